@@ -0,0 +1,384 @@
+/***********************************************************************
+AsciiPointReader - Class to parse point records from memory-mapped ASCII
+files in newline-aligned chunks on multiple threads.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "AsciiPointReader.h"
+
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdexcept>
+#include <iostream>
+#include <Misc/SizedTypes.h>
+#include <Misc/StdError.h>
+#include <Misc/FileNameExtensions.h>
+#include <Threads/Thread.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline bool isBlank(char c) // Returns true if the given character separates columns outside of strict CSV mode
+	{
+	return c==' '||c=='\t'||c=='\r';
+	}
+
+inline bool isDigit(char c)
+	{
+	return c>='0'&&c<='9';
+	}
+
+const double powersOfTen[23]= // Powers of ten that are exactly representable as doubles
+	{
+	1.0e0,1.0e1,1.0e2,1.0e3,1.0e4,1.0e5,1.0e6,1.0e7,1.0e8,1.0e9,1.0e10,1.0e11,
+	1.0e12,1.0e13,1.0e14,1.0e15,1.0e16,1.0e17,1.0e18,1.0e19,1.0e20,1.0e21,1.0e22
+	};
+
+bool parseNumber(const char*& ptr,const char* end,double& value) // Parses a decimal floating-point number independent of the current locale; returns false and leaves the pointer unchanged if there is no valid number
+	{
+	const char* p=ptr;
+	
+	/* Parse the sign: */
+	bool negative=false;
+	if(p<end&&(*p=='-'||*p=='+'))
+		{
+		negative=*p=='-';
+		++p;
+		}
+	
+	/* Accumulate up to 19 significant digits of the integer and fractional parts in an integer mantissa: */
+	Misc::UInt64 mantissa=0;
+	int numSignificantDigits=0;
+	int exponent=0;
+	bool haveDigits=false;
+	for(;p<end&&isDigit(*p);++p)
+		{
+		haveDigits=true;
+		if(numSignificantDigits<19)
+			{
+			mantissa=mantissa*10U+Misc::UInt64(*p-'0');
+			if(mantissa!=0U)
+				++numSignificantDigits;
+			}
+		else
+			++exponent;
+		}
+	if(p<end&&*p=='.')
+		{
+		for(++p;p<end&&isDigit(*p);++p)
+			{
+			haveDigits=true;
+			if(numSignificantDigits<19)
+				{
+				mantissa=mantissa*10U+Misc::UInt64(*p-'0');
+				if(mantissa!=0U)
+					++numSignificantDigits;
+				--exponent;
+				}
+			}
+		}
+	if(!haveDigits)
+		return false;
+	
+	/* Parse the optional exponent: */
+	if(p<end&&(*p=='e'||*p=='E'))
+		{
+		const char* ePtr=p+1;
+		bool negativeExponent=false;
+		if(ePtr<end&&(*ePtr=='-'||*ePtr=='+'))
+			{
+			negativeExponent=*ePtr=='-';
+			++ePtr;
+			}
+		if(ePtr<end&&isDigit(*ePtr))
+			{
+			int e=0;
+			for(;ePtr<end&&isDigit(*ePtr);++ePtr)
+				if(e<10000)
+					e=e*10+(*ePtr-'0');
+			exponent+=negativeExponent?-e:e;
+			p=ePtr;
+			}
+		}
+	
+	/* Reject numbers that run into other characters: */
+	if(p<end&&!isBlank(*p)&&*p!=','&&*p!='#')
+		return false;
+	
+	/* Scale the mantissa; the result is correctly rounded if the mantissa and the power of ten are exact: */
+	double result=double(mantissa);
+	if(exponent>=0&&exponent<=22)
+		result*=powersOfTen[exponent];
+	else if(exponent<0&&exponent>=-22)
+		result/=powersOfTen[-exponent];
+	else
+		result*=pow(10.0,double(exponent));
+	
+	value=negative?-result:result;
+	ptr=p;
+	return true;
+	}
+
+}
+
+/*********************************
+Methods of class AsciiPointReader:
+*********************************/
+
+size_t AsciiPointReader::alignToLine(size_t offset) const
+	{
+	if(offset<=dataStart)
+		return dataStart;
+	if(offset>=size)
+		return size;
+	
+	/* Find the end of the line containing the character before the offset: */
+	const char* nl=static_cast<const char*>(memchr(memory+offset-1,'\n',size-(offset-1)));
+	return nl!=0?size_t(nl+1-memory):size;
+	}
+
+bool AsciiPointReader::parseLine(const char* lPtr,const char* lineEnd,double* values) const
+	{
+	/* Initialize the record's components that are not read from any column: */
+	for(int i=0;i<numComponents;++i)
+		values[i]=componentDefaults[i];
+	
+	/* Parse all columns up to the last used one: */
+	int numColumns=int(columnComponents.size());
+	for(int column=0;column<numColumns;++column)
+		{
+		if(column>0)
+			{
+			/* Skip the column separator: */
+			while(lPtr<lineEnd&&isBlank(*lPtr))
+				++lPtr;
+			if(lPtr<lineEnd&&*lPtr==',')
+				++lPtr;
+			else if(strictCsv)
+				return false;
+			}
+		while(lPtr<lineEnd&&isBlank(*lPtr))
+			++lPtr;
+		
+		if(columnComponents[column]>=0)
+			{
+			/* Parse the column's value: */
+			if(!parseNumber(lPtr,lineEnd,values[columnComponents[column]]))
+				return false;
+			}
+		else
+			{
+			/* Skip the column: */
+			while(lPtr<lineEnd&&*lPtr!=','&&(strictCsv||!isBlank(*lPtr)))
+				++lPtr;
+			}
+		}
+	
+	return true;
+	}
+
+void* AsciiPointReader::parserThreadMethod(void)
+	{
+	std::vector<double> values; // Components of the parsed lines of the current chunk
+	std::vector<size_t> badLines; // Indices of the lines of the current chunk that could not be parsed
+	while(true)
+		{
+		/* Grab the next chunk: */
+		unsigned int chunkIndex=nextChunkIndex.preAdd(1U)-1U;
+		if(chunkIndex>=numChunks)
+			break;
+		size_t nominalStart=dataStart+size_t(chunkIndex)*chunkSize;
+		const char* cPtr=memory+alignToLine(nominalStart);
+		const char* cEnd=memory+alignToLine(nominalStart+chunkSize);
+		
+		/* Parse all lines starting inside the chunk: */
+		values.clear();
+		badLines.clear();
+		size_t numLines=0;
+		size_t numParsedLines=0;
+		while(cPtr<cEnd)
+			{
+			/* Find the end of the line: */
+			const char* lineEnd=static_cast<const char*>(memchr(cPtr,'\n',cEnd-cPtr));
+			if(lineEnd==0)
+				lineEnd=cEnd;
+			
+			/* Skip empty lines and comment lines: */
+			const char* lPtr=cPtr;
+			while(lPtr<lineEnd&&isBlank(*lPtr))
+				++lPtr;
+			if(lPtr<lineEnd&&*lPtr!='#')
+				{
+				/* Parse the line into the next record: */
+				values.resize((numParsedLines+1)*size_t(numComponents));
+				if(parseLine(lPtr,lineEnd,&values[numParsedLines*size_t(numComponents)]))
+					++numParsedLines;
+				else
+					badLines.push_back(numLines);
+				}
+			
+			++numLines;
+			cPtr=lineEnd+1;
+			}
+		
+		/* Wait until all preceding chunks have been delivered: */
+		Threads::Mutex::Lock deliveryLock(deliveryMutex);
+		while(nextDeliveredChunk!=chunkIndex&&!failed)
+			deliveryCond.wait(deliveryMutex);
+		if(failed)
+			break;
+		
+		/* Report malformed lines: */
+		for(std::vector<size_t>::iterator blIt=badLines.begin();blIt!=badLines.end();++blIt)
+			std::cerr<<"Point parsing error in line "<<size_t(numHeaderLines)+numDeliveredLines+*blIt+1<<" in input file "<<fileName<<std::endl;
+		numBadLines+=badLines.size();
+		
+		/* Deliver the chunk's records: */
+		try
+			{
+			if(numParsedLines>0)
+				consumer->consumeLines(&values[0],numParsedLines);
+			}
+		catch(const std::runtime_error& err)
+			{
+			/* Stop all threads: */
+			failed=true;
+			errorMessage=err.what();
+			deliveryCond.broadcast();
+			break;
+			}
+		
+		numDeliveredLines+=numLines;
+		++nextDeliveredChunk;
+		deliveryCond.broadcast();
+		}
+	
+	return 0;
+	}
+
+bool AsciiPointReader::canRead(const char* fileName)
+	{
+	/* Compressed files are decompressed by the IO library and can not be mapped: */
+	if(Misc::hasCaseExtension(fileName,".gz"))
+		return false;
+	
+	struct stat fileStats;
+	return stat(fileName,&fileStats)==0&&S_ISREG(fileStats.st_mode);
+	}
+
+AsciiPointReader::AsciiPointReader(const char* sFileName,int sNumComponents,const int componentColumnIndices[],const double sComponentDefaults[],int sNumHeaderLines,bool sStrictCsv)
+	:fileName(sFileName),
+	 fd(-1),size(0),memory(0),
+	 numComponents(sNumComponents),
+	 componentDefaults(sComponentDefaults,sComponentDefaults+sNumComponents),
+	 strictCsv(sStrictCsv),numHeaderLines(sNumHeaderLines),dataStart(0),
+	 consumer(0),nextChunkIndex(0U),numChunks(0),
+	 nextDeliveredChunk(0),numDeliveredLines(0),numBadLines(0),failed(false)
+	{
+	/* Create the mapping from columns to record components: */
+	int maxColumnIndex=-1;
+	for(int i=0;i<numComponents;++i)
+		if(maxColumnIndex<componentColumnIndices[i])
+			maxColumnIndex=componentColumnIndices[i];
+	columnComponents.resize(maxColumnIndex+1,-1);
+	for(int i=0;i<numComponents;++i)
+		if(componentColumnIndices[i]>=0)
+			columnComponents[componentColumnIndices[i]]=i;
+	
+	/* Open the file: */
+	fd=open(fileName.c_str(),O_RDONLY);
+	if(fd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot open file %s",fileName.c_str());
+	
+	/* Get the file's size: */
+	struct stat fileStats;
+	if(fstat(fd,&fileStats)<0)
+		{
+		int error=errno;
+		close(fd);
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot determine size of file %s",fileName.c_str());
+		}
+	size=size_t(fileStats.st_size);
+	
+	if(size>0)
+		{
+		/* Map the entire file read-only: */
+		void* mapping=mmap(0,size,PROT_READ,MAP_SHARED,fd,0);
+		if(mapping==MAP_FAILED)
+			{
+			int error=errno;
+			close(fd);
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot map file %s",fileName.c_str());
+			}
+		memory=static_cast<const char*>(mapping);
+		
+		/* The file is parsed front to back by all threads together: */
+		madvise(mapping,size,MADV_SEQUENTIAL);
+		}
+	
+	/* Skip the header lines: */
+	for(int i=0;i<numHeaderLines&&dataStart<size;++i)
+		{
+		const char* nl=static_cast<const char*>(memchr(memory+dataStart,'\n',size-dataStart));
+		dataStart=nl!=0?size_t(nl+1-memory):size;
+		}
+	numChunks=(unsigned int)((size-dataStart+chunkSize-1)/chunkSize);
+	}
+
+AsciiPointReader::~AsciiPointReader(void)
+	{
+	/* Unmap and close the file: */
+	if(memory!=0)
+		munmap(const_cast<char*>(memory),size);
+	close(fd);
+	}
+
+size_t AsciiPointReader::readLines(unsigned int numThreads,AsciiPointReader::LineConsumer& newConsumer)
+	{
+	if(numThreads<1U)
+		numThreads=1U;
+	if(numThreads>numChunks)
+		numThreads=numChunks>0?numChunks:1U;
+	
+	/* Run the parser threads: */
+	consumer=&newConsumer;
+	Threads::Thread* threads=new Threads::Thread[numThreads];
+	for(unsigned int i=0;i<numThreads;++i)
+		threads[i].start(this,&AsciiPointReader::parserThreadMethod);
+	for(unsigned int i=0;i<numThreads;++i)
+		threads[i].join();
+	delete[] threads;
+	consumer=0;
+	
+	/* Report the consumer's error: */
+	if(failed)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Error %s while reading file %s",errorMessage.c_str(),fileName.c_str());
+	
+	return numBadLines;
+	}
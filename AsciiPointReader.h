@@ -0,0 +1,105 @@
+/***********************************************************************
+AsciiPointReader - Class to parse point records from memory-mapped ASCII
+files in newline-aligned chunks on multiple threads.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef ASCIIPOINTREADER_INCLUDED
+#define ASCIIPOINTREADER_INCLUDED
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <Threads/Mutex.h>
+#include <Threads/Cond.h>
+#include <Threads/Atomic.h>
+
+/***********************************************************************
+Each line of an ASCII point file holds one point record as a sequence
+of columns, separated by whitespace and/or single commas, or by single
+commas only in strict CSV mode. Empty lines and lines starting with '#'
+are skipped. The reader maps selected columns to the components of a
+fixed-size record, parses numbers without going through the C locale,
+and passes the parsed records to a consumer in file order.
+***********************************************************************/
+
+class AsciiPointReader
+	{
+	/* Embedded classes: */
+	public:
+	class LineConsumer // Abstract base class for receivers of parsed point records
+		{
+		/* Constructors and destructors: */
+		public:
+		virtual ~LineConsumer(void)
+			{
+			}
+		
+		/* Methods: */
+		virtual void consumeLines(const double* values,size_t numLines) =0; // Called with the components of consecutive parsed lines in file order, with the number of components per line given to the reader; calls are serialized
+		};
+	
+	static const size_t chunkSize=4*1024*1024; // Nominal size of the chunks parsed independently by each thread in bytes
+	
+	/* Elements: */
+	private:
+	std::string fileName; // Name of the ASCII file
+	int fd; // File descriptor of the mapped file
+	size_t size; // Size of the mapped file in bytes
+	const char* memory; // Pointer to the beginning of the mapped file
+	int numComponents; // Number of components in each parsed record
+	std::vector<int> columnComponents; // Record component read from each column up to the last used column, or -1 for skipped columns
+	std::vector<double> componentDefaults; // Values of record components not read from any column
+	bool strictCsv; // Flag whether columns are separated by single commas only
+	int numHeaderLines; // Number of header lines skipped at the beginning of the file
+	size_t dataStart; // Offset of the first line after the header lines
+	
+	/* Transient state during multithreaded reading: */
+	LineConsumer* consumer; // The receiver of parsed records
+	Threads::Atomic<unsigned int> nextChunkIndex; // Index of the next chunk to be parsed by any thread
+	unsigned int numChunks; // Number of chunks in the file
+	Threads::Mutex deliveryMutex; // Mutex serializing deliveries to the consumer
+	Threads::Cond deliveryCond; // Condition variable signalling that a chunk has been delivered
+	unsigned int nextDeliveredChunk; // Index of the chunk to be delivered next, to keep records in file order
+	size_t numDeliveredLines; // Number of lines in all chunks delivered so far, to report line numbers
+	size_t numBadLines; // Number of lines that could not be parsed
+	bool failed; // Flag whether the consumer threw an exception
+	std::string errorMessage; // Error message of the consumer's exception
+	
+	/* Private methods: */
+	size_t alignToLine(size_t offset) const; // Returns the offset of the first line starting at or after the given offset
+	bool parseLine(const char* lPtr,const char* lineEnd,double* values) const; // Parses a non-empty line into the given record; returns false if the line is malformed
+	void* parserThreadMethod(void); // Thread method parsing chunks until all chunks are taken
+	
+	/* Constructors and destructors: */
+	public:
+	static bool canRead(const char* fileName); // Returns true if the given file is an uncompressed regular file that can be mapped into memory
+	AsciiPointReader(const char* sFileName,int sNumComponents,const int componentColumnIndices[],const double sComponentDefaults[],int sNumHeaderLines,bool sStrictCsv); // Maps the given ASCII file to read records of the given number of components from the given columns, or set to the given default values for column index -1; throws exception if the file cannot be mapped
+	private:
+	AsciiPointReader(const AsciiPointReader& source); // Prohibit copy constructor
+	AsciiPointReader& operator=(const AsciiPointReader& source); // Prohibit assignment operator
+	public:
+	~AsciiPointReader(void); // Unmaps and closes the file
+	
+	/* Methods: */
+	size_t readLines(unsigned int numThreads,LineConsumer& newConsumer); // Parses all lines using the given number of threads and passes the parsed records to the given consumer in file order; reports malformed lines and returns their number; can only be called once
+	};
+
+#endif
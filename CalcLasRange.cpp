@@ -1,7 +1,7 @@
 /***********************************************************************
 CalcLasRange - Utility program to calculate the spatial extent and range
 of point return intensities or colors stored in a set of .LAS files.
-Copyright (c) 2006-2020 Oliver Kreylos
+Copyright (c) 2006-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -22,17 +22,185 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 ***********************************************************************/
 
 #include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <Misc/FileNameExtensions.h>
 #include <IO/File.h>
 #include <IO/OpenFile.h>
 #include <Math/Math.h>
 #include <Math/Constants.h>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
 
-size_t checkLasFileRange(const char* fileName,double bbox[6],bool getColorRange,float intensityRange[2],float rgbRange[3][2])
+#include "LazReader.h"
+
+struct FileRange // Structure holding the spatial extent and attribute ranges of a single LAS or LAZ file
+	{
+	/* Elements: */
+	public:
+	bool valid; // Flag whether the file could be read
+	bool scanned; // Flag whether the file's point records were read, or only its header
+	size_t numPoints; // Number of point records read from the file
+	double bbox[6]; // The file's bounding box; taken from the point records if they were read, and from the header otherwise
+	float intensityRange[2]; // Range of the file's point intensities
+	float rgbRange[3][2]; // Ranges of the file's point color components
+	
+	/* Constructors and destructors: */
+	FileRange(void)
+		:valid(false),scanned(false),numPoints(0)
+		{
+		for(int i=0;i<3;++i)
+			{
+			bbox[i]=Math::Constants<double>::max;
+			bbox[3+i]=Math::Constants<double>::min;
+			}
+		intensityRange[0]=Math::Constants<float>::max;
+		intensityRange[1]=Math::Constants<float>::min;
+		for(int i=0;i<3;++i)
+			{
+			rgbRange[i][0]=Math::Constants<float>::max;
+			rgbRange[i][1]=Math::Constants<float>::min;
+			}
+		}
+	
+	/* Methods: */
+	void addPosition(const int pos[3],const double scale[3],const double offset[3]) // Adds a point record's position to the record bounding box
+		{
+		for(int i=0;i<3;++i)
+			{
+			double p=double(pos[i])*scale[i]+offset[i];
+			if(bbox[i]>p)
+				bbox[i]=p;
+			if(bbox[3+i]<p)
+				bbox[3+i]=p;
+			}
+		}
+	void addIntensity(float intensity)
+		{
+		if(intensityRange[0]>intensity)
+			intensityRange[0]=intensity;
+		if(intensityRange[1]<intensity)
+			intensityRange[1]=intensity;
+		}
+	void addRgb(const unsigned short rgb[3])
+		{
+		for(int j=0;j<3;++j)
+			{
+			float value=float(rgb[j]);
+			if(rgbRange[j][0]>value)
+				rgbRange[j][0]=value;
+			if(rgbRange[j][1]<value)
+				rgbRange[j][1]=value;
+			}
+		}
+	void merge(const FileRange& other) // Merges another file's extent and ranges into this one
+		{
+		numPoints+=other.numPoints;
+		for(int i=0;i<3;++i)
+			{
+			if(bbox[i]>other.bbox[i])
+				bbox[i]=other.bbox[i];
+			if(bbox[3+i]<other.bbox[3+i])
+				bbox[3+i]=other.bbox[3+i];
+			}
+		if(intensityRange[0]>other.intensityRange[0])
+			intensityRange[0]=other.intensityRange[0];
+		if(intensityRange[1]<other.intensityRange[1])
+			intensityRange[1]=other.intensityRange[1];
+		for(int j=0;j<3;++j)
+			{
+			if(rgbRange[j][0]>other.rgbRange[j][0])
+				rgbRange[j][0]=other.rgbRange[j][0];
+			if(rgbRange[j][1]<other.rgbRange[j][1])
+				rgbRange[j][1]=other.rgbRange[j][1];
+			}
+		}
+	};
+
+class LazRangeCalculator:public LazReader::BlockConsumer // Helper class to accumulate bounding boxes and intensity and color ranges from blocks of decompressed LAZ point records
+	{
+	/* Elements: */
+	private:
+	bool rgb; // Flag whether the point records contain colors
+	const double* scale; // Scale factors from scaled integer to file coordinates
+	const double* offset; // Offset from scaled integer to file coordinates
+	FileRange& range; // Accumulated file range
+	
+	/* Constructors and destructors: */
+	public:
+	LazRangeCalculator(bool sRgb,const double sScale[3],const double sOffset[3],FileRange& sRange)
+		:rgb(sRgb),scale(sScale),offset(sOffset),range(sRange)
+		{
+		}
+	
+	/* Methods from class LazReader::BlockConsumer: */
+	virtual void consumeBlock(const LazReader::PointRecord* records,size_t numRecords)
+		{
+		for(size_t i=0;i<numRecords;++i)
+			{
+			range.addPosition(records[i].position,scale,offset);
+			range.addIntensity(float(records[i].intensity));
+			if(rgb)
+				range.addRgb(records[i].rgb);
+			}
+		}
+	};
+
+void checkLazFileRange(const char* fileName,bool scanRecords,unsigned int numThreads,FileRange& range,std::string& message)
+	{
+	try
+		{
+		/* Open the LAZ input file: */
+		LazReader reader(fileName);
+		range.numPoints=reader.getNumPoints();
+		
+		if(scanRecords)
+			{
+			/* Read all points: */
+			LazRangeCalculator lrc(reader.hasRgb(),reader.getScale(),reader.getOffset(),range);
+			reader.readPoints(numThreads,lrc);
+			range.scanned=true;
+			}
+		
+		if(range.numPoints==0||!scanRecords)
+			{
+			/* Trust the bounding box from the file header: */
+			for(int i=0;i<3;++i)
+				{
+				range.bbox[i]=reader.getMin()[i];
+				range.bbox[3+i]=reader.getMax()[i];
+				}
+			}
+		range.valid=true;
+		}
+	catch(const std::runtime_error& err)
+		{
+		message="caused exception ";
+		message.append(err.what());
+		message.append(" while reading LAZ file");
+		}
+	}
+
+void checkLasFileRange(const char* fileName,bool scanRecords,FileRange& range,std::string& message)
 	{
 	/* Open the LAS input file: */
-	IO::FilePtr file(IO::openFile(fileName));
+	IO::FilePtr file;
+	try
+		{
+		file=IO::openFile(fileName);
+		}
+	catch(const std::runtime_error& err)
+		{
+		message="caused exception ";
+		message.append(err.what());
+		message.append(" while opening LAS file");
+		return;
+		}
 	file->resizeReadBuffer(1048576);
 	file->setEndianness(Misc::LittleEndian);
 	
@@ -40,6 +208,9 @@ size_t checkLasFileRange(const char* fileName,double bbox[6],bool getColorRange,
 	unsigned char pointDataFormat=0;
 	unsigned int numPointRecords=0;
 	unsigned int pointDataOffset=0;
+	double scale[3];
+	double offset[3];
+	double min[3],max[3];
 	try
 		{
 		/* Read the LAS file header: */
@@ -47,8 +218,8 @@ size_t checkLasFileRange(const char* fileName,double bbox[6],bool getColorRange,
 		file->read(signature,4);
 		if(memcmp(signature,"LASF",4)!=0)
 			{
-			std::cout<<"File "<<fileName<<" is not a LAS file"<<std::endl;
-			return 0;
+			message="is not a LAS file";
+			return;
 			}
 		
 		file->read<unsigned short>(); // Ignore file source ID
@@ -66,121 +237,170 @@ size_t checkLasFileRange(const char* fileName,double bbox[6],bool getColorRange,
 		pointDataOffset=file->read<unsigned int>();
 		file->read<unsigned int>(); // Ignore number of variable-length records
 		pointDataFormat=file->read<unsigned char>();
-		unsigned short pointDataRecordLength=file->read<unsigned short>();
+		file->read<unsigned short>(); // Ignore point data record length
 		numPointRecords=file->read<unsigned int>();
 		unsigned int numPointsByReturn[5];
 		file->read(numPointsByReturn,5);
-		double scale[3];
 		file->read(scale,3);
-		double offset[3];
 		file->read(offset,3);
-		double min[3],max[3];
 		for(int i=0;i<3;++i)
 			{
 			max[i]=file->read<double>();
 			min[i]=file->read<double>();
-			if(bbox[i]>min[i])
-				bbox[i]=min[i];
-			if(bbox[3+i]<max[i])
-				bbox[3+i]=max[i];
 			}
-		
-		#if 0
-		std::cout<<"Input file contains "<<numPointRecords<<" points."<<std::endl;
-		std::cout<<"Point record size: "<<pointDataRecordLength<<" bytes"<<std::endl;
-		std::cout<<"Point transformation scale and offset: ("<<scale[0]<<", "<<scale[1]<<", "<<scale[2]<<"), ("<<offset[0]<<", "<<offset[1]<<", "<<offset[2]<<")"<<std::endl;
-		std::cout<<"Point set bounds: ["<<min[0]<<", "<<max[0]<<"] x ["<<min[1]<<", "<<max[1]<<"] x ["<<min[2]<<", "<<max[2]<<"]"<<std::endl;
-		#endif
 		}
 	catch(const std::runtime_error& err)
 		{
-		std::cout<<"File "<<fileName<<" caused exception "<<err.what()<<" while reading LAS file header"<<std::endl;
-		return 0;
+		message="caused exception ";
+		message.append(err.what());
+		message.append(" while reading LAS file header");
+		return;
 		}
 	
-	if(!getColorRange)
+	range.valid=true;
+	range.numPoints=numPointRecords;
+	if(scanRecords)
 		{
-		std::cout<<" done."<<std::endl;
-		return numPointRecords;
-		}
-	
-	/* Read all points: */
-	std::cout<<"Reading input points..."<<std::flush;
-	unsigned int pointIndex=0;
-	try
-		{
-		/* Skip to the beginning of the point data records: */
-		if(pointDataOffset<227)
-			{
-			std::cout<<"File "<<fileName<<" has invalid LAS file header"<<std::endl;
-			return 0;
-			}
-		file->skip<unsigned char>(pointDataOffset-227);
-		
-		for(pointIndex=0;pointIndex<numPointRecords;++pointIndex)
+		/* Read all points: */
+		range.scanned=true;
+		unsigned int pointIndex=0;
+		try
 			{
-			/* Read the point position: */
-			int pos[3];
-			file->read(pos,3);
-			
-			/* Read the point intensity: */
-			float intensity=float(file->read<unsigned short>());
-			if(intensityRange[0]>intensity)
-				intensityRange[0]=intensity;
-			if(intensityRange[1]<intensity)
-				intensityRange[1]=intensity;
+			/* Skip to the beginning of the point data records: */
+			if(pointDataOffset<227)
+				{
+				message="has invalid LAS file header";
+				range.valid=false;
+				return;
+				}
+			file->skip<unsigned char>(pointDataOffset-227);
 			
-			/* Skip irrelevant information: */
-			file->skip<char>(4);
-			file->read<unsigned short>();
-			if(pointDataFormat&0x1)
-				file->read<double>();
-			if(pointDataFormat>=2)
+			for(pointIndex=0;pointIndex<numPointRecords;++pointIndex)
 				{
-				/* Read the point color: */
-				unsigned short rgb[3];
-				file->read(rgb,3);
-				for(int j=0;j<3;++j)
+				/* Read the point position: */
+				int pos[3];
+				file->read(pos,3);
+				range.addPosition(pos,scale,offset);
+				
+				/* Read the point intensity: */
+				range.addIntensity(float(file->read<unsigned short>()));
+				
+				/* Skip irrelevant information: */
+				file->skip<char>(4);
+				file->read<unsigned short>();
+				if(pointDataFormat&0x1)
+					file->read<double>();
+				if(pointDataFormat>=2)
 					{
-					float value=float(rgb[j]);
-					if(rgbRange[j][0]>value)
-						rgbRange[j][0]=value;
-					if(rgbRange[j][1]<value)
-						rgbRange[j][1]=value;
+					/* Read the point color: */
+					unsigned short rgb[3];
+					file->read(rgb,3);
+					range.addRgb(rgb);
 					}
 				}
 			}
-		std::cout<<" done."<<std::endl;
+		catch(const std::runtime_error& err)
+			{
+			std::ostringstream str;
+			str<<"terminated after "<<pointIndex<<" point records due to exception "<<err.what();
+			message=str.str();
+			}
+		range.numPoints=pointIndex;
 		}
-	catch(const std::runtime_error& err)
+	
+	if(range.numPoints==0||!scanRecords)
 		{
-		std::cout<<" terminated after "<<pointIndex<<" point records due to exception "<<err.what()<<std::endl;
+		/* Trust the bounding box from the file header: */
+		for(int i=0;i<3;++i)
+			{
+			range.bbox[i]=min[i];
+			range.bbox[3+i]=max[i];
+			}
 		}
-	
-	return pointIndex;
 	}
 
-int main(int argc,char* argv[])
+class FileChecker // Class to check the ranges of a list of LAS or LAZ files on multiple threads
 	{
-	double bbox[6];
-	for(int i=0;i<3;++i)
+	/* Elements: */
+	private:
+	const std::vector<const char*>& fileNames; // Names of all files to check
+	bool scanRecords; // Flag whether to read all point records, or only file headers
+	unsigned int numLazThreads; // Number of threads decompressing each LAZ file
+	std::vector<FileRange>& ranges; // Ranges of all files
+	Threads::Mutex fileMutex; // Mutex serializing access to the next file index and to the console
+	size_t nextFileIndex; // Index of the next file to be checked
+	size_t numCheckedFiles; // Number of files checked so far
+	
+	/* Private methods: */
+	void* checkerThreadMethod(void) // Thread method checking files until all files have been checked
 		{
-		bbox[i]=Math::Constants<double>::max;
-		bbox[3+i]=Math::Constants<double>::min;
+		while(true)
+			{
+			/* Grab the next file: */
+			size_t fileIndex;
+			{
+			Threads::Mutex::Lock fileLock(fileMutex);
+			if(nextFileIndex>=fileNames.size())
+				break;
+			fileIndex=nextFileIndex;
+			++nextFileIndex;
+			}
+			
+			/* Check the file: */
+			std::string message;
+			if(strcasecmp(Misc::getExtension(fileNames[fileIndex]),".laz")==0)
+				checkLazFileRange(fileNames[fileIndex],scanRecords,numLazThreads,ranges[fileIndex],message);
+			else
+				checkLasFileRange(fileNames[fileIndex],scanRecords,ranges[fileIndex],message);
+			
+			/* Report progress: */
+			{
+			Threads::Mutex::Lock fileLock(fileMutex);
+			++numCheckedFiles;
+			std::cout<<"Checked file "<<numCheckedFiles<<" of "<<fileNames.size()<<": "<<fileNames[fileIndex];
+			if(message.empty())
+				std::cout<<", "<<ranges[fileIndex].numPoints<<" points"<<std::endl;
+			else
+				std::cout<<' '<<message<<std::endl;
+			}
+			}
+		
+		return 0;
 		}
-	float intensityRange[2];
-	intensityRange[0]=Math::Constants<float>::max;
-	intensityRange[1]=Math::Constants<float>::min;
-	float rgbRange[3][2];
-	for(int i=0;i<3;++i)
+	
+	/* Constructors and destructors: */
+	public:
+	FileChecker(const std::vector<const char*>& sFileNames,bool sScanRecords,unsigned int sNumLazThreads,std::vector<FileRange>& sRanges)
+		:fileNames(sFileNames),scanRecords(sScanRecords),numLazThreads(sNumLazThreads),
+		 ranges(sRanges),
+		 nextFileIndex(0),numCheckedFiles(0)
 		{
-		rgbRange[i][0]=Math::Constants<float>::max;
-		rgbRange[i][1]=Math::Constants<float>::min;
+		ranges.clear();
+		ranges.resize(fileNames.size());
 		}
 	
+	/* Methods: */
+	void check(unsigned int numThreads) // Checks all files using the given number of threads
+		{
+		if(numThreads<1U)
+			numThreads=1U;
+		Threads::Thread* threads=new Threads::Thread[numThreads];
+		for(unsigned int i=0;i<numThreads;++i)
+			threads[i].start(this,&FileChecker::checkerThreadMethod);
+		for(unsigned int i=0;i<numThreads;++i)
+			threads[i].join();
+		delete[] threads;
+		}
+	};
+
+int main(int argc,char* argv[])
+	{
 	/* Parse the command line: */
 	bool getColorRange=true;
 	const char* sceneGraphName=0;
+	const char* catalogName=0;
+	unsigned int numThreads=1;
+	unsigned int numFileThreads=1;
 	int argi;
 	for(argi=1;argi<argc&&argv[argi][0]=='-';++argi)
 		{
@@ -195,8 +415,45 @@ int main(int argc,char* argv[])
 			++argi;
 			sceneGraphName=argv[argi];
 			}
+		else if(strcasecmp(argv[argi]+1,"catalog")==0)
+			{
+			/* Create a catalog file listing the extents and ranges of all LAS files: */
+			++argi;
+			if(argi<argc)
+				catalogName=argv[argi];
+			else
+				std::cerr<<"Ignoring dangling -catalog option"<<std::endl;
+			}
+		else if(strcasecmp(argv[argi]+1,"nt")==0)
+			{
+			/* Set the number of threads decompressing LAZ files: */
+			++argi;
+			if(argi<argc)
+				numThreads=(unsigned int)(atoi(argv[argi]));
+			else
+				std::cerr<<"Ignoring dangling -nt option"<<std::endl;
+			}
+		else if(strcasecmp(argv[argi]+1,"nf")==0)
+			{
+			/* Set the number of files checked in parallel: */
+			++argi;
+			if(argi<argc)
+				numFileThreads=(unsigned int)(atoi(argv[argi]));
+			else
+				std::cerr<<"Ignoring dangling -nf option"<<std::endl;
+			}
 		}
 	
+	/* Check all LAS files from the command line: */
+	std::vector<const char*> fileNames;
+	for(;argi<argc;++argi)
+		fileNames.push_back(argv[argi]);
+	std::vector<FileRange> ranges;
+	{
+	FileChecker checker(fileNames,getColorRange,numThreads,ranges);
+	checker.check(numFileThreads);
+	}
+	
 	std::ofstream sceneGraph;
 	if(sceneGraphName!=0)
 		{
@@ -206,32 +463,36 @@ int main(int argc,char* argv[])
 		sceneGraph.precision(12);
 		}
 	
-	/* Process all LAS files from the command line: */
-	int firstLasFile=argi;
-	int numLasFiles=argc-firstLasFile;
-	size_t totalNumPoints=0;
-	for(;argi<argc;++argi)
+	std::ofstream catalog;
+	if(catalogName!=0)
+		{
+		/* Create a catalog file: */
+		catalog.open(catalogName);
+		catalog<<"# LAS file catalog created by CalcLasRange"<<std::endl;
+		catalog<<"# <number of points> <header | records> <min x> <min y> <min z> <max x> <max y> <max z> <intensity min> <intensity max> <red min> <red max> <green min> <green max> <blue min> <blue max> <file name>"<<std::endl;
+		catalog.precision(12);
+		}
+	
+	/* Merge the ranges of all successfully checked files: */
+	FileRange total;
+	bool firstSceneGraphNode=true;
+	for(size_t fileIndex=0;fileIndex<fileNames.size();++fileIndex)
 		{
-		std::cout<<"Checking file "<<argi+1-firstLasFile<<" of "<<numLasFiles<<":"<<argv[argi]<<"..."<<std::flush;
+		const FileRange& range=ranges[fileIndex];
+		if(!range.valid)
+			continue;
+		total.merge(range);
+		
 		if(sceneGraphName!=0)
 			{
-			/* Create a new bounding box for this LAS file: */
-			double fileBbox[6];
-			for(int i=0;i<3;++i)
-				{
-				fileBbox[i]=Math::Constants<double>::max;
-				fileBbox[3+i]=Math::Constants<double>::min;
-				}
-			
-			/* Get the LAS file's extents: */
-			totalNumPoints+=checkLasFileRange(argv[argi],fileBbox,getColorRange,intensityRange,rgbRange);
+			const double* fileBbox=range.bbox;
 			
 			/* Create a scene graph node for this LAS file: */
 			sceneGraph<<"\n\
 				Shape\n\
 					{\n";
 			
-			if(argi==firstLasFile)
+			if(firstSceneGraphNode)
 				{
 				sceneGraph<<"\
 					appearance DEF Red Appearance\n\
@@ -288,13 +549,13 @@ int main(int argc,char* argv[])
 								{\n";
 			
 			/* Show the LAS file's base name: */
-			const char* basePtr=argv[argi];
-			for(const char* fnPtr=argv[argi];*fnPtr!='\0';++fnPtr)
+			const char* basePtr=fileNames[fileIndex];
+			for(const char* fnPtr=fileNames[fileIndex];*fnPtr!='\0';++fnPtr)
 				if(*fnPtr=='/')
 					basePtr=fnPtr+1;
 			sceneGraph<<"\t\t\t\t\t\t\t\tstring \""<<basePtr<<"\""<<std::endl;
 			
-			if(argi==firstLasFile)
+			if(firstSceneGraphNode)
 				{
 				sceneGraph<<"\
 								fontStyle DEF Sans FontStyle\n\
@@ -319,24 +580,36 @@ int main(int argc,char* argv[])
 						]\n\
 					}\n";
 			
-			/* Merge the LAS file's bounding box with the overall box: */
-			for(int i=0;i<3;++i)
+			firstSceneGraphNode=false;
+			}
+		
+		if(catalogName!=0)
+			{
+			/* Write a catalog entry for this LAS file: */
+			catalog<<range.numPoints<<(range.scanned?" records":" header");
+			for(int i=0;i<6;++i)
+				catalog<<' '<<range.bbox[i];
+			if(range.scanned&&range.numPoints>0)
 				{
-				if(bbox[i]>fileBbox[i])
-					bbox[i]=fileBbox[i];
-				if(bbox[3+i]<fileBbox[3+i])
-					bbox[3+i]=fileBbox[3+i];
+				catalog<<' '<<range.intensityRange[0]<<' '<<range.intensityRange[1];
+				for(int j=0;j<3;++j)
+					catalog<<' '<<range.rgbRange[j][0]<<' '<<range.rgbRange[j][1];
 				}
+			else
+				{
+				/* There are no attribute ranges: */
+				for(int i=0;i<8;++i)
+					catalog<<" 0";
+				}
+			catalog<<' '<<fileNames[fileIndex]<<std::endl;
 			}
-		else
-			totalNumPoints+=checkLasFileRange(argv[argi],bbox,getColorRange,intensityRange,rgbRange);
 		}
-	std::cout<<"Total number of points: "<<totalNumPoints<<std::endl;
-	std::cout<<"Overall point bounding box: ["<<bbox[0]<<", "<<bbox[3]<<"] x ["<<bbox[1]<<", "<<bbox[4]<<"] x ["<<bbox[2]<<", "<<bbox[5]<<"]"<<std::endl;
+	std::cout<<"Total number of points: "<<total.numPoints<<std::endl;
+	std::cout<<"Overall point bounding box: ["<<total.bbox[0]<<", "<<total.bbox[3]<<"] x ["<<total.bbox[1]<<", "<<total.bbox[4]<<"] x ["<<total.bbox[2]<<", "<<total.bbox[5]<<"]"<<std::endl;
 	if(getColorRange)
 		{
-		std::cout<<"Overall intensity range: ["<<intensityRange[0]<<", "<<intensityRange[1]<<"]"<<std::endl;
-		std::cout<<"Overall RGB range: ["<<rgbRange[0][0]<<", "<<rgbRange[0][1]<<"], ["<<rgbRange[1][0]<<", "<<rgbRange[1][1]<<"], ["<<rgbRange[2][0]<<", "<<rgbRange[2][1]<<"]"<<std::endl;
+		std::cout<<"Overall intensity range: ["<<total.intensityRange[0]<<", "<<total.intensityRange[1]<<"]"<<std::endl;
+		std::cout<<"Overall RGB range: ["<<total.rgbRange[0][0]<<", "<<total.rgbRange[0][1]<<"], ["<<total.rgbRange[1][0]<<", "<<total.rgbRange[1][1]<<"], ["<<total.rgbRange[2][0]<<", "<<total.rgbRange[2][1]<<"]"<<std::endl;
 		}
 	
 	if(sceneGraphName!=0)
@@ -345,9 +618,15 @@ int main(int argc,char* argv[])
 		sceneGraph.close();
 		}
 	
+	if(catalogName!=0)
+		{
+		/* Close the catalog file: */
+		catalog.close();
+		}
+	
 	std::cout<<"Recommended offset vector for LiDAR pre-processor: -lasOffset";
 	for(int i=0;i<3;++i)
-		std::cout<<' '<<-Math::mid(bbox[i],bbox[3+i]);
+		std::cout<<' '<<-Math::mid(total.bbox[i],total.bbox[3+i]);
 	std::cout<<std::endl;
 	
 	return 0;
@@ -0,0 +1,122 @@
+/***********************************************************************
+CameraPath - Class to record and replay a timed sequence of navigation
+transformations.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "CameraPath.h"
+
+#include <stdio.h>
+#include <Misc/StdError.h>
+#include <IO/OpenFile.h>
+#include <IO/ValueSource.h>
+#include <Math/Math.h>
+
+/***************************
+Methods of class CameraPath:
+***************************/
+
+CameraPath::CameraPath(void)
+	{
+	}
+
+CameraPath::CameraPath(const char* pathFileName)
+	{
+	/* Read the path file, one keyframe per line as time, translation vector, scaled rotation axis, and scaling factor: */
+	IO::ValueSource path(IO::openFile(pathFileName));
+	path.skipWs();
+	while(!path.eof())
+		{
+		Keyframe kf;
+		kf.time=path.readNumber();
+		Vrui::Vector translation;
+		for(int i=0;i<3;++i)
+			translation[i]=Vrui::Scalar(path.readNumber());
+		Vrui::Vector scaledAxis;
+		for(int i=0;i<3;++i)
+			scaledAxis[i]=Vrui::Scalar(path.readNumber());
+		Vrui::Scalar scaling=Vrui::Scalar(path.readNumber());
+		kf.navigation=Vrui::NavTransform(translation,Vrui::Rotation::rotateScaledAxis(scaledAxis),scaling);
+		
+		if(!keyframes.empty()&&kf.time<keyframes.back().time)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Keyframes in path file %s are out of order",pathFileName);
+		keyframes.push_back(kf);
+		}
+	
+	if(keyframes.empty())
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Path file %s contains no keyframes",pathFileName);
+	}
+
+void CameraPath::addKeyframe(double time,const Vrui::NavTransform& navigation)
+	{
+	Keyframe kf;
+	kf.time=time;
+	kf.navigation=navigation;
+	keyframes.push_back(kf);
+	}
+
+Vrui::NavTransform CameraPath::getNavigation(double time) const
+	{
+	/* Clamp the time to the path's range: */
+	if(time<=keyframes.front().time)
+		return keyframes.front().navigation;
+	if(time>=keyframes.back().time)
+		return keyframes.back().navigation;
+	
+	/* Find the pair of keyframes bracketing the given time: */
+	size_t l=0;
+	size_t r=keyframes.size()-1;
+	while(r-l>1)
+		{
+		size_t m=(l+r)>>1;
+		if(keyframes[m].time<=time)
+			l=m;
+		else
+			r=m;
+		}
+	const Vrui::NavTransform& nav0=keyframes[l].navigation;
+	const Vrui::NavTransform& nav1=keyframes[r].navigation;
+	double dt=keyframes[r].time-keyframes[l].time;
+	Vrui::Scalar w=dt>0.0?Vrui::Scalar((time-keyframes[l].time)/dt):Vrui::Scalar(1);
+	
+	/* Interpolate translation linearly, rotation along the shortest arc, and scaling geometrically: */
+	Vrui::Vector translation=nav0.getTranslation()*(Vrui::Scalar(1)-w)+nav1.getTranslation()*w;
+	Vrui::Rotation rotation=Vrui::Rotation::rotateScaledAxis((nav1.getRotation()*Geometry::invert(nav0.getRotation())).getScaledAxis()*w)*nav0.getRotation();
+	Vrui::Scalar scaling=nav0.getScaling()*Math::pow(nav1.getScaling()/nav0.getScaling(),w);
+	
+	return Vrui::NavTransform(translation,rotation,scaling);
+	}
+
+void CameraPath::write(const char* pathFileName) const
+	{
+	FILE* pathFile=fopen(pathFileName,"wt");
+	if(pathFile==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot create path file %s",pathFileName);
+	
+	/* Write one keyframe per line: */
+	for(std::vector<Keyframe>::const_iterator kfIt=keyframes.begin();kfIt!=keyframes.end();++kfIt)
+		{
+		const Vrui::Vector& t=kfIt->navigation.getTranslation();
+		Vrui::Vector a=kfIt->navigation.getRotation().getScaledAxis();
+		fprintf(pathFile,"%.6f %.10g %.10g %.10g %.10g %.10g %.10g %.10g\n",kfIt->time,t[0],t[1],t[2],a[0],a[1],a[2],kfIt->navigation.getScaling());
+		}
+	
+	fclose(pathFile);
+	}
@@ -0,0 +1,64 @@
+/***********************************************************************
+CameraPath - Class to record and replay a timed sequence of navigation
+transformations.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef CAMERAPATH_INCLUDED
+#define CAMERAPATH_INCLUDED
+
+#include <vector>
+#include <Vrui/Geometry.h>
+
+class CameraPath
+	{
+	/* Embedded classes: */
+	private:
+	struct Keyframe // Structure for a navigation transformation at a point in time
+		{
+		/* Elements: */
+		public:
+		double time; // Time of the keyframe in seconds since the start of the path
+		Vrui::NavTransform navigation; // Navigation transformation at the keyframe
+		};
+	
+	/* Elements: */
+	std::vector<Keyframe> keyframes; // List of keyframes in order of increasing time
+	
+	/* Constructors and destructors: */
+	public:
+	CameraPath(void); // Creates an empty path
+	CameraPath(const char* pathFileName); // Reads a path from the given text file
+	
+	/* Methods: */
+	bool empty(void) const // Returns true if the path has no keyframes
+		{
+		return keyframes.empty();
+		}
+	double getDuration(void) const // Returns the time of the path's last keyframe
+		{
+		return keyframes.empty()?0.0:keyframes.back().time;
+		}
+	void addKeyframe(double time,const Vrui::NavTransform& navigation); // Appends a keyframe; time must not be smaller than the last keyframe's
+	Vrui::NavTransform getNavigation(double time) const; // Returns the navigation transformation at the given time by interpolating between keyframes; path must not be empty
+	void write(const char* pathFileName) const; // Writes the path to the given text file
+	};
+
+#endif
@@ -0,0 +1,147 @@
+/***********************************************************************
+CoarseningClock - Helper class to store terrain tree nodes that can be
+removed from the node cache, and to select nodes for removal with the
+CLOCK algorithm based on the render pass stamps of the nodes.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef COARSENINGCLOCK_INCLUDED
+#define COARSENINGCLOCK_INCLUDED
+
+#include <vector>
+
+/***********************************************************************
+Candidates are kept in an unordered ring that the clock hand sweeps.
+Each candidate remembers the render pass stamp its node had when the
+hand last passed it. If the stamp changed since then, the node was
+rendered in the meantime. It gets a second chance, and the hand moves
+on. Otherwise, the node becomes a victim, unless the most recent render
+pass used it or an interaction tool pinned it. Render passes therefore
+never touch the clock. Updates at frame boundaries take constant time,
+and victims are collected in batches.
+***********************************************************************/
+
+template <class NodeParam>
+class CoarseningClock
+	{
+	/* Embedded classes: */
+	private:
+	typedef NodeParam Node; // Type of tree nodes
+	
+	struct Item // Structure for candidates on the clock
+		{
+		/* Elements: */
+		public:
+		Node* node; // Pointer to the candidate node
+		unsigned int lastSeenPass; // Render pass stamp of the node when the clock hand last passed it
+		};
+	
+	/* Elements: */
+	mutable std::vector<Item> items; // Ring of candidates in no particular order
+	mutable unsigned int hand; // Index of the next candidate to be examined
+	unsigned int currentPass; // The most recent render pass; nodes rendered in it or touched by an interaction tool in it are never victims
+	
+	/* Private methods: */
+	bool examine(unsigned int index) const // Examines the candidate at the given index; returns true if it is a victim, otherwise gives it a second chance if it was rendered since the last examination
+		{
+		Item& item=items[index];
+		unsigned int nodePass=item.node->getRenderPass();
+		if(nodePass!=item.lastSeenPass)
+			{
+			/* Clear the candidate's reference by remembering its current stamp: */
+			item.lastSeenPass=nodePass;
+			return false;
+			}
+		return nodePass!=currentPass&&item.node->interactionPass!=currentPass;
+		};
+	
+	/* Constructors and destructors: */
+	public:
+	CoarseningClock(unsigned int maxNumItems) // Creates an empty clock for the given number of items
+		:hand(0U),currentPass(0U)
+		{
+		items.reserve(maxNumItems);
+		};
+	
+	/* Methods: */
+	unsigned int getNumItems(void) const // Returns current number of candidates
+		{
+		return (unsigned int)(items.size());
+		};
+	Node* getTopNode(void) const // Moves the clock hand to the next victim and returns it without removing it, or returns null if a full revolution found no victim
+		{
+		for(unsigned int i=0;i<items.size();++i)
+			{
+			if(hand>=items.size())
+				hand=0U;
+			if(examine(hand))
+				return items[hand].node;
+			++hand;
+			}
+		return 0;
+		};
+	void insert(Node* newNode) // Inserts the given node; updates node's coarseningHeapIndex
+		{
+		Item newItem;
+		newItem.node=newNode;
+		newItem.lastSeenPass=newNode->getRenderPass();
+		newNode->coarseningHeapIndex=(unsigned int)(items.size());
+		items.push_back(newItem);
+		};
+	void remove(Node* node) // Removes given node from the clock
+		{
+		/* Move the last candidate into the removed candidate's slot: */
+		unsigned int index=node->coarseningHeapIndex;
+		node->coarseningHeapIndex=~0x0U;
+		if(index+1U<items.size())
+			{
+			items[index]=items.back();
+			items[index].node->coarseningHeapIndex=index;
+			}
+		items.pop_back();
+		};
+	void update(unsigned int newCurrentPass) // Starts a new render pass after the given one; takes constant time
+		{
+		currentPass=newCurrentPass;
+		};
+	void collectVictims(unsigned int maxNumVictims,std::vector<Node*>& victims) const // Sweeps the clock hand for at most one revolution and appends up to the given number of victims to the given list
+		{
+		for(unsigned int i=0;i<items.size()&&maxNumVictims>0U;++i)
+			{
+			if(hand>=items.size())
+				hand=0U;
+			if(examine(hand))
+				{
+				victims.push_back(items[hand].node);
+				--maxNumVictims;
+				}
+			++hand;
+			}
+		};
+	bool checkClock(void) const // Checks the clock for internal consistency
+		{
+		for(unsigned int i=0;i<items.size();++i)
+			if(items[i].node->coarseningHeapIndex!=i)
+				return false;
+		return true;
+		};
+	};
+
+#endif
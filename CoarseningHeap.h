@@ -2,7 +2,7 @@
 CoarseningHeap - Helper class to store terrain tree nodes that can be
 removed from the node cache, in order of least recent/most finely
 resolved first.
-Copyright (c) 2007-2008 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -39,17 +39,20 @@ class CoarseningHeap
 		Node* node; // Pointer to node stored in item
 		unsigned int renderPass; // Counter value of last rendering pass that touched the node
 		float LOD; // LOD value of node in last rendering pass that touched it
+		bool pinned; // Flag whether the node is pinned by an interaction tool
 		
 		/* Constructors and destructors: */
 		HeapItem(void)
-			:node(0),renderPass(0U),LOD(0.0f)
+			:node(0),renderPass(0U),LOD(0.0f),pinned(false)
 			{
 			};
 		
 		/* Methods: */
 		friend bool operator<=(const HeapItem& item1,const HeapItem& item2) // Comparison operator for heap ordering
 			{
-			if(item1.renderPass==item2.renderPass)
+			if(item1.pinned!=item2.pinned)
+				return item2.pinned;
+			else if(item1.renderPass==item2.renderPass)
 				return item1.LOD<=item2.LOD;
 			else
 				return item1.renderPass<item2.renderPass;
@@ -59,12 +62,22 @@ class CoarseningHeap
 	/* Elements: */
 	HeapItem* items; // Array of heap items
 	unsigned int numItems; // Current number of items in heap
+	unsigned int pinPass; // Nodes that an interaction tool touched in this rendering pass are pinned
+	
+	/* Private methods: */
+	void read(HeapItem& item) const // Reads the heap data of the given item's node
+		{
+		item.renderPass=item.node->getRenderPass();
+		item.LOD=item.node->getMaxLOD();
+		item.pinned=item.node->interactionPass==pinPass;
+		};
 	
 	/* Constructors and destructors: */
 	public:
 	CoarseningHeap(unsigned int maxNumItems) // Creates heap for given number of items; caller's responsibility to never insert more items
 		:items(new HeapItem[maxNumItems]),
-		 numItems(0U)
+		 numItems(0U),
+		 pinPass(~0x0U)
 		{
 		};
 	~CoarseningHeap(void) // Destroys heap
@@ -77,17 +90,16 @@ class CoarseningHeap
 		{
 		return numItems;
 		};
-	Node* getTopNode(void) const // Returns the node most appropriate for coarsening
+	Node* getTopNode(void) const // Returns the node most appropriate for coarsening, or null if there is none or all candidates are pinned
 		{
-		return numItems>0U?items[0].node:0;
+		return numItems>0U&&!items[0].pinned?items[0].node:0;
 		};
 	void insert(Node* newNode) // Inserts the given node into the heap; takes renderPass and LOD from node, updates node's coarseningHeapIndex
 		{
 		/* Create a new heap item: */
 		HeapItem newItem;
 		newItem.node=newNode;
-		newItem.renderPass=newNode->renderPass;
-		newItem.LOD=newNode->maxLOD;
+		read(newItem);
 		
 		/* Insert new items at bottom of heap and let them percolate up: */
 		unsigned int insertionPos=numItems;
@@ -141,8 +153,7 @@ class CoarseningHeap
 		{
 		/* Update the node's data: */
 		unsigned int insertionPos=node->coarseningHeapIndex;
-		items[insertionPos].renderPass=node->renderPass;
-		items[insertionPos].LOD=node->maxLOD;
+		read(items[insertionPos]);
 		
 		/* Start by letting the node's item percolate up the heap: */
 		while(insertionPos>0U)
@@ -178,6 +189,42 @@ class CoarseningHeap
 			insertionPos=minIndex;
 			}
 		};
+	void update(unsigned int newPinPass) // Re-reads all nodes' heap data and restores the heap invariant in one batch; pins nodes that an interaction tool touched in the given rendering pass
+		{
+		/* Update all items' data: */
+		pinPass=newPinPass;
+		for(unsigned int i=0;i<numItems;++i)
+			read(items[i]);
+		
+		/* Rebuild the heap bottom-up: */
+		for(unsigned int i=numItems>>1;i>0U;--i)
+			{
+			/* Let the item trickle down to its final position: */
+			unsigned int insertionPos=i-1U;
+			HeapItem item=items[insertionPos];
+			while(true)
+				{
+				unsigned int minIndex=insertionPos;
+				const HeapItem* minItem=&item;
+				unsigned int child=(insertionPos<<1)+1;
+				if(child<numItems&&!(*minItem<=items[child]))
+					{
+					minIndex=child;
+					minItem=&items[child];
+					}
+				++child;
+				if(child<numItems&&!(*minItem<=items[child]))
+					minIndex=child;
+				if(minIndex==insertionPos)
+					break;
+				items[insertionPos]=items[minIndex];
+				items[insertionPos].node->coarseningHeapIndex=insertionPos;
+				insertionPos=minIndex;
+				}
+			items[insertionPos]=item;
+			items[insertionPos].node->coarseningHeapIndex=insertionPos;
+			}
+		};
 	bool checkHeap(void) const // Checks the heap for internal consistency
 		{
 		for(unsigned int i=0;i<numItems;++i)
@@ -189,7 +236,7 @@ class CoarseningHeap
 				return false;
 			
 			/* Check if the node's data in the heap matches the node's data: */
-			if(node->renderPass!=items[i].renderPass||node->maxLOD!=items[i].LOD)
+			if(node->getRenderPass()!=items[i].renderPass||node->getMaxLOD()!=items[i].LOD||(node->interactionPass==pinPass)!=items[i].pinned)
 				return false;
 			
 			/* Check the heap invariant: */
@@ -186,6 +186,19 @@ class Cube // Class representing a cube
 			}
 		return result;
 		}
+	Scalar sqrDist(const Cube& other) const // Returns the squared distance between the cube and the given cube, or 0 if they overlap
+		{
+		Scalar result=Scalar(0);
+		for(int i=0;i<3;++i)
+			{
+			Scalar d;
+			if((d=other.min[i]-max[i])>Scalar(0))
+				result+=Math::sqr(d);
+			else if((d=min[i]-other.max[i])>Scalar(0))
+				result+=Math::sqr(d);
+			}
+		return result;
+		}
 	};
 
 #endif
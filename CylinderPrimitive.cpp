@@ -1,6 +1,6 @@
 /***********************************************************************
 CylinderPrimitive - Class for cylinders extracted from point clouds.
-Copyright (c) 2007-2020 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -73,78 +73,56 @@ DataType::TypeID CylinderPrimitive::type=DataType::TypeID(-1);
 Methods of class CylinderPrimitive:
 **********************************/
 
-CylinderPrimitive::CylinderPrimitive(const LidarOctree* octree,const Primitive::Vector& translation)
+CylinderPrimitive::CylinderPrimitive(const LidarOctree* octree,const Primitive::Vector& translation,size_t maxNumFitPoints)
+	:subsampled(false)
 	{
-	/* Extract all selected points from the octree: */
-	LidarSelectionExtractor<CylinderFitter::Point> lse;
+	/* Get the moments of the selected points: */
+	SelectionMoments moments=octree->getSelectionMoments();
+	
+	/* Extract all selected points, or an evenly strided subset if there are too many: */
+	size_t stride=1;
+	if(maxNumFitPoints>0&&moments.getNumPoints()>maxNumFitPoints)
+		{
+		stride=(moments.getNumPoints()+maxNumFitPoints-1)/maxNumFitPoints;
+		subsampled=true;
+		}
+	LidarSelectionExtractor<CylinderFitter::Point> lse(stride);
 	octree->processSelectedPoints(lse);
 	
 	if(lse.getPoints().size()>=6)
 		{
-		/* Try to fit a cylinder starting with all the primary axes: */
-		Scalar minF=Math::Constants<Scalar>::max;
+		/* Calculate the principal axes of the selected points from their moments: */
+		double evs[3];
+		SelectionMoments::Vector evecs[3];
+		moments.calcPrincipalAxes(evs,evecs);
+		
+		/* Try to fit a cylinder starting with all the principal axes: */
+		Fit bestFit;
 		for(int initialAxis=0;initialAxis<3;++initialAxis)
 			{
-			/* Create a cylinder fitter: */
-			CylinderFitter cf(lse.getPoints(),initialAxis);
-			
-			/* Minimize the target function: */
-			Scalar f=LevenbergMarquardtMinimizer<CylinderFitter>::minimize(cf);
+			/* Start from the principal axis, and estimate the radius from the points' spread orthogonal to it: */
+			Fit cylinderFit;
+			cylinderFit.center=moments.calcCentroid();
+			cylinderFit.axis=evecs[initialAxis];
+			double orthoSpread=evs[0]+evs[1]+evs[2]-evs[initialAxis];
+			cylinderFit.radius=orthoSpread>0.0?Scalar(Math::sqrt(orthoSpread)):Scalar(1);
 			
-			if(minF>f)
-				{
-				/* Store the target function: */
-				minF=f;
-				
-				/* Extract the cylinder parameters: */
-				center=cf.getCenter();
-				axis=cf.getAxis();
-				axis.normalize();
-				radius=cf.getRadius();
-				}
-			}
-		
-		/* Store the number of points and the RMS residual: */
-		numPoints=Misc::UInt64(lse.getPoints().size());
-		rms=Math::sqrt(minF*Scalar(2)/Scalar(numPoints));
-		
-		/* Calculate the point set's coverage along the cylinder axis: */
-		std::vector<CylinderFitter::Point>::const_iterator pIt=lse.getPoints().begin();
-		extents[1]=extents[0]=(*pIt-center)*axis;
-		for(++pIt;pIt!=lse.getPoints().end();++pIt)
-			{
-			Scalar d=(*pIt-center)*axis;
-			if(extents[0]>d)
-				extents[0]=d;
-			else if(extents[1]<d)
-				extents[1]=d;
+			/* Fit the cylinder to the extracted points: */
+			fit(lse.getPoints(),cylinderFit);
+			if(initialAxis==0||bestFit.rms>cylinderFit.rms)
+				bestFit=cylinderFit;
 			}
-		
-		/* Set the cylinder's height and adjust the center point: */
-		length=(extents[1]-extents[0])*Scalar(1.1);
-		center+=axis*Math::mid(extents[0],extents[1]);
-		extents[1]=Math::div2(length);
-		extents[0]=-extents[1];
+		setFit(bestFit);
 		
 		/* Print the cylinder's equation: */
-		std::cout<<"Cylinder fitting "<<numPoints<<" points"<<std::endl;
+		std::cout<<"Cylinder fitting "<<numPoints<<" points";
+		if(subsampled)
+			std::cout<<" of "<<moments.getNumPoints()<<" selected points";
+		std::cout<<std::endl;
 		std::cout<<"Center point: "<<(center+translation)<<std::endl;
 		std::cout<<"Axis direction: "<<axis<<std::endl;
 		std::cout<<"Radius: "<<radius<<", height: "<<length<<std::endl;
 		std::cout<<"RMS approximation residual: "<<rms<<std::endl;
-		
-		/* Compute an appropriate number of grid lines in x and y: */
-		Scalar aspect=(Scalar(2)*Math::Constants<Scalar>::pi*radius)/length;
-		if(aspect>=Scalar(1))
-			{
-			numLines[0]=10;
-			numLines[1]=int(Math::floor(Scalar(10)/aspect+Scalar(0.5)));
-			}
-		else
-			{
-			numLines[1]=10;
-			numLines[0]=int(Math::floor(Scalar(10)*aspect+Scalar(0.5)));
-			}
 		}
 	else
 		throw std::runtime_error("CylinderPrimitive::CylinderPrimitive: Not enough selected points");
@@ -382,3 +360,80 @@ void CylinderPrimitive::initContext(GLContextData& contextData) const
 	DataItem* dataItem=new DataItem;
 	contextData.addDataItem(this,dataItem);
 	}
+
+void CylinderPrimitive::fit(const std::vector<Primitive::Point>& points,CylinderPrimitive::Fit& fit,const volatile bool* cancel)
+	{
+	/* Create a cylinder fitter starting from the given fit: */
+	CylinderFitter cf(points,0);
+	cf.setCenter(fit.center);
+	cf.setAxis(fit.axis);
+	cf.setRadius(fit.radius);
+	
+	/* Minimize the target function: */
+	Scalar f=LevenbergMarquardtMinimizer<CylinderFitter>::minimize(cf,cancel);
+	
+	/* Store the cylinder parameters, the number of points, and the RMS residual: */
+	fit.center=cf.getCenter();
+	fit.axis=cf.getAxis();
+	fit.axis.normalize();
+	fit.radius=cf.getRadius();
+	fit.numPoints=Misc::UInt64(points.size());
+	fit.rms=Math::sqrt(f*Scalar(2)/Scalar(fit.numPoints));
+	
+	/* Calculate the point set's coverage along the cylinder axis: */
+	std::vector<Primitive::Point>::const_iterator pIt=points.begin();
+	Scalar min,max;
+	max=min=(*pIt-fit.center)*fit.axis;
+	for(++pIt;pIt!=points.end();++pIt)
+		{
+		Scalar d=(*pIt-fit.center)*fit.axis;
+		if(min>d)
+			min=d;
+		else if(max<d)
+			max=d;
+		}
+	
+	/* Set the cylinder's height and adjust the center point: */
+	fit.length=(max-min)*Scalar(1.1);
+	fit.center+=fit.axis*Math::mid(min,max);
+	}
+
+CylinderPrimitive::Fit CylinderPrimitive::getFit(void) const
+	{
+	Fit result;
+	result.center=center;
+	result.axis=axis;
+	result.radius=radius;
+	result.length=length;
+	result.numPoints=numPoints;
+	result.rms=rms;
+	return result;
+	}
+
+void CylinderPrimitive::setFit(const CylinderPrimitive::Fit& newFit)
+	{
+	center=newFit.center;
+	axis=newFit.axis;
+	radius=newFit.radius;
+	length=newFit.length;
+	extents[1]=Math::div2(length);
+	extents[0]=-extents[1];
+	numPoints=newFit.numPoints;
+	rms=newFit.rms;
+	
+	/* Compute an appropriate number of grid lines in x and y: */
+	Scalar aspect=(Scalar(2)*Math::Constants<Scalar>::pi*radius)/length;
+	if(aspect>=Scalar(1))
+		{
+		numLines[0]=10;
+		numLines[1]=int(Math::floor(Scalar(10)/aspect+Scalar(0.5)));
+		}
+	else
+		{
+		numLines[1]=10;
+		numLines[0]=int(Math::floor(Scalar(10)*aspect+Scalar(0.5)));
+		}
+	
+	/* Invalidate the cylinder's visual representation: */
+	invalidate();
+	}
@@ -1,6 +1,6 @@
 /***********************************************************************
 CylinderPrimitive - Class for cylinders extracted from point clouds.
-Copyright (c) 2007-2020 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,6 +23,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef CYLINDERPRIMITIVE_INCLUDED
 #define CYLINDERPRIMITIVE_INCLUDED
 
+#include <stddef.h>
+#include <vector>
 #include <GL/gl.h>
 #include <GL/GLObject.h>
 
@@ -34,6 +36,19 @@ class LidarOctree;
 class CylinderPrimitive:public LinePrimitive,public GLObject
 	{
 	/* Embedded classes: */
+	public:
+	struct Fit // Structure holding the parameters of a cylinder fitted to a set of points
+		{
+		/* Elements: */
+		public:
+		Point center; // Center point of the cylinder's axis
+		Vector axis; // Normalized direction of the cylinder's axis
+		Scalar radius; // Cylinder radius
+		Scalar length; // Cylinder height
+		Misc::UInt64 numPoints; // Number of fitted points
+		Scalar rms; // Root-mean square residual of the fit
+		};
+	
 	protected:
 	struct DataItem:public GLObject::DataItem
 		{
@@ -53,19 +68,23 @@ class CylinderPrimitive:public LinePrimitive,public GLObject
 	#endif
 	Scalar radius; // Cylinder radius
 	int numLines[2]; // Number of grid lines to render along the cylinder's x and y directions to achieve a mostly square grid
+	bool subsampled; // Flag whether the cylinder was fitted to a subset of the selected points
 	
 	/* Constructors and destructors: */
 	public:
 	CylinderPrimitive(void) // Dummy constructor
+		:subsampled(false)
 		{
 		};
-	CylinderPrimitive(const LidarOctree* octree,const Vector& translation); // Creates cylinder by processing selected points from the given octree
+	CylinderPrimitive(const LidarOctree* octree,const Vector& translation,size_t maxNumFitPoints =0); // Creates cylinder by processing selected points from the given octree; fits to an evenly strided subset of the selected points if there are more than the given non-zero maximum
 	CylinderPrimitive(IO::File& file,const Vector& translation) // Creates a cylinder primitive by reading from a binary file
+		:subsampled(false)
 		{
 		/* Read the primitive: */
 		CylinderPrimitive::read(file,translation);
 		}
 	CylinderPrimitive(Cluster::MulticastPipe* pipe) // Creates a cylinder primitive by reading from an intra-cluster pipe
+		:subsampled(false)
 		{
 		/* Read the primitive: */
 		CylinderPrimitive::read(pipe);
@@ -102,6 +121,13 @@ class CylinderPrimitive:public LinePrimitive,public GLObject
 		{
 		return numLines;
 		}
+	static void fit(const std::vector<Point>& points,Fit& fit,const volatile bool* cancel =0); // Refines the given cylinder fit against the given points; does not access any primitive and can be called from background threads
+	bool isSubsampled(void) const // Returns true if the cylinder was fitted to a subset of the selected points
+		{
+		return subsampled;
+		}
+	Fit getFit(void) const; // Returns the cylinder's current fit
+	void setFit(const Fit& newFit); // Replaces the cylinder's fit with the given one
 	};
 
 #endif
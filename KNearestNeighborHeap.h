@@ -0,0 +1,182 @@
+/***********************************************************************
+KNearestNeighborHeap - Helper class to collect the k nearest neighbors
+of a sequence of query points during directed octree traversals.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef KNEARESTNEIGHBORHEAP_INCLUDED
+#define KNEARESTNEIGHBORHEAP_INCLUDED
+
+#include <Math/Math.h>
+#include <Geometry/Point.h>
+
+#include "LidarTypes.h"
+
+template <unsigned int maxNumNeighborsParam =0>
+class KNearestNeighborHeap // Fixed-capacity max-heap of neighbor candidates; capacity is a compile-time constant unless the template parameter is zero
+	{
+	/* Embedded classes: */
+	public:
+	struct Neighbor // Structure to store a neighbor
+		{
+		/* Elements: */
+		public:
+		LidarPoint point; // Copy of the neighbor point
+		Scalar dist2; // Squared distance from query point to neighbor
+		};
+	
+	/* Elements: */
+	private:
+	Neighbor fixedNeighbors[maxNumNeighborsParam>0?maxNumNeighborsParam:1]; // Neighbor storage if capacity is a compile-time constant
+	unsigned int dynamicMaxNumNeighbors; // Capacity if it is not a compile-time constant
+	Neighbor* neighbors; // Array of current neighbor candidates, organized as a heap with the farthest neighbor at the root
+	Point queryPoint; // The current query point
+	unsigned int numNeighbors; // Current number of neighbor candidates
+	Scalar queryRadius2; // Squared radius of the current search sphere; shrinks to the farthest candidate's distance once the heap is full
+	
+	/* Private methods: */
+	KNearestNeighborHeap(const KNearestNeighborHeap& source); // Prohibit copy constructor
+	KNearestNeighborHeap& operator=(const KNearestNeighborHeap& source); // Prohibit assignment operator
+	void siftDown(unsigned int insertionPos,unsigned int heapSize,const Neighbor& neighbor) // Moves the given neighbor down from the given heap position until the heap property holds
+		{
+		while(true)
+			{
+			unsigned int biggestIndex=insertionPos;
+			Scalar biggest=neighbor.dist2;
+			unsigned int child=(insertionPos<<1)+1;
+			for(int i=0;i<2;++i,++child)
+				{
+				if(child<heapSize&&neighbors[child].dist2>biggest)
+					{
+					biggestIndex=child;
+					biggest=neighbors[child].dist2;
+					}
+				}
+			if(biggestIndex==insertionPos)
+				break;
+			neighbors[insertionPos]=neighbors[biggestIndex];
+			insertionPos=biggestIndex;
+			}
+		neighbors[insertionPos]=neighbor;
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	explicit KNearestNeighborHeap(unsigned int sMaxNumNeighbors =maxNumNeighborsParam) // Creates a heap for the given number of neighbors; argument is ignored if the capacity is a compile-time constant
+		:dynamicMaxNumNeighbors(maxNumNeighborsParam>0?maxNumNeighborsParam:sMaxNumNeighbors),
+		 neighbors(maxNumNeighborsParam>0?fixedNeighbors:new Neighbor[dynamicMaxNumNeighbors]),
+		 numNeighbors(0),queryRadius2(0)
+		{
+		}
+	~KNearestNeighborHeap(void)
+		{
+		if(neighbors!=fixedNeighbors)
+			delete[] neighbors;
+		}
+	
+	/* Methods: */
+	unsigned int getMaxNumNeighbors(void) const // Returns the heap's capacity
+		{
+		return maxNumNeighborsParam>0?maxNumNeighborsParam:dynamicMaxNumNeighbors;
+		}
+	void prepare(const Point& newQueryPoint,Scalar maxDist2) // Prepares the heap for a query around the given point within the given squared distance
+		{
+		queryPoint=newQueryPoint;
+		numNeighbors=0;
+		queryRadius2=maxDist2;
+		}
+	void prepareAdjacent(const Point& newQueryPoint,Scalar maxDist2) // Ditto; bounds the search sphere by the previous query's complete neighborhood, which is most effective when the new query point is close to the previous one
+		{
+		if(numNeighbors==getMaxNumNeighbors())
+			{
+			/* All previous neighbors lie within their distance from the previous query point plus the distance between query points: */
+			Scalar bound=Math::sqrt(queryRadius2)+Geometry::dist(queryPoint,newQueryPoint);
+			Scalar bound2=Math::sqr(bound)*Scalar(1.0001);
+			if(maxDist2>bound2)
+				maxDist2=bound2;
+			}
+		prepare(newQueryPoint,maxDist2);
+		}
+	const Point& getQueryPoint(void) const
+		{
+		return queryPoint;
+		}
+	Scalar getQueryRadius2(void) const
+		{
+		return queryRadius2;
+		}
+	void operator()(const LidarPoint& point) // Offers a point to the heap
+		{
+		Scalar dist2=Geometry::sqrDist(point,queryPoint);
+		unsigned int maxNumNeighbors=getMaxNumNeighbors();
+		if(numNeighbors<maxNumNeighbors)
+			{
+			if(dist2<=queryRadius2)
+				{
+				/* Insert the new point into the heap: */
+				unsigned int insertionPos=numNeighbors;
+				while(insertionPos>0)
+					{
+					unsigned int parent=(insertionPos-1)>>1;
+					if(neighbors[parent].dist2>=dist2)
+						break;
+					neighbors[insertionPos]=neighbors[parent];
+					insertionPos=parent;
+					}
+				neighbors[insertionPos].point=point;
+				neighbors[insertionPos].dist2=dist2;
+				
+				/* Shrink the search sphere if the heap became full: */
+				++numNeighbors;
+				if(numNeighbors==maxNumNeighbors)
+					queryRadius2=neighbors[0].dist2;
+				}
+			}
+		else if(dist2<queryRadius2)
+			{
+			/* Replace the currently farthest-away neighbor in the heap: */
+			Neighbor newNeighbor;
+			newNeighbor.point=point;
+			newNeighbor.dist2=dist2;
+			siftDown(0,numNeighbors,newNeighbor);
+			queryRadius2=neighbors[0].dist2;
+			}
+		}
+	unsigned int getNumNeighbors(void) const // Returns the current number of neighbor candidates
+		{
+		return numNeighbors;
+		}
+	const Neighbor& getNeighbor(unsigned int index) const // Returns one of the current neighbor candidates
+		{
+		return neighbors[index];
+		}
+	void sort(void) // Sorts the neighbor candidates by increasing distance from the query point; no more points can be offered until the next prepare call
+		{
+		for(unsigned int heapSize=numNeighbors;heapSize>1;--heapSize)
+			{
+			/* Move the farthest remaining neighbor behind the shrunken heap: */
+			Neighbor last=neighbors[heapSize-1];
+			neighbors[heapSize-1]=neighbors[0];
+			siftDown(0,heapSize-1,last);
+			}
+		}
+	};
+
+#endif
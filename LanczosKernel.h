@@ -0,0 +1,154 @@
+/***********************************************************************
+LanczosKernel - Class to evaluate a Lanczos reconstruction filter from
+precomputed tables, for single arguments or batches of arguments.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LANCZOSKERNEL_INCLUDED
+#define LANCZOSKERNEL_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+/***********************************************************************
+The kernel's argument t is the distance from the filter center in units
+of the filter step size. The kernel is sinc(pi*t)*sinc(pi*t/numLobes)
+for |t|<numLobes, and zero otherwise. It is tabulated over t, and over
+t^2 for radial filters, which avoids a square root per point. Both
+functions are smooth in their arguments, so linear interpolation
+between table entries stays within 2e-5 of the exact kernel for up
+to four lobes.
+***********************************************************************/
+
+class LanczosKernel
+	{
+	/* Embedded classes: */
+	public:
+	static const int numSamplesPerLobe=512; // Number of table entries per lobe
+	
+	/* Elements: */
+	private:
+	int numLobes; // Number of lobes of the filter
+	double scale; // Factor from arguments to table indices
+	double scale2; // Factor from squared arguments to squared table indices
+	std::vector<double> weights; // Filter weights at uniformly spaced arguments, with an additional trailing zero
+	std::vector<double> weights2; // Filter weights at uniformly spaced squared arguments, with an additional trailing zero
+	
+	/* Private methods: */
+	static double lanczos(double t,double numLobes) // Evaluates the exact kernel for the given non-negative argument
+		{
+		if(t==0.0)
+			return 1.0;
+		if(t>=numLobes)
+			return 0.0;
+		double x=Math::Constants<double>::pi*t;
+		double xl=x/numLobes;
+		return (Math::sin(x)/x)*(Math::sin(xl)/xl);
+		}
+	static double lookup(const std::vector<double>& table,double index) // Interpolates the given table at the given non-negative index
+		{
+		size_t i=size_t(index);
+		if(i>=table.size()-1)
+			return 0.0;
+		double f=index-double(i);
+		return table[i]+(table[i+1]-table[i])*f;
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	LanczosKernel(int sNumLobes) // Creates a kernel with the given number of lobes
+		:numLobes(0)
+		{
+		setNumLobes(sNumLobes);
+		}
+	
+	/* Methods: */
+	int getNumLobes(void) const // Returns the kernel's number of lobes
+		{
+		return numLobes;
+		}
+	void setNumLobes(int newNumLobes) // Changes the kernel's number of lobes; rebuilds the tables only if the number changed
+		{
+		if(newNumLobes<1)
+			newNumLobes=1;
+		if(numLobes==newNumLobes)
+			return;
+		
+		numLobes=newNumLobes;
+		int numSamples=numLobes*numSamplesPerLobe;
+		double dNumLobes=double(numLobes);
+		scale=double(numSamples)/dNumLobes;
+		scale2=double(numSamples)/(dNumLobes*dNumLobes);
+		weights.resize(numSamples+2);
+		weights2.resize(numSamples+2);
+		for(int i=0;i<numSamples;++i)
+			{
+			weights[i]=lanczos(double(i)/scale,dNumLobes);
+			weights2[i]=lanczos(Math::sqrt(double(i)/scale2),dNumLobes);
+			}
+		weights[numSamples]=weights[numSamples+1]=0.0;
+		weights2[numSamples]=weights2[numSamples+1]=0.0;
+		}
+	double operator()(double t) const // Returns the filter weight for the given argument
+		{
+		return lookup(weights,Math::abs(t)*scale);
+		}
+	double evaluateSquared(double t2) const // Returns the filter weight for the given squared argument
+		{
+		return lookup(weights2,t2*scale2);
+		}
+	void evaluate(const double* ts,double* results,size_t numArguments) const // Stores the filter weights for the given array of arguments in the given result array
+		{
+		/* Calculate all table indices first, then interpolate, to keep both loops free of dependencies: */
+		const double* w=&weights[0];
+		double maxIndex=double(weights.size()-2);
+		for(size_t i=0;i<numArguments;++i)
+			{
+			double index=Math::abs(ts[i])*scale;
+			results[i]=index<maxIndex?index:maxIndex;
+			}
+		for(size_t i=0;i<numArguments;++i)
+			{
+			size_t ti=size_t(results[i]);
+			double f=results[i]-double(ti);
+			results[i]=w[ti]+(w[ti+1]-w[ti])*f;
+			}
+		}
+	void evaluateSquared(const double* t2s,double* results,size_t numArguments) const // Stores the filter weights for the given array of squared arguments in the given result array
+		{
+		const double* w=&weights2[0];
+		double maxIndex=double(weights2.size()-2);
+		for(size_t i=0;i<numArguments;++i)
+			{
+			double index=t2s[i]*scale2;
+			results[i]=index<maxIndex?index:maxIndex;
+			}
+		for(size_t i=0;i<numArguments;++i)
+			{
+			size_t ti=size_t(results[i]);
+			double f=results[i]-double(ti);
+			results[i]=w[ti]+(w[ti+1]-w[ti])*f;
+			}
+		}
+	};
+
+#endif
@@ -0,0 +1,249 @@
+/***********************************************************************
+LazReader - Class to read point records from LAZ (compressed LAS) files
+using the LASzip library, decompressing the files' chunks on multiple
+threads.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LazReader.h"
+
+#include <string.h>
+#include <vector>
+#include <Misc/StdError.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+#include <Threads/Thread.h>
+
+#include "Config.h"
+
+#if USE_LASZIP
+#include <laszip/laszip_api.h>
+#endif
+
+namespace {
+
+#if USE_LASZIP
+
+/**************
+Helper classes:
+**************/
+
+class LaszipReader // Helper class to hold a LASzip reader, which is closed and destroyed when the holder goes out of scope
+	{
+	/* Elements: */
+	private:
+	laszip_POINTER reader; // The LASzip reader
+	
+	/* Constructors and destructors: */
+	public:
+	LaszipReader(const char* fileName) // Opens a LASzip reader for the given file; throws exception on failure
+		{
+		if(laszip_create(&reader)!=0)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to create LASzip reader");
+		laszip_BOOL isCompressed;
+		if(laszip_open_reader(reader,fileName,&isCompressed)!=0)
+			{
+			laszip_CHAR* error;
+			laszip_get_error(reader,&error);
+			std::string message=error;
+			laszip_destroy(reader);
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to open file %s due to LASzip error %s",fileName,message.c_str());
+			}
+		}
+	private:
+	LaszipReader(const LaszipReader& source); // Prohibit copy constructor
+	LaszipReader& operator=(const LaszipReader& source); // Prohibit assignment operator
+	public:
+	~LaszipReader(void)
+		{
+		laszip_close_reader(reader);
+		laszip_destroy(reader);
+		}
+	
+	/* Methods: */
+	laszip_POINTER getReader(void) const // Returns the LASzip reader
+		{
+		return reader;
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+size_t readLazChunkSize(const char* fileName) // Returns the chunk size stored in the given LAZ file's LASzip variable-length record, or 0 if chunks have variable size
+	{
+	/* Open the file and read the relevant parts of its LAS header: */
+	IO::FilePtr file(IO::openFile(fileName));
+	file->setEndianness(Misc::LittleEndian);
+	file->skip<char>(94);
+	unsigned int headerSize=file->read<unsigned short>();
+	file->skip<unsigned int>(1); // Ignore offset to point data
+	unsigned int numVlrs=file->read<unsigned int>();
+	file->skip<char>(headerSize-104);
+	
+	/* Find the LASzip variable-length record: */
+	for(unsigned int i=0;i<numVlrs;++i)
+		{
+		file->skip<unsigned short>(1); // Ignore reserved field
+		char userId[16];
+		file->read(userId,16);
+		unsigned int recordId=file->read<unsigned short>();
+		unsigned int recordLength=file->read<unsigned short>();
+		file->skip<char>(32); // Ignore description
+		if(strncmp(userId,"laszip encoded",16)==0&&recordId==22204U&&recordLength>=16U)
+			{
+			/* Skip the compressor, coder, version, and option fields, and read the chunk size: */
+			file->skip<char>(12);
+			unsigned int chunkSize=file->read<unsigned int>();
+			return chunkSize!=~0x0U?size_t(chunkSize):0;
+			}
+		file->skip<char>(recordLength);
+		}
+	
+	return 0;
+	}
+
+#endif
+
+}
+
+/**************************
+Methods of class LazReader:
+**************************/
+
+void* LazReader::decompressionThreadMethod(void)
+	{
+	#if USE_LASZIP
+	try
+		{
+		/* Open a private LASzip reader, which is closed when leaving this scope, even if the consumer throws: */
+		LaszipReader laszipReader(fileName.c_str());
+		laszip_POINTER reader=laszipReader.getReader();
+		laszip_point* point;
+		laszip_get_point_pointer(reader,&point);
+		bool extendedClasses=pointDataFormat>=6U;
+		bool rgb=hasRgb();
+		
+		std::vector<PointRecord> records(chunkSize);
+		while(true)
+			{
+			/* Grab the next chunk: */
+			size_t first=size_t(nextChunkIndex.preAdd(1U)-1U)*chunkSize;
+			if(first>=numPoints)
+				break;
+			size_t numRecords=numPoints-first;
+			if(numRecords>chunkSize)
+				numRecords=chunkSize;
+			
+			/* Decompress the chunk's point records: */
+			if(laszip_seek_point(reader,laszip_I64(first))!=0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to seek to point record %u",(unsigned int)first);
+			for(size_t i=0;i<numRecords;++i)
+				{
+				if(laszip_read_point(reader)!=0)
+					throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to read point record %u",(unsigned int)(first+i));
+				PointRecord& r=records[i];
+				r.position[0]=point->X;
+				r.position[1]=point->Y;
+				r.position[2]=point->Z;
+				r.intensity=point->intensity;
+				r.classification=extendedClasses?point->extended_classification:point->classification;
+				if(rgb)
+					for(int j=0;j<3;++j)
+						r.rgb[j]=point->rgb[j];
+				}
+			
+			/* Hand the decompressed records to the consumer: */
+			Threads::Mutex::Lock consumerLock(consumerMutex);
+			consumer->consumeBlock(&records[0],numRecords);
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		/* Remember the first error and bail out: */
+		Threads::Mutex::Lock errorLock(errorMutex);
+		if(errorMessage.empty())
+			errorMessage=err.what();
+		}
+	#endif
+	
+	return 0;
+	}
+
+bool LazReader::isSupported(void)
+	{
+	return USE_LASZIP!=0;
+	}
+
+LazReader::LazReader(const char* sFileName)
+	:fileName(sFileName),numPoints(0),pointDataFormat(0),chunkSize(50000),
+	 consumer(0),nextChunkIndex(0U)
+	{
+	#if USE_LASZIP
+	/* Read the file's header: */
+	{
+	LaszipReader laszipReader(fileName.c_str());
+	laszip_header* header;
+	laszip_get_header_pointer(laszipReader.getReader(),&header);
+	numPoints=header->number_of_point_records!=0?size_t(header->number_of_point_records):size_t(header->extended_number_of_point_records);
+	pointDataFormat=header->point_data_format;
+	scale[0]=header->x_scale_factor;
+	scale[1]=header->y_scale_factor;
+	scale[2]=header->z_scale_factor;
+	offset[0]=header->x_offset;
+	offset[1]=header->y_offset;
+	offset[2]=header->z_offset;
+	min[0]=header->min_x;
+	min[1]=header->min_y;
+	min[2]=header->min_z;
+	max[0]=header->max_x;
+	max[1]=header->max_y;
+	max[2]=header->max_z;
+	}
+	
+	/* Align decompression blocks with the file's chunks, keeping the default LASzip chunk size for variable-sized chunks: */
+	size_t fileChunkSize=readLazChunkSize(fileName.c_str());
+	if(fileChunkSize!=0)
+		chunkSize=fileChunkSize;
+	#else
+	throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot read file %s; LAZ support not enabled",sFileName);
+	#endif
+	}
+
+void LazReader::readPoints(unsigned int numThreads,LazReader::BlockConsumer& newConsumer)
+	{
+	if(numThreads<1U)
+		numThreads=1U;
+	
+	/* Run the decompression threads: */
+	consumer=&newConsumer;
+	Threads::Thread* threads=new Threads::Thread[numThreads];
+	for(unsigned int i=0;i<numThreads;++i)
+		threads[i].start(this,&LazReader::decompressionThreadMethod);
+	for(unsigned int i=0;i<numThreads;++i)
+		threads[i].join();
+	delete[] threads;
+	consumer=0;
+	
+	/* Report the first error encountered by any thread: */
+	if(!errorMessage.empty())
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Error %s while reading file %s",errorMessage.c_str(),fileName.c_str());
+	}
@@ -0,0 +1,115 @@
+/***********************************************************************
+LazReader - Class to read point records from LAZ (compressed LAS) files
+using the LASzip library, decompressing the files' chunks on multiple
+threads.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LAZREADER_INCLUDED
+#define LAZREADER_INCLUDED
+
+#include <string>
+#include <Threads/Mutex.h>
+#include <Threads/Atomic.h>
+
+class LazReader
+	{
+	/* Embedded classes: */
+	public:
+	struct PointRecord // Structure for the fields of LAZ point records used by LiDAR processing
+		{
+		/* Elements: */
+		public:
+		int position[3]; // Point position in scaled integer coordinates
+		unsigned short intensity; // Point return intensity
+		unsigned char classification; // Point class
+		unsigned short rgb[3]; // Point color; only valid if the file's point data format contains colors
+		};
+	
+	class BlockConsumer // Abstract base class for receivers of decompressed blocks of point records
+		{
+		/* Constructors and destructors: */
+		public:
+		virtual ~BlockConsumer(void)
+			{
+			}
+		
+		/* Methods: */
+		virtual void consumeBlock(const PointRecord* records,size_t numRecords) =0; // Called with each decompressed block of point records; calls are serialized
+		};
+	
+	/* Elements: */
+	private:
+	std::string fileName; // Name of the LAZ file
+	size_t numPoints; // Number of point records in the file
+	unsigned int pointDataFormat; // LAS point data format of the file's point records
+	double scale[3]; // Scale factors from integer to model coordinates
+	double offset[3]; // Offset from integer to model coordinates
+	double min[3],max[3]; // Bounding box of the file's points in model coordinates
+	size_t chunkSize; // Number of point records in each independently decompressible chunk
+	
+	/* Transient state during multithreaded reading: */
+	BlockConsumer* consumer; // The receiver of decompressed blocks
+	Threads::Mutex consumerMutex; // Mutex serializing calls to the block consumer
+	Threads::Atomic<unsigned int> nextChunkIndex; // Index of the next chunk to be decompressed by any thread
+	Threads::Mutex errorMutex; // Mutex protecting the error message
+	std::string errorMessage; // Error message reported by the first failing decompression thread
+	
+	/* Private methods: */
+	void* decompressionThreadMethod(void); // Thread method decompressing chunks until all chunks are taken
+	
+	/* Constructors and destructors: */
+	public:
+	static bool isSupported(void); // Returns true if LAZ support was enabled at compile time
+	LazReader(const char* sFileName); // Opens the given LAZ file and reads its header; throws exception if LAZ support was not enabled at compile time
+	
+	/* Methods: */
+	size_t getNumPoints(void) const // Returns the number of point records in the file
+		{
+		return numPoints;
+		}
+	unsigned int getPointDataFormat(void) const // Returns the file's LAS point data format
+		{
+		return pointDataFormat;
+		}
+	bool hasRgb(void) const // Returns true if the file's point records contain colors
+		{
+		return pointDataFormat==2||pointDataFormat==3||pointDataFormat==5||pointDataFormat==7||pointDataFormat==8||pointDataFormat==10;
+		}
+	const double* getScale(void) const // Returns the file's scale factors
+		{
+		return scale;
+		}
+	const double* getOffset(void) const // Returns the file's offset
+		{
+		return offset;
+		}
+	const double* getMin(void) const // Returns the minimum corner of the file's bounding box
+		{
+		return min;
+		}
+	const double* getMax(void) const // Returns the maximum corner of the file's bounding box
+		{
+		return max;
+		}
+	void readPoints(unsigned int numThreads,BlockConsumer& newConsumer); // Decompresses all point records using the given number of threads and passes them to the given consumer in blocks in no particular order; can only be called once
+	};
+
+#endif
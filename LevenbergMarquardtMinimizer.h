@@ -1,7 +1,7 @@
 /***********************************************************************
 LevenbergMarquardtMinimizer - Class to implement n-dimensional least-
 squares minimization using a modified Levenberg-Marquardt algorithm.
-Copyright (c) 2007-2008 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -41,7 +41,7 @@ class LevenbergMarquardtMinimizer
 	typedef Geometry::ComponentArray<Scalar,dimension> Vector; // Type for vectors (in the matrix sense)
 	
 	/* Methods: */
-	static Scalar minimize(Fitter& fitter); // Minimizes the target function by manipulating the given fitter
+	static Scalar minimize(Fitter& fitter,const volatile bool* cancel =0); // Minimizes the target function by manipulating the given fitter; stops early when the optional cancellation flag is set
 	};
 
 /********************************************
@@ -52,7 +52,8 @@ template <class FitterParam>
 inline
 typename LevenbergMarquardtMinimizer<FitterParam>::Scalar
 LevenbergMarquardtMinimizer<FitterParam>::minimize(
-	typename LevenbergMarquardtMinimizer<FitterParam>::Fitter& fitter)
+	typename LevenbergMarquardtMinimizer<FitterParam>::Fitter& fitter,
+	const volatile bool* cancel)
 	{
 	/* Initialize the optimizer: */
 	Scalar tau=Scalar(1.0e-3);
@@ -97,7 +98,7 @@ LevenbergMarquardtMinimizer<FitterParam>::minimize(
 	for(int i=0;i<dimension;++i)
 		if(Math::abs(g[i])>epsilon1)
 			found=false;
-	for(int iteration=0;!found&&iteration<maxNumIterations;++iteration)
+	for(int iteration=0;!found&&iteration<maxNumIterations&&(cancel==0||!*cancel);++iteration)
 		{
 		/* Calculate step direction: */
 		Matrix H=A;
@@ -0,0 +1,86 @@
+/***********************************************************************
+LidarAttributeWriter - Class to create a per-point attribute channel of
+a LiDAR file and fill in its records in arbitrary order.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarAttributeWriter.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <Misc/StdError.h>
+
+#include "LidarAttributes.h"
+
+/*************************************
+Methods of class LidarAttributeWriter:
+*************************************/
+
+LidarAttributeWriter::LidarAttributeWriter(const char* lidarFileName,const char* channelName,unsigned int sRecordSize,LidarFile::Offset sNumRecords)
+	:fileName(getLidarAttributeFileName(lidarFileName,channelName)),
+	 fd(-1),size(0),memory(0),
+	 recordSize(sRecordSize),numRecords(sNumRecords)
+	{
+	#if __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+	/* Attribute channels are little-endian, and mapped records are written in place: */
+	throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot write little-endian file %s on big-endian host",fileName.c_str());
+	#endif
+	
+	/* Create the data file: */
+	fd=open(fileName.c_str(),O_RDWR|O_CREAT|O_TRUNC,0666);
+	if(fd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot create file %s",fileName.c_str());
+	
+	/* Extend the data file to its final size; the records are initialized to zero: */
+	size=LidarDataFileHeader::getFileSize()+size_t(numRecords)*size_t(recordSize);
+	if(ftruncate(fd,off_t(size))<0)
+		{
+		int error=errno;
+		close(fd);
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot resize file %s",fileName.c_str());
+		}
+	
+	/* Map the entire file read-write: */
+	void* mapping=mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if(mapping==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot map file %s",fileName.c_str());
+		}
+	memory=static_cast<unsigned char*>(mapping);
+	
+	/* Records are written in source file order, not file order; disable aggressive read-ahead: */
+	madvise(mapping,size,MADV_RANDOM);
+	
+	/* Write the data file's header: */
+	*reinterpret_cast<unsigned int*>(memory)=recordSize;
+	}
+
+LidarAttributeWriter::~LidarAttributeWriter(void)
+	{
+	/* Unmap and close the file; the kernel writes back all modified pages: */
+	munmap(memory,size);
+	close(fd);
+	}
@@ -0,0 +1,68 @@
+/***********************************************************************
+LidarAttributeWriter - Class to create a per-point attribute channel of
+a LiDAR file and fill in its records in arbitrary order.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARATTRIBUTEWRITER_INCLUDED
+#define LIDARATTRIBUTEWRITER_INCLUDED
+
+#include <stddef.h>
+#include <string>
+
+#include "LidarFile.h"
+
+class LidarAttributeWriter
+	{
+	/* Elements: */
+	private:
+	std::string fileName; // Name of the channel's data file
+	int fd; // File descriptor of the channel's data file
+	size_t size; // Total size of the channel's data file in bytes
+	unsigned char* memory; // Pointer to the beginning of the read-write mapped data file
+	unsigned int recordSize; // Size of one record in bytes
+	LidarFile::Offset numRecords; // Number of records in the channel
+	
+	/* Constructors and destructors: */
+	public:
+	LidarAttributeWriter(const char* lidarFileName,const char* channelName,unsigned int sRecordSize,LidarFile::Offset sNumRecords); // Creates the named attribute channel inside the given LiDAR file with the given number of zero-initialized records; throws exception if the channel's data file cannot be created
+	private:
+	LidarAttributeWriter(const LidarAttributeWriter& source); // Prohibit copy constructor
+	LidarAttributeWriter& operator=(const LidarAttributeWriter& source); // Prohibit assignment operator
+	public:
+	~LidarAttributeWriter(void); // Unmaps and closes the channel's data file; modified records are written back by the operating system
+	
+	/* Methods: */
+	const std::string& getFileName(void) const // Returns the name of the channel's data file
+		{
+		return fileName;
+		}
+	LidarFile::Offset getNumRecords(void) const // Returns the number of records in the channel
+		{
+		return numRecords;
+		}
+	template <class RecordParam>
+	RecordParam* getRecords(LidarFile::Offset recordIndex) // Returns a pointer to the record of the given index inside the mapped data file
+		{
+		return reinterpret_cast<RecordParam*>(memory+LidarDataFileHeader::getFileSize()+size_t(recordIndex)*size_t(recordSize));
+		}
+	};
+
+#endif
@@ -0,0 +1,69 @@
+/***********************************************************************
+LidarAttributes - Names and record types of optional per-point attribute
+channels stored alongside a LiDAR octree's point data.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARATTRIBUTES_INCLUDED
+#define LIDARATTRIBUTES_INCLUDED
+
+#include <string>
+#include <Misc/SizedTypes.h>
+
+/***********************************************************************
+An attribute channel is a data file named Attribute.<channel name>
+inside a LiDAR file directory. Like the Points, Normals, and Colors
+files, it starts with a LidarDataFileHeader holding the size of one
+record, followed by one little-endian record per point, addressed by the
+octree nodes' data offsets. Channels are independent of each other and
+of the point data, and are only read by applications that ask for them
+by name.
+***********************************************************************/
+
+/* Record types of the standard channels written by LidarPreprocessor: */
+typedef Misc::UInt16 LidarIntensity; // Record type of the "Intensity" channel
+typedef Misc::UInt8 LidarClassification; // Record type of the "Classification" channel
+typedef Misc::UInt8 LidarReturnInfo; // Record type of the "ReturnInfo" channel; return number in the low four bits, number of returns of the pulse in the high four bits
+typedef Misc::Float64 LidarGpsTime; // Record type of the "GpsTime" channel
+
+inline std::string getLidarAttributeFileName(const char* lidarFileName,const char* channelName) // Returns the name of the given attribute channel's data file inside the given LiDAR file
+	{
+	std::string result=lidarFileName;
+	result.append("/Attribute.");
+	result.append(channelName);
+	return result;
+	}
+
+inline LidarReturnInfo packReturnInfo(unsigned int returnNumber,unsigned int numReturns) // Packs a return number and the number of returns of its pulse into a return info record
+	{
+	return LidarReturnInfo((returnNumber&0x0fU)|((numReturns&0x0fU)<<4));
+	}
+
+inline unsigned int getReturnNumber(LidarReturnInfo returnInfo) // Returns the return number from a return info record
+	{
+	return (unsigned int)(returnInfo)&0x0fU;
+	}
+
+inline unsigned int getNumReturns(LidarReturnInfo returnInfo) // Returns the number of returns of the pulse from a return info record
+	{
+	return (unsigned int)(returnInfo)>>4;
+	}
+
+#endif
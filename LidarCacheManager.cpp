@@ -0,0 +1,114 @@
+/***********************************************************************
+LidarCacheManager - Class to share one memory cache budget between
+several LiDAR octrees, and to evict the least important nodes across all
+octrees when the shared cache is full.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarCacheManager.h"
+
+#include <algorithm>
+
+#include "LidarOctree.h"
+
+/**********************************
+Methods of class LidarCacheManager:
+**********************************/
+
+LidarOctree* LidarCacheManager::findCoarseningCandidate(unsigned int& age,Scalar& lod)
+	{
+	/* Find the least important coarsening candidate among all octrees; older nodes are less important, and nodes of the same age with lower LOD: */
+	LidarOctree* result=0;
+	for(std::vector<LidarOctree*>::iterator oIt=octrees.begin();oIt!=octrees.end();++oIt)
+		{
+		unsigned int candidateAge;
+		Scalar candidateLod;
+		if((*oIt)->getCoarseningCandidate(candidateAge,candidateLod)&&(result==0||age<candidateAge||(age==candidateAge&&lod>candidateLod)))
+			{
+			result=*oIt;
+			age=candidateAge;
+			lod=candidateLod;
+			}
+		}
+	
+	return result;
+	}
+
+LidarCacheManager::LidarCacheManager(size_t sCacheSize)
+	:cacheSize(sCacheSize),
+	 numCachedBytes(0)
+	{
+	}
+
+LidarCacheManager::~LidarCacheManager(void)
+	{
+	}
+
+void LidarCacheManager::addOctree(LidarOctree* octree,size_t octreeNumCachedBytes)
+	{
+	octrees.push_back(octree);
+	numCachedBytes+=octreeNumCachedBytes;
+	}
+
+void LidarCacheManager::removeOctree(LidarOctree* octree,size_t octreeNumCachedBytes)
+	{
+	std::vector<LidarOctree*>::iterator oIt=std::find(octrees.begin(),octrees.end(),octree);
+	if(oIt!=octrees.end())
+		{
+		octrees.erase(oIt);
+		numCachedBytes-=octreeNumCachedBytes;
+		}
+	}
+
+bool LidarCacheManager::makeRoom(size_t numBytes,unsigned int age,Scalar lod)
+	{
+	while(numCachedBytes+numBytes>cacheSize)
+		{
+		/* Find the least important coarsening candidate among all octrees: */
+		unsigned int coarsenAge=0;
+		Scalar coarsenLod(0);
+		LidarOctree* coarsenOctree=findCoarseningCandidate(coarsenAge,coarsenLod);
+		
+		/* Bail out if there is no candidate less important than the requesting node: */
+		if(coarsenOctree==0||!(coarsenAge>age||(coarsenAge==age&&coarsenLod<lod)))
+			return false;
+		
+		/* Coarsen the candidate; bail out if its children are being loaded: */
+		if(!coarsenOctree->coarsenCandidate())
+			return false;
+		}
+	
+	return true;
+	}
+
+bool LidarCacheManager::trim(void)
+	{
+	while(numCachedBytes>cacheSize)
+		{
+		/* Coarsen the least important coarsening candidate among all octrees regardless of its importance; bail out if there is none, or if its children are being loaded: */
+		unsigned int coarsenAge=0;
+		Scalar coarsenLod(0);
+		LidarOctree* coarsenOctree=findCoarseningCandidate(coarsenAge,coarsenLod);
+		if(coarsenOctree==0||!coarsenOctree->coarsenCandidate())
+			return false;
+		}
+	
+	return true;
+	}
@@ -0,0 +1,79 @@
+/***********************************************************************
+LidarCacheManager - Class to share one memory cache budget between
+several LiDAR octrees, and to evict the least important nodes across all
+octrees when the shared cache is full.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARCACHEMANAGER_INCLUDED
+#define LIDARCACHEMANAGER_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+#include "LidarTypes.h"
+
+/* Forward declarations: */
+class LidarOctree;
+
+class LidarCacheManager // Class to arbitrate node residency between LiDAR octrees sharing one memory cache; must only be used from the main thread
+	{
+	/* Elements: */
+	private:
+	size_t cacheSize; // Size of the shared memory cache in bytes
+	size_t numCachedBytes; // Number of bytes currently held by the cached nodes of all registered octrees
+	std::vector<LidarOctree*> octrees; // List of octrees sharing the cache
+	
+	/* Private methods: */
+	LidarOctree* findCoarseningCandidate(unsigned int& age,Scalar& lod); // Returns the octree holding the least important coarsening candidate among all octrees and the candidate's age and LOD, or null if there are no candidates
+	
+	/* Constructors and destructors: */
+	public:
+	LidarCacheManager(size_t sCacheSize); // Creates a cache manager for a shared cache of the given size in bytes
+	~LidarCacheManager(void);
+	
+	/* Methods: */
+	size_t getCacheSize(void) const // Returns the size of the shared memory cache in bytes
+		{
+		return cacheSize;
+		}
+	void setCacheSize(size_t newCacheSize) // Changes the size of the shared memory cache in bytes; call trim to enforce a reduced size immediately
+		{
+		cacheSize=newCacheSize;
+		}
+	size_t getNumCachedBytes(void) const // Returns the number of bytes currently held by all octrees
+		{
+		return numCachedBytes;
+		}
+	void addOctree(LidarOctree* octree,size_t octreeNumCachedBytes); // Registers an octree currently holding the given number of bytes
+	void removeOctree(LidarOctree* octree,size_t octreeNumCachedBytes); // Unregisters an octree currently holding the given number of bytes
+	void addCachedBytes(size_t numBytes) // Accounts for newly cached nodes
+		{
+		numCachedBytes+=numBytes;
+		}
+	void removeCachedBytes(size_t numBytes) // Accounts for evicted nodes
+		{
+		numCachedBytes-=numBytes;
+		}
+	bool makeRoom(size_t numBytes,unsigned int age,Scalar lod); // Coarsens nodes in any octree that are less important than a node of the given age in render passes and LOD until the given number of bytes fit into the cache; returns false if not enough room could be made
+	bool trim(void); // Coarsens the least important nodes in any octree until the cached nodes fit into the cache; returns false if not enough nodes could be coarsened
+	};
+
+#endif
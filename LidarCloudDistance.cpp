@@ -0,0 +1,254 @@
+/***********************************************************************
+LidarCloudDistance - Utility to calculate cloud-to-cloud distances
+between two LiDAR data sets, e.g., for change detection between survey
+epochs.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+#include <IO/SeekableFile.h>
+#include <IO/OpenFile.h>
+#include <Math/Math.h>
+
+#include "LidarTypes.h"
+#include "LidarProcessOctree.h"
+
+/**************
+Helper classes:
+**************/
+
+class NearestDistanceFinder // Functor class to find the distance from a point to its nearest neighbor inside a node
+	{
+	/* Elements: */
+	private:
+	Point queryPoint; // The query point
+	Scalar dist2; // Squared distance to the closest point found so far
+	
+	/* Constructors and destructors: */
+	public:
+	NearestDistanceFinder(const Point& sQueryPoint,Scalar sMaxDist2)
+		:queryPoint(sQueryPoint),dist2(sMaxDist2)
+		{
+		}
+	
+	/* Methods: */
+	void operator()(const LidarPoint& point)
+		{
+		Scalar d2=Geometry::sqrDist(point,queryPoint);
+		if(dist2>d2)
+			dist2=d2;
+		}
+	const Point& getQueryPoint(void) const
+		{
+		return queryPoint;
+		}
+	Scalar getQueryRadius2(void) const
+		{
+		return dist2;
+		}
+	Scalar getDist2(void) const
+		{
+		return dist2;
+		}
+	};
+
+class CloudDistanceCalculator // Node pair functor to calculate the distance from each point of a LiDAR data set to a second LiDAR data set
+	{
+	/* Elements: */
+	private:
+	LidarProcessOctree& octree2; // The octree to which to calculate distances
+	Vector offset2; // Vector from the first octree's coordinates to the second octree's coordinates
+	Scalar maxDist2; // Squared maximum distance at which points are considered matched
+	std::vector<Scalar> dist2s; // Squared distances to closest neighbors found so far for all points of the current leaf
+	Scalar leafMaxDist2; // Largest squared distance in the current leaf; no farther leaf of the second octree can improve any of them
+	IO::FilePtr changeFile; // File to which to write unmatched points, or null
+	size_t numPoints; // Total number of processed points
+	size_t numUnmatched; // Number of points without a match within the maximum distance
+	double distSum,dist2Sum; // Sums of distances and squared distances of matched points
+	Scalar maxMatchedDist; // Largest distance of a matched point
+	
+	/* Constructors and destructors: */
+	public:
+	CloudDistanceCalculator(LidarProcessOctree& octree1,LidarProcessOctree& sOctree2,Scalar sMaxDist,IO::FilePtr sChangeFile)
+		:octree2(sOctree2),
+		 offset2(octree1.getOffset()-octree2.getOffset()),
+		 maxDist2(Math::sqr(sMaxDist)),
+		 leafMaxDist2(maxDist2),
+		 changeFile(sChangeFile),
+		 numPoints(0),numUnmatched(0),
+		 distSum(0.0),dist2Sum(0.0),maxMatchedDist(0)
+		{
+		}
+	
+	/* Methods: */
+	Scalar getMaxDist2(void) const
+		{
+		return leafMaxDist2;
+		}
+	void beginLeaf(LidarProcessOctree::Node& leaf1)
+		{
+		/* Reset the current leaf's distances: */
+		dist2s.assign(leaf1.getNumPoints(),maxDist2);
+		leafMaxDist2=maxDist2;
+		}
+	void operator()(LidarProcessOctree::Node& leaf1,LidarProcessOctree::Node& leaf2)
+		{
+		/* Improve each point's distance using the second leaf's points: */
+		const LidarPoint* points=leaf1.getPoints();
+		Scalar newLeafMaxDist2(0);
+		for(unsigned int i=0;i<leaf1.getNumPoints();++i)
+			{
+			NearestDistanceFinder ndf(points[i]+offset2,dist2s[i]);
+			octree2.processNodePointsDirected(&leaf2,ndf);
+			dist2s[i]=ndf.getDist2();
+			if(newLeafMaxDist2<dist2s[i])
+				newLeafMaxDist2=dist2s[i];
+			}
+		leafMaxDist2=newLeafMaxDist2;
+		}
+	void endLeaf(LidarProcessOctree::Node& leaf1)
+		{
+		/* Accumulate the current leaf's distances: */
+		const LidarPoint* points=leaf1.getPoints();
+		for(unsigned int i=0;i<leaf1.getNumPoints();++i)
+			{
+			if(dist2s[i]<maxDist2)
+				{
+				Scalar dist=Math::sqrt(dist2s[i]);
+				distSum+=double(dist);
+				dist2Sum+=double(dist2s[i]);
+				if(maxMatchedDist<dist)
+					maxMatchedDist=dist;
+				}
+			else
+				{
+				/* Point has no match in the second data set: */
+				if(changeFile!=0)
+					changeFile->write(points[i]);
+				++numUnmatched;
+				}
+			}
+		numPoints+=leaf1.getNumPoints();
+		}
+	void printStatistics(void) const // Prints distance statistics
+		{
+		size_t numMatched=numPoints-numUnmatched;
+		std::cout<<numPoints<<" points, "<<numMatched<<" matched within distance "<<Math::sqrt(maxDist2)<<", "<<numUnmatched<<" unmatched"<<std::endl;
+		if(numMatched>0)
+			{
+			std::cout<<"Mean distance "<<distSum/double(numMatched)<<", RMS distance "<<Math::sqrt(dist2Sum/double(numMatched));
+			std::cout<<", maximum matched distance "<<maxMatchedDist<<std::endl;
+			}
+		}
+	size_t getNumUnmatched(void) const
+		{
+		return numUnmatched;
+		}
+	};
+
+int main(int argc,char* argv[])
+	{
+	/* Parse the command line: */
+	size_t memoryCaches[2]={256,256};
+	const char* lidarFileNames[2]={0,0};
+	Scalar maxDist=Scalar(1);
+	const char* changeFileName=0;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"cache")==0)
+				{
+				if(i+2<argc)
+					{
+					for(int j=0;j<2;++j)
+						{
+						++i;
+						memoryCaches[j]=size_t(atoi(argv[i]));
+						}
+					}
+				else
+					std::cerr<<"Dangling -cache flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"maxDist")==0)
+				{
+				++i;
+				if(i<argc)
+					maxDist=Scalar(atof(argv[i]));
+				else
+					std::cerr<<"Dangling -maxDist flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"o")==0)
+				{
+				++i;
+				if(i<argc)
+					changeFileName=argv[i];
+				else
+					std::cerr<<"Dangling -o flag on command line"<<std::endl;
+				}
+			else
+				std::cerr<<"Ignoring unrecognized option "<<argv[i]<<std::endl;
+			}
+		else if(lidarFileNames[0]==0)
+			lidarFileNames[0]=argv[i];
+		else if(lidarFileNames[1]==0)
+			lidarFileNames[1]=argv[i];
+		else
+			std::cerr<<"Ignoring command line argument "<<argv[i]<<std::endl;
+		}
+	if(lidarFileNames[1]==0)
+		{
+		std::cerr<<"Usage: "<<argv[0]<<" [-cache <cache size 1> <cache size 2>] [-maxDist <maximum distance>] [-o <unmatched point file name>] <LiDAR file 1> <LiDAR file 2>"<<std::endl;
+		return 1;
+		}
+	
+	/* Open the two LiDAR octree files: */
+	LidarProcessOctree lpo1(lidarFileNames[0],memoryCaches[0]*size_t(1024*1024));
+	LidarProcessOctree lpo2(lidarFileNames[1],memoryCaches[1]*size_t(1024*1024));
+	
+	/* Open the unmatched point file: */
+	IO::SeekableFilePtr changeFile;
+	if(changeFileName!=0)
+		{
+		changeFile=IO::openSeekableFile(changeFileName,IO::File::WriteOnly);
+		changeFile->setEndianness(Misc::LittleEndian);
+		
+		/* Write a bogus file header: */
+		changeFile->write<unsigned int>(0);
+		}
+	
+	/* Calculate the distances from all points of the first LiDAR file to the second one: */
+	CloudDistanceCalculator cdc(lpo1,lpo2,maxDist,changeFile);
+	lpo1.processNodePairs(lpo2,cdc);
+	cdc.printStatistics();
+	
+	if(changeFile!=0)
+		{
+		/* Finalize the unmatched point file: */
+		changeFile->setWritePosAbs(0);
+		changeFile->write<unsigned int>((unsigned int)cdc.getNumUnmatched());
+		std::cout<<cdc.getNumUnmatched()<<" unmatched points written to "<<changeFileName<<std::endl;
+		}
+	
+	return 0;
+	}
@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarColorMapper - Post-processing filter to assign image colors to each
 point in a LiDAR data set.
-Copyright (c) 2009-2024 Oliver Kreylos
+Copyright (c) 2009-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -21,17 +21,27 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 02111-1307 USA
 ***********************************************************************/
 
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <utility>
 #include <string>
+#include <stdexcept>
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <Misc/SizedTypes.h>
 #include <Misc/StdError.h>
 #include <Misc/HashTable.h>
 #include <Misc/FileNameExtensions.h>
+#include <Threads/Mutex.h>
 #include <IO/File.h>
 #include <IO/OpenFile.h>
 #include <IO/ValueSource.h>
+#include <Math/Math.h>
 #include <Geometry/Point.h>
 #include <Geometry/Box.h>
 #include <Geometry/AffineTransformation.h>
@@ -48,7 +58,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarProcessOctree.h"
 
 /*******************************************************************
-Class to represent color images with 2D projection into world space:
+Class to represent color images with 2D projection into world space,
+stored as memory-mapped pyramids of tiles:
 *******************************************************************/
 
 class Image2D
@@ -62,19 +73,51 @@ class Image2D
 	typedef Images::RGBImage::Color Color; // Type for image colors
 	typedef std::pair<bool,Color> SampleResult; // Type for results of sampling an image
 	
-	/* Elements: */
 	private:
+	struct Level // Structure describing one level of an image pyramid
+		{
+		/* Elements: */
+		public:
+		Size size; // The level's width and height in pixels
+		unsigned int numTiles[2]; // Number of tiles covering the level in x and y
+		size_t firstTile; // Index of the level's first tile in the pyramid file
+		};
+	
+	static const size_t pyramidHeaderSize=4096; // Size of a pyramid file's header; tiles start at the next page boundary
+	
+	/* Elements: */
 	std::string fileName; // The image's file name
 	Size size; // The image's width and height in pixels
 	Transform transform; // The transformation from image coordinates to world coordinates
 	Transform invTransform; // The transformation from world coordinates to image coordinates
 	Box imageBox; // Bounding box of image in image coordinates
 	Box worldBox; // Bounding box of image in world coordinates
-	Images::RGBImage image; // Image data; invalid if image is not paged in
+	double pixelSize; // Average edge length of a full-resolution pixel in world coordinates
+	unsigned int tileSize; // Width and height of tiles in pixels; each tile also stores the adjacent column and row of its right and upper neighbors for seamless interpolation
+	size_t tileStride; // Size of a tile in the pyramid file in bytes, padded to whole pages
+	std::vector<Level> levels; // Pyramid levels from full resolution down to a single tile
+	size_t numTiles; // Total number of tiles in all pyramid levels
+	int pyramidFd; // File descriptor of the mapped pyramid file
+	size_t pyramidSize; // Size of the mapped pyramid file in bytes
+	const unsigned char* pyramid; // Pointer to the beginning of the mapped pyramid file
+	
+	/* Private methods: */
+	void calcLevels(void); // Calculates the pyramid layout for the current image size and tile size
+	bool mapPyramid(const char* pyramidFileName); // Maps an existing pyramid file read-only; returns false if the file does not exist or does not match the image
+	void createPyramid(const char* pyramidFileName) const; // Creates the image's pyramid file by reading the image once
+	const Color* getTile(size_t tileIndex) const // Returns the pixels of the tile of the given index
+		{
+		return reinterpret_cast<const Color*>(pyramid+pyramidHeaderSize+tileIndex*tileStride);
+		}
 	
 	/* Constructors and destructors: */
 	public:
-	Image2D(const char* sFileName); // Loads an image and world space information from a set of files
+	Image2D(const char* sFileName,unsigned int sTileSize); // Loads world space information for an image and maps its pyramid, which is created with the given tile size if it does not exist
+	private:
+	Image2D(const Image2D& source); // Prohibit copy constructor
+	Image2D& operator=(const Image2D& source); // Prohibit assignment operator
+	public:
+	~Image2D(void);
 	
 	/* Methods: */
 	const Size& getSize(void) const // Returns the image's size in pixels
@@ -85,17 +128,195 @@ class Image2D
 		{
 		return worldBox;
 		}
-	void pageIn(void); // Ensures that the image's data resides in main memory
-	void pageOut(void); // Releases the image's data from main memory
-	SampleResult getColor(const Point& worldPos) const; // Returns the image's color for the given point in world coordinates
+	size_t getNumTiles(void) const // Returns the total number of tiles in the image's pyramid
+		{
+		return numTiles;
+		}
+	size_t getTileStride(void) const // Returns the memory footprint of a tile in bytes
+		{
+		return tileStride;
+		}
+	unsigned int selectLevel(double pointSpacing) const; // Returns the coarsest pyramid level whose pixels are no larger than the given point spacing in world space
+	void getTiles(unsigned int level,const Box& box,std::vector<size_t>& tileIndices) const; // Appends the indices of all tiles of the given pyramid level overlapping the given box in world space to the given list
+	void adviseWillNeed(size_t tileIndex) const; // Tells the operating system that the given tile will be accessed soon
+	void adviseDontNeed(size_t tileIndex) const; // Tells the operating system that the given tile's pages can be released
+	SampleResult getColor(const Point& worldPos,unsigned int level) const; // Returns the image's color for the given point in world coordinates from the given pyramid level
 	};
 
 /************************
 Methods of class Image2D:
 ************************/
 
-Image2D::Image2D(const char* sFileName)
-	:fileName(sFileName)
+void Image2D::calcLevels(void)
+	{
+	/* Halve the image size until it fits into a single tile: */
+	levels.clear();
+	numTiles=0;
+	Size levelSize=size;
+	while(true)
+		{
+		Level level;
+		level.size=levelSize;
+		for(int i=0;i<2;++i)
+			level.numTiles[i]=(levelSize[i]+tileSize-1)/tileSize;
+		level.firstTile=numTiles;
+		levels.push_back(level);
+		numTiles+=size_t(level.numTiles[0])*size_t(level.numTiles[1]);
+		if(level.numTiles[0]==1&&level.numTiles[1]==1)
+			break;
+		for(int i=0;i<2;++i)
+			levelSize[i]=(levelSize[i]+1)/2;
+		}
+	
+	/* Pad tiles to whole pages: */
+	tileStride=size_t(tileSize+1)*size_t(tileSize+1)*sizeof(Color);
+	tileStride=(tileStride+pyramidHeaderSize-1)&~(pyramidHeaderSize-1);
+	}
+
+bool Image2D::mapPyramid(const char* pyramidFileName)
+	{
+	/* Open the pyramid file: */
+	int fd=open(pyramidFileName,O_RDONLY);
+	if(fd<0)
+		return false;
+	
+	/* Check the file's size against the pyramid layout: */
+	size_t expectedSize=pyramidHeaderSize+numTiles*tileStride;
+	struct stat fileStats;
+	if(fstat(fd,&fileStats)<0||size_t(fileStats.st_size)!=expectedSize)
+		{
+		close(fd);
+		return false;
+		}
+	
+	/* Map the entire file read-only: */
+	void* mapping=mmap(0,expectedSize,PROT_READ,MAP_SHARED,fd,0);
+	if(mapping==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot map pyramid file %s",pyramidFileName);
+		}
+	
+	/* Check the file's header: */
+	const unsigned int* header=static_cast<const unsigned int*>(mapping);
+	if(header[0]!=0x4c50594dU||header[1]!=(unsigned int)(sizeof(Color))||header[2]!=size[0]||header[3]!=size[1]||header[4]!=tileSize)
+		{
+		munmap(mapping,expectedSize);
+		close(fd);
+		return false;
+		}
+	
+	/* Tiles are accessed in octree order, not file order; disable aggressive read-ahead: */
+	madvise(mapping,expectedSize,MADV_RANDOM);
+	
+	pyramidFd=fd;
+	pyramidSize=expectedSize;
+	pyramid=static_cast<const unsigned char*>(mapping);
+	return true;
+	}
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+void writeLevelTiles(IO::File& pyramidFile,const std::vector<const Image2D::Color*>& rows,const Image2D::Size& levelSize,unsigned int tileSize,std::vector<unsigned char>& tileBuffer)
+	{
+	/* Write all tiles of the level in row-major order: */
+	Image2D::Color* tile=reinterpret_cast<Image2D::Color*>(&tileBuffer[0]);
+	for(unsigned int tileY=0;tileY*tileSize<levelSize[1];++tileY)
+		for(unsigned int tileX=0;tileX*tileSize<levelSize[0];++tileX)
+			{
+			/* Copy the tile's pixels, replicating the level's last column and row where the tile extends past the level: */
+			for(unsigned int y=0;y<=tileSize;++y)
+				{
+				const Image2D::Color* row=rows[Math::min(tileY*tileSize+y,levelSize[1]-1)];
+				Image2D::Color* tileRow=tile+y*(tileSize+1);
+				for(unsigned int x=0;x<=tileSize;++x)
+					tileRow[x]=row[Math::min(tileX*tileSize+x,levelSize[0]-1)];
+				}
+			pyramidFile.writeRaw(&tileBuffer[0],tileBuffer.size());
+			}
+	}
+
+void downsampleLevel(const std::vector<const Image2D::Color*>& rows,const Image2D::Size& levelSize,const Image2D::Size& nextSize,std::vector<Image2D::Color>& nextPixels)
+	{
+	/* Average each 2x2 block of pixels, replicating the level's last column and row if its size is odd: */
+	nextPixels.resize(size_t(nextSize[0])*size_t(nextSize[1]));
+	for(unsigned int y=0;y<nextSize[1];++y)
+		{
+		const Image2D::Color* r0=rows[2*y];
+		const Image2D::Color* r1=rows[Math::min(2*y+1,levelSize[1]-1)];
+		Image2D::Color* nextRow=&nextPixels[size_t(y)*size_t(nextSize[0])];
+		for(unsigned int x=0;x<nextSize[0];++x)
+			{
+			unsigned int x0=2*x;
+			unsigned int x1=Math::min(2*x+1,levelSize[0]-1);
+			for(int i=0;i<3;++i)
+				nextRow[x][i]=Image2D::Color::Scalar(((unsigned int)(r0[x0][i])+(unsigned int)(r0[x1][i])+(unsigned int)(r1[x0][i])+(unsigned int)(r1[x1][i])+2U)/4U);
+			}
+		}
+	}
+
+}
+
+void Image2D::createPyramid(const char* pyramidFileName) const
+	{
+	std::cout<<"Creating image pyramid "<<pyramidFileName<<"..."<<std::flush;
+	IO::FilePtr pyramidFile(IO::openFile(pyramidFileName,IO::File::WriteOnly));
+	
+	/* Write the pyramid file's header: */
+	std::vector<unsigned char> tileBuffer(tileStride,0U);
+	{
+	std::vector<unsigned char> headerBuffer(pyramidHeaderSize,0U);
+	unsigned int* header=reinterpret_cast<unsigned int*>(&headerBuffer[0]);
+	header[0]=0x4c50594dU;
+	header[1]=(unsigned int)(sizeof(Color));
+	header[2]=size[0];
+	header[3]=size[1];
+	header[4]=tileSize;
+	header[5]=(unsigned int)(levels.size());
+	pyramidFile->writeRaw(&headerBuffer[0],headerBuffer.size());
+	}
+	
+	/* Write the full-resolution level straight from the image: */
+	std::vector<const Color*> rows(size[1]);
+	std::vector<Color> levelPixels;
+	{
+	Images::RGBImage image=Images::readImageFile(fileName.c_str());
+	for(unsigned int y=0;y<size[1];++y)
+		rows[y]=image.getPixelRow(y);
+	writeLevelTiles(*pyramidFile,rows,size,tileSize,tileBuffer);
+	if(levels.size()>1)
+		downsampleLevel(rows,size,levels[1].size,levelPixels);
+	}
+	
+	/* Write all lower-resolution levels, downsampling each level into the next one: */
+	for(size_t level=1;level<levels.size();++level)
+		{
+		const Size& levelSize=levels[level].size;
+		rows.resize(levelSize[1]);
+		for(unsigned int y=0;y<levelSize[1];++y)
+			rows[y]=&levelPixels[size_t(y)*size_t(levelSize[0])];
+		writeLevelTiles(*pyramidFile,rows,levelSize,tileSize,tileBuffer);
+		
+		if(level+1<levels.size())
+			{
+			std::vector<Color> nextPixels;
+			downsampleLevel(rows,levelSize,levels[level+1].size,nextPixels);
+			levelPixels.swap(nextPixels);
+			}
+		}
+	
+	std::cout<<" done"<<std::endl;
+	}
+
+Image2D::Image2D(const char* sFileName,unsigned int sTileSize)
+	:fileName(sFileName),
+	 tileSize(sTileSize),
+	 pyramidFd(-1),pyramidSize(0),pyramid(0)
 	{
 	/* Construct the file name of the world space metafile: */
 	const char* extPtr=Misc::getExtension(fileName.c_str());
@@ -121,6 +342,10 @@ Image2D::Image2D(const char* sFileName)
 	/* Calculate the inverse transformation: */
 	invTransform=Geometry::invert(transform);
 	
+	/* Calculate the average pixel size in world space: */
+	const Transform::Matrix& m=transform.getMatrix();
+	pixelSize=Math::sqrt(Math::abs(m(0,0)*m(1,1)-m(0,1)*m(1,0)));
+	
 	/* Calculate the bounding box in image space: */
 	imageBox.min=Point::origin;
 	imageBox.max=Point(double(size[0]-1),double(size[1]-1));
@@ -131,27 +356,88 @@ Image2D::Image2D(const char* sFileName)
 	
 	/* Print the world space bounding box: */
 	std::cout<<"World space bounding box: "<<worldBox.min<<", "<<worldBox.max<<std::endl;
+	
+	/* Map the image's pyramid, and create it first if it does not exist yet: */
+	calcLevels();
+	std::string pyramidFileName=fileName+".pyramid";
+	if(!mapPyramid(pyramidFileName.c_str()))
+		{
+		createPyramid(pyramidFileName.c_str());
+		if(!mapPyramid(pyramidFileName.c_str()))
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot map pyramid file %s",pyramidFileName.c_str());
+		}
 	}
 
-void Image2D::pageIn(void)
+Image2D::~Image2D(void)
 	{
-	if(!image.isValid())
+	/* Unmap and close the pyramid file: */
+	if(pyramid!=0)
 		{
-		/* Load the image file: */
-		std::cout<<"\rPaging in image file "<<fileName<<"..."<<std::flush;
-		image=Images::readImageFile(fileName.c_str());
-		std::cout<<" done"<<std::endl;
+		munmap(const_cast<unsigned char*>(pyramid),pyramidSize);
+		close(pyramidFd);
 		}
 	}
 
-void Image2D::pageOut(void)
+unsigned int Image2D::selectLevel(double pointSpacing) const
 	{
-	/* Replace the image with an invalid image: */
-	std::cout<<"\rPaging out image file "<<fileName<<std::endl;
-	image=Images::RGBImage();
+	unsigned int level=0;
+	double levelPixelSize=pixelSize*2.0;
+	while(level+1<levels.size()&&levelPixelSize<=pointSpacing)
+		{
+		++level;
+		levelPixelSize*=2.0;
+		}
+	return level;
 	}
 
-Image2D::SampleResult Image2D::getColor(const Image2D::Point& worldPos) const
+void Image2D::getTiles(unsigned int level,const Image2D::Box& box,std::vector<size_t>& tileIndices) const
+	{
+	/* Transform the box's corners into the level's pixel space: */
+	const Level& l=levels[level];
+	double levelScale=1.0/double(1U<<level);
+	Box levelBox=Box::empty;
+	for(int corner=0;corner<4;++corner)
+		{
+		Point imagePos=invTransform.transform(Point(corner&0x1?box.max[0]:box.min[0],corner&0x2?box.max[1]:box.min[1]));
+		for(int i=0;i<2;++i)
+			imagePos[i]=(imagePos[i]+0.5)*levelScale-0.5;
+		levelBox.addPoint(imagePos);
+		}
+	
+	/* Clamp the box to the level: */
+	if(levelBox.max[0]<0.0||levelBox.min[0]>double(l.size[0]-1)||levelBox.max[1]<0.0||levelBox.min[1]>double(l.size[1]-1))
+		return;
+	unsigned int tileMin[2],tileMax[2];
+	for(int i=0;i<2;++i)
+		{
+		tileMin[i]=(unsigned int)(Math::max(levelBox.min[i],0.0))/tileSize;
+		tileMax[i]=(unsigned int)(Math::min(levelBox.max[i],double(l.size[i]-1)))/tileSize+1;
+		}
+	
+	/* Append the overlapping tiles: */
+	for(unsigned int tileY=tileMin[1];tileY<tileMax[1];++tileY)
+		for(unsigned int tileX=tileMin[0];tileX<tileMax[0];++tileX)
+			tileIndices.push_back(l.firstTile+size_t(tileY)*size_t(l.numTiles[0])+size_t(tileX));
+	}
+
+void Image2D::adviseWillNeed(size_t tileIndex) const
+	{
+	madvise(const_cast<unsigned char*>(pyramid)+pyramidHeaderSize+tileIndex*tileStride,tileStride,MADV_WILLNEED);
+	}
+
+void Image2D::adviseDontNeed(size_t tileIndex) const
+	{
+	/* Only release pages that lie entirely inside the tile: */
+	size_t pageSize=size_t(sysconf(_SC_PAGESIZE));
+	size_t start=pyramidHeaderSize+tileIndex*tileStride;
+	size_t end=start+tileStride;
+	start=(start+pageSize-1)&~(pageSize-1);
+	end&=~(pageSize-1);
+	if(start<end)
+		madvise(const_cast<unsigned char*>(pyramid)+start,end-start,MADV_DONTNEED);
+	}
+
+Image2D::SampleResult Image2D::getColor(const Image2D::Point& worldPos,unsigned int level) const
 	{
 	/* Transform the world position to image space: */
 	Point imagePos=invTransform.transform(worldPos);
@@ -160,13 +446,29 @@ Image2D::SampleResult Image2D::getColor(const Image2D::Point& worldPos) const
 	if(imagePos[0]<imageBox.min[0]||imagePos[0]>=imageBox.max[0]||imagePos[1]<imageBox.min[1]||imagePos[1]>=imageBox.max[1])
 		return SampleResult(false,Color(0,0,0));
 	
-	/* Sample the image: */
+	/* Transform the image position to the level's pixel space: */
+	const Level& l=levels[level];
+	if(level>0)
+		{
+		double levelScale=1.0/double(1U<<level);
+		for(int i=0;i<2;++i)
+			imagePos[i]=Math::clamp((imagePos[i]+0.5)*levelScale-0.5,0.0,double(l.size[i]-1));
+		}
+	
+	/* Find the tile containing the image position: */
 	unsigned int cx=(unsigned int)imagePos[0];
 	double dx=imagePos[0]-double(cx);
 	unsigned int cy=(unsigned int)imagePos[1];
 	double dy=imagePos[1]-double(cy);
-	const Color* r0=image.getPixelRow(cy);
-	const Color* r1=image.getPixelRow(cy+1);
+	unsigned int tileX=cx/tileSize;
+	unsigned int tileY=cy/tileSize;
+	cx-=tileX*tileSize;
+	cy-=tileY*tileSize;
+	const Color* tile=getTile(l.firstTile+size_t(tileY)*size_t(l.numTiles[0])+size_t(tileX));
+	
+	/* Sample the tile: */
+	const Color* r0=tile+cy*(tileSize+1);
+	const Color* r1=r0+(tileSize+1);
 	double p0[3],p1[3];
 	for(int i=0;i<3;++i)
 		{
@@ -187,159 +489,172 @@ Image2D::SampleResult Image2D::getColor(const Image2D::Point& worldPos) const
 	return SampleResult(true,result);
 	}
 
-/************************************************
-Helper class to manage an LRU cache of 2D images:
-************************************************/
+/***********************************************************
+Helper class to manage an LRU cache of resident image tiles:
+***********************************************************/
 
-class ImageCacher
+class TileCache
 	{
 	/* Embedded classes: */
+	public:
+	typedef std::pair<Image2D*,size_t> TileRef; // Type to identify a tile by its image and its index in the image's pyramid
+	
 	private:
 	struct LRUItem // Structure for least-recently-used list items
 		{
 		/* Elements: */
-		Image2D* image; // Pointer to the image
-		size_t imageSize; // Image memory footprint in bytes
-		bool pagedIn; // Flag if the image's data are currently residing in main memory
-		unsigned int pageInCounter; // Request counter value at which this image was last paged in
+		Image2D* image; // Pointer to the image containing the tile
+		size_t tileIndex; // Index of the tile in its image's pyramid
+		Misc::UInt64 key; // Cache-wide key of the tile
+		unsigned int pinCount; // Number of requests currently using the tile; pinned tiles are not in the LRU list
 		LRUItem* pred; // Pointer to preceding entry in LRU list
 		LRUItem* succ; // Pointer to succeeding entry in LRU list
 		};
 	
 	/* Elements: */
 	private:
+	Threads::Mutex cacheMutex; // Mutex serializing access to the cache from multiple threads
 	size_t maxMemory; // Allocated amount of memory in bytes
-	Misc::HashTable<Image2D*,LRUItem*> lruMap; // Map from image pointers to least-recently-used list items
-	LRUItem* lruHead; // Pointer to the least-recently-used image
-	LRUItem* lruTail; // Pointer to the most-recently-used image
+	Misc::HashTable<Image2D*,Misc::UInt64> imageTileBases; // Map from image pointers to the cache-wide keys of their first tiles
+	Misc::UInt64 numTiles; // Total number of tiles in all registered images
+	Misc::HashTable<Misc::UInt64,LRUItem*> lruMap; // Map from cache-wide keys of resident tiles to least-recently-used list items
+	LRUItem* lruHead; // Pointer to the least-recently-used unpinned tile
+	LRUItem* lruTail; // Pointer to the most-recently-used unpinned tile
 	size_t usedMemory; // Currently used amount of memory in bytes
-	unsigned int requestCounter; // Counter to keep track of cache memory overflow
-	unsigned int numPageInRequests; // Total number of times an image was loaded into memory
+	size_t numTileLoads; // Total number of times a tile was loaded into memory
+	
+	/* Private methods: */
+	void unlink(LRUItem* item) // Removes the given item from the LRU list
+		{
+		if(item->pred!=0)
+			item->pred->succ=item->succ;
+		else
+			lruHead=item->succ;
+		if(item->succ!=0)
+			item->succ->pred=item->pred;
+		else
+			lruTail=item->pred;
+		}
+	void linkTail(LRUItem* item) // Appends the given item to the end of the LRU list
+		{
+		item->pred=lruTail;
+		if(lruTail!=0)
+			lruTail->succ=item;
+		else
+			lruHead=item;
+		lruTail=item;
+		item->succ=0;
+		}
+	void pageOut(void); // Releases least-recently-used unpinned tiles until the cache fits into memory; cache must be locked
 	
 	/* Constructors and destructors: */
 	public:
-	ImageCacher(size_t sMaxMemory); // Creates an image cacher with the given memory size in bytes
-	~ImageCacher(void);
+	TileCache(size_t sMaxMemory); // Creates a tile cache with the given memory size in bytes
+	~TileCache(void);
 	
 	/* Methods: */
 	void registerImage(Image2D* image); // Registers an image with the cache manager
-	void requestImages(const std::vector<Image2D*>& images); // Requests in-memory access to the given set of images
-	unsigned int getNumPageInRequests(void) const
+	void requestTiles(const std::vector<TileRef>& tiles); // Requests in-memory access to the given tiles and pins them until they are released
+	void releaseTiles(const std::vector<TileRef>& tiles); // Releases the given previously requested tiles
+	size_t getNumTileLoads(void) const
 		{
-		return numPageInRequests;
+		return numTileLoads;
 		}
 	};
 
-/****************************
-Methods of class ImageCacher:
-****************************/
+/**************************
+Methods of class TileCache:
+**************************/
+
+void TileCache::pageOut(void)
+	{
+	/* Page out tiles from the head of the LRU list until the cache fits into memory: */
+	while(usedMemory>maxMemory&&lruHead!=0)
+		{
+		LRUItem* out=lruHead;
+		unlink(out);
+		out->image->adviseDontNeed(out->tileIndex);
+		usedMemory-=out->image->getTileStride();
+		lruMap.removeEntry(out->key);
+		delete out;
+		}
+	}
 
-ImageCacher::ImageCacher(size_t sMaxMemory)
+TileCache::TileCache(size_t sMaxMemory)
 	:maxMemory(sMaxMemory),
-	 lruMap(101),
+	 imageTileBases(101),numTiles(0),
+	 lruMap(1021),
 	 lruHead(0),lruTail(0),
 	 usedMemory(0),
-	 requestCounter(0),
-	 numPageInRequests(0)
+	 numTileLoads(0)
 	{
 	}
 
-ImageCacher::~ImageCacher(void)
+TileCache::~TileCache(void)
 	{
 	/* Destroy all LRU list items: */
-	for(Misc::HashTable<Image2D*,LRUItem*>::Iterator lmIt=lruMap.begin();!lmIt.isFinished();++lmIt)
+	for(Misc::HashTable<Misc::UInt64,LRUItem*>::Iterator lmIt=lruMap.begin();!lmIt.isFinished();++lmIt)
 		delete lmIt->getDest();
 	}
 
-void ImageCacher::registerImage(Image2D* image)
+void TileCache::registerImage(Image2D* image)
 	{
-	/* Create a new LRU list item: */
-	LRUItem* newItem=new LRUItem;
-	newItem->image=image;
-	newItem->imageSize=size_t(image->getSize()[1])*size_t(image->getSize()[0])*sizeof(Image2D::Color);
-	newItem->pagedIn=false;
-	newItem->pred=0;
-	newItem->succ=0;
-	
-	/* Store the LRU list item in the item map: */
-	lruMap[image]=newItem;
+	/* Assign a range of cache-wide keys to the image's tiles: */
+	imageTileBases[image]=numTiles;
+	numTiles+=Misc::UInt64(image->getNumTiles());
 	}
 
-void ImageCacher::requestImages(const std::vector<Image2D*>& images)
+void TileCache::requestTiles(const std::vector<TileCache::TileRef>& tiles)
 	{
-	/* Add all images in the list to the LRU cache in turn: */
-	for(std::vector<Image2D*>::const_iterator iIt=images.begin();iIt!=images.end();++iIt)
+	Threads::Mutex::Lock cacheLock(cacheMutex);
+	
+	for(std::vector<TileRef>::const_iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
 		{
-		/* Check if the image is already paged in: */
-		LRUItem* item=lruMap[*iIt].getDest();
-		if(item->pagedIn)
+		/* Check if the tile is already resident: */
+		Misc::UInt64 key=imageTileBases[tIt->first].getDest()+Misc::UInt64(tIt->second);
+		Misc::HashTable<Misc::UInt64,LRUItem*>::Iterator lmIt=lruMap.findEntry(key);
+		LRUItem* item;
+		if(!lmIt.isFinished())
 			{
-			/* Move the image's LRU list item to the end of the LRU list: */
-			if(lruTail!=item)
-				{
-				/* Unlink the item from its current place in the list: */
-				if(item->pred!=0)
-					item->pred->succ=item->succ;
-				else
-					lruHead=item->succ;
-				if(item->succ!=0)
-					item->succ->pred=item->pred;
-				
-				/* Link the item to the list's tail: */
-				item->pred=lruTail;
-				if(lruTail!=0)
-					lruTail->succ=item;
-				else
-					lruHead=item;
-				lruTail=item;
-				item->succ=0;
-				}
+			/* Take the tile out of the LRU list while it is pinned: */
+			item=lmIt->getDest();
+			if(item->pinCount==0)
+				unlink(item);
 			}
 		else
 			{
-			/* Page out images from the head of the LRU list until there is enough space in memory: */
-			while(usedMemory+item->imageSize>maxMemory)
-				{
-				/* Page out the current least-recently-used item: */
-				LRUItem* out=lruHead;
-				if(out->pageInCounter==requestCounter)
-					{
-					/* We just paged this image in; there is not enough memory in the cache to satisfy the request list: */
-					throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Not enough memory to satisfy image request");
-					}
-				out->image->pageOut();
-				out->pagedIn=false;
-				usedMemory-=out->imageSize;
-				
-				/* Unlink the item from the LRU list: */
-				if(out->succ!=0)
-					out->succ->pred=0;
-				else
-					lruTail=0;
-				lruHead=out->succ;
-				out->succ=0;
-				}
-			
-			/* Page in the requested image: */
-			item->image->pageIn();
-			item->pagedIn=true;
-			item->pageInCounter=requestCounter;
-			usedMemory+=item->imageSize;
-			++numPageInRequests;
-			
-			/* Link the item to the list's tail: */
-			item->pred=lruTail;
-			if(lruTail!=0)
-				lruTail->succ=item;
-			else
-				lruHead=item;
-			lruTail=item;
-			item->succ=0;
+			/* Page in the requested tile: */
+			item=new LRUItem;
+			item->image=tIt->first;
+			item->tileIndex=tIt->second;
+			item->key=key;
+			item->pinCount=0;
+			item->image->adviseWillNeed(item->tileIndex);
+			usedMemory+=item->image->getTileStride();
+			++numTileLoads;
+			lruMap[key]=item;
 			}
+		++item->pinCount;
 		}
 	
-	/* Go to the next request transaction: */
-	++requestCounter;
+	/* Make room for the new tiles: */
+	pageOut();
+	}
+
+void TileCache::releaseTiles(const std::vector<TileCache::TileRef>& tiles)
+	{
+	Threads::Mutex::Lock cacheLock(cacheMutex);
+	
+	for(std::vector<TileRef>::const_iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		{
+		/* Move the tile back to the end of the LRU list once it is no longer used: */
+		LRUItem* item=lruMap[imageTileBases[tIt->first].getDest()+Misc::UInt64(tIt->second)].getDest();
+		if(--item->pinCount==0)
+			linkTail(item);
+		}
+	
+	/* Release tiles that did not fit while they were pinned: */
+	pageOut();
 	}
 
 /*******************************************************
@@ -348,18 +663,36 @@ Octree traversal functor class to colorize LiDAR points:
 
 class NodeColorSampler
 	{
-	/* Elements: */
+	/* Embedded classes: */
 	private:
+	struct Buffers // Structure for scratch buffers used while processing a single node
+		{
+		/* Elements: */
+		public:
+		Color* colorBuffer; // Array to hold colors for a node during processing
+		Color* childColorBuffers[8]; // Array of color arrays for a node's children during subsampling
+		};
+	
+	/* Elements: */
 	LidarProcessOctree& lpo; // The processed LiDAR octree
 	const std::vector<Image2D*>& images; // The vector of images
-	ImageCacher imageCacher; // The cache manager for images
-	Color* colorBuffer; // Array to hold colors for a node during processing
-	Color* childColorBuffers[8]; // Array of color arrays for a node's children during subsampling
+	TileCache tileCache; // The cache manager for image tiles
+	Threads::Mutex bufferMutex; // Mutex protecting the list of idle scratch buffers
+	std::vector<Buffers*> idleBuffers; // List of scratch buffers not currently used by any thread
 	LidarFile::Offset colorDataSize; // Size of each record in the color file
-	LidarFile colorFile; // The file to which to write the color data
+	int colorFd; // File descriptor of the color file, which is read and written at explicit positions by concurrent threads
+	Threads::Mutex statusMutex; // Mutex protecting the progress counters and error message
 	size_t numProcessedNodes; // Number of already processed nodes
 	size_t nextProgressUpdate; // Number of processed nodes at which the progress indicator should be updated
 	size_t numAssignedColors; // Number of LiDAR points to which colors could be assigned
+	std::string errorMessage; // Message of the first error that occurred during processing
+	
+	/* Private methods: */
+	Buffers* acquireBuffers(void); // Returns an idle set of scratch buffers, or a new set if there is none
+	void releaseBuffers(Buffers* buffers); // Returns the given set of scratch buffers to the idle list
+	void readColors(Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const; // Reads a node's colors from the color file
+	void writeColors(const Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const; // Writes a node's colors to the color file
+	size_t colorizeNode(LidarProcessOctree::Node& node,Buffers& buffers); // Assigns colors to the given node's points and writes them to the color file; returns number of points whose colors were assigned from images
 	
 	/* Constructors and destructors: */
 	public:
@@ -367,14 +700,18 @@ class NodeColorSampler
 	~NodeColorSampler(void);
 	
 	/* Methods: */
-	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel);
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel); // Processes a node; thread-safe if called from a parallel post-fix traversal
 	size_t getNumAssignedColors(void) const // Returns the number of LiDAR points that were assigned colors
 		{
 		return numAssignedColors;
 		}
-	const ImageCacher& getImageCacher(void) const
+	const TileCache& getTileCache(void) const
+		{
+		return tileCache;
+		}
+	const std::string& getErrorMessage(void) const // Returns the message of the first error that occurred during processing, or an empty string
 		{
-		return imageCacher;
+		return errorMessage;
 		}
 	};
 
@@ -382,35 +719,101 @@ class NodeColorSampler
 Methods of class NodeColorSampler:
 *********************************/
 
+NodeColorSampler::Buffers* NodeColorSampler::acquireBuffers(void)
+	{
+	{
+	Threads::Mutex::Lock bufferLock(bufferMutex);
+	if(!idleBuffers.empty())
+		{
+		Buffers* result=idleBuffers.back();
+		idleBuffers.pop_back();
+		return result;
+		}
+	}
+	
+	/* Allocate a new set of buffers: */
+	Buffers* result=new Buffers;
+	result->colorBuffer=new Color[lpo.getMaxNumPointsPerNode()];
+	for(int i=0;i<8;++i)
+		result->childColorBuffers[i]=new Color[lpo.getMaxNumPointsPerNode()];
+	return result;
+	}
+
+void NodeColorSampler::releaseBuffers(NodeColorSampler::Buffers* buffers)
+	{
+	Threads::Mutex::Lock bufferLock(bufferMutex);
+	idleBuffers.push_back(buffers);
+	}
+
+void NodeColorSampler::readColors(Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const
+	{
+	char* bufPtr=reinterpret_cast<char*>(colors);
+	size_t numBytes=size_t(numColors)*sizeof(Color);
+	off_t pos=off_t(LidarDataFileHeader::getFileSize()+colorDataSize*dataOffset);
+	while(numBytes>0)
+		{
+		ssize_t readResult=pread(colorFd,bufPtr,numBytes,pos);
+		if(readResult<=0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,readResult<0?errno:0,"Cannot read colors at offset %llu",(unsigned long long)dataOffset);
+		bufPtr+=readResult;
+		numBytes-=size_t(readResult);
+		pos+=off_t(readResult);
+		}
+	}
+
+void NodeColorSampler::writeColors(const Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const
+	{
+	const char* bufPtr=reinterpret_cast<const char*>(colors);
+	size_t numBytes=size_t(numColors)*sizeof(Color);
+	off_t pos=off_t(LidarDataFileHeader::getFileSize()+colorDataSize*dataOffset);
+	while(numBytes>0)
+		{
+		ssize_t writeResult=pwrite(colorFd,bufPtr,numBytes,pos);
+		if(writeResult<0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot write colors at offset %llu",(unsigned long long)dataOffset);
+		bufPtr+=writeResult;
+		numBytes-=size_t(writeResult);
+		pos+=off_t(writeResult);
+		}
+	}
+
 NodeColorSampler::NodeColorSampler(LidarProcessOctree& sLpo,const std::vector<Image2D*>& sImages,size_t imageMemorySize,const char* colorFileName)
 	:lpo(sLpo),
 	 images(sImages),
-	 imageCacher(imageMemorySize),
-	 colorBuffer(new Color[lpo.getMaxNumPointsPerNode()]),
+	 tileCache(imageMemorySize),
 	 colorDataSize(sizeof(Color)),
-	 colorFile(colorFileName,LidarFile::ReadWrite),
+	 colorFd(-1),
 	 numProcessedNodes(0),nextProgressUpdate((lpo.getNumNodes()+199)/200),
 	 numAssignedColors(0)
 	{
-	/* Allocate the color subsampling arrays: */
-	for(int i=0;i<8;++i)
-		childColorBuffers[i]=new Color[lpo.getMaxNumPointsPerNode()];
-	
+	{
 	/* Write the color file's header: */
+	LidarFile colorFile(colorFileName,LidarFile::ReadWrite);
 	colorFile.setEndianness(Misc::LittleEndian);
 	LidarDataFileHeader dfh((unsigned int)(colorDataSize));
 	dfh.write(colorFile);
+	}
+	
+	/* Reopen the color file for positional reads and writes: */
+	colorFd=open(colorFileName,O_RDWR);
+	if(colorFd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot open color file %s",colorFileName);
 	
 	/* Register all images in the image list: */
 	for(std::vector<Image2D*>::const_iterator iIt=images.begin();iIt!=images.end();++iIt)
-		imageCacher.registerImage(*iIt);
+		tileCache.registerImage(*iIt);
 	}
 
 NodeColorSampler::~NodeColorSampler(void)
 	{
-	delete[] colorBuffer;
-	for(int i=0;i<8;++i)
-		delete[] childColorBuffers[i];
+	close(colorFd);
+	for(std::vector<Buffers*>::iterator bIt=idleBuffers.begin();bIt!=idleBuffers.end();++bIt)
+		{
+		delete[] (*bIt)->colorBuffer;
+		for(int i=0;i<8;++i)
+			delete[] (*bIt)->childColorBuffers[i];
+		delete *bIt;
+		}
 	}
 
 namespace {
@@ -456,8 +859,12 @@ class NodePointFinder // Class to find a point inside an octree node
 
 }
 
-void NodeColorSampler::operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
+size_t NodeColorSampler::colorizeNode(LidarProcessOctree::Node& node,NodeColorSampler::Buffers& buffers)
 	{
+	Color* colorBuffer=buffers.colorBuffer;
+	Color** childColorBuffers=buffers.childColorBuffers;
+	size_t nodeNumAssignedColors=0;
+	
 	if(node.isLeaf())
 		{
 		if(node.getNumPoints()>0)
@@ -472,8 +879,31 @@ void NodeColorSampler::operator()(LidarProcessOctree::Node& node,unsigned int no
 					nodeImages.push_back(*iIt);
 				}
 			
-			/* Page in all found images: */
-			imageCacher.requestImages(nodeImages);
+			/* Estimate the node's point spacing; leaf nodes have no subsampling detail size: */
+			double pointSpacing=double(node.getDetailSize());
+			if(pointSpacing==0.0)
+				pointSpacing=double(node.getDomain().getMax()[0]-node.getDomain().getMin()[0])/Math::sqrt(double(node.getNumPoints()));
+			
+			/* Page in the tiles of all found images that overlap this node, at the pyramid levels matching the node's point spacing: */
+			Image2D::Box nodeBox;
+			for(int i=0;i<2;++i)
+				{
+				nodeBox.min[i]=double(node.getDomain().getMin()[i])+lpo.getOffset()[i];
+				nodeBox.max[i]=double(node.getDomain().getMax()[i])+lpo.getOffset()[i];
+				}
+			std::vector<unsigned int> nodeImageLevels;
+			std::vector<size_t> tileIndices;
+			std::vector<TileCache::TileRef> nodeTiles;
+			for(std::vector<Image2D*>::iterator iIt=nodeImages.begin();iIt!=nodeImages.end();++iIt)
+				{
+				unsigned int level=(*iIt)->selectLevel(pointSpacing);
+				nodeImageLevels.push_back(level);
+				tileIndices.clear();
+				(*iIt)->getTiles(level,nodeBox,tileIndices);
+				for(std::vector<size_t>::iterator tiIt=tileIndices.begin();tiIt!=tileIndices.end();++tiIt)
+					nodeTiles.push_back(TileCache::TileRef(*iIt,*tiIt));
+				}
+			tileCache.requestTiles(nodeTiles);
 			
 			/* Assign a color to each LiDAR point in this node: */
 			for(unsigned int i=0;i<node.getNumPoints();++i)
@@ -515,12 +945,12 @@ void NodeColorSampler::operator()(LidarProcessOctree::Node& node,unsigned int no
 						}
 					colorBuffer[i][3]=Color::Scalar(255);
 					
-					++numAssignedColors;
+					++nodeNumAssignedColors;
 					}
 				else
-				for(std::vector<Image2D*>::iterator iIt=nodeImages.begin();iIt!=nodeImages.end();++iIt)
+				for(size_t imageIndex=0;imageIndex<nodeImages.size();++imageIndex)
 					{
-					Image2D::SampleResult sr=(*iIt)->getColor(Image2D::Point(pos.getComponents()));
+					Image2D::SampleResult sr=nodeImages[imageIndex]->getColor(Image2D::Point(pos.getComponents()),nodeImageLevels[imageIndex]);
 					if(sr.first)
 						{
 						/* Copy the sample result: */
@@ -528,26 +958,27 @@ void NodeColorSampler::operator()(LidarProcessOctree::Node& node,unsigned int no
 							colorBuffer[i][j]=sr.second[j];
 						colorBuffer[i][3]=Color::Scalar(255);
 						
-						++numAssignedColors;
+						++nodeNumAssignedColors;
 						
 						/* Bail out: */
 						break;
 						}
 					}
 				}
+			
+			/* Release the node's tiles: */
+			tileCache.releaseTiles(nodeTiles);
 			}
 		}
 	else
 		{
 		/* Get pointers to the node's children and load their color arrays: */
-		colorFile.flush();
 		for(int childIndex=0;childIndex<8;++childIndex)
 			{
 			LidarProcessOctree::Node* child=lpo.getChild(&node,childIndex);
 			if(child->getNumPoints()>0)
 				{
-				colorFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+colorDataSize*child->getDataOffset());
-				colorFile.read(childColorBuffers[childIndex],child->getNumPoints());
+				readColors(childColorBuffers[childIndex],child->getDataOffset(),child->getNumPoints());
 				}
 			}
 		
@@ -573,10 +1004,33 @@ void NodeColorSampler::operator()(LidarProcessOctree::Node& node,unsigned int no
 		}
 	
 	/* Write the node's colors to the color file: */
-	colorFile.setWritePosAbs(LidarDataFileHeader::getFileSize()+colorDataSize*node.getDataOffset());
-	colorFile.write(colorBuffer,node.getNumPoints());
+	writeColors(colorBuffer,node.getDataOffset(),node.getNumPoints());
+	
+	return nodeNumAssignedColors;
+	}
+
+void NodeColorSampler::operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
+	{
+	/* Colorize the node using a set of scratch buffers: */
+	Buffers* buffers=acquireBuffers();
+	size_t nodeNumAssignedColors=0;
+	std::string nodeErrorMessage;
+	try
+		{
+		nodeNumAssignedColors=colorizeNode(node,*buffers);
+		}
+	catch(const std::runtime_error& err)
+		{
+		/* Parallel traversals do not allow exceptions; remember the error instead: */
+		nodeErrorMessage=err.what();
+		}
+	releaseBuffers(buffers);
 	
 	/* Update the progress counter: */
+	Threads::Mutex::Lock statusLock(statusMutex);
+	numAssignedColors+=nodeNumAssignedColors;
+	if(errorMessage.empty())
+		errorMessage=nodeErrorMessage;
 	++numProcessedNodes;
 	if(numProcessedNodes>=nextProgressUpdate)
 		{
@@ -591,6 +1045,8 @@ int main(int argc,char* argv[])
 	const char* lidarFileName=0;
 	size_t octreeCacheSize=512;
 	size_t imageCacheSize=512;
+	unsigned int tileSize=256;
+	unsigned int numThreads=1;
 	const char* colorFileName=0;
 	std::vector<Image2D*> images;
 	for(int i=1;i<argc;++i)
@@ -607,6 +1063,16 @@ int main(int argc,char* argv[])
 				++i;
 				imageCacheSize=size_t(atoi(argv[i]));
 				}
+			else if(strcasecmp(argv[i]+1,"tileSize")==0)
+				{
+				++i;
+				tileSize=(unsigned int)atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"threads")==0)
+				{
+				++i;
+				numThreads=(unsigned int)atoi(argv[i]);
+				}
 			}
 		else if(lidarFileName==0)
 			lidarFileName=argv[i];
@@ -615,7 +1081,7 @@ int main(int argc,char* argv[])
 		else
 			{
 			/* Load an image: */
-			Image2D* newImage=new Image2D(argv[i]);
+			Image2D* newImage=new Image2D(argv[i],tileSize);
 			images.push_back(newImage);
 			}
 		}
@@ -634,6 +1100,7 @@ int main(int argc,char* argv[])
 	
 	/* Create a processing octree: */
 	LidarProcessOctree lpo(lidarFileName,octreeCacheSize*size_t(1024*1024));
+	lpo.startPrefetching();
 	std::cout<<"LiDAR coordinate offset: "<<lpo.getOffset()[0]<<", "<<lpo.getOffset()[1]<<", "<<lpo.getOffset()[2]<<std::endl;
 	
 	/* Assign colors to all points in the octree: */
@@ -642,10 +1109,18 @@ int main(int argc,char* argv[])
 	lidarColorFileName.append(colorFileName);
 	NodeColorSampler nodeColorSampler(lpo,images,imageCacheSize*size_t(1024*1024),lidarColorFileName.c_str());
 	std::cout<<"Assigning colors...   0%"<<std::flush;
-	lpo.processNodesPostfix(nodeColorSampler);
+	if(numThreads>1)
+		lpo.processNodesPostfixParallel(nodeColorSampler,numThreads);
+	else
+		lpo.processNodesPostfix(nodeColorSampler);
 	std::cout<<std::endl;
+	if(!nodeColorSampler.getErrorMessage().empty())
+		{
+		std::cerr<<"Error while assigning colors: "<<nodeColorSampler.getErrorMessage()<<std::endl;
+		return 1;
+		}
 	std::cout<<nodeColorSampler.getNumAssignedColors()<<" LiDAR points re-colored"<<std::endl;
-	std::cout<<nodeColorSampler.getImageCacher().getNumPageInRequests()<<" images paged into main memory during processing"<<std::endl;
+	std::cout<<nodeColorSampler.getTileCache().getNumTileLoads()<<" image tiles paged into main memory during processing"<<std::endl;
 	
 	/* Delete all images: */
 	for(std::vector<Image2D*>::iterator iIt=images.begin();iIt!=images.end();++iIt)
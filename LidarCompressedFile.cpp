@@ -0,0 +1,171 @@
+/***********************************************************************
+LidarCompressedFile - Classes to write and read LiDAR point or ancillary
+data files storing each octree node's records as a separate
+zlib-compressed block.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarCompressedFile.h"
+
+#include <zlib.h>
+#include <Misc/SelfDestructArray.h>
+#include <Misc/StdError.h>
+
+/************************************
+Methods of class LidarCompressedFile:
+************************************/
+
+LidarCompressedFile::LidarCompressedFile(LidarSourceFile& file)
+	:recordSize(0),numBlocks(0),blocks(0)
+	{
+	#if __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+	/* Compressed blocks contain little-endian records, which are decompressed in place: */
+	throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot read little-endian compressed file on big-endian host");
+	#endif
+	
+	/* Read the data file header: */
+	file.setReadPosAbs(0);
+	LidarDataFileHeader dfh(file);
+	if(!isCompressed(dfh.recordSize))
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Data file is not compressed");
+	recordSize=getRecordSize(dfh.recordSize);
+	
+	/* Read the block table: */
+	Misc::UInt64 tableOffset=file.read<Misc::UInt64>();
+	file.setReadPosAbs(LidarFile::Offset(tableOffset));
+	numBlocks=size_t(file.read<Misc::UInt64>());
+	blocks=new Block[numBlocks+1];
+	for(size_t i=0;i<=numBlocks;++i)
+		{
+		blocks[i].dataOffset=file.read<Misc::UInt64>();
+		blocks[i].fileOffset=file.read<Misc::UInt64>();
+		}
+	}
+
+LidarCompressedFile::~LidarCompressedFile(void)
+	{
+	delete[] blocks;
+	}
+
+void LidarCompressedFile::readRecords(LidarSourceFile& file,LidarFile::Offset dataOffset,unsigned int numRecords,void* records) const
+	{
+	/* Empty nodes do not have blocks, and share their data offset with the next node: */
+	if(numRecords==0)
+		return;
+	
+	/* Find the block starting at the given data offset via binary search: */
+	size_t l=0;
+	size_t r=numBlocks;
+	while(r-l>1)
+		{
+		size_t m=(l+r)>>1;
+		if(blocks[m].dataOffset<=Misc::UInt64(dataOffset))
+			l=m;
+		else
+			r=m;
+		}
+	if(numBlocks==0||blocks[l].dataOffset!=Misc::UInt64(dataOffset))
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No compressed block at data offset %llu",(unsigned long long)dataOffset);
+	if(blocks[l+1].dataOffset-blocks[l].dataOffset!=Misc::UInt64(numRecords))
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Compressed block at data offset %llu does not contain %u records",(unsigned long long)dataOffset,numRecords);
+	
+	/* Read the compressed block: */
+	size_t compressedSize=size_t(blocks[l+1].fileOffset-blocks[l].fileOffset);
+	Misc::SelfDestructArray<Bytef> compressed(compressedSize);
+	file.setReadPosAbs(LidarFile::Offset(blocks[l].fileOffset));
+	file.readRaw(compressed.getArray(),compressedSize);
+	
+	/* Decompress the block directly into the record array: */
+	uLongf uncompressedSize=uLongf(numRecords)*uLongf(recordSize);
+	uLongf expectedSize=uncompressedSize;
+	if(uncompress(static_cast<Bytef*>(records),&uncompressedSize,compressed.getArray(),uLong(compressedSize))!=Z_OK||uncompressedSize!=expectedSize)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Corrupted compressed block at data offset %llu",(unsigned long long)dataOffset);
+	}
+
+/******************************************
+Methods of class LidarCompressedFileWriter:
+******************************************/
+
+LidarCompressedFileWriter::LidarCompressedFileWriter(LidarFile& sFile,unsigned int sRecordSize,int sCompressionLevel)
+	:file(sFile),recordSize(sRecordSize),compressionLevel(sCompressionLevel),
+	 blockDataOffset(0),dataEnd(0)
+	{
+	#if __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+	throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot write little-endian compressed file on big-endian host");
+	#endif
+	
+	/* Write the data file header and a placeholder for the block table offset: */
+	LidarDataFileHeader dfh(recordSize|LidarCompressedFile::compressedFlag);
+	dfh.write(file);
+	tableOffsetPos=file.getWritePos();
+	file.write(Misc::UInt64(0));
+	}
+
+void LidarCompressedFileWriter::beginBlock(LidarFile::Offset dataOffset)
+	{
+	if(Misc::UInt64(dataOffset)<dataEnd)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Block data offset %llu out of order",(unsigned long long)dataOffset);
+	
+	blockDataOffset=Misc::UInt64(dataOffset);
+	blockBuffer.clear();
+	}
+
+void LidarCompressedFileWriter::endBlock(void)
+	{
+	if(blockBuffer.size()%recordSize!=0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Block does not contain an integral number of records");
+	
+	/* Empty blocks are not stored: */
+	if(blockBuffer.empty())
+		return;
+	
+	/* Compress the block: */
+	uLongf compressedSize=compressBound(uLong(blockBuffer.size()));
+	compressBuffer.resize(compressedSize);
+	if(compress2(&compressBuffer[0],&compressedSize,&blockBuffer[0],uLong(blockBuffer.size()),compressionLevel)!=Z_OK)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to compress block at data offset %llu",(unsigned long long)blockDataOffset);
+	
+	/* Write the compressed block and remember its position: */
+	LidarCompressedFile::Block block;
+	block.dataOffset=blockDataOffset;
+	block.fileOffset=Misc::UInt64(file.getWritePos());
+	blocks.push_back(block);
+	file.writeRaw(&compressBuffer[0],compressedSize);
+	dataEnd=blockDataOffset+Misc::UInt64(blockBuffer.size()/recordSize);
+	}
+
+void LidarCompressedFileWriter::finish(void)
+	{
+	/* Write the block table: */
+	Misc::UInt64 tableOffset=Misc::UInt64(file.getWritePos());
+	file.write(Misc::UInt64(blocks.size()));
+	for(std::vector<LidarCompressedFile::Block>::const_iterator bIt=blocks.begin();bIt!=blocks.end();++bIt)
+		{
+		file.write(bIt->dataOffset);
+		file.write(bIt->fileOffset);
+		}
+	file.write(dataEnd);
+	file.write(tableOffset);
+	
+	/* Patch the block table offset: */
+	file.setWritePosAbs(tableOffsetPos);
+	file.write(tableOffset);
+	file.flush();
+	}
@@ -0,0 +1,120 @@
+/***********************************************************************
+LidarCompressedFile - Classes to write and read LiDAR point or ancillary
+data files storing each octree node's records as a separate
+zlib-compressed block.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARCOMPRESSEDFILE_INCLUDED
+#define LIDARCOMPRESSEDFILE_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+
+#include "LidarFile.h"
+
+/***********************************************************************
+Compressed data files are identified by the compressedFlag bit in their
+LidarDataFileHeader's record size; the remaining bits hold the size of
+the uncompressed records. The header is followed by the 64-bit file
+offset of the block table, the compressed blocks, and the block table,
+which consists of the 64-bit number of blocks and one (data offset, file
+offset) pair of 64-bit values for each block plus a final pair marking
+the end of the last block. Blocks are stored in increasing data offset
+order, and contain records in little-endian byte order.
+***********************************************************************/
+
+class LidarCompressedFile // Class to read octree nodes' records from compressed data files
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int compressedFlag=0x80000000U; // Flag bit in a data file header's record size marking a compressed data file
+	
+	struct Block // Structure describing one compressed block in a data file
+		{
+		/* Elements: */
+		public:
+		Misc::UInt64 dataOffset; // Data offset of the block's first record, in units of records
+		Misc::UInt64 fileOffset; // Position of the block's compressed data in the data file
+		};
+	
+	/* Elements: */
+	private:
+	unsigned int recordSize; // Size of uncompressed records in bytes
+	size_t numBlocks; // Number of compressed blocks in the data file
+	Block* blocks; // Array of block descriptors, with an additional descriptor marking the end of the last block
+	
+	/* Constructors and destructors: */
+	public:
+	LidarCompressedFile(LidarSourceFile& file); // Reads the block table of the given compressed data file; changes the file's read position
+	private:
+	LidarCompressedFile(const LidarCompressedFile& source); // Prohibit copy constructor
+	LidarCompressedFile& operator=(const LidarCompressedFile& source); // Prohibit assignment operator
+	public:
+	~LidarCompressedFile(void);
+	
+	/* Methods: */
+	static bool isCompressed(unsigned int headerRecordSize) // Returns true if the given data file header record size denotes a compressed data file
+		{
+		return (headerRecordSize&compressedFlag)!=0x0U;
+		}
+	static unsigned int getRecordSize(unsigned int headerRecordSize) // Returns the size of uncompressed records for the given data file header record size
+		{
+		return headerRecordSize&~compressedFlag;
+		}
+	unsigned int getRecordSize(void) const // Returns the size of uncompressed records in bytes
+		{
+		return recordSize;
+		}
+	void readRecords(LidarSourceFile& file,LidarFile::Offset dataOffset,unsigned int numRecords,void* records) const; // Reads and decompresses the block starting at the given data offset from the given handle to the data file, or does nothing for zero records; thread-safe if each thread uses its own file handle
+	};
+
+class LidarCompressedFileWriter // Class to write octree nodes' records to compressed data files
+	{
+	/* Elements: */
+	private:
+	LidarFile& file; // The data file being written
+	unsigned int recordSize; // Size of uncompressed records in bytes
+	int compressionLevel; // zlib compression level
+	LidarFile::Offset tableOffsetPos; // Position of the block table offset in the data file
+	std::vector<LidarCompressedFile::Block> blocks; // List of blocks written so far
+	std::vector<unsigned char> blockBuffer; // Buffer accumulating the uncompressed records of the current block
+	std::vector<unsigned char> compressBuffer; // Buffer to hold the compressed data of the current block
+	Misc::UInt64 blockDataOffset; // Data offset of the current block
+	Misc::UInt64 dataEnd; // Data offset one record past the end of the last written block
+	
+	/* Constructors and destructors: */
+	public:
+	LidarCompressedFileWriter(LidarFile& sFile,unsigned int sRecordSize,int sCompressionLevel =6); // Writes the data file header to the given empty data file
+	
+	/* Methods: */
+	void beginBlock(LidarFile::Offset dataOffset); // Starts a new block at the given data offset, which must be larger than that of all previous blocks
+	template <class RecordParam>
+	void write(const RecordParam* records,size_t numRecords) // Appends records to the current block
+		{
+		const unsigned char* bytes=reinterpret_cast<const unsigned char*>(records);
+		blockBuffer.insert(blockBuffer.end(),bytes,bytes+numRecords*sizeof(RecordParam));
+		}
+	void endBlock(void); // Compresses and writes the current block
+	void finish(void); // Writes the block table after the last block
+	};
+
+#endif
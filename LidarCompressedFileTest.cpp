@@ -0,0 +1,128 @@
+/***********************************************************************
+LidarCompressedFileTest - Test program for reading octree nodes,
+including empty nodes, from compressed data files.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include <unistd.h>
+#include <stdexcept>
+#include <iostream>
+#include <vector>
+
+#include "LidarTypes.h"
+#include "LidarFile.h"
+#include "LidarCompressedFile.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+LidarPoint makePoint(unsigned int nodeIndex,unsigned int pointIndex) // Returns a recognizable point for the given node
+	{
+	LidarPoint result;
+	for(int i=0;i<3;++i)
+		result[i]=Scalar(nodeIndex*100+pointIndex*10+i);
+	result.value=Color(Color::Scalar(nodeIndex),Color::Scalar(pointIndex),Color::Scalar(0));
+	return result;
+	}
+
+bool isEqual(const LidarPoint& p1,const LidarPoint& p2) // Returns true if the two points have the same position and color
+	{
+	for(int i=0;i<3;++i)
+		if(p1[i]!=p2[i])
+			return false;
+	for(int i=0;i<4;++i)
+		if(p1.value[i]!=p2.value[i])
+			return false;
+	return true;
+	}
+
+void writeNodes(const char* fileName,unsigned int numNodes,const unsigned int numNodePoints[],LidarFile::Offset dataOffsets[]) // Writes nodes' points to a compressed data file the way LidarOctreeCreator does, where an empty node gets the data offset of the following node and no block
+	{
+	LidarFile pointsFile(fileName,IO::File::WriteOnly);
+	pointsFile.setEndianness(Misc::LittleEndian);
+	LidarCompressedFileWriter writer(pointsFile,(unsigned int)(sizeof(LidarPoint)));
+	LidarFile::Offset nextDataOffset=0;
+	for(unsigned int i=0;i<numNodes;++i)
+		{
+		std::vector<LidarPoint> points;
+		for(unsigned int j=0;j<numNodePoints[i];++j)
+			points.push_back(makePoint(i,j));
+		dataOffsets[i]=nextDataOffset;
+		nextDataOffset+=LidarFile::Offset(numNodePoints[i]);
+		writer.beginBlock(dataOffsets[i]);
+		if(!points.empty())
+			writer.write(&points[0],points.size());
+		writer.endBlock();
+		}
+	writer.finish();
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parse the command line: */
+	const char* fileName="LidarCompressedFileTest.points";
+	if(argc>1)
+		fileName=argv[1];
+	
+	/* Number of points in a parent node and its eight children, several of which are empty octants: */
+	static const unsigned int numNodes=9;
+	static const unsigned int numNodePoints[numNodes]={5,0,3,0,0,7,1,0,0};
+	
+	int result=0;
+	try
+		{
+		/* Write the nodes' points: */
+		LidarFile::Offset dataOffsets[numNodes];
+		writeNodes(fileName,numNodes,numNodePoints,dataOffsets);
+		
+		/* Read all nodes back, including the empty ones: */
+		LidarFile readFile(fileName,IO::File::ReadOnly);
+		readFile.setEndianness(Misc::LittleEndian);
+		LidarCompressedFile compressedPoints(readFile);
+		for(unsigned int i=0;i<numNodes;++i)
+			{
+			std::vector<LidarPoint> points(numNodePoints[i]+1);
+			compressedPoints.readRecords(readFile,dataOffsets[i],numNodePoints[i],&points[0]);
+			for(unsigned int j=0;j<numNodePoints[i];++j)
+				if(!isEqual(points[j],makePoint(i,j)))
+					{
+					std::cerr<<"Point "<<j<<" of node "<<i<<" was not read back correctly"<<std::endl;
+					result=1;
+					}
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Compressed data file test failed due to exception "<<err.what()<<std::endl;
+		result=1;
+		}
+	
+	/* Clean up: */
+	unlink(fileName);
+	if(result==0)
+		std::cout<<"Compressed data file test passed"<<std::endl;
+	
+	return result;
+	}
@@ -0,0 +1,106 @@
+/***********************************************************************
+LidarDataBlock - Class to read the records of several octree nodes that
+are stored contiguously in a LiDAR data file in a single request.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARDATABLOCK_INCLUDED
+#define LIDARDATABLOCK_INCLUDED
+
+#include <stddef.h>
+
+#include "LidarFile.h"
+
+struct LidarDataRange // Structure for a contiguous range of records in a LiDAR data file
+	{
+	/* Elements: */
+	public:
+	LidarFile::Offset first; // Index of the first record in the range
+	LidarFile::Offset end; // Index one past the last record in the range
+	
+	/* Constructors and destructors: */
+	LidarDataRange(void) // Creates an empty range
+		:first(0),end(0)
+		{
+		}
+	
+	/* Methods: */
+	bool append(LidarFile::Offset dataOffset,unsigned int numRecords) // Appends the given records to the range; returns false if they do not directly follow the range
+		{
+		/* Nodes without records do not break up a range: */
+		if(numRecords==0)
+			return true;
+		
+		if(first==end)
+			first=dataOffset;
+		else if(dataOffset!=end)
+			return false;
+		end=dataOffset+LidarFile::Offset(numRecords);
+		return true;
+		}
+	size_t getNumRecords(void) const // Returns the number of records in the range
+		{
+		return size_t(end-first);
+		}
+	};
+
+template <class RecordParam>
+class LidarDataBlock
+	{
+	/* Elements: */
+	private:
+	LidarFile::Offset firstRecord; // Index of the first record in the block
+	RecordParam* records; // Array of records read from the data file, or 0
+	
+	/* Constructors and destructors: */
+	public:
+	LidarDataBlock(void) // Creates an empty block
+		:firstRecord(0),records(0)
+		{
+		}
+	private:
+	LidarDataBlock(const LidarDataBlock& source); // Prohibit copy constructor
+	LidarDataBlock& operator=(const LidarDataBlock& source); // Prohibit assignment operator
+	public:
+	~LidarDataBlock(void)
+		{
+		delete[] records;
+		}
+	
+	/* Methods: */
+	void read(LidarSourceFile& file,LidarFile::Offset recordSize,const LidarDataRange& range) // Reads the given range of records from the given data file with the given record size in a single read
+		{
+		delete[] records;
+		firstRecord=range.first;
+		records=new RecordParam[range.getNumRecords()];
+		file.setReadPosAbs(LidarFile::Offset(LidarDataFileHeader::getFileSize())+recordSize*range.first);
+		file.read(records,range.getNumRecords());
+		}
+	bool isValid(void) const // Returns true if the block contains records
+		{
+		return records!=0;
+		}
+	const RecordParam* getRecords(LidarFile::Offset dataOffset) const // Returns a pointer to the record of the given index inside the block
+		{
+		return records+(dataOffset-firstRecord);
+		}
+	};
+
+#endif
@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarElevationSampler - Functor class to evaluate the implicit elevation
 function of a 2.5D LiDAR point cloud.
-Copyright (c) 2009-2010 Oliver Kreylos
+Copyright (c) 2009-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,32 +24,39 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef LIDARELEVATIONSAMPLER_INCLUDED
 #define LIDARELEVATIONSAMPLER_INCLUDED
 
+#include <stddef.h>
 #include <Math/Math.h>
-#include <Math/Constants.h>
 
 #include "LidarTypes.h"
+#include "LanczosKernel.h"
 
 class LidarSeparableElevationSampler // Sampler using a separable Lanczos filter for Cartesian grid generation
 	{
+	/* Embedded classes: */
+	public:
+	static const size_t batchSize=64; // Number of points whose filter weights are evaluated together
+	
 	/* Elements: */
 	private:
+	const LanczosKernel& kernel; // Tabulated Lanczos reconstruction filter
 	double pos[2]; // Sample point's (x, y) position
 	double filterSize[2]; // Filter size, or cell size of target grid, in x and y
-	double numLobes; // Number of lobes in Lanczos reconstruction filter
+	double invFilterSize[2]; // Reciprocal filter size in x and y
 	double accumulator; // Accumulated convolution between point cloud and filter
 	double weightSum; // Sum of weights for all accumulated points
 	double absWeightSum; // Sum of absolute weights for all accumulated points
 	
 	/* Constructors and destructors: */
 	public:
-	LidarSeparableElevationSampler(const double sPos[2],const double sFilterSize[2],int sNumLobes) // Creates an empty sampler
-		:numLobes(double(sNumLobes)),
+	LidarSeparableElevationSampler(const double sPos[2],const double sFilterSize[2],const LanczosKernel& sKernel) // Creates an empty sampler using the given filter kernel, which must outlive the sampler
+		:kernel(sKernel),
 		 accumulator(0.0),weightSum(0.0),absWeightSum(0.0)
 		{
 		for(int i=0;i<2;++i)
 			{
 			pos[i]=sPos[i];
 			filterSize[i]=sFilterSize[i];
+			invFilterSize[i]=1.0/filterSize[i];
 			}
 		}
 	
@@ -57,6 +64,7 @@ class LidarSeparableElevationSampler // Sampler using a separable Lanczos filter
 	Box getBox(void) const
 		{
 		Box result;
+		double numLobes=double(kernel.getNumLobes());
 		for(int i=0;i<2;++i)
 			{
 			result.min[i]=pos[i]-filterSize[i]*numLobes;
@@ -69,23 +77,40 @@ class LidarSeparableElevationSampler // Sampler using a separable Lanczos filter
 	void operator()(const LidarPoint& p)
 		{
 		/* Calculate the Lanczos filter weight for the LiDAR point: */
-		double weight=1.0;
-		for(int i=0;i<2;++i)
-			{
-			double x=Math::Constants<double>::pi*(double(p[i])-pos[i])/filterSize[i];
-			if(x!=0.0)
-				{
-				weight*=Math::sin(x)/x;
-				x/=numLobes;
-				weight*=Math::sin(x)/x;
-				}
-			}
+		double weight=kernel((double(p[0])-pos[0])*invFilterSize[0])*kernel((double(p[1])-pos[1])*invFilterSize[1]);
 		
 		/* Accumulate the weighted point: */
 		accumulator+=double(p[2])*weight;
 		weightSum+=weight;
 		absWeightSum+=Math::abs(weight);
 		}
+	void operator()(const LidarPoint* points,size_t numPoints) // Accumulates an array of LiDAR points, as passed by batched octree traversals
+		{
+		double tx[batchSize],ty[batchSize],wx[batchSize],wy[batchSize];
+		for(size_t first=0;first<numPoints;first+=batchSize)
+			{
+			size_t n=numPoints-first<batchSize?numPoints-first:batchSize;
+			const LidarPoint* ps=points+first;
+			
+			/* Calculate the Lanczos filter weights for the batch's points: */
+			for(size_t i=0;i<n;++i)
+				{
+				tx[i]=(double(ps[i][0])-pos[0])*invFilterSize[0];
+				ty[i]=(double(ps[i][1])-pos[1])*invFilterSize[1];
+				}
+			kernel.evaluate(tx,wx,n);
+			kernel.evaluate(ty,wy,n);
+			
+			/* Accumulate the weighted points: */
+			for(size_t i=0;i<n;++i)
+				{
+				double weight=wx[i]*wy[i];
+				accumulator+=double(ps[i][2])*weight;
+				weightSum+=weight;
+				absWeightSum+=Math::abs(weight);
+				}
+			}
+		}
 	double getWeightSum(void) const // Returns the sum of point weights
 		{
 		return weightSum;
@@ -103,20 +128,25 @@ class LidarSeparableElevationSampler // Sampler using a separable Lanczos filter
 
 class LidarRadialElevationSampler // Sampler using a radial Lanczos filter
 	{
+	/* Embedded classes: */
+	public:
+	static const size_t batchSize=64; // Number of points whose filter weights are evaluated together
+	
 	/* Elements: */
 	private:
+	const LanczosKernel& kernel; // Tabulated Lanczos reconstruction filter
 	double pos[2]; // Sample point's (x, y) position
 	double filterRadius; // Filter radius
-	double numLobes; // Number of lobes in Lanczos reconstruction filter
-	double maxRadius2; // Squared maximum radius of Lanczos reconstruction filter
+	double invFilterRadius2; // Reciprocal squared filter radius
 	double accumulator; // Accumulated convolution between point cloud and filter
 	double weightSum; // Sum of weights for all accumulated points
 	double absWeightSum; // Sum of absolute weights for all accumulated points
 	
 	/* Constructors and destructors: */
 	public:
-	LidarRadialElevationSampler(const double sPos[2],double sFilterRadius,int sNumLobes) // Creates an empty sampler
-		:filterRadius(sFilterRadius),numLobes(double(sNumLobes)),maxRadius2(Math::sqr(filterRadius*numLobes)),
+	LidarRadialElevationSampler(const double sPos[2],double sFilterRadius,const LanczosKernel& sKernel) // Creates an empty sampler using the given filter kernel, which must outlive the sampler
+		:kernel(sKernel),
+		 filterRadius(sFilterRadius),invFilterRadius2(1.0/Math::sqr(filterRadius)),
 		 accumulator(0.0),weightSum(0.0),absWeightSum(0.0)
 		{
 		for(int i=0;i<2;++i)
@@ -127,6 +157,7 @@ class LidarRadialElevationSampler // Sampler using a radial Lanczos filter
 	Box getBox(void) const
 		{
 		Box result;
+		double numLobes=double(kernel.getNumLobes());
 		for(int i=0;i<2;++i)
 			{
 			result.min[i]=pos[i]-filterRadius*numLobes;
@@ -138,23 +169,34 @@ class LidarRadialElevationSampler // Sampler using a radial Lanczos filter
 		}
 	void operator()(const LidarPoint& p)
 		{
-		double r=Math::sqr(double(p[0])-pos[0])+Math::sqr(double(p[1])-pos[1]);
-		if(r<maxRadius2)
+		/* Calculate the Lanczos filter weight for the LiDAR point from its squared distance; points outside the filter's support get zero weight: */
+		double weight=kernel.evaluateSquared((Math::sqr(double(p[0])-pos[0])+Math::sqr(double(p[1])-pos[1]))*invFilterRadius2);
+		
+		/* Accumulate the weighted point: */
+		accumulator+=double(p[2])*weight;
+		weightSum+=weight;
+		absWeightSum+=Math::abs(weight);
+		}
+	void operator()(const LidarPoint* points,size_t numPoints) // Accumulates an array of LiDAR points, as passed by batched octree traversals
+		{
+		double t2[batchSize],w[batchSize];
+		for(size_t first=0;first<numPoints;first+=batchSize)
 			{
-			/* Calculate the Lanczos filter weight for the LiDAR point: */
-			r=Math::Constants<double>::pi*Math::sqrt(r)/filterRadius;
-			double weight=1.0;
-			if(r!=0.0)
+			size_t n=numPoints-first<batchSize?numPoints-first:batchSize;
+			const LidarPoint* ps=points+first;
+			
+			/* Calculate the Lanczos filter weights for the batch's points: */
+			for(size_t i=0;i<n;++i)
+				t2[i]=(Math::sqr(double(ps[i][0])-pos[0])+Math::sqr(double(ps[i][1])-pos[1]))*invFilterRadius2;
+			kernel.evaluateSquared(t2,w,n);
+			
+			/* Accumulate the weighted points: */
+			for(size_t i=0;i<n;++i)
 				{
-				weight*=Math::sin(r)/r;
-				r/=numLobes;
-				weight*=Math::sin(r)/r;
+				accumulator+=double(ps[i][2])*w[i];
+				weightSum+=w[i];
+				absWeightSum+=Math::abs(w[i]);
 				}
-			
-			/* Accumulate the weighted point: */
-			accumulator+=double(p[2])*weight;
-			weightSum+=weight;
-			absWeightSum+=Math::abs(weight);
 			}
 		}
 	double getWeightSum(void) const // Returns the sum of point weights
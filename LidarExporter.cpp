@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarExporter - Utility to export points from LiDAR files to ASCII files
 in xyzrgb format.
-Copyright (c) 2010-2023 Oliver Kreylos
+Copyright (c) 2010-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,203 +24,543 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include <iostream>
-#include <Misc/File.h>
+#include <stdexcept>
+#include <Misc/Endianness.h>
+#include <Misc/FileNameExtensions.h>
+#include <Threads/Mutex.h>
 #include <IO/SeekableFile.h>
 #include <IO/OpenFile.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
 
 #include "LidarTypes.h"
 #include "LidarProcessOctree.h"
 
-class PointSaver
+/****************
+Helper functions:
+****************/
+
+inline char* formatUnsigned(unsigned long long value,char* buffer) // Writes the given unsigned integer in decimal notation into the given buffer; returns pointer behind the last written character
+	{
+	/* Generate the digits in reverse order: */
+	char digits[20];
+	char* dPtr=digits;
+	do
+		{
+		*(dPtr++)=char('0'+value%10U);
+		value/=10U;
+		}
+	while(value!=0U);
+	
+	/* Copy the digits in order: */
+	while(dPtr!=digits)
+		*(buffer++)=*(--dPtr);
+	return buffer;
+	}
+
+template <class ValueParam>
+inline char* putLittleEndian(ValueParam value,char* buffer) // Writes the given value into the given buffer in little-endian byte order; returns pointer behind the written value
+	{
+	#if __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+	Misc::swapEndianness(value);
+	#endif
+	memcpy(buffer,&value,sizeof(ValueParam));
+	return buffer+sizeof(ValueParam);
+	}
+
+/*****************************
+Formatters for export formats:
+*****************************/
+
+class AsciiFormat // Formats points as lines of ASCII xyzrgb text
 	{
 	/* Elements: */
+	public:
+	static const size_t maxRecordSize=128; // Upper bound on the size of a formatted point
 	private:
-	LidarProcessOctree::OffsetVector offset;
-	Misc::File resultFile;
-	size_t numPoints;
+	LidarProcessOctree::OffsetVector offset; // Offset from LiDAR coordinates to source coordinates
+	int numDecimals; // Number of fixed-point decimals for point coordinates, or -1 to format coordinates with %.12g
+	double decimalScale; // Scale factor from coordinates to fixed-point integers
+	unsigned long long decimalUnit; // Fixed-point integer representing 1.0
+	
+	/* Private methods: */
+	char* formatCoordinate(double value,char* buffer) const // Writes the given coordinate into the given buffer
+		{
+		if(numDecimals>=0)
+			{
+			/* Round the coordinate's absolute value to a fixed-point integer if it does not overflow: */
+			double scaled=Math::abs(value)*decimalScale+0.5;
+			if(scaled<1.0e19)
+				{
+				unsigned long long fixed=(unsigned long long)(scaled);
+				if(value<0.0&&fixed!=0U)
+					*(buffer++)='-';
+				buffer=formatUnsigned(fixed/decimalUnit,buffer);
+				if(numDecimals>0)
+					{
+					/* Write the fractional digits from right to left: */
+					*(buffer++)='.';
+					unsigned long long fraction=fixed%decimalUnit;
+					for(int i=numDecimals-1;i>=0;--i)
+						{
+						buffer[i]=char('0'+fraction%10U);
+						fraction/=10U;
+						}
+					buffer+=numDecimals;
+					}
+				return buffer;
+				}
+			}
+		
+		return buffer+snprintf(buffer,32,"%.12g",value);
+		}
 	
 	/* Constructors and destructors: */
 	public:
-	PointSaver(const LidarProcessOctree::OffsetVector& sOffset,const char* resultFileName)
+	AsciiFormat(const LidarProcessOctree::OffsetVector& sOffset,int sNumDecimals)
 		:offset(sOffset),
-		 resultFile(resultFileName,"wb"),
-		 numPoints(0)
+		 numDecimals(sNumDecimals<9?sNumDecimals:9),
+		 decimalScale(1.0),decimalUnit(1U)
 		{
+		for(int i=0;i<numDecimals;++i)
+			{
+			decimalScale*=10.0;
+			decimalUnit*=10U;
+			}
 		}
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point)
+	void writeHeader(IO::SeekableFile& file) const // Writes an export file's initial header
+		{
+		}
+	char* formatPoint(const LidarPoint& point,char* buffer) const // Writes the given point into the given buffer; returns pointer behind the last written character
 		{
-		double pos[3];
 		for(int i=0;i<3;++i)
-			pos[i]=double(point[i])+double(offset[i]);
-		fprintf(resultFile.getFilePtr(),"%.12g %.12g %.12g %u %u %u\n",pos[0],pos[1],pos[2],point.value[0],point.value[1],point.value[2]);
-		++numPoints;
+			{
+			buffer=formatCoordinate(double(point[i])+double(offset[i]),buffer);
+			*(buffer++)=' ';
+			}
+		for(int i=0;i<3;++i)
+			{
+			buffer=formatUnsigned(point.value[i],buffer);
+			*(buffer++)=i<2?' ':'\n';
+			}
+		return buffer;
 		}
-	size_t getNumPoints(void) const
+	void finishFile(IO::SeekableFile& file,size_t numPoints,const Box& bbox) const // Updates an export file's header after all points have been written
 		{
-		return numPoints;
 		}
 	};
 
-class BinaryPointSaver
+class BinaryFormat // Formats points as binary records of position and color
 	{
 	/* Elements: */
+	public:
+	static const size_t maxRecordSize=3*sizeof(Scalar)+4*sizeof(Color::Scalar); // Size of a formatted point
 	private:
-	IO::SeekableFilePtr resultFile;
-	size_t numPoints;
+	LidarProcessOctree::OffsetVector offset; // Offset from LiDAR coordinates to source coordinates
 	
 	/* Constructors and destructors: */
 	public:
-	BinaryPointSaver(const LidarProcessOctree::OffsetVector& offset,const char* resultFileName)
-		:resultFile(IO::openSeekableFile(resultFileName,IO::File::WriteOnly)),
-		 numPoints(0)
-		{
-		resultFile->setEndianness(Misc::LittleEndian);
-		
-		/* Write the point offset vector: */
-		resultFile->write(offset.getComponents(),3);
-		
-		/* Write the initial number of points: */
-		resultFile->write<unsigned int>(0);
-		}
-	~BinaryPointSaver(void)
+	BinaryFormat(const LidarProcessOctree::OffsetVector& sOffset)
+		:offset(sOffset)
 		{
-		/* Write the final number of points: */
-		resultFile->setWritePosAbs(3*sizeof(double));
-		resultFile->write<unsigned int>(numPoints);
 		}
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point)
+	void writeHeader(IO::SeekableFile& file) const
 		{
-		/* Write the point: */
-		resultFile->write(point.getComponents(),3);
-		resultFile->write(point.value.getRgba(),4);
+		/* Write the point offset vector: */
+		file.write(offset.getComponents(),3);
 		
-		/* Update the file header: */
-		++numPoints;
+		/* Write the initial number of points: */
+		file.write<unsigned int>(0);
 		}
-	size_t getNumPoints(void) const
+	char* formatPoint(const LidarPoint& point,char* buffer) const
 		{
-		return numPoints;
+		for(int i=0;i<3;++i)
+			buffer=putLittleEndian(point[i],buffer);
+		memcpy(buffer,point.value.getRgba(),4*sizeof(Color::Scalar));
+		return buffer+4*sizeof(Color::Scalar);
+		}
+	void finishFile(IO::SeekableFile& file,size_t numPoints,const Box& bbox) const
+		{
+		/* Write the final number of points: */
+		file.setWritePosAbs(3*sizeof(double));
+		file.write<unsigned int>(numPoints);
 		}
 	};
 
-class LasPointSaver
+class LasFormat // Formats points as LAS point data records
 	{
 	/* Elements: */
+	public:
+	static const size_t maxRecordSize=26; // Size of a point data record of format 2
 	private:
-	IO::SeekableFilePtr lasFile;
-	LidarProcessOctree::OffsetVector lpoOffset;
-	double scale[3],offset[3];
-	double min[3],max[3];
-	size_t numPoints;
+	LidarProcessOctree::OffsetVector lpoOffset; // Offset from LiDAR coordinates to source coordinates
+	double scale[3],offset[3]; // Quantization scale factors and offset vector in LiDAR coordinates
 	
 	/* Constructors and destructors: */
 	public:
-	LasPointSaver(const char* lasFileName,const LidarProcessOctree::OffsetVector& sLpoOffset,const double sScale[3],const double sOffset[3])
-		:lasFile(IO::openSeekableFile(lasFileName,IO::File::WriteOnly)),
-		 lpoOffset(sLpoOffset),
-		 numPoints(0)
+	LasFormat(const LidarProcessOctree::OffsetVector& sLpoOffset,const double sScale[3],const double sOffset[3])
+		:lpoOffset(sLpoOffset)
 		{
 		for(int i=0;i<3;++i)
 			{
 			scale[i]=sScale[i];
 			offset[i]=sOffset[i];
-			min[i]=Math::Constants<double>::max;
-			max[i]=Math::Constants<double>::min;
 			}
-		
+		}
+	
+	/* Methods: */
+	void writeHeader(IO::SeekableFile& file) const
+		{
 		/* Create the initial LAS file header: */
 		char signature[5]="LASF";
-		lasFile->write(signature,4); // LAS signature
-		lasFile->write<unsigned short>(0); // File source ID
-		lasFile->write<unsigned short>(0); // Reserved field
-		lasFile->write<unsigned int>(0); // Project ID
-		lasFile->write<unsigned short>(0); // Project ID
-		lasFile->write<unsigned short>(0); // Project ID
+		file.write(signature,4); // LAS signature
+		file.write<unsigned short>(0); // File source ID
+		file.write<unsigned short>(0); // Reserved field
+		file.write<unsigned int>(0); // Project ID
+		file.write<unsigned short>(0); // Project ID
+		file.write<unsigned short>(0); // Project ID
 		char dummy[32];
 		memset(dummy,0,sizeof(dummy));
-		lasFile->write(dummy,8); // Project ID
-		lasFile->write<unsigned char>(1); // File version number
-		lasFile->write<unsigned char>(2); // File version number
-		lasFile->write(dummy,32); // System identifier
-		lasFile->write(dummy,32); // Generating software
-		lasFile->write<unsigned short>(1); // File creation day of year
-		lasFile->write<unsigned short>(2011); // File creation year
-		lasFile->write<unsigned short>(227); // LAS header size
-		lasFile->write<unsigned int>(227); // Point data offset
-		lasFile->write<unsigned int>(0); // Number of variable-length records
-		lasFile->write<unsigned char>(2); // Point data format
-		lasFile->write<unsigned short>(26); // Point data record length
-		lasFile->write<unsigned int>(0); // Number of point records
-		lasFile->write<unsigned int>(0); // Number of point records by return
-		lasFile->write<unsigned int>(0); // Number of point records by return
-		lasFile->write<unsigned int>(0); // Number of point records by return
-		lasFile->write<unsigned int>(0); // Number of point records by return
-		lasFile->write<unsigned int>(0); // Number of point records by return
-		lasFile->write(scale,3); // Quantization scale factor
+		file.write(dummy,8); // Project ID
+		file.write<unsigned char>(1); // File version number
+		file.write<unsigned char>(2); // File version number
+		file.write(dummy,32); // System identifier
+		file.write(dummy,32); // Generating software
+		file.write<unsigned short>(1); // File creation day of year
+		file.write<unsigned short>(2011); // File creation year
+		file.write<unsigned short>(227); // LAS header size
+		file.write<unsigned int>(227); // Point data offset
+		file.write<unsigned int>(0); // Number of variable-length records
+		file.write<unsigned char>(2); // Point data format
+		file.write<unsigned short>(26); // Point data record length
+		file.write<unsigned int>(0); // Number of point records
+		file.write<unsigned int>(0); // Number of point records by return
+		file.write<unsigned int>(0); // Number of point records by return
+		file.write<unsigned int>(0); // Number of point records by return
+		file.write<unsigned int>(0); // Number of point records by return
+		file.write<unsigned int>(0); // Number of point records by return
+		file.write(scale,3); // Quantization scale factor
 		for(int i=0;i<3;++i) // Quantization offset vector
-			lasFile->write<double>(offset[i]+lpoOffset[i]);
+			file.write<double>(offset[i]+lpoOffset[i]);
 		for(int i=0;i<3;++i) // Point position bounding box
 			{
-			lasFile->write<double>(max[i]);
-			lasFile->write<double>(min[i]);
+			file.write<double>(Math::Constants<double>::min);
+			file.write<double>(Math::Constants<double>::max);
 			}
 		}
-	~LasPointSaver(void)
+	char* formatPoint(const LidarPoint& point,char* buffer) const
+		{
+		/* Quantize the point position: */
+		for(int i=0;i<3;++i)
+			buffer=putLittleEndian(int(Math::floor((double(point[i])-offset[i])/scale[i]+0.5)),buffer);
+		
+		/* Calculate point intensity from RGB color: */
+		unsigned short intensity=((unsigned short)(point.value[0])+(unsigned short)(point.value[1])+(unsigned short)(point.value[2])+1)/3;
+		
+		/* Write the rest of the point record: */
+		buffer=putLittleEndian(intensity,buffer); // Point intensity
+		*(buffer++)=0; // Return data
+		*(buffer++)=0; // Point classification
+		*(buffer++)=0; // Laser angle
+		*(buffer++)=0; // User data
+		buffer=putLittleEndian((unsigned short)(0),buffer); // Source
+		for(int i=0;i<3;++i) // Point color
+			buffer=putLittleEndian((unsigned short)(point.value[i]),buffer);
+		return buffer;
+		}
+	void finishFile(IO::SeekableFile& file,size_t numPoints,const Box& bbox) const
 		{
 		/* Write the final LAS header: */
-		lasFile->setWritePosAbs(107);
-		lasFile->write<unsigned int>(numPoints);
-		lasFile->write<unsigned int>(numPoints);
-		lasFile->setWritePosAbs(179);
+		file.setWritePosAbs(107);
+		file.write<unsigned int>(numPoints);
+		file.write<unsigned int>(numPoints);
+		file.setWritePosAbs(179);
 		for(int i=0;i<3;++i)
 			{
-			lasFile->write<double>(max[i]+lpoOffset[i]);
-			lasFile->write<double>(min[i]+lpoOffset[i]);
+			file.write<double>(double(bbox.max[i])+lpoOffset[i]);
+			file.write<double>(double(bbox.min[i])+lpoOffset[i]);
 			}
 		}
+	};
+
+/**************
+Helper classes:
+**************/
+
+template <class FormatParam>
+class ExportFile // Class for export files receiving chunks of formatted points from multiple threads
+	{
+	/* Elements: */
+	private:
+	const FormatParam& format; // Formatter for the file's points
+	Threads::Mutex fileMutex; // Mutex serializing access to the file
+	IO::SeekableFilePtr file; // The export file
+	size_t numPoints; // Number of points written to the file
+	Box bbox; // Bounding box of the points written to the file in LiDAR coordinates
+	
+	/* Constructors and destructors: */
+	public:
+	ExportFile(const FormatParam& sFormat,const char* fileName)
+		:format(sFormat),
+		 file(IO::openSeekableFile(fileName,IO::File::WriteOnly)),
+		 numPoints(0),bbox(Box::empty)
+		{
+		file->setEndianness(Misc::LittleEndian);
+		format.writeHeader(*file);
+		}
+	~ExportFile(void)
+		{
+		/* Finalize the file header: */
+		format.finishFile(*file,numPoints,bbox);
+		}
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point)
+	void writeChunk(const char* chunk,size_t chunkSize,size_t chunkNumPoints,const Box& chunkBox) // Appends a chunk of formatted points in one go
 		{
-		/* Quantize the point position: */
-		int p[3];
-		for(int i=0;i<3;++i)
-			p[i]=int(Math::floor((double(point[i])-offset[i])/scale[i]+0.5));
+		Threads::Mutex::Lock fileLock(fileMutex);
+		file->writeRaw(chunk,chunkSize);
+		numPoints+=chunkNumPoints;
+		bbox.addBox(chunkBox);
+		}
+	size_t getNumPoints(void) const
+		{
+		return numPoints;
+		}
+	};
+
+template <class FormatParam>
+class ChunkExporter // Node functor to format the points of leaf nodes into per-thread chunks from multiple threads and append them to one export file, or to one export file per spatial tile
+	{
+	/* Embedded classes: */
+	private:
+	typedef ExportFile<FormatParam> File;
+	
+	/* Elements: */
+	const FormatParam& format; // Formatter for exported points
+	const Box* box; // Box from which to export points in LiDAR coordinates, or null to export all points
+	std::string fileNamePrefix,fileNameSuffix; // Parts of the export file name before and after the tile indices
+	unsigned int numTiles[2]; // Number of export tiles in x and y
+	Scalar tileOrigin[2]; // Lower-left corner of the export tile grid in LiDAR coordinates
+	Scalar tileSize[2]; // Size of each export tile in LiDAR coordinates
+	Threads::Mutex filesMutex; // Mutex serializing creation of export files
+	std::vector<File*> files; // Export files for all tiles, created when the first chunk for a tile arrives
+	Threads::Mutex bufferMutex; // Mutex protecting the list of idle chunk buffers
+	std::vector<std::vector<char>*> idleBuffers; // List of chunk buffers not currently used by any thread
+	Threads::Mutex statusMutex; // Mutex protecting the error message
+	std::string errorMessage; // Message of the first error that occurred during processing
+	
+	/* Private methods: */
+	unsigned int getTileIndex(int dimension,Scalar coordinate) const // Returns the index of the tile containing the given coordinate
+		{
+		int index=int(Math::floor((coordinate-tileOrigin[dimension])/tileSize[dimension]));
+		if(index<0)
+			index=0;
+		if(index>int(numTiles[dimension])-1)
+			index=int(numTiles[dimension])-1;
+		return (unsigned int)(index);
+		}
+	File& getFile(unsigned int tileX,unsigned int tileY) // Returns the export file for the given tile, creating it if necessary
+		{
+		Threads::Mutex::Lock filesLock(filesMutex);
+		File*& file=files[tileY*numTiles[0]+tileX];
+		if(file==0)
+			{
+			char tileIndices[32];
+			snprintf(tileIndices,sizeof(tileIndices),"_%u_%u",tileX,tileY);
+			file=new File(format,(fileNamePrefix+tileIndices+fileNameSuffix).c_str());
+			}
+		return *file;
+		}
+	std::vector<char>* acquireBuffer(void) // Returns an idle chunk buffer, or a new one if there is none
+		{
+		Threads::Mutex::Lock bufferLock(bufferMutex);
+		if(idleBuffers.empty())
+			return new std::vector<char>;
+		std::vector<char>* result=idleBuffers.back();
+		idleBuffers.pop_back();
+		return result;
+		}
+	void releaseBuffer(std::vector<char>* buffer) // Returns the given chunk buffer to the idle list
+		{
+		Threads::Mutex::Lock bufferLock(bufferMutex);
+		idleBuffers.push_back(buffer);
+		}
+	void exportNode(const LidarProcessOctree::Node& node,std::vector<char>& buffer) // Exports the given leaf node's points
+		{
+		/* Check if the node's domain is entirely inside the export box: */
+		bool allInBox=box==0||(node.getDomain().compareBox(*box)&Cube::CONTAINS);
 		
-		/* Calculate point intensity from RGB color: */
-		unsigned short intensity=((unsigned short)(point.value[0])+(unsigned short)(point.value[1])+(unsigned short)(point.value[2])+1)/3;
+		/* Find the range of tiles overlapping the node's domain: */
+		unsigned int tileMin[2],tileMax[2];
+		for(int i=0;i<2;++i)
+			{
+			tileMin[i]=getTileIndex(i,node.getDomain().getMin()[i]);
+			tileMax[i]=getTileIndex(i,node.getDomain().getMax()[i]);
+			}
+		bool singleTile=tileMin[0]==tileMax[0]&&tileMin[1]==tileMax[1];
 		
-		/* Write the point record: */
-		lasFile->write(p,3); // Quantized point position
-		lasFile->write<unsigned short>(intensity); // Point intensity
-		lasFile->write<char>(0); // Return data
-		lasFile->write<char>(0); // Point classification
-		lasFile->write<unsigned char>(0); // Laser angle
-		lasFile->write<unsigned char>(0); // User data
-		lasFile->write<unsigned short>(0); // Source
-		lasFile->write<unsigned short>(point.value.getRgba(),3);
+		/* Make room for the formatted points: */
+		size_t maxChunkSize=size_t(node.getNumPoints())*FormatParam::maxRecordSize;
+		if(buffer.size()<maxChunkSize)
+			buffer.resize(maxChunkSize);
 		
-		/* Update LAS header: */
-		for(int i=0;i<3;++i)
+		/* Format one chunk per overlapped tile: */
+		const LidarPoint* points=node.getPoints();
+		for(unsigned int tileY=tileMin[1];tileY<=tileMax[1];++tileY)
+			for(unsigned int tileX=tileMin[0];tileX<=tileMax[0];++tileX)
+				{
+				char* chunkEnd=&buffer[0];
+				size_t chunkNumPoints=0;
+				Box chunkBox=Box::empty;
+				for(unsigned int i=0;i<node.getNumPoints();++i)
+					{
+					const LidarPoint& p=points[i];
+					if((allInBox||box->contains(p))&&(singleTile||(getTileIndex(0,p[0])==tileX&&getTileIndex(1,p[1])==tileY)))
+						{
+						chunkEnd=format.formatPoint(p,chunkEnd);
+						++chunkNumPoints;
+						chunkBox.addPoint(p);
+						}
+					}
+				
+				/* Append the chunk to the tile's export file: */
+				if(chunkNumPoints>0)
+					getFile(tileX,tileY).writeChunk(&buffer[0],chunkEnd-&buffer[0],chunkNumPoints,chunkBox);
+				}
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	ChunkExporter(const FormatParam& sFormat,const Box* sBox,const Box& tileDomain,const char* fileName,const unsigned int sNumTiles[2])
+		:format(sFormat),box(sBox)
+		{
+		for(int i=0;i<2;++i)
+			{
+			numTiles[i]=sNumTiles[i]>0U?sNumTiles[i]:1U;
+			tileOrigin[i]=tileDomain.min[i];
+			tileSize[i]=(tileDomain.max[i]-tileDomain.min[i])/Scalar(numTiles[i]);
+			if(tileSize[i]<=Scalar(0))
+				tileSize[i]=Scalar(1);
+			}
+		files.resize(numTiles[0]*numTiles[1],0);
+		
+		if(files.size()==1)
 			{
-			if(min[i]>point[i])
-				min[i]=point[i];
-			if(max[i]<point[i])
-				max[i]=point[i];
+			/* Create the single export file right away: */
+			files[0]=new File(format,fileName);
+			}
+		else
+			{
+			/* Insert the tile indices in front of the file name's extension: */
+			const char* extPtr=Misc::getExtension(fileName);
+			fileNamePrefix=std::string(fileName,extPtr);
+			fileNameSuffix=extPtr;
 			}
-		++numPoints;
 		}
-	size_t getNumPoints(void) const
+	~ChunkExporter(void)
 		{
-		return numPoints;
+		/* Finalize and close all export files: */
+		for(typename std::vector<File*>::iterator fIt=files.begin();fIt!=files.end();++fIt)
+			delete *fIt;
+		
+		/* Delete all chunk buffers: */
+		for(std::vector<std::vector<char>*>::iterator bIt=idleBuffers.begin();bIt!=idleBuffers.end();++bIt)
+			delete *bIt;
+		}
+	
+	/* Methods: */
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel) // Exports a node's points; thread-safe if called from a parallel traversal
+		{
+		/* Only leaf nodes contain original points: */
+		if(!node.isLeaf()||node.getNumPoints()==0)
+			return;
+		
+		/* Export the node using a chunk buffer: */
+		std::vector<char>* buffer=acquireBuffer();
+		try
+			{
+			exportNode(node,*buffer);
+			}
+		catch(const std::runtime_error& err)
+			{
+			/* Parallel traversals do not allow exceptions; remember the error instead: */
+			Threads::Mutex::Lock statusLock(statusMutex);
+			if(errorMessage.empty())
+				errorMessage=err.what();
+			}
+		releaseBuffer(buffer);
+		}
+	size_t getNumFiles(void) const // Returns the number of created export files
+		{
+		size_t result=0;
+		for(typename std::vector<File*>::const_iterator fIt=files.begin();fIt!=files.end();++fIt)
+			if(*fIt!=0)
+				++result;
+		return result;
+		}
+	size_t getNumPoints(void) const // Returns the total number of exported points
+		{
+		size_t result=0;
+		for(typename std::vector<File*>::const_iterator fIt=files.begin();fIt!=files.end();++fIt)
+			if(*fIt!=0)
+				result+=(*fIt)->getNumPoints();
+		return result;
+		}
+	const std::string& getErrorMessage(void) const // Returns the message of the first error that occurred during processing, or an empty string
+		{
+		return errorMessage;
 		}
 	};
 
+template <class FormatParam>
+inline
+bool
+exportPoints(
+	LidarProcessOctree& lpo,
+	const FormatParam& format,
+	const Box* box,
+	const char* outputFileName,
+	const unsigned int numTiles[2],
+	unsigned int numThreads) // Exports points from the given octree; returns false and prints an error message if the export failed
+	{
+	/* Lay out export tiles over the export box, or over the octree's domain: */
+	Box tileDomain=box!=0?*box:Box(lpo.getDomain().getMin(),lpo.getDomain().getMax());
+	ChunkExporter<FormatParam> ce(format,box,tileDomain,outputFileName,numTiles);
+	
+	/* Process the LiDAR file's leaf nodes in parallel: */
+	if(box!=0)
+		{
+		/* Exports points from inside the box: */
+		lpo.processNodesInBoxPrefixParallel(*box,ce,numThreads);
+		}
+	else
+		{
+		/* Export all points: */
+		lpo.processNodesPrefixParallel(ce,numThreads);
+		}
+	
+	if(!ce.getErrorMessage().empty())
+		{
+		std::cerr<<"Error while exporting points: "<<ce.getErrorMessage()<<std::endl;
+		return false;
+		}
+	
+	/* Print statistics: */
+	std::cout<<ce.getNumPoints()<<" points saved";
+	if(numTiles[0]*numTiles[1]>1U)
+		std::cout<<" into "<<ce.getNumFiles()<<" tile files";
+	std::cout<<std::endl;
+	
+	return true;
+	}
+
 int main(int argc,char* argv[])
 	{
 	/* Process command line: */
@@ -232,6 +572,10 @@ int main(int argc,char* argv[])
 	int cacheSize=512;
 	bool haveBox=false;
 	double box[6];
+	bool mapDataFiles=false;
+	unsigned int numThreads=1;
+	unsigned int numTiles[2]={1,1};
+	int numDecimals=-1;
 	for(int i=1;i<argc;++i)
 		{
 		if(argv[i][0]=='-')
@@ -255,6 +599,40 @@ int main(int argc,char* argv[])
 					box[j]=atof(argv[i]);
 					}
 				}
+			else if(strcasecmp(argv[i]+1,"mmap")==0)
+				mapDataFiles=true;
+			else if(strcasecmp(argv[i]+1,"threads")==0)
+				{
+				++i;
+				if(i<argc)
+					numThreads=(unsigned int)atoi(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -threads option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"tiles")==0)
+				{
+				if(i+2<argc)
+					{
+					for(int j=0;j<2;++j)
+						{
+						++i;
+						numTiles[j]=(unsigned int)atoi(argv[i]);
+						}
+					}
+				else
+					{
+					std::cerr<<"Ignoring dangling -tiles option"<<std::endl;
+					i+=2;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"decimals")==0)
+				{
+				++i;
+				if(i<argc)
+					numDecimals=atoi(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -decimals option"<<std::endl;
+				}
 			else if(strcasecmp(argv[i]+1,"bin")==0)
 				outputFileType=1;
 			else if(strcasecmp(argv[i]+1,"las")==0)
@@ -287,19 +665,24 @@ int main(int argc,char* argv[])
 		}
 	if(lidarFile==0||outputFile==0)
 		{
-		std::cerr<<"Usage: "<<argv[0]<<" [-cache <cache size>] [-box <box spec>] <LiDAR file name> [-bin] [-las] [-lasScale <x scale> <y scale> <z scale>] <output file name>"<<std::endl;
+		std::cerr<<"Usage: "<<argv[0]<<" [-cache <cache size>] [-threads <num threads>] [-box <box spec>] [-tiles <num tiles x> <num tiles y>] <LiDAR file name> [-bin] [-las] [-lasScale <x scale> <y scale> <z scale>] [-decimals <num decimals>] <output file name>"<<std::endl;
 		std::cerr<<"  -readColors <colors file name> requests to read the additional point color file of the given name"<<std::endl;
 		std::cerr<<"  -cache <cache size> sets the size of the LiDAR memory cache in MB (default: 512)"<<std::endl;
+		std::cerr<<"  -mmap requests to read point data from memory-mapped files"<<std::endl;
+		std::cerr<<"  -threads <num threads> sets the number of threads formatting points in parallel (default: 1)"<<std::endl;
 		std::cerr<<"  -box <box spec> specifies a box in source coordinates from which to export points (default: export all points)"<<std::endl;
 		std::cerr<<"     box specification: <min_x> <min_y> <min_z> <max_x> <max_y> <max_z>"<<std::endl;
+		std::cerr<<"  -tiles <num tiles x> <num tiles y> splits the export box, or the LiDAR file's domain, into a grid of tiles and writes each tile's points into <output file name>_<x>_<y> (default: 1 1)"<<std::endl;
 		std::cerr<<"  -bin requests to write exported points into a binary file (default: write into ASCII file)"<<std::endl;
 		std::cerr<<"  -las requests to write exported points into a LAS-like file (default: write into ASCII file)"<<std::endl;
 		std::cerr<<"  -lasScale <x scale> <y scale> <z scale> defines the quantization scaling factors for LAS files"<<std::endl;
+		std::cerr<<"  -decimals <num decimals> writes ASCII coordinates with the given fixed number of decimals, at most 9 (default: write with 12 significant digits)"<<std::endl;
 		return 1;
 		}
 	
 	/* Open the input and output files: */
-	LidarProcessOctree lpo(lidarFile,size_t(cacheSize)*1024*1024,colorsFileName);
+	LidarProcessOctree lpo(lidarFile,size_t(cacheSize)*1024*1024,colorsFileName,mapDataFiles);
+	lpo.startPrefetching();
 	Box lbox;
 	if(haveBox)
 		{
@@ -311,67 +694,26 @@ int main(int argc,char* argv[])
 			}
 		}
 	
+	bool ok;
 	if(outputFileType==2)
 		{
 		/* Use octree file's center point as quantization offset: */
 		double lasOffset[3];
 		for(int i=0;i<3;++i)
 			lasOffset[i]=lpo.getDomain().getCenter(i);
-		LasPointSaver ps(outputFile,lpo.getOffset(),lasScale,lasOffset);
-		
-		/* Process the LiDAR file: */
-		if(haveBox)
-			{
-			/* Exports points from inside the box: */
-			lpo.processPointsInBox(lbox,ps);
-			}
-		else
-			{
-			/* Export all points: */
-			lpo.processPoints(ps);
-			}
-		
-		/* Print statistics: */
-		std::cout<<ps.getNumPoints()<<" points saved"<<std::endl;
+		LasFormat format(lpo.getOffset(),lasScale,lasOffset);
+		ok=exportPoints(lpo,format,haveBox?&lbox:0,outputFile,numTiles,numThreads);
 		}
 	else if(outputFileType==1)
 		{
-		BinaryPointSaver ps(lpo.getOffset(),outputFile);
-		
-		/* Process the LiDAR file: */
-		if(haveBox)
-			{
-			/* Exports points from inside the box: */
-			lpo.processPointsInBox(lbox,ps);
-			}
-		else
-			{
-			/* Export all points: */
-			lpo.processPoints(ps);
-			}
-		
-		/* Print statistics: */
-		std::cout<<ps.getNumPoints()<<" points saved"<<std::endl;
+		BinaryFormat format(lpo.getOffset());
+		ok=exportPoints(lpo,format,haveBox?&lbox:0,outputFile,numTiles,numThreads);
 		}
 	else
 		{
-		PointSaver ps(lpo.getOffset(),outputFile);
-		
-		/* Process the LiDAR file: */
-		if(haveBox)
-			{
-			/* Exports points from inside the box: */
-			lpo.processPointsInBox(lbox,ps);
-			}
-		else
-			{
-			/* Export all points: */
-			lpo.processPoints(ps);
-			}
-		
-		/* Print statistics: */
-		std::cout<<ps.getNumPoints()<<" points saved"<<std::endl;
+		AsciiFormat format(lpo.getOffset(),numDecimals);
+		ok=exportPoints(lpo,format,haveBox?&lbox:0,outputFile,numTiles,numThreads);
 		}
 	
-	return 0;
+	return ok?0:1;
 	}
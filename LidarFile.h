@@ -23,12 +23,14 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef LIDARFILE_INCLUDED
 #define LIDARFILE_INCLUDED
 
+#include <IO/SeekableFile.h>
 #include <IO/StandardFile.h>
 
 #include "LidarTypes.h"
 #include "Cube.h"
 
 typedef IO::StandardFile LidarFile; // Type for LiDAR octree and data files
+typedef IO::SeekableFile LidarSourceFile; // Type for LiDAR octree and data files opened for reading from local or remote sources
 
 struct LidarOctreeFileHeader // Header structure for LiDAR octree files
 	{
@@ -43,7 +45,7 @@ struct LidarOctreeFileHeader // Header structure for LiDAR octree files
 		 maxNumPointsPerNode(sMaxNumPointsPerNode)
 		{
 		}
-	LidarOctreeFileHeader(LidarFile& file) // Reads the header of a LiDAR octree file
+	LidarOctreeFileHeader(LidarSourceFile& file) // Reads the header of a LiDAR octree file
 		:domain(file),
 		 maxNumPointsPerNode(file.read<unsigned int>())
 		{
@@ -78,7 +80,7 @@ struct LidarOctreeFileNode // Structure for a node in a LiDAR octree file
 		{
 		return sizeof(LidarFile::Offset)+sizeof(Scalar)+sizeof(unsigned int)+sizeof(LidarFile::Offset);
 		};
-	void read(LidarFile& file) // Reads the octree node from file
+	void read(LidarSourceFile& file) // Reads the octree node from file
 		{
 		file.read(childrenOffset);
 		file.read(detailSize);
@@ -105,7 +107,7 @@ struct LidarDataFileHeader // Header structure for LiDAR point or ancillary data
 		:recordSize(sRecordSize)
 		{
 		}
-	LidarDataFileHeader(LidarFile& file) // Reads the header of a LiDAR data file
+	LidarDataFileHeader(LidarSourceFile& file) // Reads the header of a LiDAR data file
 		:recordSize(file.read<unsigned int>())
 		{
 		}
@@ -0,0 +1,398 @@
+/***********************************************************************
+LidarFileServer - Class to serve the parts of local LiDAR files to peers
+through HTTP range requests, so that they can stream octree nodes on
+demand as remote LiDAR files.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarFileServer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <Misc/StdError.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+bool isValidPartName(const char* partName) // Returns true if the given part name can not escape the served directory
+	{
+	if(*partName=='\0'||*partName=='.')
+		return false;
+	for(const char* pnPtr=partName;*pnPtr!='\0';++pnPtr)
+		if(!isalnum(*pnPtr)&&*pnPtr!='.'&&*pnPtr!='-'&&*pnPtr!='_')
+			return false;
+	return true;
+	}
+
+}
+
+/********************************
+Methods of class LidarFileServer:
+********************************/
+
+void LidarFileServer::startResponse(LidarFileServer::Connection& connection,int status,const char* reason,long long contentLength,const char* extraHeaders,bool close)
+	{
+	char header[1024];
+	snprintf(header,sizeof(header),"HTTP/1.1 %d %s\r\nContent-Length: %lld\r\n%sConnection: %s\r\n\r\n",status,reason,contentLength,extraHeaders,close?"close":"keep-alive");
+	connection.output=header;
+	connection.outputPos=0;
+	connection.closeAfterResponse=close;
+	}
+
+void LidarFileServer::handleRequest(LidarFileServer::Connection& connection,const std::string& header)
+	{
+	/* Parse the request line: */
+	char method[16];
+	char path[1024];
+	if(sscanf(header.c_str(),"%15s %1023s HTTP/1.",method,path)!=2)
+		{
+		startResponse(connection,400,"Bad Request",0,"",true);
+		return;
+		}
+	bool isHead=strcmp(method,"HEAD")==0;
+	
+	/* Parse the request headers: */
+	bool haveRange=false;
+	long long rangeFirst=0,rangeLast=-1;
+	bool keepAlive=true;
+	std::string::size_type lineStart=header.find('\n');
+	while(lineStart!=std::string::npos)
+		{
+		++lineStart;
+		std::string::size_type lineEnd=header.find('\n',lineStart);
+		std::string line=header.substr(lineStart,lineEnd==std::string::npos?std::string::npos:lineEnd-lineStart);
+		if(!line.empty()&&line[line.size()-1]=='\r')
+			line.erase(line.size()-1);
+		if(strncasecmp(line.c_str(),"Range:",6)==0)
+			{
+			if(sscanf(line.c_str()+6," bytes=%lld-%lld",&rangeFirst,&rangeLast)!=2||rangeFirst<0||rangeLast<rangeFirst)
+				{
+				startResponse(connection,416,"Range Not Satisfiable",0,"",true);
+				return;
+				}
+			haveRange=true;
+			}
+		else if(strncasecmp(line.c_str(),"Connection:",11)==0&&strstr(line.c_str()+11,"close")!=0)
+			keepAlive=false;
+		lineStart=lineEnd;
+		}
+	if(!isHead&&strcmp(method,"GET")!=0)
+		{
+		startResponse(connection,405,"Method Not Allowed",0,"",!keepAlive);
+		return;
+		}
+	
+	/* Map the path to a part of a served LiDAR file: */
+	char* indexEnd=path;
+	unsigned long lidarFileIndex=path[0]=='/'?strtoul(path+1,&indexEnd,10):0;
+	if(path[0]!='/'||indexEnd==path+1||*indexEnd!='/'||lidarFileIndex>=lidarFileNames.size()||!isValidPartName(indexEnd+1))
+		{
+		startResponse(connection,404,"Not Found",0,"",!keepAlive);
+		return;
+		}
+	std::string partFileName=lidarFileNames[lidarFileIndex];
+	if(partFileName.empty()||partFileName[partFileName.size()-1]!='/')
+		partFileName.push_back('/');
+	partFileName.append(indexEnd+1);
+	int partFd=open(partFileName.c_str(),O_RDONLY);
+	struct stat partStat;
+	if(partFd<0||fstat(partFd,&partStat)<0||!S_ISREG(partStat.st_mode))
+		{
+		if(partFd>=0)
+			close(partFd);
+		startResponse(connection,404,"Not Found",0,"",!keepAlive);
+		return;
+		}
+	long long partSize=(long long)(partStat.st_size);
+	
+	/* Queue the response header: */
+	char extraHeaders[256];
+	int ehSize=snprintf(extraHeaders,sizeof(extraHeaders),"ETag: \"%llx-%llx\"\r\n",(unsigned long long)(partSize),(unsigned long long)(partStat.st_mtime));
+	if(haveRange)
+		{
+		if(rangeFirst>=partSize)
+			{
+			close(partFd);
+			startResponse(connection,416,"Range Not Satisfiable",0,"",!keepAlive);
+			return;
+			}
+		if(rangeLast>=partSize)
+			rangeLast=partSize-1;
+		snprintf(extraHeaders+ehSize,sizeof(extraHeaders)-size_t(ehSize),"Content-Range: bytes %lld-%lld/%lld\r\n",rangeFirst,rangeLast,partSize);
+		startResponse(connection,206,"Partial Content",rangeLast+1-rangeFirst,extraHeaders,!keepAlive);
+		}
+	else
+		{
+		rangeFirst=0;
+		rangeLast=partSize-1;
+		startResponse(connection,200,"OK",partSize,extraHeaders,!keepAlive);
+		}
+	
+	/* Queue the requested byte range of the part: */
+	if(isHead)
+		close(partFd);
+	else
+		{
+		connection.partFd=partFd;
+		connection.partPos=off_t(rangeFirst);
+		connection.partEnd=off_t(rangeLast)+1;
+		}
+	}
+
+bool LidarFileServer::serve(LidarFileServer::Connection& connection)
+	{
+	while(true)
+		{
+		if(connection.outputPos<connection.output.size())
+			{
+			/* Send as much of the pending data as the socket takes: */
+			ssize_t sendResult=send(connection.fd,connection.output.data()+connection.outputPos,connection.output.size()-connection.outputPos,MSG_NOSIGNAL);
+			if(sendResult<0)
+				{
+				if(errno==EINTR)
+					continue;
+				
+				/* Wait until the peer takes more data if the socket's buffer is full: */
+				return errno==EAGAIN||errno==EWOULDBLOCK;
+				}
+			connection.outputPos+=size_t(sendResult);
+			connection.lastProgress=time(0);
+			}
+		else if(connection.partFd>=0&&connection.partPos<connection.partEnd)
+			{
+			/* Read the next piece of part data: */
+			size_t readSize=pieceSize;
+			if(off_t(readSize)>connection.partEnd-connection.partPos)
+				readSize=size_t(connection.partEnd-connection.partPos);
+			connection.output.resize(readSize);
+			ssize_t readResult=pread(connection.partFd,&connection.output[0],readSize,connection.partPos);
+			if(readResult<0&&errno==EINTR)
+				continue;
+			
+			/* Close the connection if the part could not be read, as the promised body can not be delivered: */
+			if(readResult<=0)
+				return false;
+			connection.output.resize(size_t(readResult));
+			connection.outputPos=0;
+			connection.partPos+=off_t(readResult);
+			}
+		else
+			{
+			/* Finish the current response: */
+			if(connection.partFd>=0)
+				{
+				close(connection.partFd);
+				connection.partFd=-1;
+				}
+			connection.output.clear();
+			connection.outputPos=0;
+			if(connection.closeAfterResponse)
+				return false;
+			
+			/* Answer the next buffered request, or wait for one: */
+			std::string::size_type headerEnd=connection.request.find("\r\n\r\n");
+			if(headerEnd==std::string::npos)
+				return connection.request.size()<=maxRequestSize;
+			std::string header=connection.request.substr(0,headerEnd);
+			connection.request.erase(0,headerEnd+4);
+			handleRequest(connection,header);
+			}
+		}
+	}
+
+void* LidarFileServer::serverThreadMethod(void)
+	{
+	std::vector<struct pollfd> pollFds;
+	while(true)
+		{
+		/* Wait for new connections, for requests on idle connections, and for room to send on busy connections: */
+		pollFds.clear();
+		struct pollfd listenPollFd;
+		listenPollFd.fd=listenFd;
+		listenPollFd.events=POLLIN;
+		pollFds.push_back(listenPollFd);
+		for(std::vector<Connection>::iterator cIt=connections.begin();cIt!=connections.end();++cIt)
+			{
+			struct pollfd connectionPollFd;
+			connectionPollFd.fd=cIt->fd;
+			connectionPollFd.events=cIt->output.empty()?POLLIN:POLLOUT;
+			pollFds.push_back(connectionPollFd);
+			}
+		if(poll(&pollFds[0],nfds_t(pollFds.size()),1000)<0)
+			continue;
+		time_t now=time(0);
+		
+		/* Serve all ready connections, and close connections that failed, were closed by their peers, or stalled: */
+		std::vector<Connection>::iterator cIt=connections.begin();
+		for(size_t i=1;i<pollFds.size();++i)
+			{
+			bool keep=true;
+			if(pollFds[i].revents&POLLIN)
+				{
+				/* Receive request data: */
+				char buffer[4096];
+				ssize_t recvResult=recv(cIt->fd,buffer,sizeof(buffer),0);
+				if(recvResult>0)
+					{
+					cIt->request.append(buffer,size_t(recvResult));
+					cIt->lastProgress=now;
+					keep=serve(*cIt);
+					}
+				else if(recvResult==0||(errno!=EINTR&&errno!=EAGAIN&&errno!=EWOULDBLOCK))
+					keep=false;
+				}
+			else if(pollFds[i].revents&POLLOUT)
+				keep=serve(*cIt);
+			else if(pollFds[i].revents!=0)
+				keep=false;
+			else if(!cIt->output.empty()&&now-cIt->lastProgress>sendTimeout)
+				keep=false;
+			
+			if(keep)
+				++cIt;
+			else
+				{
+				if(cIt->partFd>=0)
+					close(cIt->partFd);
+				close(cIt->fd);
+				cIt=connections.erase(cIt);
+				}
+			}
+		
+		/* Accept a new connection: */
+		if(pollFds[0].revents&POLLIN)
+			{
+			int fd=accept(listenFd,0,0);
+			if(fd>=0)
+				{
+				/* Send responses immediately and without blocking: */
+				int flag=1;
+				setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+				fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_NONBLOCK);
+				Connection newConnection;
+				newConnection.fd=fd;
+				newConnection.outputPos=0;
+				newConnection.partFd=-1;
+				newConnection.partPos=newConnection.partEnd=0;
+				newConnection.closeAfterResponse=false;
+				newConnection.lastProgress=now;
+				connections.push_back(newConnection);
+				}
+			}
+		}
+	
+	return 0;
+	}
+
+LidarFileServer::LidarFileServer(const char* interfaceName,int sPort,const std::vector<std::string>& sLidarFileNames)
+	:listenFd(-1),port(sPort),
+	 lidarFileNames(sLidarFileNames)
+	{
+	/* Resolve the address of the requested interface, or of all interfaces: */
+	struct addrinfo hints;
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_STREAM;
+	hints.ai_flags=AI_PASSIVE;
+	char portName[16];
+	snprintf(portName,sizeof(portName),"%d",port);
+	bool anyInterface=interfaceName==0||interfaceName[0]=='\0';
+	if(anyInterface)
+		hints.ai_family=AF_INET;
+	struct addrinfo* addresses;
+	int aiResult=getaddrinfo(anyInterface?0:interfaceName,portName,&hints,&addresses);
+	if(aiResult!=0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot resolve interface %s due to error %s",anyInterface?"(any)":interfaceName,gai_strerror(aiResult));
+	
+	/* Listen on the first address that can be bound: */
+	int error=0;
+	for(struct addrinfo* aPtr=addresses;aPtr!=0&&listenFd<0;aPtr=aPtr->ai_next)
+		{
+		listenFd=socket(aPtr->ai_family,aPtr->ai_socktype,aPtr->ai_protocol);
+		if(listenFd<0)
+			{
+			error=errno;
+			continue;
+			}
+		int flag=1;
+		setsockopt(listenFd,SOL_SOCKET,SO_REUSEADDR,&flag,sizeof(flag));
+		if(bind(listenFd,aPtr->ai_addr,aPtr->ai_addrlen)<0||listen(listenFd,16)<0)
+			{
+			error=errno;
+			close(listenFd);
+			listenFd=-1;
+			}
+		}
+	freeaddrinfo(addresses);
+	if(listenFd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot listen on port %d",port);
+	
+	/* Retrieve the port number chosen by the operating system: */
+	struct sockaddr_storage address;
+	socklen_t addressLen=sizeof(address);
+	if(getsockname(listenFd,reinterpret_cast<struct sockaddr*>(&address),&addressLen)==0)
+		{
+		if(address.ss_family==AF_INET)
+			port=ntohs(reinterpret_cast<struct sockaddr_in*>(&address)->sin_port);
+		else if(address.ss_family==AF_INET6)
+			port=ntohs(reinterpret_cast<struct sockaddr_in6*>(&address)->sin6_port);
+		}
+	
+	/* Start the server thread: */
+	serverThread.start(this,&LidarFileServer::serverThreadMethod);
+	}
+
+LidarFileServer::~LidarFileServer(void)
+	{
+	/* Stop the server thread: */
+	serverThread.cancel();
+	serverThread.join();
+	
+	/* Close all connections and the listening socket: */
+	for(std::vector<Connection>::iterator cIt=connections.begin();cIt!=connections.end();++cIt)
+		{
+		if(cIt->partFd>=0)
+			close(cIt->partFd);
+		close(cIt->fd);
+		}
+	close(listenFd);
+	}
+
+std::string LidarFileServer::getUrl(const char* hostName,size_t lidarFileIndex) const
+	{
+	char url[1024];
+	snprintf(url,sizeof(url),"http://%s:%d/%u/",hostName,port,(unsigned int)lidarFileIndex);
+	return url;
+	}
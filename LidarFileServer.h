@@ -0,0 +1,109 @@
+/***********************************************************************
+LidarFileServer - Class to serve the parts of local LiDAR files to peers
+through HTTP range requests, so that they can stream octree nodes on
+demand as remote LiDAR files.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARFILESERVER_INCLUDED
+#define LIDARFILESERVER_INCLUDED
+
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <Threads/Thread.h>
+
+/***********************************************************************
+The server answers HEAD requests and GET requests for single byte
+ranges, which is the subset of HTTP/1.1 used by LidarRemoteDataset.
+The i-th served LiDAR file is available under the path /<i>/, and each
+of its parts under /<i>/<part name>. Part names may only contain
+letters, digits, dots, dashes, and underscores. Each part's ETag is
+derived from its size and modification time, so that peers discard
+cached blocks of changed parts.
+
+All connections are served by one thread through non-blocking sockets.
+Each connection sends its current response in small pieces whenever
+its peer can take more data, so a slow peer does not hold up the
+others, and connections whose peers stop taking data for sendTimeout
+seconds are closed. The server offers the files to anybody who can
+reach the listening port; bind it to the interface facing the session
+peers to limit exposure.
+***********************************************************************/
+
+class LidarFileServer
+	{
+	/* Embedded classes: */
+	private:
+	struct Connection // Structure for the state of a connection to a peer
+		{
+		/* Elements: */
+		public:
+		int fd; // Socket connected to the peer
+		std::string request; // Received data of requests that have not been answered yet
+		std::string output; // Data of the current response that is waiting to be sent
+		size_t outputPos; // Amount of the pending response data that has already been sent
+		int partFd; // File descriptor of the part whose data is being sent, or -1
+		off_t partPos,partEnd; // Range of part data that remains to be sent
+		bool closeAfterResponse; // Flag whether to close the connection after sending the current response
+		time_t lastProgress; // Time at which the connection last sent or received data
+		};
+	
+	static const size_t maxRequestSize=16384; // Maximum size of a request header in bytes
+	static const size_t pieceSize=65536; // Amount of part data read and sent at once in bytes
+	static const time_t sendTimeout=30; // Time in seconds after which connections that stopped taking response data are closed
+	
+	/* Elements: */
+	int listenFd; // Socket listening for incoming connections
+	int port; // Port number on which the server listens
+	std::vector<std::string> lidarFileNames; // Names of the served LiDAR file directories
+	Threads::Thread serverThread; // Thread accepting connections and answering requests
+	std::vector<Connection> connections; // List of open connections; only accessed by the server thread
+	
+	/* Private methods: */
+	void startResponse(Connection& connection,int status,const char* reason,long long contentLength,const char* extraHeaders,bool close); // Queues the status line and headers of a response on the given connection
+	void handleRequest(Connection& connection,const std::string& header); // Queues the response to the request with the given header on the given connection
+	bool serve(Connection& connection); // Sends as much pending response data as the given connection takes without blocking, and answers further buffered requests; returns false if the connection must be closed
+	void* serverThreadMethod(void); // Thread method serving all connections
+	
+	/* Constructors and destructors: */
+	public:
+	LidarFileServer(const char* interfaceName,int sPort,const std::vector<std::string>& sLidarFileNames); // Serves the given LiDAR file directories on the network interface of the given host name or address, or on all interfaces if the name is empty, and on the given TCP port, or on a port chosen by the operating system if the port is 0; throws exception if the port cannot be opened
+	private:
+	LidarFileServer(const LidarFileServer& source); // Prohibit copy constructor
+	LidarFileServer& operator=(const LidarFileServer& source); // Prohibit assignment operator
+	public:
+	~LidarFileServer(void); // Stops serving and closes all connections
+	
+	/* Methods: */
+	int getPort(void) const // Returns the port number on which the server listens
+		{
+		return port;
+		}
+	size_t getNumLidarFiles(void) const // Returns the number of served LiDAR files
+		{
+		return lidarFileNames.size();
+		}
+	std::string getUrl(const char* hostName,size_t lidarFileIndex) const; // Returns the URL under which peers can open the given served LiDAR file as a remote LiDAR file, using the given host name
+	};
+
+#endif
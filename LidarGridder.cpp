@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarGridder - Experimental program to resample LiDAR data onto a
 regular grid.
-Copyright (c) 2009-2025 Oliver Kreylos
+Copyright (c) 2009-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -27,6 +27,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <string>
+#include <vector>
 #include <stdexcept>
 #include <iostream>
 #include <iomanip>
@@ -34,6 +35,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Misc/StdError.h>
 #include <Misc/File.h>
 #include <Misc/Timer.h>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
 #include <Math/Math.h>
 #include <Math/Constants.h>
 #include <Geometry/ComponentArray.h>
@@ -137,6 +140,28 @@ class SimpleSampler // Class to sample a LiDAR point cloud at an (x, y) position
 		#endif
 		++numPoints;
 		}
+	void operator()(const LidarPoint* points,size_t numBatchPoints)
+		{
+		#if 1
+		/* Accumulate the batch in local variables to keep the loop free of dependencies on members: */
+		double batchSum=0.0;
+		double batchWeight=0.0;
+		double px=pos[0],py=pos[1];
+		double cx=1.0/gridCellSize[0],cy=1.0/gridCellSize[1];
+		for(size_t i=0;i<numBatchPoints;++i)
+			{
+			double w=Math::max(0.0,(1.0-(points[i][0]-px)*cx)*(1.0-(points[i][1]-py)*cy));
+			batchSum+=points[i][2]*w;
+			batchWeight+=w;
+			}
+		sum+=batchSum;
+		weight+=batchWeight;
+		numPoints+=(unsigned int)(numBatchPoints);
+		#else
+		for(size_t i=0;i<numBatchPoints;++i)
+			(*this)(points[i]);
+		#endif
+		}
 	unsigned int getNumPoints(void) const
 		{
 		return numPoints;
@@ -156,6 +181,135 @@ class SimpleSampler // Class to sample a LiDAR point cloud at an (x, y) position
 		}
 	};
 
+class TileSampler // Class to sample all vertices of a rectangular DEM tile with SimpleSampler's filter from a single gathered set of LiDAR points
+	{
+	/* Embedded classes: */
+	public:
+	static const int maxNumDilations=6; // Largest number of sampler dilations that can be resolved from a tile's gathered points
+	static const int margin=1<<maxNumDilations; // Margin around a tile in grid cells covered by the largest resolvable sampler
+	
+	private:
+	struct Moments // Structure to accumulate the moments of a set of points from which the integral of a tent filter follows
+		{
+		/* Elements: */
+		public:
+		double m[8]; // Sums of 1, u, v, uv, z, zu, zv, zuv, where (u, v) are a point's position relative to the first bin in grid cell units
+		};
+	
+	/* Elements: */
+	double gridOrigin[2]; // Position of the DEM's (0, 0) vertex
+	double gridCellSize[2]; // Cell size of target grid in x and y
+	int binMin[2]; // Index of the grid vertex at the lower-left corner of the first bin
+	int numBins[2]; // Number of grid cell-sized bins covering the current tile and its margin
+	std::vector<Moments> table; // Summed-area table of point moments, with an additional leading row and column of zeros
+	
+	/* Constructors and destructors: */
+	public:
+	TileSampler(const double sGridOrigin[2],const double sGridCellSize[2])
+		{
+		for(int i=0;i<2;++i)
+			{
+			gridOrigin[i]=sGridOrigin[i];
+			gridCellSize[i]=sGridCellSize[i];
+			}
+		}
+	
+	/* Methods: */
+	Box prepare(const int tileMin[2],const int tileMax[2]) // Prepares for sampling the given range of grid vertices; returns the box from which points have to be gathered
+		{
+		/* Cover the tile and the footprints of its largest resolvable samplers with bins: */
+		for(int i=0;i<2;++i)
+			{
+			binMin[i]=tileMin[i]-margin;
+			numBins[i]=tileMax[i]-tileMin[i]+2*margin;
+			}
+		Moments zero;
+		for(int i=0;i<8;++i)
+			zero.m[i]=0.0;
+		table.assign(size_t(numBins[0]+1)*size_t(numBins[1]+1),zero);
+		
+		/* Calculate the bins' bounding box: */
+		Box sampleBox;
+		for(int i=0;i<2;++i)
+			{
+			sampleBox.min[i]=Scalar(gridOrigin[i]+double(binMin[i])*gridCellSize[i]);
+			sampleBox.max[i]=Scalar(gridOrigin[i]+double(binMin[i]+numBins[i])*gridCellSize[i]);
+			}
+		sampleBox.min[2]=Box::full.min[2];
+		sampleBox.max[2]=Box::full.max[2];
+		
+		return sampleBox;
+		}
+	void operator()(const LidarPoint* points,size_t numBatchPoints)
+		{
+		double u0=gridOrigin[0]+double(binMin[0])*gridCellSize[0];
+		double v0=gridOrigin[1]+double(binMin[1])*gridCellSize[1];
+		double cu=1.0/gridCellSize[0],cv=1.0/gridCellSize[1];
+		for(size_t i=0;i<numBatchPoints;++i)
+			{
+			/* Find the bin containing the point: */
+			double u=(double(points[i][0])-u0)*cu;
+			double v=(double(points[i][1])-v0)*cv;
+			int bu=int(Math::floor(u));
+			int bv=int(Math::floor(v));
+			if(bu<0||bu>=numBins[0]||bv<0||bv>=numBins[1])
+				continue;
+			
+			/* Accumulate the point's moments: */
+			double* m=table[size_t(bv+1)*size_t(numBins[0]+1)+size_t(bu+1)].m;
+			double z=double(points[i][2]);
+			double uv=u*v;
+			m[0]+=1.0;
+			m[1]+=u;
+			m[2]+=v;
+			m[3]+=uv;
+			m[4]+=z;
+			m[5]+=z*u;
+			m[6]+=z*v;
+			m[7]+=z*uv;
+			}
+		}
+	void finish(void) // Converts the per-bin moments into a summed-area table after all points have been gathered
+		{
+		size_t stride=size_t(numBins[0]+1);
+		for(int y=1;y<=numBins[1];++y)
+			for(int x=1;x<=numBins[0];++x)
+				{
+				double* m=table[size_t(y)*stride+size_t(x)].m;
+				const double* mx=table[size_t(y)*stride+size_t(x-1)].m;
+				const double* my=table[size_t(y-1)*stride+size_t(x)].m;
+				const double* mxy=table[size_t(y-1)*stride+size_t(x-1)].m;
+				for(int i=0;i<8;++i)
+					m[i]+=mx[i]+my[i]-mxy[i];
+				}
+		}
+	bool sample(int x,int y,int numDilations,double& value) const // Samples the grid vertex of the given index with a sampler dilated the given number of times; returns true and the sampled value if the sampler's weight is sufficient
+		{
+		/* Sum the moments of all bins inside the sampler's footprint: */
+		int h=1<<numDilations;
+		int lu=x-binMin[0];
+		int lv=y-binMin[1];
+		size_t stride=size_t(numBins[0]+1);
+		const double* m11=table[size_t(lv+h)*stride+size_t(lu+h)].m;
+		const double* m01=table[size_t(lv+h)*stride+size_t(lu-h)].m;
+		const double* m10=table[size_t(lv-h)*stride+size_t(lu+h)].m;
+		const double* m00=table[size_t(lv-h)*stride+size_t(lu-h)].m;
+		double s[8];
+		for(int i=0;i<8;++i)
+			s[i]=m11[i]-m01[i]-m10[i]+m00[i];
+		
+		/* Integrate the tent filter (1-(u-lu)/h)*(1-(v-lv)/h) over the footprint's points, for weights and for weighted elevations: */
+		double du=double(lu),dv=double(lv);
+		double ih=1.0/double(h);
+		double weight=s[0]-((s[1]-s[0]*du)+(s[2]-s[0]*dv))*ih+(s[3]-dv*s[1]-du*s[2]+s[0]*du*dv)*ih*ih;
+		if(weight<10.0)
+			return false;
+		double sum=s[4]-((s[5]-s[4]*du)+(s[6]-s[4]*dv))*ih+(s[7]-dv*s[5]-du*s[6]+s[4]*du*dv)*ih*ih;
+		value=sum/weight;
+		return true;
+		}
+	};
+
 class PointNormalSampler // Class to sample the implicit surface defined by a LiDAR point cloud and its normal vector at an (x, y) position
 	{
 	/* Elements: */
@@ -378,6 +532,7 @@ class LidarGridder:public Vrui::Application,public GLObject
 		};
 	
 	/* Elements: */
+	static const int arcInfoTileSize[2]; // Width and height of tiles in Arc/Info binary grid files
 	LidarProcessOctree* lpo; // The out-of-core LiDAR octree
 	Cube lpoDomain; // Domain of the LiDAR octree
 	double lpoOffset[3]; // Offset value from octree coordinates to data coordinates
@@ -385,10 +540,27 @@ class LidarGridder:public Vrui::Application,public GLObject
 	double gridCellSize[2]; // Cell size for the extracted DEM
 	int numLobes; // Number of lobes in the Lanczos reconstruction filter
 	Misc::Array<DemVertex,2> dem; // The current DEM
+	unsigned int numThreads; // Number of threads sampling DEM tiles in parallel
+	int tileSize; // Width and height of DEM tiles in grid vertices, or 0 to sample the DEM one vertex at a time
+	double demOrigin[2]; // Position of the DEM's lower-left vertex
+	int demSize[2]; // DEM size in number of vertices
+	Threads::Mutex tileMutex; // Mutex protecting the index of the next tile to be sampled in the current band
+	int nextTileX; // Index of the next tile to be sampled in the current band
+	int bandMin,bandMax; // Range of grid rows in the current band of tiles
+	float* bandElevations; // Elevations of the current band's vertices in octree coordinates
+	int* bandNumDilations; // Number of sampler dilations for each of the current band's vertices
 	
 	/* Private methods: */
+	void calcDemLayout(void);
+	void* tileSamplerThreadMethod(unsigned int threadIndex);
+	void sampleBand(int newBandMin,int newBandMax);
 	void createDem(void);
+	void streamDem(const char* gridFileName,bool arcInfo);
+	void writeBILHeader(const char* imageFileName) const;
 	void writeBILFile(const char* imageFileName) const;
+	void writeArcInfoHeaders(const char* directoryName) const;
+	void writeArcInfoTileFileHeader(Misc::File& tileFile) const;
+	void writeArcInfoTileRow(Misc::File& tileFile,const float* rows,int numRows) const;
 	void writeArcInfoBinaryGridFile(const char* directoryName) const;
 	
 	/* Constructors and destructors: */
@@ -408,6 +580,99 @@ class LidarGridder:public Vrui::Application,public GLObject
 Methods of class LidarGridder:
 *****************************/
 
+const int LidarGridder::arcInfoTileSize[2]={256,4};
+
+void LidarGridder::calcDemLayout(void)
+	{
+	/* Calculate the exact size of the DEM grid: */
+	for(int i=0;i<2;++i)
+		{
+		demSize[i]=int(Math::ceil((gridBox.max[i]-gridBox.min[i])/gridCellSize[i]))+1;
+		double overshoot=double(demSize[i]-1)*gridCellSize[i]-(gridBox.max[i]-gridBox.min[i]);
+		demOrigin[i]=gridBox.min[i]-0.5*overshoot;
+		}
+	}
+
+void* LidarGridder::tileSamplerThreadMethod(unsigned int threadIndex)
+	{
+	TileSampler sampler(demOrigin,gridCellSize);
+	while(true)
+		{
+		/* Grab the next tile in the current band: */
+		int tileX;
+		{
+		Threads::Mutex::Lock tileLock(tileMutex);
+		tileX=nextTileX;
+		++nextTileX;
+		}
+		int tileMin[2],tileMax[2];
+		tileMin[0]=tileX*tileSize;
+		if(tileMin[0]>=demSize[0])
+			break;
+		tileMax[0]=Math::min(tileMin[0]+tileSize,demSize[0]);
+		tileMin[1]=bandMin;
+		tileMax[1]=bandMax;
+		
+		/* Gather the points around the tile once: */
+		lpo->processPointsInBoxBatched(sampler.prepare(tileMin,tileMax),sampler);
+		sampler.finish();
+		
+		/* Sample all of the tile's vertices: */
+		for(int y=tileMin[1];y<tileMax[1];++y)
+			for(int x=tileMin[0];x<tileMax[0];++x)
+				{
+				/* Find the smallest sampler with enough confidence that can be resolved from the tile's points: */
+				int numDilations;
+				double value=0.0;
+				for(numDilations=0;numDilations<=TileSampler::maxNumDilations&&!sampler.sample(x,y,numDilations,value);++numDilations)
+					;
+				
+				if(numDilations>TileSampler::maxNumDilations)
+					{
+					/* Keep dilating a per-vertex sampler beyond the tile's margin: */
+					double pos[2];
+					pos[0]=demOrigin[0]+double(x)*gridCellSize[0];
+					pos[1]=demOrigin[1]+double(y)*gridCellSize[1];
+					SimpleSampler vertexSampler(pos,gridCellSize);
+					for(int i=0;i<numDilations;++i)
+						vertexSampler.dilate();
+					while(true)
+						{
+						lpo->processPointsInBoxBatched(vertexSampler.calcSampleBox(),vertexSampler);
+						if(vertexSampler.getWeight()>=10.0)
+							break;
+						vertexSampler.dilate();
+						++numDilations;
+						}
+					value=vertexSampler.getValue();
+					}
+				
+				/* Store the vertex: */
+				size_t index=size_t(y-bandMin)*size_t(demSize[0])+size_t(x);
+				bandElevations[index]=float(value);
+				bandNumDilations[index]=numDilations;
+				}
+		}
+	
+	return 0;
+	}
+
+void LidarGridder::sampleBand(int newBandMin,int newBandMax)
+	{
+	/* Set up the new band: */
+	bandMin=newBandMin;
+	bandMax=newBandMax;
+	nextTileX=0;
+	
+	/* Sample the band's tiles in parallel: */
+	Threads::Thread* tileSamplerThreads=new Threads::Thread[numThreads];
+	for(unsigned int i=0;i<numThreads;++i)
+		tileSamplerThreads[i].start(this,&LidarGridder::tileSamplerThreadMethod,i);
+	for(unsigned int i=0;i<numThreads;++i)
+		tileSamplerThreads[i].join();
+	delete[] tileSamplerThreads;
+	}
+
 void LidarGridder::createDem(void)
 	{
 	/* Calculate the exact size of the DEM grid: */
@@ -437,69 +702,98 @@ void LidarGridder::createDem(void)
 	/* Sample the LiDAR data set: */
 	Misc::Timer timer;
 	std::cout<<"Calculating DEM...   0% done"<<std::flush;
-	for(int y=0;y<gridSize[1];++y)
+	if(tileSize>0)
 		{
-		for(int x=0;x<gridSize[0];++x)
+		/* Sample the LiDAR data set in bands of tiles: */
+		bandElevations=new float[size_t(tileSize)*size_t(gridSize[0])];
+		bandNumDilations=new int[size_t(tileSize)*size_t(gridSize[0])];
+		for(int y0=0;y0<gridSize[1];y0+=tileSize)
 			{
-			/* Calculate the grid vertex position: */
-			double pos[2];
-			pos[0]=gridOrigin[0]+double(x)*gridCellSize[0];
-			pos[1]=gridOrigin[1]+double(y)*gridCellSize[1];
-			
-			/* Create a sampler: */
-			// PointNormalSampler sampler(pos,gridCellSize,numLobes);
-			SimpleSampler sampler(pos,gridCellSize);
+			int y1=Math::min(y0+tileSize,gridSize[1]);
+			sampleBand(y0,y1);
 			
-			/* Repeatedly dilate the sampler until there is enough confidence in the returned value: */
-			double yTotal=0.0;
-			double wTotal=1.0;
-			int numDilations=0;
-			double confidence;
-			while(true)
-				{
-				/* Sample the LiDAR data set: */
-				lpo->processPointsInBox(sampler.calcSampleBox(),sampler);
-				
-				#if 1
-				if(sampler.getWeight()>=10.0)
-					break;
-				#else
-				/* Calculate the sampling confidence: */
-				confidence=sampler.getWeightSum();
-				if(confidence>=2.0)
+			/* Create the band's DEM vertices: */
+			for(int y=y0;y<y1;++y)
+				for(int x=0;x<gridSize[0];++x)
 					{
-					/* Store the step's contribution and stop: */
-					yTotal+=wTotal*sampler.getValue();
-					break;
+					size_t index=size_t(y-y0)*size_t(gridSize[0])+size_t(x);
+					dem(x,y).texCoord=DemVertex::TexCoord((double(bandNumDilations[index])+0.5)/8,0.0);
+					dem(x,y).position=DemVertex::Position(gridOrigin[0]+double(x)*gridCellSize[0],gridOrigin[1]+double(y)*gridCellSize[1],bandElevations[index]);
 					}
+			std::cout<<"\rCalculating DEM... "<<std::setw(3)<<(100*y1+gridSize[1]/2)/gridSize[1]<<"% done"<<std::flush;
+			}
+		delete[] bandElevations;
+		bandElevations=0;
+		delete[] bandNumDilations;
+		bandNumDilations=0;
+		}
+	else
+		{
+		/* Sample each grid vertex individually: */
+		for(int y=0;y<gridSize[1];++y)
+			{
+			for(int x=0;x<gridSize[0];++x)
+				{
+				/* Calculate the grid vertex position: */
+				double pos[2];
+				pos[0]=gridOrigin[0]+double(x)*gridCellSize[0];
+				pos[1]=gridOrigin[1]+double(y)*gridCellSize[1];
 				
-				/* Calculate the pre-dilation weight for this step: */
-				double pdw=(confidence-0.25)/(1.0-0.25);
-				if(pdw>0.0)
+				/* Create a sampler: */
+				// PointNormalSampler sampler(pos,gridCellSize,numLobes);
+				SimpleSampler sampler(pos,gridCellSize);
+				
+				/* Repeatedly dilate the sampler until there is enough confidence in the returned value: */
+				double yTotal=0.0;
+				double wTotal=1.0;
+				int numDilations=0;
+				double confidence;
+				while(true)
 					{
-					/* Store this step's partial contribution: */
-					yTotal+=wTotal*pdw*sampler.getValue();
-					wTotal*=(1.0-pdw);
+					/* Sample the LiDAR data set: */
+					lpo->processPointsInBoxBatched(sampler.calcSampleBox(),sampler);
+					
+					#if 1
+					if(sampler.getWeight()>=10.0)
+						break;
+					#else
+					/* Calculate the sampling confidence: */
+					confidence=sampler.getWeightSum();
+					if(confidence>=2.0)
+						{
+						/* Store the step's contribution and stop: */
+						yTotal+=wTotal*sampler.getValue();
+						break;
+						}
+					
+					/* Calculate the pre-dilation weight for this step: */
+					double pdw=(confidence-0.25)/(1.0-0.25);
+					if(pdw>0.0)
+						{
+						/* Store this step's partial contribution: */
+						yTotal+=wTotal*pdw*sampler.getValue();
+						wTotal*=(1.0-pdw);
+						}
+					#endif
+					
+					/* Dilate the sampler and try again: */
+					sampler.dilate();
+					++numDilations;
 					}
-				#endif
 				
-				/* Dilate the sampler and try again: */
-				sampler.dilate();
-				++numDilations;
+				/* Create the DEM vertex: */
+				dem(x,y).texCoord=DemVertex::TexCoord((double(numDilations)+0.5)/8,confidence);
+				#if 1
+				yTotal=sampler.getValue();
+				#else
+				DemVertex::Normal n(-sampler.getDiff(0),-sampler.getDiff(1),1);
+				n.normalize();
+				dem(x,y).normal=n;
+				#endif
+				dem(x,y).position=DemVertex::Position(pos[0],pos[1],yTotal);
 				}
-			
-			/* Create the DEM vertex: */
-			dem(x,y).texCoord=DemVertex::TexCoord((double(numDilations)+0.5)/8,confidence);
-			#if 1
-			yTotal=sampler.getValue();
-			#else
-			DemVertex::Normal n(-sampler.getDiff(0),-sampler.getDiff(1),1);
-			n.normalize();
-			dem(x,y).normal=n;
-			#endif
-			dem(x,y).position=DemVertex::Position(pos[0],pos[1],yTotal);
+			std::cout<<"\rCalculating DEM... "<<std::setw(3)<<(100*(y+1)+gridSize[1]/2)/gridSize[1]<<"% done"<<std::flush;
 			}
-		std::cout<<"\rCalculating DEM... "<<std::setw(3)<<(100*(y+1)+gridSize[1]/2)/gridSize[1]<<"% done"<<std::flush;
 		}
 	std::cout<<std::endl;
 	
@@ -530,20 +824,82 @@ void LidarGridder::createDem(void)
 	std::cout<<"Grid generation time: "<<timer.getTime()*1000.0<<" ms"<<std::endl;
 	}
 
-void LidarGridder::writeBILFile(const char* imageFileName) const
+void LidarGridder::streamDem(const char* gridFileName,bool arcInfo)
 	{
-	/* Calculate the exact size of the DEM grid: */
-	double gridOrigin[2];
-	int gridSize[2];
-	for(int i=0;i<2;++i)
+	std::ios::fmtflags flags=std::cout.flags();
+	std::cout.setf(std::ios::fixed);
+	std::streamsize precision=std::cout.precision(3);
+	std::cout<<"Streaming DEM to "<<gridFileName<<":"<<std::endl;
+	std::cout<<"Grid cell size: "<<gridCellSize[0]<<" x "<<gridCellSize[1]<<std::endl;
+	std::cout<<"Grid size: "<<demSize[0]<<" x "<<demSize[1]<<std::endl;
+	std::cout<<"Lower-left corner : "<<demOrigin[0]<<", "<<demOrigin[1]<<std::endl;
+	std::cout<<"Upper-right corner: "<<demOrigin[0]+double(demSize[0]-1)*gridCellSize[0]<<", "<<demOrigin[1]+double(demSize[1]-1)*gridCellSize[1]<<std::endl;
+	std::cout.precision(precision);
+	std::cout.flags(flags);
+	
+	/* Create the output file: */
+	std::string outputFileName(gridFileName);
+	if(arcInfo)
 		{
-		gridSize[i]=int(Math::ceil((gridBox.max[i]-gridBox.min[i])/gridCellSize[i]))+1;
-		double overshoot=double(gridSize[i]-1)*gridCellSize[i]-(gridBox.max[i]-gridBox.min[i]);
-		gridOrigin[i]=gridBox.min[i]-0.5*overshoot;
-		gridOrigin[i]+=lpoOffset[i];
+		writeArcInfoHeaders(gridFileName);
+		outputFileName.append("/w001001.adf");
+		}
+	else
+		writeBILHeader(gridFileName);
+	Misc::File outputFile(outputFileName.c_str(),"wb",arcInfo?Misc::File::BigEndian:Misc::File::LittleEndian);
+	if(arcInfo)
+		writeArcInfoTileFileHeader(outputFile);
+	double elevationOffset=arcInfo?-lpoOffset[2]:lpoOffset[2];
+	
+	/* Sample the LiDAR data set in bands of tiles from the top row down, and write each band as soon as it is finished: */
+	Misc::Timer timer;
+	std::cout<<"Calculating DEM...   0% done"<<std::flush;
+	bandElevations=new float[size_t(tileSize)*size_t(demSize[0])];
+	bandNumDilations=new int[size_t(tileSize)*size_t(demSize[0])];
+	float* rows=new float[size_t(tileSize)*size_t(demSize[0])];
+	for(int row0=0;row0<demSize[1];row0+=tileSize)
+		{
+		int row1=Math::min(row0+tileSize,demSize[1]);
+		sampleBand(demSize[1]-row1,demSize[1]-row0);
+		
+		/* Convert the band to output rows: */
+		for(int row=row0;row<row1;++row)
+			{
+			const float* bandRow=bandElevations+size_t(demSize[1]-1-row-bandMin)*size_t(demSize[0]);
+			float* rowPtr=rows+size_t(row-row0)*size_t(demSize[0]);
+			for(int x=0;x<demSize[0];++x)
+				rowPtr[x]=float(double(bandRow[x])+elevationOffset);
+			}
+		
+		/* Write the output rows: */
+		if(arcInfo)
+			{
+			for(int row=row0;row<row1;row+=arcInfoTileSize[1])
+				writeArcInfoTileRow(outputFile,rows+size_t(row-row0)*size_t(demSize[0]),Math::min(arcInfoTileSize[1],row1-row));
+			}
+		else
+			outputFile.write<float>(rows,size_t(row1-row0)*size_t(demSize[0]));
+		
+		std::cout<<"\rCalculating DEM... "<<std::setw(3)<<(100*row1+demSize[1]/2)/demSize[1]<<"% done"<<std::flush;
 		}
+	std::cout<<std::endl;
+	delete[] rows;
+	delete[] bandElevations;
+	bandElevations=0;
+	delete[] bandNumDilations;
+	bandNumDilations=0;
 	
+	timer.elapse();
+	std::cout<<"Grid generation time: "<<timer.getTime()*1000.0<<" ms"<<std::endl;
+	}
+
+void LidarGridder::writeBILHeader(const char* imageFileName) const
 	{
+	/* Calculate the DEM's origin in data coordinates: */
+	double gridOrigin[2];
+	for(int i=0;i<2;++i)
+		gridOrigin[i]=demOrigin[i]+lpoOffset[i];
+	
 	/* Remove the file name extension from the image file name: */
 	const char* extPtr=0;
 	const char* ifnPtr;
@@ -561,15 +917,20 @@ void LidarGridder::writeBILFile(const char* imageFileName) const
 	fprintf(headerFile.getFilePtr(),"LAYOUT BIL\r\n");
 	fprintf(headerFile.getFilePtr(),"NBANDS 1\r\n");
 	fprintf(headerFile.getFilePtr(),"NBITS 32\r\n");
-	fprintf(headerFile.getFilePtr(),"NCOLS %d\r\n",dem.getSize(0));
-	fprintf(headerFile.getFilePtr(),"NROWS %d\r\n",dem.getSize(1));
-	fprintf(headerFile.getFilePtr(),"BANDROWBYTES %u\r\n",(unsigned int)(dem.getSize(0)*sizeof(float)));
-	fprintf(headerFile.getFilePtr(),"TOTALROWBYTES %u\r\n",(unsigned int)(dem.getSize(0)*sizeof(float)));
+	fprintf(headerFile.getFilePtr(),"NCOLS %d\r\n",demSize[0]);
+	fprintf(headerFile.getFilePtr(),"NROWS %d\r\n",demSize[1]);
+	fprintf(headerFile.getFilePtr(),"BANDROWBYTES %u\r\n",(unsigned int)(demSize[0]*sizeof(float)));
+	fprintf(headerFile.getFilePtr(),"TOTALROWBYTES %u\r\n",(unsigned int)(demSize[0]*sizeof(float)));
 	fprintf(headerFile.getFilePtr(),"ULXMAP %f\r\n",gridOrigin[0]);
-	fprintf(headerFile.getFilePtr(),"ULYMAP %f\r\n",gridOrigin[1]+double(gridSize[1]-1)*gridCellSize[1]);
+	fprintf(headerFile.getFilePtr(),"ULYMAP %f\r\n",gridOrigin[1]+double(demSize[1]-1)*gridCellSize[1]);
 	fprintf(headerFile.getFilePtr(),"XDIM %f\r\n",gridCellSize[0]);
 	fprintf(headerFile.getFilePtr(),"YDIM %f\r\n",gridCellSize[1]);
 	}
+
+void LidarGridder::writeBILFile(const char* imageFileName) const
+	{
+	/* Create the header file: */
+	writeBILHeader(imageFileName);
 	
 	/* Create the image file: */
 	Misc::File imageFile(imageFileName,"wb",Misc::File::LittleEndian);
@@ -578,25 +939,14 @@ void LidarGridder::writeBILFile(const char* imageFileName) const
 			imageFile.write(float(dem(x,dem.getSize(1)-1-y).position[2]+lpoOffset[2]));
 	}
 
-void LidarGridder::writeArcInfoBinaryGridFile(const char* directoryName) const
+void LidarGridder::writeArcInfoHeaders(const char* directoryName) const
 	{
-	/* Calculate the exact size of the DEM grid: */
-	double gridOrigin[2];
-	int gridSize[2];
-	for(int i=0;i<2;++i)
-		{
-		gridSize[i]=int(Math::ceil((gridBox.max[i]-gridBox.min[i])/gridCellSize[i]))+1;
-		double overshoot=double(gridSize[i]-1)*gridCellSize[i]-(gridBox.max[i]-gridBox.min[i]);
-		gridOrigin[i]=gridBox.min[i]-0.5*overshoot;
-		}
-	
 	/* Calculate the DEM's tile layout: */
-	int tileSize[2]={256,4};
 	int numTiles[2];
 	for(int i=0;i<2;++i)
-		numTiles[i]=(gridSize[i]+tileSize[i]-1)/tileSize[i];
+		numTiles[i]=(demSize[i]+arcInfoTileSize[i]-1)/arcInfoTileSize[i];
 	unsigned int totalNumTiles=(unsigned int)numTiles[0]*(unsigned int)numTiles[1];
-	unsigned int fileTileSize=(unsigned int)tileSize[0]*(unsigned int)tileSize[1]*sizeof(float);
+	unsigned int fileTileSize=(unsigned int)arcInfoTileSize[0]*(unsigned int)arcInfoTileSize[1]*sizeof(float);
 	
 	{
 	/* Create the DEM's base directory: */
@@ -647,15 +997,15 @@ void LidarGridder::writeArcInfoBinaryGridFile(const char* directoryName) const
 	
 	/* Calculate and write reference values: */
 	double ref[2];
-	ref[0]=gridOrigin[0]-lpoOffset[0]-0.5-(double(numTiles[0])*double(tileSize[0])*gridCellSize[0])/2.0;
-	ref[1]=gridOrigin[1]-lpoOffset[1]-0.5-(3.0*double(numTiles[1])*double(tileSize[1])*gridCellSize[1])/2.0;
+	ref[0]=demOrigin[0]-lpoOffset[0]-0.5-(double(numTiles[0])*double(arcInfoTileSize[0])*gridCellSize[0])/2.0;
+	ref[1]=demOrigin[1]-lpoOffset[1]-0.5-(3.0*double(numTiles[1])*double(arcInfoTileSize[1])*gridCellSize[1])/2.0;
 	headerFile.write<double>(ref,2);
 	
 	/* Write the DEM's tile layout: */
 	headerFile.write<int>(numTiles,2);
-	headerFile.write<int>(tileSize[0]);
+	headerFile.write<int>(arcInfoTileSize[0]);
 	headerFile.write<int>(1);
-	headerFile.write<int>(tileSize[1]);
+	headerFile.write<int>(arcInfoTileSize[1]);
 	}
 	
 	{
@@ -665,10 +1015,10 @@ void LidarGridder::writeArcInfoBinaryGridFile(const char* directoryName) const
 	Misc::File boundaryFile(boundaryFileName.c_str(),"wb",Misc::File::BigEndian);
 	
 	/* Write the DEM's boundaries: */
-	boundaryFile.write<double>(gridOrigin[0]-lpoOffset[0]-0.5);
-	boundaryFile.write<double>(gridOrigin[1]-lpoOffset[1]-0.5);
-	boundaryFile.write<double>(gridOrigin[0]+double(gridSize[0])*gridCellSize[0]-lpoOffset[0]-0.5);
-	boundaryFile.write<double>(gridOrigin[1]+double(gridSize[1])*gridCellSize[1]-lpoOffset[1]-0.5);
+	boundaryFile.write<double>(demOrigin[0]-lpoOffset[0]-0.5);
+	boundaryFile.write<double>(demOrigin[1]-lpoOffset[1]-0.5);
+	boundaryFile.write<double>(demOrigin[0]+double(demSize[0])*gridCellSize[0]-lpoOffset[0]-0.5);
+	boundaryFile.write<double>(demOrigin[1]+double(demSize[1])*gridCellSize[1]-lpoOffset[1]-0.5);
 	}
 	
 	{
@@ -703,12 +1053,15 @@ void LidarGridder::writeArcInfoBinaryGridFile(const char* directoryName) const
 		fileTileOffset+=fileTileSize;
 		}
 	}
-	
+	}
+
+void LidarGridder::writeArcInfoTileFileHeader(Misc::File& tileFile) const
 	{
-	/* Write the tile data file: */
-	std::string tileFileName(directoryName);
-	tileFileName.append("/w001001.adf");
-	Misc::File tileFile(tileFileName.c_str(),"wb",Misc::File::BigEndian);
+	/* Calculate the DEM's tile layout: */
+	unsigned int totalNumTiles=1U;
+	for(int i=0;i<2;++i)
+		totalNumTiles*=(unsigned int)((demSize[i]+arcInfoTileSize[i]-1)/arcInfoTileSize[i]);
+	unsigned int fileTileSize=(unsigned int)arcInfoTileSize[0]*(unsigned int)arcInfoTileSize[1]*sizeof(float);
 	
 	/* Write tile file magic number: */
 	unsigned int tileFileMagic[2]={0x0000270aU,0xfffffc14U};
@@ -726,41 +1079,58 @@ void LidarGridder::writeArcInfoBinaryGridFile(const char* directoryName) const
 	for(size_t i=0;i<sizeof(dummy2)/sizeof(dummy2[0]);++i)
 		dummy2[i]=0U;
 	tileFile.write<unsigned int>(dummy2,sizeof(dummy2)/sizeof(dummy2[0]));
-	
-	/* Write all tiles: */
-	float* tile=new float[tileSize[0]*tileSize[1]];
-	for(int tileY=0;tileY<numTiles[1];++tileY)
-		for(int tileX=0;tileX<numTiles[0];++tileX)
-			{
-			/* Calculate the tile's position: */
-			int tileMin[2],tileMax[2];
-			tileMin[0]=tileX*tileSize[0];
-			tileMin[1]=tileY*tileSize[1];
-			tileMax[0]=(tileX+1)*tileSize[0];
-			tileMax[1]=(tileY+1)*tileSize[1];
-			
-			/* Clamp the tile against the DEM: */
-			if(tileMax[0]>dem.getSize(0))
-				tileMax[0]=dem.getSize(0);
-			if(tileMax[1]>dem.getSize(1))
-				tileMax[1]=dem.getSize(1);
-			
-			/* Copy tile data: */
-			for(int y=tileMin[1];y<tileMax[1];++y)
-				for(int x=tileMin[0];x<tileMax[0];++x)
-					tile[(y-tileMin[1])*tileSize[0]+(x-tileMin[0])]=float(dem(x,dem.getSize(1)-1-y).position[2]-lpoOffset[2]);
-			
-			/* Write the tile: */
-			tileFile.write<short>(fileTileSize/2U);
-			tileFile.write<float>(tile,tileSize[0]*tileSize[1]);
-			}
-	delete[] tile;
 	}
+
+void LidarGridder::writeArcInfoTileRow(Misc::File& tileFile,const float* rows,int numRows) const
+	{
+	/* Write all tiles covering the given rows, from left to right: */
+	unsigned int fileTileSize=(unsigned int)arcInfoTileSize[0]*(unsigned int)arcInfoTileSize[1]*sizeof(float);
+	std::vector<float> tile(size_t(arcInfoTileSize[0])*size_t(arcInfoTileSize[1]));
+	for(int tileX=0;tileX*arcInfoTileSize[0]<demSize[0];++tileX)
+		{
+		/* Copy tile data, padding the tile where it extends past the DEM: */
+		for(int y=0;y<arcInfoTileSize[1];++y)
+			for(int x=0;x<arcInfoTileSize[0];++x)
+				{
+				int demX=tileX*arcInfoTileSize[0]+x;
+				tile[y*arcInfoTileSize[0]+x]=y<numRows&&demX<demSize[0]?rows[size_t(y)*size_t(demSize[0])+size_t(demX)]:0.0f;
+				}
+		
+		/* Write the tile: */
+		tileFile.write<short>(fileTileSize/2U);
+		tileFile.write<float>(&tile[0],tile.size());
+		}
+	}
+
+void LidarGridder::writeArcInfoBinaryGridFile(const char* directoryName) const
+	{
+	/* Write the DEM's header, boundary, and tile index files: */
+	writeArcInfoHeaders(directoryName);
+	
+	/* Write the tile data file: */
+	std::string tileFileName(directoryName);
+	tileFileName.append("/w001001.adf");
+	Misc::File tileFile(tileFileName.c_str(),"wb",Misc::File::BigEndian);
+	writeArcInfoTileFileHeader(tileFile);
+	
+	/* Write all tiles one row of tiles at a time: */
+	float* rows=new float[size_t(arcInfoTileSize[1])*size_t(dem.getSize(0))];
+	for(int row0=0;row0<dem.getSize(1);row0+=arcInfoTileSize[1])
+		{
+		int numRows=Math::min(arcInfoTileSize[1],dem.getSize(1)-row0);
+		for(int y=0;y<numRows;++y)
+			for(int x=0;x<dem.getSize(0);++x)
+				rows[size_t(y)*size_t(dem.getSize(0))+size_t(x)]=float(dem(x,dem.getSize(1)-1-(row0+y)).position[2]-lpoOffset[2]);
+		writeArcInfoTileRow(tileFile,rows,numRows);
+		}
+	delete[] rows;
 	}
 
 LidarGridder::LidarGridder(int& argc,char**& argv)
 	:Vrui::Application(argc,argv),
-	 lpo(0)
+	 lpo(0),
+	 numThreads(1),tileSize(0),
+	 bandElevations(0),bandNumDilations(0)
 	{
 	/* Parse the command line: */
 	const char* lidarFileName=0;
@@ -769,6 +1139,8 @@ LidarGridder::LidarGridder(int& argc,char**& argv)
 	gridCellSize[0]=gridCellSize[1]=1.0;
 	numLobes=3;
 	const char* gridFileName=0;
+	bool stream=false;
+	bool arcInfo=false;
 	for(int i=1;i<argc;++i)
 		{
 		if(argv[i][0]=='-')
@@ -807,6 +1179,20 @@ LidarGridder::LidarGridder(int& argc,char**& argv)
 				++i;
 				numLobes=atoi(argv[i]);
 				}
+			else if(strcasecmp(argv[i]+1,"tileSize")==0)
+				{
+				++i;
+				tileSize=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"threads")==0)
+				{
+				++i;
+				numThreads=(unsigned int)atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"stream")==0)
+				stream=true;
+			else if(strcasecmp(argv[i]+1,"arcInfo")==0)
+				arcInfo=true;
 			else
 				std::cerr<<"Unrecognized switch "<<argv[i]<<std::endl;
 			}
@@ -819,9 +1205,23 @@ LidarGridder::LidarGridder(int& argc,char**& argv)
 		}
 	if(lidarFileName==0)
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No LiDAR file name provided");
+	if(stream&&gridFileName==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No grid file name provided for streamed DEM");
+	if(numThreads<1)
+		numThreads=1;
+	
+	/* Sample in tiles if requested directly, or implied by multithreading or streaming: */
+	if(tileSize<=0&&(numThreads>1||stream))
+		tileSize=128;
+	if(tileSize<0)
+		tileSize=0;
+	
+	/* Round the tile size up to whole rows of Arc/Info tiles: */
+	if(arcInfo)
+		tileSize=((tileSize+arcInfoTileSize[1]-1)/arcInfoTileSize[1])*arcInfoTileSize[1];
 	
 	/* Open the LiDAR data set: */
-	lpo=new LidarProcessOctree(lidarFileName,cacheSize*1024*1024);
+	lpo=new LidarProcessOctree(lidarFileName,cacheSize*1024*1024,0,false,true);
 	lpoDomain=lpo->getDomain();
 	for(int i=0;i<3;++i)
 		lpoOffset[i]=lpo->getOffset()[i];
@@ -846,30 +1246,49 @@ LidarGridder::LidarGridder(int& argc,char**& argv)
 			gridBox.max[i]=lpoDomain.getMax()[i];
 		}
 	
-	/* Sample the initial DEM: */
-	createDem();
+	/* Calculate the DEM's layout: */
+	calcDemLayout();
 	
-	if(gridFileName!=0)
+	if(stream)
 		{
-		#if 0
-		/* Save the dem as a grid file: */
-		Misc::File gridFile(gridFileName,"wb",Misc::File::LittleEndian);
-		gridFile.write<int>(dem.getSize(0));
-		gridFile.write<int>(dem.getSize(1));
-		gridFile.write<float>(dem(0,0).position[0]);
-		gridFile.write<float>(dem(0,0).position[1]);
-		gridFile.write<float>(dem(dem.getSize(0)-1,dem.getSize(1)-1).position[0]);
-		gridFile.write<float>(dem(dem.getSize(0)-1,dem.getSize(1)-1).position[1]);
-		for(int y=0;y<dem.getSize(1);++y)
-			for(int x=0;x<dem.getSize(0);++x)
-				gridFile.write<float>(dem(x,y).position[2]);
-		#elif 0
-		/* Save the dem as an Arc/Info binary grid file: */
-		writeArcInfoBinaryGridFile(gridFileName);
-		#else
-		/* Save the dem as a BIL file: */
-		writeBILFile(gridFileName);
-		#endif
+		/* Write the DEM straight to the grid file without holding it in memory: */
+		streamDem(gridFileName,arcInfo);
+		
+		/* There is no in-memory DEM to display: */
+		Vrui::shutdown();
+		}
+	else
+		{
+		/* Sample the initial DEM: */
+		createDem();
+		
+		if(gridFileName!=0)
+			{
+			#if 0
+			/* Save the dem as a grid file: */
+			Misc::File gridFile(gridFileName,"wb",Misc::File::LittleEndian);
+			gridFile.write<int>(dem.getSize(0));
+			gridFile.write<int>(dem.getSize(1));
+			gridFile.write<float>(dem(0,0).position[0]);
+			gridFile.write<float>(dem(0,0).position[1]);
+			gridFile.write<float>(dem(dem.getSize(0)-1,dem.getSize(1)-1).position[0]);
+			gridFile.write<float>(dem(dem.getSize(0)-1,dem.getSize(1)-1).position[1]);
+			for(int y=0;y<dem.getSize(1);++y)
+				for(int x=0;x<dem.getSize(0);++x)
+					gridFile.write<float>(dem(x,y).position[2]);
+			#else
+			if(arcInfo)
+				{
+				/* Save the dem as an Arc/Info binary grid file: */
+				writeArcInfoBinaryGridFile(gridFileName);
+				}
+			else
+				{
+				/* Save the dem as a BIL file: */
+				writeBILFile(gridFileName);
+				}
+			#endif
+			}
 		}
 	}
 
@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarIlluminator - Post-processing filter to calculate normal vectors
 for each point in a LiDAR data set.
-Copyright (c) 2008-2011 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -30,6 +30,32 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarProcessOctree.h"
 #include "NormalCalculator.h"
 
+template <class NormalCalculatorParam>
+bool calcNormals(LidarProcessOctree& lpo,const NormalCalculatorParam& nc,const char* normalFileName,const char* outlierFileName,unsigned int numThreads) // Calculates normal vectors for all points in the octree with the given normal calculator; returns false on error
+	{
+	/* Create a node functor: */
+	NodeNormalCalculator<NormalCalculatorParam> nodeNormalCalculator(lpo,nc,normalFileName);
+	
+	/* Enable saving of outliers if requested: */
+	if(outlierFileName!=0)
+		nodeNormalCalculator.saveOutlierPoints(outlierFileName);
+	
+	/* Calculate normal vectors for all points in the octree, processing many nodes at once when multithreaded: */
+	std::cout<<"Calculating normal vectors...   0%"<<std::flush;
+	if(numThreads>1)
+		lpo.processNodesPostfixParallel(nodeNormalCalculator,numThreads);
+	else
+		lpo.processNodesPostfix(nodeNormalCalculator);
+	std::cout<<std::endl;
+	if(!nodeNormalCalculator.getErrorMessage().empty())
+		{
+		std::cerr<<"Error while calculating normal vectors: "<<nodeNormalCalculator.getErrorMessage()<<std::endl;
+		return false;
+		}
+	
+	return true;
+	}
+
 int main(int argc,char* argv[])
 	{
 	const char* fileName=0;
@@ -38,6 +64,7 @@ int main(int argc,char* argv[])
 	int cacheSize=512;
 	const char* outlierFileName=0;
 	unsigned int numThreads=1;
+	bool mapDataFiles=false;
 	for(int i=1;i<argc;++i)
 		{
 		if(argv[i][0]=='-')
@@ -67,6 +94,8 @@ int main(int argc,char* argv[])
 				++i;
 				outlierFileName=argv[i];
 				}
+			else if(strcasecmp(argv[i]+1,"mmap")==0)
+				mapDataFiles=true;
 			}
 		else if(fileName==0)
 			fileName=argv[i];
@@ -78,7 +107,10 @@ int main(int argc,char* argv[])
 		}
 	
 	/* Create a processing octree: */
-	LidarProcessOctree lpo(fileName,size_t(cacheSize)*size_t(1024*1024));
+	LidarProcessOctree lpo(fileName,size_t(cacheSize)*size_t(1024*1024),0,mapDataFiles,true);
+	
+	/* Load nodes in the background ahead of the traversal: */
+	lpo.startPrefetching();
 	
 	/* Create the output file name: */
 	std::string normalFileName=fileName;
@@ -86,53 +118,27 @@ int main(int argc,char* argv[])
 	normalFileName.append("Normals");
 	
 	/* Check which version of the normal calculator to use: */
+	bool ok;
 	if(maxNumNeighbors>0)
 		{
 		/* Create a fixed-neighborhood normal vector calculation functor: */
 		if(radius>Scalar(0))
 			{
 			NumberRadiusNormalCalculator nc(maxNumNeighbors,radius);
-			NodeNormalCalculator<NumberRadiusNormalCalculator> nodeNormalCalculator(lpo,nc,normalFileName.c_str(),numThreads);
-			
-			/* Enable saving of outliers if requested: */
-			if(outlierFileName!=0)
-				nodeNormalCalculator.saveOutlierPoints(outlierFileName);
-			
-			/* Calculate normal vectors for all points in the octree: */
-			std::cout<<"Calculating normal vectors...   0%"<<std::flush;
-			lpo.processNodesPostfix(nodeNormalCalculator);
-			std::cout<<std::endl;
+			ok=calcNormals(lpo,nc,normalFileName.c_str(),outlierFileName,numThreads);
 			}
 		else
 			{
 			NumberRadiusNormalCalculator nc(maxNumNeighbors);
-			NodeNormalCalculator<NumberRadiusNormalCalculator> nodeNormalCalculator(lpo,nc,normalFileName.c_str(),numThreads);
-			
-			/* Enable saving of outliers if requested: */
-			if(outlierFileName!=0)
-				nodeNormalCalculator.saveOutlierPoints(outlierFileName);
-			
-			/* Calculate normal vectors for all points in the octree: */
-			std::cout<<"Calculating normal vectors...   0%"<<std::flush;
-			lpo.processNodesPostfix(nodeNormalCalculator);
-			std::cout<<std::endl;
+			ok=calcNormals(lpo,nc,normalFileName.c_str(),outlierFileName,numThreads);
 			}
 		}
 	else
 		{
 		/* Create a fixed-radius normal vector calculation functor: */
 		RadiusNormalCalculator nc(radius);
-		NodeNormalCalculator<RadiusNormalCalculator> nodeNormalCalculator(lpo,nc,normalFileName.c_str(),numThreads);
-		
-		/* Enable saving of outliers if requested: */
-		if(outlierFileName!=0)
-			nodeNormalCalculator.saveOutlierPoints(outlierFileName);
-		
-		/* Calculate normal vectors for all points in the octree: */
-		std::cout<<"Calculating normal vectors...   0%"<<std::flush;
-		lpo.processNodesPostfix(nodeNormalCalculator);
-		std::cout<<std::endl;
+		ok=calcNormals(lpo,nc,normalFileName.c_str(),outlierFileName,numThreads);
 		}
 	
-	return 0;
+	return ok?0:1;
 	}
@@ -0,0 +1,104 @@
+/***********************************************************************
+LidarMappedFile - Class to map LiDAR point or ancillary data files into
+memory for in-place read access.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarMappedFile.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <Misc/StdError.h>
+
+/********************************
+Methods of class LidarMappedFile:
+********************************/
+
+LidarMappedFile::LidarMappedFile(const char* fileName)
+	:fd(-1),size(0),memory(0),recordSize(0)
+	{
+	#if __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+	/* LiDAR data files are little-endian, and mapped records are used in place: */
+	throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot map little-endian file %s on big-endian host",fileName);
+	#endif
+	
+	/* Open the file: */
+	fd=open(fileName,O_RDONLY);
+	if(fd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot open file %s",fileName);
+	
+	/* Get the file's size: */
+	struct stat fileStats;
+	if(fstat(fd,&fileStats)<0||size_t(fileStats.st_size)<LidarDataFileHeader::getFileSize())
+		{
+		int error=errno;
+		close(fd);
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot determine size of file %s",fileName);
+		}
+	size=size_t(fileStats.st_size);
+	
+	/* Map the entire file read-only: */
+	void* mapping=mmap(0,size,PROT_READ,MAP_SHARED,fd,0);
+	if(mapping==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot map file %s",fileName);
+		}
+	memory=static_cast<const unsigned char*>(mapping);
+	
+	/* Node data is accessed in octree order, not file order; disable aggressive read-ahead: */
+	madvise(mapping,size,MADV_RANDOM);
+	
+	/* Read the data file's header: */
+	recordSize=*reinterpret_cast<const unsigned int*>(memory);
+	}
+
+LidarMappedFile::~LidarMappedFile(void)
+	{
+	/* Unmap and close the file: */
+	munmap(const_cast<unsigned char*>(memory),size);
+	close(fd);
+	}
+
+void LidarMappedFile::checkRecords(LidarFile::Offset recordIndex,unsigned int numRecords) const
+	{
+	/* Check the end of the record range against the file size: */
+	size_t end=LidarDataFileHeader::getFileSize()+(size_t(recordIndex)+size_t(numRecords))*size_t(recordSize);
+	if(end>size)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Record range %llu+%u outside of mapped file",(unsigned long long)recordIndex,numRecords);
+	}
+
+void LidarMappedFile::adviseWillNeed(LidarFile::Offset recordIndex,unsigned int numRecords) const
+	{
+	/* Align the record range to page boundaries: */
+	size_t pageSize=size_t(sysconf(_SC_PAGESIZE));
+	size_t start=LidarDataFileHeader::getFileSize()+size_t(recordIndex)*size_t(recordSize);
+	size_t end=start+size_t(numRecords)*size_t(recordSize);
+	if(end>size)
+		end=size;
+	start&=~(pageSize-1);
+	if(start<end)
+		madvise(const_cast<unsigned char*>(memory)+start,end-start,MADV_WILLNEED);
+	}
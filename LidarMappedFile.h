@@ -0,0 +1,67 @@
+/***********************************************************************
+LidarMappedFile - Class to map LiDAR point or ancillary data files into
+memory for in-place read access.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARMAPPEDFILE_INCLUDED
+#define LIDARMAPPEDFILE_INCLUDED
+
+#include <stddef.h>
+
+#include "LidarFile.h"
+
+class LidarMappedFile
+	{
+	/* Elements: */
+	private:
+	int fd; // File descriptor of the mapped file
+	size_t size; // Total size of the mapped file in bytes
+	const unsigned char* memory; // Pointer to the beginning of the mapped file
+	unsigned int recordSize; // Record size read from the data file's header
+	
+	/* Constructors and destructors: */
+	public:
+	LidarMappedFile(const char* fileName); // Maps the LiDAR data file of the given name read-only; throws exception if file cannot be mapped
+	private:
+	LidarMappedFile(const LidarMappedFile& source); // Prohibit copy constructor
+	LidarMappedFile& operator=(const LidarMappedFile& source); // Prohibit assignment operator
+	public:
+	~LidarMappedFile(void); // Unmaps and closes the file
+	
+	/* Methods: */
+	size_t getSize(void) const // Returns the size of the mapped file in bytes
+		{
+		return size;
+		}
+	unsigned int getRecordSize(void) const // Returns the record size stored in the data file's header
+		{
+		return recordSize;
+		}
+	template <class RecordParam>
+	const RecordParam* getRecords(LidarFile::Offset recordIndex) const // Returns a pointer to the record of the given index inside the mapped file
+		{
+		return reinterpret_cast<const RecordParam*>(memory+LidarDataFileHeader::getFileSize()+size_t(recordIndex)*size_t(recordSize));
+		}
+	void checkRecords(LidarFile::Offset recordIndex,unsigned int numRecords) const; // Throws exception if the given range of records is not inside the mapped file
+	void adviseWillNeed(LidarFile::Offset recordIndex,unsigned int numRecords) const; // Tells the operating system that the given range of records will be accessed soon
+	};
+
+#endif
@@ -0,0 +1,160 @@
+/***********************************************************************
+LidarNodeSummary - Structure summarizing the points and attributes in
+the subtree of a LiDAR octree node, used to prune queries without
+loading point data.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARNODESUMMARY_INCLUDED
+#define LIDARNODESUMMARY_INCLUDED
+
+#include <string>
+#include <Misc/SizedTypes.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+#include "LidarTypes.h"
+#include "Cube.h"
+#include "LidarFile.h"
+
+/***********************************************************************
+Node summaries are stored in an optional data file named Summaries
+inside a LiDAR file directory. It starts with a LidarDataFileHeader
+holding the size of one record, followed by one record per octree node
+in the order in which the nodes appear in the Index file, i.e., the root
+node first. Each record covers all points in its node's subtree.
+***********************************************************************/
+
+struct LidarNodeSummary
+	{
+	/* Elements: */
+	public:
+	Box bounds; // Tight bounding box of the points in the node's subtree; the z range is the subtree's elevation range; empty if the subtree has no points
+	Misc::UInt32 classMask; // Bit mask of the point classifications occurring in the subtree; classifications 31 and higher share bit 31; all bits set if unknown
+	Misc::UInt16 intensityRange[2]; // Minimum and maximum point intensity in the subtree; full range if unknown
+	
+	/* Constructors and destructors: */
+	LidarNodeSummary(void) // Creates a summary of an empty subtree
+		:bounds(Box::empty),classMask(0x0U)
+		{
+		intensityRange[0]=Misc::UInt16(65535U);
+		intensityRange[1]=Misc::UInt16(0U);
+		}
+	
+	/* Methods: */
+	static std::string getFileName(const char* lidarFileName) // Returns the name of the summaries file inside the given LiDAR file
+		{
+		std::string result=lidarFileName;
+		result.append("/Summaries");
+		return result;
+		}
+	static size_t getFileSize(void) // Returns the file size of a node summary
+		{
+		return sizeof(Scalar)*3*2+sizeof(Misc::UInt32)+sizeof(Misc::UInt16)*2;
+		}
+	static Misc::UInt32 getClassBit(unsigned int classification) // Returns the class mask bit representing the given point classification
+		{
+		return Misc::UInt32(1U)<<(classification<31U?classification:31U);
+		}
+	void read(LidarSourceFile& file) // Reads the node summary from file
+		{
+		file.read(bounds.min.getComponents(),3);
+		file.read(bounds.max.getComponents(),3);
+		file.read(classMask);
+		file.read(intensityRange,2);
+		}
+	void write(LidarFile& file) const // Writes the node summary to file
+		{
+		file.write(bounds.min.getComponents(),3);
+		file.write(bounds.max.getComponents(),3);
+		file.write(classMask);
+		file.write(intensityRange,2);
+		}
+	bool isEmpty(void) const // Returns true if the node's subtree has no points
+		{
+		return bounds.min[0]>bounds.max[0];
+		}
+	void addPoint(const Point& point) // Adds a point to the summary
+		{
+		bounds.addPoint(point);
+		}
+	void addClassification(unsigned int classification) // Adds a point classification to the summary
+		{
+		classMask|=getClassBit(classification);
+		}
+	void addIntensity(Misc::UInt16 intensity) // Adds a point intensity to the summary
+		{
+		if(intensityRange[0]>intensity)
+			intensityRange[0]=intensity;
+		if(intensityRange[1]<intensity)
+			intensityRange[1]=intensity;
+		}
+	void addSummary(const LidarNodeSummary& other) // Merges the summary of a child node into this summary
+		{
+		if(!other.isEmpty())
+			{
+			bounds.addBox(other.bounds);
+			classMask|=other.classMask;
+			if(intensityRange[0]>other.intensityRange[0])
+				intensityRange[0]=other.intensityRange[0];
+			if(intensityRange[1]<other.intensityRange[1])
+				intensityRange[1]=other.intensityRange[1];
+			}
+		}
+	int compareBox(const Box& box) const // Compares the subtree's bounds against the given query box with the same result semantics as Cube::compareBox; conservative for points on the box's faces
+		{
+		if(isEmpty())
+			return Cube::SEPARATE;
+		int result=Cube::OVERLAPS|Cube::CONTAINS;
+		for(int i=0;i<3;++i)
+			{
+			if(bounds.max[i]<box.min[i]||bounds.min[i]>box.max[i])
+				return Cube::SEPARATE;
+			if(bounds.min[i]<=box.min[i]||bounds.max[i]>=box.max[i])
+				result&=~Cube::CONTAINS;
+			}
+		return result;
+		}
+	Scalar sqrDist(const Point& point) const // Returns the squared distance from the point to the subtree's bounds, or 0 if the bounds contain the point
+		{
+		if(isEmpty())
+			return Math::Constants<Scalar>::max;
+		Scalar result=Scalar(0);
+		for(int i=0;i<3;++i)
+			{
+			Scalar d;
+			if((d=point[i]-bounds.max[i])>Scalar(0))
+				result+=Math::sqr(d);
+			else if((d=point[i]-bounds.min[i])<Scalar(0))
+				result+=Math::sqr(d);
+			}
+		return result;
+		}
+	bool overlapsClasses(Misc::UInt32 queryClassMask) const // Returns true if the subtree may contain points of any of the given classifications
+		{
+		return (classMask&queryClassMask)!=0x0U;
+		}
+	bool overlapsIntensities(Misc::UInt16 min,Misc::UInt16 max) const // Returns true if the subtree may contain points with intensities in the given closed range
+		{
+		return intensityRange[0]<=max&&intensityRange[1]>=min;
+		}
+	};
+
+#endif
@@ -1,6 +1,6 @@
 /***********************************************************************
 LidarOctree - Class to render multiresolution LiDAR point sets.
-Copyright (c) 2005-2025 Oliver Kreylos
+Copyright (c) 2005-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,10 +24,15 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include <string.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <Misc/StdError.h>
 #include <Misc/SelfDestructArray.h>
+#include <Misc/Timer.h>
+#include <Misc/StringMarshaller.h>
+#include <Misc/HashTable.h>
 #include <Geometry/Ray.h>
 #include <Geometry/Box.h>
 #include <GL/gl.h>
@@ -35,11 +40,20 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <GL/GLContextData.h>
 #include <GL/GLExtensionManager.h>
 #include <GL/Extensions/GLARBPointParameters.h>
+#include <GL/Extensions/GLARBShaderObjects.h>
 #include <GL/Extensions/GLARBVertexBufferObject.h>
 #include <GL/GLFrustum.h>
 
 #include "CoarseningHeap.h"
+#include "CoarseningClock.h"
+#include "SubdivisionRequestHeap.h"
 #include "PointBasedLightingShader.h"
+#include "LidarMappedFile.h"
+#include "LidarCompressedFile.h"
+#include "LidarQuantization.h"
+#include "LidarCacheManager.h"
+#include "SystemMemory.h"
+#include "TraceEvents.h"
 
 /**********************************
 Methods of class LidarOctree::Node:
@@ -47,18 +61,32 @@ Methods of class LidarOctree::Node:
 
 LidarOctree::Node::~Node(void)
 	{
-	/* Delete point array: */
-	if(haveNormals)
-		delete[] static_cast<NVertex*>(points);
-	else
-		delete[] static_cast<Vertex*>(points);
-	
-	/* Delete selected point flag mask: */
-	delete[] selectedPoints;
+	/* Delete selected point mask; the point array is returned to the octree's point array pool separately: */
+	delete[] selectionMask;
 	delete[] selectedPointColors;
+	delete selectedPointMoments;
+	}
+
+void LidarOctree::Node::updateTraversalState(unsigned int renderPass,Scalar LOD) const
+	{
+	/* Pack the render pass and LOD value into one word; non-negative floats order like their bit patterns: */
+	union
+		{
+		Misc::UInt32 i;
+		Scalar f;
+		} lod;
+	lod.f=LOD>Scalar(0)?LOD:Scalar(0);
+	Misc::UInt64 newState=(Misc::UInt64(renderPass)<<32)|Misc::UInt64(lod.i);
 	
-	/* Delete children: */
-	delete[] children;
+	/* Replace the node's state until it is from the same pass with at least the same LOD value, or from a later pass: */
+	Misc::UInt64 state=traversalState.get();
+	while(state<newState)
+		{
+		Misc::UInt64 oldState=traversalState.compareAndSwap(state,newState);
+		if(oldState==state)
+			break;
+		state=oldState;
+		}
 	}
 
 namespace {
@@ -101,6 +129,110 @@ intersectConeWithPoints(
 		}
 	}
 
+/****************************************************************
+Helper functions to intersect a cone with a node's point kd-tree:
+****************************************************************/
+
+struct ConeTraversal // Structure holding per-node constants for cone intersection with a point kd-tree
+	{
+	/* Elements: */
+	public:
+	Scalar coneAngleCos; // Cosine of the cone's opening angle
+	Scalar dLen; // Length of the cone's axis direction vector
+	};
+
+template <class VertexParam>
+inline
+void
+intersectConeWithPointTree(
+	LidarOctree::ConeIntersection& cone,
+	const ConeTraversal& ct,
+	const VertexParam* points,
+	unsigned int left,
+	unsigned int right,
+	int splitDimension,
+	Point boxMin,
+	Point boxMax)
+	{
+	/* Intersect the cone with all points of small subtrees directly: */
+	if(right-left<32U)
+		{
+		intersectConeWithPoints(cone,points+left,right+1-left);
+		return;
+		}
+	
+	/* Skip the subtree if its bounding sphere is behind the closest intersection found so far, or outside the cone: */
+	Point center=Geometry::mid(boxMin,boxMax);
+	Scalar radius=Geometry::dist(boxMin,boxMax)*Scalar(0.5);
+	Vector sc=center-cone.ray.getOrigin();
+	Scalar scLen=Geometry::mag(sc);
+	if(scLen>radius)
+		{
+		Scalar xd=sc*cone.ray.getDirection();
+		if(xd-radius*ct.dLen>=cone.testLambdaMin*cone.d2)
+			return;
+		
+		Scalar axisCos=xd/(scLen*ct.dLen);
+		Scalar sphereSin=radius/scLen;
+		Scalar sphereCos=Math::sqrt(Scalar(1)-Math::sqr(sphereSin));
+		if(axisCos<sphereCos)
+			{
+			/* Calculate the cosine of the angle between the cone axis and the closest ray tangent to the sphere: */
+			Scalar axisSin=Math::sqrt(Math::max(Scalar(1)-Math::sqr(axisCos),Scalar(0)));
+			if(axisCos*sphereCos+axisSin*sphereSin<ct.coneAngleCos)
+				return;
+			}
+		}
+	
+	/* Process the current point: */
+	unsigned int mid=(left+right)>>1;
+	intersectConeWithPoints(cone,points+mid,1);
+	
+	int childSplitDimension=splitDimension+1;
+	if(childSplitDimension==3)
+		childSplitDimension=0;
+	
+	/* Traverse the child on the side of the cone's apex first to find close intersections early: */
+	Scalar split=points[mid].position[splitDimension];
+	Point leftMax=boxMax;
+	leftMax[splitDimension]=split;
+	Point rightMin=boxMin;
+	rightMin[splitDimension]=split;
+	if(cone.ray.getOrigin()[splitDimension]<split)
+		{
+		if(left<mid)
+			intersectConeWithPointTree(cone,ct,points,left,mid-1,childSplitDimension,boxMin,leftMax);
+		if(right>mid)
+			intersectConeWithPointTree(cone,ct,points,mid+1,right,childSplitDimension,rightMin,boxMax);
+		}
+	else
+		{
+		if(right>mid)
+			intersectConeWithPointTree(cone,ct,points,mid+1,right,childSplitDimension,rightMin,boxMax);
+		if(left<mid)
+			intersectConeWithPointTree(cone,ct,points,left,mid-1,childSplitDimension,boxMin,leftMax);
+		}
+	}
+
+template <class VertexParam>
+inline
+void
+intersectConeWithNode(
+	LidarOctree::ConeIntersection& cone,
+	const Cube& domain,
+	const VertexParam* points,
+	unsigned int numPoints)
+	{
+	if(numPoints==0)
+		return;
+	
+	/* Intersect the cone with the node's point kd-tree: */
+	ConeTraversal ct;
+	ct.coneAngleCos=Math::sqrt(cone.coneAngleCos2);
+	ct.dLen=Math::sqrt(cone.d2);
+	intersectConeWithPointTree(cone,ct,points,0,numPoints-1,0,domain.getMin(),domain.getMax());
+	}
+
 }
 
 void LidarOctree::Node::intersectCone(LidarOctree::ConeIntersection& cone) const
@@ -194,29 +326,139 @@ void LidarOctree::Node::intersectCone(LidarOctree::ConeIntersection& cone) const
 	else
 		{
 		/* Intersect the cone with all points in this node: */
-		if(haveNormals)
-			intersectConeWithPoints(cone,static_cast<const NVertex*>(points),numPoints);
+		if(haveCompactNormals)
+			intersectConeWithNode(cone,domain,static_cast<const CNVertex*>(points),numPoints);
+		else if(haveNormals)
+			intersectConeWithNode(cone,domain,static_cast<const NVertex*>(points),numPoints);
 		else
-			intersectConeWithPoints(cone,static_cast<const Vertex*>(points),numPoints);
+			intersectConeWithNode(cone,domain,static_cast<const Vertex*>(points),numPoints);
 		}
 	}
 
+/*****************************************
+Methods of class LidarOctree::LoaderFiles:
+*****************************************/
+
+namespace {
+
+/***********************************************************
+Helper functions to load LiDAR files given a base file name:
+***********************************************************/
+
+std::string getLidarPartFileName(const char* lidarFileName,const char* partFileName)
+	{
+	std::string result=lidarFileName;
+	result.push_back('/');
+	result.append(partFileName);
+	return result;
+	}
+
+}
+
+LidarOctree::LoaderFiles::LoaderFiles(const LidarSource& source,bool haveNormals,bool haveColors,unsigned int maxNumPointsPerNode)
+	:indexFile(source.openPart("Index")),
+	 pointsFile(source.openPart("Points")),
+	 normalsFile(0),colorsFile(0),attributeFile(0),
+	 pointsBuffer(new LidarPoint[maxNumPointsPerNode]),
+	 normalsBuffer(haveNormals?new Vector[maxNumPointsPerNode]:0)
+	{
+	/* Open the optional data files; all reads use absolute positions, and the source sets up endianness: */
+	if(haveNormals)
+		normalsFile=source.openPart("Normals");
+	if(haveColors)
+		colorsFile=source.openPart("Colors");
+	}
+
+LidarOctree::LoaderFiles::~LoaderFiles(void)
+	{
+	delete indexFile;
+	delete pointsFile;
+	delete normalsFile;
+	delete colorsFile;
+	delete attributeFile;
+	delete[] pointsBuffer;
+	delete[] normalsBuffer;
+	}
+
 /**************************************
 Methods of class LidarOctree::DataItem:
 **************************************/
 
-LidarOctree::DataItem::DataItem(unsigned int sCacheSize)
+LidarOctree::DataItem::DataItem(unsigned int sCacheSize,bool sUsePersistentBuffer,unsigned int sSlotNumPoints,size_t vertexSize)
 	:hasVertexBufferObjectExtension(GLARBVertexBufferObject::isSupported()),
 	 cacheSize(sCacheSize-1),
 	 cacheSlots(new CacheSlot[cacheSize]),
+	 usePersistentBuffer(false),
+	 slotNumPoints(sSlotNumPoints),slotSize(size_t(sSlotNumPoints)*vertexSize),
+	 persistentBufferId(0),persistentBuffer(0),
+	 batchFirsts(0),batchCounts(0),numBatchedNodes(0),
+	 glBufferStorageProc(0),glMapBufferRangeProc(0),glUnmapBufferProc(0),
+	 glFenceSyncProc(0),glClientWaitSyncProc(0),glDeleteSyncProc(0),
+	 glMultiDrawArraysProc(0),
 	 cacheNodeMap(cacheSize+cacheSize/4),
 	 lruHead(0),lruTail(0),
 	 bypassVertexBufferObjectId(0),
 	 hasPointParametersExtension(GLARBPointParameters::isSupported()),
-	 numRenderedNodes(0),numCacheMisses(0),numCacheBypasses(0),numRenderedPoints(0),numBypassedPoints(0)
+	 hasOcclusionQueryExtension(false),
+	 glGenQueriesARBProc(0),glDeleteQueriesARBProc(0),glBeginQueryARBProc(0),glEndQueryARBProc(0),
+	 glGetQueryObjectuivARBProc(0),
+	 cullOccludedNodes(false),
+	 nodeQueries(cacheSize+cacheSize/4),
+	 numRenderedNodes(0),numCacheMisses(0),numCacheBypasses(0),numRenderedPoints(0),numBypassedPoints(0),
+	 numOccludedNodes(0),
+	 uploadPass(~0U),numUploadedBytes(0)
 	{
+	for(unsigned int i=0;i<numFrameFences;++i)
+		{
+		frameFences[i]=0;
+		frameFencePasses[i]=0U;
+		}
+	
+	/* Check if the persistently mapped cache is requested and supported: */
+	usePersistentBuffer=sUsePersistentBuffer&&hasVertexBufferObjectExtension&&GLExtensionManager::isExtensionSupported("GL_ARB_buffer_storage")&&GLExtensionManager::isExtensionSupported("GL_ARB_sync");
+	
 	/* Allocate the cache objects: */
-	if(hasVertexBufferObjectExtension)
+	if(usePersistentBuffer)
+		{
+		/* Initialize the vertex buffer object extension: */
+		GLARBVertexBufferObject::initExtension();
+		
+		/* Get the required entry points: */
+		glBufferStorageProc=GLExtensionManager::getFunction<PFNGLBUFFERSTORAGEPROC>("glBufferStorage");
+		glMapBufferRangeProc=GLExtensionManager::getFunction<PFNGLMAPBUFFERRANGEPROC>("glMapBufferRange");
+		glUnmapBufferProc=GLExtensionManager::getFunction<PFNGLUNMAPBUFFERPROC>("glUnmapBuffer");
+		glFenceSyncProc=GLExtensionManager::getFunction<PFNGLFENCESYNCPROC>("glFenceSync");
+		glClientWaitSyncProc=GLExtensionManager::getFunction<PFNGLCLIENTWAITSYNCPROC>("glClientWaitSync");
+		glDeleteSyncProc=GLExtensionManager::getFunction<PFNGLDELETESYNCPROC>("glDeleteSync");
+		glMultiDrawArraysProc=GLExtensionManager::getFunction<PFNGLMULTIDRAWARRAYSPROC>("glMultiDrawArrays");
+		
+		/* Create one immutable buffer holding all cache slots, and the buffer for nodes bypassing the cache: */
+		GLuint bufferIds[2];
+		glGenBuffersARB(2,bufferIds);
+		persistentBufferId=bufferIds[0];
+		bypassVertexBufferObjectId=bufferIds[1];
+		GLbitfield flags=GL_MAP_WRITE_BIT|GL_MAP_PERSISTENT_BIT|GL_MAP_COHERENT_BIT;
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB,persistentBufferId);
+		glBufferStorageProc(GL_ARRAY_BUFFER_ARB,GLsizeiptr(cacheSize)*GLsizeiptr(slotSize),0,flags);
+		persistentBuffer=static_cast<GLubyte*>(glMapBufferRangeProc(GL_ARRAY_BUFFER_ARB,0,GLsizeiptr(cacheSize)*GLsizeiptr(slotSize),flags));
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
+		
+		if(persistentBuffer!=0)
+			{
+			/* Create the multi-draw batch arrays: */
+			batchFirsts=new GLint[cacheSize];
+			batchCounts=new GLsizei[cacheSize];
+			}
+		else
+			{
+			/* Fall back to one buffer object per cache slot: */
+			glDeleteBuffersARB(2,bufferIds);
+			persistentBufferId=0;
+			bypassVertexBufferObjectId=0;
+			usePersistentBuffer=false;
+			}
+		}
+	if(!usePersistentBuffer&&hasVertexBufferObjectExtension)
 		{
 		/* Initialize the vertex buffer object extension: */
 		GLARBVertexBufferObject::initExtension();
@@ -246,11 +488,45 @@ LidarOctree::DataItem::DataItem(unsigned int sCacheSize)
 		/* Initialize the point parameters extension: */
 		GLARBPointParameters::initExtension();
 		}
+	
+	/* Check if occlusion queries are supported; depth clamping keeps the near plane from clipping bounding boxes, and shader objects are needed to suspend the point shader: */
+	hasOcclusionQueryExtension=GLExtensionManager::isExtensionSupported("GL_ARB_occlusion_query")&&GLExtensionManager::isExtensionSupported("GL_ARB_depth_clamp")&&GLARBShaderObjects::isSupported();
+	if(hasOcclusionQueryExtension)
+		{
+		/* Initialize the shader objects extension: */
+		GLARBShaderObjects::initExtension();
+		
+		/* Get the required entry points: */
+		glGenQueriesARBProc=GLExtensionManager::getFunction<PFNGLGENQUERIESARBPROC>("glGenQueriesARB");
+		glDeleteQueriesARBProc=GLExtensionManager::getFunction<PFNGLDELETEQUERIESARBPROC>("glDeleteQueriesARB");
+		glBeginQueryARBProc=GLExtensionManager::getFunction<PFNGLBEGINQUERYARBPROC>("glBeginQueryARB");
+		glEndQueryARBProc=GLExtensionManager::getFunction<PFNGLENDQUERYARBPROC>("glEndQueryARB");
+		glGetQueryObjectuivARBProc=GLExtensionManager::getFunction<PFNGLGETQUERYOBJECTUIVARBPROC>("glGetQueryObjectuivARB");
+		}
 	}
 
 LidarOctree::DataItem::~DataItem(void)
 	{
-	if(hasVertexBufferObjectExtension)
+	if(usePersistentBuffer)
+		{
+		/* Delete all outstanding fences: */
+		for(unsigned int i=0;i<numFrameFences;++i)
+			if(frameFences[i]!=0)
+				glDeleteSyncProc(frameFences[i]);
+		
+		/* Unmap and delete the persistent buffer and the bypass buffer: */
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB,persistentBufferId);
+		glUnmapBufferProc(GL_ARRAY_BUFFER_ARB);
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
+		GLuint bufferIds[2];
+		bufferIds[0]=persistentBufferId;
+		bufferIds[1]=bypassVertexBufferObjectId;
+		glDeleteBuffersARB(2,bufferIds);
+		
+		delete[] batchFirsts;
+		delete[] batchCounts;
+		}
+	else if(hasVertexBufferObjectExtension)
 		{
 		/* Delete vertex buffer objects: */
 		GLuint* vertexBufferObjectIds=new GLuint[cacheSize+1];
@@ -261,21 +537,211 @@ LidarOctree::DataItem::~DataItem(void)
 		delete[] vertexBufferObjectIds;
 		}
 	
+	/* Delete all occlusion query objects: */
+	if(!occlusionQueryIds.empty())
+		glDeleteQueriesARBProc(GLsizei(occlusionQueryIds.size()),&occlusionQueryIds[0]);
+	
 	/* Delete the cache slots: */
 	delete[] cacheSlots;
 	}
 
+bool LidarOctree::DataItem::canRefine(const LidarOctree::Node* node,size_t uploadBudget)
+	{
+	if(uploadBudget==0||numUploadedBytes<uploadBudget)
+		return true;
+	
+	/* Check whether all non-empty children have up-to-date points in the cache: */
+	for(int childIndex=0;childIndex<8;++childIndex)
+		{
+		const Node* child=&node->children[childIndex];
+		if(child->numPoints!=0)
+			{
+			NodeHasher::Iterator cnIt=cacheNodeMap.findEntry(child);
+			if(cnIt.isFinished()||cnIt->getDest()->version!=child->pointsVersion)
+				return false;
+			}
+		}
+	
+	return true;
+	}
+
+void LidarOctree::DataItem::waitForRenderPass(unsigned int renderPass)
+	{
+	/* Check if there is still an outstanding fence for the given rendering pass: */
+	unsigned int fenceIndex=renderPass%numFrameFences;
+	if(frameFences[fenceIndex]!=0&&frameFencePasses[fenceIndex]==renderPass)
+		{
+		/* Wait for the fence and retire it: */
+		while(glClientWaitSyncProc(frameFences[fenceIndex],GL_SYNC_FLUSH_COMMANDS_BIT,GLuint64(1000000000))==GL_TIMEOUT_EXPIRED)
+			;
+		glDeleteSyncProc(frameFences[fenceIndex]);
+		frameFences[fenceIndex]=0;
+		}
+	}
+
+void LidarOctree::DataItem::fenceRenderPass(unsigned int renderPass)
+	{
+	unsigned int fenceIndex=renderPass%numFrameFences;
+	if(frameFences[fenceIndex]!=0)
+		{
+		if(frameFencePasses[fenceIndex]!=renderPass)
+			{
+			/* Retire the fence of an older rendering pass; cache slots from passes without fences are always safe to overwrite: */
+			waitForRenderPass(frameFencePasses[fenceIndex]);
+			}
+		else
+			{
+			/* The new fence supersedes the previous fence of the same rendering pass: */
+			glDeleteSyncProc(frameFences[fenceIndex]);
+			}
+		}
+	
+	/* Insert a new fence: */
+	frameFences[fenceIndex]=glFenceSyncProc(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	frameFencePasses[fenceIndex]=renderPass;
+	}
+
+bool LidarOctree::DataItem::wasOccluded(const LidarOctree::Node* node)
+	{
+	/* Check if the node's bounding box was queried in the previous render pass: */
+	QueryHasher::Iterator nqIt=nodeQueries.findEntry(node);
+	if(nqIt.isFinished())
+		return false;
+	
+	/* Treat the node as visible if the query's result is not available yet: */
+	GLuint resultAvailable=0;
+	glGetQueryObjectuivARBProc(nqIt->getDest(),GL_QUERY_RESULT_AVAILABLE_ARB,&resultAvailable);
+	if(resultAvailable==0)
+		return false;
+	
+	/* The node is occluded if none of its bounding box's fragments passed the depth test: */
+	GLuint numSamples=0;
+	glGetQueryObjectuivARBProc(nqIt->getDest(),GL_QUERY_RESULT_ARB,&numSamples);
+	return numSamples==0;
+	}
+
+void LidarOctree::DataItem::queryOcclusion(void)
+	{
+	/* Create additional query objects if necessary: */
+	size_t numQueryIds=occlusionQueryIds.size();
+	if(numQueryIds<queryNodes.size())
+		{
+		occlusionQueryIds.resize(queryNodes.size());
+		glGenQueriesARBProc(GLsizei(queryNodes.size()-numQueryIds),&occlusionQueryIds[numQueryIds]);
+		}
+	
+	/* Render bounding boxes without changing the frame buffer, and without near plane clipping: */
+	glPushAttrib(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_ENABLE_BIT|GL_POLYGON_BIT);
+	GLhandleARB currentProgram=glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
+	glUseProgramObjectARB(0);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_DEPTH_CLAMP);
+	glPolygonMode(GL_FRONT_AND_BACK,GL_FILL);
+	glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
+	glDepthMask(GL_FALSE);
+	
+	/* Query each node's bounding box against the depth buffer: */
+	nodeQueries.clear();
+	for(size_t i=0;i<queryNodes.size();++i)
+		{
+		const Box& bounds=queryNodes[i]->bounds;
+		const Point& min=bounds.min;
+		const Point& max=bounds.max;
+		glBeginQueryARBProc(GL_SAMPLES_PASSED_ARB,occlusionQueryIds[i]);
+		glBegin(GL_QUADS);
+		glVertex3f(min[0],min[1],min[2]);
+		glVertex3f(min[0],max[1],min[2]);
+		glVertex3f(max[0],max[1],min[2]);
+		glVertex3f(max[0],min[1],min[2]);
+		glVertex3f(min[0],min[1],max[2]);
+		glVertex3f(max[0],min[1],max[2]);
+		glVertex3f(max[0],max[1],max[2]);
+		glVertex3f(min[0],max[1],max[2]);
+		glVertex3f(min[0],min[1],min[2]);
+		glVertex3f(max[0],min[1],min[2]);
+		glVertex3f(max[0],min[1],max[2]);
+		glVertex3f(min[0],min[1],max[2]);
+		glVertex3f(min[0],max[1],min[2]);
+		glVertex3f(min[0],max[1],max[2]);
+		glVertex3f(max[0],max[1],max[2]);
+		glVertex3f(max[0],max[1],min[2]);
+		glVertex3f(min[0],min[1],min[2]);
+		glVertex3f(min[0],min[1],max[2]);
+		glVertex3f(min[0],max[1],max[2]);
+		glVertex3f(min[0],max[1],min[2]);
+		glVertex3f(max[0],min[1],min[2]);
+		glVertex3f(max[0],max[1],min[2]);
+		glVertex3f(max[0],max[1],max[2]);
+		glVertex3f(max[0],min[1],max[2]);
+		glEnd();
+		glEndQueryARBProc(GL_SAMPLES_PASSED_ARB);
+		nodeQueries.setEntry(QueryHasher::Entry(queryNodes[i],occlusionQueryIds[i]));
+		}
+	queryNodes.clear();
+	
+	/* Restore OpenGL state: */
+	glUseProgramObjectARB(currentProgram);
+	glPopAttrib();
+	}
+
 /****************************
 Methods of class LidarOctree:
 ****************************/
 
-void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree::Frustum& frustum,PointBasedLightingShader& pbls,LidarOctree::DataItem* dataItem) const
+void LidarOctree::loadSummaries(void)
 	{
-	/* Bail out if the node is empty: */
-	if(node->numPoints==0)
+	/* Check if there is a summaries file: */
+	if(!source.hasPart("Summaries"))
 		return;
+	LidarSourceFile* summariesFile=source.openPart("Summaries");
 	
-	/* Check if this node intersects the view frustum: */
+	/* Check the summaries file's header and size against the octree file, and ignore it if it does not match: */
+	LidarDataFileHeader dfh(*summariesFile);
+	size_t numNodes=size_t((indexFile->getSize()-LidarOctreeFileHeader::getFileSize())/LidarFile::Offset(LidarOctreeFileNode::getFileSize()));
+	if(dfh.recordSize==LidarNodeSummary::getFileSize()&&summariesFile->getSize()==LidarFile::Offset(LidarDataFileHeader::getFileSize())+LidarFile::Offset(numNodes)*LidarFile::Offset(LidarNodeSummary::getFileSize()))
+		{
+		/* Read all node summaries and re-center their bounding boxes: */
+		summaries.resize(numNodes);
+		for(std::vector<LidarNodeSummary>::iterator sIt=summaries.begin();sIt!=summaries.end();++sIt)
+			{
+			sIt->read(*summariesFile);
+			if(!sIt->isEmpty())
+				{
+				sIt->bounds.min-=pointOffset;
+				sIt->bounds.max-=pointOffset;
+				}
+			}
+		}
+	
+	delete summariesFile;
+	}
+
+void LidarOctree::deleteChildren(LidarOctree::Node* children)
+	{
+	/* Delete the children's subtrees first: */
+	for(int i=0;i<8;++i)
+		if(children[i].children!=0)
+			deleteChildren(children[i].children);
+	
+	/* Recycle the children's point arrays, then destroy the children and recycle their array: */
+	for(int i=0;i<8;++i)
+		pointArrayPool->free(children[i].points);
+	nodeBlockPool.free(children);
+	}
+
+void LidarOctree::setNodeBounds(LidarOctree::Node* node,size_t nodeIndex) const
+	{
+	/* Use the node's tight bounding box if available; nodes without points are never rendered and keep their domains: */
+	if(!summaries.empty()&&!summaries[nodeIndex].isEmpty())
+		node->bounds=summaries[nodeIndex].bounds;
+	else
+		node->bounds=Box(node->domain.getMin(),node->domain.getMax());
+	}
+
+bool LidarOctree::intersectsFrustum(const LidarOctree::Node* node,const LidarOctree::Frustum& frustum)
+	{
 	for(int plane=0;plane<6;++plane)
 		{
 		const Frustum::Plane::Vector& normal=frustum.getFrustumPlane(plane).getNormal();
@@ -283,13 +749,48 @@ void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree:
 		/* Find the point on the node's bounding box which is closest to the frustum plane: */
 		Point p;
 		for(int i=0;i<3;++i)
-			p[i]=normal[i]>Scalar(0)?node->domain.getMax()[i]:node->domain.getMin()[i];
+			p[i]=normal[i]>Scalar(0)?node->bounds.max[i]:node->bounds.min[i];
 		
 		/* Bail out if the point is not inside the view frustum: */
 		if(frustum.getFrustumPlane(plane).contains(p))
-			return;
+			return false;
+		}
+	
+	return true;
+	}
+
+bool LidarOctree::isNodeVisible(const LidarOctree::Node* node,const LidarOctree::Frustum& frustum,LidarOctree::DataItem* dataItem) const
+	{
+	/* Check if this node intersects the view frustum: */
+	if(!intersectsFrustum(node,frustum))
+		return false;
+	
+	if(dataItem->cullOccludedNodes)
+		{
+		/* Nodes containing the eye are always visible: */
+		Point eye=frustum.getEye().toPoint();
+		bool containsEye=true;
+		for(int i=0;i<3&&containsEye;++i)
+			containsEye=eye[i]>=node->bounds.min[i]&&eye[i]<=node->bounds.max[i];
+		if(!containsEye)
+			{
+			/* Query the node's bounding box at the end of this render pass: */
+			dataItem->queryNodes.push_back(node);
+			
+			/* Neither render nor subdivide the node if it was occluded in the previous render pass: */
+			if(dataItem->wasOccluded(node))
+				{
+				++dataItem->numOccludedNodes;
+				return false;
+				}
+			}
 		}
 	
+	return true;
+	}
+
+Scalar LidarOctree::calcProjectedDetailSize(const LidarOctree::Node* node,const LidarOctree::Frustum& frustum) const
+	{
 	/* Find the point inside the node that is closest to the focus+context center: */
 	Point nodeFncPoint=fncCenter;
 	for(int i=0;i<3;++i)
@@ -319,42 +820,33 @@ void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree:
 	else
 		projectedDetailSize=Math::Constants<Scalar>::max; // Temporary workaround until GLFrustum is fixed
 	
-	/* Update node's rendering traversal state: */
+	return projectedDetailSize;
+	}
+
+void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree::Frustum& frustum,PointBasedLightingShader& pbls,LidarOctree::DataItem* dataItem) const
 	{
-	Threads::Mutex::Lock nodeLock(node->nodeMutex);
-	bool nodeStateChanged=false;
-	if(node->renderPass!=renderPass)
-		{
-		/* Store the node's LOD value from this rendering pass: */
-		node->maxLOD=projectedDetailSize;
-		node->renderPass=renderPass;
-		nodeStateChanged=true;
-		}
-	else
-		{
-		/* Update the node's maximum LOD value: */
-		if(node->maxLOD<projectedDetailSize)
-			{
-			node->maxLOD=projectedDetailSize;
-			nodeStateChanged=true;
-			}
-		}
+	/* Bail out if the node is empty or invisible: */
+	if(node->numPoints==0||!isNodeVisible(node,frustum,dataItem))
+		return;
 	
-	if(node->coarseningHeapIndex!=~0x0U&&nodeStateChanged)
-		{
-		/* Update the node's data in the coarsening heap: */
-		{
-		Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
-		coarseningHeap->move(const_cast<Node*>(node));
-		}
-		}
-	}
+	/* Calculate the node's projected detail size: */
+	Scalar projectedDetailSize=calcProjectedDetailSize(node,frustum);
+	
+	/* Update node's rendering traversal state; the coarsening heap picks up the change in the next startRenderPass: */
+	node->updateTraversalState(renderPass,projectedDetailSize);
 	
 	/* Check whether to render this node or its children: */
 	if(projectedDetailSize>=maxRenderLOD)
 		{
 		if(node->children!=0)
 			{
+			/* Render this node instead of its children until the children's points are uploaded in later render passes: */
+			if(!dataItem->canRefine(node,glUploadBudget))
+				{
+				renderNode(node,pbls,dataItem);
+				return;
+				}
+			
 			/* Use the view point for a view-ordered traversal of the child nodes: */
 			int childIndex=0x0;
 			Point nodeCenter=node->domain.getCenter();
@@ -373,71 +865,370 @@ void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree:
 			}
 		else if(node->childrenOffset!=LidarFile::Offset(0))
 			{
-			/* Try inserting this node into the node loader thread's request queue: */
-			Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
-			if(node->subdivisionQueueIndex<subdivisionRequestQueueLength)
-				{
-				/* Update the node's position in the subdivision queue if necessary: */
-				if(subdivisionRequestQueue[node->subdivisionQueueIndex].LOD<projectedDetailSize)
-					{
-					/* Adjust the node's position in the queue: */
-					for(;node->subdivisionQueueIndex>0&&subdivisionRequestQueue[node->subdivisionQueueIndex-1].LOD<projectedDetailSize;--node->subdivisionQueueIndex)
-						{
-						subdivisionRequestQueue[node->subdivisionQueueIndex]=subdivisionRequestQueue[node->subdivisionQueueIndex-1];
-						subdivisionRequestQueue[node->subdivisionQueueIndex].node->subdivisionQueueIndex=node->subdivisionQueueIndex;
-						}
-					
-					/* Update the node's LOD value in the queue: */
-					subdivisionRequestQueue[node->subdivisionQueueIndex].node=const_cast<Node*>(node);
-					subdivisionRequestQueue[node->subdivisionQueueIndex].LOD=projectedDetailSize;
-					}
-				}
-			else if(node->subdivisionQueueIndex==subdivisionRequestQueueLength&&subdivisionRequestQueue[subdivisionRequestQueueLength-1].LOD<projectedDetailSize)
-				{
-				/* Remove the node from the last queue slot: */
-				if(subdivisionRequestQueue[subdivisionRequestQueueLength-1].node!=0)
-					subdivisionRequestQueue[subdivisionRequestQueueLength-1].node->subdivisionQueueIndex=subdivisionRequestQueueLength;
-				
-				/* Insert the node into the subdivision request queue: */
-				unsigned int insertIndex;
-				for(insertIndex=subdivisionRequestQueueLength-1;insertIndex>0&&subdivisionRequestQueue[insertIndex-1].LOD<projectedDetailSize;--insertIndex)
-					{
-					if(subdivisionRequestQueue[insertIndex-1].node!=0)
-						subdivisionRequestQueue[insertIndex-1].node->subdivisionQueueIndex=insertIndex;
-					if(insertIndex<subdivisionRequestQueueLength)
-						subdivisionRequestQueue[insertIndex]=subdivisionRequestQueue[insertIndex-1];
-					}
-				node->subdivisionQueueIndex=insertIndex;
-				subdivisionRequestQueue[insertIndex].node=const_cast<Node*>(node);
-				subdivisionRequestQueue[insertIndex].LOD=projectedDetailSize;
-				
-				/* Wake up the node loader thread: */
-				loadRequestCond.signal();
-				}
+			/* Try inserting this node into the node loader threads' request queue: */
+			requestSubdivision(node,projectedDetailSize);
 			}
 		}
 	
-	/* Retrieve the cache slot containing this node's vertex array: */
-	GLuint vertexBufferObjectId=0;
-	DataItem::CacheSlot* slot=0;
-	bool mustUploadData=false;
-	DataItem::NodeHasher::Iterator cnIt=dataItem->cacheNodeMap.findEntry(node);
-	if(cnIt.isFinished()) // Cache miss
+	/* Render this node's point set: */
+	renderNode(node,pbls,dataItem);
+	}
+
+void LidarOctree::prefetchSubTree(const LidarOctree::Node* node,const LidarOctree::Frustum& frustum) const
+	{
+	if(node->numPoints==0)
+		return;
+	
+	/* Move the node's bounding sphere to where the predicted navigation will place it relative to the current view: */
+	Point center=prefetchTransform.transform(node->domain.getCenter());
+	Scalar scale=prefetchTransform.getScaling();
+	Scalar radius=node->radius*scale;
+	
+	/* Bail out if the moved bounding sphere is outside the view frustum: */
+	for(int plane=0;plane<6;++plane)
 		{
-		/*******************************************************************
-		We use an LRU cache replacement strategy, but do not replace cache
-		slots that were already used in the same rendering pass to prevent
-		cache thrashing. If the cache is full for a rendering pass,
-		additional nodes will be rendered straight from the main memory data
-		structures.
-		*******************************************************************/
-		
-		/* Check if the head of the LRU list is from a previous rendering pass: */
-		if(dataItem->lruHead->lastUsed!=renderPass)
-			{
-			/* Replace the cache slot: */
-			slot=dataItem->lruHead;
-			if(slot->node!=0)
+		const Frustum::Plane& fp=frustum.getFrustumPlane(plane);
+		if(fp.calcDistance(center)<-radius*Geometry::mag(fp.getNormal()))
+			return;
+		}
+	
+	/* Estimate the moved node's projected detail size from its center; the focus region stays in place relative to the view: */
+	Scalar projectedDetailSize=frustum.calcProjectedRadius(center,node->detailSize*scale);
+	if(projectedDetailSize<Scalar(0))
+		projectedDetailSize=Math::Constants<Scalar>::max;
+	else if(fncWeight>Scalar(0))
+		{
+		Scalar fncDist=Geometry::dist(center,fncCenter)-radius;
+		if(fncDist>fncRadius)
+			projectedDetailSize*=Math::pow(fncRadius/fncDist,fncWeight);
+		}
+	
+	if(projectedDetailSize>=maxRenderLOD)
+		{
+		if(node->children!=0)
+			{
+			/* Check the node's children: */
+			for(int i=0;i<8;++i)
+				prefetchSubTree(&node->children[i],frustum);
+			}
+		else if(node->childrenOffset!=LidarFile::Offset(0))
+			{
+			/* Request the node's subdivision at prefetch priority: */
+			requestSubdivision(node,projectedDetailSize,PrefetchRequest);
+			}
+		}
+	}
+
+namespace {
+
+/*************************************
+Helper classes for budgeted rendering:
+*************************************/
+
+template <class NodeParam>
+struct BudgetEntry // Structure for nodes in the budgeted traversal's priority queue
+	{
+	/* Elements: */
+	public:
+	const NodeParam* node; // The node
+	Scalar projectedDetailSize; // The node's projected detail size
+	
+	/* Constructors and destructors: */
+	BudgetEntry(void)
+		:node(0),projectedDetailSize(0)
+		{
+		}
+	BudgetEntry(const NodeParam* sNode,Scalar sProjectedDetailSize)
+		:node(sNode),projectedDetailSize(sProjectedDetailSize)
+		{
+		}
+	
+	/* Methods: */
+	bool operator<(const BudgetEntry& other) const // Orders nodes by ascending projected detail size for a max-heap
+		{
+		return projectedDetailSize<other.projectedDetailSize;
+		}
+	};
+
+template <class NodeParam>
+class FrontToBackOrder // Functor class to sort nodes by the distance of their centers from the eye
+	{
+	/* Elements: */
+	private:
+	Point eye; // The eye position
+	
+	/* Constructors and destructors: */
+	public:
+	FrontToBackOrder(const Point& sEye)
+		:eye(sEye)
+		{
+		}
+	
+	/* Methods: */
+	bool operator()(const NodeParam* node1,const NodeParam* node2) const
+		{
+		return Geometry::sqrDist(node1->domain.getCenter(),eye)<Geometry::sqrDist(node2->domain.getCenter(),eye);
+		}
+	};
+
+}
+
+void LidarOctree::renderBudgeted(const LidarOctree::Frustum& frustum,PointBasedLightingShader& pbls,LidarOctree::DataItem* dataItem) const
+	{
+	/* Bail out if the root node is empty or invisible: */
+	if(root.numPoints==0||!isNodeVisible(&root,frustum,dataItem))
+		return;
+	
+	/* Start the render cut with the root node: */
+	typedef BudgetEntry<Node> Entry;
+	std::vector<Entry> queue;
+	Scalar rootDetailSize=calcProjectedDetailSize(&root,frustum);
+	root.updateTraversalState(renderPass,rootDetailSize);
+	queue.push_back(Entry(&root,rootDetailSize));
+	size_t numCutPoints=root.numPoints;
+	
+	/* Expand the nodes with the largest projected detail sizes first until the point budget is exhausted: */
+	std::vector<const Node*> renderNodes;
+	while(!queue.empty())
+		{
+		std::pop_heap(queue.begin(),queue.end());
+		Entry entry=queue.back();
+		queue.pop_back();
+		const Node* node=entry.node;
+		
+		bool expanded=false;
+		if(entry.projectedDetailSize>=maxRenderLOD)
+			{
+			if(node->children!=0)
+				{
+				/* Collect the node's visible children: */
+				Entry children[8];
+				int numVisibleChildren=0;
+				size_t numChildPoints=0;
+				for(int childIndex=0;childIndex<8;++childIndex)
+					{
+					const Node* child=&node->children[childIndex];
+					if(child->numPoints!=0&&isNodeVisible(child,frustum,dataItem))
+						{
+						children[numVisibleChildren]=Entry(child,calcProjectedDetailSize(child,frustum));
+						++numVisibleChildren;
+						numChildPoints+=child->numPoints;
+						}
+					}
+				
+				/* Replace the node with its visible children if they fit into the budget: */
+				if(numCutPoints-node->numPoints+numChildPoints<=pointBudget)
+					{
+					numCutPoints=numCutPoints-node->numPoints+numChildPoints;
+					for(int i=0;i<numVisibleChildren;++i)
+						{
+						children[i].node->updateTraversalState(renderPass,children[i].projectedDetailSize);
+						queue.push_back(children[i]);
+						std::push_heap(queue.begin(),queue.end());
+						}
+					expanded=true;
+					}
+				}
+			else if(node->childrenOffset!=LidarFile::Offset(0)&&numCutPoints+size_t(node->numPoints)*3<=pointBudget)
+				{
+				/* Request the node's children if they are likely to fit into the budget, assuming they hold about four times the node's points: */
+				requestSubdivision(node,entry.projectedDetailSize);
+				}
+			}
+		
+		/* Add the node to the render cut if it was not replaced by its children: */
+		if(!expanded)
+			renderNodes.push_back(node);
+		}
+	
+	/* Render the nodes of the render cut front-to-back: */
+	std::sort(renderNodes.begin(),renderNodes.end(),FrontToBackOrder<Node>(frustum.getEye().toPoint()));
+	for(std::vector<const Node*>::iterator rnIt=renderNodes.begin();rnIt!=renderNodes.end();++rnIt)
+		renderNode(*rnIt,pbls,dataItem);
+	}
+
+bool LidarOctree::evaluateNode(const LidarOctree::Node* node,const std::vector<LidarOctree::Frustum>& frusta,Scalar& projectedDetailSize) const
+	{
+	/* Find the node's largest projected detail size in all frusta that contain it: */
+	bool visible=false;
+	for(std::vector<Frustum>::const_iterator fIt=frusta.begin();fIt!=frusta.end();++fIt)
+		if(intersectsFrustum(node,*fIt))
+			{
+			Scalar pds=calcProjectedDetailSize(node,*fIt);
+			if(!visible||projectedDetailSize<pds)
+				projectedDetailSize=pds;
+			visible=true;
+			}
+	
+	return visible;
+	}
+
+void LidarOctree::traverseShared(const LidarOctree::Node* node,const std::vector<LidarOctree::Frustum>& frusta,std::vector<const LidarOctree::Node*>& cut) const
+	{
+	if(node->numPoints==0)
+		return;
+	
+	/* Keep invisible nodes in the cut without refining them, so that the cut covers views that moved since the previous render pass: */
+	Scalar projectedDetailSize;
+	if(evaluateNode(node,frusta,projectedDetailSize))
+		{
+		/* Update node's rendering traversal state: */
+		node->updateTraversalState(renderPass,projectedDetailSize);
+		
+		/* Check whether to add this node or its children to the render cut: */
+		if(projectedDetailSize>=maxRenderLOD)
+			{
+			if(node->children!=0)
+				{
+				for(int i=0;i<8;++i)
+					traverseShared(&node->children[i],frusta,cut);
+				
+				/* Done here... */
+				return;
+				}
+			else if(node->childrenOffset!=LidarFile::Offset(0))
+				{
+				/* Try inserting this node into the node loader threads' request queue: */
+				requestSubdivision(node,projectedDetailSize);
+				}
+			}
+		}
+	
+	cut.push_back(node);
+	}
+
+void LidarOctree::collapseCutTail(const std::vector<LidarOctree::Frustum>& frusta,std::vector<const LidarOctree::Node*>& cut) const
+	{
+	while(!cut.empty())
+		{
+		const Node* parent=cut.back()->parent;
+		if(parent==0)
+			break;
+		
+		/* Bail out unless the cut ends with all of the parent's non-empty children; the cut lists nodes in depth-first order: */
+		unsigned int numChildren=0;
+		for(int i=0;i<8;++i)
+			if(parent->children[i].numPoints!=0)
+				++numChildren;
+		unsigned int numTailChildren=0;
+		for(std::vector<const Node*>::reverse_iterator cIt=cut.rbegin();cIt!=cut.rend()&&numTailChildren<numChildren&&(*cIt)->parent==parent;++cIt)
+			++numTailChildren;
+		if(numTailChildren!=numChildren)
+			break;
+		
+		/* Check whether the parent still needs to be refined: */
+		Scalar projectedDetailSize;
+		bool visible=evaluateNode(parent,frusta,projectedDetailSize);
+		if(visible)
+			{
+			/* Keep the parent's traversal state current even if it is not in the cut, so that the coarsening heap does not consider its children stale: */
+			parent->updateTraversalState(renderPass,projectedDetailSize);
+			if(projectedDetailSize>=maxRenderLOD)
+				break;
+			}
+		
+		/* Replace the children by their parent and check the next level up: */
+		cut.resize(cut.size()-numChildren);
+		cut.push_back(parent);
+		}
+	}
+
+void LidarOctree::updateSharedCut(const std::vector<LidarOctree::Frustum>& frusta) const
+	{
+	std::vector<const Node*> newCut;
+	newCut.reserve(sharedCut.size());
+	for(std::vector<const Node*>::const_iterator scIt=sharedCut.begin();scIt!=sharedCut.end();++scIt)
+		{
+		/* Refine the node if its projected detail size grew, and coarsen its ancestors if the node completes a set of siblings that became too small: */
+		traverseShared(*scIt,frusta,newCut);
+		collapseCutTail(frusta,newCut);
+		}
+	sharedCut.swap(newCut);
+	}
+
+void LidarOctree::renderShared(const LidarOctree::Frustum& frustum,PointBasedLightingShader& pbls,LidarOctree::DataItem* dataItem) const
+	{
+	{
+	Threads::Mutex::Lock sharedTraversalLock(sharedTraversalMutex);
+	if(sharedTraversalPass!=renderPass)
+		{
+		/* Collect this view and, in shared mode, all views of the previous render pass, which are most likely the other eyes and windows of this one: */
+		TraceEvents::Scope traceScope("SharedTraversal","LidarOctree");
+		std::vector<Frustum> frusta;
+		frusta.push_back(frustum);
+		if(sharedTraversal)
+			frusta.insert(frusta.end(),lastPassFrusta.begin(),lastPassFrusta.end());
+		
+		/* Check whether the previous render pass's cut can be updated: */
+		bool updateCut=incrementalTraversal&&sharedCutValid;
+		if(updateCut&&!lastPassFrusta.empty())
+			{
+			/* Rebuild the cut after large camera jumps, where updating it would touch most of its nodes anyway: */
+			Point eye=frustum.getEye().toPoint();
+			Point lastEye=lastPassFrusta.front().getEye().toPoint();
+			updateCut=Geometry::sqrDist(eye,lastEye)<=Math::sqr(Geometry::dist(lastEye,fncCenter)*Scalar(0.25));
+			}
+		
+		if(updateCut)
+			updateSharedCut(frusta);
+		else
+			{
+			/* Build the render cut from the root: */
+			sharedCut.clear();
+			traverseShared(&root,frusta,sharedCut);
+			sharedCutValid=true;
+			}
+		
+		if(prefetching)
+			{
+			/* Request subdivisions for the predicted view once per render pass: */
+			prefetchSubTree(&root,frustum);
+			}
+		
+		sharedTraversalPass=renderPass;
+		}
+	
+	/* Remember this view for the next render pass's shared traversal: */
+	passFrusta.push_back(frustum);
+	}
+	
+	/* Cull the shared render cut against this view's frustum and occlusion state: */
+	std::vector<const Node*> renderNodes;
+	renderNodes.reserve(sharedCut.size());
+	for(std::vector<const Node*>::const_iterator scIt=sharedCut.begin();scIt!=sharedCut.end();++scIt)
+		if(isNodeVisible(*scIt,frustum,dataItem))
+			renderNodes.push_back(*scIt);
+	
+	/* Render the visible nodes front-to-back: */
+	std::sort(renderNodes.begin(),renderNodes.end(),FrontToBackOrder<Node>(frustum.getEye().toPoint()));
+	for(std::vector<const Node*>::iterator rnIt=renderNodes.begin();rnIt!=renderNodes.end();++rnIt)
+		renderNode(*rnIt,pbls,dataItem);
+	}
+
+void LidarOctree::renderNode(const LidarOctree::Node* node,PointBasedLightingShader& pbls,LidarOctree::DataItem* dataItem) const
+	{
+	/* Retrieve the cache slot containing this node's vertex array: */
+	GLuint vertexBufferObjectId=0;
+	DataItem::CacheSlot* slot=0;
+	bool mustUploadData=false;
+	unsigned int uploadBegin=0,uploadEnd=node->numPoints; // Range of points to upload if data must be uploaded
+	DataItem::NodeHasher::Iterator cnIt=dataItem->cacheNodeMap.findEntry(node);
+	if(cnIt.isFinished()) // Cache miss
+		{
+		/*******************************************************************
+		We use an LRU cache replacement strategy, but do not replace cache
+		slots that were already used in the same rendering pass to prevent
+		cache thrashing. If the cache is full for a rendering pass,
+		additional nodes will be rendered straight from the main memory data
+		structures.
+		*******************************************************************/
+		
+		/* Check if the head of the LRU list is from a previous rendering pass: */
+		if(dataItem->lruHead->lastUsed!=renderPass)
+			{
+			/* Replace the cache slot: */
+			slot=dataItem->lruHead;
+			if(slot->node!=0)
 				{
 				/* Remove the currently cached node: */
 				dataItem->cacheNodeMap.removeEntry(slot->node);
@@ -463,20 +1254,48 @@ void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree:
 			{
 			/* Remember to upload the node's data later: */
 			mustUploadData=true;
+			
+			/* Only upload the changed range if the cached point set was up-to-date when the node's dirty range started: */
+			if(slot->version-node->dirtyBaseVersion<node->pointsVersion-node->dirtyBaseVersion)
+				{
+				uploadBegin=node->dirtyBegin;
+				uploadEnd=node->dirtyEnd;
+				}
 			}
 		}
 	
 	if(slot!=0)
 		{
 		/* Install the cache slot's buffer object (and upload data if required): */
-		if(dataItem->hasVertexBufferObjectExtension)
+		if(dataItem->usePersistentBuffer)
+			{
+			if(mustUploadData)
+				{
+				/* Wait until the GPU is no longer reading the slot's previous contents, then write straight into the mapped buffer: */
+				dataItem->waitForRenderPass(slot->lastUsed);
+				size_t vertexSize=node->getVertexSize();
+				dataItem->numUploadedBytes+=(uploadEnd-uploadBegin)*vertexSize;
+				memcpy(dataItem->persistentBuffer+size_t(slot-dataItem->cacheSlots)*dataItem->slotSize+uploadBegin*vertexSize,static_cast<const char*>(node->points)+uploadBegin*vertexSize,(uploadEnd-uploadBegin)*vertexSize);
+				}
+			}
+		else if(dataItem->hasVertexBufferObjectExtension)
 			{
 			vertexBufferObjectId=slot->vertexBufferObjectId;
 			glBindBufferARB(GL_ARRAY_BUFFER_ARB,vertexBufferObjectId);
 			if(mustUploadData)
 				{
-				size_t arraySize=node->numPoints*(node->haveNormals?sizeof(NVertex):sizeof(Vertex));
-				glBufferDataARB(GL_ARRAY_BUFFER_ARB,arraySize,node->points,GL_DYNAMIC_DRAW_ARB);
+				size_t vertexSize=node->getVertexSize();
+				dataItem->numUploadedBytes+=(uploadEnd-uploadBegin)*vertexSize;
+				if(uploadBegin==0&&uploadEnd==node->numPoints)
+					{
+					/* Replace the buffer's entire contents: */
+					glBufferDataARB(GL_ARRAY_BUFFER_ARB,node->numPoints*vertexSize,node->points,GL_DYNAMIC_DRAW_ARB);
+					}
+				else
+					{
+					/* Only replace the changed range of points: */
+					glBufferSubDataARB(GL_ARRAY_BUFFER_ARB,uploadBegin*vertexSize,(uploadEnd-uploadBegin)*vertexSize,static_cast<const char*>(node->points)+uploadBegin*vertexSize);
+					}
 				}
 			}
 		
@@ -503,7 +1322,8 @@ void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree:
 			{
 			vertexBufferObjectId=dataItem->bypassVertexBufferObjectId;
 			glBindBufferARB(GL_ARRAY_BUFFER_ARB,vertexBufferObjectId);
-			size_t arraySize=node->numPoints*(node->haveNormals?sizeof(NVertex):sizeof(Vertex));
+			size_t arraySize=node->numPoints*node->getVertexSize();
+			dataItem->numUploadedBytes+=arraySize;
 			glBufferDataARB(GL_ARRAY_BUFFER_ARB,arraySize,node->points,GL_STREAM_DRAW_ARB);
 			}
 		dataItem->numBypassedPoints+=node->numPoints;
@@ -517,23 +1337,35 @@ void LidarOctree::renderSubTree(const LidarOctree::Node* node,const LidarOctree:
 	#endif
 	
 	/* Render this node's point set: */
-	if(vertexBufferObjectId!=0)
+	if(dataItem->usePersistentBuffer&&slot!=0)
+		{
+		/* Add the node's cache slot to the multi-draw batch: */
+		dataItem->batchFirsts[dataItem->numBatchedNodes]=GLint((slot-dataItem->cacheSlots)*dataItem->slotNumPoints);
+		dataItem->batchCounts[dataItem->numBatchedNodes]=GLsizei(node->numPoints);
+		++dataItem->numBatchedNodes;
+		}
+	else if(vertexBufferObjectId!=0)
 		{
 		/* Render from the vertex buffer: */
-		if(node->haveNormals)
+		if(node->haveCompactNormals)
+			glVertexPointer(static_cast<const CNVertex*>(0));
+		else if(node->haveNormals)
 			glVertexPointer(static_cast<const NVertex*>(0));
 		else
 			glVertexPointer(static_cast<const Vertex*>(0));
+		glDrawArrays(GL_POINTS,0,node->numPoints);
 		}
 	else
 		{
 		/* Render straight from the node vertex array (only happens if GL_ARB_vertex_buffer_object not supported): */
-		if(node->haveNormals)
+		if(node->haveCompactNormals)
+			glVertexPointer(static_cast<const CNVertex*>(node->points));
+		else if(node->haveNormals)
 			glVertexPointer(static_cast<const NVertex*>(node->points));
 		else
 			glVertexPointer(static_cast<const Vertex*>(node->points));
+		glDrawArrays(GL_POINTS,0,node->numPoints);
 		}
-	glDrawArrays(GL_POINTS,0,node->numPoints);
 	
 	#if 0
 	glColor3f(1.0f,0.0f,0.0f);
@@ -577,268 +1409,674 @@ void LidarOctree::interactWithSubTree(LidarOctree::Node* node,const LidarOctree:
 	/* Calculate an appropriate LOD value for the node: */
 	Scalar interactorLOD=(node->radius*maxRenderLOD)/interactor.radius; // This could use some tweaking
 	
-	/* Update node's rendering traversal state: */
-	{
-	Threads::Mutex::Lock nodeLock(node->nodeMutex);
-	bool nodeStateChanged=false;
-	if(node->renderPass!=renderPass)
+	/* Update node's rendering traversal state and pin it against coarsening; the coarsening heap picks up the changes in the next startRenderPass: */
+	node->updateTraversalState(renderPass,interactorLOD);
+	node->interactionPass=renderPass;
+	
+	/* Check if the node should be subdivided: */
+	if(node->children==0)
 		{
-		/* Store the node's LOD value from this rendering pass: */
-		node->maxLOD=interactorLOD;
-		node->renderPass=renderPass;
-		nodeStateChanged=true;
+		/* Subdivide if the node is not a leaf: */
+		if(node->childrenOffset!=LidarFile::Offset(0))
+			{
+			/* Try inserting this node into the node loader threads' request queue ahead of view-driven requests: */
+			requestSubdivision(node,interactorLOD,InteractionRequest);
+			}
 		}
 	else
 		{
-		/* Update the node's maximum LOD value: */
-		if(node->maxLOD<interactorLOD)
+		/* Recurse into the node's children: */
+		for(int i=0;i<8;++i)
+			interactWithSubTree(&node->children[i],interactor);
+		}
+	}
+
+void LidarOctree::requestSubdivision(const LidarOctree::Node* node,Scalar LOD,LidarOctree::RequestPriority priority) const
+	{
+	Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
+	
+	/* Insert the node into the request queue, or update its existing request; prefetch requests are filed under the previous render pass, and interaction requests under the next render pass, which they prepare: */
+	unsigned int requestPass=renderPass;
+	if(priority==PrefetchRequest)
+		--requestPass;
+	else if(priority==InteractionRequest)
+		++requestPass;
+	if(subdivisionRequestQueue->request(const_cast<Node*>(node),requestPass,float(LOD),priority==InteractionRequest))
+		{
+		/* Wake up a node loader thread: */
+		loadRequestCond.signal();
+		}
+	}
+
+void LidarOctree::collectResidentNodes(const LidarOctree::Node* node,std::vector<LidarOctree::ResidentNode>& residentNodes) const
+	{
+	if(node->children!=0)
+		{
+		residentNodes.push_back(ResidentNode(node->childrenOffset,node->getMaxLOD()));
+		for(int i=0;i<8;++i)
+			collectResidentNodes(&node->children[i],residentNodes);
+		}
+	}
+
+void LidarOctree::preloadNode(const LidarOctree::Node* node)
+	{
+	if(node->childrenOffset==LidarFile::Offset(0))
+		return;
+	
+	/* Check if the node was subdivided in the previous session: */
+	std::vector<ResidentNode>::iterator pnIt=std::lower_bound(preloadNodes.begin(),preloadNodes.end(),ResidentNode(node->childrenOffset,Scalar(0)));
+	bool wasSubdivided=pnIt!=preloadNodes.end()&&pnIt->childrenOffset==node->childrenOffset;
+	if(node->children!=0)
+		{
+		/* Continue with the children of nodes that were already loaded when opening the octree: */
+		if(wasSubdivided)
 			{
-			node->maxLOD=interactorLOD;
-			nodeStateChanged=true;
+			preloadNodes.erase(pnIt);
+			for(int i=0;i<8;++i)
+				preloadNode(&node->children[i]);
 			}
 		}
+	else if(wasSubdivided)
+		{
+		/* Request the node's subdivision below all requests from the current view, and only once: */
+		requestSubdivision(node,pnIt->LOD,PrefetchRequest);
+		preloadNodes.erase(pnIt);
+		}
+	}
+
+void LidarOctree::insertCoarseningCandidate(LidarOctree::Node* node)
+	{
+	if(coarseningClock!=0)
+		coarseningClock->insert(node);
+	else
+		coarseningHeap->insert(node);
+	}
+
+void LidarOctree::removeCoarseningCandidate(LidarOctree::Node* node)
+	{
+	if(coarseningClock!=0)
+		coarseningClock->remove(node);
+	else
+		coarseningHeap->remove(node);
+	}
+
+LidarOctree::Node* LidarOctree::getTopCoarseningCandidate(void) const
+	{
+	if(coarseningClock!=0)
+		return coarseningClock->getTopNode();
+	else
+		return coarseningHeap->getTopNode();
+	}
+
+void LidarOctree::collectCoarseningCandidates(LidarOctree::Node* node,std::vector<LidarOctree::Node*>& candidates)
+	{
+	if(node->coarseningHeapIndex!=~0x0U)
+		candidates.push_back(node);
+	else if(node->children!=0)
+		{
+		for(int i=0;i<8;++i)
+			collectCoarseningCandidates(&node->children[i],candidates);
+		}
+	}
+
+void LidarOctree::coarsen(LidarOctree::Node* node)
+	{
+	// DEBUGGING
+	/* Check if something bad happened: */
+	bool isRemovable=true;
+	for(int i=0;i<8&&isRemovable;++i)
+		isRemovable=node->children[i].children==0&&node->children[i].numSelectedPoints==0;
+	if(!isRemovable)
+		std::cout<<"Removing non-removable nodes!"<<std::endl;
+	
+	/* Delete the node's children: */
+	deleteChildren(node->children);
+	node->children=0;
 	
-	if(node->coarseningHeapIndex!=~0x0U&&nodeStateChanged)
+	/* The previous render pass's cut might contain the deleted nodes: */
+	sharedCutValid=false;
+	
+	/* Update the number of cached nodes: */
+	numCachedNodes-=8;
+	if(cacheManager!=0)
+		cacheManager->removeCachedBytes(8*memNodeSize);
+	
+	/* Remove the node from the coarsening candidates: */
+	removeCoarseningCandidate(node);
+	
+	/* Check if the node's parent is now a coarsening candidate: */
+	if(node->parent!=0)
 		{
-		/* Update the node's data in the coarsening heap: */
+		bool canCoarsenParent=true;
+		for(int childIndex=0;childIndex<8;++childIndex)
+			{
+			Node& sibling=node->parent->children[childIndex];
+			if(sibling.children!=0||sibling.numSelectedPoints!=0)
+				{
+				canCoarsenParent=false;
+				break;
+				}
+			}
+		if(canCoarsenParent)
+			{
+			/* Insert the parent into the coarsening candidates: */
+			insertCoarseningCandidate(node->parent);
+			}
+		}
+	}
+
+void LidarOctree::invalidatePoints(LidarOctree::Node* node,unsigned int begin,unsigned int end)
+	{
+	/* Start a new dirty range in each rendering pass, or extend the current one: */
+	if(node->dirtyRenderPass!=renderPass||node->dirtyBegin>=node->dirtyEnd)
 		{
-		Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
-		coarseningHeap->move(node);
+		/* Cache slots up-to-date as of the current version only need to receive the new range: */
+		node->dirtyBaseVersion=node->pointsVersion;
+		node->dirtyRenderPass=renderPass;
+		node->dirtyBegin=begin;
+		node->dirtyEnd=end;
 		}
+	else
+		{
+		if(node->dirtyBegin>begin)
+			node->dirtyBegin=begin;
+		if(node->dirtyEnd<end)
+			node->dirtyEnd=end;
 		}
+	
+	/* Invalidate the points array: */
+	++node->pointsVersion;
 	}
+
+bool LidarOctree::withdrawSubdivisionRequests(const LidarOctree::Node* children) const
+	{
+	Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
 	
-	/* Check if the node should be subdivided: */
-	if(node->children==0)
+	/* Check if any of the nodes is currently being subdivided by a node loader thread: */
+	for(int i=0;i<8;++i)
+		if(children[i].subdivisionQueueIndex==SubdivisionRequestHeap<Node>::locked)
+			return false;
+	
+	/* Remove the nodes' pending subdivision requests: */
+	for(int i=0;i<8;++i)
+		subdivisionRequestQueue->remove(const_cast<Node*>(&children[i]));
+	
+	return true;
+	}
+
+void LidarOctree::selectPoints(LidarOctree::Node* node,const LidarOctree::Interactor& interactor)
+	{
+	/* Check if the interactor's region of influence intersects the node's domain: */
+	Scalar dist2=node->domain.sqrDist(interactor.center);
+	Scalar ir2=Math::sqr(interactor.radius);
+	if(dist2<ir2)
 		{
-		/* Subdivide if the node is not a leaf: */
-		if(node->childrenOffset!=LidarFile::Offset(0))
+		{
+		Threads::Mutex::Lock selectionLock(getSelectionMutex(node));
+		
+		bool selectionEmpty=node->numSelectedPoints==0;
+		
+		/* Select points in this node: */
+		if(node->haveCompactNormals)
+			selectPointsInNode<CNVertex>(node,interactor);
+		else if(node->haveNormals)
+			selectPointsInNode<NVertex>(node,interactor);
+		else
+			selectPointsInNode<Vertex>(node,interactor);
+		
+		/* Check if this node just had its first points selected: */
+		if(selectionEmpty&&node->numSelectedPoints!=0)
 			{
-			/* Try inserting this node into the node loader thread's request queue: */
-			Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
-			if(node->subdivisionQueueIndex<subdivisionRequestQueueLength)
+			/* Check if the node's parent is in the coarsening heap: */
+			if(node->parent!=0&&node->parent->coarseningHeapIndex!=~0x0U)
 				{
-				/* Update the node's position in the subdivision queue if necessary: */
-				if(subdivisionRequestQueue[node->subdivisionQueueIndex].LOD<interactorLOD)
-					{
-					/* Adjust the node's position in the queue: */
-					for(;node->subdivisionQueueIndex>0&&subdivisionRequestQueue[node->subdivisionQueueIndex-1].LOD<interactorLOD;--node->subdivisionQueueIndex)
-						{
-						subdivisionRequestQueue[node->subdivisionQueueIndex]=subdivisionRequestQueue[node->subdivisionQueueIndex-1];
-						subdivisionRequestQueue[node->subdivisionQueueIndex].node->subdivisionQueueIndex=node->subdivisionQueueIndex;
-						}
-					
-					/* Update the node's LOD value in the queue: */
-					subdivisionRequestQueue[node->subdivisionQueueIndex].node=node;
-					subdivisionRequestQueue[node->subdivisionQueueIndex].LOD=interactorLOD;
-					}
+				Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+				removeCoarseningCandidate(node->parent);
 				}
-			else if(node->subdivisionQueueIndex==subdivisionRequestQueueLength&&subdivisionRequestQueue[subdivisionRequestQueueLength-1].LOD<interactorLOD)
+			}
+		}
+		
+		if(node->children!=0)
+			{
+			/* Recurse into the node's children and update the node's subtree selection count: */
+			node->numSubtreeSelectedPoints=node->numSelectedPoints;
+			for(int childIndex=0;childIndex<8;++childIndex)
 				{
-				/* Remove the node from the last queue slot: */
-				if(subdivisionRequestQueue[subdivisionRequestQueueLength-1].node!=0)
-					subdivisionRequestQueue[subdivisionRequestQueueLength-1].node->subdivisionQueueIndex=subdivisionRequestQueueLength;
-				
-				/* Insert the node into the subdivision request queue: */
-				unsigned int insertIndex;
-				for(insertIndex=subdivisionRequestQueueLength-1;insertIndex>0&&subdivisionRequestQueue[insertIndex-1].LOD<interactorLOD;--insertIndex)
-					{
-					if(subdivisionRequestQueue[insertIndex-1].node!=0)
-						subdivisionRequestQueue[insertIndex-1].node->subdivisionQueueIndex=insertIndex;
-					if(insertIndex<subdivisionRequestQueueLength)
-						subdivisionRequestQueue[insertIndex]=subdivisionRequestQueue[insertIndex-1];
-					}
-				node->subdivisionQueueIndex=insertIndex;
-				subdivisionRequestQueue[insertIndex].node=node;
-				subdivisionRequestQueue[insertIndex].LOD=interactorLOD;
-				
-				/* Wake up the node loader thread: */
-				loadRequestCond.signal();
+				selectPoints(&node->children[childIndex],interactor);
+				node->numSubtreeSelectedPoints+=node->children[childIndex].numSubtreeSelectedPoints;
+				}
+			}
+		}
+	}
+
+bool LidarOctree::deselectPoints(LidarOctree::Node* node,const LidarOctree::Interactor& interactor)
+	{
+	/* Check if the interactor's region of influence intersects the node's domain: */
+	Scalar dist2=node->domain.sqrDist(interactor.center);
+	Scalar ir2=Math::sqr(interactor.radius);
+	if(dist2<ir2&&node->numSubtreeSelectedPoints!=0)
+		{
+		if(node->numSelectedPoints!=0)
+			{
+			Threads::Mutex::Lock selectionLock(getSelectionMutex(node));
+			
+			/* Deselect points in this node: */
+			if(node->haveCompactNormals)
+				deselectPointsInNode<CNVertex>(node,interactor);
+			else if(node->haveNormals)
+				deselectPointsInNode<NVertex>(node,interactor);
+			else
+				deselectPointsInNode<Vertex>(node,interactor);
+			}
+		
+		if(node->children!=0)
+			{
+			/* Recurse into the node's children and update the node's subtree selection count: */
+			node->numSubtreeSelectedPoints=node->numSelectedPoints;
+			bool canCoarsen=true;
+			for(int childIndex=0;childIndex<8;++childIndex)
+				{
+				canCoarsen=deselectPoints(&node->children[childIndex],interactor)&&canCoarsen;
+				node->numSubtreeSelectedPoints+=node->children[childIndex].numSubtreeSelectedPoints;
+				}
+			
+			if(canCoarsen&&node->coarseningHeapIndex==~0x0U)
+				{
+				/* Insert the node into the coarsening candidates: */
+				Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+				insertCoarseningCandidate(node);
+				}
+			}
+		}
+	
+	return node->children==0&&node->numSelectedPoints==0;
+	}
+
+bool LidarOctree::clearSelection(LidarOctree::Node* node)
+	{
+	/* Bail out if there are no selected points in the node's subtree: */
+	if(node->numSubtreeSelectedPoints==0)
+		return node->children==0;
+	
+	if(node->numSelectedPoints!=0)
+		{
+		Threads::Mutex::Lock selectionLock(getSelectionMutex(node));
+		
+		/* Restore the original colors of all selected points: */
+		unsigned int maskSize=node->getSelectionMaskSize();
+		unsigned int selectionRank=0;
+		unsigned int first=node->numPoints,last=0;
+		for(unsigned int word=0;word<maskSize;++word)
+			for(Misc::UInt32 bits=node->selectionMask[word];bits!=0U;bits&=bits-1U,++selectionRank)
+				{
+				unsigned int i=(word<<5)+(unsigned int)(__builtin_ctz(bits));
+				if(first>i)
+					first=i;
+				last=i;
+				if(node->haveCompactNormals)
+					static_cast<CNVertex*>(node->points)[i].color=node->selectedPointColors[selectionRank];
+				else if(node->haveNormals)
+					static_cast<NVertex*>(node->points)[i].color=node->selectedPointColors[selectionRank];
+				else
+					static_cast<Vertex*>(node->points)[i].color=node->selectedPointColors[selectionRank];
 				}
+		
+		/* Destroy the selection mask: */
+		delete[] node->selectionMask;
+		node->selectionMask=0;
+		delete[] node->selectedPointColors;
+		node->selectedPointColors=0;
+		node->numSelectedPoints=0;
+		delete node->selectedPointMoments;
+		node->selectedPointMoments=0;
+		
+		/* Invalidate the range of the points array that contained selected points: */
+		invalidatePoints(node,first,last+1);
+		}
+	
+	if(node->children!=0)
+		{
+		/* Recurse into the node's children: */
+		bool canCoarsen=true;
+		for(int childIndex=0;childIndex<8;++childIndex)
+			canCoarsen=clearSelection(&node->children[childIndex])&&canCoarsen;
+		
+		if(canCoarsen&&node->coarseningHeapIndex==~0x0U)
+			{
+			/* Insert the node into the coarsening candidates: */
+			Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+			insertCoarseningCandidate(node);
 			}
 		}
+	node->numSubtreeSelectedPoints=0;
+	
+	return node->children==0;
+	}
+
+void LidarOctree::accumulateSelectionMoments(const LidarOctree::Node* node,SelectionMoments& moments) const
+	{
+	/* Bail out if there are no selected points in the node's subtree: */
+	if(node->numSubtreeSelectedPoints==0)
+		return;
+	
+	if(node->children!=0)
+		{
+		/* Recurse into the node's children: */
+		for(int childIndex=0;childIndex<8;++childIndex)
+			accumulateSelectionMoments(&node->children[childIndex],moments);
+		}
+	else
+		{
+		/* Add the moments of the leaf node's selected points: */
+		if(node->selectedPointMoments!=0)
+			moments+=*node->selectedPointMoments;
+		}
+	}
+
+namespace {
+
+/**************************************************************
+Helper function to convert mapped LiDAR points to render points:
+**************************************************************/
+
+template <class VertexParam>
+inline
+void
+copyMappedPoints(
+	VertexParam* vertices,
+	const LidarPoint* points,
+	const LidarOctree::Color* colors,
+	unsigned int numPoints,
+	const Vector& pointOffset)
+	{
+	for(unsigned int i=0;i<numPoints;++i,++vertices,++points)
+		{
+		/* Copy the point color, either from the point itself or from the color file: */
+		if(colors!=0)
+			vertices->color=colors[i];
+		else
+			{
+			for(int j=0;j<4;++j)
+				vertices->color[j]=points->value[j];
+			}
+		
+		/* Copy the point position: */
+		vertices->position=*points;
+		
+		#if RECENTER_OCTREE
+		/* Offset the points so that the root node's center is the origin: */
+		vertices->position-=pointOffset;
+		#endif
+		}
+	}
+
+/**************************************************************
+Helper function to store unit normal vectors in compact points:
+**************************************************************/
+
+template <class CompactNormalParam>
+inline
+void
+encodeCompactNormal(
+	CompactNormalParam& compactNormal,
+	const Vector& normal)
+	{
+	for(int i=0;i<3;++i)
+		compactNormal[i]=GLshort(Math::floor(normal[i]*Scalar(32767)+Scalar(0.5)));
+	}
+
+}
+
+Cube LidarOctree::getSourceDomain(const LidarOctree::Node* node) const
+	{
+	#if RECENTER_OCTREE
+	return Cube(node->domain.getMin()+pointOffset,node->domain.getMax()+pointOffset);
+	#else
+	return node->domain;
+	#endif
+	}
+
+bool LidarOctree::readChildBlocks(const LidarOctree::Node* children,LidarOctree::LoaderFiles& files,LidarOctree::DataBlocks& blocks) const
+	{
+	/* Compressed point data is read block by block, and mapped data files need no reading: */
+	if(compressedPoints!=0||pointsMap!=0)
+		return false;
+	
+	/* Check whether the children's records follow each other in the data files: */
+	LidarDataRange childrenRange;
+	for(int childIndex=0;childIndex<8;++childIndex)
+		if(!childrenRange.append(children[childIndex].dataOffset,children[childIndex].numPoints))
+			return false;
+	if(childrenRange.getNumRecords()==0)
+		return false;
+	
+	/* Read the children's records with one request per data file: */
+	readDataBlocks(childrenRange,*files.pointsFile,files.normalsFile,files.colorsFile,blocks);
+	
+	return true;
+	}
+
+void LidarOctree::readDataBlocks(const LidarDataRange& range,LidarSourceFile& blockPointsFile,LidarSourceFile* blockNormalsFile,LidarSourceFile* blockColorsFile,LidarOctree::DataBlocks& blocks) const
+	{
+	if(quantizedPoints)
+		blocks.quantizedPoints.read(blockPointsFile,pointsRecordSize,range);
 	else
+		blocks.points.read(blockPointsFile,pointsRecordSize,range);
+	if(blockNormalsFile!=0)
 		{
-		/* Recurse into the node's children: */
-		for(int i=0;i<8;++i)
-			interactWithSubTree(&node->children[i],interactor);
+		if(quantizedNormals)
+			blocks.quantizedNormals.read(*blockNormalsFile,normalsRecordSize,range);
+		else
+			blocks.normals.read(*blockNormalsFile,normalsRecordSize,range);
 		}
+	if(blockColorsFile!=0)
+		blocks.colors.read(*blockColorsFile,colorsRecordSize,range);
 	}
 
-void LidarOctree::selectPoints(LidarOctree::Node* node,const LidarOctree::Interactor& interactor)
+void LidarOctree::readChildren(LidarOctree::Node* node,LidarOctree::Node* children,LidarSourceFile& nodeIndexFile) const
 	{
-	/* Check if the interactor's region of influence intersects the node's domain: */
-	Scalar dist2=node->domain.sqrDist(interactor.center);
-	Scalar ir2=Math::sqr(interactor.radius);
-	if(dist2<ir2)
+	/* Read the children's structure from the index file's current position: */
+	size_t firstChildIndex=size_t((node->childrenOffset-LidarFile::Offset(LidarOctreeFileHeader::getFileSize()))/LidarFile::Offset(LidarOctreeFileNode::getFileSize()));
+	for(int childIndex=0;childIndex<8;++childIndex)
 		{
+		LidarOctreeFileNode ofn;
+		ofn.read(nodeIndexFile);
+		children[childIndex].parent=node;
+		children[childIndex].childrenOffset=ofn.childrenOffset;
+		children[childIndex].domain=Cube(node->domain,childIndex);
+		setNodeBounds(&children[childIndex],firstChildIndex+childIndex);
+		children[childIndex].radius=Math::div2(node->radius);
+		children[childIndex].numPoints=ofn.numPoints;
+		children[childIndex].haveNormals=node->haveNormals;
+		children[childIndex].haveCompactNormals=node->haveCompactNormals;
+		children[childIndex].dataOffset=ofn.dataOffset;
+		children[childIndex].detailSize=ofn.detailSize;
+		}
+	}
+
+void LidarOctree::readNodePoints(const LidarOctree::Node* node,LidarSourceFile& nodePointsFile,LidarPoint* points,const LidarOctree::DataBlocks* blocks) const
+	{
+	if(quantizedPoints&&blocks!=0)
 		{
-		Threads::Mutex::Lock selectionLock(node->selectionMutex);
-		
-		bool selectionEmpty=node->selectedPoints==0;
-		
-		/* Select points in this node: */
-		if(node->haveNormals)
-			selectPointsInNode<NVertex>(node,interactor);
+		/* Convert the quantized points read together with the node's siblings relative to the node's domain: */
+		dequantizePoints(blocks->quantizedPoints.getRecords(node->dataOffset),node->numPoints,getSourceDomain(node),points);
+		}
+	else if(quantizedPoints)
+		{
+		/* Read the quantized points and convert them relative to the node's domain: */
+		Misc::SelfDestructArray<QuantizedLidarPoint> qPoints(node->numPoints);
+		if(compressedPoints!=0)
+			compressedPoints->readRecords(nodePointsFile,node->dataOffset,node->numPoints,qPoints.getArray());
 		else
-			selectPointsInNode<Vertex>(node,interactor);
-		
-		/* Check if this node just had its first points selected: */
-		if(selectionEmpty&&node->selectedPoints!=0)
 			{
-			/* Check if the node's parent is in the coarsening heap: */
-			if(node->parent!=0&&node->parent->coarseningHeapIndex!=~0x0U)
-				{
-				Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
-				coarseningHeap->remove(node->parent);
-				}
+			nodePointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node->dataOffset);
+			nodePointsFile.read(qPoints.getArray(),node->numPoints);
 			}
+		dequantizePoints(qPoints.getArray(),node->numPoints,getSourceDomain(node),points);
 		}
-		
-		if(node->children!=0)
-			{
-			/* Recurse into the node's children: */
-			for(int childIndex=0;childIndex<8;++childIndex)
-				selectPoints(&node->children[childIndex],interactor);
-			}
+	else if(compressedPoints!=0)
+		{
+		/* Decompress the node's block of points: */
+		compressedPoints->readRecords(nodePointsFile,node->dataOffset,node->numPoints,points);
+		}
+	else if(blocks!=0)
+		{
+		/* Copy the points read together with the node's siblings: */
+		const LidarPoint* bpPtr=blocks->points.getRecords(node->dataOffset);
+		for(unsigned int i=0;i<node->numPoints;++i)
+			points[i]=bpPtr[i];
+		}
+	else
+		{
+		nodePointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node->dataOffset);
+		nodePointsFile.read(points,node->numPoints);
 		}
 	}
 
-bool LidarOctree::deselectPoints(LidarOctree::Node* node,const LidarOctree::Interactor& interactor)
+void LidarOctree::readNodeNormals(const LidarOctree::Node* node,LidarSourceFile& nodeNormalsFile,Vector* normals,const LidarOctree::DataBlocks* blocks) const
 	{
-	/* Check if the interactor's region of influence intersects the node's domain: */
-	Scalar dist2=node->domain.sqrDist(interactor.center);
-	Scalar ir2=Math::sqr(interactor.radius);
-	if(dist2<ir2)
+	if(blocks!=0)
 		{
-		if(node->selectedPoints!=0)
+		/* Copy or decode the normal vectors read together with the node's siblings: */
+		if(quantizedNormals)
 			{
-			Threads::Mutex::Lock selectionLock(node->selectionMutex);
-			
-			/* Deselect points in this node: */
-			if(node->haveNormals)
-				deselectPointsInNode<NVertex>(node,interactor);
-			else
-				deselectPointsInNode<Vertex>(node,interactor);
+			const QuantizedNormal* bnPtr=blocks->quantizedNormals.getRecords(node->dataOffset);
+			for(unsigned int i=0;i<node->numPoints;++i)
+				normals[i]=decodeNormal(bnPtr[i]);
 			}
-		
-		if(node->children!=0)
+		else
 			{
-			/* Recurse into the node's children: */
-			bool canCoarsen=true;
-			for(int childIndex=0;childIndex<8;++childIndex)
-				canCoarsen=deselectPoints(&node->children[childIndex],interactor)&&canCoarsen;
-			
-			if(canCoarsen&&node->coarseningHeapIndex==~0x0U)
-				{
-				/* Insert the node into the coarsening heap: */
-				Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
-				coarseningHeap->insert(node);
-				}
+			const Vector* bnPtr=blocks->normals.getRecords(node->dataOffset);
+			for(unsigned int i=0;i<node->numPoints;++i)
+				normals[i]=bnPtr[i];
 			}
+		return;
 		}
 	
-	return node->children==0&&node->selectedPoints==0;
+	nodeNormalsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+normalsRecordSize*node->dataOffset);
+	if(quantizedNormals)
+		{
+		/* Read the encoded normal vectors and decode them: */
+		Misc::SelfDestructArray<QuantizedNormal> qNormals(node->numPoints);
+		nodeNormalsFile.read(qNormals.getArray(),node->numPoints);
+		for(unsigned int i=0;i<node->numPoints;++i)
+			normals[i]=decodeNormal(qNormals[i]);
+		}
+	else
+		nodeNormalsFile.read(normals,node->numPoints);
 	}
 
-bool LidarOctree::clearSelection(LidarOctree::Node* node)
+void LidarOctree::readNodeColors(const LidarOctree::Node* node,LidarSourceFile& nodeColorsFile,LidarPoint* points,const LidarOctree::DataBlocks* blocks) const
 	{
-	if(node->selectedPoints!=0)
+	/* Get the node's colors from the block read together with the node's siblings, or load them into a temporary buffer: */
+	Misc::SelfDestructArray<Color> colorsBuffer(blocks!=0?0U:node->numPoints);
+	const Color* cPtr;
+	if(blocks!=0)
+		cPtr=blocks->colors.getRecords(node->dataOffset);
+	else
 		{
-		Threads::Mutex::Lock selectionLock(node->selectionMutex);
-		
-		/* Deselect all selected points: */
-		bool pointsChanged=false;
-		if(node->haveNormals)
+		nodeColorsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+colorsRecordSize*node->dataOffset);
+		nodeColorsFile.read(colorsBuffer.getArray(),node->numPoints);
+		cPtr=colorsBuffer.getArray();
+		}
+	
+	/* Copy the colors into the point buffer: */
+	LidarPoint* pPtr=points;
+	for(unsigned int i=0;i<node->numPoints;++i,++pPtr,++cPtr)
+		for(int j=0;j<4;++j)
+			pPtr->value[j]=(*cPtr)[j];
+	}
+
+void LidarOctree::loadNodePoints(LidarOctree::Node* node,LidarSourceFile& nodePointsFile,LidarSourceFile* nodeNormalsFile,LidarSourceFile* nodeColorsFile,LidarPoint* pointsBuffer,Vector* normalsBuffer,const LidarOctree::DataBlocks* blocks)
+	{
+	/* Take the node's point array from the pool; it is returned to the pool with the node even if loading fails: */
+	if(node->haveCompactNormals)
+		node->points=pointArrayPool->allocate<CNVertex>();
+	else if(node->haveNormals)
+		node->points=pointArrayPool->allocate<NVertex>();
+	else
+		node->points=pointArrayPool->allocate<Vertex>();
+	
+	if(pointsMap!=0)
+		{
+		/* Access the node's point data inside the mapped files: */
+		pointsMap->checkRecords(node->dataOffset,node->numPoints);
+		const LidarPoint* mappedPoints;
+		if(quantizedPoints)
 			{
-			NVertex* points=static_cast<NVertex*>(node->points);
-			for(unsigned int i=0;i<node->numPoints;++i)
-				{
-				if(node->selectedPoints[i])
-					{
-					GLubyte intensity=node->selectedPoints[i];
-					points[i].color=node->selectedPointColors[i];
-					pointsChanged=true;
-					}
-				}
+			/* Convert the mapped quantized points relative to the node's domain into the staging buffer: */
+			dequantizePoints(pointsMap->getRecords<QuantizedLidarPoint>(node->dataOffset),node->numPoints,getSourceDomain(node),pointsBuffer);
+			mappedPoints=pointsBuffer;
 			}
 		else
+			mappedPoints=pointsMap->getRecords<LidarPoint>(node->dataOffset);
+		const Color* mappedColors=0;
+		if(colorsMap!=0)
+			{
+			colorsMap->checkRecords(node->dataOffset,node->numPoints);
+			mappedColors=colorsMap->getRecords<Color>(node->dataOffset);
+			}
+		
+		/* Convert the mapped points straight into the node's render point array: */
+		if(node->haveCompactNormals)
 			{
-			Vertex* points=static_cast<Vertex*>(node->points);
+			normalsMap->checkRecords(node->dataOffset,node->numPoints);
+			CNVertex* points=static_cast<CNVertex*>(node->points);
+			copyMappedPoints(points,mappedPoints,mappedColors,node->numPoints,pointOffset);
+			const QuantizedNormal* mappedNormals=normalsMap->getRecords<QuantizedNormal>(node->dataOffset);
 			for(unsigned int i=0;i<node->numPoints;++i)
+				encodeCompactNormal(points[i].normal,decodeNormal(mappedNormals[i]));
+			}
+		else if(node->haveNormals)
+			{
+			normalsMap->checkRecords(node->dataOffset,node->numPoints);
+			NVertex* points=static_cast<NVertex*>(node->points);
+			copyMappedPoints(points,mappedPoints,mappedColors,node->numPoints,pointOffset);
+			NVertex* npPtr=points;
+			if(quantizedNormals)
 				{
-				if(node->selectedPoints[i])
-					{
-					GLubyte intensity=node->selectedPoints[i];
-					points[i].color=node->selectedPointColors[i];
-					pointsChanged=true;
-					}
+				const QuantizedNormal* mappedNormals=normalsMap->getRecords<QuantizedNormal>(node->dataOffset);
+				for(unsigned int i=0;i<node->numPoints;++i,++npPtr)
+					npPtr->normal=decodeNormal(mappedNormals[i]);
+				}
+			else
+				{
+				const Vector* mappedNormals=normalsMap->getRecords<Vector>(node->dataOffset);
+				for(unsigned int i=0;i<node->numPoints;++i,++npPtr)
+					npPtr->normal=mappedNormals[i];
 				}
 			}
+		else
+			copyMappedPoints(static_cast<Vertex*>(node->points),mappedPoints,mappedColors,node->numPoints,pointOffset);
 		
-		/* Destroy the selection mask: */
-		delete[] node->selectedPoints;
-		node->selectedPoints=0;
-		delete[] node->selectedPointColors;
-		node->selectedPointColors=0;
-		
-		/* Check if the points array has to be invalidated: */
-		if(pointsChanged)
-			++node->pointsVersion;
+		return;
 		}
 	
-	if(node->children!=0)
+	/* Load the node's points and colors into the staging buffer: */
+	readNodePoints(node,nodePointsFile,pointsBuffer,blocks);
+	if(nodeColorsFile!=0)
+		readNodeColors(node,*nodeColorsFile,pointsBuffer,blocks);
+	
+	if(node->haveCompactNormals)
 		{
-		/* Recurse into the node's children: */
-		bool canCoarsen=true;
-		for(int childIndex=0;childIndex<8;++childIndex)
-			canCoarsen=clearSelection(&node->children[childIndex])&&canCoarsen;
+		/* Load the node's normal vectors into the staging buffer: */
+		readNodeNormals(node,*nodeNormalsFile,normalsBuffer,blocks);
 		
-		if(canCoarsen&&node->coarseningHeapIndex==~0x0U)
-			{
-			/* Insert the node into the coarsening heap: */
-			Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
-			coarseningHeap->insert(node);
-			}
+		/* Convert the LiDAR points to compact render points: */
+		CNVertex* points=static_cast<CNVertex*>(node->points);
+		copyMappedPoints(points,pointsBuffer,0,node->numPoints,pointOffset);
+		for(unsigned int i=0;i<node->numPoints;++i)
+			encodeCompactNormal(points[i].normal,normalsBuffer[i]);
 		}
-	
-	return node->children==0;
-	}
-
-void LidarOctree::loadNodePoints(LidarOctree::Node* node)
-	{
-	if(node->haveNormals)
+	else if(node->haveNormals)
 		{
-		/* Create the node's point array (always allocate the maximum size to prevent memory fragmentation): */
-		Misc::SelfDestructArray<NVertex> points(maxNumPointsPerNode);
-		
-		/* Load the node's points into a temporary point buffer: */
-		Misc::SelfDestructArray<LidarPoint> pointsBuffer(maxNumPointsPerNode);
-		pointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node->dataOffset);
-		pointsFile.read(pointsBuffer.getArray(),node->numPoints);
-		Misc::SelfDestructArray<Vector> normalsBuffer(maxNumPointsPerNode);
-		normalsFile->setReadPosAbs(LidarDataFileHeader::getFileSize()+normalsRecordSize*node->dataOffset);
-		normalsFile->read(normalsBuffer.getArray(),node->numPoints);
-		
-		if(colorsFile!=0)
-			{
-			/* Load the node's colors into a temporary buffer: */
-			Misc::SelfDestructArray<Color> colorsBuffer(maxNumPointsPerNode);
-			colorsFile->setReadPosAbs(LidarDataFileHeader::getFileSize()+colorsRecordSize*node->dataOffset);
-			colorsFile->read(colorsBuffer.getArray(),node->numPoints);
-			
-			/* Copy the colors into the point buffer: */
-			LidarPoint* pPtr=pointsBuffer.getArray();
-			Color* cPtr=colorsBuffer.getArray();
-			for(unsigned int i=0;i<node->numPoints;++i,++pPtr,++cPtr)
-				for(int j=0;j<4;++j)
-					pPtr->value[j]=(*cPtr)[j];
-			}
+		/* Load the node's normal vectors into the staging buffer: */
+		readNodeNormals(node,*nodeNormalsFile,normalsBuffer,blocks);
 		
 		/* Convert the LiDAR points to render points: */
-		NVertex* npPtr=points.getArray();
-		const LidarPoint* pPtr=pointsBuffer.getArray();
-		const Vector* nPtr=normalsBuffer.getArray();
+		NVertex* npPtr=static_cast<NVertex*>(node->points);
+		const LidarPoint* pPtr=pointsBuffer;
+		const Vector* nPtr=normalsBuffer;
 		for(unsigned int i=0;i<node->numPoints;++i,++npPtr,++pPtr,++nPtr)
 			{
 			/* Copy the point color: */
@@ -856,38 +2094,12 @@ void LidarOctree::loadNodePoints(LidarOctree::Node* node)
 			npPtr->position-=pointOffset;
 			#endif
 			}
-		
-		/* Store the new point array in the node: */
-		node->points=points.releaseTarget();
 		}
 	else
 		{
-		/* Create the node's point array (always allocate the maximum size to prevent memory fragmentation): */
-		Misc::SelfDestructArray<Vertex> points(maxNumPointsPerNode);
-		
-		/* Load the node's points into a temporary point buffer: */
-		Misc::SelfDestructArray<LidarPoint> pointsBuffer(maxNumPointsPerNode);
-		pointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node->dataOffset);
-		pointsFile.read(pointsBuffer.getArray(),node->numPoints);
-		
-		if(colorsFile!=0)
-			{
-			/* Load the node's colors into a temporary buffer: */
-			Misc::SelfDestructArray<Color> colorsBuffer(maxNumPointsPerNode);
-			colorsFile->setReadPosAbs(LidarDataFileHeader::getFileSize()+colorsRecordSize*node->dataOffset);
-			colorsFile->read(colorsBuffer.getArray(),node->numPoints);
-			
-			/* Copy the colors into the point buffer: */
-			LidarPoint* pPtr=pointsBuffer.getArray();
-			Color* cPtr=colorsBuffer.getArray();
-			for(unsigned int i=0;i<node->numPoints;++i,++pPtr,++cPtr)
-				for(int j=0;j<4;++j)
-					pPtr->value[j]=(*cPtr)[j];
-			}
-		
 		/* Convert the LiDAR points to render points: */
-		Vertex* npPtr=points.getArray();
-		const LidarPoint* pPtr=pointsBuffer.getArray();
+		Vertex* npPtr=static_cast<Vertex*>(node->points);
+		const LidarPoint* pPtr=pointsBuffer;
 		for(unsigned int i=0;i<node->numPoints;++i,++npPtr,++pPtr)
 			{
 			/* Copy the point color: */
@@ -902,26 +2114,230 @@ void LidarOctree::loadNodePoints(LidarOctree::Node* node)
 			npPtr->position-=pointOffset;
 			#endif
 			}
+		}
+	}
+
+namespace {
+
+/*************************************************************
+Helper function to map attribute values to color alpha values:
+*************************************************************/
+
+template <class ValueParam,class VertexParam>
+inline
+void
+readAttributeAlphas(
+	LidarSourceFile& attributeFile,
+	unsigned int numPoints,
+	double attributeMin,
+	double attributeScale,
+	VertexParam* points)
+	{
+	/* Read the attribute values: */
+	Misc::SelfDestructArray<ValueParam> values(numPoints);
+	attributeFile.read(values.getArray(),numPoints);
+	
+	/* Map the values to [0, 255] and store them in the points' alpha components: */
+	for(unsigned int i=0;i<numPoints;++i)
+		{
+		double alpha=(double(values[i])-attributeMin)*attributeScale;
+		points[i].color[3]=alpha<=0.0?GLubyte(0):alpha>=255.0?GLubyte(255):GLubyte(alpha+0.5);
+		}
+	}
+
+template <class VertexParam>
+inline
+void
+readAttributeAlphas(
+	LidarSourceFile& attributeFile,
+	unsigned int recordSize,
+	unsigned int numPoints,
+	double attributeMin,
+	double attributeScale,
+	VertexParam* points)
+	{
+	/* Interpret the attribute records based on their size: */
+	switch(recordSize)
+		{
+		case 1:
+			readAttributeAlphas<Misc::UInt8>(attributeFile,numPoints,attributeMin,attributeScale,points);
+			break;
+		
+		case 2:
+			readAttributeAlphas<Misc::UInt16>(attributeFile,numPoints,attributeMin,attributeScale,points);
+			break;
+		
+		case 4:
+			readAttributeAlphas<Misc::Float32>(attributeFile,numPoints,attributeMin,attributeScale,points);
+			break;
+		
+		case 8:
+			readAttributeAlphas<Misc::Float64>(attributeFile,numPoints,attributeMin,attributeScale,points);
+			break;
+		}
+	}
+
+}
+
+void LidarOctree::loadNodeAttribute(LidarOctree::Node* node,LidarSourceFile& nodeAttributeFile) const
+	{
+	/* Read the node's attribute records directly into its point array: */
+	nodeAttributeFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+LidarFile::Offset(colorAttributeRecordSize)*node->dataOffset);
+	if(node->haveCompactNormals)
+		readAttributeAlphas(nodeAttributeFile,colorAttributeRecordSize,node->numPoints,colorAttributeMin,colorAttributeScale,static_cast<CNVertex*>(node->points));
+	else if(node->haveNormals)
+		readAttributeAlphas(nodeAttributeFile,colorAttributeRecordSize,node->numPoints,colorAttributeMin,colorAttributeScale,static_cast<NVertex*>(node->points));
+	else
+		readAttributeAlphas(nodeAttributeFile,colorAttributeRecordSize,node->numPoints,colorAttributeMin,colorAttributeScale,static_cast<Vertex*>(node->points));
+	}
+
+namespace {
+
+/**********************************************************
+Helper class to propagate selected points into child nodes:
+**********************************************************/
+
+class SelectedPointGrid // Hashed grid of a node's selected points, with cells the size of the maximum propagation distance
+	{
+	/* Embedded classes: */
+	private:
+	struct CellPoint // Structure to sort points by the cells containing them
+		{
+		/* Elements: */
+		public:
+		Misc::UInt64 key; // Hash key of the cell containing the point
+		Point point; // The point
+		
+		/* Methods: */
+		bool operator<(const CellPoint& other) const
+			{
+			return key<other.key;
+			}
+		};
+	
+	struct CellPoints // Structure to locate a cell's points in the grid's point array
+		{
+		/* Elements: */
+		public:
+		unsigned int firstPoint; // Index of the cell's first point
+		unsigned int numPoints; // Number of points in the cell
+		};
+	
+	typedef Misc::HashTable<Misc::UInt64,CellPoints> CellHasher; // Hash table mapping cell keys to cells' points
+	
+	/* Elements: */
+	double origin[3]; // Position of the grid's minimum corner
+	double cellSize; // Side length of the grid's cells
+	Scalar maxDist2; // Squared maximum propagation distance
+	std::vector<Point> points; // The selected points, sorted by cell
+	CellHasher cells; // Hash table of the grid's non-empty cells
+	
+	/* Private methods: */
+	static Misc::UInt64 getCellKey(const int cellIndex[3]) // Returns the hash key of the given cell; accepts indices from -1 to 2^21-2
+		{
+		return (Misc::UInt64(cellIndex[0]+1)<<42)|(Misc::UInt64(cellIndex[1]+1)<<21)|Misc::UInt64(cellIndex[2]+1);
+		}
+	void getCellIndex(const Point& p,int cellIndex[3]) const // Returns the index of the cell containing the given point
+		{
+		for(int i=0;i<3;++i)
+			cellIndex[i]=int(Math::floor((double(p[i])-origin[i])/cellSize));
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	SelectedPointGrid(const Point& sOrigin,Scalar maxDist,std::vector<CellPoint>& cellPoints); // Creates a grid for the given points; reorders the given point array
+	
+	/* Methods: */
+	template <class VertexParam>
+	static SelectedPointGrid* create(const Cube& domain,Scalar maxDist,const VertexParam* vertices,unsigned int numVertices,const Misc::UInt32* selectionMask) // Returns a grid of the selected vertices inside the given domain
+		{
+		/* Collect the positions of all selected vertices: */
+		std::vector<CellPoint> cellPoints;
+		unsigned int maskSize=(numVertices+31U)>>5;
+		for(unsigned int word=0;word<maskSize;++word)
+			for(Misc::UInt32 bits=selectionMask[word];bits!=0U;bits&=bits-1U)
+				{
+				CellPoint cp;
+				cp.point=vertices[(word<<5)+(unsigned int)(__builtin_ctz(bits))].position;
+				cellPoints.push_back(cp);
+				}
+		
+		return new SelectedPointGrid(domain.getMin(),maxDist,cellPoints);
+		}
+	bool findMatch(const Point& p) const // Returns true if the grid contains a point within the maximum propagation distance of the given point
+		{
+		/* Check the cell containing the point and all its neighbors: */
+		int cellIndex[3];
+		getCellIndex(p,cellIndex);
+		int ci[3];
+		for(ci[0]=cellIndex[0]-1;ci[0]<=cellIndex[0]+1;++ci[0])
+			for(ci[1]=cellIndex[1]-1;ci[1]<=cellIndex[1]+1;++ci[1])
+				for(ci[2]=cellIndex[2]-1;ci[2]<=cellIndex[2]+1;++ci[2])
+					{
+					CellHasher::ConstIterator cIt=cells.findEntry(getCellKey(ci));
+					if(!cIt.isFinished())
+						{
+						const CellPoints& cp=cIt->getDest();
+						for(unsigned int i=0;i<cp.numPoints;++i)
+							if(Geometry::sqrDist(points[cp.firstPoint+i],p)<=maxDist2)
+								return true;
+						}
+					}
 		
-		/* Store the new point array in the node: */
-		node->points=points.releaseTarget();
+		return false;
+		}
+	};
+
+SelectedPointGrid::SelectedPointGrid(const Point& sOrigin,Scalar maxDist,std::vector<SelectedPointGrid::CellPoint>& cellPoints)
+	:cellSize(double(maxDist)),maxDist2(Math::sqr(maxDist)),
+	 cells(cellPoints.size()/4+17)
+	{
+	for(int i=0;i<3;++i)
+		origin[i]=double(sOrigin[i]);
+	
+	/* Sort the points by cell: */
+	for(std::vector<CellPoint>::iterator cpIt=cellPoints.begin();cpIt!=cellPoints.end();++cpIt)
+		{
+		int cellIndex[3];
+		getCellIndex(cpIt->point,cellIndex);
+		cpIt->key=getCellKey(cellIndex);
+		}
+	std::sort(cellPoints.begin(),cellPoints.end());
+	
+	/* Store the sorted points and enter each cell's point range into the hash table: */
+	points.reserve(cellPoints.size());
+	unsigned int first=0;
+	for(unsigned int i=0;i<cellPoints.size();++i)
+		{
+		points.push_back(cellPoints[i].point);
+		if(i+1==cellPoints.size()||cellPoints[i+1].key!=cellPoints[i].key)
+			{
+			CellPoints cp;
+			cp.firstPoint=first;
+			cp.numPoints=i+1-first;
+			cells.setEntry(CellHasher::Entry(cellPoints[i].key,cp));
+			first=i+1;
+			}
 		}
 	}
 
+}
+
 template <class VertexParam>
 inline
 void
 LidarOctree::selectCloseNeighbors(
-	LidarOctree::Node* node,
+	const LidarOctree::Node* node,
 	unsigned int left,
 	unsigned int right,
 	int splitDimension,
 	const VertexParam& point,
-	Scalar maxDist)
+	Scalar maxDist,
+	Misc::UInt32* selectionMask) const
 	{
 	/* Calculate the index of the current point: */
 	unsigned int mid=(left+right)>>1;
-	VertexParam& np=static_cast<VertexParam*>(node->points)[mid];
+	const VertexParam& np=static_cast<const VertexParam*>(node->points)[mid];
 	
 	int childSplitDimension=splitDimension+1;
 	if(childSplitDimension==3)
@@ -932,35 +2348,35 @@ LidarOctree::selectCloseNeighbors(
 		{
 		/* Traverse left child: */
 		if(left<mid)
-			selectCloseNeighbors(node,left,mid-1,childSplitDimension,point,maxDist);
+			selectCloseNeighbors(node,left,mid-1,childSplitDimension,point,maxDist,selectionMask);
 		
 		/* Process the current point: */
 		if(Geometry::sqrDist(point.position,np.position)<=Math::sqr(maxDist))
 			{
 			/* Select the point: */
-			selectPoint<VertexParam>(node,mid);
+			selectionMask[mid>>5]|=Misc::UInt32(1)<<(mid&31U);
 			}
 		
 		/* Traverse the right child: */
 		if(point.position[splitDimension]+maxDist>=np.position[splitDimension]&&right>mid)
-			selectCloseNeighbors(node,mid+1,right,childSplitDimension,point,maxDist);
+			selectCloseNeighbors(node,mid+1,right,childSplitDimension,point,maxDist,selectionMask);
 		}
 	else
 		{
 		/* Traverse right child: */
 		if(right>mid)
-			selectCloseNeighbors(node,mid+1,right,childSplitDimension,point,maxDist);
+			selectCloseNeighbors(node,mid+1,right,childSplitDimension,point,maxDist,selectionMask);
 		
 		/* Process the current point: */
 		if(Geometry::sqrDist(point.position,np.position)<=Math::sqr(maxDist))
 			{
 			/* Select the point: */
-			selectPoint<VertexParam>(node,mid);
+			selectionMask[mid>>5]|=Misc::UInt32(1)<<(mid&31U);
 			}
 		
 		/* Traverse the left child: */
 		if(point.position[splitDimension]-maxDist<=np.position[splitDimension]&&left<mid)
-			selectCloseNeighbors(node,left,mid-1,childSplitDimension,point,maxDist);
+			selectCloseNeighbors(node,left,mid-1,childSplitDimension,point,maxDist,selectionMask);
 		}
 	}
 
@@ -972,72 +2388,99 @@ LidarOctree::propagateSelectedPoints(
 	LidarOctree::Node* children)
 	{
 	VertexParam* nodePoints=static_cast<VertexParam*>(node->points);
+	unsigned int nodeMaskSize=node->getSelectionMaskSize();
+	
+	/* Create a hashed grid of the node's selected points unless the propagation distance is degenerate: */
+	SelectedPointGrid* grid=0;
+	if(node->detailSize>Scalar(0))
+		grid=SelectedPointGrid::create(node->domain,node->detailSize,nodePoints,node->numPoints,node->selectionMask);
+	
+	std::vector<Misc::UInt32> childSelectionMask;
 	for(int childIndex=0;childIndex<8;++childIndex)
 		if(children[childIndex].numPoints!=0)
 			{
-			VertexParam* childPoints=static_cast<VertexParam*>(children[childIndex].points);
+			Node& child=children[childIndex];
+			childSelectionMask.assign(child.getSelectionMaskSize(),Misc::UInt32(0));
 			
-			/* Process each selected point in the node: */
-			for(unsigned int i=0;i<node->numPoints;++i)
-				if(node->selectedPoints[i])
-					{
-					/* Select the point's close neighbors in the child node: */
-					selectCloseNeighbors<VertexParam>(&children[childIndex],0,children[childIndex].numPoints-1,0,nodePoints[i],node->detailSize);
-					}
+			if(grid!=0)
+				{
+				/* Select each child point that is close to any selected point in the node: */
+				const VertexParam* childPoints=static_cast<const VertexParam*>(child.points);
+				for(unsigned int i=0;i<child.numPoints;++i)
+					if(grid->findMatch(childPoints[i].position))
+						childSelectionMask[i>>5]|=Misc::UInt32(1)<<(i&31U);
+				}
+			else
+				{
+				/* Process each selected point in the node: */
+				for(unsigned int word=0;word<nodeMaskSize;++word)
+					for(Misc::UInt32 bits=node->selectionMask[word];bits!=0U;bits&=bits-1U)
+						{
+						/* Select the point's close neighbors in the child node: */
+						unsigned int i=(word<<5)+(unsigned int)(__builtin_ctz(bits));
+						selectCloseNeighbors<VertexParam>(&child,0,child.numPoints-1,0,nodePoints[i],node->detailSize,&childSelectionMask[0]);
+						}
+				}
+			
+			/* Apply the propagated selection to the child node: */
+			updateSelection<VertexParam>(&child,&childSelectionMask[0]);
+			child.numSubtreeSelectedPoints=child.numSelectedPoints;
 			}
+	
+	delete grid;
 	}
 
-void* LidarOctree::nodeLoaderThreadMethod(void)
+void* LidarOctree::nodeLoaderThreadMethod(unsigned int threadIndex)
 	{
+	/* Use the thread's private set of file handles so that several loader threads can read concurrently: */
+	LoaderFiles& files=*nodeLoaderFiles[threadIndex];
+	TraceEvents::setThreadName("Node loader");
+	
 	while(true)
 		{
 		/* Get the next subdivision request: */
 		Node* node;
 		{
 		Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
-		while(subdivisionRequestQueue[0].node==0)
+		while(subdivisionRequestQueue->getNumItems()==0)
 			loadRequestCond.wait(loadRequestMutex);
-		node=subdivisionRequestQueue[0].node;
-		
-		/* Remove the node from the queue: */
-		unsigned int i;
-		for(i=1;i<subdivisionRequestQueueLength&&subdivisionRequestQueue[i].node!=0;++i)
-			{
-			subdivisionRequestQueue[i].node->subdivisionQueueIndex=i-1;
-			subdivisionRequestQueue[i-1]=subdivisionRequestQueue[i];
-			}
-		subdivisionRequestQueue[i-1].node=0;
-		subdivisionRequestQueue[i-1].LOD=Scalar(0);
 		
-		/* Lock the node until it has been loaded: */
-		node->subdivisionQueueIndex=~0x0U;
+		/* Remove the most urgent node from the queue and lock it until it has been loaded: */
+		node=subdivisionRequestQueue->removeTop();
 		}
 		
 		/* Create the node's children: */
-		Node* children=new Node[8];
+		TraceEvents::Scope traceScope("LoadSubdivision","LidarOctree");
+		Misc::Timer loadTimer;
+		Node* children=nodeBlockPool.allocate();
 		bool childrenOk=true;
+		Misc::UInt64 numBytesRead=Misc::UInt64(LidarOctreeFileNode::getFileSize())*8U;
 		
 		try
 			{
-			indexFile.setReadPosAbs(node->childrenOffset);
+			files.indexFile->setReadPosAbs(node->childrenOffset);
+			readChildren(node,children,*files.indexFile);
+			
+			/* Load the node's children's point data, with one request per data file if the children's records are stored contiguously: */
+			DataBlocks blocks;
+			const DataBlocks* blocksPtr=readChildBlocks(children,files,blocks)?&blocks:0;
 			for(int childIndex=0;childIndex<8;++childIndex)
 				{
-				LidarOctreeFileNode ofn;
-				ofn.read(indexFile);
-				children[childIndex].parent=node;
-				children[childIndex].childrenOffset=ofn.childrenOffset;
-				children[childIndex].domain=Cube(node->domain,childIndex);
-				children[childIndex].radius=Math::div2(node->radius);
-				children[childIndex].numPoints=ofn.numPoints;
-				children[childIndex].haveNormals=node->haveNormals;
-				children[childIndex].dataOffset=ofn.dataOffset;
-				children[childIndex].detailSize=ofn.detailSize;
-				children[childIndex].subdivisionQueueIndex=subdivisionRequestQueueLength;
+				loadNodePoints(&children[childIndex],*files.pointsFile,files.normalsFile,files.colorsFile,files.pointsBuffer,files.normalsBuffer,blocksPtr);
+				if(colorAttributeRecordSize!=0)
+					{
+					/* Store the children's color attribute values in their point colors: */
+					if(files.attributeFile==0)
+						files.attributeFile=source.openPart(("Attribute."+colorAttributeName).c_str());
+					loadNodeAttribute(&children[childIndex],*files.attributeFile);
+					numBytesRead+=Misc::UInt64(children[childIndex].numPoints)*Misc::UInt64(colorAttributeRecordSize);
+					}
+				numBytesRead+=Misc::UInt64(children[childIndex].numPoints)*Misc::UInt64(pointsRecordSize);
+				if(files.normalsFile!=0)
+					numBytesRead+=Misc::UInt64(children[childIndex].numPoints)*Misc::UInt64(normalsRecordSize);
+				if(files.colorsFile!=0)
+					numBytesRead+=Misc::UInt64(children[childIndex].numPoints)*Misc::UInt64(colorsRecordSize);
 				}
-
-			/* Load the node's children's point data: */
-			for(int childIndex=0;childIndex<8;++childIndex)
-				loadNodePoints(&children[childIndex]);
 			}
 		catch(const std::runtime_error&)
 			{
@@ -1047,12 +2490,23 @@ void* LidarOctree::nodeLoaderThreadMethod(void)
 		
 		if(childrenOk)
 			{
+			/* Update the loader statistics: */
+			loadTimer.elapse();
+			{
+			Threads::Mutex::Lock statisticsLock(statisticsMutex);
+			++loaderStatistics.numLoadedSubdivisions;
+			loaderStatistics.loadTime+=loadTimer.getTime();
+			loaderStatistics.numBytesRead+=numBytesRead;
+			}
+			
 			{
-			Threads::Mutex::Lock nodeSelectionLock(node->selectionMutex);
-			if(node->selectedPoints!=0)
+			Threads::Mutex::Lock nodeSelectionLock(getSelectionMutex(node));
+			if(node->numSelectedPoints!=0)
 				{
 				/* Propagate selected points from the node to its children: */
-				if(node->haveNormals)
+				if(node->haveCompactNormals)
+					propagateSelectedPoints<CNVertex>(node,children);
+				else if(node->haveNormals)
 					propagateSelectedPoints<NVertex>(node,children);
 				else
 					propagateSelectedPoints<Vertex>(node,children);
@@ -1075,63 +2529,50 @@ void* LidarOctree::nodeLoaderThreadMethod(void)
 		else
 			{
 			/* Delete the child nodes again and carry on: */
-			delete[] children;
-			}
-		}
-	
-	return 0;
-	}
-
-namespace {
-
-/***********************************************************
-Helper functions to load LiDAR files given a base file name:
-***********************************************************/
-
-std::string getLidarPartFileName(const char* lidarFileName,const char* partFileName)
-	{
-	std::string result=lidarFileName;
-	result.push_back('/');
-	result.append(partFileName);
-	return result;
+			deleteChildren(children);
+			}
+		}
+	
+	return 0;
 	}
 
-}
-
-LidarOctree::LidarOctree(const char* lidarFileName,size_t sCacheSize,size_t sGlCacheSize)
-	:indexFile(getLidarPartFileName(lidarFileName,"Index").c_str()),
-	 pointsFile(getLidarPartFileName(lidarFileName,"Points").c_str()),
+LidarOctree::LidarOctree(const char* sLidarFileName,size_t sCacheSize,size_t sGlCacheSize,bool mapDataFiles,unsigned int sNumNodeLoaderThreads)
+	:source(sLidarFileName),
+	 indexFile(source.openPart("Index")),
+	 pointsFile(source.openPart("Points")),
 	 normalsFile(0),
 	 colorsFile(0),
+	 quantizedPoints(false),quantizedNormals(false),
+	 compressedPoints(0),
+	 pointsMap(0),normalsMap(0),colorsMap(0),
+	 colorAttributeRecordSize(0),colorAttributeMin(0.0),colorAttributeScale(1.0),
+	 pointArrayPool(0),
 	 maxRenderLOD(Math::sqrt(Scalar(2))),
 	 fncWeight(0),
+	 autoGlCacheFraction(0.5),
+	 persistentGlCache(false),
+	 occlusionCulling(false),
+	 pointBudget(0),glUploadBudget(0),
+	 prefetching(false),prefetchTransform(OGTransform::identity),
+	 sharedTraversal(false),incrementalTraversal(false),sharedTraversalPass(~0U),sharedCutValid(false),
+	 cacheManager(0),protectedNode(0),
 	 numCachedNodes(0),
 	 renderPass(0U),
 	 treeUpdateFunction(0),treeUpdateFunctionArg(0),
-	 subdivisionRequestQueueLength(16),subdivisionRequestQueue(new SubdivisionRequest[subdivisionRequestQueueLength]),
-	 coarseningHeap(0)
+	 numNodeLoaderThreads(sNumNodeLoaderThreads>0?sNumNodeLoaderThreads:1),nodeLoaderThreads(0),
+	 subdivisionRequestQueue(new SubdivisionRequestHeap<Node>(4096)),
+	 coarseningHeap(0),coarseningClock(0)
 	{
 	/* Check if there is a normal vector file: */
-	try
-		{
-		normalsFile=new LidarFile(getLidarPartFileName(lidarFileName,"Normals").c_str());
-		}
-	catch(const std::runtime_error&)
-		{
-		}
+	if(source.hasPart("Normals"))
+		normalsFile=source.openPart("Normals");
 	
 	/* Check if there is a color file: */
-	try
-		{
-		colorsFile=new LidarFile(getLidarPartFileName(lidarFileName,"Colors").c_str());
-		}
-	catch(const std::runtime_error&)
-		{
-		}
+	if(source.hasPart("Colors"))
+		colorsFile=source.openPart("Colors");
 	
 	/* Read the octree file header: */
-	indexFile.setEndianness(Misc::LittleEndian);
-	LidarOctreeFileHeader ofh(indexFile);
+	LidarOctreeFileHeader ofh(*indexFile);
 	
 	/* Initialize the root node's domain: */
 	#if RECENTER_OCTREE
@@ -1146,61 +2587,140 @@ LidarOctree::LidarOctree(const char* lidarFileName,size_t sCacheSize,size_t sGlC
 		rootRadius2+=Math::sqr(root.domain.getMax()[i]-root.domain.getMin()[i]);
 	root.radius=Math::div2(Math::sqrt(rootRadius2));
 	
+	/* Load the optional node summaries and set the root node's bounding box: */
+	loadSummaries();
+	setNodeBounds(&root,0);
+	
 	/* Initialize the tree structure: */
 	maxNumPointsPerNode=ofh.maxNumPointsPerNode;
 	root.haveNormals=normalsFile!=0;
+	root.haveCompactNormals=false;
+	if(root.haveNormals)
+		{
+		/* Read the normal vector file's header: */
+		LidarDataFileHeader dfh(*normalsFile);
+		normalsRecordSize=LidarFile::Offset(dfh.recordSize);
+		quantizedNormals=dfh.recordSize==sizeof(QuantizedNormal);
+		
+		/* Encoded normal vectors are unit-length and can be stored in compact render points without further loss: */
+		root.haveCompactNormals=quantizedNormals;
+		}
 	
 	/* Calculate the memory and GPU cache sizes: */
-	size_t vertexSize=root.haveNormals?sizeof(NVertex):sizeof(Vertex);
-	size_t memNodeSize=sizeof(Node)+maxNumPointsPerNode*vertexSize;
+	size_t vertexSize=root.getVertexSize();
+	memNodeSize=sizeof(Node)+maxNumPointsPerNode*vertexSize;
 	size_t glNodeSize=maxNumPointsPerNode*vertexSize;
+	if(sCacheSize==0)
+		{
+		/* Use half of the currently available physical memory: */
+		sCacheSize=getAutoCacheSize();
+		}
 	cacheSize=sCacheSize/memNodeSize;
 	if(cacheSize==0)
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Specified memory cache size too small");
-	glCacheSize=sGlCacheSize/glNodeSize;
-	if(glCacheSize==0)
-		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Specified GPU cache size too small");
-	std::cout<<"Cache sizes: "<<cacheSize<<" memory nodes, "<<glCacheSize<<" GPU nodes"<<std::endl;
+	if(sGlCacheSize!=0)
+		{
+		glCacheSize=sGlCacheSize/glNodeSize;
+		if(glCacheSize<2)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Specified GPU cache size too small");
+		std::cout<<"Cache sizes: "<<cacheSize<<" memory nodes, "<<glCacheSize<<" GPU nodes"<<std::endl;
+		}
+	else
+		{
+		/* Size the GPU cache when the OpenGL context is known: */
+		glCacheSize=0;
+		std::cout<<"Cache sizes: "<<cacheSize<<" memory nodes, automatic GPU nodes"<<std::endl;
+		}
+	
+	/* Create the pool of render point arrays: */
+	pointArrayPool=new PointArrayPool(maxNumPointsPerNode*vertexSize,cacheSize);
 	
 	/* Read the root node's structure: */
 	LidarOctreeFileNode rootfn;
-	rootfn.read(indexFile);
+	rootfn.read(*indexFile);
 	root.childrenOffset=rootfn.childrenOffset;
 	root.numPoints=rootfn.numPoints;
 	root.dataOffset=rootfn.dataOffset;
 	root.detailSize=rootfn.detailSize;
-	root.subdivisionQueueIndex=subdivisionRequestQueueLength;
 	
 	/* Read the point file's header: */
-	pointsFile.setEndianness(Misc::LittleEndian);
-	LidarDataFileHeader dfh(pointsFile);
-	pointsRecordSize=LidarFile::Offset(dfh.recordSize);
-	
-	if(root.haveNormals)
+	LidarDataFileHeader dfh(*pointsFile);
+	if(LidarCompressedFile::isCompressed(dfh.recordSize))
 		{
-		/* Read the normal vector file's header: */
-		normalsFile->setEndianness(Misc::LittleEndian);
-		LidarDataFileHeader dfh(*normalsFile);
-		normalsRecordSize=LidarFile::Offset(dfh.recordSize);
+		/* Read the compressed points file's block table: */
+		compressedPoints=new LidarCompressedFile(*pointsFile);
+		pointsRecordSize=LidarFile::Offset(compressedPoints->getRecordSize());
 		}
+	else
+		pointsRecordSize=LidarFile::Offset(dfh.recordSize);
+	quantizedPoints=pointsRecordSize==LidarFile::Offset(sizeof(QuantizedLidarPoint));
 	
 	if(colorsFile!=0)
 		{
 		/* Read the color file's header: */
-		colorsFile->setEndianness(Misc::LittleEndian);
 		LidarDataFileHeader dfh(*colorsFile);
 		colorsRecordSize=LidarFile::Offset(dfh.recordSize);
 		}
 	
+	if(mapDataFiles&&source.isRemote())
+		{
+		/* Remote files are read through the block cache and can not be mapped; ignore the request: */
+		mapDataFiles=false;
+		}
+	if(mapDataFiles&&compressedPoints!=0)
+		{
+		/* Compressed blocks have to be decompressed on load and can not be used in place; ignore the request: */
+		mapDataFiles=false;
+		}
+	if(mapDataFiles)
+		{
+		/* Map the points file and all ancillary data files into memory: */
+		pointsMap=new LidarMappedFile(getLidarPartFileName(sLidarFileName,"Points").c_str());
+		if(normalsFile!=0)
+			normalsMap=new LidarMappedFile(getLidarPartFileName(sLidarFileName,"Normals").c_str());
+		if(colorsFile!=0)
+			colorsMap=new LidarMappedFile(getLidarPartFileName(sLidarFileName,"Colors").c_str());
+		
+		/* Fall back to reading the data files if their records can not be used in place: */
+		if(pointsMap->getRecordSize()!=(quantizedPoints?sizeof(QuantizedLidarPoint):sizeof(LidarPoint))||(normalsMap!=0&&normalsMap->getRecordSize()!=(quantizedNormals?sizeof(QuantizedNormal):sizeof(Vector)))||(colorsMap!=0&&colorsMap->getRecordSize()!=sizeof(Color)))
+			{
+			delete pointsMap;
+			pointsMap=0;
+			delete normalsMap;
+			normalsMap=0;
+			delete colorsMap;
+			colorsMap=0;
+			}
+		}
+	
 	/* Load the root's point data: */
-	loadNodePoints(&root);
+	{
+	Misc::SelfDestructArray<LidarPoint> pointsBuffer(maxNumPointsPerNode);
+	Misc::SelfDestructArray<Vector> normalsBuffer(root.haveNormals?maxNumPointsPerNode:0U);
+	loadNodePoints(&root,*pointsFile,normalsFile,colorsFile,pointsBuffer.getArray(),normalsBuffer.getArray());
+	}
 	numCachedNodes=1;
 	
 	/* Create the coarsening heap: */
 	coarseningHeap=new CoarseningHeap<Node>((cacheSize+7U)/8U+1U); // Pessimistic estimate
 	
-	/* Start the node loader thread: */
-	nodeLoaderThread.start(this,&LidarOctree::nodeLoaderThreadMethod);
+	/* Open a private set of file handles for each node loader thread up front, so that errors are thrown from the constructor instead of inside the threads: */
+	try
+		{
+		for(unsigned int i=0;i<numNodeLoaderThreads;++i)
+			nodeLoaderFiles.push_back(new LoaderFiles(source,normalsFile!=0,colorsFile!=0,maxNumPointsPerNode));
+		}
+	catch(...)
+		{
+		for(std::vector<LoaderFiles*>::iterator nlfIt=nodeLoaderFiles.begin();nlfIt!=nodeLoaderFiles.end();++nlfIt)
+			delete *nlfIt;
+		throw;
+		}
+	
+	/* Start the node loader threads: */
+	nodeLoaderThreads=new Threads::Thread[numNodeLoaderThreads];
+	for(unsigned int i=0;i<numNodeLoaderThreads;++i)
+		nodeLoaderThreads[i].start(this,&LidarOctree::nodeLoaderThreadMethod,i);
 	
 	/* Initialize render state: */
 	renderPass=1U;
@@ -1208,25 +2728,85 @@ LidarOctree::LidarOctree(const char* lidarFileName,size_t sCacheSize,size_t sGlC
 
 LidarOctree::~LidarOctree(void)
 	{
-	/* Shut down the node loader thread: */
-	nodeLoaderThread.cancel();
-	nodeLoaderThread.join();
+	/* Shut down the node loader threads: */
+	for(unsigned int i=0;i<numNodeLoaderThreads;++i)
+		{
+		nodeLoaderThreads[i].cancel();
+		nodeLoaderThreads[i].join();
+		}
+	delete[] nodeLoaderThreads;
+	for(std::vector<LoaderFiles*>::iterator nlfIt=nodeLoaderFiles.begin();nlfIt!=nodeLoaderFiles.end();++nlfIt)
+		delete *nlfIt;
+	
+	/* Release the octree's share of a shared memory cache: */
+	if(cacheManager!=0)
+		cacheManager->removeOctree(this,size_t(numCachedNodes)*memNodeSize);
 	
-	/* Delete the coarsening heap: */
+	/* Delete the coarsening candidates: */
 	delete coarseningHeap;
+	delete coarseningClock;
 	
 	/* Delete the subdivision request queue: */
-	delete[] subdivisionRequestQueue;
+	delete subdivisionRequestQueue;
+	
+	/* Return all loaded nodes to the node block pool before it is destroyed: */
+	for(std::vector<Node*>::iterator rnIt=readyNodes.begin();rnIt!=readyNodes.end();++rnIt)
+		deleteChildren(*rnIt);
+	if(root.children!=0)
+		deleteChildren(root.children);
+	root.children=0;
+	pointArrayPool->free(root.points);
+	root.points=0;
+	delete pointArrayPool;
+	
+	/* Unmap the data files: */
+	delete pointsMap;
+	delete normalsMap;
+	delete colorsMap;
+	
+	/* Delete the compressed points file's block table: */
+	delete compressedPoints;
 	
-	/* Delete the optional normal vector and color file: */
+	/* Close the octree and data files: */
+	delete indexFile;
+	delete pointsFile;
 	delete normalsFile;
 	delete colorsFile;
 	}
 
 void LidarOctree::initContext(GLContextData& contextData) const
 	{
+	/* Calculate the GPU cache size: */
+	size_t vertexSize=root.getVertexSize();
+	unsigned int contextGlCacheSize=glCacheSize;
+	if(contextGlCacheSize==0)
+		{
+		/* Query the amount of free graphics card memory in KB from vendor-specific extensions: */
+		GLint freeKb=0;
+		if(GLExtensionManager::isExtensionSupported("GL_NVX_gpu_memory_info"))
+			{
+			/* Query GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX: */
+			glGetIntegerv(0x9049,&freeKb);
+			}
+		else if(GLExtensionManager::isExtensionSupported("GL_ATI_meminfo"))
+			{
+			/* Query the total free memory in GL_VBO_FREE_MEMORY_ATI: */
+			GLint vboFree[4]={0,0,0,0};
+			glGetIntegerv(0x87FB,vboFree);
+			freeKb=vboFree[0];
+			}
+		
+		/* Use the configured fraction of free memory, or 128MB if the amount is unknown: */
+		size_t glCacheBytes=size_t(128)*size_t(1024*1024);
+		if(freeKb>0)
+			glCacheBytes=size_t(double(freeKb)*1024.0*autoGlCacheFraction);
+		contextGlCacheSize=(unsigned int)(glCacheBytes/(size_t(maxNumPointsPerNode)*vertexSize));
+		if(contextGlCacheSize<2)
+			contextGlCacheSize=2;
+		}
+	
 	/* Create a context data item: */
-	DataItem* dataItem=new DataItem(glCacheSize);
+	DataItem* dataItem=new DataItem(contextGlCacheSize,persistentGlCache,maxNumPointsPerNode,vertexSize);
 	contextData.addDataItem(this,dataItem);
 	}
 
@@ -1278,115 +2858,479 @@ void LidarOctree::setBaseSurfelSize(float newBaseSurfelSize,float newSurfelScale
 	surfelScale=newSurfelScale;
 	}
 
+void LidarOctree::setPersistentGlCache(bool newPersistentGlCache)
+	{
+	persistentGlCache=newPersistentGlCache;
+	}
+
+void LidarOctree::setAutoGlCacheFraction(double newAutoGlCacheFraction)
+	{
+	autoGlCacheFraction=newAutoGlCacheFraction;
+	}
+
+void LidarOctree::setOcclusionCulling(bool newOcclusionCulling)
+	{
+	occlusionCulling=newOcclusionCulling;
+	}
+
+void LidarOctree::setPointBudget(size_t newPointBudget)
+	{
+	pointBudget=newPointBudget;
+	}
+
+void LidarOctree::setGlUploadBudget(size_t newGlUploadBudget)
+	{
+	glUploadBudget=newGlUploadBudget;
+	}
+
+void LidarOctree::setColorAttribute(const char* newColorAttributeName,double attributeMin,double attributeMax)
+	{
+	/* Open the attribute channel and check its record size: */
+	std::string partName="Attribute.";
+	partName.append(newColorAttributeName);
+	if(!source.hasPart(partName.c_str()))
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"LiDAR file has no attribute channel %s",newColorAttributeName);
+	LidarSourceFile* attributeFile=source.openPart(partName.c_str());
+	unsigned int recordSize;
+	try
+		{
+		LidarDataFileHeader dfh(*attributeFile);
+		recordSize=dfh.recordSize;
+		}
+	catch(...)
+		{
+		delete attributeFile;
+		throw;
+		}
+	if(recordSize!=1&&recordSize!=2&&recordSize!=4&&recordSize!=8)
+		{
+		delete attributeFile;
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Attribute channel %s has unsupported record size %u",newColorAttributeName,recordSize);
+		}
+	
+	/* Set up the mapping from attribute values to alpha components: */
+	colorAttributeName=newColorAttributeName;
+	colorAttributeMin=attributeMin;
+	colorAttributeScale=attributeMax>attributeMin?255.0/(attributeMax-attributeMin):1.0;
+	
+	/* Store the root's attribute values; the node loader threads will pick up the channel with their next request: */
+	try
+		{
+		colorAttributeRecordSize=recordSize;
+		loadNodeAttribute(&root,*attributeFile);
+		}
+	catch(...)
+		{
+		colorAttributeRecordSize=0;
+		colorAttributeName.clear();
+		delete attributeFile;
+		throw;
+		}
+	delete attributeFile;
+	}
+
+void LidarOctree::setSharedTraversal(bool newSharedTraversal)
+	{
+	sharedTraversal=newSharedTraversal;
+	}
+
+void LidarOctree::setIncrementalTraversal(bool newIncrementalTraversal)
+	{
+	incrementalTraversal=newIncrementalTraversal;
+	}
+
+void LidarOctree::setClockCoarsening(bool newClockCoarsening)
+	{
+	Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+	if(newClockCoarsening==(coarseningClock!=0))
+		return;
+	
+	/* Collect the current coarsening candidates and remove them from the old policy: */
+	std::vector<Node*> candidates;
+	collectCoarseningCandidates(&root,candidates);
+	for(std::vector<Node*>::iterator cIt=candidates.begin();cIt!=candidates.end();++cIt)
+		removeCoarseningCandidate(*cIt);
+	
+	/* Switch policies: */
+	unsigned int maxNumCandidates=(cacheSize+7U)/8U+1U; // Pessimistic estimate
+	if(newClockCoarsening)
+		{
+		delete coarseningHeap;
+		coarseningHeap=0;
+		coarseningClock=new CoarseningClock<Node>(maxNumCandidates);
+		coarseningClock->update(renderPass);
+		}
+	else
+		{
+		delete coarseningClock;
+		coarseningClock=0;
+		coarseningHeap=new CoarseningHeap<Node>(maxNumCandidates);
+		}
+	
+	/* Add the candidates to the new policy: */
+	for(std::vector<Node*>::iterator cIt=candidates.begin();cIt!=candidates.end();++cIt)
+		insertCoarseningCandidate(*cIt);
+	}
+
+void LidarOctree::setCacheManager(LidarCacheManager* newCacheManager)
+	{
+	/* Move the octree's cached nodes from the old to the new cache manager: */
+	if(cacheManager!=0)
+		cacheManager->removeOctree(this,size_t(numCachedNodes)*memNodeSize);
+	cacheManager=newCacheManager;
+	if(cacheManager!=0)
+		cacheManager->addOctree(this,size_t(numCachedNodes)*memNodeSize);
+	}
+
+bool LidarOctree::getCoarseningCandidate(unsigned int& age,Scalar& lod) const
+	{
+	Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+	Node* coarsenNode=getTopCoarseningCandidate();
+	if(coarsenNode==0||coarsenNode==protectedNode)
+		return false;
+	
+	/* Measure the candidate's age against the octree's own render pass counter to compare it to other octrees' candidates: */
+	age=renderPass-coarsenNode->getRenderPass();
+	lod=coarsenNode->getMaxLOD();
+	return true;
+	}
+
+bool LidarOctree::coarsenCandidate(void)
+	{
+	Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+	Node* coarsenNode=getTopCoarseningCandidate();
+	if(coarsenNode==0||coarsenNode==protectedNode||!withdrawSubdivisionRequests(coarsenNode->children))
+		return false;
+	
+	coarsen(coarsenNode);
+	return true;
+	}
+
+void LidarOctree::setPrefetchTransform(const LidarOctree::OGTransform& newPrefetchTransform)
+	{
+	prefetching=true;
+	prefetchTransform=newPrefetchTransform;
+	}
+
+void LidarOctree::disablePrefetching(void)
+	{
+	prefetching=false;
+	}
+
+LidarOctree::RenderStatistics LidarOctree::getRenderStatistics(void) const
+	{
+	Threads::Mutex::Lock statisticsLock(statisticsMutex);
+	return renderStatistics;
+	}
+
+LidarOctree::LoaderStatistics LidarOctree::getLoaderStatistics(void) const
+	{
+	LoaderStatistics result;
+	{
+	Threads::Mutex::Lock statisticsLock(statisticsMutex);
+	result=loaderStatistics;
+	}
+	{
+	Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
+	result.numQueuedRequests=subdivisionRequestQueue->getNumItems();
+	}
+	result.numCachedNodes=numCachedNodes;
+	result.cacheSize=cacheSize;
+	
+	return result;
+	}
+
+LidarOctree::PreloadStatistics LidarOctree::preloadTopLevels(unsigned int numLevels)
+	{
+	/* Leave at least half of the memory cache to view-dependent subdivisions: */
+	unsigned int maxNumCachedNodes=cacheSize/2U;
+	
+	/* Open the color attribute channel if one is stored in the point colors: */
+	LidarSourceFile* attributeFile=0;
+	if(colorAttributeRecordSize!=0)
+		attributeFile=source.openPart(("Attribute."+colorAttributeName).c_str());
+	
+	Misc::SelfDestructArray<LidarPoint> pointsBuffer(maxNumPointsPerNode);
+	Misc::SelfDestructArray<Vector> normalsBuffer(root.haveNormals?maxNumPointsPerNode:0U);
+	std::vector<Node*> level(1,&root);
+	PreloadStatistics result;
+	for(;result.numPreloadedLevels<numLevels;++result.numPreloadedLevels)
+		{
+		/* Collect the current level's interior nodes and stop if their children do not fit into the cache budget: */
+		std::vector<Node*> parents;
+		for(std::vector<Node*>::iterator lIt=level.begin();lIt!=level.end();++lIt)
+			if((*lIt)->childrenOffset!=LidarFile::Offset(0))
+				parents.push_back(*lIt);
+		if(parents.empty()||numCachedNodes+8U*(unsigned int)(parents.size())>maxNumCachedNodes)
+			break;
+		
+		std::vector<Node*> childBlocks;
+		childBlocks.reserve(parents.size());
+		try
+			{
+			/* Read the next level's index records; index files are level-ordered, so this is one sequential read unless a file was written differently: */
+			LidarFile::Offset indexPos=LidarFile::Offset(0);
+			for(std::vector<Node*>::iterator pIt=parents.begin();pIt!=parents.end();++pIt)
+				{
+				Node* children=nodeBlockPool.allocate();
+				childBlocks.push_back(children);
+				if((*pIt)->childrenOffset!=indexPos)
+					indexFile->setReadPosAbs((*pIt)->childrenOffset);
+				readChildren(*pIt,children,*indexFile);
+				indexPos=(*pIt)->childrenOffset+LidarFile::Offset(LidarOctreeFileNode::getFileSize())*8U;
+				}
+			
+			/* Read the next level's point data in runs of sibling groups, with one request per data file and run if the run's records are stored contiguously: */
+			const size_t maxNumRunBlocks=64; // Bounds the size of the temporary data blocks
+			for(size_t runStart=0;runStart<childBlocks.size();runStart+=maxNumRunBlocks)
+				{
+				size_t runEnd=runStart+maxNumRunBlocks<childBlocks.size()?runStart+maxNumRunBlocks:childBlocks.size();
+				LidarDataRange runRange;
+				bool contiguous=compressedPoints==0&&pointsMap==0;
+				for(size_t block=runStart;block<runEnd&&contiguous;++block)
+					for(int i=0;i<8&&contiguous;++i)
+						contiguous=runRange.append(childBlocks[block][i].dataOffset,childBlocks[block][i].numPoints);
+				DataBlocks blocks;
+				const DataBlocks* blocksPtr=0;
+				if(contiguous&&runRange.getNumRecords()!=0)
+					{
+					readDataBlocks(runRange,*pointsFile,normalsFile,colorsFile,blocks);
+					blocksPtr=&blocks;
+					}
+				for(size_t block=runStart;block<runEnd;++block)
+					for(int i=0;i<8;++i)
+						{
+						loadNodePoints(&childBlocks[block][i],*pointsFile,normalsFile,colorsFile,pointsBuffer.getArray(),normalsBuffer.getArray(),blocksPtr);
+						if(attributeFile!=0)
+							loadNodeAttribute(&childBlocks[block][i],*attributeFile);
+						}
+				}
+			}
+		catch(const std::runtime_error& err)
+			{
+			/* Keep the levels loaded so far, leave the rest to the node loader threads, and report the error to the caller: */
+			result.errorMessage=err.what();
+			for(std::vector<Node*>::iterator cbIt=childBlocks.begin();cbIt!=childBlocks.end();++cbIt)
+				deleteChildren(*cbIt);
+			break;
+			}
+		
+		/* Attach the next level to the tree: */
+		std::vector<Node*> nextLevel;
+		nextLevel.reserve(childBlocks.size()*8);
+		{
+		Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+		for(size_t i=0;i<parents.size();++i)
+			{
+			Node* node=parents[i];
+			Node* children=childBlocks[i];
+			node->children=children;
+			for(int childIndex=0;childIndex<8;++childIndex)
+				{
+				children[childIndex].pointsVersion=renderPass;
+				children[childIndex].dirtyBaseVersion=renderPass;
+				nextLevel.push_back(&children[childIndex]);
+				}
+			
+			/* Make the node instead of its parent a coarsening candidate: */
+			if(node->parent!=0&&node->parent->coarseningHeapIndex!=~0x0U)
+				removeCoarseningCandidate(node->parent);
+			insertCoarseningCandidate(node);
+			
+			/* Update the node cache: */
+			numCachedNodes+=8;
+			if(cacheManager!=0)
+				cacheManager->addCachedBytes(8*memNodeSize);
+			}
+		}
+		result.numPreloadedNodes+=(unsigned int)(nextLevel.size());
+		level.swap(nextLevel);
+		}
+	delete attributeFile;
+	
+	return result;
+	}
+
+void LidarOctree::saveResidentNodes(IO::File& file) const
+	{
+	/* Write the key identifying the octree's LiDAR file: */
+	Misc::writeCppString(source.getLidarFileName(),file);
+	file.write<Misc::UInt64>(indexFile->getSize());
+	
+	/* Write all nodes whose children are in memory: */
+	std::vector<ResidentNode> residentNodes;
+	collectResidentNodes(&root,residentNodes);
+	file.write<Misc::UInt32>(Misc::UInt32(residentNodes.size()));
+	for(std::vector<ResidentNode>::iterator rnIt=residentNodes.begin();rnIt!=residentNodes.end();++rnIt)
+		{
+		file.write<Misc::UInt64>(rnIt->childrenOffset);
+		file.write<Misc::Float32>(rnIt->LOD);
+		}
+	}
+
+bool LidarOctree::preloadResidentNodes(IO::File& file)
+	{
+	/* Read the key and the node set: */
+	std::string lidarFileName=Misc::readCppString(file);
+	Misc::UInt64 indexFileSize=file.read<Misc::UInt64>();
+	Misc::UInt32 numNodes=file.read<Misc::UInt32>();
+	std::vector<ResidentNode> residentNodes;
+	residentNodes.reserve(numNodes);
+	for(Misc::UInt32 i=0;i<numNodes;++i)
+		{
+		LidarFile::Offset childrenOffset=file.read<Misc::UInt64>();
+		Scalar LOD=file.read<Misc::Float32>();
+		residentNodes.push_back(ResidentNode(childrenOffset,LOD));
+		}
+	
+	/* Bail out if the set belongs to a different LiDAR file: */
+	if(lidarFileName!=source.getLidarFileName()||indexFileSize!=Misc::UInt64(indexFile->getSize()))
+		return false;
+	
+	/* Start preloading from the root: */
+	std::sort(residentNodes.begin(),residentNodes.end());
+	preloadNodes.swap(residentNodes);
+	preloadNode(&root);
+	
+	return true;
+	}
+
 void LidarOctree::startRenderPass(void)
 	{
+	{
+	/* Count the nodes recently loaded by the node loader thread: */
+	unsigned int numReadyNodes;
+	{
+	Threads::Mutex::Lock readyNodesLock(readyNodesMutex);
+	numReadyNodes=(unsigned int)(readyNodes.size());
+	}
+	
+	Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
+	if(coarseningClock!=0)
+		{
+		/* Start a new pass on the coarsening clock: */
+		coarseningClock->update(renderPass);
+		
+		/* Coarsen enough candidates in one batch to make room for all recently loaded nodes: */
+		if(cacheManager==0)
+			{
+			unsigned int numNeededNodes=numCachedNodes+8U*numReadyNodes;
+			if(numNeededNodes>cacheSize)
+				{
+				/* Collect one victim for each block of eight nodes over the cache size, and coarsen those whose children are not being loaded: */
+				std::vector<Node*> victims;
+				coarseningClock->collectVictims((numNeededNodes-cacheSize+7U)/8U,victims);
+				for(std::vector<Node*>::iterator vIt=victims.begin();vIt!=victims.end();++vIt)
+					if(withdrawSubdivisionRequests((*vIt)->children))
+						coarsen(*vIt);
+				}
+			}
+		}
+	else
+		{
+		/* Apply all node state changes from the previous rendering pass to the coarsening heap in one batch, and pin the nodes touched by interactors since then: */
+		coarseningHeap->update(renderPass);
+		}
+	}
+	
 	{
 	/* Process all nodes recently loaded by the node loader thread: */
+	TraceEvents::Scope traceScope("IntegrateReadyNodes","LidarOctree");
 	Threads::Mutex::Lock readyNodesLock(readyNodesMutex);
 	for(std::vector<Node*>::iterator rnIt=readyNodes.begin();rnIt!=readyNodes.end();++rnIt)
 		{
 		Node* children=*rnIt;
 		Node* node=children->parent;
+		bool canSubdivide=true;
 		
 		/* Check if the node cache is full: */
-		if(numCachedNodes+8>cacheSize)
+		if(cacheManager!=0)
+			{
+			/* Coarsen less important nodes of any octree sharing the cache until the node's children fit: */
+			protectedNode=node->parent;
+			canSubdivide=cacheManager->makeRoom(8*memNodeSize,renderPass-node->getRenderPass(),node->getMaxLOD());
+			protectedNode=0;
+			}
+		else if(numCachedNodes+8>cacheSize)
 			{
 			/* Get the best coarsening candidate: */
 			Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
 			// DEBUGGING
 			//std::cout<<coarseningHeap->getNumItems()<<std::endl;
-			Node* coarsenNode=coarseningHeap->getTopNode();
+			Node* coarsenNode=getTopCoarseningCandidate();
 			
-			if(coarsenNode!=0&&coarsenNode!=node->parent)
-				{
-				/* Check if subdividing the node will improve the overall tree: */
-				if(coarsenNode->renderPass<node->renderPass||(coarsenNode->renderPass==node->renderPass&&coarsenNode->maxLOD<node->maxLOD))
-					{
-					// DEBUGGING
-					/* Check if something bad happened: */
-					bool isRemovable=true;
-					for(int i=0;i<8&&isRemovable;++i)
-						isRemovable=coarsenNode->children[i].children==0&&coarsenNode->children[i].selectedPoints==0;
-					if(!isRemovable)
-						std::cout<<"Removing non-removable nodes!"<<std::endl;
-					
-					/* Delete the coarsening candidate's children: */
-					delete[] coarsenNode->children;
-					coarsenNode->children=0;
-					
-					/* Update the number of cached nodes: */
-					numCachedNodes-=8;
-					
-					/* Remove the coarsening candidate from the coarsening heap: */
-					coarseningHeap->remove(coarsenNode);
-					
-					/* Check if the coarsening candidate's parent node is now a coarsening candidate: */
-					if(coarsenNode->parent!=0)
-						{
-						bool canCoarsenParent=true;
-						for(int childIndex=0;childIndex<8;++childIndex)
-							{
-							Node& sibling=coarsenNode->parent->children[childIndex];
-							if(sibling.children!=0||sibling.selectedPoints!=0)
-								{
-								canCoarsenParent=false;
-								break;
-								}
-							}
-						if(canCoarsenParent)
-							{
-							/* Insert the parent into the coarsening heap: */
-							coarseningHeap->insert(coarsenNode->parent);
-							}
-						}
-					}
-				}
+			/* Check if subdividing the node will improve the overall tree, and if the coarsening candidate's children are not being loaded: */
+			if(coarsenNode!=0&&coarsenNode!=node->parent&&(coarsenNode->getRenderPass()<node->getRenderPass()||(coarsenNode->getRenderPass()==node->getRenderPass()&&coarsenNode->getMaxLOD()<node->getMaxLOD()))&&withdrawSubdivisionRequests(coarsenNode->children))
+				coarsen(coarsenNode);
 			}
 		
 		/* Check if the node can now be subdivided: */
-		if(numCachedNodes+8<=cacheSize)
+		if(canSubdivide&&numCachedNodes+8<=cacheSize)
 			{
 			Threads::Mutex::Lock coarseningHeapLock(coarseningHeapMutex);
 			
 			/* Mark the node as subdivided: */
 			node->children=children;
 			
+			/* Add the points selected by propagation into the new children to the subtree selection counts of the node and its ancestors: */
+			size_t numChildSelectedPoints=0;
+			for(int i=0;i<8;++i)
+				numChildSelectedPoints+=children[i].numSubtreeSelectedPoints;
+			if(numChildSelectedPoints!=0)
+				for(Node* ancestor=node;ancestor!=0;ancestor=ancestor->parent)
+					ancestor->numSubtreeSelectedPoints+=numChildSelectedPoints;
+			
 			/* Remove the node's parent from the list of coarsening candidates: */
 			if(node->parent!=0&&node->parent->coarseningHeapIndex!=~0x0U)
-				coarseningHeap->remove(node->parent);
+				removeCoarseningCandidate(node->parent);
 			
 			/* Check if the just refined node can be coarsened again: */
 			bool canCoarsen=true;
 			for(int i=0;i<8&&canCoarsen;++i)
-				canCoarsen=node->children[i].selectedPoints==0;
+				canCoarsen=node->children[i].numSelectedPoints==0;
 			if(canCoarsen)
 				{
 				/* Add the node to the list of coarsening candidates: */
-				coarseningHeap->insert(node);
+				insertCoarseningCandidate(node);
 				}
 			
-			/* Remove all new child nodes from the node cache: */
+			/* Remove all new child nodes from the node cache, and discard any dirty ranges from selection propagation: */
 			for(int i=0;i<8;++i)
+				{
 				children[i].pointsVersion=renderPass;
+				children[i].dirtyBaseVersion=renderPass;
+				children[i].dirtyBegin=children[i].dirtyEnd=0;
+				}
+			
+			/* Continue preloading the previous session's nodes: */
+			if(!preloadNodes.empty())
+				for(int i=0;i<8;++i)
+					preloadNode(&children[i]);
 			
 			/* Update the node cache: */
 			numCachedNodes+=8;
+			if(cacheManager!=0)
+				cacheManager->addCachedBytes(8*memNodeSize);
 			}
 		else
 			{
 			/* Alas, all the effort was for nought -- delete the nodes just loaded: */
-			delete[] children;
+			deleteChildren(children);
 			}
 		
 		/* Unlock the node: */
 		{
 		Threads::Mutex::Lock loadRequestLock(loadRequestMutex);
-		node->subdivisionQueueIndex=subdivisionRequestQueueLength;
+		node->subdivisionQueueIndex=SubdivisionRequestHeap<Node>::notQueued;
 		}
 		}
 	readyNodes.clear();
 	}
 	
+	/* Hand the view frusta of the previous rendering pass to the next shared traversal: */
+	lastPassFrusta.swap(passFrusta);
+	passFrusta.clear();
+	
 	/* Bump up the render pass counter: */
 	++renderPass;
 	
@@ -1395,6 +3339,8 @@ void LidarOctree::startRenderPass(void)
 
 void LidarOctree::glRenderAction(const LidarOctree::Frustum& frustum,PointBasedLightingShader& pbls,GLContextData& contextData) const
 	{
+	TraceEvents::Scope traceScope("Render","LidarOctree");
+	
 	/* Retrieve the context data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
 	
@@ -1420,7 +3366,57 @@ void LidarOctree::glRenderAction(const LidarOctree::Frustum& frustum,PointBasedL
 	dataItem->numCacheBypasses=0;
 	dataItem->numRenderedPoints=0;
 	dataItem->numBypassedPoints=0;
-	renderSubTree(&root,frustum,pbls,dataItem);
+	dataItem->numBatchedNodes=0;
+	dataItem->numOccludedNodes=0;
+	if(dataItem->uploadPass!=renderPass)
+		{
+		/* Start counting this render pass's uploads; all views rendered by the context in the same pass share its upload budget: */
+		dataItem->uploadPass=renderPass;
+		dataItem->numUploadedBytes=0;
+		}
+	dataItem->cullOccludedNodes=occlusionCulling&&dataItem->hasOcclusionQueryExtension;
+	if(!dataItem->cullOccludedNodes)
+		dataItem->nodeQueries.clear();
+	if(pointBudget!=0)
+		renderBudgeted(frustum,pbls,dataItem);
+	else if(sharedTraversal||incrementalTraversal)
+		renderShared(frustum,pbls,dataItem);
+	else
+		renderSubTree(&root,frustum,pbls,dataItem);
+	
+	if(prefetching&&(pointBudget!=0||!(sharedTraversal||incrementalTraversal)))
+		{
+		/* Request subdivisions for the predicted view after all current-view requests have been queued: */
+		prefetchSubTree(&root,frustum);
+		}
+	
+	if(dataItem->usePersistentBuffer)
+		{
+		/* Render all cached nodes in a single batch: */
+		if(dataItem->numBatchedNodes>0)
+			{
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB,dataItem->persistentBufferId);
+			if(root.haveCompactNormals)
+				glVertexPointer(static_cast<const CNVertex*>(0));
+			else if(root.haveNormals)
+				glVertexPointer(static_cast<const NVertex*>(0));
+			else
+				glVertexPointer(static_cast<const Vertex*>(0));
+			dataItem->glMultiDrawArraysProc(GL_POINTS,dataItem->batchFirsts,dataItem->batchCounts,dataItem->numBatchedNodes);
+			}
+		}
+	
+	if(dataItem->cullOccludedNodes)
+		{
+		/* Query the visibility of all traversed nodes against this pass's depth buffer: */
+		dataItem->queryOcclusion();
+		}
+	
+	if(dataItem->usePersistentBuffer)
+		{
+		/* Protect this pass's cache slots from being overwritten while the GPU still reads them: */
+		dataItem->fenceRenderPass(renderPass);
+		}
 	
 	/* Reset OpenGL state: */
 	#if 0
@@ -1434,8 +3430,16 @@ void LidarOctree::glRenderAction(const LidarOctree::Frustum& frustum,PointBasedL
 	else
 		GLVertexArrayParts::disable(Vertex::getPartsMask());
 	
-	/* Print performance counters: */
-	// std::cout<<dataItem->numRenderedNodes<<", "<<dataItem->numCacheMisses<<", "<<dataItem->numCacheBypasses<<", "<<dataItem->numRenderedPoints<<", "<<dataItem->numBypassedPoints<<std::endl;
+	/* Publish the performance counters: */
+	{
+	Threads::Mutex::Lock statisticsLock(statisticsMutex);
+	renderStatistics.numRenderedNodes=dataItem->numRenderedNodes;
+	renderStatistics.numCacheMisses=dataItem->numCacheMisses;
+	renderStatistics.numCacheBypasses=dataItem->numCacheBypasses;
+	renderStatistics.numRenderedPoints=dataItem->numRenderedPoints;
+	renderStatistics.numBypassedPoints=dataItem->numBypassedPoints;
+	renderStatistics.numOccludedNodes=dataItem->numOccludedNodes;
+	}
 	}
 
 void LidarOctree::intersectCone(LidarOctree::ConeIntersection& cone) const
@@ -1,6 +1,6 @@
 /***********************************************************************
 LidarOctree - Class to render multiresolution LiDAR point sets.
-Copyright (c) 2005-2025 Oliver Kreylos
+Copyright (c) 2005-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,14 +23,19 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef LIDAROCTREE_INCLUDED
 #define LIDAROCTREE_INCLUDED
 
+#include <string>
 #include <vector>
+#include <Misc/SizedTypes.h>
 #include <Misc/HashTable.h>
+#include <Threads/Atomic.h>
 #include <Threads/Mutex.h>
 #include <Threads/Cond.h>
 #include <Threads/Thread.h>
 #include <Math/Math.h>
 #include <Math/Constants.h>
+#include <Geometry/OrthogonalTransformation.h>
 #include <GL/gl.h>
+#include <GL/glext.h>
 #include <GL/GLColor.h>
 #include <GL/GLObject.h>
 #define GLGEOMETRY_NONSTANDARD_TEMPLATES
@@ -39,6 +44,13 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarTypes.h"
 #include "Cube.h"
 #include "LidarFile.h"
+#include "LidarSource.h"
+#include "LidarNodeSummary.h"
+#include "LidarQuantization.h"
+#include "LidarDataBlock.h"
+#include "NodeBlockPool.h"
+#include "PointArrayPool.h"
+#include "SelectionMoments.h"
 
 /* Flag whether to shift the center of the octree's domain to the coordinate system's origin: */
 #define RECENTER_OCTREE 1
@@ -52,7 +64,14 @@ template <class ScalarParam>
 class GLFrustum;
 template <class NodeParam>
 class CoarseningHeap;
+template <class NodeParam>
+class CoarseningClock;
+template <class NodeParam>
+class SubdivisionRequestHeap;
 class PointBasedLightingShader;
+class LidarMappedFile;
+class LidarCompressedFile;
+class LidarCacheManager;
 
 class LidarOctree:public GLObject
 	{
@@ -77,6 +96,7 @@ class LidarOctree:public GLObject
 	typedef std::vector<Interactor> InteractorList; // Type for lists of interactors
 	typedef Geometry::Ray<Scalar,3> Ray; // Type for rays for intersection tests
 	typedef GLFrustum<Scalar> Frustum; // Data type to represent view frusta
+	typedef Geometry::OrthogonalTransformation<Scalar,3> OGTransform; // Type for transformations with uniform scaling
 	typedef GLColor<GLubyte,4> Color; // Type for point colors
 	
 	struct ConeIntersection // Helper structure containing necessary state for cone intersection queries
@@ -121,63 +141,198 @@ class LidarOctree:public GLObject
 			}
 		};
 	
+	struct RenderStatistics // Structure reporting the work done by the most recent rendering pass in any OpenGL context
+		{
+		/* Elements: */
+		public:
+		unsigned int numRenderedNodes; // Number of rendered nodes
+		unsigned int numCacheMisses; // Number of rendered nodes that had to be uploaded into the graphics card cache
+		unsigned int numCacheBypasses; // Number of rendered nodes that bypassed the graphics card cache
+		unsigned int numRenderedPoints; // Number of rendered points
+		unsigned int numBypassedPoints; // Number of points rendered without using the graphics card cache
+		unsigned int numOccludedNodes; // Number of nodes culled as occluded
+		
+		/* Constructors and destructors: */
+		RenderStatistics(void)
+			:numRenderedNodes(0),numCacheMisses(0),numCacheBypasses(0),
+			 numRenderedPoints(0),numBypassedPoints(0),numOccludedNodes(0)
+			{
+			}
+		};
+	
+	struct LoaderStatistics // Structure reporting the state of the node loader threads and the memory cache
+		{
+		/* Elements: */
+		public:
+		unsigned int numQueuedRequests; // Number of currently pending subdivision requests
+		unsigned int numCachedNodes; // Number of nodes currently in the memory cache
+		unsigned int cacheSize; // Maximum number of nodes in the memory cache
+		unsigned int numLoadedSubdivisions; // Total number of subdivisions loaded since the octree was created
+		double loadTime; // Total time in seconds spent by node loader threads to load those subdivisions
+		Misc::UInt64 numBytesRead; // Total number of bytes read from the index and data files to load those subdivisions
+		
+		/* Constructors and destructors: */
+		LoaderStatistics(void)
+			:numQueuedRequests(0),numCachedNodes(0),cacheSize(0),
+			 numLoadedSubdivisions(0),loadTime(0.0),numBytesRead(0)
+			{
+			}
+		};
+	
+	struct PreloadStatistics // Structure reporting the outcome of preloading the octree's top levels
+		{
+		/* Elements: */
+		public:
+		unsigned int numPreloadedLevels; // Number of completely preloaded levels below the root
+		unsigned int numPreloadedNodes; // Number of preloaded nodes
+		std::string errorMessage; // Message of the exception that stopped preloading early, or empty
+		
+		/* Constructors and destructors: */
+		PreloadStatistics(void)
+			:numPreloadedLevels(0),numPreloadedNodes(0)
+			{
+			}
+		};
+	
 	private:
 	typedef GLGeometry::Vertex<void,0,GLubyte,4,void,float,3> Vertex; // Type for rendered points
 	typedef GLGeometry::Vertex<void,0,GLubyte,4,float,float,3> NVertex; // Type for rendered points with normal vectors
+	typedef GLGeometry::Vertex<void,0,GLubyte,4,GLshort,float,3> CNVertex; // Type for rendered points with unit-length normal vectors stored as normalized short integers
+	
+	enum RequestPriority // Enumerated type for priority classes of subdivision requests
+		{
+		PrefetchRequest, // Request for a predicted view or a previous session, ranking below all requests from the current render pass
+		ViewRequest, // Request from the current render pass
+		InteractionRequest // Request from an interaction tool, preempting view requests from the next render pass
+		};
 	
 	struct Node // Structure for Octree nodes
 		{
-		/* Elements: */
+		/* Elements read by rendering traversals, kept together at the front of the node: */
 		public:
-		Node* parent; // Pointer to parent of this node (0 for root)
-		LidarFile::Offset childrenOffset; // Offset of the node's children in the octree file (0 if node is leaf node)
 		Node* children; // Pointer to an array of eight child nodes (0 if node is not subdivided)
 		Cube domain; // This node's domain
+		Box bounds; // Tight bounding box of the points in this node's subtree if node summaries are available, or the node's domain
 		Scalar radius; // This node's radius
+		Scalar detailSize; // Detail size of this node, for proper LOD computation
 		unsigned int numPoints; // Number of LiDAR points belonging to this node
 		bool haveNormals; // Flag whether the node's points have normal vectors associated with them
-		LidarFile::Offset dataOffset; // Offset of node's data in the LiDAR data file(s)
-		Scalar detailSize; // Detail size of this node, for proper LOD computation
-		void* points; // Pointer to the LiDAR points belonging to this node
+		bool haveCompactNormals; // Flag whether the node's normal vectors are unit-length and stored in compact render points; implies haveNormals
 		unsigned int pointsVersion; // Version counter for points array to invalidate render cache on changes
-		Threads::Mutex selectionMutex; // Mutex protecting the node's selection state
-		bool* selectedPoints; // Array holding flags for selected points
-		Vertex::Color* selectedPointColors; // Array holding the original colors of selected points
-		
-		/* State touched during rendering traversals: */
-		mutable Threads::Mutex nodeMutex; // Mutex protecting node state touched during rendering traversal
-		mutable unsigned int renderPass; // Counter value of last rendering pass that entered this node
-		mutable Scalar maxLOD; // Maximum LOD value of node during current rendering pass
-		mutable unsigned int subdivisionQueueIndex; // Node's index in the node loader's request queue, == queue size if no request pending, == ~0x0U if locked by node loader
+		void* points; // Pointer to the LiDAR points belonging to this node
+		LidarFile::Offset childrenOffset; // Offset of the node's children in the octree file (0 if node is leaf node)
+		mutable Threads::Atomic<Misc::UInt64> traversalState; // Counter value of last rendering pass that entered this node in the upper 32 bits, bit pattern of node's maximum LOD value during that pass in the lower 32 bits
+		mutable unsigned int subdivisionQueueIndex; // Node's index in the node loader's request heap, == ~0x0U-1 if no request pending, == ~0x0U if locked by node loader
 		mutable unsigned int coarseningHeapIndex; // Node's index in the heap of coarsening candidates; == ~0x0U if not a coarsening candidate
+		unsigned int interactionPass; // Render pass in which an interactor last touched this node, pinning it against coarsening until the next render pass; == ~0x0U if never touched
+		Node* parent; // Pointer to parent of this node (0 for root)
+		unsigned int numSelectedPoints; // Number of selected points in this node
+		size_t numSubtreeSelectedPoints; // Number of selected points in this node and all its in-memory descendants
+		
+		/* Elements only touched by the node loader and by selection changes: */
+		LidarFile::Offset dataOffset; // Offset of node's data in the LiDAR data file(s)
+		unsigned int dirtyBaseVersion; // Version of the points array since which changes are tracked in the dirty range
+		unsigned int dirtyRenderPass; // Rendering pass in which tracking of the dirty range started
+		unsigned int dirtyBegin,dirtyEnd; // Half-open range of indices of points that changed since the dirty base version
+		Misc::UInt32* selectionMask; // Bit mask of selected points, one bit per point; 0 if no points are selected
+		Vertex::Color* selectedPointColors; // Original colors of selected points in order of point index; 0 if no points are selected
+		SelectionMoments* selectedPointMoments; // Moments of the positions of the selected points in this node; 0 if no points are selected
 		
 		/* Constructors and destructors: */
 		Node(void) // Creates a leaf node without points
-			:parent(0),children(0),
-			 points(0),pointsVersion(0),
-			 selectedPoints(0),selectedPointColors(0),
-			 renderPass(0U),
+			:children(0),
+			 pointsVersion(0),points(0),
+			 traversalState(0U),
 			 subdivisionQueueIndex(~0x0U-1),
-			 coarseningHeapIndex(~0x0U)
+			 coarseningHeapIndex(~0x0U),
+			 interactionPass(~0x0U),
+			 parent(0),
+			 numSelectedPoints(0),numSubtreeSelectedPoints(0),
+			 dirtyBaseVersion(0),dirtyRenderPass(0),dirtyBegin(0),dirtyEnd(0),
+			 selectionMask(0),selectedPointColors(0),selectedPointMoments(0)
 			{
 			}
-		~Node(void); // Destroys a node and its subtree
+		~Node(void); // Destroys a node's point array and selection state; children are returned to the octree's node block pool separately
 		
 		/* Methods: */
+		unsigned int getRenderPass(void) const // Returns the counter value of the last rendering pass that entered this node
+			{
+			return (unsigned int)(traversalState.get()>>32);
+			}
+		Scalar getMaxLOD(void) const // Returns the node's maximum LOD value during the last rendering pass that entered it
+			{
+			union
+				{
+				Misc::UInt32 i;
+				Scalar f;
+				} lod;
+			lod.i=Misc::UInt32(traversalState.get()&0xffffffffU);
+			return lod.f;
+			}
+		unsigned int getSelectionMaskSize(void) const // Returns the number of words in the node's selection mask
+			{
+			return (numPoints+31U)>>5;
+			}
+		bool isSelected(unsigned int pointIndex) const // Returns true if the given point is selected
+			{
+			return selectionMask!=0&&(selectionMask[pointIndex>>5]&(Misc::UInt32(1)<<(pointIndex&31U)))!=0U;
+			}
+		size_t getVertexSize(void) const // Returns the size of one of the node's render points in bytes
+			{
+			return haveCompactNormals?sizeof(CNVertex):(haveNormals?sizeof(NVertex):sizeof(Vertex));
+			}
+		void updateTraversalState(unsigned int renderPass,Scalar LOD) const; // Atomically raises the node's maximum LOD value for the given rendering pass
 		void intersectCone(ConeIntersection& cone) const; // Recursively intersects a cone with this node's subtree
 		};
 	
-	struct SubdivisionRequest // Structure to store subdivision request for nodes
+	struct LoaderFiles // Structure holding a set of octree file handles and staging buffers private to one node loader thread
 		{
 		/* Elements: */
 		public:
-		Node* node; // Node to be subdivided
-		Scalar LOD; // LOD value of the node in the most recent rendering pass
+		LidarSourceFile* indexFile; // The file containing the octree's structural data
+		LidarSourceFile* pointsFile; // The file containing the octree's point data
+		LidarSourceFile* normalsFile; // Pointer to the optional file containing normal vectors
+		LidarSourceFile* colorsFile; // Pointer to the optional file containing colors
+		LidarSourceFile* attributeFile; // Pointer to the attribute channel file whose values are stored in point colors' alpha components, opened on first use
+		LidarPoint* pointsBuffer; // Staging buffer for the points of one node
+		Vector* normalsBuffer; // Staging buffer for the normal vectors of one node, or 0
 		
 		/* Constructors and destructors: */
-		SubdivisionRequest(void)
-			:node(0),LOD(0.0f)
+		LoaderFiles(const LidarSource& source,bool haveNormals,bool haveColors,unsigned int maxNumPointsPerNode); // Opens a new set of file handles for the given LiDAR file and creates staging buffers for nodes of the given maximum size
+		~LoaderFiles(void);
+		};
+	
+	struct DataBlocks // Structure holding the records of all children of a node, read in one request per data file
+		{
+		/* Elements: */
+		public:
+		LidarDataBlock<LidarPoint> points; // Block of points if the points file contains unquantized points
+		LidarDataBlock<QuantizedLidarPoint> quantizedPoints; // Block of points if the points file contains quantized points
+		LidarDataBlock<Vector> normals; // Block of normal vectors if the normal vector file contains unencoded normal vectors
+		LidarDataBlock<QuantizedNormal> quantizedNormals; // Block of normal vectors if the normal vector file contains encoded normal vectors
+		LidarDataBlock<Color> colors; // Block of colors from the color file
+		};
+	
+	struct ResidentNode // Structure identifying a node whose children were in memory in a previous session
+		{
+		/* Elements: */
+		public:
+		LidarFile::Offset childrenOffset; // Offset of the node's children in the octree's index file
+		Scalar LOD; // The node's LOD value in the previous session's last rendering pass
+		
+		/* Constructors and destructors: */
+		ResidentNode(void)
+			{
+			}
+		ResidentNode(LidarFile::Offset sChildrenOffset,Scalar sLOD)
+			:childrenOffset(sChildrenOffset),LOD(sLOD)
+			{
+			}
+		
+		/* Methods: */
+		bool operator<(const ResidentNode& other) const // Orders nodes by children offset
 			{
+			return childrenOffset<other.childrenOffset;
 			}
 		};
 	
@@ -205,37 +360,91 @@ class LidarOctree:public GLObject
 			};
 		
 		typedef Misc::HashTable<const Node*,CacheSlot*> NodeHasher; // Hash table to map from nodes to the cache slots containing their points
+		typedef Misc::HashTable<const Node*,GLuint> QueryHasher; // Hash table to map from nodes to the occlusion queries of their bounding boxes
+		static const unsigned int numFrameFences=4; // Number of rendering passes for which the persistent cache keeps fences
 		
 		/* Elements: */
 		bool hasVertexBufferObjectExtension; // Flag if vertex buffer objects are supported
 		unsigned int cacheSize; // Number of node vertex arrays to keep in graphics card memory
 		CacheSlot* cacheSlots; // Array of cache slots
+		bool usePersistentBuffer; // Flag if all cache slots are fixed-size slices of one persistently mapped buffer, rendered with a single multi-draw call
+		unsigned int slotNumPoints; // Maximum number of points in a fixed-size cache slot
+		size_t slotSize; // Size of a fixed-size cache slot in bytes
+		GLuint persistentBufferId; // ID of the buffer object holding all fixed-size cache slots
+		GLubyte* persistentBuffer; // Pointer to the persistently mapped buffer
+		GLint* batchFirsts; // Indices of the first vertices of all cache slots to be rendered in the current batch
+		GLsizei* batchCounts; // Numbers of vertices of all cache slots to be rendered in the current batch
+		GLsizei numBatchedNodes; // Number of nodes in the current batch
+		GLsync frameFences[numFrameFences]; // Fences completing the rendering commands of recent rendering passes
+		unsigned int frameFencePasses[numFrameFences]; // Rendering passes whose commands are completed by the fences
+		PFNGLBUFFERSTORAGEPROC glBufferStorageProc;
+		PFNGLMAPBUFFERRANGEPROC glMapBufferRangeProc;
+		PFNGLUNMAPBUFFERPROC glUnmapBufferProc;
+		PFNGLFENCESYNCPROC glFenceSyncProc;
+		PFNGLCLIENTWAITSYNCPROC glClientWaitSyncProc;
+		PFNGLDELETESYNCPROC glDeleteSyncProc;
+		PFNGLMULTIDRAWARRAYSPROC glMultiDrawArraysProc;
 		NodeHasher cacheNodeMap; // Hash table of nodes whose points are currently held in graphics card memory
 		CacheSlot* lruHead; // Pointer to first (least recently used) cache slot in LRU list
 		CacheSlot* lruTail; // Pointer to last cache slot in LRU list
 		GLuint bypassVertexBufferObjectId; // ID of the vertex buffer object used to render nodes bypassing the cache
 		bool hasPointParametersExtension; // Flag if point parameters are supported
+		bool hasOcclusionQueryExtension; // Flag if occlusion queries and depth clamping are supported
+		PFNGLGENQUERIESARBPROC glGenQueriesARBProc;
+		PFNGLDELETEQUERIESARBPROC glDeleteQueriesARBProc;
+		PFNGLBEGINQUERYARBPROC glBeginQueryARBProc;
+		PFNGLENDQUERYARBPROC glEndQueryARBProc;
+		PFNGLGETQUERYOBJECTUIVARBPROC glGetQueryObjectuivARBProc;
+		bool cullOccludedNodes; // Flag whether the current render pass culls nodes that were occluded in the previous render pass
+		std::vector<GLuint> occlusionQueryIds; // Pool of occlusion query objects
+		QueryHasher nodeQueries; // Occlusion queries issued for node bounding boxes at the end of the previous render pass
+		std::vector<const Node*> queryNodes; // Nodes whose bounding boxes to query at the end of the current render pass
 		unsigned int numRenderedNodes; // Total number of nodes rendered in the last render pass
 		unsigned int numCacheMisses; // Total number of cache misses in the last render pass
 		unsigned int numCacheBypasses; // Total number of cache bypasses in the last render pass
 		unsigned int numRenderedPoints; // Total number of points rendered in the last render pass
 		unsigned int numBypassedPoints; // Total number of points rendered without using the cache
+		unsigned int numOccludedNodes; // Total number of nodes culled as occluded in the last render pass
+		unsigned int uploadPass; // Render pass for which uploaded bytes are counted
+		size_t numUploadedBytes; // Number of bytes uploaded into graphics card memory in that render pass
 		
 		/* Constructors and destructors: */
-		DataItem(unsigned int sCacheSize);
+		DataItem(unsigned int sCacheSize,bool sUsePersistentBuffer,unsigned int sSlotNumPoints,size_t vertexSize); // Creates a cache of the given number of slots; tries to use a persistently mapped buffer if flag is true
 		virtual ~DataItem(void);
+		
+		/* Methods: */
+		bool canRefine(const Node* node,size_t uploadBudget); // Returns true if the given node's children are in the cache, or if their points can still be uploaded within the given per-pass upload budget in bytes
+		void waitForRenderPass(unsigned int renderPass); // Blocks until all rendering commands of the given rendering pass have been completed
+		void fenceRenderPass(unsigned int renderPass); // Inserts a fence after all rendering commands issued so far in the given rendering pass
+		bool wasOccluded(const Node* node); // Returns true if the bounding box of the given node was found to be occluded at the end of the previous render pass; does not wait for query results
+		void queryOcclusion(void); // Queries the visibility of the bounding boxes of all nodes traversed in the current render pass against the current depth buffer
 		};
 	
+	static const unsigned int numSelectionMutexes=64; // Number of mutexes protecting the selection states of all nodes
+	
 	/* Elements: */
-	LidarFile indexFile; // The file containing the octree's structural data
-	LidarFile pointsFile; // The file containing the octree's point data
+	LidarSource source; // The local or remote LiDAR file
+	LidarSourceFile* indexFile; // The file containing the octree's structural data
+	LidarSourceFile* pointsFile; // The file containing the octree's point data
 	LidarFile::Offset pointsRecordSize; // Record size of points file
-	LidarFile* normalsFile; // Pointer to an optional file containing normal vectors for each point
+	LidarSourceFile* normalsFile; // Pointer to an optional file containing normal vectors for each point
 	LidarFile::Offset normalsRecordSize; // Record size of normals file
-	LidarFile* colorsFile; // Pointer to an optional file containing colors for each point
+	LidarSourceFile* colorsFile; // Pointer to an optional file containing colors for each point
 	LidarFile::Offset colorsRecordSize; // Record size of colors file
+	bool quantizedPoints; // Flag whether the points file contains points quantized relative to their nodes' domains
+	bool quantizedNormals; // Flag whether the normal vector file contains octahedrally encoded normal vectors
+	LidarCompressedFile* compressedPoints; // Block table of the points file if it is compressed, or 0
+	LidarMappedFile* pointsMap; // Optional memory mapping of the points file
+	LidarMappedFile* normalsMap; // Optional memory mapping of the normal vector file
+	LidarMappedFile* colorsMap; // Optional memory mapping of the color file
+	std::string colorAttributeName; // Name of the attribute channel whose values are stored in point colors' alpha components, or empty
+	unsigned int colorAttributeRecordSize; // Record size of the color attribute channel, or 0 if there is none
+	double colorAttributeMin,colorAttributeScale; // Mapping from color attribute values to alpha components
 	unsigned int maxNumPointsPerNode; // Maximum number of points per node
 	Vector pointOffset; // Offset from original LiDAR point positions to re-centered point positions
+	std::vector<LidarNodeSummary> summaries; // Summaries of all nodes' subtrees with re-centered bounds, indexed by node index, or empty if the LiDAR file has no summaries file
+	NodeBlockPool<Node> nodeBlockPool; // Pool of arrays of eight child nodes
+	PointArrayPool* pointArrayPool; // Pool of render point arrays of maximum node size
 	Node root; // The octree's root node (offset to center around the origin)
 	Scalar maxRenderLOD; // Maximum LOD value at which a node will be rendered
 	Point fncCenter; // Center point of focus region
@@ -243,30 +452,83 @@ class LidarOctree:public GLObject
 	Scalar fncWeight; // Weight for focus+context LOD adjustment
 	float baseSurfelSize; // Base splat size for leaf nodes
 	float surfelScale; // Scale factor applied to adjusted splat size
+	size_t memNodeSize; // Size of a cached node including its maximum-size point array in bytes
 	unsigned int cacheSize; // Maximum number of nodes to hold in memory at any time
-	unsigned int glCacheSize; // Maximum number of nodes to hold in graphics card memory at any time
+	LidarCacheManager* cacheManager; // Manager of a memory cache shared with other octrees, or null if the octree manages its own cache
+	const Node* protectedNode; // Node that must not be coarsened to make room for its own children, or null
+	unsigned int glCacheSize; // Maximum number of nodes to hold in graphics card memory at any time, or 0 to size each OpenGL context's cache from its free graphics card memory
+	double autoGlCacheFraction; // Fraction of free graphics card memory used by an automatically sized graphics card cache
+	bool persistentGlCache; // Flag whether to hold the graphics card cache in one persistently mapped buffer if supported
+	bool occlusionCulling; // Flag whether to cull nodes that were occluded in the previous render pass if supported
+	size_t pointBudget; // Maximum number of points to render in each render pass, or 0 to render all nodes that meet the LOD threshold
+	size_t glUploadBudget; // Number of bytes each OpenGL context uploads into graphics card memory per render pass before it renders nodes instead of their uncached children, or 0 for no limit
+	bool prefetching; // Flag whether to request subdivisions for the predicted view after each render pass
+	OGTransform prefetchTransform; // Transformation from current to predicted octree coordinates, relative to the current view
+	bool sharedTraversal; // Flag whether to traverse the octree once per render pass for all eyes and windows
+	mutable Threads::Mutex sharedTraversalMutex; // Mutex serializing the shared traversal and the recording of view frusta
+	bool incrementalTraversal; // Flag whether to update the previous render pass's render cut instead of traversing the octree from the root
+	mutable unsigned int sharedTraversalPass; // Render pass for which the shared render cut was built
+	mutable bool sharedCutValid; // Flag whether the shared render cut only contains nodes that still exist
+	std::vector<Frustum> lastPassFrusta; // View frusta of all eyes and windows rendered in the previous render pass
+	mutable std::vector<Frustum> passFrusta; // View frusta of all eyes and windows rendered so far in the current render pass
+	mutable std::vector<const Node*> sharedCut; // Render cut of the shared traversal in depth-first order, including nodes outside all frusta at the level where they were culled
 	unsigned int numCachedNodes; // Number of nodes currently in the memory cache
+	std::vector<ResidentNode> preloadNodes; // Nodes from a previous session that are still to be subdivided when they are loaded, sorted by children offset
 	unsigned int renderPass; // Render pass counter
 	
 	/* Elements for communication with the node loading thread: */
 	Threads::Mutex treeUpdateFunctionMutex; // Mutex protecting the tree update function's state
 	TreeUpdateFunction treeUpdateFunction; // Callback function called whenever the tree is updated asynchronously
 	void* treeUpdateFunctionArg; // Arbitrary argument for tree update function
-	Threads::Thread nodeLoaderThread; // Handle for the node loading thread
+	unsigned int numNodeLoaderThreads; // Number of node loader threads
+	std::vector<LoaderFiles*> nodeLoaderFiles; // Private sets of file handles and staging buffers of the node loader threads, opened before the threads start
+	Threads::Thread* nodeLoaderThreads; // Array of handles for the node loading threads
 	mutable Threads::Mutex loadRequestMutex; // Mutex protecting the tile loader thread state
 	mutable Threads::Cond loadRequestCond; // Condition variable to signal a new tile loading request
-	mutable unsigned int subdivisionRequestQueueLength; // Maximum number of pending subdivision requests
-	mutable SubdivisionRequest* subdivisionRequestQueue; // Queue of subdivision requests to the node loader thread
+	mutable SubdivisionRequestHeap<Node>* subdivisionRequestQueue; // Priority queue of subdivision requests to the node loader threads
 	Threads::Mutex readyNodesMutex; // Mutex protecting the list of ready nodes
 	std::vector<Node*> readyNodes; // List of ready child nodes
+	Threads::Mutex selectionMutexes[numSelectionMutexes]; // Mutexes protecting the selection states of nodes, shared between nodes by address
 	mutable Threads::Mutex coarseningHeapMutex; // Mutex protecting the coarsening heap during rendering
-	mutable CoarseningHeap<Node>* coarseningHeap; // Heap of nodes that are candidates for coarsening
+	mutable CoarseningHeap<Node>* coarseningHeap; // Heap of nodes that are candidates for coarsening, or null if the CLOCK policy is used
+	mutable CoarseningClock<Node>* coarseningClock; // Clock of nodes that are candidates for coarsening if the CLOCK policy is used, or null
+	mutable Threads::Mutex statisticsMutex; // Mutex protecting the render and loader statistics
+	mutable RenderStatistics renderStatistics; // Work done by the most recent rendering pass
+	LoaderStatistics loaderStatistics; // Cumulative node loader statistics
 	
 	/* Private methods: */
+	void loadSummaries(void); // Loads the node summaries file if it exists and matches the octree file
+	void setNodeBounds(Node* node,size_t nodeIndex) const; // Sets the bounding box of the given node of the given index from its summary, or from its domain
+	Threads::Mutex& getSelectionMutex(const Node* node) // Returns the mutex protecting the given node's selection state
+		{
+		return selectionMutexes[(size_t(node)/sizeof(Node))%numSelectionMutexes];
+		}
+	void deleteChildren(Node* children); // Returns the given array of eight child nodes and all their descendants, and their point arrays, to the node block and point array pools
+	static bool intersectsFrustum(const Node* node,const Frustum& frustum); // Returns true if the given node's bounding box intersects the given frustum
+	bool isNodeVisible(const Node* node,const Frustum& frustum,DataItem* dataItem) const; // Returns true if the given node intersects the view frustum and was not occluded in the previous render pass
+	Scalar calcProjectedDetailSize(const Node* node,const Frustum& frustum) const; // Returns the given node's projected detail size, adjusted by the focus+context rule
 	void renderSubTree(const Node* node,const Frustum& frustum,PointBasedLightingShader& pbls,DataItem* dataItem) const;
+	void renderBudgeted(const Frustum& frustum,PointBasedLightingShader& pbls,DataItem* dataItem) const; // Renders the octree by expanding nodes in order of projected detail size until the point budget is exhausted
+	bool evaluateNode(const Node* node,const std::vector<Frustum>& frusta,Scalar& projectedDetailSize) const; // Returns true if the given node intersects any of the given frusta, and its largest projected detail size in those frusta
+	void traverseShared(const Node* node,const std::vector<Frustum>& frusta,std::vector<const Node*>& cut) const; // Appends the render cut of the given subtree for the union of the given frusta to the given cut
+	void collapseCutTail(const std::vector<Frustum>& frusta,std::vector<const Node*>& cut) const; // Replaces complete sets of siblings at the end of the given cut by their parents while the parents no longer need to be refined
+	void updateSharedCut(const std::vector<Frustum>& frusta) const; // Refines and coarsens the shared render cut of the previous render pass for the given frusta
+	void renderShared(const Frustum& frustum,PointBasedLightingShader& pbls,DataItem* dataItem) const; // Renders the nodes of the shared render cut that are visible in the given frustum, building the cut first if this is the render pass's first view
+	void renderNode(const Node* node,PointBasedLightingShader& pbls,DataItem* dataItem) const; // Renders the given node's points from the graphics card cache or main memory
+	void prefetchSubTree(const Node* node,const Frustum& frustum) const; // Requests subdivisions of nodes in the given subtree that will be too coarse in the predicted view
 	void interactWithSubTree(Node* node,const Interactor& interactor); // Prepares a subtree for interaction with an interactor
+	void requestSubdivision(const Node* node,Scalar LOD,RequestPriority priority =ViewRequest) const; // Queues a subdivision request for the given node with the given LOD value at the given priority
+	bool withdrawSubdivisionRequests(const Node* children) const; // Withdraws pending subdivision requests for the given array of eight sibling nodes; returns false if any of them is locked by a node loader thread
+	void collectResidentNodes(const Node* node,std::vector<ResidentNode>& residentNodes) const; // Appends all nodes in the given subtree whose children are in memory to the given list
+	void preloadNode(const Node* node); // Requests subdivision of the given node at prefetch priority if it was subdivided in a previous session
+	void insertCoarseningCandidate(Node* node); // Adds the given node to the coarsening candidates of the current policy; coarsening heap mutex must be locked
+	void removeCoarseningCandidate(Node* node); // Removes the given node from the coarsening candidates of the current policy; coarsening heap mutex must be locked
+	Node* getTopCoarseningCandidate(void) const; // Returns the next node to be coarsened under the current policy, or null; coarsening heap mutex must be locked
+	void collectCoarseningCandidates(Node* node,std::vector<Node*>& candidates); // Appends all coarsening candidates in the given subtree to the given list
+	void coarsen(Node* node); // Deletes the children of the given coarsening candidate; coarsening heap mutex must be locked
+	void invalidatePoints(Node* node,unsigned int begin,unsigned int end); // Invalidates the given half-open range of points in the given node's points array
 	template <class VertexParam>
-	bool selectPoint(Node* node,unsigned int pointIndex); // Selects the given point in the given node; returns true if selection changed
+	bool updateSelection(Node* node,const Misc::UInt32* newSelectionMask); // Replaces the given node's selection with the given mask, highlighting newly selected and restoring deselected points; returns true if selection changed
 	template <class VertexParam>
 	void selectPointsInNode(Node* node,const Interactor& interactor); // Selects points in the given node
 	void selectPoints(Node* node,const Interactor& interactor); // Selects points in the given subtree
@@ -274,28 +536,45 @@ class LidarOctree:public GLObject
 	void deselectPointsInNode(Node* node,const Interactor& interactor); // Deselects points in the given node
 	bool deselectPoints(Node* node,const Interactor& interactor); // Deselects points in the given subtree; returns true if node is removable (i.e., has no children or selected points)
 	bool clearSelection(Node* node); // Clears selected points in the given subtree; returns true if node is removable (i.e., has no children or selected points)
+	void accumulateSelectionMoments(const Node* node,SelectionMoments& moments) const; // Adds the moments of the selected points in leaf nodes of the given subtree to the given moments
 	template <class VertexParam,class PointProcessorParam>
 	void processPointsInBox(const Box& box,const Node* node,PointProcessorParam& dpp) const; // Processes points inside the given box in the given subtree
 	template <class VertexParam,class DirectedPointProcessorParam>
 	void processPointsDirected(const Node* node,DirectedPointProcessorParam& dpp) const; // Processes points in the given subtree in order of increasing distance from the processor's query point
 	template <class VertexParam,class PointProcessorParam>
 	void processSelectedPoints(const Node* node,PointProcessorParam& pp) const; // Processes selected points in the given subtree
-	template <class PointNormalProcessorParam>
+	static const NVertex::Normal& getVertexNormal(const NVertex& vertex) // Returns the normal vector of the given render point
+		{
+		return vertex.normal;
+		}
+	static Vector getVertexNormal(const CNVertex& vertex) // Returns the normal vector of the given compact render point
+		{
+		return Vector(Scalar(vertex.normal[0])/Scalar(32767),Scalar(vertex.normal[1])/Scalar(32767),Scalar(vertex.normal[2])/Scalar(32767));
+		}
+	template <class VertexParam,class PointNormalProcessorParam>
 	void processSelectedPointsWithNormals(const Node* node,PointNormalProcessorParam& pp) const; // Processes selected points in the given subtree
 	template <class PointNormalProcessorParam>
 	void processSelectedPointsWithNullNormals(const Node* node,PointNormalProcessorParam& pp) const; // Processes selected points in the given subtree
 	template <class VertexParam,class ColoringPointProcessorParam>
 	void colorSelectedPoints(Node* node,ColoringPointProcessorParam& cpp); // Colors selected points in the given subtree
-	void loadNodePoints(Node* node); // Loads the point array of the given node
+	Cube getSourceDomain(const Node* node) const; // Returns the given node's domain in the coordinate system of the data files
+	void readChildren(Node* node,Node* children,LidarSourceFile& nodeIndexFile) const; // Initializes the given node's eight children from their records at the given index file's current position
+	void readDataBlocks(const LidarDataRange& range,LidarSourceFile& blockPointsFile,LidarSourceFile* blockNormalsFile,LidarSourceFile* blockColorsFile,DataBlocks& blocks) const; // Reads the given range of records from the given set of data files into the given blocks with one request per data file
+	bool readChildBlocks(const Node* children,LoaderFiles& files,DataBlocks& blocks) const; // Reads the records of the given eight sibling nodes into the given blocks with one request per data file; returns false if the records are not stored contiguously or can not be read in blocks
+	void readNodePoints(const Node* node,LidarSourceFile& nodePointsFile,LidarPoint* points,const DataBlocks* blocks) const; // Reads the given node's points from the given points file or the given blocks, decoding quantized points
+	void readNodeNormals(const Node* node,LidarSourceFile& nodeNormalsFile,Vector* normals,const DataBlocks* blocks) const; // Reads the given node's normal vectors from the given normal vector file or the given blocks, decoding encoded normal vectors
+	void readNodeColors(const Node* node,LidarSourceFile& nodeColorsFile,LidarPoint* points,const DataBlocks* blocks) const; // Reads the given node's colors from the given color file or the given blocks into the given points
+	void loadNodePoints(Node* node,LidarSourceFile& nodePointsFile,LidarSourceFile* nodeNormalsFile,LidarSourceFile* nodeColorsFile,LidarPoint* pointsBuffer,Vector* normalsBuffer,const DataBlocks* blocks =0); // Loads the point array of the given node from the given set of data files, or from the given blocks read together with the node's siblings, using the given staging buffers of maximum node size
+	void loadNodeAttribute(Node* node,LidarSourceFile& nodeAttributeFile) const; // Reads the given node's color attribute values from the given attribute channel file into the alpha components of its loaded point array
 	template <class VertexParam>
-	void selectCloseNeighbors(Node* node,unsigned int left,unsigned int right,int splitDimension,const VertexParam& point,Scalar maxDist);
+	void selectCloseNeighbors(const Node* node,unsigned int left,unsigned int right,int splitDimension,const VertexParam& point,Scalar maxDist,Misc::UInt32* selectionMask) const; // Sets the bits of the given node's points close to the given point in the given selection mask
 	template <class VertexParam>
 	void propagateSelectedPoints(Node* node,Node* children); // Propagates selected points from the given node into its just loaded child nodes
-	void* nodeLoaderThreadMethod(void); // Thread method to subdivide octree nodes without interrupting rendering
+	void* nodeLoaderThreadMethod(unsigned int threadIndex); // Thread method to subdivide octree nodes without interrupting rendering, using the given thread's set of file handles
 	
 	/* Constructors and destructors: */
 	public:
-	LidarOctree(const char* lidarFileName,size_t sCacheSize,size_t sGlCacheSize); // Creates octree from the given LiDAR file; cache sizes are in bytes
+	LidarOctree(const char* sLidarFileName,size_t sCacheSize,size_t sGlCacheSize,bool mapDataFiles =false,unsigned int sNumNodeLoaderThreads =1); // Creates octree from the given LiDAR file; cache sizes are in bytes, or zero to size caches automatically from available system and graphics card memory; reads point data from memory-mapped files if flag is true and the files' records can be used in place; subdivides nodes using the given number of background threads
 	virtual ~LidarOctree(void);
 	
 	/* Methods: */
@@ -306,6 +585,10 @@ class LidarOctree:public GLObject
 		}
 	Point getDomainCenter(void) const; // Returns the center of the octree's domain
 	Scalar getDomainRadius(void) const; // Returns the radius of the octree's domain
+	const LidarSource& getSource(void) const // Returns the local or remote LiDAR file from which the octree is loaded
+		{
+		return source;
+		}
 	const Vector& getPointOffset(void) const // Returns an offset vector to transform LiDAR octree coordinates to source point coordinates
 		{
 		return pointOffset;
@@ -314,6 +597,29 @@ class LidarOctree:public GLObject
 	void setRenderQuality(Scalar qualityLevel); // Sets the quality level for rendering, 0 is normal quality
 	void setFocusAndContext(const Point& newFncCenter,Scalar newFncRadius,Scalar newFncWeight); // Adjusts focus+context LOD adjustment parameters
 	void setBaseSurfelSize(float newBaseSurfelSize,float newSurfelScale); // Sets the splat size for leaf nodes
+	void setPersistentGlCache(bool newPersistentGlCache); // Selects the persistently mapped graphics card cache for OpenGL contexts initialized afterwards
+	void setAutoGlCacheFraction(double newAutoGlCacheFraction); // Sets the fraction of free graphics card memory used by automatically sized graphics card caches of OpenGL contexts initialized afterwards
+	void setOcclusionCulling(bool newOcclusionCulling); // Enables or disables culling of nodes that were occluded in the previous render pass
+	void setPointBudget(size_t newPointBudget); // Sets the maximum number of points to render in each render pass; 0 disables the budget
+	void setGlUploadBudget(size_t newGlUploadBudget); // Sets the number of bytes each OpenGL context uploads per render pass before it renders nodes instead of their uncached children; 0 disables the budget
+	void setPrefetchTransform(const OGTransform& newPrefetchTransform); // Prefetches nodes for the view predicted by moving the octree by the given transformation relative to the current view
+	void disablePrefetching(void); // Stops prefetching nodes for a predicted view
+	void setSharedTraversal(bool newSharedTraversal); // Enables or disables traversing the octree once per render pass for all eyes and windows; ignored while a point budget is set
+	void setIncrementalTraversal(bool newIncrementalTraversal); // Enables or disables updating the previous render pass's render cut instead of traversing the octree from the root; ignored while a point budget is set
+	void setColorAttribute(const char* newColorAttributeName,double attributeMin,double attributeMax); // Stores the values of the given attribute channel, mapped from the given range to [0, 255], in the alpha components of point colors for shader-side color mapping; must be called before the first rendering pass; throws exception if the channel does not exist or has an unsupported record size
+	const std::string& getColorAttribute(void) const // Returns the name of the attribute channel stored in point colors' alpha components, or an empty string
+		{
+		return colorAttributeName;
+		}
+	void setClockCoarsening(bool newClockCoarsening); // Selects coarsening candidates with the CLOCK algorithm and coarsens them in batches at the start of each render pass, or from a heap ordered by render pass and LOD, one candidate per loaded subdivision
+	void setCacheManager(LidarCacheManager* newCacheManager); // Shares the given manager's memory cache with other octrees; cache manager must outlive the octree
+	bool getCoarseningCandidate(unsigned int& age,Scalar& lod) const; // Returns the age in render passes and the LOD of the octree's best coarsening candidate; returns false if there is none
+	bool coarsenCandidate(void); // Coarsens the octree's best coarsening candidate; returns false if its children are being loaded
+	RenderStatistics getRenderStatistics(void) const; // Returns the work done by the most recent rendering pass
+	LoaderStatistics getLoaderStatistics(void) const; // Returns the current node loader and memory cache state and cumulative loader statistics
+	void saveResidentNodes(IO::File& file) const; // Writes the set of nodes whose children are in memory, keyed to the octree's LiDAR file, to the given file
+	PreloadStatistics preloadTopLevels(unsigned int numLevels); // Loads the given number of levels below the root in one sequential pass over the index and data files, using at most half of the memory cache, and returns the number of loaded levels and nodes and the error that stopped preloading early, if any; must be called before the first rendering pass
+	bool preloadResidentNodes(IO::File& file); // Reads a set of nodes written by saveResidentNodes from the given file and loads them in the background at prefetch priority; returns false if the set belongs to a different LiDAR file
 	void startRenderPass(void); // Starts the next rendering pass of the point octree
 	void glRenderAction(const Frustum& frustum,PointBasedLightingShader& pbls,GLContextData& contextData) const;
 	void intersectCone(ConeIntersection& cone) const; // Intersects a cone with all points in the current octree
@@ -321,11 +627,23 @@ class LidarOctree:public GLObject
 	void selectPoints(const Interactor& interactor); // Selects all points inside the interactor's region of influence
 	void deselectPoints(const Interactor& interactor); // Deselects all points inside the interactor's region of influence
 	void clearSelection(void); // Clears the set of selected points
+	size_t getNumSelectedPoints(void) const // Returns the number of selected points in all in-memory nodes, including subsampled interior nodes
+		{
+		return root.numSubtreeSelectedPoints;
+		}
+	SelectionMoments getSelectionMoments(void) const // Returns the moments of the set of selected points in leaf nodes, i.e., of the points processed by processSelectedPoints
+		{
+		SelectionMoments result;
+		accumulateSelectionMoments(&root,result);
+		return result;
+		}
 	template <class PointProcessorParam>
 	void processPointsInBox(const Box& box,PointProcessorParam& dpp) const // Processes points in leaf nodes that are inside the given box
 		{
 		/* Process nodes from the root: */
-		if(root.haveNormals)
+		if(root.haveCompactNormals)
+			processPointsInBox<CNVertex,PointProcessorParam>(box,&root,dpp);
+		else if(root.haveNormals)
 			processPointsInBox<NVertex,PointProcessorParam>(box,&root,dpp);
 		else
 			processPointsInBox<Vertex,PointProcessorParam>(box,&root,dpp);
@@ -334,7 +652,9 @@ class LidarOctree:public GLObject
 	void processPointsDirected(DirectedPointProcessorParam& dpp) const // Processes points in leaf nodes in order of approximately increasing distance from the processor's query point
 		{
 		/* Process nodes from the root: */
-		if(root.haveNormals)
+		if(root.haveCompactNormals)
+			processPointsDirected<CNVertex,DirectedPointProcessorParam>(&root,dpp);
+		else if(root.haveNormals)
 			processPointsDirected<NVertex,DirectedPointProcessorParam>(&root,dpp);
 		else
 			processPointsDirected<Vertex,DirectedPointProcessorParam>(&root,dpp);
@@ -343,7 +663,9 @@ class LidarOctree:public GLObject
 	void processSelectedPoints(PointProcessorParam& pp) const // Processes the set of selected points in leaf nodes with the given point processor
 		{
 		/* Process nodes from the root: */
-		if(root.haveNormals)
+		if(root.haveCompactNormals)
+			processSelectedPoints<CNVertex,PointProcessorParam>(&root,pp);
+		else if(root.haveNormals)
 			processSelectedPoints<NVertex,PointProcessorParam>(&root,pp);
 		else
 			processSelectedPoints<Vertex,PointProcessorParam>(&root,pp);
@@ -352,8 +674,10 @@ class LidarOctree:public GLObject
 	void processSelectedPointsWithNormals(PointNormalProcessorParam& pp) const // Processes the set of selected points in leaf nodes with the given point processor
 		{
 		/* Process nodes from the root: */
-		if(root.haveNormals)
-			processSelectedPointsWithNormals<PointNormalProcessorParam>(&root,pp);
+		if(root.haveCompactNormals)
+			processSelectedPointsWithNormals<CNVertex,PointNormalProcessorParam>(&root,pp);
+		else if(root.haveNormals)
+			processSelectedPointsWithNormals<NVertex,PointNormalProcessorParam>(&root,pp);
 		else
 			processSelectedPointsWithNullNormals<PointNormalProcessorParam>(&root,pp);
 		}
@@ -361,7 +685,9 @@ class LidarOctree:public GLObject
 	void colorSelectedPoints(ColoringPointProcessorParam& cpp) // Ditto, but allows point processor to change the selection color of selected points
 		{
 		/* Process nodes from the root: */
-		if(root.haveNormals)
+		if(root.haveCompactNormals)
+			colorSelectedPoints<CNVertex,ColoringPointProcessorParam>(&root,cpp);
+		else if(root.haveNormals)
 			colorSelectedPoints<NVertex,ColoringPointProcessorParam>(&root,cpp);
 		else
 			colorSelectedPoints<Vertex,ColoringPointProcessorParam>(&root,cpp);
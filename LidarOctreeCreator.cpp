@@ -30,10 +30,11 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <dirent.h>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <iostream>
-#include <iomanip>
 #include <Misc/StdError.h>
 #include <Misc/PriorityHeap.h>
+#include <Misc/Timer.h>
 #include <Threads/Thread.h>
 #include <Math/Math.h>
 #include <Math/Constants.h>
@@ -41,6 +42,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include "TempOctree.h"
 #include "SplitPoints.h"
+#include "LidarCompressedFile.h"
+#include "TraceEvents.h"
 
 #include "LidarOctreeCreator.h"
 
@@ -162,75 +165,305 @@ struct NeighborPair
 		};
 	};
 
+/***************************************************************
+Helper structure and functions to subsample point sets on grids:
+***************************************************************/
+
+struct GridCellPoint // Structure associating a point with the grid cell containing it
+	{
+	/* Elements: */
+	public:
+	unsigned long long cell; // Linear index of the grid cell containing the point
+	Scalar dist2; // Squared distance from the point to the center of its grid cell
+	unsigned int point; // Index of the point
+	
+	/* Methods: */
+	static bool less(const GridCellPoint& p1,const GridCellPoint& p2) // Orders points by grid cell, and by distance to the cell center inside each cell
+		{
+		return p1.cell<p2.cell||(p1.cell==p2.cell&&p1.dist2<p2.dist2);
+		};
+	};
+
+inline unsigned long long getGridCell(const LidarPoint& p,const Point& origin,Scalar cellSize,unsigned int gridSize,Scalar* cellCenterDist2 =0) // Returns the linear index of the grid cell containing the given point, and optionally the point's squared distance to the cell center
+	{
+	unsigned long long result=0;
+	Scalar dist2=Scalar(0);
+	for(int i=0;i<3;++i)
+		{
+		Scalar cellPos=(p[i]-origin[i])/cellSize;
+		int c=int(Math::floor(cellPos));
+		if(c<0)
+			c=0;
+		if(c>=int(gridSize))
+			c=int(gridSize)-1;
+		result=result*gridSize+(unsigned long long)(c);
+		Scalar d=(cellPos-(Scalar(c)+Scalar(0.5)))*cellSize;
+		dist2+=d*d;
+		}
+	if(cellCenterDist2!=0)
+		*cellCenterDist2=dist2;
+	return result;
+	}
+
+unsigned int countGridCells(const LidarPoint* points,unsigned int numPoints,const Point& origin,Scalar cellSize,unsigned int gridSize,std::vector<unsigned long long>& cells) // Returns the number of grid cells occupied by the given points
+	{
+	for(unsigned int i=0;i<numPoints;++i)
+		cells[i]=getGridCell(points[i],origin,cellSize,gridSize);
+	std::sort(cells.begin(),cells.begin()+numPoints);
+	return (unsigned int)(std::unique(cells.begin(),cells.begin()+numPoints)-cells.begin());
+	}
+
+}
+
+namespace {
+
+/*************************************************
+Helper function to create LiDAR file directories:
+*************************************************/
+
+void createLidarFileDirectory(const char* lidarFileName)
+	{
+	/*********************************************************************
+	Try creating the new LiDAR file base directory (oh, this can fail in
+	so many ways...):
+	*********************************************************************/
+	
+	/* Check if a file or directory of the given name already exists: */
+	struct stat statBuffer;
+	if(stat(lidarFileName,&statBuffer)==0)
+		{
+		/* Check if it's a directory: */
+		if(S_ISDIR(statBuffer.st_mode))
+			{
+			/* Create a list of all files or subdirectories in the directory: */
+			std::vector<std::string> files;
+			DIR* dir=opendir(lidarFileName);
+			if(dir!=0)
+				{
+				struct dirent* entry;
+				while((entry=readdir(dir))!=0)
+					if(strcmp(entry->d_name,".")!=0&&strcmp(entry->d_name,"..")!=0)
+						{
+						std::string file=lidarFileName;
+						file.push_back('/');
+						file.append(entry->d_name);
+						files.push_back(file);
+						}
+				closedir(dir);
+				
+				/* Try deleting all files: */
+				for(std::vector<std::string>::const_iterator fIt=files.begin();fIt!=files.end();++fIt)
+					{
+					if(unlink(fIt->c_str())<0)
+						throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Directory %s already exists, and file %s cannot be deleted",lidarFileName,fIt->c_str());
+					}
+				}
+			else
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Directory %s already exists but could not be opened",lidarFileName);
+			}
+		else
+			{
+			if(unlink(lidarFileName)==0)
+				{
+				if(mkdir(lidarFileName,0777)<0)
+					throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Could not create LiDAR file %s",lidarFileName);
+				}
+			else
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"File %s already exists and could not be removed",lidarFileName);
+			}
+		}
+	else
+		{
+		if(mkdir(lidarFileName,0777)<0)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Could not create LiDAR file %s",lidarFileName);
+		}
+	}
+
 }
 
 /***********************************
 Methods of class PointOctreeCreator:
 ***********************************/
 
-void LidarOctreeCreator::writeNodePoints(LidarOctreeCreator::Node& node)
+void LidarOctreeCreator::writeNodePoints(LidarOctreeCreator::Node* nodes,int numNodes)
 	{
-	/* Get the temporary point file responsible for the node's level: */
-	TempPointFile* tpf=0;
+	/* Sort the nodes' points into kd-tree order in-place: */
+	LidarPoint* nodePoints[8];
+	for(int i=0;i<numNodes;++i)
+		{
+		Geometry::ArrayKdTree<LidarPoint> pointTree;
+		pointTree.donatePoints(nodes[i].numPoints,nodes[i].points);
+		nodePoints[i]=pointTree.detachPoints();
+		}
+	
+	/* Append the nodes' points to the point data file, without interruption so that sibling nodes can be read in a single request: */
 	{
-	Threads::Mutex::Lock tempPointFilesLock(tempPointFilesMutex);
+	Threads::Mutex::Lock pointsFileLock(pointsFileMutex);
 	
-	/* Check if the current level is bigger than the previous maximum level in the tree: */
-	if(maxLevel<node.level)
+	for(int i=0;i<numNodes;++i)
 		{
-		/* Add new temporary point file structures to the vector: */
-		for(unsigned int i=maxLevel+1;i<=node.level;++i)
-			tempPointFiles.push_back(new TempPointFile);
+		Node& node=nodes[i];
 		
 		/* Remember the maximum tree level: */
-		maxLevel=node.level;
+		if(maxLevel<node.level)
+			maxLevel=node.level;
+		
+		/* Assign the node's data offset and write its points: */
+		node.octreeDataOffset=nextDataOffset;
+		nextDataOffset+=LidarFile::Offset(node.numPoints);
+		if(compressedPoints!=0)
+			{
+			compressedPoints->beginBlock(node.octreeDataOffset);
+			compressedPoints->write(nodePoints[i],node.numPoints);
+			compressedPoints->endBlock();
+			}
+		else
+			pointsFile->write(nodePoints[i],node.numPoints);
 		}
+	}
 	
-	/* Check if the temporary point file for this level needs to be created: */
-	tpf=tempPointFiles[node.level];
-	if(tpf->file==0)
+	/* Delete the nodes' points: */
+	for(int i=0;i<numNodes;++i)
 		{
-		/* Create a temporary point file name: */
-		char fnt[1024];
-		strcpy(fnt,tempPointFileNameTemplate.c_str());
-		int pointFileFd=mkstemp(fnt);
-		if(pointFileFd<0)
-			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot open temporary point file %s",fnt);
-		
-		/* Create the temporary point file: */
-		tpf->file=new TempFile(pointFileFd,TempFile::ReadWrite);
-		tpf->fileName=fnt;
+		Node& node=nodes[i];
+		if(node.pointsPrivate)
+			{
+			node.pointsPrivate=false;
+			delete[] nodePoints[i];
+			}
+		node.points=0;
+		}
+	}
+
+unsigned int LidarOctreeCreator::subsamplePointsOnGrid(LidarPoint* points,unsigned int numPoints,unsigned int maxNumPoints,Scalar& detailSize)
+	{
+	/* Keep all points if there are few enough: */
+	if(numPoints<=maxNumPoints)
+		return numPoints;
+	
+	/* Calculate the points' bounding box: */
+	Box pointBox=Box::empty;
+	for(unsigned int i=0;i<numPoints;++i)
+		pointBox.addPoint(points[i]);
+	
+	/* Calculate the size of the cube containing all points: */
+	Scalar size=Scalar(0);
+	for(int i=0;i<3;++i)
+		if(size<pointBox.max[i]-pointBox.min[i])
+			size=pointBox.max[i]-pointBox.min[i];
+	if(size==Scalar(0))
+		size=Scalar(1);
+	
+	/* Find a grid resolution close to the finest one whose number of occupied cells does not exceed the maximum node size: */
+	std::vector<unsigned long long> cells(numPoints);
+	unsigned int gridSizeLow=1; // A single cell always fits
+	unsigned int gridSizeHigh=maxNumPoints<(1U<<20)?maxNumPoints+1:(1U<<20); // First grid size known or assumed to have too many occupied cells
+	unsigned int gridSize=(unsigned int)(Math::floor(Math::sqrt(double(maxNumPoints))));
+	for(int iteration=0;gridSizeHigh-gridSizeLow>1&&gridSizeHigh-gridSizeLow>gridSizeLow/16;++iteration)
+		{
+		/* Clamp the next grid size into the open search interval: */
+		if(gridSize<=gridSizeLow)
+			gridSize=gridSizeLow+1;
+		if(gridSize>=gridSizeHigh)
+			gridSize=gridSizeHigh-1;
+		
+		/* Count the number of cells occupied at the current grid size: */
+		unsigned int numCells=countGridCells(points,numPoints,pointBox.min,size/Scalar(gridSize),gridSize,cells);
+		if(numCells<=maxNumPoints)
+			gridSizeLow=gridSize;
+		else
+			gridSizeHigh=gridSize;
 		
-		/* Immediately unlink the temporary file, it will stay alive until the file handle is closed: */
-		unlink(tpf->fileName.c_str());
+		/* Guess the next grid size assuming that LiDAR points sample surfaces, then fall back to bisection: */
+		if(iteration<2)
+			gridSize=(unsigned int)(Math::floor(double(gridSize)*Math::sqrt(double(maxNumPoints)/double(numCells))));
+		else
+			gridSize=(gridSizeLow+gridSizeHigh)/2;
 		}
 	
-	}
+	/* Keep the point closest to the center of each occupied grid cell: */
+	Scalar cellSize=size/Scalar(gridSizeLow);
+	std::vector<unsigned int> keptPoints;
+	std::vector<GridCellPoint> cellPoints(numPoints);
+	for(unsigned int i=0;i<numPoints;++i)
+		{
+		cellPoints[i].cell=getGridCell(points[i],pointBox.min,cellSize,gridSizeLow,&cellPoints[i].dist2);
+		cellPoints[i].point=i;
+		}
+	std::sort(cellPoints.begin(),cellPoints.end(),GridCellPoint::less);
+	for(unsigned int i=0;i<numPoints;++i)
+		if(i==0||cellPoints[i].cell!=cellPoints[i-1].cell)
+			keptPoints.push_back(cellPoints[i].point);
 	
-	/* Sort the node's points into kd-tree order in-place: */
-	Geometry::ArrayKdTree<LidarPoint> pointTree;
-	pointTree.donatePoints(node.numPoints,node.points);
-	LidarPoint* nodePoints=pointTree.detachPoints();
+	/* The kept points are about one grid cell apart: */
+	if(detailSize<cellSize)
+		detailSize=cellSize;
 	
-	/* Write the node's points to the appropriate point file: */
-	{
-	Threads::Mutex::Lock tempPointFileLock(tpf->mutex);
-	node.pointsOffset=tpf->file->getWritePos();
-	tpf->file->write(nodePoints,node.numPoints);
+	/* Compact the kept points in place, preserving their original order: */
+	std::sort(keptPoints.begin(),keptPoints.end());
+	for(unsigned int i=0;i<keptPoints.size();++i)
+		points[i]=points[keptPoints[i]];
+	
+	return (unsigned int)(keptPoints.size());
 	}
+
+void LidarOctreeCreator::subsampleGrid(LidarOctreeCreator::Node& node)
+	{
+	/* Count the total number of points in all children's point sets: */
+	unsigned int totalNumPoints=0;
+	for(int childIndex=0;childIndex<8;++childIndex)
+		totalNumPoints+=node.children[childIndex].numPoints;
 	
-	/* Delete the node's points: */
-	if(node.pointsPrivate)
+	/* Collect all the children's points: */
+	LidarPoint* points=new LidarPoint[totalNumPoints];
+	LidarPoint* pPtr=points;
+	Scalar largestCollapsedDetail=Scalar(0);
+	for(int childIndex=0;childIndex<8;++childIndex)
+		{
+		Node& child=node.children[childIndex];
+		
+		/* Copy the child's point set: */
+		if(largestCollapsedDetail<child.detailSize)
+			largestCollapsedDetail=child.detailSize;
+		for(unsigned int i=0;i<child.numPoints;++i,++pPtr)
+			*pPtr=child.points[i];
+		}
+	
+	/* Write the child nodes to file: */
+	writeNodePoints(node.children,8);
+	
+	/* Subsample the collected points: */
+	unsigned int numPointsLeft=subsamplePointsOnGrid(points,totalNumPoints,maxNumPointsPerNode,largestCollapsedDetail);
+	
+	/* Store the leftover points in the node's point array: */
+	node.detailSize=largestCollapsedDetail;
+	if(node.points!=0&&node.numPoints<numPointsLeft)
+		std::cerr<<"Bad subsampling result"<<std::endl;
+	node.numPoints=numPointsLeft;
+	if(node.points==0)
 		{
-		node.pointsPrivate=false;
-		delete[] nodePoints;
+		node.pointsPrivate=true;
+		node.points=new LidarPoint[numPointsLeft];
 		}
+	for(unsigned int i=0;i<numPointsLeft;++i)
+		node.points[i]=points[i];
+	delete[] points;
+	
+	if(maxNumPointsPerInteriorNode<node.numPoints)
+		maxNumPointsPerInteriorNode=node.numPoints;
 	}
 
 void LidarOctreeCreator::subsample(LidarOctreeCreator::Node& node)
 	{
 	typedef Geometry::ArrayKdTree<LidarPoint> KdTree;
 	
+	/* Delegate to the grid subsampler if requested: */
+	if(subsampleMode==GRID)
+		{
+		subsampleGrid(node);
+		return;
+		}
+	
 	/* Count the total number of points in all children's point sets: */
 	unsigned int totalNumPoints=0;
 	for(int childIndex=0;childIndex<8;++childIndex)
@@ -249,10 +482,10 @@ void LidarOctreeCreator::subsample(LidarOctreeCreator::Node& node)
 			largestCollapsedDetail=child.detailSize;
 		for(unsigned int i=0;i<child.numPoints;++i,++tpPtr)
 			*tpPtr=child.points[i];
-		
-		/* Write the child node to file: */
-		writeNodePoints(child);
 		}
+	
+	/* Write the child nodes to file: */
+	writeNodePoints(node.children,8);
 	pointTree->releasePoints();
 	
 	bool* removeFlags=0;
@@ -359,8 +592,10 @@ void LidarOctreeCreator::subsample(LidarOctreeCreator::Node& node)
 		maxNumPointsPerInteriorNode=node.numPoints;
 	}
 
-void* LidarOctreeCreator::subsampleThreadMethod(void)
+void* LidarOctreeCreator::subsampleThreadMethod(unsigned int threadIndex)
 	{
+	TraceEvents::setThreadName("Subsampler");
+	double busyTime=0.0;
 	Node* node=0;
 	while(true)
 		{
@@ -375,7 +610,11 @@ void* LidarOctreeCreator::subsampleThreadMethod(void)
 			}
 		
 		/* Subsample the requested node: */
+		TraceEvents::Scope traceScope("Subsample","LidarOctreeCreator");
+		Misc::Timer subsampleTimer;
 		subsample(*node);
+		subsampleTimer.elapse();
+		busyTime+=subsampleTimer.getTime();
 		
 		/* Update the parent node's ready counter: */
 		if(node->parent!=0&&node->parent->numChildrenDone.preAdd(1)==8)
@@ -390,9 +629,62 @@ void* LidarOctreeCreator::subsampleThreadMethod(void)
 			}
 		}
 	
+	subsampleBusyTimes[threadIndex]=busyTime;
+	
+	return 0;
+	}
+
+void* LidarOctreeCreator::gatherThreadMethod(unsigned int threadIndex)
+	{
+	/* Read from every numGatherThreads-th temporary octree: */
+	for(size_t i=threadIndex;i<tempOctrees.size();i+=numGatherThreads)
+		gatherRegions[i].pointsEnd=tempOctrees[i]->getPointsInCube(*gatherDomain,gatherRegions[i].points);
+	
 	return 0;
 	}
 
+LidarPoint* LidarOctreeCreator::gatherPoints(const Cube& domain,LidarPoint* points)
+	{
+	TraceEvents::Scope traceScope("GatherPoints","LidarOctreeCreator");
+	
+	if(numSubsampleThreads<=1||tempOctrees.size()<=1)
+		{
+		/* Read from all temporary octrees in sequence: */
+		for(TempOctreeList::const_iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
+			points=(*toIt)->getPointsInCube(domain,points);
+		return points;
+		}
+	
+	/* Reserve a region of the point array for each temporary octree: */
+	gatherDomain=&domain;
+	gatherRegions.resize(tempOctrees.size());
+	LidarPoint* rPtr=points;
+	for(size_t i=0;i<tempOctrees.size();++i)
+		{
+		gatherRegions[i].points=rPtr;
+		rPtr+=tempOctrees[i]->boundNumPointsInCube(domain);
+		}
+	
+	/* Read from the temporary octrees in parallel to overlap reads from different scratch volumes: */
+	numGatherThreads=numSubsampleThreads;
+	if(numGatherThreads>tempOctrees.size())
+		numGatherThreads=(unsigned int)(tempOctrees.size());
+	Threads::Thread* gatherThreads=new Threads::Thread[numGatherThreads];
+	for(unsigned int i=0;i<numGatherThreads;++i)
+		gatherThreads[i].start(this,&LidarOctreeCreator::gatherThreadMethod,i);
+	for(unsigned int i=0;i<numGatherThreads;++i)
+		gatherThreads[i].join();
+	delete[] gatherThreads;
+	
+	/* Compact the regions: */
+	LidarPoint* pPtr=points;
+	for(size_t i=0;i<gatherRegions.size();++i)
+		for(const LidarPoint* sPtr=gatherRegions[i].points;sPtr!=gatherRegions[i].pointsEnd;++sPtr,++pPtr)
+			*pPtr=*sPtr;
+	
+	return pPtr;
+	}
+
 void LidarOctreeCreator::createSubTree(LidarOctreeCreator::Node& node,const Cube& nodeDomain)
 	{
 	/* Get an upper bound on the number of points contained in this node's domain: */
@@ -419,9 +711,7 @@ void LidarOctreeCreator::createSubTree(LidarOctreeCreator::Node& node,const Cube
 		/* Get the actual points contained in this node's domain: */
 		node.pointsPrivate=true;
 		node.points=new LidarPoint[numPointsBound];
-		LidarPoint* pPtr=node.points;
-		for(TempOctreeList::const_iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
-			pPtr=(*toIt)->getPointsInCube(nodeDomain,pPtr);
+		LidarPoint* pPtr=gatherPoints(nodeDomain,node.points);
 		node.numPoints=(unsigned int)(pPtr-node.points);
 		if(node.numPoints>numPointsBound)
 			std::cerr<<"Too many points collected from temporary octrees"<<std::endl;
@@ -512,23 +802,19 @@ void LidarOctreeCreator::createSubTreeWithPoints(LidarOctreeCreator::Node& node,
 		}
 	}
 
-void LidarOctreeCreator::calcFileOffsets(LidarOctreeCreator::Node& node,unsigned int level,LidarFile::Offset& octreeFilePos,LidarFile::Offset& dataFilePos)
+void LidarOctreeCreator::calcFileOffsets(LidarOctreeCreator::Node& node,unsigned int level,LidarFile::Offset& octreeFilePos)
 	{
 	if(level==0)
 		{
 		/* Calculate the node's offset: */
 		node.octreeNodeOffset=octreeFilePos;
 		octreeFilePos+=LidarFile::Offset(LidarOctreeFileNode::getFileSize());
-		
-		/* Calculate the node's points' offsets: */
-		node.octreeDataOffset=dataFilePos;
-		dataFilePos+=LidarFile::Offset(node.numPoints);
 		}
 	else if(node.children!=0)
 		{
 		/* Recurse into the node's children: */
 		for(int childIndex=0;childIndex<8;++childIndex)
-			calcFileOffsets(node.children[childIndex],level-1,octreeFilePos,dataFilePos);
+			calcFileOffsets(node.children[childIndex],level-1,octreeFilePos);
 		}
 	}
 
@@ -565,95 +851,41 @@ void LidarOctreeCreator::writeIndexFileLevel(const LidarOctreeCreator::Node& nod
 		}
 	}
 
-void LidarOctreeCreator::writePointsFileLevel(const LidarOctreeCreator::Node& node,unsigned int level,LidarOctreeCreator::TempFile& tempPointFile,LidarFile& pointsFile)
-	{
-	if(level==0)
-		{
-		/* Check if the node's point data offset matches the current point file write position: */
-		if(pointsFile.getWritePos()!=sizeof(LidarDataFileHeader)+node.octreeDataOffset*sizeof(LidarPoint))
-			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Wrong point data offset in octree node");
-		
-		/* Calculate the starting offset of the node's point array in units of LiDAR points: */
-		size_t nodeStart=node.pointsOffset/sizeof(LidarPoint);
-		
-		/* Check if the node's point array is outside the double buffer: */
-		if(nodeStart+node.numPoints>pointBufferStarts[2])
-			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Node's point array outside of temp point buffer");
-		
-		/* Copy node points from the double buffer halves: */
-		if(nodeStart<pointBufferStarts[1])
-			{
-			/* Copy points from the first buffer half: */
-			size_t numPoints=pointBufferStarts[1]-nodeStart;
-			if(numPoints>node.numPoints)
-				numPoints=node.numPoints;
-			const LidarPoint* pointData=pointBuffers[0]+(nodeStart-pointBufferStarts[0]);
-			pointsFile.write(pointData,numPoints);
-			if(pointBufferSizes[0]<numPoints)
-				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Wrong number of points in temp point buffer");
-			pointBufferSizes[0]-=numPoints;
-			}
-		if(nodeStart+node.numPoints>pointBufferStarts[1])
-			{
-			/* Copy points from the second buffer half: */
-			size_t numPoints=nodeStart+node.numPoints-pointBufferStarts[1];
-			if(numPoints>node.numPoints)
-				numPoints=node.numPoints;
-			const LidarPoint* pointData=pointBuffers[1]+(nodeStart+node.numPoints-pointBufferStarts[1]-numPoints);
-			pointsFile.write(pointData,numPoints);
-			if(pointBufferSizes[1]<numPoints)
-				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Wrong number of points in temp point buffer");
-			pointBufferSizes[1]-=numPoints;
-			}
-		
-		/* Check if the first buffer half has become empty: */
-		if(pointBufferSizes[0]==0)
-			{
-			/* Move the second buffer half into the now empty first half: */
-			LidarPoint* emptyBuffer=pointBuffers[0];
-			pointBuffers[0]=pointBuffers[1];
-			pointBufferStarts[0]=pointBufferStarts[1];
-			pointBufferSizes[0]=pointBufferSizes[1];
-			
-			pointBuffers[1]=emptyBuffer;
-			pointBufferStarts[1]=pointBufferStarts[2];
-			pointBufferSizes[1]=fileSize-pointBufferStarts[1];
-			if(pointBufferSizes[1]>pointBufferMaxSize)
-				pointBufferSizes[1]=pointBufferMaxSize;
-			tempPointFile.read(pointBuffers[1],pointBufferSizes[1]);
-			pointBufferStarts[2]=pointBufferStarts[1]+pointBufferSizes[1];
-			}
-		
-		++numWrittenNodes;
-		if(numWrittenNodes>nextNumWrittenNodesUpdate)
-			{
-			int percent=int(Math::floor(double(numWrittenNodes)*100.0/double(totalNumNodes)+0.5));
-			std::cout<<"\b\b\b\b"<<std::setw(3)<<percent<<"%"<<std::flush;
-			nextNumWrittenNodesUpdate=((2U*(percent+1U)+1U)*totalNumNodes+199U)/200U;
-			}
-		}
-	else if(node.children!=0)
-		{
-		/* Recurse into the node's children: */
-		for(int childIndex=0;childIndex<8;++childIndex)
-			writePointsFileLevel(node.children[childIndex],level-1,tempPointFile,pointsFile);
-		}
-	}
-
-LidarOctreeCreator::LidarOctreeCreator(size_t sMaxNumCachablePoints,unsigned int sMaxNumPointsPerNode,int sNumSubsampleThreads,const LidarOctreeCreator::TempOctreeList& sTempOctrees,std::string sTempPointFileNameTemplate)
+LidarOctreeCreator::LidarOctreeCreator(size_t sMaxNumCachablePoints,unsigned int sMaxNumPointsPerNode,int sNumSubsampleThreads,const LidarOctreeCreator::TempOctreeList& sTempOctrees,const char* sLidarFileName,bool compressPoints,LidarOctreeCreator::SubsampleMode sSubsampleMode,const Cube* sRootDomain)
 	:maxNumCachablePoints(sMaxNumCachablePoints),
 	 maxNumPointsPerNode(sMaxNumPointsPerNode),
 	 tempOctrees(sTempOctrees),
 	 domainBox(Box::empty),
+	 subsampleMode(sSubsampleMode),
 	 numSubsampleThreads(sNumSubsampleThreads),subsampleThreads(0),
-	 tempPointFileNameTemplate(sTempPointFileNameTemplate),
+	 subsampleBusyTimes(numSubsampleThreads,0.0),subsampleWallTime(0.0),
+	 gatherDomain(0),numGatherThreads(0),
+	 lidarFileName(sLidarFileName),
+	 pointsFile(0),compressedPoints(0),nextDataOffset(0),
 	 totalNumPoints(0),totalNumReadPoints(0),
 	 totalNumNodes(1),
 	 maxLevel(0),
-	 maxNumPointsPerInteriorNode(0)
+	 maxNumPointsPerInteriorNode(0),
+	 indexFileSize(0),pointsFileSize(0)
 	{
-	for(int i=0;i<2;++i)
-		pointBuffers[i]=0;
+	/* Create the LiDAR file directory: */
+	createLidarFileDirectory(sLidarFileName);
+	
+	/* Create the point data file, to which nodes' points will be appended as soon as they are final: */
+	std::string pointFileName=lidarFileName;
+	pointFileName.push_back('/');
+	pointFileName.append("Points");
+	pointsFile=new LidarFile(pointFileName.c_str(),IO::File::WriteOnly);
+	pointsFile->setEndianness(Misc::LittleEndian);
+	
+	/* Write the point data file header: */
+	if(compressPoints)
+		compressedPoints=new LidarCompressedFileWriter(*pointsFile,(unsigned int)(sizeof(LidarPoint)));
+	else
+		{
+		LidarDataFileHeader dfh((unsigned int)(sizeof(LidarPoint)));
+		dfh.write(*pointsFile);
+		}
 	
 	/* Calculate the total number of points and the union of all temporary octrees' bounding boxes: */
 	for(TempOctreeList::const_iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
@@ -663,15 +895,22 @@ LidarOctreeCreator::LidarOctreeCreator(size_t sMaxNumCachablePoints,unsigned int
 		}
 	
 	/* Calculate the root node's domain: */
-	rootDomain=Cube(domainBox);
-	
-	/* Initialize the temporary point file vector: */
-	tempPointFiles.push_back(new TempPointFile);
+	if(sRootDomain!=0)
+		{
+		/* Only create an octree for the points inside the given domain; the point count is an upper bound used for progress reports: */
+		rootDomain=*sRootDomain;
+		totalNumPoints=0;
+		for(TempOctreeList::const_iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
+			totalNumPoints+=(*toIt)->boundNumPointsInCube(rootDomain);
+		}
+	else
+		rootDomain=Cube(domainBox);
 	
 	/* Start the subsampling threads: */
+	Misc::Timer subsampleTimer;
 	subsampleThreads=new Threads::Thread[numSubsampleThreads];
 	for(unsigned int i=0;i<numSubsampleThreads;++i)
-		subsampleThreads[i].start(this,&LidarOctreeCreator::subsampleThreadMethod);
+		subsampleThreads[i].start(this,&LidarOctreeCreator::subsampleThreadMethod,i);
 	
 	/* Create the root's subtree: */
 	std::cout<<"Creating octree for "<<totalNumPoints<<" points"<<std::endl;
@@ -689,26 +928,37 @@ LidarOctreeCreator::LidarOctreeCreator(size_t sMaxNumCachablePoints,unsigned int
 		subsampleThreads[i].join();
 	delete[] subsampleThreads;
 	subsampleThreads=0;
+	subsampleTimer.elapse();
+	subsampleWallTime=subsampleTimer.getTime();
+	
+	/* Write the root's point list: */
+	writeNodePoints(&root,1);
 	
-	/* Write the root's point list and flush all point files: */
-	writeNodePoints(root);
-	for(TempPointFileList::iterator tpfIt=tempPointFiles.begin();tpfIt!=tempPointFiles.end();++tpfIt)
-		if((*tpfIt)->file!=0)
-			(*tpfIt)->file->flush();
+	/* Finish the point data file: */
+	if(compressedPoints!=0)
+		{
+		/* Write the compressed point data file's block table: */
+		compressedPoints->finish();
+		delete compressedPoints;
+		compressedPoints=0;
+		}
+	pointsFileSize=pointsFile->getWritePosAbs();
+	delete pointsFile;
+	pointsFile=0;
 	std::cout<<std::endl;
-	if(totalNumReadPoints!=totalNumPoints)
+	if(sRootDomain==0&&totalNumReadPoints!=totalNumPoints)
 		std::cout<<"Read "<<totalNumReadPoints<<" from temporary octree files instead of "<<totalNumPoints<<std::endl;
 	std::cout<<"Octree contains "<<totalNumNodes<<" nodes with up to "<<maxNumPointsPerInteriorNode<<" points per node in "<<maxLevel+1<<" resolution levels"<<std::endl;
 	
-	/* Calculate the octree nodes' file offsets: */
+	/* Calculate the octree nodes' index file offsets: */
 	LidarFile::Offset octreeFilePos=LidarFile::Offset(LidarOctreeFileHeader::getFileSize());
-	LidarFile::Offset dataFilePos=LidarFile::Offset(0);
 	for(unsigned int level=0;level<=maxLevel;++level)
 		{
 		std::cout<<"Processing octree level "<<level<<std::endl;
-		calcFileOffsets(root,level,octreeFilePos,dataFilePos);
+		calcFileOffsets(root,level,octreeFilePos);
 		}
-	std::cout<<"Octree file sizes are "<<octreeFilePos<<" bytes and "<<LidarFile::Offset(LidarDataFileHeader::getFileSize())+dataFilePos*LidarFile::Offset(sizeof(LidarPoint))<<" bytes"<<std::endl;
+	indexFileSize=octreeFilePos;
+	std::cout<<"Octree file sizes are "<<octreeFilePos<<" bytes and "<<LidarFile::Offset(LidarDataFileHeader::getFileSize())+nextDataOffset*LidarFile::Offset(sizeof(LidarPoint))<<" bytes"<<std::endl;
 	}
 
 LidarOctreeCreator::~LidarOctreeCreator(void)
@@ -716,81 +966,14 @@ LidarOctreeCreator::~LidarOctreeCreator(void)
 	/* Delete the subsampling threads: */
 	delete[] subsampleThreads;
 	
-	/* Delete the temporary point files: */
-	for(TempPointFileList::iterator tpfIt=tempPointFiles.begin();tpfIt!=tempPointFiles.end();++tpfIt)
-		{
-		if((*tpfIt)->file!=0)
-			{
-			delete (*tpfIt)->file;
-			// unlink((*tpfIt)->fileName.c_str());
-			delete *tpfIt;
-			}
-		}
-	
-	/* Delete the point writing buffer: */
-	for(int i=0;i<2;++i)
-		delete[] pointBuffers[i];
+	/* Close the point data file if octree creation was interrupted: */
+	delete compressedPoints;
+	delete pointsFile;
 	}
 
-void LidarOctreeCreator::write(size_t memorySize,const char* lidarFileName)
+void LidarOctreeCreator::write(void)
 	{
-	/*********************************************************************
-	Try creating the new LiDAR file base directory (oh, this can fail in
-	so many ways...):
-	*********************************************************************/
-	
-	/* Check if a file or directory of the given name already exists: */
-	struct stat statBuffer;
-	if(stat(lidarFileName,&statBuffer)==0)
-		{
-		/* Check if it's a directory: */
-		if(S_ISDIR(statBuffer.st_mode))
-			{
-			/* Create a list of all files or subdirectories in the directory: */
-			std::vector<std::string> files;
-			DIR* dir=opendir(lidarFileName);
-			if(dir!=0)
-				{
-				struct dirent* entry;
-				while((entry=readdir(dir))!=0)
-					if(strcmp(entry->d_name,".")!=0&&strcmp(entry->d_name,"..")!=0)
-						{
-						std::string file=lidarFileName;
-						file.push_back('/');
-						file.append(entry->d_name);
-						files.push_back(file);
-						}
-				closedir(dir);
-				
-				/* Try deleting all files: */
-				for(std::vector<std::string>::const_iterator fIt=files.begin();fIt!=files.end();++fIt)
-					{
-					if(unlink(fIt->c_str())<0)
-						throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Directory %s already exists, and file %s cannot be deleted",lidarFileName,fIt->c_str());
-					}
-				}
-			else
-				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Directory %s already exists but could not be opened",lidarFileName);
-			}
-		else
-			{
-			if(unlink(lidarFileName)==0)
-				{
-				if(mkdir(lidarFileName,0777)<0)
-					throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Could not create LiDAR file %s",lidarFileName);
-				}
-			else
-				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"File %s already exists and could not be removed",lidarFileName);
-			}
-		}
-	else
-		{
-		if(mkdir(lidarFileName,0777)<0)
-			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Could not create LiDAR file %s",lidarFileName);
-		}
-	
 	/* Create the octree file: */
-	{
 	std::cout<<"Writing octree index file..."<<std::flush;
 	std::string octreeFileName=lidarFileName;
 	octreeFileName.push_back('/');
@@ -807,57 +990,3 @@ void LidarOctreeCreator::write(size_t memorySize,const char* lidarFileName)
 		writeIndexFileLevel(root,level,octreeFile);
 	std::cout<<" done"<<std::endl;
 	}
-	
-	/* Create the point data file: */
-	{
-	std::cout<<"Writing octree points file...   0%"<<std::flush;
-	std::string pointFileName=lidarFileName;
-	pointFileName.push_back('/');
-	pointFileName.append("Points");
-	LidarFile pointFile(pointFileName.c_str(),IO::File::WriteOnly);
-	pointFile.setEndianness(Misc::LittleEndian);
-	
-	/* Write the point data file header: */
-	LidarDataFileHeader dfh((unsigned int)(sizeof(LidarPoint)));
-	dfh.write(pointFile);
-	
-	/* Create the point file double-buffer: */
-	pointBufferMaxSize=(memorySize/sizeof(LidarPoint))/2;
-	for(int i=0;i<2;++i)
-		pointBuffers[i]=new LidarPoint[pointBufferMaxSize];
-	
-	/* Write the octree points file: */
-	numWrittenNodes=0;
-	nextNumWrittenNodesUpdate=(totalNumNodes+199U)/200U;
-	for(unsigned int level=0;level<=maxLevel;++level)
-		{
-		/* Fill the double-buffer from the temporary point file for this level: */
-		fileSize=tempPointFiles[level]->file->getWritePos()/sizeof(LidarPoint);
-		tempPointFiles[level]->file->setReadPosAbs(0);
-		pointBufferStarts[0]=TempFile::Offset(0);
-		for(int i=0;i<2;++i)
-			{
-			pointBufferSizes[i]=fileSize-pointBufferStarts[i];
-			if(pointBufferSizes[i]>pointBufferMaxSize)
-				pointBufferSizes[i]=pointBufferMaxSize;
-			tempPointFiles[level]->file->read(pointBuffers[i],pointBufferSizes[i]);
-			pointBufferStarts[i+1]=pointBufferStarts[i]+pointBufferSizes[i];
-			}
-		
-		/* Write the level's nodes: */
-		writePointsFileLevel(root,level,*tempPointFiles[level]->file,pointFile);
-		
-		/* Delete the level's temporary point file: */
-		delete tempPointFiles[level]->file;
-		// unlink(tempPointFiles[level]->fileName.c_str());
-		delete tempPointFiles[level];
-		}
-	for(int i=0;i<2;++i)
-		{
-		delete[] pointBuffers[i];
-		pointBuffers[i]=0;
-		}
-	tempPointFiles.clear();
-	std::cout<<"\b\b\b\bdone"<<std::endl;
-	}
-	}
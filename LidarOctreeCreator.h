@@ -31,7 +31,6 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Threads/Atomic.h>
 #include <Threads/Thread.h>
 #include <Threads/Queue.h>
-#include <IO/StandardFile.h>
 
 #include "LidarTypes.h"
 #include "Cube.h"
@@ -39,15 +38,21 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 /* Forward declarations: */
 class TempOctree;
+class LidarCompressedFileWriter;
 
 class LidarOctreeCreator
 	{
 	/* Embedded classes: */
 	public:
 	typedef std::vector<TempOctree*> TempOctreeList; // Type for lists of temporary octrees
-	private:
-	typedef IO::StandardFile TempFile; // Type for temporary files used during octree creation
 	
+	enum SubsampleMode // Enumerated type for algorithms creating interior nodes' point sets from their children's point sets
+		{
+		NEARESTNEIGHBOR, // Repeatedly collapse neighborhoods around the closest pairs of points
+		GRID // Keep the point closest to the center of each occupied cell of the finest regular grid that does not exceed the node size
+		};
+	
+	private:
 	struct Node // Structure for octree nodes during creation
 		{
 		/* Elements: */
@@ -59,11 +64,7 @@ class LidarOctreeCreator
 		unsigned int numPoints; // Number of points belonging to this node
 		Threads::Atomic<unsigned char> numChildrenDone; // Counts the number of children of this node whose point sets have been created
 		bool pointsPrivate; // Flag whether this node owns the point array
-		union
-			{
-			LidarPoint* points; // Pointer to the points belonging to this node
-			TempFile::Offset pointsOffset; // Offset of the node's point set in the temporary point file
-			};
+		LidarPoint* points; // Pointer to the points belonging to this node until they are written to the point data file
 		LidarFile::Offset octreeNodeOffset; // Offset of node's structure data in the resulting octree file
 		LidarFile::Offset octreeDataOffset; // Offset of node's point and ancillary data in the resulting octree file, in units of data record size
 		
@@ -84,23 +85,14 @@ class LidarOctreeCreator
 			};
 		};
 	
-	struct TempPointFile // Structure to store names and handles for temporary files holding created points for each tree level
+	struct GatherRegion // Structure describing the part of a node's point array filled from one temporary octree
 		{
 		/* Elements: */
 		public:
-		TempFile* file; // Pointer to the temporary point file
-		std::string fileName; // Name of the temporary point file
-		Threads::Mutex mutex; // Mutex to serialize write access to the temporary point file
-		
-		/* Constructors and destructors: */
-		TempPointFile(void)
-			:file(0)
-			{
-			};
+		LidarPoint* points; // Start of the region reserved for the temporary octree's points
+		LidarPoint* pointsEnd; // End of the points actually read from the temporary octree
 		};
 	
-	typedef std::vector<TempPointFile*> TempPointFileList; // Type for lists of temporary point files
-	
 	/* Elements: */
 	size_t maxNumCachablePoints; // Maximum number of points to be held in memory at any time
 	unsigned int maxNumPointsPerNode; // Maximum number of points per leaf node
@@ -109,46 +101,74 @@ class LidarOctreeCreator
 	Cube rootDomain; // The domain of the root node
 	Node root; // The octree's root node
 	
+	SubsampleMode subsampleMode; // Algorithm used to subsample interior nodes
 	Threads::Queue<Node*> subsampleQueue; // Subsample request queue
 	unsigned int numSubsampleThreads; // Number of subsampling threads
 	Threads::Thread* subsampleThreads; // Array of subsampling threads
+	std::vector<double> subsampleBusyTimes; // Time each subsampling thread spent subsampling nodes, in seconds
+	double subsampleWallTime; // Time from starting to joining the subsampling threads, in seconds
+	const Cube* gatherDomain; // Domain whose points are currently being read from the temporary octrees
+	std::vector<GatherRegion> gatherRegions; // Point array regions for the temporary octrees during the current read
+	unsigned int numGatherThreads; // Number of threads reading from the temporary octrees during the current read
 	
-	std::string tempPointFileNameTemplate; // Template to generate temporary point file names
-	Threads::Mutex tempPointFilesMutex; // Mutex serializing access to the temporary point file list
-	TempPointFileList tempPointFiles; // Vector of temporary point files for each tree level
+	std::string lidarFileName; // Name of the LiDAR file directory being created
+	Threads::Mutex pointsFileMutex; // Mutex serializing access to the point data file, its writer, and the next data offset
+	LidarFile* pointsFile; // The point data file of the LiDAR file being created
+	LidarCompressedFileWriter* compressedPoints; // Writer for compressed point data files, or 0 if points are stored uncompressed
+	LidarFile::Offset nextDataOffset; // Data offset of the next node written to the point data file, in units of LiDAR points
 	
 	size_t totalNumPoints; // Total number of points in all input files
 	size_t totalNumReadPoints; // Total number of points read from the temporary octrees; should equal the total number of points in the end
 	unsigned int totalNumNodes; // Total number of nodes in the octree
 	unsigned int maxLevel; // Number of the highest level in the octree
 	unsigned int maxNumPointsPerInteriorNode; // Actual maximum number of points in any node in the octree
-	
-	TempFile::Offset pointBufferMaxSize; // Maximum number of LiDAR points in each double-buffer half
-	TempFile::Offset fileSize; // Total number of LiDAR points in temporary point file
-	LidarPoint* pointBuffers[2]; // A double-buffer to read points from a temporary point file
-	TempFile::Offset pointBufferStarts[3]; // File offsets of the two double-buffer halves (plus end of second half) in units of LiDAR points
-	TempFile::Offset pointBufferSizes[2]; // Number of uncopied points in each double-buffer half
-	
-	unsigned int numWrittenNodes; // Number of nodes already written to the final octree files
-	unsigned int nextNumWrittenNodesUpdate; // Next number of written nodes at which to print a percentage update
+	LidarFile::Offset indexFileSize; // Size of the index file in bytes
+	LidarFile::Offset pointsFileSize; // Size of the point data file in bytes
 	
 	/* Private methods: */
-	void writeNodePoints(Node& node); // Writes a node's points to a temporary point file
+	void writeNodePoints(Node* nodes,int numNodes); // Appends the points of an array of at most eight nodes to the point data file back-to-back and assigns the nodes' data offsets
+	void subsampleGrid(Node& node);
 	void subsample(Node& node);
-	void* subsampleThreadMethod(void);
+	void* subsampleThreadMethod(unsigned int threadIndex);
+	void* gatherThreadMethod(unsigned int threadIndex); // Reads the points inside the current gather domain from a subset of the temporary octrees
+	LidarPoint* gatherPoints(const Cube& domain,LidarPoint* points); // Reads the points inside the given domain from all temporary octrees into the given array, in parallel when there are multiple threads; returns the end of the read points
 	void createSubTree(Node& node,const Cube& nodeDomain);
 	void createSubTreeWithPoints(Node& node,const Cube& nodeDomain);
-	void calcFileOffsets(Node& node,unsigned int level,LidarFile::Offset& octreeFilePos,LidarFile::Offset& dataFilePos);
+	void calcFileOffsets(Node& node,unsigned int level,LidarFile::Offset& octreeFilePos);
 	void writeIndexFileLevel(const Node& node,unsigned int level,LidarFile& octreeFile);
-	void writePointsFileLevel(const Node& node,unsigned int level,TempFile& tempPointFile,LidarFile& pointsFile);
 	
 	/* Constructors and destructors: */
 	public:
-	LidarOctreeCreator(size_t sMaxNumCachablePoints,unsigned int sMaxNumPointsPerNode,int sNumSubsampleThreads,const TempOctreeList& sTempOctrees,std::string sTempPointFileNameTemplate); // Creates point octree for the union of the given point sets and the given node parameters
+	LidarOctreeCreator(size_t sMaxNumCachablePoints,unsigned int sMaxNumPointsPerNode,int sNumSubsampleThreads,const TempOctreeList& sTempOctrees,const char* sLidarFileName,bool compressPoints =false,SubsampleMode sSubsampleMode =NEARESTNEIGHBOR,const Cube* sRootDomain =0); // Creates point octree for the union of the given point sets and the given node parameters, using the given subsampling algorithm for interior nodes, and streams all nodes' points directly into the given LiDAR file directory's point data file; stores each node's points as a compressed block if flag is true; if a root domain is given, only creates an octree for the points inside that cube
 	~LidarOctreeCreator(void);
 	
 	/* Methods: */
-	void write(size_t memorySize,const char* lidarFileName); // Writes the octree structure and point data to the given LiDAR file directory
+	static unsigned int subsamplePointsOnGrid(LidarPoint* points,unsigned int numPoints,unsigned int maxNumPoints,Scalar& detailSize); // Reduces the given point array in place to at most the given number of points by keeping one point per occupied cell of a regular grid; returns the number of kept points and enlarges the detail size to the grid's cell size
+	unsigned int getNumSubsampleThreads(void) const // Returns the number of subsampling threads
+		{
+		return numSubsampleThreads;
+		}
+	double getSubsampleBusyTime(unsigned int threadIndex) const // Returns the time the given subsampling thread spent subsampling nodes in seconds
+		{
+		return subsampleBusyTimes[threadIndex];
+		}
+	double getSubsampleWallTime(void) const // Returns the time during which the subsampling threads were running in seconds
+		{
+		return subsampleWallTime;
+		}
+	LidarFile::Offset getIndexFileSize(void) const // Returns the size of the index file written by the write method in bytes
+		{
+		return indexFileSize;
+		}
+	LidarFile::Offset getPointsFileSize(void) const // Returns the size of the point data file in bytes
+		{
+		return pointsFileSize;
+		}
+	LidarFile::Offset getNumDataRecords(void) const // Returns the number of point records written to the point data file, which is also the number of records in each ancillary data file
+		{
+		return nextDataOffset;
+		}
+	void write(void); // Writes the octree structure to the LiDAR file directory's index file
 	};
 
 #endif
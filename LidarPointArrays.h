@@ -0,0 +1,141 @@
+/***********************************************************************
+LidarPointArrays - Structure-of-arrays view of an octree node's LiDAR
+points, with filter kernels selecting the points inside boxes or spheres
+in blocks that are amenable to compiler vectorization.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARPOINTARRAYS_INCLUDED
+#define LIDARPOINTARRAYS_INCLUDED
+
+#include <stdlib.h>
+#include <Misc/StdError.h>
+
+#include "LidarTypes.h"
+
+class LidarPointArrays // Class holding separate coordinate arrays for an array of LiDAR points
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int blockSize=64; // Number of points tested by one invocation of a filter kernel
+	static const size_t alignment=32; // Alignment of the coordinate arrays in bytes
+	
+	/* Elements: */
+	private:
+	unsigned int numPoints; // Number of points
+	unsigned int stride; // Distance between the starts of the coordinate arrays in units of Scalar, padded to the alignment
+	Scalar* memory; // Block of memory holding all coordinate arrays
+	
+	/* Constructors and destructors: */
+	public:
+	LidarPointArrays(unsigned int maxNumPoints) // Creates empty coordinate arrays for the given maximum number of points
+		:numPoints(0),
+		 stride((maxNumPoints+unsigned(alignment/sizeof(Scalar))-1U)&~(unsigned(alignment/sizeof(Scalar))-1U)),
+		 memory(0)
+		{
+		void* mem;
+		if(posix_memalign(&mem,alignment,size_t(stride)*3*sizeof(Scalar))!=0)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to allocate coordinate arrays for %u points",maxNumPoints);
+		memory=static_cast<Scalar*>(mem);
+		}
+	private:
+	LidarPointArrays(const LidarPointArrays& source); // Prohibit copy constructor
+	LidarPointArrays& operator=(const LidarPointArrays& source); // Prohibit assignment operator
+	public:
+	~LidarPointArrays(void)
+		{
+		free(memory);
+		}
+	
+	/* Methods: */
+	void set(const LidarPoint* points,unsigned int newNumPoints) // Copies the coordinates of the given point array; number of points must not exceed the maximum
+		{
+		numPoints=newNumPoints;
+		Scalar* x=memory;
+		Scalar* y=memory+stride;
+		Scalar* z=memory+2*stride;
+		for(unsigned int i=0;i<numPoints;++i)
+			{
+			x[i]=points[i][0];
+			y[i]=points[i][1];
+			z[i]=points[i][2];
+			}
+		}
+	unsigned int getNumPoints(void) const // Returns the number of points
+		{
+		return numPoints;
+		}
+	const Scalar* getCoords(int dimension) const // Returns the aligned array of the given coordinate
+		{
+		return memory+dimension*stride;
+		}
+	unsigned int selectInBox(unsigned int first,const Box& box,unsigned int selected[blockSize]) const // Stores indices of the points inside the given box among the block of points starting at the given index; returns number of selected points
+		{
+		unsigned int count=numPoints-first<blockSize?numPoints-first:blockSize;
+		const Scalar* __restrict x=getCoords(0)+first;
+		const Scalar* __restrict y=getCoords(1)+first;
+		const Scalar* __restrict z=getCoords(2)+first;
+		Scalar min0=box.min[0],min1=box.min[1],min2=box.min[2];
+		Scalar max0=box.max[0],max1=box.max[1],max2=box.max[2];
+		
+		/* Test all points in the block without branches: */
+		unsigned char inside[blockSize];
+		for(unsigned int i=0;i<count;++i)
+			inside[i]=(x[i]>=min0)&(x[i]<=max0)&(y[i]>=min1)&(y[i]<=max1)&(z[i]>=min2)&(z[i]<=max2);
+		
+		/* Compact the indices of the selected points: */
+		unsigned int numSelected=0;
+		for(unsigned int i=0;i<count;++i)
+			{
+			selected[numSelected]=first+i;
+			numSelected+=inside[i];
+			}
+		return numSelected;
+		}
+	unsigned int selectInSphere(unsigned int first,const Point& center,Scalar radius2,unsigned int selected[blockSize]) const // Stores indices of the points inside the given sphere among the block of points starting at the given index; returns number of selected points
+		{
+		unsigned int count=numPoints-first<blockSize?numPoints-first:blockSize;
+		const Scalar* __restrict x=getCoords(0)+first;
+		const Scalar* __restrict y=getCoords(1)+first;
+		const Scalar* __restrict z=getCoords(2)+first;
+		Scalar c0=center[0],c1=center[1],c2=center[2];
+		
+		/* Test all points in the block without branches: */
+		unsigned char inside[blockSize];
+		for(unsigned int i=0;i<count;++i)
+			{
+			Scalar d0=x[i]-c0;
+			Scalar d1=y[i]-c1;
+			Scalar d2=z[i]-c2;
+			inside[i]=d0*d0+d1*d1+d2*d2<=radius2;
+			}
+		
+		/* Compact the indices of the selected points: */
+		unsigned int numSelected=0;
+		for(unsigned int i=0;i<count;++i)
+			{
+			selected[numSelected]=first+i;
+			numSelected+=inside[i];
+			}
+		return numSelected;
+		}
+	};
+
+#endif
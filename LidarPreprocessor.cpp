@@ -22,16 +22,22 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <vector>
+#include <Misc/SelfDestructArray.h>
 #include <Misc/StdError.h>
 #include <Misc/Endianness.h>
 #include <Misc/FileNameExtensions.h>
 #include <Misc/Timer.h>
 #include <Misc/StandardValueCoders.h>
+#include <Misc/CompoundValueCoders.h>
 #include <Misc/ConfigurationFile.h>
 #include <IO/File.h>
 #include <IO/SeekableFile.h>
@@ -39,6 +45,9 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <IO/ReadAheadFilter.h>
 #include <IO/ValueSource.h>
 #include <IO/OpenFile.h>
+#include <Threads/Mutex.h>
+#include <Threads/Atomic.h>
+#include <Threads/Thread.h>
 #include <Math/Math.h>
 #include <Math/Constants.h>
 #include <Geometry/OrthogonalTransformation.h>
@@ -52,7 +61,14 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarTypes.h"
 #include "PointAccumulator.h"
 #include "ReadPlyFile.h"
+#include "LazReader.h"
+#include "AsciiPointReader.h"
 #include "LidarProcessOctree.h"
+#include "LidarAttributes.h"
+#include "LidarAttributeWriter.h"
+#include "LidarNodeSummary.h"
+#include "TempOctree.h"
+#include "TraceEvents.h"
 #include "LidarOctreeCreator.h"
 
 class TIFFDEMLoader // Helper class to convert DEMs in TIFF format into a point cloud
@@ -61,7 +77,7 @@ class TIFFDEMLoader // Helper class to convert DEMs in TIFF format into a point
 	private:
 	Images::TIFFReader tiffReader; // TIFF image file reader object
 	Images::GeoTIFFMetadata mapData; // Map transformation defined in the TIFF image file
-	PointAccumulator& pa; // Accumulator for 3D points
+	PointAccumulator::Batch batch; // Batch collecting 3D points for the point accumulator
 	PointAccumulator::Color color; // Color to assign to all points
 	
 	/* Private methods: */
@@ -80,7 +96,7 @@ class TIFFDEMLoader // Helper class to convert DEMs in TIFF format into a point
 			/* Convert and add the current pixel: */
 			p[2]=double(*pPtr);
 			if(p[2]!=md.noData)
-				thisPtr->pa.addPoint(p,thisPtr->color);
+				thisPtr->batch.addPoint(p,thisPtr->color);
 			
 			/* Go to the next pixel: */
 			p[0]+=md.dim[0];
@@ -93,7 +109,7 @@ class TIFFDEMLoader // Helper class to convert DEMs in TIFF format into a point
 	public:
 	TIFFDEMLoader(PointAccumulator& sPa,const char* fileName,unsigned int imageIndex)
 		:tiffReader(*IO::openFile(fileName),imageIndex),
-		 pa(sPa),color(1.0,1.0,1.0)
+		 batch(sPa),color(1.0,1.0,1.0)
 		{
 		/* Check if the TIFF image has a compatible format: */
 		if(tiffReader.getNumSamples()!=1||tiffReader.getNumBits()!=32||!tiffReader.hasFloatSamples())
@@ -129,6 +145,7 @@ class TIFFDEMLoader // Helper class to convert DEMs in TIFF format into a point
 		{
 		/* Stream the image's pixels into the streaming callback, which in turn adds them to the point accumulator: */
 		tiffReader.streamImage(&TIFFDEMLoader::streamingCallback,this);
+		batch.flush();
 		}
 	};
 
@@ -333,10 +350,12 @@ void loadXYZBILImage(PointAccumulator& pa,const char* fileName)
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"File %s is not an XYZ image file",fileName);
 	
 	/* Add all non-zero image pixels to the point accumulator: */
+	PointAccumulator::Batch batch(pa);
 	const float* pPtr=static_cast<const float*>(xyzImage.getPixels());
 	for(size_t numPixels=xyzImage.getHeight()*xyzImage.getWidth();numPixels>0;--numPixels,pPtr+=3)
 		if(pPtr[0]!=0.0f||pPtr[1]!=0.0f||pPtr[2]!=0.0f)
-			pa.addPoint(PointAccumulator::Point(-pPtr[0],pPtr[1],-pPtr[2]),PointAccumulator::Color(1,1,1)); // X and Z coordinates must be negated!
+			batch.addPoint(PointAccumulator::Point(-pPtr[0],pPtr[1],-pPtr[2]),PointAccumulator::Color(1,1,1)); // X and Z coordinates must be negated!
+	batch.flush();
 	}
 
 void loadPointFileBin(PointAccumulator& pa,const char* fileName)
@@ -349,6 +368,7 @@ void loadPointFileBin(PointAccumulator& pa,const char* fileName)
 	size_t numPoints=file->read<unsigned int>();
 	
 	/* Read all points: */
+	PointAccumulator::Batch batch(pa);
 	for(size_t i=0;i<numPoints;++i)
 		{
 		/* Read the point position and intensity from the input file: */
@@ -356,8 +376,9 @@ void loadPointFileBin(PointAccumulator& pa,const char* fileName)
 		file->read(rp,4);
 		
 		/* Store the point: */
-		pa.addPoint(PointAccumulator::Point(rp),PointAccumulator::Color(rp[3],rp[3],rp[3]));
+		batch.addPoint(PointAccumulator::Point(rp),PointAccumulator::Color(rp[3],rp[3],rp[3]));
 		}
+	batch.flush();
 	}
 
 void loadPointFileBinRgb(PointAccumulator& pa,const char* fileName)
@@ -370,6 +391,7 @@ void loadPointFileBinRgb(PointAccumulator& pa,const char* fileName)
 	size_t numPoints=file->read<unsigned int>();
 	
 	/* Read all points: */
+	PointAccumulator::Batch batch(pa);
 	for(size_t i=0;i<numPoints;++i)
 		{
 		/* Read the point position and color from the input file: */
@@ -379,50 +401,84 @@ void loadPointFileBinRgb(PointAccumulator& pa,const char* fileName)
 		file->read(rcol,4);
 		
 		/* Store the point: */
-		pa.addPoint(PointAccumulator::Point(rp),PointAccumulator::Color(rcol));
+		batch.addPoint(PointAccumulator::Point(rp),PointAccumulator::Color(rcol));
 		}
+	batch.flush();
 	}
 
-void loadPointFileLas(PointAccumulator& pa,const char* fileName,unsigned int classMask)
+inline int getLasInt(const unsigned char* bytes) // Decodes a little-endian signed 32-bit integer from a LAS point record
 	{
-	/* Open the LAS input file: */
-	IO::FilePtr file(new IO::ReadAheadFilter(IO::openFile(fileName)));
-	file->setEndianness(Misc::LittleEndian);
+	return int((unsigned int)(bytes[0])|((unsigned int)(bytes[1])<<8)|((unsigned int)(bytes[2])<<16)|((unsigned int)(bytes[3])<<24));
+	}
+
+inline unsigned short getLasUShort(const unsigned char* bytes) // Decodes a little-endian unsigned 16-bit integer from a LAS point record
+	{
+	return (unsigned short)((unsigned int)(bytes[0])|((unsigned int)(bytes[1])<<8));
+	}
+
+struct LasFileHeader // Structure for the parts of a LAS file header needed to decode point records
+	{
+	/* Elements: */
+	public:
+	unsigned char pointDataFormat; // Format of the file's point records
+	unsigned short pointDataRecordLength; // Size of each point record in bytes
+	size_t numPointRecords; // Number of point records in the file
+	double scale[3]; // Scale factors from integer to model coordinates
+	PointAccumulator::Vector offset; // Offset from scaled integer to model coordinates
 	
+	/* Methods: */
+	bool haveTime(void) const // Returns true if the file's point records contain GPS times
+		{
+		static const bool haveTimes[]=
+			{
+			false,true,false,true,true,true
+			};
+		return haveTimes[pointDataFormat];
+		}
+	bool haveRgb(void) const // Returns true if the file's point records contain RGB colors
+		{
+		static const bool haveRgbs[]=
+			{
+			false,false,true,true,false,false
+			};
+		return haveRgbs[pointDataFormat];
+		}
+	};
+
+bool readLasFileHeader(IO::File& file,const char* fileName,LasFileHeader& header) // Reads the header of the given little-endian LAS file and skips to its first point record; returns false if the file's point records can not be read
+	{
 	/* Read the LAS file header: */
 	char signature[4];
-	file->read(signature,4);
+	file.read(signature,4);
 	if(memcmp(signature,"LASF",4)!=0)
-		return;
-	
-	file->skip<unsigned short>(1); // Ignore file source ID
-	file->skip<unsigned short>(1); // Ignore reserved field
-	file->skip<unsigned int>(1); // Ignore project ID
-	file->skip<unsigned short>(1); // Ignore project ID
-	file->skip<unsigned short>(1); // Ignore project ID
-	file->skip<char>(8); // Ignore project ID
-	file->skip<char>(2); // Ignore file version number
-	file->skip<char>(32); // Ignore system identifier
-	file->skip<char>(32); // Ignore generating software
-	file->skip<unsigned short>(1); // Ignore file creation day of year
-	file->skip<unsigned short>(1); // Ignore file creation year
-	file->skip<unsigned short>(1); // Ignore header size
-	unsigned int pointDataOffset=file->read<unsigned int>();
-	file->skip<unsigned int>(1); // Ignore number of variable-length records
-	unsigned char pointDataFormat=file->read<unsigned char>();
-	unsigned short pointDataRecordLength=file->read<unsigned short>();
-	size_t numPointRecords=file->read<unsigned int>();
+		return false;
+	
+	file.skip<unsigned short>(1); // Ignore file source ID
+	file.skip<unsigned short>(1); // Ignore reserved field
+	file.skip<unsigned int>(1); // Ignore project ID
+	file.skip<unsigned short>(1); // Ignore project ID
+	file.skip<unsigned short>(1); // Ignore project ID
+	file.skip<char>(8); // Ignore project ID
+	file.skip<char>(2); // Ignore file version number
+	file.skip<char>(32); // Ignore system identifier
+	file.skip<char>(32); // Ignore generating software
+	file.skip<unsigned short>(1); // Ignore file creation day of year
+	file.skip<unsigned short>(1); // Ignore file creation year
+	file.skip<unsigned short>(1); // Ignore header size
+	unsigned int pointDataOffset=file.read<unsigned int>();
+	file.skip<unsigned int>(1); // Ignore number of variable-length records
+	header.pointDataFormat=file.read<unsigned char>();
+	header.pointDataRecordLength=file.read<unsigned short>();
+	header.numPointRecords=file.read<unsigned int>();
 	unsigned int numPointsByReturn[5];
-	file->read(numPointsByReturn,5);
-	double scale[3];
-	file->read(scale,3);
-	PointAccumulator::Vector offset;
-	file->read(offset.getComponents(),3);
+	file.read(numPointsByReturn,5);
+	file.read(header.scale,3);
+	file.read(header.offset.getComponents(),3);
 	double min[3],max[3];
 	for(int i=0;i<3;++i)
 		{
-		max[i]=file->read<double>();
-		min[i]=file->read<double>();
+		max[i]=file.read<double>();
+		min[i]=file.read<double>();
 		}
 	
 	/* Check the point record format for sanity: */
@@ -430,98 +486,222 @@ void loadPointFileLas(PointAccumulator& pa,const char* fileName,unsigned int cla
 		{
 		20,28,26,34,57,63
 		};
-	if(pointDataFormat<6U&&pointDataRecordLength<expectedPointDataRecordLengths[pointDataFormat])
+	if(header.pointDataFormat<6U&&header.pointDataRecordLength<expectedPointDataRecordLengths[header.pointDataFormat])
 		{
-		std::cout<<"Ignoring LAS file "<<fileName<<" with point data format "<<int(pointDataFormat)<<" due to wrong point record length ("<<pointDataRecordLength<<" instead of "<<expectedPointDataRecordLengths[pointDataFormat]<<")"<<std::endl;
-		return;
+		std::cout<<"Ignoring LAS file "<<fileName<<" with point data format "<<int(header.pointDataFormat)<<" due to wrong point record length ("<<header.pointDataRecordLength<<" instead of "<<expectedPointDataRecordLengths[header.pointDataFormat]<<")"<<std::endl;
+		return false;
 		}
-	else if(pointDataFormat>=6U)
+	else if(header.pointDataFormat>=6U)
 		{
-		std::cout<<"Ignoring LAS file "<<fileName<<" due to unknown point data format "<<int(pointDataFormat)<<std::endl;
-		return;
+		std::cout<<"Ignoring LAS file "<<fileName<<" due to unknown point data format "<<int(header.pointDataFormat)<<std::endl;
+		return false;
 		}
 	
-	/* Arrays of point data record features by point data format: */
-	static const bool haveTimes[]=
-		{
-		false,true,false,true,true,true
-		};
-	static const bool haveRgb[]=
-		{
-		false,false,true,true,false,false
-		};
-	size_t skipToClass=sizeof(char);
-	size_t skipToColor=2*sizeof(unsigned char)+sizeof(unsigned short);
-	if(haveTimes[pointDataFormat])
-		skipToColor+=sizeof(double);
-	size_t skipToEnd=pointDataRecordLength-expectedPointDataRecordLengths[pointDataFormat];
-	
 	/* Skip to the beginning of the point records: */
 	if(pointDataOffset<227)
 		{
 		std::cout<<"Ignoring LAS file "<<fileName<<" due to short file header ("<<pointDataOffset<<" bytes)"<<std::endl;
-		return;
+		return false;
 		}
-	file->skip<unsigned char>(pointDataOffset-227);
+	file.skip<unsigned char>(pointDataOffset-227);
+	
+	return true;
+	}
+
+void loadPointFileLas(PointAccumulator& pa,const char* fileName,unsigned int classMask)
+	{
+	/* Open the LAS input file: */
+	IO::FilePtr file(new IO::ReadAheadFilter(IO::openFile(fileName)));
+	file->setEndianness(Misc::LittleEndian);
+	
+	/* Read the LAS file header: */
+	LasFileHeader header;
+	if(!readLasFileHeader(*file,fileName,header))
+		return;
+	
+	/* Byte offsets of point record features: */
+	const size_t classOffset=15; // Byte offset of the point classification in point records of all formats
+	size_t colorOffset=20; // Byte offset of the (optional) point color
+	if(header.haveTime())
+		colorOffset+=sizeof(double);
 	
 	/* Apply the LAS offset to the point accumulator's point offset: */
 	PointAccumulator::Vector originalPointOffset=pa.getPointOffset();
-	pa.setPointOffset(originalPointOffset+offset);
-	
-	/* Read all points: */
-	for(size_t i=0;i<numPointRecords;++i)
+	pa.setPointOffset(originalPointOffset+header.offset);
+	
+	/* Read point records in large blocks and decode them directly from the block buffer: */
+	const size_t blockSize=65536; // Number of point records per block
+	Misc::SelfDestructArray<unsigned char> recordBuffer(blockSize*header.pointDataRecordLength);
+	Misc::SelfDestructArray<PointAccumulator::Point> blockPoints(blockSize);
+	Misc::SelfDestructArray<PointAccumulator::Color> blockColors(blockSize);
+	for(size_t numRecordsLeft=header.numPointRecords;numRecordsLeft>0;)
 		{
-		/* Read the point position: */
-		int pos[3];
-		file->read(pos,3);
-		PointAccumulator::Point p;
-		for(int j=0;j<3;++j)
-			p[j]=double(pos[j])*scale[j];
-		
-		/* Read the point intensity: */
-		float intensity=float(file->read<unsigned short>());
-		
-		/* Skip to the point classification: */
-		file->skip<char>(skipToClass);
-		
-		/* Read the point classification: */
-		unsigned int classBit=0x1U<<(file->read<unsigned char>()&0x1fU);
-		
-		/* Skip to the (optional) point color: */
-		file->skip<char>(skipToColor);
+		/* Read the next block of point records: */
+		size_t numRecords=numRecordsLeft<blockSize?numRecordsLeft:blockSize;
+		file->read(recordBuffer.getArray(),numRecords*header.pointDataRecordLength);
 		
-		PointAccumulator::Color c;
-		if(haveRgb[pointDataFormat])
+		/* Decode all point records whose classification passes the class mask: */
+		const unsigned char* rPtr=recordBuffer.getArray();
+		PointAccumulator::Point* pPtr=blockPoints.getArray();
+		PointAccumulator::Color* cPtr=blockColors.getArray();
+		for(size_t i=0;i<numRecords;++i,rPtr+=header.pointDataRecordLength)
 			{
-			/* Assign point color from stored RGB data: */
-			unsigned short rgb[3];
-			file->read(rgb,3);
-			for(int j=0;j<3;++j)
-				c[j]=float(rgb[j]);
-			}
-		else
-			{
-			/* Assign point color from intensity: */
-			for(int j=0;j<3;++j)
-				c[j]=float(intensity);
+			unsigned int classBit=0x1U<<(rPtr[classOffset]&0x1fU);
+			if(classMask&classBit)
+				{
+				/* Decode the point position: */
+				for(int j=0;j<3;++j)
+					(*pPtr)[j]=double(getLasInt(rPtr+j*sizeof(int)))*header.scale[j];
+				
+				if(header.haveRgb())
+					{
+					/* Assign point color from stored RGB data: */
+					for(int j=0;j<3;++j)
+						(*cPtr)[j]=float(getLasUShort(rPtr+colorOffset+j*sizeof(unsigned short)));
+					}
+				else
+					{
+					/* Assign point color from intensity: */
+					float intensity=float(getLasUShort(rPtr+3*sizeof(int)));
+					for(int j=0;j<3;++j)
+						(*cPtr)[j]=intensity;
+					}
+				
+				++pPtr;
+				++cPtr;
+				}
 			}
 		
-		/* Skip any extra data at the end of the point record: */
-		file->skip<char>(skipToEnd);
+		/* Store the block's points: */
+		pa.addPoints(pPtr-blockPoints.getArray(),blockPoints.getArray(),blockColors.getArray());
 		
-		if(classMask&classBit)
+		numRecordsLeft-=numRecords;
+		}
+	
+	/* Reset the point accumulator's point offset: */
+	pa.setPointOffset(originalPointOffset);
+	}
+
+class LazPointLoader:public LazReader::BlockConsumer // Helper class to store blocks of decompressed LAZ point records in a point accumulator
+	{
+	/* Elements: */
+	private:
+	PointAccumulator& pa; // Accumulator for 3D points
+	double scale[3]; // Scale factors from integer to model coordinates
+	unsigned int classMask; // Bit mask of point classes to store
+	bool rgb; // Flag whether to assign point colors from stored RGB data instead of intensities
+	std::vector<PointAccumulator::Point> points; // Buffer for converted point positions
+	std::vector<PointAccumulator::Color> colors; // Buffer for converted point colors
+	
+	/* Constructors and destructors: */
+	public:
+	LazPointLoader(PointAccumulator& sPa,const LazReader& reader,unsigned int sClassMask)
+		:pa(sPa),classMask(sClassMask),rgb(reader.hasRgb())
+		{
+		for(int i=0;i<3;++i)
+			scale[i]=reader.getScale()[i];
+		}
+	
+	/* Methods from class LazReader::BlockConsumer: */
+	virtual void consumeBlock(const LazReader::PointRecord* records,size_t numRecords)
+		{
+		/* Convert all point records whose classification passes the class mask: */
+		points.resize(numRecords);
+		colors.resize(numRecords);
+		size_t numPoints=0;
+		for(size_t i=0;i<numRecords;++i)
 			{
-			/* Store the point: */
-			pa.addPoint(p,c);
+			const LazReader::PointRecord& r=records[i];
+			if(classMask&(0x1U<<(r.classification&0x1fU)))
+				{
+				for(int j=0;j<3;++j)
+					points[numPoints][j]=double(r.position[j])*scale[j];
+				for(int j=0;j<3;++j)
+					colors[numPoints][j]=float(rgb?r.rgb[j]:r.intensity);
+				++numPoints;
+				}
 			}
+		
+		/* Store the block's points: */
+		if(numPoints>0)
+			pa.addPoints(numPoints,&points[0],&colors[0]);
 		}
+	};
+
+void loadPointFileLaz(PointAccumulator& pa,const char* fileName,unsigned int classMask,unsigned int numThreads)
+	{
+	/* Open the LAZ input file: */
+	LazReader reader(fileName);
+	
+	/* Apply the LAZ offset to the point accumulator's point offset: */
+	PointAccumulator::Vector originalPointOffset=pa.getPointOffset();
+	pa.setPointOffset(originalPointOffset+PointAccumulator::Vector(reader.getOffset()));
+	
+	/* Read all points: */
+	LazPointLoader loader(pa,reader,classMask);
+	reader.readPoints(numThreads,loader);
 	
 	/* Reset the point accumulator's point offset: */
 	pa.setPointOffset(originalPointOffset);
 	}
 
-void loadPointFileXyzi(PointAccumulator& pa,const char* fileName)
+class AsciiPointLoader:public AsciiPointReader::LineConsumer // Helper class to store parsed ASCII point records in a point accumulator
 	{
+	/* Elements: */
+	private:
+	PointAccumulator& pa; // Accumulator for 3D points
+	bool rgb; // Flag whether to assign point colors from the records' RGB components instead of their intensity component
+	std::vector<PointAccumulator::Point> points; // Buffer for converted point positions
+	std::vector<PointAccumulator::Color> colors; // Buffer for converted point colors
+	
+	/* Constructors and destructors: */
+	public:
+	AsciiPointLoader(PointAccumulator& sPa,bool sRgb)
+		:pa(sPa),rgb(sRgb)
+		{
+		}
+	
+	/* Methods from class AsciiPointReader::LineConsumer: */
+	virtual void consumeLines(const double* values,size_t numLines)
+		{
+		/* Convert all records of (x, y, z, intensity or r, g, b): */
+		points.resize(numLines);
+		colors.resize(numLines);
+		const double* vPtr=values;
+		for(size_t i=0;i<numLines;++i,vPtr+=6)
+			{
+			points[i]=PointAccumulator::Point(vPtr);
+			for(int j=0;j<3;++j)
+				colors[i][j]=float(vPtr[rgb?3+j:3]);
+			}
+		
+		/* Store the block's points: */
+		if(numLines>0)
+			pa.addPoints(numLines,&points[0],&colors[0]);
+		}
+	};
+
+bool loadPointFileParallelASCII(PointAccumulator& pa,const char* fileName,int numHeaderLines,bool strictCsv,bool rgb,const int columnIndices[6],unsigned int numThreads) // Parses an ASCII point file on multiple threads; returns false if the file can not be mapped into memory
+	{
+	if(!AsciiPointReader::canRead(fileName))
+		return false;
+	
+	/* Read (x, y, z, intensity or r, g, b) records, with full intensity or white for missing color columns: */
+	static const double componentDefaults[6]={0.0,0.0,0.0,255.0,255.0,255.0};
+	AsciiPointReader reader(fileName,6,columnIndices,componentDefaults,numHeaderLines,strictCsv);
+	AsciiPointLoader loader(pa,rgb);
+	reader.readLines(numThreads,loader);
+	
+	return true;
+	}
+
+void loadPointFileXyzi(PointAccumulator& pa,const char* fileName,unsigned int numThreads)
+	{
+	/* Parse the file on multiple threads if possible: */
+	static const int columnIndices[6]={0,1,2,3,-1,-1};
+	if(loadPointFileParallelASCII(pa,fileName,0,false,false,columnIndices,numThreads))
+		return;
+	
 	/* Open the ASCII input file: */
 	IO::ValueSource reader(new IO::ReadAheadFilter(IO::openFile(fileName)));
 	reader.setPunctuation('#',true);
@@ -529,6 +709,7 @@ void loadPointFileXyzi(PointAccumulator& pa,const char* fileName)
 	reader.skipWs();
 	
 	/* Read all lines from the input file: */
+	PointAccumulator::Batch batch(pa);
 	size_t lineNumber=1;
 	while(!reader.eof())
 		{
@@ -545,7 +726,7 @@ void loadPointFileXyzi(PointAccumulator& pa,const char* fileName)
 				PointAccumulator::Color c(intensity,intensity,intensity);
 				
 				/* Store the point: */
-				pa.addPoint(p,c);
+				batch.addPoint(p,c);
 				}
 			catch(const IO::ValueSource::NumberError& err)
 				{
@@ -558,10 +739,16 @@ void loadPointFileXyzi(PointAccumulator& pa,const char* fileName)
 		++lineNumber;
 		reader.skipWs();
 		}
+	batch.flush();
 	}
 
-void loadPointFileXyzrgb(PointAccumulator& pa,const char* fileName)
+void loadPointFileXyzrgb(PointAccumulator& pa,const char* fileName,unsigned int numThreads)
 	{
+	/* Parse the file on multiple threads if possible: */
+	static const int columnIndices[6]={0,1,2,3,4,5};
+	if(loadPointFileParallelASCII(pa,fileName,0,false,true,columnIndices,numThreads))
+		return;
+	
 	/* Open the ASCII input file: */
 	IO::ValueSource reader(new IO::ReadAheadFilter(IO::openFile(fileName)));
 	reader.setPunctuation('#',true);
@@ -569,6 +756,7 @@ void loadPointFileXyzrgb(PointAccumulator& pa,const char* fileName)
 	reader.skipWs();
 	
 	/* Read all lines from the input file: */
+	PointAccumulator::Batch batch(pa);
 	size_t lineNumber=1;
 	while(!reader.eof())
 		{
@@ -586,7 +774,7 @@ void loadPointFileXyzrgb(PointAccumulator& pa,const char* fileName)
 					c[i]=float(reader.readNumber());
 				
 				/* Store the point: */
-				pa.addPoint(p,c);
+				batch.addPoint(p,c);
 				}
 			catch(const IO::ValueSource::NumberError& err)
 				{
@@ -599,10 +787,15 @@ void loadPointFileXyzrgb(PointAccumulator& pa,const char* fileName)
 		++lineNumber;
 		reader.skipWs();
 		}
+	batch.flush();
 	}
 
-void loadPointFileGenericASCII(PointAccumulator& pa,const char* fileName,int numHeaderLines,bool strictCsv,bool rgb,const int columnIndices[6])
+void loadPointFileGenericASCII(PointAccumulator& pa,const char* fileName,int numHeaderLines,bool strictCsv,bool rgb,const int columnIndices[6],unsigned int numThreads)
 	{
+	/* Parse the file on multiple threads if possible: */
+	if(loadPointFileParallelASCII(pa,fileName,numHeaderLines,strictCsv,rgb,columnIndices,numThreads))
+		return;
+	
 	/* Create the mapping from column indices to point components: */
 	int maxColumnIndex=columnIndices[0];
 	for(int i=1;i<6;++i)
@@ -653,6 +846,7 @@ void loadPointFileGenericASCII(PointAccumulator& pa,const char* fileName,int num
 		}
 	
 	/* Read all lines from the input file: */
+	PointAccumulator::Batch batch(pa);
 	try
 		{
 		while(!reader.eof())
@@ -697,7 +891,7 @@ void loadPointFileGenericASCII(PointAccumulator& pa,const char* fileName,int num
 					}
 				
 				/* Store the point: */
-				pa.addPoint(p,c);
+				batch.addPoint(p,c);
 				}
 			
 			/* Skip to the next line: */
@@ -710,6 +904,7 @@ void loadPointFileGenericASCII(PointAccumulator& pa,const char* fileName,int num
 		{
 		std::cerr<<"Caught exception "<<err.what()<<" in line "<<lineNumber<<" in input file "<<fileName<<std::endl;
 		}
+	batch.flush();
 	
 	/* Clean up: */
 	delete[] componentColumnIndices;
@@ -750,6 +945,7 @@ void loadPointFileBlockedASCII(PointAccumulator& pa,const char* fileName,int num
 		}
 	
 	/* Read all lines from the input file: */
+	PointAccumulator::Batch batch(pa);
 	try
 		{
 		while(!reader.eof())
@@ -801,7 +997,7 @@ void loadPointFileBlockedASCII(PointAccumulator& pa,const char* fileName,int num
 					}
 				
 				/* Store the point: */
-				pa.addPoint(p,c);
+				batch.addPoint(p,c);
 				
 				/* Skip to the next line: */
 				reader.skipLine();
@@ -814,6 +1010,7 @@ void loadPointFileBlockedASCII(PointAccumulator& pa,const char* fileName,int num
 		{
 		std::cerr<<"Caught exception "<<err.what()<<" in line "<<lineNumber<<" in input file "<<fileName<<std::endl;
 		}
+	batch.flush();
 	
 	/* Clean up: */
 	delete[] componentColumnIndices;
@@ -949,6 +1146,7 @@ void loadPointFileIdl(PointAccumulator& pa,const char* fileName)
 	/* Read all records: */
 	float massMin=Math::Constants<float>::max;
 	float massMax=Math::Constants<float>::min;
+	PointAccumulator::Batch batch(pa);
 	for(size_t i=0;i<numRecords;++i)
 		{
 		/* Read the next record: */
@@ -984,9 +1182,10 @@ void loadPointFileIdl(PointAccumulator& pa,const char* fileName)
 		// if(record.recordType==0)
 			{
 			/* Store the point: */
-			pa.addPoint(p,c);
+			batch.addPoint(p,c);
 			}
 		}
+	batch.flush();
 	
 	std::cout<<"mVir range: "<<massMin<<" - "<<massMax<<std::endl;
 	}
@@ -1043,7 +1242,7 @@ struct OldLidarOctreeFileNode // Structure for a node in a LiDAR octree file
 		}
 	};
 
-void readOctreeFileSubtree(PointAccumulator& pa,IO::SeekableFile& octFile,IO::SeekableFile& obinFile)
+void readOctreeFileSubtree(PointAccumulator::Batch& batch,IO::SeekableFile& octFile,IO::SeekableFile& obinFile)
 	{
 	/* Read the node's header from the octree file: */
 	OldLidarOctreeFileNode ofn(octFile);
@@ -1055,7 +1254,7 @@ void readOctreeFileSubtree(PointAccumulator& pa,IO::SeekableFile& octFile,IO::Se
 		for(int childIndex=0;childIndex<8;++childIndex,childOffset+=OldLidarOctreeFileNode::getSize())
 			{
 			octFile.setReadPosAbs(childOffset);
-			readOctreeFileSubtree(pa,octFile,obinFile);
+			readOctreeFileSubtree(batch,octFile,obinFile);
 			}
 		}
 	else if(ofn.numPoints>0)
@@ -1067,7 +1266,7 @@ void readOctreeFileSubtree(PointAccumulator& pa,IO::SeekableFile& octFile,IO::Se
 			LidarPoint p;
 			obinFile.read(p.getComponents(),3);
 			obinFile.read(p.value.getRgba(),4);
-			pa.addPoint(PointAccumulator::Point(p.getComponents()),PointAccumulator::Color(p.value.getRgba()));
+			batch.addPoint(PointAccumulator::Point(p.getComponents()),PointAccumulator::Color(p.value.getRgba()));
 			}
 		}
 	}
@@ -1088,7 +1287,9 @@ void loadPointFileOctree(PointAccumulator& pa,const char* fileNameStem)
 	OldLidarOctreeFileHeader ofh(*octFile);
 	
 	/* Read all original points from the octree: */
-	readOctreeFileSubtree(pa,*octFile,*obinFile);
+	PointAccumulator::Batch batch(pa);
+	readOctreeFileSubtree(batch,*octFile,*obinFile);
+	batch.flush();
 	}
 
 /*****************************************************
@@ -1099,12 +1300,12 @@ class LidarFileLoader
 	{
 	/* Elements: */
 	private:
-	PointAccumulator& pa;
+	PointAccumulator::Batch batch;
 	
 	/* Constructors and destructors: */
 	public:
 	LidarFileLoader(PointAccumulator& sPa)
-		:pa(sPa)
+		:batch(sPa)
 		{
 		}
 	
@@ -1118,10 +1319,14 @@ class LidarFileLoader
 			for(unsigned int i=0;i<node.getNumPoints();++i)
 				{
 				LidarPoint p=node[i];
-				pa.addPoint(PointAccumulator::Point(p.getComponents()),PointAccumulator::Color(p.value.getRgba()));
+				batch.addPoint(PointAccumulator::Point(p.getComponents()),PointAccumulator::Color(p.value.getRgba()));
 				}
 			}
 		}
+	void flush(void)
+		{
+		batch.flush();
+		}
 	};
 
 
@@ -1131,6 +1336,7 @@ void loadLidarFile(PointAccumulator& pa,const char* lidarFileName)
 	LidarProcessOctree lpo(lidarFileName,size_t(64)*size_t(1024)*size_t(1024));
 	LidarFileLoader lfl(pa);
 	lpo.processNodesPostfix(lfl);
+	lfl.flush();
 	}
 
 /**************
@@ -1146,6 +1352,7 @@ enum PointFileType // Enumerated type for point file formats
 	BINRGB, // Simple binary format: number of points followed by (x, y, z, r, g, b) tuples
 	PLY, // File in standard PLY format; only reads vertex positions and colors
 	LAS, // Standard binary LiDAR point cloud interchange format
+	LAZ, // LAS file compressed with LASzip
 	XYZI, // Simple ASCII format: rows containing space-separated (x, y, z, i) tuples
 	XYZRGB, // Simple ASCII format: rows containing space-separated (x, y, z, r, g, b) tuples
 	ASCII, // Generic ASCII format with intensity data
@@ -1192,15 +1399,700 @@ bool readColumnIndexMask(int argc,char* argv[],int& argi,int columnIndices[6])
 	return columnIndices[0]>=0&&columnIndices[1]>=0&&columnIndices[2]>=0;
 	}
 
+std::vector<std::string> getTempFileNameTemplates(const std::vector<std::string>& fileNameStems)
+	{
+	/* Append the mkstemp pattern to all file name stems: */
+	std::vector<std::string> result;
+	for(std::vector<std::string>::const_iterator fnsIt=fileNameStems.begin();fnsIt!=fileNameStems.end();++fnsIt)
+		result.push_back(*fnsIt+"XXXXXX");
+	return result;
+	}
+
+PointAccumulator::Vector readCatalogPointOffset(const char* catalogFileName)
+	{
+	/* Open the catalog file written by CalcLasRange: */
+	IO::ValueSource catalog(IO::openFile(catalogFileName));
+	catalog.setPunctuation('#',true);
+	catalog.setPunctuation('\n',true);
+	catalog.skipWs();
+	
+	/* Merge the bounding boxes of all catalog entries: */
+	double bbox[6];
+	for(int i=0;i<3;++i)
+		{
+		bbox[i]=Math::Constants<double>::max;
+		bbox[3+i]=Math::Constants<double>::min;
+		}
+	size_t numEntries=0;
+	while(!catalog.eof())
+		{
+		/* Check for comment or empty lines: */
+		if(catalog.peekc()!='#'&&catalog.peekc()!='\n')
+			{
+			/* Skip the number of points and the scan mode: */
+			catalog.readNumber();
+			catalog.readString();
+			
+			/* Read the entry's bounding box: */
+			for(int i=0;i<6;++i)
+				{
+				double value=catalog.readNumber();
+				if(i<3?bbox[i]>value:bbox[i]<value)
+					bbox[i]=value;
+				}
+			++numEntries;
+			}
+		
+		/* Skip the rest of the line: */
+		catalog.skipLine();
+		catalog.skipWs();
+		}
+	if(numEntries==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Catalog file %s has no entries",catalogFileName);
+	
+	/* Return the offset that moves the bounding box's center to the origin: */
+	PointAccumulator::Vector result;
+	for(int i=0;i<3;++i)
+		result[i]=-Math::mid(bbox[i],bbox[3+i]);
+	return result;
+	}
+
+struct InputFile // Structure describing an input file and the settings in effect when it was named on the command line
+	{
+	/* Elements: */
+	public:
+	const char* fileName; // Name of the input file
+	PointFileType pointFileType; // Format of the input file
+	unsigned int tiffImageIndex; // Index of the image to read from TIFF files
+	int asciiColumnIndices[6]; // Column indices for ASCII files
+	unsigned int lasClassMask; // Bit mask of LAS point classes to read
+	int numHeaderLines; // Number of header lines to skip in ASCII files
+	unsigned int numParserThreads; // Number of threads decompressing LAZ files or parsing ASCII files
+	const char* plyColorNames[3]; // Names of color components in PLY files
+	PointAccumulator::Vector pointOffset; // Point offset applied to the file's points
+	bool haveTransform; // Flag whether a transformation is applied to the file's points
+	PointAccumulator::ATransform transform; // Transformation applied to the file's points
+	float colorMask[3]; // Color mask applied to the file's points
+	};
+
+const char* getPointFileTypeName(PointFileType pointFileType)
+	{
+	switch(pointFileType)
+		{
+		case TIFFDEM:
+			return "TIFF";
+		
+		case XYZBIL:
+			return "XYZ BIL";
+		
+		case BIN:
+		case LAS:
+			return "binary";
+		
+		case LAZ:
+			return "LAZ";
+		
+		case BINRGB:
+			return "RGB binary";
+		
+		case PLY:
+			return "PLY";
+		
+		case XYZI:
+			return "XYZI";
+		
+		case XYZRGB:
+			return "XYZRGB";
+		
+		case ASCII:
+			return "generic ASCII";
+		
+		case ASCIIRGB:
+			return "generic RGB ASCII";
+		
+		case CSV:
+			return "generic CSV";
+		
+		case CSVRGB:
+			return "generic RGB CSV";
+		
+		case BLOCKEDASCII:
+			return "blocked ASCII";
+		
+		case BLOCKEDASCIIRGB:
+			return "blocked RGB ASCII";
+		
+		case IDL:
+			return "redshift IDL";
+		
+		case OCTREE:
+			return "LiDAR octree";
+		
+		case LIDAR:
+			return "LiDAR";
+		
+		default:
+			return "unrecognized";
+		}
+	}
+
+bool loadInputFile(PointAccumulator& pa,const InputFile& inputFile)
+	{
+	const char* fileName=inputFile.fileName;
+	switch(inputFile.pointFileType)
+		{
+		case TIFFDEM:
+			{
+			TIFFDEMLoader tiff(pa,fileName,inputFile.tiffImageIndex);
+			tiff.collectPoints();
+			return true;
+			}
+		
+		case XYZBIL:
+			loadXYZBILImage(pa,fileName);
+			return true;
+		
+		case BIN:
+			loadPointFileBin(pa,fileName);
+			return true;
+		
+		case BINRGB:
+			loadPointFileBinRgb(pa,fileName);
+			return true;
+		
+		case PLY:
+			{
+			const char* plyColorNames[3];
+			for(int i=0;i<3;++i)
+				plyColorNames[i]=inputFile.plyColorNames[i];
+			readPlyFile(pa,fileName,plyColorNames);
+			return true;
+			}
+		
+		case LAS:
+			loadPointFileLas(pa,fileName,inputFile.lasClassMask);
+			return true;
+		
+		case LAZ:
+			loadPointFileLaz(pa,fileName,inputFile.lasClassMask,inputFile.numParserThreads);
+			return true;
+		
+		case XYZI:
+			loadPointFileXyzi(pa,fileName,inputFile.numParserThreads);
+			return true;
+		
+		case XYZRGB:
+			loadPointFileXyzrgb(pa,fileName,inputFile.numParserThreads);
+			return true;
+		
+		case ASCII:
+			loadPointFileGenericASCII(pa,fileName,inputFile.numHeaderLines,false,false,inputFile.asciiColumnIndices,inputFile.numParserThreads);
+			return true;
+		
+		case ASCIIRGB:
+			loadPointFileGenericASCII(pa,fileName,inputFile.numHeaderLines,false,true,inputFile.asciiColumnIndices,inputFile.numParserThreads);
+			return true;
+		
+		case CSV:
+			loadPointFileGenericASCII(pa,fileName,inputFile.numHeaderLines,true,false,inputFile.asciiColumnIndices,inputFile.numParserThreads);
+			return true;
+		
+		case CSVRGB:
+			loadPointFileGenericASCII(pa,fileName,inputFile.numHeaderLines,true,true,inputFile.asciiColumnIndices,inputFile.numParserThreads);
+			return true;
+		
+		case BLOCKEDASCII:
+			loadPointFileBlockedASCII(pa,fileName,inputFile.numHeaderLines,false,inputFile.asciiColumnIndices);
+			return true;
+		
+		case BLOCKEDASCIIRGB:
+			loadPointFileBlockedASCII(pa,fileName,inputFile.numHeaderLines,true,inputFile.asciiColumnIndices);
+			return true;
+		
+		case IDL:
+			loadPointFileIdl(pa,fileName);
+			return true;
+		
+		case OCTREE:
+			loadPointFileOctree(pa,fileName);
+			return true;
+		
+		case LIDAR:
+			loadLidarFile(pa,fileName);
+			return true;
+		
+		default:
+			return false;
+		}
+	}
+
+class ParallelIngester // Helper class to load queued input files into per-thread point accumulators
+	{
+	/* Elements: */
+	private:
+	const std::vector<InputFile>& inputFiles; // List of queued input files
+	Threads::Atomic<unsigned int> nextInputFileIndex; // Index of the next input file to be loaded by any reader thread
+	std::vector<PointAccumulator*> accumulators; // Private point accumulator for each reader thread
+	unsigned int threadNumParserThreads; // Maximum number of threads each reader thread uses to decompress LAZ files or parse ASCII files
+	Threads::Mutex outputMutex; // Mutex serializing progress output
+	Threads::Atomic<unsigned int> numErrors; // Number of input files that could not be loaded
+	
+	/* Private methods: */
+	void* readerThreadMethod(unsigned int threadIndex) // Loads input files into the given thread's point accumulator until all input files are taken
+		{
+		PointAccumulator& pa=*accumulators[threadIndex];
+		while(true)
+			{
+			/* Grab the next input file: */
+			unsigned int inputFileIndex=nextInputFileIndex.preAdd(1U)-1U;
+			if(inputFileIndex>=inputFiles.size())
+				break;
+			InputFile inputFile=inputFiles[inputFileIndex];
+			
+			/* Share the parser threads between the reader threads: */
+			if(inputFile.numParserThreads>threadNumParserThreads)
+				inputFile.numParserThreads=threadNumParserThreads;
+			
+			/* Apply the settings that were in effect when the input file was named: */
+			pa.setPointOffset(inputFile.pointOffset);
+			if(inputFile.haveTransform)
+				pa.setTransform(inputFile.transform);
+			else
+				pa.resetTransform();
+			pa.setColorMask(inputFile.colorMask);
+			pa.resetExtents();
+			
+			/* Load the input file: */
+			try
+				{
+				loadInputFile(pa,inputFile);
+				
+				/* Print the spatial and color extents of the just-read input file: */
+				Threads::Mutex::Lock outputLock(outputMutex);
+				std::cout<<"Processed "<<getPointFileTypeName(inputFile.pointFileType)<<" input file "<<inputFile.fileName<<std::endl;
+				pa.printExtents();
+				}
+			catch(const std::runtime_error& err)
+				{
+				numErrors.preAdd(1U);
+				Threads::Mutex::Lock outputLock(outputMutex);
+				std::cerr<<"Unable to read input file "<<inputFile.fileName<<" due to exception "<<err.what()<<std::endl;
+				}
+			}
+		
+		/* Write the thread's leftover in-memory points into another temporary octree: */
+		try
+			{
+			pa.finishReading();
+			}
+		catch(const std::runtime_error& err)
+			{
+			numErrors.preAdd(1U);
+			Threads::Mutex::Lock outputLock(outputMutex);
+			std::cerr<<"Unable to write temporary octree due to exception "<<err.what()<<std::endl;
+			}
+		
+		return 0;
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	ParallelIngester(const std::vector<InputFile>& sInputFiles)
+		:inputFiles(sInputFiles),nextInputFileIndex(0U),threadNumParserThreads(1U),numErrors(0U)
+		{
+		}
+	~ParallelIngester(void)
+		{
+		/* Delete all remaining per-thread point accumulators and their temporary octrees: */
+		for(std::vector<PointAccumulator*>::iterator aIt=accumulators.begin();aIt!=accumulators.end();++aIt)
+			delete *aIt;
+		}
+	
+	/* Methods: */
+	bool ingest(PointAccumulator& pa,unsigned int numReaderThreads,size_t memoryCacheSize,unsigned int tempOctreeMaxNumPointsPerNode,const std::vector<std::string>& tempOctreeFileNameTemplates,unsigned int numTempOctreeThreads) // Loads all queued input files using the given number of threads, which share the given number of temporary octree and parser threads, and hands the resulting temporary octrees to the given point accumulator; returns false if any input file could not be loaded
+		{
+		/* Write any points read before the parallel reader was selected and release the main point accumulator's buffers, so that the reader threads can share the entire memory cache: */
+		pa.finishReading();
+		
+		/* Split the memory cache between the reader threads: */
+		size_t threadMemoryCacheSize=memoryCacheSize/numReaderThreads;
+		if(threadMemoryCacheSize<1)
+			threadMemoryCacheSize=1;
+		unsigned int threadNumTempOctreeThreads=numTempOctreeThreads/numReaderThreads;
+		threadNumParserThreads=numTempOctreeThreads/numReaderThreads;
+		if(threadNumParserThreads<1U)
+			threadNumParserThreads=1U;
+		for(unsigned int i=0;i<numReaderThreads;++i)
+			{
+			PointAccumulator* threadPa=new PointAccumulator;
+			threadPa->setMemorySize(threadMemoryCacheSize,tempOctreeMaxNumPointsPerNode);
+			threadPa->setTempOctreeFileNameTemplates(tempOctreeFileNameTemplates,i);
+			threadPa->setNumTempOctreeThreads(threadNumTempOctreeThreads);
+			accumulators.push_back(threadPa);
+			}
+		
+		/* Run the reader threads: */
+		std::cout<<"Reading "<<inputFiles.size()<<" input files using "<<numReaderThreads<<" threads"<<std::endl;
+		Threads::Thread* readerThreads=new Threads::Thread[numReaderThreads];
+		for(unsigned int i=0;i<numReaderThreads;++i)
+			readerThreads[i].start(this,&ParallelIngester::readerThreadMethod,i);
+		for(unsigned int i=0;i<numReaderThreads;++i)
+			readerThreads[i].join();
+		delete[] readerThreads;
+		
+		/* Move all per-thread temporary octrees into the main point accumulator: */
+		std::vector<TempOctree*>& tempOctrees=pa.getTempOctrees();
+		for(std::vector<PointAccumulator*>::iterator aIt=accumulators.begin();aIt!=accumulators.end();++aIt)
+			{
+			std::vector<TempOctree*>& threadTempOctrees=(*aIt)->getTempOctrees();
+			tempOctrees.insert(tempOctrees.end(),threadTempOctrees.begin(),threadTempOctrees.end());
+			threadTempOctrees.clear();
+			}
+		
+		return numErrors.get()==0U;
+		}
+	};
+
+inline double getLasDouble(const unsigned char* bytes) // Decodes a little-endian 64-bit floating-point number from a LAS point record
+	{
+	Misc::UInt64 bits=0;
+	for(int i=7;i>=0;--i)
+		bits=(bits<<8)|Misc::UInt64(bytes[i]);
+	double result;
+	memcpy(&result,&bits,sizeof(double));
+	return result;
+	}
+
+struct LasPointAttributes // Structure for the attributes of a LAS point record that are stored in attribute channels
+	{
+	/* Elements: */
+	public:
+	LidarIntensity intensity; // Return intensity
+	LidarClassification classification; // Point class
+	LidarReturnInfo returnInfo; // Return number and number of returns of the pulse
+	LidarGpsTime gpsTime; // GPS time of the pulse, or zero if the point record format does not contain times
+	};
+
+class LasAttributeMatcher // Helper class to copy the attributes of a LAS point record to all octree points at the record's position
+	{
+	/* Elements: */
+	private:
+	LidarProcessOctree& lpo; // The octree created from the input files
+	LidarAttributeWriter& intensities; // Channel receiving return intensities
+	LidarAttributeWriter& classifications; // Channel receiving point classes
+	LidarAttributeWriter& returnInfos; // Channel receiving return numbers
+	LidarAttributeWriter* gpsTimes; // Channel receiving GPS times, or 0 if no input file contains times
+	Point queryPoint; // Position of the current point record in octree coordinates
+	LasPointAttributes attributes; // Attributes of the current point record
+	LidarProcessOctree::Node* node; // Octree node whose points are currently searched
+	size_t numMatchedPoints; // Number of octree points that received attributes
+	
+	/* Constructors and destructors: */
+	public:
+	LasAttributeMatcher(LidarProcessOctree& sLpo,LidarAttributeWriter& sIntensities,LidarAttributeWriter& sClassifications,LidarAttributeWriter& sReturnInfos,LidarAttributeWriter* sGpsTimes)
+		:lpo(sLpo),
+		 intensities(sIntensities),classifications(sClassifications),returnInfos(sReturnInfos),gpsTimes(sGpsTimes),
+		 node(0),numMatchedPoints(0)
+		{
+		}
+	
+	/* Methods: */
+	size_t match(const Point& newQueryPoint,const LasPointAttributes& newAttributes) // Copies the given attributes to all octree points at the given position; returns the number of matching points
+		{
+		queryPoint=newQueryPoint;
+		attributes=newAttributes;
+		size_t numMatchedBefore=numMatchedPoints;
+		lpo.processNodesOnPath(queryPoint,*this);
+		return numMatchedPoints-numMatchedBefore;
+		}
+	void operator()(LidarProcessOctree::Node& newNode,unsigned int nodeLevel) // Searches the points of a node containing the query position
+		{
+		node=&newNode;
+		lpo.processNodePointsDirected(node,*this);
+		}
+	const Point& getQueryPoint(void) const
+		{
+		return queryPoint;
+		}
+	Scalar getQueryRadius2(void) const
+		{
+		/* Subsampling copies points, so all copies of the point record are exactly at the query position: */
+		return Scalar(0);
+		}
+	void operator()(const LidarPoint& point) // Copies the current attributes to the records of the given point of the current node
+		{
+		LidarFile::Offset recordIndex=node->getDataOffset()+LidarFile::Offset(&point-node->getPoints());
+		*intensities.getRecords<LidarIntensity>(recordIndex)=attributes.intensity;
+		*classifications.getRecords<LidarClassification>(recordIndex)=attributes.classification;
+		*returnInfos.getRecords<LidarReturnInfo>(recordIndex)=attributes.returnInfo;
+		if(gpsTimes!=0)
+			*gpsTimes->getRecords<LidarGpsTime>(recordIndex)=attributes.gpsTime;
+		++numMatchedPoints;
+		}
+	size_t getNumMatchedPoints(void) const // Returns the total number of octree points that received attributes
+		{
+		return numMatchedPoints;
+		}
+	};
+
+void writeLasAttributes(const char* lidarFileName,const std::vector<InputFile>& inputFiles,LidarFile::Offset numRecords,unsigned int memoryCacheSize) // Writes the intensities, classes, return numbers, and GPS times of all points read from LAS input files into attribute channels of the given newly-created LiDAR file
+	{
+	/* Check which attributes the LAS input files contain: */
+	bool haveLasFiles=false;
+	bool haveTimes=false;
+	for(std::vector<InputFile>::const_iterator ifIt=inputFiles.begin();ifIt!=inputFiles.end();++ifIt)
+		if(ifIt->pointFileType==LAS)
+			{
+			IO::FilePtr file(IO::openFile(ifIt->fileName));
+			file->setEndianness(Misc::LittleEndian);
+			LasFileHeader header;
+			if(readLasFileHeader(*file,ifIt->fileName,header))
+				{
+				haveLasFiles=true;
+				if(header.haveTime())
+					haveTimes=true;
+				}
+			}
+	if(!haveLasFiles)
+		{
+		std::cout<<"No LAS input files; not writing attribute channels"<<std::endl;
+		return;
+		}
+	
+	/* Create the attribute channels; records of points that did not come from LAS files remain zero: */
+	LidarAttributeWriter intensities(lidarFileName,"Intensity",sizeof(LidarIntensity),numRecords);
+	LidarAttributeWriter classifications(lidarFileName,"Classification",sizeof(LidarClassification),numRecords);
+	LidarAttributeWriter returnInfos(lidarFileName,"ReturnInfo",sizeof(LidarReturnInfo),numRecords);
+	LidarAttributeWriter* gpsTimes=haveTimes?new LidarAttributeWriter(lidarFileName,"GpsTime",sizeof(LidarGpsTime),numRecords):0;
+	
+	/* Open the new octree to find the octree points belonging to each LAS point record: */
+	LidarProcessOctree lpo(lidarFileName,size_t(memoryCacheSize)*size_t(1024*1024));
+	LasAttributeMatcher matcher(lpo,intensities,classifications,returnInfos,gpsTimes);
+	
+	/* Process all LAS input files: */
+	size_t numUnmatchedRecords=0;
+	for(std::vector<InputFile>::const_iterator ifIt=inputFiles.begin();ifIt!=inputFiles.end();++ifIt)
+		{
+		if(ifIt->pointFileType!=LAS)
+			continue;
+		
+		/* Open the LAS input file: */
+		IO::FilePtr file(new IO::ReadAheadFilter(IO::openFile(ifIt->fileName)));
+		file->setEndianness(Misc::LittleEndian);
+		LasFileHeader header;
+		if(!readLasFileHeader(*file,ifIt->fileName,header))
+			continue;
+		std::cout<<"Writing attributes of LAS file "<<ifIt->fileName<<"..."<<std::flush;
+		
+		/* Apply the same point offset and transformation as when the file was read: */
+		PointAccumulator::Vector fileOffset=ifIt->pointOffset+header.offset;
+		const size_t timeOffset=20; // Byte offset of the (optional) GPS time
+		
+		/* Read point records in large blocks and decode them directly from the block buffer: */
+		const size_t blockSize=65536; // Number of point records per block
+		Misc::SelfDestructArray<unsigned char> recordBuffer(blockSize*header.pointDataRecordLength);
+		for(size_t numRecordsLeft=header.numPointRecords;numRecordsLeft>0;)
+			{
+			/* Read the next block of point records: */
+			size_t numRecords=numRecordsLeft<blockSize?numRecordsLeft:blockSize;
+			file->read(recordBuffer.getArray(),numRecords*header.pointDataRecordLength);
+			
+			/* Match all point records whose classification passed the class mask: */
+			const unsigned char* rPtr=recordBuffer.getArray();
+			for(size_t i=0;i<numRecords;++i,rPtr+=header.pointDataRecordLength)
+				if(ifIt->lasClassMask&(0x1U<<(rPtr[15]&0x1fU)))
+					{
+					/* Calculate the point's position exactly as PointAccumulator does: */
+					PointAccumulator::Point p;
+					for(int j=0;j<3;++j)
+						p[j]=double(getLasInt(rPtr+j*sizeof(int)))*header.scale[j];
+					PointAccumulator::Point pt=p+fileOffset;
+					if(ifIt->haveTransform)
+						pt=ifIt->transform.transform(pt);
+					
+					/* Decode the point's attributes: */
+					LasPointAttributes attributes;
+					attributes.intensity=getLasUShort(rPtr+3*sizeof(int));
+					attributes.classification=rPtr[15]&0x1fU;
+					attributes.returnInfo=packReturnInfo(rPtr[14]&0x07U,(rPtr[14]>>3)&0x07U);
+					attributes.gpsTime=header.haveTime()?getLasDouble(rPtr+timeOffset):0.0;
+					
+					/* Copy the attributes to the octree points created from the point record: */
+					if(matcher.match(Point(pt),attributes)==0)
+						++numUnmatchedRecords;
+					}
+			
+			numRecordsLeft-=numRecords;
+			}
+		std::cout<<" done"<<std::endl;
+		}
+	std::cout<<"Assigned attributes to "<<matcher.getNumMatchedPoints()<<" of "<<numRecords<<" octree points";
+	if(numUnmatchedRecords>0)
+		std::cout<<"; "<<numUnmatchedRecords<<" LAS point records were outside the octree";
+	std::cout<<std::endl;
+	
+	delete gpsTimes;
+	}
+
+class NodeSummarizer // Helper class to summarize the subtrees of all octree nodes in a post-fix traversal
+	{
+	/* Elements: */
+	private:
+	LidarProcessOctree& lpo; // The processed octree
+	int classificationChannel; // Index of the octree's classification attribute channel, or -1
+	int intensityChannel; // Index of the octree's intensity attribute channel, or -1
+	std::vector<LidarNodeSummary> summaries; // Summaries of all nodes indexed by node index
+	
+	/* Constructors and destructors: */
+	public:
+	NodeSummarizer(LidarProcessOctree& sLpo)
+		:lpo(sLpo),
+		 classificationChannel(-1),intensityChannel(-1),
+		 summaries(lpo.getNumNodes())
+		{
+		/* Use the octree's attribute channels if they exist: */
+		if(lpo.hasAttributeChannel("Classification"))
+			classificationChannel=int(lpo.addAttributeChannel("Classification"));
+		if(lpo.hasAttributeChannel("Intensity"))
+			intensityChannel=int(lpo.addAttributeChannel("Intensity"));
+		}
+	
+	/* Methods: */
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
+		{
+		LidarNodeSummary& summary=summaries[node.getIndex()];
+		if(node.isLeaf())
+			{
+			/* Summarize the leaf's points; interior nodes' points are subsets of their leaves' points: */
+			if(node.getNumPoints()>0)
+				{
+				for(unsigned int i=0;i<node.getNumPoints();++i)
+					summary.addPoint(node[i]);
+				
+				if(classificationChannel>=0)
+					{
+					const LidarClassification* classes=lpo.getAttributes<LidarClassification>(node,(unsigned int)classificationChannel);
+					for(unsigned int i=0;i<node.getNumPoints();++i)
+						summary.addClassification(classes[i]);
+					}
+				else
+					summary.classMask=~Misc::UInt32(0);
+				
+				if(intensityChannel>=0)
+					{
+					const LidarIntensity* intensities=lpo.getAttributes<LidarIntensity>(node,(unsigned int)intensityChannel);
+					for(unsigned int i=0;i<node.getNumPoints();++i)
+						summary.addIntensity(intensities[i]);
+					}
+				else
+					{
+					summary.intensityRange[0]=Misc::UInt16(0U);
+					summary.intensityRange[1]=Misc::UInt16(65535U);
+					}
+				}
+			}
+		else
+			{
+			/* Merge the children's summaries, which have already been calculated: */
+			for(int childIndex=0;childIndex<8;++childIndex)
+				summary.addSummary(summaries[lpo.getChild(&node,childIndex)->getIndex()]);
+			}
+		}
+	void write(const char* lidarFileName) const // Writes all node summaries to the given LiDAR file's summaries file
+		{
+		LidarFile summariesFile(LidarNodeSummary::getFileName(lidarFileName).c_str(),IO::File::WriteOnly);
+		summariesFile.setEndianness(Misc::LittleEndian);
+		LidarDataFileHeader dfh((unsigned int)LidarNodeSummary::getFileSize());
+		dfh.write(summariesFile);
+		for(std::vector<LidarNodeSummary>::const_iterator sIt=summaries.begin();sIt!=summaries.end();++sIt)
+			sIt->write(summariesFile);
+		}
+	};
+
+void writeNodeSummaries(const char* lidarFileName,unsigned int memoryCacheSize) // Writes the summaries of all octree nodes of the given newly-created LiDAR file
+	{
+	std::cout<<"Writing node summaries..."<<std::flush;
+	LidarProcessOctree lpo(lidarFileName,size_t(memoryCacheSize)*size_t(1024*1024));
+	NodeSummarizer ns(lpo);
+	lpo.processNodesPostfix(ns);
+	ns.write(lidarFileName);
+	std::cout<<" done"<<std::endl;
+	}
+
+class PhaseTimer // Helper class to measure the wall-clock and CPU time of a processing phase
+	{
+	/* Elements: */
+	private:
+	Misc::Timer wallTimer; // Timer measuring wall-clock time since the phase started
+	double startCpuTime; // Process CPU time when the phase started
+	public:
+	double wallTime; // Wall-clock time of the finished phase in seconds
+	double cpuTime; // CPU time used by all threads during the finished phase in seconds
+	
+	/* Constructors and destructors: */
+	PhaseTimer(void) // Starts a phase
+		:startCpuTime(getCpuTime()),
+		 wallTime(0.0),cpuTime(0.0)
+		{
+		}
+	
+	/* Methods: */
+	static double getCpuTime(void) // Returns the user and system CPU time used by all threads of the process so far in seconds
+		{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF,&usage);
+		return double(usage.ru_utime.tv_sec+usage.ru_stime.tv_sec)+double(usage.ru_utime.tv_usec+usage.ru_stime.tv_usec)*1.0e-6;
+		}
+	static size_t getPeakRss(void) // Returns the process's peak resident set size in bytes
+		{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF,&usage);
+		#ifdef __APPLE__
+		return size_t(usage.ru_maxrss);
+		#else
+		return size_t(usage.ru_maxrss)*size_t(1024);
+		#endif
+		}
+	void elapse(void) // Finishes the phase
+		{
+		wallTimer.elapse();
+		wallTime=wallTimer.getTime();
+		cpuTime=getCpuTime()-startCpuTime;
+		}
+	};
+
+struct TempFileStats // Structure recording the I/O of a temporary octree file
+	{
+	/* Elements: */
+	public:
+	std::string fileName; // Name of the temporary octree file
+	size_t numPoints; // Number of points in the temporary octree
+	double buildTime; // Time to create the temporary octree in seconds
+	size_t numBytesWritten; // Number of point data bytes written to the file
+	size_t numBytesRead; // Number of point data bytes read back during octree creation
+	};
+
+void printPhase(const char* phaseName,const PhaseTimer& phase,size_t numPoints) // Prints one line of the phase summary
+	{
+	std::cout<<"  "<<std::left<<std::setw(14)<<phaseName<<std::right;
+	std::cout<<std::setw(10)<<std::fixed<<std::setprecision(2)<<phase.wallTime<<" s";
+	std::cout<<std::setw(10)<<phase.cpuTime<<" s";
+	std::cout<<std::setw(8)<<std::setprecision(1)<<(phase.wallTime>0.0?phase.cpuTime*100.0/phase.wallTime:0.0)<<"% CPU";
+	if(numPoints>0&&phase.wallTime>0.0)
+		std::cout<<std::setw(12)<<std::setprecision(0)<<double(numPoints)/phase.wallTime<<" points/s";
+	std::cout<<std::endl;
+	}
+
 int main(int argc,char* argv[])
 	{
 	/* Set default values for all parameters: */
 	unsigned int memoryCacheSize=512;
 	unsigned int tempOctreeMaxNumPointsPerNode=4096;
-	std::string tempOctreeFileNameTemplate="/tmp/LidarPreprocessorTempOctree";
+	std::vector<std::string> tempOctreeFileNameTemplates(1,"/tmp/LidarPreprocessorTempOctree");
 	unsigned int maxNumPointsPerNode=4096;
 	int numThreads=1;
-	std::string tempPointFileNameTemplate="/tmp/LidarPreprocessorTempPoints";
+	int numReaderThreads=1;
+	std::string subsampleModeName="NearestNeighbor";
 	
 	try
 		{
@@ -1211,10 +2103,12 @@ int main(int argc,char* argv[])
 		/* Override program settings from configuration file: */
 		memoryCacheSize=cfg.retrieveValue<unsigned int>("./memoryCacheSize",memoryCacheSize);
 		tempOctreeMaxNumPointsPerNode=cfg.retrieveValue<unsigned int>("./tempOctreeMaxNumPointsPerNode",tempOctreeMaxNumPointsPerNode);
-		tempOctreeFileNameTemplate=cfg.retrieveValue<std::string>("./tempOctreeFileNameTemplate",tempOctreeFileNameTemplate);
+		tempOctreeFileNameTemplates[0]=cfg.retrieveValue<std::string>("./tempOctreeFileNameTemplate",tempOctreeFileNameTemplates[0]);
+		tempOctreeFileNameTemplates=cfg.retrieveValue<std::vector<std::string> >("./tempOctreeFileNameTemplates",tempOctreeFileNameTemplates);
 		maxNumPointsPerNode=cfg.retrieveValue<unsigned int>("./maxNumPointsPerNode",maxNumPointsPerNode);
 		numThreads=cfg.retrieveValue<int>("./numThreads",numThreads);
-		tempPointFileNameTemplate=cfg.retrieveValue<std::string>("./tempPointFileNameTemplate",tempPointFileNameTemplate);
+		numReaderThreads=cfg.retrieveValue<int>("./numReaderThreads",numReaderThreads);
+		subsampleModeName=cfg.retrieveValue<std::string>("./subsampleMode",subsampleModeName);
 		}
 	catch(const std::runtime_error&)
 		{
@@ -1233,9 +2127,17 @@ int main(int argc,char* argv[])
 		"red","green","blue"
 		};
 	bool havePoints=false;
+	bool compressPoints=false;
+	bool writeAttributes=false;
+	bool writeSummaries=false;
+	bool haveRootDomain=false;
+	bool haveTempOctreeFileNameTemplateArg=false;
+	Cube rootDomain;
+	std::vector<InputFile> inputFiles; // List of input files queued for parallel reading
+	std::vector<InputFile> lasInputFiles; // List of all LAS input files, read serially or in parallel, for writing attribute channels
 	
 	/* Parse the command line and load all input files: */
-	Misc::Timer loadTimer;
+	PhaseTimer loadTimer;
 	PointAccumulator pa;
 	for(int i=1;i<argc;++i)
 		{
@@ -1265,6 +2167,22 @@ int main(int argc,char* argv[])
 				else
 					std::cerr<<"Dangling -nt flag on command line"<<std::endl;
 				}
+			else if(strcasecmp(argv[i]+1,"trace")==0)
+				{
+				++i;
+				if(i<argc)
+					TraceEvents::start(argv[i]);
+				else
+					std::cerr<<"Dangling -trace flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"nr")==0)
+				{
+				++i;
+				if(i<argc)
+					numReaderThreads=atoi(argv[i]);
+				else
+					std::cerr<<"Dangling -nr flag on command line"<<std::endl;
+				}
 			else if(strcasecmp(argv[i]+1,"ooc")==0)
 				{
 				++i;
@@ -1279,7 +2197,13 @@ int main(int argc,char* argv[])
 				if(i<argc)
 					{
 					if(!havePoints)
-						tempOctreeFileNameTemplate=argv[i];
+						{
+						/* Replace the configured templates with the first -to flag, and stripe across all further ones: */
+						if(!haveTempOctreeFileNameTemplateArg)
+							tempOctreeFileNameTemplates.clear();
+						tempOctreeFileNameTemplates.push_back(argv[i]);
+						haveTempOctreeFileNameTemplateArg=true;
+						}
 					else
 						std::cerr<<"Ignoring -to flag; must be specified before any input point sets are read"<<std::endl;
 					}
@@ -1290,10 +2214,41 @@ int main(int argc,char* argv[])
 				{
 				++i;
 				if(i<argc)
-					tempPointFileNameTemplate=argv[i];
+					std::cerr<<"Ignoring -tp flag; octree creation no longer uses temporary point files"<<std::endl;
 				else
 					std::cerr<<"Dangling -tp flag on command line"<<std::endl;
 				}
+			else if(strcasecmp(argv[i]+1,"subsample")==0)
+				{
+				++i;
+				if(i<argc)
+					subsampleModeName=argv[i];
+				else
+					std::cerr<<"Dangling -subsample flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"compress")==0)
+				compressPoints=true;
+			else if(strcasecmp(argv[i]+1,"attributes")==0)
+				writeAttributes=true;
+			else if(strcasecmp(argv[i]+1,"summaries")==0)
+				writeSummaries=true;
+			else if(strcasecmp(argv[i]+1,"domain")==0)
+				{
+				if(i+6<argc)
+					{
+					/* Read the root domain of a partial octree in octree coordinates: */
+					Point domainMin,domainMax;
+					for(int j=0;j<3;++j)
+						domainMin[j]=Scalar(atof(argv[i+1+j]));
+					for(int j=0;j<3;++j)
+						domainMax[j]=Scalar(atof(argv[i+4+j]));
+					rootDomain=Cube(domainMin,domainMax);
+					haveRootDomain=true;
+					}
+				else
+					std::cerr<<"Dangling -domain flag on command line"<<std::endl;
+				i+=6;
+				}
 			else if(strcasecmp(argv[i]+1,"lasOffset")==0)
 				{
 				if(havePoints)
@@ -1339,6 +2294,27 @@ int main(int argc,char* argv[])
 				else
 					std::cerr<<"Dangling -lasOffsetFile flag on command line"<<std::endl;
 				}
+			else if(strcasecmp(argv[i]+1,"lasOffsetCatalog")==0)
+				{
+				++i;
+				if(havePoints)
+					std::cerr<<"Ignoring lasOffsetCatalog argument; must be specified before any input files are read"<<std::endl;
+				else if(i<argc)
+					{
+					/* Center the point offset on the bounding box of a CalcLasRange catalog file: */
+					try
+						{
+						pa.setPointOffset(readCatalogPointOffset(argv[i]));
+						}
+					catch(const std::runtime_error& err)
+						{
+						/* Print a warning and carry on: */
+						std::cerr<<"Ignoring lasOffsetCatalog argument due to error "<<err.what()<<" when reading file "<<argv[i]<<std::endl;
+						}
+					}
+				else
+					std::cerr<<"Dangling -lasOffsetCatalog flag on command line"<<std::endl;
+				}
 			else if(strcasecmp(argv[i]+1,"noLasOffset")==0)
 				pa.resetPointOffset();
 			else if(strcasecmp(argv[i]+1,"transform")==0)
@@ -1415,6 +2391,8 @@ int main(int argc,char* argv[])
 				}
 			else if(strcasecmp(argv[i]+1,"las")==0)
 				pointFileType=LAS;
+			else if(strcasecmp(argv[i]+1,"laz")==0)
+				pointFileType=LAZ;
 			else if(strcasecmp(argv[i]+1,"lasClasses")==0)
 				{
 				/* Build a bit mask of LAS point classes to process: */
@@ -1541,6 +2519,8 @@ int main(int argc,char* argv[])
 					thisPointFileType=PLY;
 				else if(strcasecmp(extPtr,".las")==0)
 					thisPointFileType=LAS;
+				else if(strcasecmp(extPtr,".laz")==0)
+					thisPointFileType=LAZ;
 				else if(strcasecmp(extPtr,".xyzi")==0)
 					thisPointFileType=XYZI;
 				else if(strcasecmp(extPtr,".xyzrgb")==0)
@@ -1557,142 +2537,53 @@ int main(int argc,char* argv[])
 				{
 				/* Initialize the point accumulator: */
 				pa.setMemorySize(memoryCacheSize,tempOctreeMaxNumPointsPerNode);
-				pa.setTempOctreeFileNameTemplate(tempOctreeFileNameTemplate+"XXXXXX");
+				pa.setTempOctreeFileNameTemplates(getTempFileNameTemplates(tempOctreeFileNameTemplates));
+				pa.setNumTempOctreeThreads(numThreads>1?(unsigned int)numThreads:1U);
 				}
 			
 			/* Reset the point accumulator's spatial and color extents: */
 			pa.resetExtents();
 			
-			switch(thisPointFileType)
+			/* Capture the current settings for the input file: */
+			InputFile inputFile;
+			inputFile.fileName=argv[i];
+			inputFile.pointFileType=thisPointFileType;
+			inputFile.tiffImageIndex=tiffImageIndex;
+			for(int j=0;j<6;++j)
+				inputFile.asciiColumnIndices[j]=asciiColumnIndices[j];
+			inputFile.lasClassMask=lasClassMask;
+			inputFile.numHeaderLines=numHeaderLines;
+			inputFile.numParserThreads=numThreads>1?(unsigned int)numThreads:1U;
+			for(int j=0;j<3;++j)
+				inputFile.plyColorNames[j]=plyColorNames[j];
+			inputFile.pointOffset=pa.getPointOffset();
+			inputFile.haveTransform=pa.hasTransform();
+			inputFile.transform=pa.getTransform();
+			for(int j=0;j<3;++j)
+				inputFile.colorMask[j]=pa.getColorMask()[j];
+			
+			if(thisPointFileType==LAS)
+				lasInputFiles.push_back(inputFile);
+			
+			if(thisPointFileType==ILLEGAL)
+				std::cerr<<"Input file "<<argv[i]<<" has an unrecognized file format"<<std::endl;
+			else if(numReaderThreads>1)
 				{
-				case TIFFDEM:
-					{
-					std::cout<<"Processing TIFF input file "<<argv[i]<<"..."<<std::flush;
-					TIFFDEMLoader tiff(pa,argv[i],tiffImageIndex);
-					tiff.collectPoints();
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-					}
-				
-				case XYZBIL:
-					std::cout<<"Processing XYZ BIL input file "<<argv[i]<<"..."<<std::flush;
-					loadXYZBILImage(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case BIN:
-					std::cout<<"Processing binary input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileBin(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case BINRGB:
-					std::cout<<"Processing RGB binary input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileBinRgb(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case PLY:
-					std::cout<<"Processing PLY input file "<<argv[i]<<"..."<<std::flush;
-					readPlyFile(pa,argv[i],plyColorNames);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case LAS:
-					std::cout<<"Processing binary input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileLas(pa,argv[i],lasClassMask);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case XYZI:
-					std::cout<<"Processing XYZI input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileXyzi(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case XYZRGB:
-					std::cout<<"Processing XYZRGB input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileXyzrgb(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case ASCII:
-					std::cout<<"Processing generic ASCII input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileGenericASCII(pa,argv[i],numHeaderLines,false,false,asciiColumnIndices);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case ASCIIRGB:
-					std::cout<<"Processing generic RGB ASCII input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileGenericASCII(pa,argv[i],numHeaderLines,false,true,asciiColumnIndices);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case CSV:
-					std::cout<<"Processing generic CSV input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileGenericASCII(pa,argv[i],numHeaderLines,true,false,asciiColumnIndices);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case CSVRGB:
-					std::cout<<"Processing generic RGB CSV input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileGenericASCII(pa,argv[i],numHeaderLines,true,true,asciiColumnIndices);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case BLOCKEDASCII:
-					std::cout<<"Processing blocked ASCII input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileBlockedASCII(pa,argv[i],numHeaderLines,false,asciiColumnIndices);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case BLOCKEDASCIIRGB:
-					std::cout<<"Processing blocked RGB ASCII input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileBlockedASCII(pa,argv[i],numHeaderLines,true,asciiColumnIndices);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case IDL:
-					std::cout<<"Processing redshift IDL input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileIdl(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case OCTREE:
-					std::cout<<"Processing LiDAR octree input file "<<argv[i]<<"..."<<std::flush;
-					loadPointFileOctree(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
-				
-				case LIDAR:
-					std::cout<<"Processing LiDAR input file "<<argv[i]<<"..."<<std::flush;
-					loadLidarFile(pa,argv[i]);
-					havePoints=true;
-					std::cout<<" done."<<std::endl;
-					break;
+				/* Queue the input file to be read in parallel after the command line has been parsed: */
+				inputFiles.push_back(inputFile);
+				havePoints=true;
+				}
+			else
+				{
+				/* Read the input file: */
+				std::cout<<"Processing "<<getPointFileTypeName(thisPointFileType)<<" input file "<<argv[i]<<"..."<<std::flush;
+				loadInputFile(pa,inputFile);
+				havePoints=true;
+				std::cout<<" done."<<std::endl;
 				
-				default:
-					std::cerr<<"Input file "<<argv[i]<<" has an unrecognized file format"<<std::endl;
+				/* Print the spatial and color extents of the just-read input file: */
+				pa.printExtents();
 				}
-			
-			/* Print the spatial and color extents of the just-read input file: */
-			pa.printExtents();
 			}
 		}
 	
@@ -1702,11 +2593,18 @@ int main(int argc,char* argv[])
 		std::cerr<<"Usage: "<<argv[0]<<" -o <output file name stem> [<option 1>] ... [<option n>] <input file spec 1> ... <input file spec n>"<<std::endl;
 		std::cerr<<"Options: -np <max points per node>"<<std::endl;
 		std::cerr<<"         -nt <number of threads>"<<std::endl;
+		std::cerr<<"         -nr <number of input file reader threads>"<<std::endl;
+		std::cerr<<"         -trace <trace file name>"<<std::endl;
 		std::cerr<<"         -ooc <memory cache size in MB>"<<std::endl;
-		std::cerr<<"         -to <temporary octree file name template>"<<std::endl;
-		std::cerr<<"         -tp <temporary point file name template>"<<std::endl;
+		std::cerr<<"         -to <temporary octree file name template> (repeat to stripe across scratch volumes)"<<std::endl;
+		std::cerr<<"         -subsample ( NearestNeighbor | Grid )"<<std::endl;
+		std::cerr<<"         -compress"<<std::endl;
+		std::cerr<<"         -attributes"<<std::endl;
+		std::cerr<<"         -summaries"<<std::endl;
+		std::cerr<<"         -domain <min x> <min y> <min z> <max x> <max y> <max z>"<<std::endl;
 		std::cerr<<"         -lasOffset <offset x> <offset y> <offset z>"<<std::endl;
 		std::cerr<<"         -lasOffsetFile <binary offset file name>"<<std::endl;
+		std::cerr<<"         -lasOffsetCatalog <CalcLasRange catalog file name>"<<std::endl;
 		std::cerr<<"         -noLasOffset"<<std::endl;
 		std::cerr<<"         -plyColorNames <red component name> <green component name> <blue component name>"<<std::endl;
 		std::cerr<<"         -transform <orthogonal transformation specification>"<<std::endl;
@@ -1716,6 +2614,7 @@ int main(int argc,char* argv[])
 		std::cerr<<"             -BINRGB"<<std::endl;
 		std::cerr<<"             -PLY"<<std::endl;
 		std::cerr<<"             -LAS"<<std::endl;
+		std::cerr<<"             -LAZ"<<std::endl;
 		std::cerr<<"             -XYZI"<<std::endl;
 		std::cerr<<"             -XYZRGB"<<std::endl;
 		std::cerr<<"             -ASCII <x column> <y column> <z column> [<intensity column>]"<<std::endl;
@@ -1730,23 +2629,60 @@ int main(int argc,char* argv[])
 		return 1;
 		}
 	
+	/* Read all queued input files in parallel: */
+	if(!inputFiles.empty())
+		{
+		ParallelIngester ingester(inputFiles);
+		if(!ingester.ingest(pa,(unsigned int)numReaderThreads,memoryCacheSize,tempOctreeMaxNumPointsPerNode,getTempFileNameTemplates(tempOctreeFileNameTemplates),numThreads>1?(unsigned int)numThreads:1U))
+			{
+			std::cerr<<"Aborting due to unreadable input files"<<std::endl;
+			return 1;
+			}
+		}
+	
 	/* Finish reading points: */
 	pa.finishReading();
 	loadTimer.elapse();
 	
+	/* Select the interior node subsampling algorithm: */
+	LidarOctreeCreator::SubsampleMode subsampleMode=LidarOctreeCreator::NEARESTNEIGHBOR;
+	if(strcasecmp(subsampleModeName.c_str(),"Grid")==0)
+		subsampleMode=LidarOctreeCreator::GRID;
+	else if(strcasecmp(subsampleModeName.c_str(),"NearestNeighbor")!=0)
+		std::cerr<<"Unknown subsampling mode "<<subsampleModeName<<"; using NearestNeighbor"<<std::endl;
+	
 	/* Construct an octree with less than maxPointsPerNode points per leaf: */
-	Misc::Timer createTimer;
-	LidarOctreeCreator tree(pa.getMaxNumCacheablePoints(),maxNumPointsPerNode,numThreads,pa.getTempOctrees(),tempPointFileNameTemplate+"XXXXXX");
+	PhaseTimer createTimer;
+	LidarOctreeCreator tree(pa.getMaxNumCacheablePoints(),maxNumPointsPerNode,numThreads,pa.getTempOctrees(),outputFileName,compressPoints,subsampleMode,haveRootDomain?&rootDomain:0);
+	
+	/* Collect the temporary octree files' statistics: */
+	size_t totalNumPoints=0;
+	std::vector<TempFileStats> tempFileStats;
+	const std::vector<TempOctree*>& tempOctrees=pa.getTempOctrees();
+	for(std::vector<TempOctree*>::const_iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
+		{
+		TempFileStats tfs;
+		tfs.fileName=(*toIt)->getTempFileName()!=0?(*toIt)->getTempFileName():"(input octree)";
+		tfs.numPoints=(*toIt)->getTotalNumPoints();
+		tfs.buildTime=(*toIt)->getBuildTime();
+		tfs.numBytesWritten=(*toIt)->getNumBytesWritten();
+		tfs.numBytesRead=(*toIt)->getNumBytesRead();
+		tempFileStats.push_back(tfs);
+		totalNumPoints+=tfs.numPoints;
+		}
 	
 	/* Delete the temporary point octrees: */
 	pa.deleteTempOctrees();
 	createTimer.elapse();
 	
-	/* Write the octree structure and data to the destination LiDAR file: */
-	Misc::Timer writeTimer;
-	tree.write(size_t(memoryCacheSize)*size_t(1024*1024),outputFileName);
+	/* Write the octree structure to the destination LiDAR file: */
+	PhaseTimer writeTimer;
+	tree.write();
 	writeTimer.elapse();
 	
+	/* Remove a summaries file left over from an earlier run, which would not match the new octree: */
+	unlink(LidarNodeSummary::getFileName(outputFileName).c_str());
+	
 	/* Check if a point offset was defined: */
 	if(pa.getPointOffset()!=PointAccumulator::Vector::zero)
 		{
@@ -1758,7 +2694,59 @@ int main(int argc,char* argv[])
 		offsetFile->write(pa.getPointOffset().getComponents(),3);
 		}
 	
-	std::cout<<"Time to load input data: "<<loadTimer.getTime()<<"s, time to create octree: "<<createTimer.getTime()<<"s, time to write final octree files: "<<writeTimer.getTime()<<"s"<<std::endl;
+	/* Write attribute channels for points read from LAS files if requested: */
+	PhaseTimer attributesTimer;
+	if(writeAttributes)
+		writeLasAttributes(outputFileName,lasInputFiles,tree.getNumDataRecords(),memoryCacheSize);
+	attributesTimer.elapse();
+	
+	/* Write node summaries if requested, after the attribute channels they summarize: */
+	PhaseTimer summariesTimer;
+	if(writeSummaries)
+		writeNodeSummaries(outputFileName,memoryCacheSize);
+	summariesTimer.elapse();
+	
+	/* Print the summary report: */
+	std::cout<<std::endl<<"Summary for "<<totalNumPoints<<" points:"<<std::endl;
+	printPhase("Load input",loadTimer,totalNumPoints);
+	printPhase("Create octree",createTimer,totalNumPoints);
+	printPhase("Write index",writeTimer,0);
+	if(writeAttributes)
+		printPhase("Attributes",attributesTimer,totalNumPoints);
+	if(writeSummaries)
+		printPhase("Summaries",summariesTimer,totalNumPoints);
+	
+	std::cout<<std::setprecision(1);
+	std::cout<<"Temporary octree files:"<<std::endl;
+	for(std::vector<TempFileStats>::iterator tfsIt=tempFileStats.begin();tfsIt!=tempFileStats.end();++tfsIt)
+		{
+		std::cout<<"  "<<tfsIt->fileName<<": "<<tfsIt->numPoints<<" points, built in "<<std::setprecision(2)<<tfsIt->buildTime<<" s, ";
+		std::cout<<std::setprecision(1)<<double(tfsIt->numBytesWritten)/(1024.0*1024.0)<<" MB written, "<<double(tfsIt->numBytesRead)/(1024.0*1024.0)<<" MB read"<<std::endl;
+		}
+	std::cout<<"Output files: "<<double(tree.getIndexFileSize())/(1024.0*1024.0)<<" MB index, "<<double(tree.getPointsFileSize())/(1024.0*1024.0)<<" MB point data"<<std::endl;
+	
+	/* Report how busy the subsampling threads were while they were running: */
+	double totalBusyTime=0.0;
+	std::cout<<"Subsample threads:";
+	for(unsigned int i=0;i<tree.getNumSubsampleThreads();++i)
+		{
+		std::cout<<' '<<std::setprecision(2)<<tree.getSubsampleBusyTime(i)<<" s";
+		totalBusyTime+=tree.getSubsampleBusyTime(i);
+		}
+	double subsampleCapacity=tree.getSubsampleWallTime()*double(tree.getNumSubsampleThreads());
+	std::cout<<" busy, "<<std::setprecision(1)<<(subsampleCapacity>0.0?totalBusyTime*100.0/subsampleCapacity:0.0)<<"% utilization"<<std::endl;
+	
+	std::cout<<"Peak resident memory: "<<double(PhaseTimer::getPeakRss())/(1024.0*1024.0)<<" MB, memory cache size: "<<memoryCacheSize<<" MB"<<std::endl;
+	
+	/* Write the trace file if tracing was requested: */
+	try
+		{
+		TraceEvents::finish();
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Could not write trace file due to exception "<<err.what()<<std::endl;
+		}
 	
 	return 0;
 	}
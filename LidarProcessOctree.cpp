@@ -1,6 +1,6 @@
 /***********************************************************************
 LidarProcessOctree - Class to process multiresolution LiDAR point sets.
-Copyright (c) 2008-2024 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -20,16 +20,62 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 02111-1307 USA
 ***********************************************************************/
 
+#include <unistd.h>
 #include <string>
 #include <iostream>
 #include <Misc/Utility.h>
+#include <Misc/SelfDestructPointer.h>
 #include <Misc/StdError.h>
 #include <IO/File.h>
-#include <IO/OpenFile.h>
 #include <Math/Math.h>
 
 #include "LidarProcessOctree.h"
 
+#include "LidarCompressedFile.h"
+#include "LidarQuantization.h"
+#include "LidarAttributes.h"
+#include "SystemMemory.h"
+
+namespace {
+
+/***********************************************************
+Helper functions to load LiDAR files given a base file name:
+***********************************************************/
+
+std::string getLidarPartFileName(const char* lidarFileName,const char* partFileName)
+	{
+	std::string result=lidarFileName;
+	result.push_back('/');
+	result.append(partFileName);
+	return result;
+	}
+
+}
+
+/************************************************
+Methods of class LidarProcessOctree::LoaderFiles:
+************************************************/
+
+LidarProcessOctree::LoaderFiles::LoaderFiles(const LidarSource& source,const std::string& colorsFileName)
+	:indexFile(source.openPart("Index")),
+	 pointsFile(source.openPart("Points")),
+	 colorsFile(0),
+	 quantizedPointsBuffer(0),colorsBuffer(0)
+	{
+	/* Open the optional additional colors file; all reads use absolute positions, and the source sets up endianness: */
+	if(!colorsFileName.empty())
+		colorsFile=source.openPart(colorsFileName.c_str());
+	}
+
+LidarProcessOctree::LoaderFiles::~LoaderFiles(void)
+	{
+	delete indexFile;
+	delete pointsFile;
+	delete colorsFile;
+	delete[] quantizedPointsBuffer;
+	delete[] colorsBuffer;
+	}
+
 /*****************************************
 Methods of class LidarProcessOctree::Node:
 *****************************************/
@@ -39,7 +85,7 @@ LidarProcessOctree::Node::Node(void)
 	 #if ALLOW_THREADING
 	 numProcessedChildren(0),
 	 #endif
-	 parent(0),children(0),points(0),
+	 parent(0),index(0),children(0),points(0),pointsMapped(false),pointArrays(0),
 	 processCounter(0),
 	 lruPred(0),lruSucc(0)
 	{
@@ -47,183 +93,533 @@ LidarProcessOctree::Node::Node(void)
 
 LidarProcessOctree::Node::~Node(void)
 	{
-	/* Delete point array: */
-	delete[] points;
-	
-	/* Delete children: */
-	delete[] children;
+	/* Delete the structure-of-arrays view; the point array is owned by the octree's point array pool or by a memory-mapped file: */
+	delete pointArrays;
 	}
 
 /***********************************
 Methods of class LidarProcessOctree:
 ***********************************/
 
-void LidarProcessOctree::loadPoints(LidarProcessOctree::Node& node)
+void LidarProcessOctree::loadPoints(LidarProcessOctree::Node& node,LidarProcessOctree::LoaderFiles& files,const LidarProcessOctree::DataBlocks* blocks)
 	{
-	/* Load the node's points: */
-	node.points=new LidarPoint[maxNumPointsPerNode]; // Always allocate maximum to prevent memory fragmentation
-	pointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node.dataOffset);
-	pointsFile.read(node.points,node.numPoints);
+	LidarSourceFile& nodePointsFile=*files.pointsFile;
+	LidarSourceFile* nodeColorsFile=files.colorsFile;
+	
+	if(pointsMap!=0)
+		{
+		/* Access the node's points inside the mapped points file: */
+		pointsMap->checkRecords(node.dataOffset,node.numPoints);
+		
+		if(quantizedPoints)
+			{
+			/* Convert the mapped quantized points relative to the node's domain: */
+			LidarPoint* points=pointArrayPool->allocate<LidarPoint>();
+			node.points=points;
+			dequantizePoints(pointsMap->getRecords<QuantizedLidarPoint>(node.dataOffset),node.numPoints,node.domain,points);
+			
+			if(colorsMap!=0)
+				{
+				/* Merge in the mapped colors: */
+				colorsMap->checkRecords(node.dataOffset,node.numPoints);
+				const Color* mappedColors=colorsMap->getRecords<Color>(node.dataOffset);
+				for(unsigned int i=0;i<node.numPoints;++i)
+					points[i].value=mappedColors[i];
+				}
+			
+			return;
+			}
+		
+		const LidarPoint* mappedPoints=pointsMap->getRecords<LidarPoint>(node.dataOffset);
+		if(colorsMap==0)
+			{
+			/* Use the mapped points in place; they are read-only like all node points handed to callers: */
+			node.points=mappedPoints;
+			node.pointsMapped=true;
+			}
+		else
+			{
+			/* Copy the mapped points and merge in the mapped colors: */
+			colorsMap->checkRecords(node.dataOffset,node.numPoints);
+			const Color* mappedColors=colorsMap->getRecords<Color>(node.dataOffset);
+			LidarPoint* points=pointArrayPool->allocate<LidarPoint>();
+			node.points=points;
+			for(unsigned int i=0;i<node.numPoints;++i)
+				{
+				points[i]=mappedPoints[i];
+				points[i].value=mappedColors[i];
+				}
+			}
+		
+		return;
+		}
+	
+	/* Load the node's points into an array from the pool: */
+	LidarPoint* points=pointArrayPool->allocate<LidarPoint>();
+	node.points=points;
+	if(quantizedPoints&&blocks!=0)
+		{
+		/* Convert the quantized points read together with the node's siblings relative to the node's domain: */
+		dequantizePoints(blocks->quantizedPoints.getRecords(node.dataOffset),node.numPoints,node.domain,points);
+		}
+	else if(quantizedPoints)
+		{
+		/* Read the quantized points into the file handles' staging buffer and convert them relative to the node's domain: */
+		if(files.quantizedPointsBuffer==0)
+			files.quantizedPointsBuffer=new QuantizedLidarPoint[maxNumPointsPerNode];
+		if(compressedPoints!=0)
+			compressedPoints->readRecords(nodePointsFile,node.dataOffset,node.numPoints,files.quantizedPointsBuffer);
+		else
+			{
+			nodePointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node.dataOffset);
+			nodePointsFile.read(files.quantizedPointsBuffer,node.numPoints);
+			}
+		dequantizePoints(files.quantizedPointsBuffer,node.numPoints,node.domain,points);
+		}
+	else if(compressedPoints!=0)
+		{
+		/* Decompress the node's block of points: */
+		compressedPoints->readRecords(nodePointsFile,node.dataOffset,node.numPoints,points);
+		}
+	else if(blocks!=0)
+		{
+		/* Copy the points read together with the node's siblings: */
+		const LidarPoint* bpPtr=blocks->points.getRecords(node.dataOffset);
+		for(unsigned int i=0;i<node.numPoints;++i)
+			points[i]=bpPtr[i];
+		}
+	else
+		{
+		nodePointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+pointsRecordSize*node.dataOffset);
+		nodePointsFile.read(points,node.numPoints);
+		}
 	
 	/* Check for an additional color file: */
-	if(colorsFile!=0)
+	if(nodeColorsFile!=0&&blocks!=0)
+		{
+		/* Merge in the colors read together with the node's siblings: */
+		const Color* bcPtr=blocks->colors.getRecords(node.dataOffset);
+		for(unsigned int i=0;i<node.numPoints;++i)
+			points[i].value=bcPtr[i];
+		}
+	else if(nodeColorsFile!=0)
 		{
-		/* Load additional point colors: */
-		colorsFile->setReadPosAbs(LidarDataFileHeader::getFileSize()+colorsRecordSize*node.dataOffset);
+		/* Load additional point colors into the file handles' staging buffer in a single read and merge them into the points: */
+		if(files.colorsBuffer==0)
+			files.colorsBuffer=new Color[maxNumPointsPerNode];
+		nodeColorsFile->setReadPosAbs(LidarDataFileHeader::getFileSize()+colorsRecordSize*node.dataOffset);
+		nodeColorsFile->read(files.colorsBuffer,node.numPoints);
 		for(unsigned int i=0;i<node.numPoints;++i)
-			colorsFile->read(node.points[i].value.getRgba(),4);
+			points[i].value=files.colorsBuffer[i];
 		}
 	}
 
-void LidarProcessOctree::subdivide(LidarProcessOctree::Node& node)
+void LidarProcessOctree::deleteChildren(LidarProcessOctree::Node* children)
+	{
+	for(int i=0;i<8;++i)
+		{
+		/* Delete the child's subtree: */
+		if(children[i].children!=0)
+			deleteChildren(children[i].children);
+		
+		/* Recycle the child's point array unless it is owned by a memory-mapped file; arrays from the pool are writable: */
+		if(!children[i].pointsMapped)
+			pointArrayPool->free(const_cast<LidarPoint*>(children[i].points));
+		}
+	
+	delete[] children;
+	}
+
+void LidarProcessOctree::createPointArrays(LidarProcessOctree::Node& node)
 	{
+	/* Always allocate maximum to prevent memory fragmentation: */
+	node.pointArrays=new LidarPointArrays(maxNumPointsPerNode);
+	node.pointArrays->set(node.points,node.numPoints);
+	}
+
+void LidarProcessOctree::lockLruShard(LidarProcessOctree::LruShard& shard)
 	{
 	#if ALLOW_THREADING
-	Threads::Mutex::Lock lruLock(lruMutex);
+	/* Count the lock attempt as contended if the part is locked by another thread: */
+	if(!shard.mutex.tryLock())
+		{
+		numLruContentions.preAdd(1);
+		shard.mutex.lock();
+		}
 	#endif
-	++numSubdivideCalls;
 	}
-	
+
+void LidarProcessOctree::unlockLruShard(LidarProcessOctree::LruShard& shard)
+	{
 	#if ALLOW_THREADING
-	Threads::Mutex::Lock nodeLock(node.mutex);
+	shard.mutex.unlock();
 	#endif
+	}
+
+void LidarProcessOctree::addLeafParent(LidarProcessOctree::Node& node)
+	{
+	LruShard& shard=getLruShard(node);
+	lockLruShard(shard);
 	
-	/* Bail out if the node's children have magically appeared since the last check: */
-	if(node.children!=0)
-		return;
+	/* Bail out if the node is already in the list, which can happen if two of its children were coarsened concurrently: */
+	if(node.lruPred==0&&node.lruSucc==0&&shard.head!=&node)
+		{
+		/* Add the node to the end of the list: */
+		node.lruPred=shard.tail;
+		node.lruSucc=0;
+		if(shard.tail!=0)
+			shard.tail->lruSucc=&node;
+		else
+			shard.head=&node;
+		shard.tail=&node;
+		}
 	
-	/* Check if the node cache is full: */
+	unlockLruShard(shard);
+	}
+
+void LidarProcessOctree::removeLeafParent(LidarProcessOctree::Node& node)
 	{
-	#if ALLOW_THREADING
-	Threads::Mutex::Lock lruLock(lruMutex);
-	#endif
-	if(numCachedNodes+8>cacheSize)
+	LruShard& shard=getLruShard(node);
+	lockLruShard(shard);
+	
+	/* Check if the node is in the list: */
+	if(node.lruPred!=0||node.lruSucc!=0||shard.head==&node)
+		{
+		/* Remove the node from the list: */
+		if(node.lruPred!=0)
+			node.lruPred->lruSucc=node.lruSucc;
+		else
+			shard.head=node.lruSucc;
+		if(node.lruSucc!=0)
+			node.lruSucc->lruPred=node.lruPred;
+		else
+			shard.tail=node.lruPred;
+		node.lruPred=0;
+		node.lruSucc=0;
+		}
+	
+	unlockLruShard(shard);
+	}
+
+void LidarProcessOctree::coarsen(unsigned int firstShardIndex)
+	{
+	/* Search all parts of the leaf parent node list for an unused leaf parent, starting with the given one: */
+	Node* coarsenNode=0;
+	for(unsigned int i=0;i<numLruShards&&coarsenNode==0;++i)
 		{
-		/* Find an unused leaf node parent and remove its children: */
-		Node* coarsenNode;
-		#if ALLOW_THREADING
-		for(coarsenNode=lruHead;coarsenNode!=0;coarsenNode=coarsenNode->lruSucc)
+		LruShard& shard=lruShards[(firstShardIndex+i)%numLruShards];
+		lockLruShard(shard);
+		
+		for(coarsenNode=shard.head;coarsenNode!=0;coarsenNode=coarsenNode->lruSucc)
 			{
-			/* Check if the leaf parent is currently unused: */
-			coarsenNode->mutex.lock();
+			#if ALLOW_THREADING
+			/* Check if the leaf parent is currently unused; skip nodes locked by other threads, which might be waiting on this part of the list: */
+			if(coarsenNode->mutex.tryLock())
+				{
+				if(coarsenNode->processCounter==0)
+					break;
+				coarsenNode->mutex.unlock();
+				}
+			#else
 			if(coarsenNode->processCounter==0)
 				break;
-			coarsenNode->mutex.unlock();
+			#endif
+			numBusyEvictionCandidates.preAdd(1);
 			}
-		#else
-		for(coarsenNode=lruHead;coarsenNode!=0&&coarsenNode->processCounter!=0;coarsenNode=coarsenNode->lruSucc)
-			;
-		#endif
 		
-		/* Remove the found node's children: */
-		delete[] coarsenNode->children;
-		coarsenNode->children=0;
+		if(coarsenNode!=0)
+			{
+			/* Remove the found node from the list: */
+			if(coarsenNode->lruPred!=0)
+				coarsenNode->lruPred->lruSucc=coarsenNode->lruSucc;
+			else
+				shard.head=coarsenNode->lruSucc;
+			if(coarsenNode->lruSucc!=0)
+				coarsenNode->lruSucc->lruPred=coarsenNode->lruPred;
+			else
+				shard.tail=coarsenNode->lruPred;
+			coarsenNode->lruPred=0;
+			coarsenNode->lruSucc=0;
+			}
 		
-		#if ALLOW_THREADING
-		coarsenNode->mutex.unlock();
-		#endif
+		unlockLruShard(shard);
+		}
+	
+	/* Temporarily exceed the cache size if all leaf parents are in use: */
+	if(coarsenNode==0)
+		return;
+	
+	/* Remove the found node's children: */
+	deleteChildren(coarsenNode->children);
+	coarsenNode->children=0;
+	
+	#if ALLOW_THREADING
+	coarsenNode->mutex.unlock();
+	#endif
+	
+	/* Update the node cache: */
+	numCachedNodes.preSub(8U);
+	
+	/* Check if the found node's parent is now a leaf parent node: */
+	Node* parent=coarsenNode->parent;
+	if(parent!=0)
+		{
+		/* Check if all children of the parent are leaves: */
+		bool leafParent=true;
+		for(int childIndex=0;childIndex<8&&leafParent;++childIndex)
+			leafParent=parent->children[childIndex].children==0;
 		
-		/* Remove the found node from the lru list: */
-		if(coarsenNode->lruPred!=0)
-			coarsenNode->lruPred->lruSucc=coarsenNode->lruSucc;
-		else
-			lruHead=coarsenNode->lruSucc;
-		if(coarsenNode->lruSucc!=0)
-			coarsenNode->lruSucc->lruPred=coarsenNode->lruPred;
-		else
-			lruTail=coarsenNode->lruPred;
-		coarsenNode->lruPred=0;
-		coarsenNode->lruSucc=0;
+		if(leafParent)
+			addLeafParent(*parent);
+		}
+	}
+
+LidarProcessOctree::LoaderFiles& LidarProcessOctree::acquireLoaderFiles(void)
+	{
+	#if ALLOW_THREADING
+	/* Try grabbing an unused set of file handles: */
+	unsigned int numFiles=numLoaderFiles.get();
+	for(unsigned int i=0;i<numFiles;++i)
+		if(loaderFiles[i]->mutex.tryLock())
+			return *loaderFiles[i];
+	
+	numFileContentions.preAdd(1);
+	
+	/* Open a new set of file handles unless the maximum has been reached: */
+	{
+	Threads::Mutex::Lock loaderFilesLock(loaderFilesMutex);
+	numFiles=numLoaderFiles.get();
+	if(numFiles<maxNumLoaderFiles)
+		{
+		LoaderFiles* files=new LoaderFiles(source,colorsFileName);
+		files->mutex.lock();
+		
+		/* Publish the new set of file handles after it has been stored: */
+		loaderFiles[numFiles]=files;
+		numLoaderFiles.preAdd(1U);
+		
+		return *files;
+		}
+	}
+	
+	/* Wait for one of the existing sets of file handles: */
+	LoaderFiles& files=*loaderFiles[numSubdivideCalls.get()%maxNumLoaderFiles];
+	files.mutex.lock();
+	return files;
+	#else
+	return *loaderFiles[0];
+	#endif
+	}
+
+void LidarProcessOctree::releaseLoaderFiles(LidarProcessOctree::LoaderFiles& files)
+	{
+	#if ALLOW_THREADING
+	files.mutex.unlock();
+	#endif
+	}
+
+void LidarProcessOctree::subdivide(LidarProcessOctree::Node& node)
+	{
+	numSubdivideCalls.preAdd(1);
+	
+	#if ALLOW_THREADING
+	Threads::Mutex::Lock nodeLock(node.mutex);
+	#endif
+	
+	/* Bail out if the node's children have magically appeared since the last check: */
+	if(node.children!=0)
+		return;
+	
+	/* Check if the node cache is full: */
+	LruShard& shard=getLruShard(node);
+	if(numCachedNodes.get()+8U>cacheSize)
+		{
+		/* Find an unused leaf node parent and remove its children, preferring the node's own part of the leaf parent node list: */
+		coarsen((unsigned int)(&shard-lruShards));
+		}
+	
+	/* Create and load the node's children using a private set of file handles: */
+	Node* children=new Node[8];
+	try
+		{
+		LoaderFilesLock filesLock(*this);
+		LoaderFiles& files=filesLock.getFiles();
+		files.indexFile->setReadPosAbs(node.childrenOffset);
+		size_t firstChildIndex=size_t((node.childrenOffset-LidarFile::Offset(LidarOctreeFileHeader::getFileSize()))/LidarFile::Offset(LidarOctreeFileNode::getFileSize()));
+		LidarDataRange childrenRange;
+		bool childrenContiguous=true;
+		for(int childIndex=0;childIndex<8;++childIndex)
+			{
+			Node& child=children[childIndex];
+			
+			/* Read the child node's structure: */
+			LidarOctreeFileNode ofn;
+			ofn.read(*files.indexFile);
+			child.parent=&node;
+			child.childrenOffset=ofn.childrenOffset;
+			child.index=firstChildIndex+childIndex;
+			child.domain=Cube(node.domain,childIndex);
+			child.numPoints=ofn.numPoints;
+			child.dataOffset=ofn.dataOffset;
+			child.detailSize=ofn.detailSize;
+			
+			/* Check whether the children's records follow each other in the data files: */
+			if(!childrenRange.append(child.dataOffset,child.numPoints))
+				childrenContiguous=false;
+			}
 		
-		/* Update the node cache: */
-		numCachedNodes-=8;
+		/* Read all children's records in one request per data file if they are stored contiguously and not compressed or mapped: */
+		DataBlocks blocks;
+		DataBlocks* blocksPtr=0;
+		if(childrenContiguous&&childrenRange.getNumRecords()>0&&compressedPoints==0&&pointsMap==0)
+			{
+			if(quantizedPoints)
+				blocks.quantizedPoints.read(*files.pointsFile,pointsRecordSize,childrenRange);
+			else
+				blocks.points.read(*files.pointsFile,pointsRecordSize,childrenRange);
+			if(files.colorsFile!=0)
+				blocks.colors.read(*files.colorsFile,colorsRecordSize,childrenRange);
+			blocksPtr=&blocks;
+			}
 		
-		/* Check if the found node's parent is now a leaf parent node: */
-		Node* parent=coarsenNode->parent;
-		if(parent!=0)
+		for(int childIndex=0;childIndex<8;++childIndex)
 			{
-			/* Check if all children of the parent are leaves: */
-			bool leafParent=true;
-			for(int childIndex=0;childIndex<8&&leafParent;++childIndex)
-				leafParent=parent->children[childIndex].children==0;
+			Node& child=children[childIndex];
 			
-			if(leafParent)
+			/* Load the child's points: */
+			if(child.numPoints>0)
 				{
-				/* Add the parent to the end of the leaf parent node list: */
-				parent->lruPred=lruTail;
-				parent->lruSucc=0;
-				if(lruTail!=0)
-					lruTail->lruSucc=parent;
-				else
-					lruHead=parent;
-				lruTail=parent;
+				loadPoints(child,files,blocksPtr);
+				if(usePointArrays)
+					createPointArrays(child);
+				
+				/* Have the child's records in all requested attribute channels read ahead in bulk: */
+				for(std::vector<LidarMappedFile*>::iterator acIt=attributeChannels.begin();acIt!=attributeChannels.end();++acIt)
+					(*acIt)->adviseWillNeed(child.dataOffset,child.numPoints);
 				}
 			}
 		}
+	catch(...)
+		{
+		/* Release the partially loaded children and leave the node and the node cache unchanged: */
+		deleteChildren(children);
+		throw;
+		}
+	numLoadedNodes.preAdd(8);
 	
-	/* Check if the node's parent was a leaf parent: */
-	Node* parent=node.parent;
-	if(parent!=0&&(parent->lruPred!=0||parent->lruSucc!=0||lruHead==parent))
+	/* Update the node cache: */
+	numCachedNodes.preAdd(8U);
+	
+	/* The node's parent is no longer a leaf parent, and the node becomes one: */
+	if(node.parent!=0)
+		removeLeafParent(*node.parent);
+	addLeafParent(node);
+	
+	/* Install the node's children array: */
+	node.children=children;
+	}
+
+void LidarProcessOctree::loadSummaries(void)
+	{
+	/* Bail out if the LiDAR file has no summaries file: */
+	if(!source.hasPart("Summaries"))
+		return;
+	
+	/* Open the summaries file and check its header and size; ignore a summaries file that does not match the octree file: */
+	Misc::SelfDestructPointer<LidarSourceFile> summariesFile(source.openPart("Summaries"));
+	LidarDataFileHeader dfh(*summariesFile);
+	LidarFile::Offset expectedSize=LidarFile::Offset(LidarDataFileHeader::getFileSize())+LidarFile::Offset(numNodes)*LidarFile::Offset(LidarNodeSummary::getFileSize());
+	if(dfh.recordSize!=LidarNodeSummary::getFileSize()||summariesFile->getSize()!=expectedSize)
+		return;
+	
+	/* Read all node summaries: */
+	summaries.resize(numNodes);
+	for(std::vector<LidarNodeSummary>::iterator sIt=summaries.begin();sIt!=summaries.end();++sIt)
+		sIt->read(*summariesFile);
+	}
+
+#if ALLOW_THREADING
+
+void LidarProcessOctree::queuePrefetches(LidarProcessOctree::Node& node,const Box* box)
+	{
+	/* Enter the node's unloaded interior children, so that they can not be paged out while queued: */
+	Node* children[8];
+	int numChildren=0;
+	for(int childIndex=7;childIndex>=0;--childIndex)
 		{
-		/* Remove the node's parent from the leaf parent node list: */
-		if(parent->lruPred!=0)
-			parent->lruPred->lruSucc=parent->lruSucc;
-		else
-			lruHead=parent->lruSucc;
-		if(parent->lruSucc!=0)
-			parent->lruSucc->lruPred=parent->lruPred;
-		else
-			lruTail=parent->lruPred;
-		parent->lruPred=0;
-		parent->lruSucc=0;
+		Node& child=node.children[childIndex];
+		if(child.childrenOffset!=0&&child.children==0&&(box==0||(compareNodeBox(child,*box)&Cube::OVERLAPS)))
+			{
+			enterNodeRec(&child);
+			children[numChildren++]=&child;
+			}
 		}
+	if(numChildren==0)
+		return;
 	
-	/* Add the node to the leaf parent node list: */
-	node.lruPred=lruTail;
-	node.lruSucc=0;
-	if(lruTail!=0)
-		lruTail->lruSucc=&node;
-	else
-		lruHead=&node;
-	lruTail=&node;
+	Node* dropped[maxPrefetchQueueSize];
+	size_t numDropped=0;
+	{
+	Threads::MutexCond::Lock prefetchLock(prefetchCond);
 	
-	/* Update the node cache: */
-	numCachedNodes+=8U;
+	/* Queue the children in reverse order, so that the first child will be prefetched first: */
+	for(int i=0;i<numChildren;++i)
+		prefetchQueue.push_back(children[i]);
+	
+	/* Drop the requests furthest ahead in traversal order if the queue is too long: */
+	while(prefetchQueue.size()>maxPrefetchQueueSize)
+		{
+		dropped[numDropped++]=prefetchQueue.front();
+		prefetchQueue.pop_front();
+		}
+	
+	prefetchCond.signal();
 	}
 	
-	/* Create and load the node's children: */
+	/* Release the dropped nodes: */
+	for(size_t i=0;i<numDropped;++i)
+		leaveNodeRec(dropped[i]);
+	}
+
+void* LidarProcessOctree::prefetchThreadMethod(void)
 	{
-	#if ALLOW_THREADING
-	Threads::Mutex::Lock fileLock(fileMutex);
-	#endif
-	Node* children=new Node[8];
-	indexFile.setReadPosAbs(node.childrenOffset);
-	for(int childIndex=0;childIndex<8;++childIndex)
+	while(true)
 		{
-		Node& child=children[childIndex];
-		
-		/* Read the child node's structure: */
-		LidarOctreeFileNode ofn;
-		ofn.read(indexFile);
-		child.parent=&node;
-		child.childrenOffset=ofn.childrenOffset;
-		child.domain=Cube(node.domain,childIndex);
-		child.numPoints=ofn.numPoints;
-		child.dataOffset=ofn.dataOffset;
-		child.detailSize=ofn.detailSize;
+		/* Wait for the next node in traversal order: */
+		Node* node;
+		{
+		Threads::MutexCond::Lock prefetchLock(prefetchCond);
+		while(!stopPrefetching&&prefetchQueue.empty())
+			prefetchCond.wait(prefetchLock);
+		if(stopPrefetching)
+			break;
+		node=prefetchQueue.back();
+		prefetchQueue.pop_back();
+		}
 		
-		/* Load the child's points: */
-		if(child.numPoints>0)
-			loadPoints(child);
+		/* Load the node's children if they are still missing and fit into the cache without paging out other nodes: */
+		if(node->children==0&&numCachedNodes.get()+8U<=cacheSize)
+			{
+			try
+				{
+				subdivide(*node);
+				numPrefetchedNodes.preAdd(8);
+				}
+			catch(const std::runtime_error&)
+				{
+				/* Drop the prefetch; the traversal reaching the node will load its children again and report the error: */
+				}
+			}
 		
-		++numLoadedNodes;
+		/* Release the node: */
+		leaveNodeRec(node);
 		}
 	
-	/* Install the node's children array: */
-	node.children=children;
-	}
+	return 0;
 	}
 
+#endif
+
 void LidarProcessOctree::enterNodeRec(LidarProcessOctree::Node* node)
 	{
 	/* Enter all nodes from the root to the given node: */
@@ -278,34 +674,27 @@ LidarProcessOctree::Node* LidarProcessOctree::nextNodePrefix(LidarProcessOctree:
 		}
 	}
 
-namespace {
-
-/***********************************************************
-Helper functions to load LiDAR files given a base file name:
-***********************************************************/
-
-std::string getLidarPartFileName(const char* lidarFileName,const char* partFileName)
-	{
-	std::string result=lidarFileName;
-	result.push_back('/');
-	result.append(partFileName);
-	return result;
-	}
-
-}
-
-LidarProcessOctree::LidarProcessOctree(const char* lidarFileName,size_t sCacheSize,const char* colorsFileName)
-	:indexFile(getLidarPartFileName(lidarFileName,"Index").c_str()),
-	 pointsFile(getLidarPartFileName(lidarFileName,"Points").c_str()),
-	 colorsFile(colorsFileName!=0?new LidarFile(getLidarPartFileName(lidarFileName,colorsFileName).c_str()):0),
+LidarProcessOctree::LidarProcessOctree(const char* sLidarFileName,size_t sCacheSize,const char* sColorsFileName,bool mapDataFiles,bool sUsePointArrays)
+	:source(sLidarFileName),colorsFileName(sColorsFileName!=0?sColorsFileName:""),
+	 numLoaderFiles(0U),
+	 quantizedPoints(false),
+	 compressedPoints(0),pointsMap(0),pointArrayPool(0),colorsMap(0),
+	 usePointArrays(sUsePointArrays),
 	 offset(OffsetVector::zero),
-	 numSubdivideCalls(0),numLoadedNodes(0),
-	 lruHead(0),lruTail(0)
+	 numCachedNodes(1U),numSubdivideCalls(0),numLoadedNodes(0),
+	 numLruContentions(0),numBusyEvictionCandidates(0),numFileContentions(0),
+	 #if ALLOW_THREADING
+	 prefetching(false),stopPrefetching(false),
+	 #endif
+	 numPrefetchedNodes(0)
 	{
-	indexFile.setEndianness(Misc::LittleEndian);
-	pointsFile.setEndianness(Misc::LittleEndian);
-	if(colorsFile!=0)
-		colorsFile->setEndianness(Misc::LittleEndian);
+	/* Open the first set of file handles, which is also used to read the files' headers: */
+	loaderFiles[0]=new LoaderFiles(source,colorsFileName);
+	numLoaderFiles.preAdd(1U);
+	LoaderFiles& files=*loaderFiles[0];
+	LidarSourceFile& indexFile=*files.indexFile;
+	LidarSourceFile& pointsFile=*files.pointsFile;
+	LidarSourceFile* colorsFile=files.colorsFile;
 	
 	/* Read the octree file header: */
 	LidarOctreeFileHeader ofh(indexFile);
@@ -316,13 +705,20 @@ LidarProcessOctree::LidarProcessOctree(const char* lidarFileName,size_t sCacheSi
 	/* Initialize the tree structure: */
 	maxNumPointsPerNode=ofh.maxNumPointsPerNode;
 	
-	/* Calculate the memory and GPU cache sizes: */
+	/* Calculate the memory cache size, using half of the available physical memory if no size was given: */
 	size_t memNodeSize=sizeof(Node)+size_t(maxNumPointsPerNode)*sizeof(LidarPoint);
+	if(usePointArrays)
+		memNodeSize+=sizeof(LidarPointArrays)+size_t(maxNumPointsPerNode)*3*sizeof(Scalar);
+	if(sCacheSize==0)
+		sCacheSize=getAutoCacheSize();
 	cacheSize=(unsigned int)(sCacheSize/memNodeSize);
 	if(cacheSize==0U)
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Specified memory cache size too small");
 	std::cout<<"Cache size: "<<cacheSize<<" memory nodes"<<std::endl;
 	
+	/* Create the pool of point arrays: */
+	pointArrayPool=new PointArrayPool(size_t(maxNumPointsPerNode)*sizeof(LidarPoint),cacheSize);
+	
 	/* Read the root node's structure: */
 	LidarOctreeFileNode rootfn;
 	rootfn.read(indexFile);
@@ -336,7 +732,15 @@ LidarProcessOctree::LidarProcessOctree(const char* lidarFileName,size_t sCacheSi
 	
 	/* Read the point file's header: */
 	LidarDataFileHeader dfh(pointsFile);
-	pointsRecordSize=LidarFile::Offset(dfh.recordSize);
+	if(LidarCompressedFile::isCompressed(dfh.recordSize))
+		{
+		/* Read the compressed points file's block table: */
+		compressedPoints=new LidarCompressedFile(pointsFile);
+		pointsRecordSize=LidarFile::Offset(compressedPoints->getRecordSize());
+		}
+	else
+		pointsRecordSize=LidarFile::Offset(dfh.recordSize);
+	quantizedPoints=pointsRecordSize==LidarFile::Offset(sizeof(QuantizedLidarPoint));
 	
 	/* Read the color file's header: */
 	if(colorsFile!=0)
@@ -345,17 +749,46 @@ LidarProcessOctree::LidarProcessOctree(const char* lidarFileName,size_t sCacheSi
 		colorsRecordSize=LidarFile::Offset(dfh.recordSize);
 		}
 	
+	if(mapDataFiles&&source.isRemote())
+		{
+		/* Remote files are read through the block cache and can not be mapped; ignore the request: */
+		mapDataFiles=false;
+		}
+	if(mapDataFiles&&compressedPoints!=0)
+		{
+		/* Compressed blocks have to be decompressed on load and can not be used in place; ignore the request: */
+		mapDataFiles=false;
+		}
+	if(mapDataFiles)
+		{
+		/* Map the points file and the colors file into memory: */
+		pointsMap=new LidarMappedFile(getLidarPartFileName(sLidarFileName,"Points").c_str());
+		if(colorsFile!=0)
+			colorsMap=new LidarMappedFile(getLidarPartFileName(sLidarFileName,sColorsFileName).c_str());
+		
+		/* Check that the data files' records can be used in place: */
+		if(pointsMap->getRecordSize()!=(quantizedPoints?sizeof(QuantizedLidarPoint):sizeof(LidarPoint))||(colorsMap!=0&&colorsMap->getRecordSize()!=sizeof(Color)))
+			{
+			delete pointsMap;
+			delete colorsMap;
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Data file record sizes do not match in-memory layout");
+			}
+		}
+	
 	/* Load the root node's points: */
 	if(root.numPoints>0)
-		loadPoints(root);
+		{
+		loadPoints(root,files);
+		if(usePointArrays)
+			createPointArrays(root);
+		}
 	
-	++numLoadedNodes;
+	numLoadedNodes.preAdd(1);
 	
 	/* Try loading an offset file: */
-	try
+	if(source.hasPart("Offset"))
 		{
-		IO::FilePtr offsetFile(IO::openFile(getLidarPartFileName(lidarFileName,"Offset").c_str()));
-		offsetFile->setEndianness(Misc::LittleEndian);
+		Misc::SelfDestructPointer<LidarSourceFile> offsetFile(source.openPart("Offset"));
 		
 		/* Read the original offset vector: */
 		offsetFile->read(offset.getComponents(),3);
@@ -363,19 +796,91 @@ LidarProcessOctree::LidarProcessOctree(const char* lidarFileName,size_t sCacheSi
 		/* Invert the offset transformation: */
 		offset=-offset;
 		}
-	catch(const IO::File::OpenError& err)
+	
+	/* Load the optional node summaries: */
+	loadSummaries();
+	}
+
+LidarProcessOctree::~LidarProcessOctree(void)
+	{
+	#if ALLOW_THREADING
+	if(prefetching)
 		{
-		/* Ignore the error */
+		/* Shut down the prefetching thread: */
+		{
+		Threads::MutexCond::Lock prefetchLock(prefetchCond);
+		stopPrefetching=true;
+		prefetchCond.signal();
 		}
+		prefetchThread.join();
+		
+		/* Release all nodes still in the prefetch queue: */
+		for(std::deque<Node*>::iterator pqIt=prefetchQueue.begin();pqIt!=prefetchQueue.end();++pqIt)
+			leaveNodeRec(*pqIt);
+		}
+	#endif
+	
+	/* Delete the octree's nodes below the root, and recycle the root's point array: */
+	if(root.children!=0)
+		deleteChildren(root.children);
+	root.children=0;
+	if(!root.pointsMapped)
+		pointArrayPool->free(const_cast<LidarPoint*>(root.points));
+	root.points=0;
+	delete pointArrayPool;
+	
+	/* Unmap the data files: */
+	delete pointsMap;
+	delete colorsMap;
+	for(std::vector<LidarMappedFile*>::iterator acIt=attributeChannels.begin();acIt!=attributeChannels.end();++acIt)
+		delete *acIt;
 	
-	/* Initialize the node cache: */
-	numCachedNodes=1U;
+	/* Close all sets of file handles: */
+	unsigned int numFiles=numLoaderFiles.get();
+	for(unsigned int i=0;i<numFiles;++i)
+		delete loaderFiles[i];
+	
+	/* Delete the compressed points file's block table: */
+	delete compressedPoints;
 	}
 
-LidarProcessOctree::~LidarProcessOctree(void)
+void LidarProcessOctree::startPrefetching(void)
 	{
-	/* Close the additional colors file: */
-	delete colorsFile;
+	#if ALLOW_THREADING
+	if(!prefetching)
+		{
+		/* Start the prefetching thread: */
+		prefetching=true;
+		prefetchThread.start(this,&LidarProcessOctree::prefetchThreadMethod);
+		}
+	#endif
+	}
+
+bool LidarProcessOctree::hasAttributeChannel(const char* channelName) const
+	{
+	/* Attribute channels are memory-mapped, and are not available from remote LiDAR files: */
+	return !source.isRemote()&&access(getLidarAttributeFileName(source.getLidarFileName().c_str(),channelName).c_str(),R_OK)==0;
+	}
+
+unsigned int LidarProcessOctree::addAttributeChannel(const char* channelName)
+	{
+	/* Return the channel's index if it is already mapped: */
+	for(unsigned int i=0;i<attributeChannelNames.size();++i)
+		if(attributeChannelNames[i]==channelName)
+			return i;
+	
+	if(source.isRemote())
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Attribute channel %s can not be mapped from remote LiDAR file %s",channelName,source.getLidarFileName().c_str());
+	
+	/* Map the channel's data file; its records are only read when nodes' attributes are accessed: */
+	LidarMappedFile* channel=new LidarMappedFile(getLidarAttributeFileName(source.getLidarFileName().c_str(),channelName).c_str());
+	attributeChannelNames.push_back(channelName);
+	attributeChannels.push_back(channel);
+	
+	/* Read the root node's records ahead; the records of all other nodes are read ahead when the nodes are loaded: */
+	channel->adviseWillNeed(root.dataOffset,root.numPoints);
+	
+	return (unsigned int)(attributeChannels.size()-1);
 	}
 
 Point LidarProcessOctree::getRootCenter(void) const
@@ -1,6 +1,6 @@
 /***********************************************************************
 LidarProcessOctree - Class to process multiresolution LiDAR point sets.
-Copyright (c) 2008-2023 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -26,16 +26,32 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #define OPTIMIZED_TRAVERSAL 1
 #define ALLOW_THREADING 1
 
+#include <string>
+#include <vector>
 #if ALLOW_THREADING
+#include <deque>
 #include <Threads/Mutex.h>
-#include <Threads/Atomic.h>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
 #endif
+#include <Threads/Atomic.h>
 #include <Math/Math.h>
 #include <Geometry/Vector.h>
 
 #include "LidarTypes.h"
 #include "Cube.h"
 #include "LidarFile.h"
+#include "LidarSource.h"
+#include "LidarPointArrays.h"
+#include "LidarMappedFile.h"
+#include "LidarQuantization.h"
+#include "LidarDataBlock.h"
+#include "PointArrayPool.h"
+#include "LidarAttributes.h"
+#include "LidarNodeSummary.h"
+
+/* Forward declarations: */
+class LidarCompressedFile;
 
 class LidarProcessOctree
 	{
@@ -53,12 +69,15 @@ class LidarProcessOctree
 		#endif
 		Node* parent; // Pointer to node's parent node; 0 for root
 		LidarFile::Offset childrenOffset; // Offset of the node's children in the octree file (0 if node is a leaf)
+		size_t index; // Index of the node in the octree file, in the order in which nodes are stored
 		Node* children; // Pointer to an array of eight child nodes (0 if node is a leaf or children are paged out)
 		Cube domain; // Node's domain
 		unsigned int numPoints; // Number of LiDAR points belonging to this node
 		Scalar detailSize; // Detail size of this node, for proper LOD computation
 		LidarFile::Offset dataOffset; // Offset of the node's data in the octree's data file(s) in units of record size
-		LidarPoint* points; // Pointer to the LiDAR points belonging to this node
+		const LidarPoint* points; // Pointer to the LiDAR points belonging to this node, which are read-only as they might live in a read-only memory-mapped points file
+		bool pointsMapped; // Flag whether the node's point array points directly into a memory-mapped points file
+		LidarPointArrays* pointArrays; // Structure-of-arrays view of the node's points, or 0 if point arrays are disabled
 		unsigned int processCounter; // Number of processes who have entered this node's subtree
 		Node* lruPred; // Pointer to previous leaf parent node
 		Node* lruSucc; // Pointer to next leaf parent node
@@ -82,7 +101,7 @@ class LidarProcessOctree
 		/* Constructors and destructors: */
 		private:
 		Node(void); // Creates a leaf node without points
-		~Node(void); // Destroys a node and its subtree
+		~Node(void); // Destroys a node; its point array and subtree are released by the octree
 		
 		/* Methods: */
 		public:
@@ -90,6 +109,10 @@ class LidarProcessOctree
 			{
 			return childrenOffset==LidarFile::Offset(0);
 			}
+		size_t getIndex(void) const // Returns the node's index in the octree file; the root node has index 0
+			{
+			return index;
+			}
 		const Cube& getDomain(void) const // Returns the node's domain
 			{
 			return domain;
@@ -114,6 +137,10 @@ class LidarProcessOctree
 			{
 			return points[index];
 			}
+		const LidarPointArrays* getPointArrays(void) const // Returns the node's structure-of-arrays view, or 0 if point arrays are disabled
+			{
+			return pointArrays;
+			}
 		};
 	
 	class NodeIterator // Class to iterate through all nodes in an octree
@@ -302,55 +329,213 @@ class LidarProcessOctree
 	
 	friend class NodeIterator;
 	
+	private:
+	#if ALLOW_THREADING
+	template <class NodeProcessFunctorParam>
+	class ParallelTraversal; // Helper class to traverse the octree with a pool of work-stealing threads
+	#endif
+	
+	struct LoaderFiles // Structure holding a set of octree file handles used by one subdividing thread at a time
+		{
+		/* Elements: */
+		public:
+		#if ALLOW_THREADING
+		Threads::Mutex mutex; // Mutex held by the thread currently using this set of file handles
+		#endif
+		LidarSourceFile* indexFile; // The file containing the octree's structural data
+		LidarSourceFile* pointsFile; // The file containing the octree's point data
+		LidarSourceFile* colorsFile; // Pointer to an additional file containing the octree's color data
+		QuantizedLidarPoint* quantizedPointsBuffer; // Staging buffer for the quantized points of one node, allocated on first use
+		Color* colorsBuffer; // Staging buffer for the additional colors of one node, allocated on first use
+		
+		/* Constructors and destructors: */
+		LoaderFiles(const LidarSource& source,const std::string& colorsFileName); // Opens a new set of file handles for the given LiDAR file and optional additional colors file
+		~LoaderFiles(void);
+		};
+	
+	class LoaderFilesLock // Helper class to acquire an unused set of file handles for the lifetime of the lock
+		{
+		/* Elements: */
+		private:
+		LidarProcessOctree& octree; // The octree owning the set of file handles
+		LoaderFiles& files; // The acquired set of file handles
+		
+		/* Constructors and destructors: */
+		public:
+		LoaderFilesLock(LidarProcessOctree& sOctree) // Acquires an unused set of file handles from the given octree
+			:octree(sOctree),files(octree.acquireLoaderFiles())
+			{
+			}
+		private:
+		LoaderFilesLock(const LoaderFilesLock& source); // Prohibit copy constructor
+		LoaderFilesLock& operator=(const LoaderFilesLock& source); // Prohibit assignment operator
+		public:
+		~LoaderFilesLock(void) // Releases the set of file handles
+			{
+			octree.releaseLoaderFiles(files);
+			}
+		
+		/* Methods: */
+		LoaderFiles& getFiles(void) // Returns the acquired set of file handles
+			{
+			return files;
+			}
+		};
+	
+	struct DataBlocks // Structure holding the records of all children of a node, read in one request per data file
+		{
+		/* Elements: */
+		public:
+		LidarDataBlock<LidarPoint> points; // Block of points if the points file contains unquantized points
+		LidarDataBlock<QuantizedLidarPoint> quantizedPoints; // Block of points if the points file contains quantized points
+		LidarDataBlock<Color> colors; // Block of colors from the additional colors file
+		};
+	
+	struct LruShard // Structure for an independently locked part of the leaf parent node list
+		{
+		/* Elements: */
+		public:
+		#if ALLOW_THREADING
+		Threads::Mutex mutex; // Mutex to serialize access to this part of the list
+		#endif
+		Node* head; // Head of this part's leaf parent node list
+		Node* tail; // Tail of this part's leaf parent node list
+		
+		/* Constructors and destructors: */
+		LruShard(void)
+			:head(0),tail(0)
+			{
+			}
+		};
+	
+	#if ALLOW_THREADING
+	static const unsigned int numLruShards=16; // Number of parts of the leaf parent node list
+	static const unsigned int maxNumLoaderFiles=64; // Maximum number of sets of file handles opened by concurrently subdividing threads
+	static const size_t maxPrefetchQueueSize=64; // Maximum number of nodes waiting to be subdivided by the prefetching thread
+	#else
+	static const unsigned int numLruShards=1;
+	static const unsigned int maxNumLoaderFiles=1;
+	#endif
+	
 	/* Elements: */
 	private:
+	LidarSource source; // The local or remote LiDAR file
+	std::string colorsFileName; // Name of the additional colors file inside the LiDAR file, or empty
 	#if ALLOW_THREADING
-	Threads::Mutex fileMutex; // Mutex to serialize access to the underlying LiDAR files
+	Threads::Mutex loaderFilesMutex; // Mutex to serialize opening new sets of file handles
 	#endif
-	LidarFile indexFile; // The file containing the octree's structural data
-	LidarFile pointsFile; // The file containing the octree's point data
+	LoaderFiles* loaderFiles[maxNumLoaderFiles]; // Pool of sets of file handles
+	Threads::Atomic<unsigned int> numLoaderFiles; // Number of sets of file handles opened so far
 	LidarFile::Offset pointsRecordSize; // Record size of points file
-	LidarFile* colorsFile; // Pointer to an additional file containing the octree's color data
+	bool quantizedPoints; // Flag whether the points file contains points quantized relative to their nodes' domains
 	LidarFile::Offset colorsRecordSize; // Record size of colors file
+	LidarCompressedFile* compressedPoints; // Block table of the points file if it is compressed, or 0
+	LidarMappedFile* pointsMap; // Optional memory mapping of the points file
+	PointArrayPool* pointArrayPool; // Pool of point arrays of maximum node size
+	LidarMappedFile* colorsMap; // Optional memory mapping of the additional colors file
+	std::vector<std::string> attributeChannelNames; // Names of the per-point attribute channels requested by the application
+	std::vector<LidarMappedFile*> attributeChannels; // Memory mappings of the requested attribute channels' data files
+	std::vector<LidarNodeSummary> summaries; // Summaries of all nodes' subtrees indexed by node index, or empty if the LiDAR file has no summaries file
+	bool usePointArrays; // Flag whether to create structure-of-arrays views of all loaded nodes' points
 	size_t numNodes; // Total number of nodes in the octree
 	unsigned int maxNumPointsPerNode; // Maximum number of points per node
 	OffsetVector offset; // Offset that needs to be added to LiDAR points to transform them back to source coordinates
 	Node root; // Root node
 	unsigned int cacheSize; // Maximum number of nodes that can be held in memory
-	unsigned int numCachedNodes; // Number of nodes currently held in memory
-	size_t numSubdivideCalls; // Total number of calls to the subdivide method
-	size_t numLoadedNodes; // Total number of nodes that had to be loaded from file
+	Threads::Atomic<unsigned int> numCachedNodes; // Number of nodes currently held in memory
+	Threads::Atomic<size_t> numSubdivideCalls; // Total number of calls to the subdivide method
+	Threads::Atomic<size_t> numLoadedNodes; // Total number of nodes that had to be loaded from file
+	LruShard lruShards[numLruShards]; // Leaf parent node list, split into independently locked parts
+	Threads::Atomic<size_t> numLruContentions; // Number of times a thread had to wait for a part of the leaf parent node list
+	Threads::Atomic<size_t> numBusyEvictionCandidates; // Number of leaf parent nodes skipped during eviction because they were locked or in use
+	Threads::Atomic<size_t> numFileContentions; // Number of times a subdividing thread did not find an unused set of file handles
 	#if ALLOW_THREADING
-	Threads::Mutex lruMutex; // Mutex to serialize access to the LRU list
+	bool prefetching; // Flag whether traversals queue nodes for the prefetching thread
+	Threads::MutexCond prefetchCond; // Condition variable to serialize access to the prefetch queue and wake up the prefetching thread
+	std::deque<Node*> prefetchQueue; // Queue of entered nodes to subdivide ahead of traversals; the next node in traversal order is at the back
+	bool stopPrefetching; // Flag to shut down the prefetching thread
+	Threads::Thread prefetchThread; // Thread subdividing queued nodes in the background
 	#endif
-	Node* lruHead; // Head of leaf parent node list
-	Node* lruTail; // Tail of leaf parent node list
+	Threads::Atomic<size_t> numPrefetchedNodes; // Number of nodes loaded by the prefetching thread
 	
 	/* Private methods: */
-	void loadPoints(Node& node); // Loads the given node's points from the points and additional files
-	void subdivide(Node& node); // Subdivides the given parent node
+	void loadPoints(Node& node,LoaderFiles& files,const DataBlocks* blocks =0); // Loads the given node's points from the given set of file handles, or from the given blocks read together with the node's siblings
+	void deleteChildren(Node* children); // Deletes the given array of eight child nodes and all their descendants, and returns their point arrays to the point array pool
+	void createPointArrays(Node& node); // Creates the structure-of-arrays view of the given node's loaded points
+	LruShard& getLruShard(const Node& node) // Returns the part of the leaf parent node list responsible for the given interior node
+		{
+		return lruShards[size_t(node.childrenOffset/LidarFile::Offset(8*LidarOctreeFileNode::getFileSize()))%numLruShards];
+		}
+	void lockLruShard(LruShard& shard); // Locks the given part of the leaf parent node list
+	void unlockLruShard(LruShard& shard); // Unlocks the given part of the leaf parent node list
+	void addLeafParent(Node& node); // Adds the given node to the end of the leaf parent node list if it is not already in it
+	void removeLeafParent(Node& node); // Removes the given node from the leaf parent node list if it is in it
+	void coarsen(unsigned int firstShardIndex); // Removes the children of one unused leaf parent node, starting the search in the given part of the leaf parent node list
+	LoaderFiles& acquireLoaderFiles(void); // Returns an unused set of file handles, locked by the calling thread
+	void releaseLoaderFiles(LoaderFiles& files); // Releases a set of file handles acquired by the calling thread
+	void subdivide(Node& node); // Subdivides the given parent node; leaves the node unchanged if its children can not be loaded
+	void loadSummaries(void); // Loads the node summaries file if it exists and matches the octree file
+	int compareNodeBox(const Node& node,const Box& box) const // Compares the given node against the given box, using the node's summary if available
+		{
+		int result=node.domain.compareBox(box);
+		if(result==Cube::OVERLAPS&&!summaries.empty())
+			result=summaries[node.index].compareBox(box);
+		return result;
+		}
+	bool nodeInSphere(const Node& node,const Point& center,Scalar radius2) const // Returns true if the given node may contain points inside the given sphere, using the node's summary if available
+		{
+		if(node.domain.sqrDist(center)>radius2)
+			return false;
+		return summaries.empty()||summaries[node.index].sqrDist(center)<=radius2;
+		}
+	#if ALLOW_THREADING
+	void queuePrefetches(Node& node,const Box* box); // Queues the given node's unloaded interior children overlapping the given box, or all if box is null, for the prefetching thread
+	void* prefetchThreadMethod(void); // Thread method subdividing queued nodes while there is room in the node cache
+	#endif
+	void prefetchChildren(Node& node,const Box* box =0) // Queues the given node's children for the prefetching thread if prefetching is enabled
+		{
+		#if ALLOW_THREADING
+		if(prefetching)
+			queuePrefetches(node,box);
+		#endif
+		}
 	template <class NodeProcessFunctorParam>
 	void processNodesPrefix(Node& node,unsigned int nodeLevel,NodeProcessFunctorParam& processFunctor); // Recursive node processor for octree in pre-fix order
 	template <class NodeProcessFunctorParam>
 	void processNodesPostfix(Node& node,unsigned int nodeLevel,NodeProcessFunctorParam& processFunctor); // Recursive node processor for octree in post-fix order
+	template <class NodeProcessFunctorParam>
+	void processNodesInBoxPrefix(Node& node,unsigned int nodeLevel,const Box& box,NodeProcessFunctorParam& processFunctor); // Recursive node processor for octree nodes overlapping a box in pre-fix order
+	template <class NodeProcessFunctorParam>
+	void processNodesOnPath(Node& node,unsigned int nodeLevel,const Point& point,NodeProcessFunctorParam& processFunctor); // Recursive node processor for octree nodes containing a point
 	template <class ProcessFunctorParam>
 	void processPoints(Node& node,ProcessFunctorParam& processFunctor); // Recursive point processor
 	template <class ProcessFunctorParam>
 	void processPointsInBox(Node& node,const Box& box,ProcessFunctorParam& processFunctor); // Recursive point processor
+	template <class BatchProcessFunctorParam>
+	void processPointsInBoxBatched(Node& node,const Box& box,BatchProcessFunctorParam& processFunctor); // Recursive batched point processor
+	template <class ProcessFunctorParam>
+	void processPointsInBoxWithClasses(Node& node,const Box& box,Misc::UInt32 classMask,unsigned int channelIndex,ProcessFunctorParam& processFunctor); // Recursive class-filtered point processor
 	template <class DirectedProcessFunctorParam>
 	static void processPointsDirectedKdtree(const LidarPoint* points,unsigned int left,unsigned int right,unsigned int splitDimension,DirectedProcessFunctorParam& processFunctor); // Recursive directed point processor for intra-node kd-tree
 	template <class DirectedProcessFunctorParam>
 	void processPointsDirectedOctree(Node& node,DirectedProcessFunctorParam& processFunctor); // Recursive directed point processor for octree
+	template <class SphereProcessFunctorParam>
+	void processPointsInSphere(Node& node,SphereProcessFunctorParam& processFunctor); // Recursive point processor for octree
+	template <class NodePairProcessFunctorParam>
+	void processNodePairs(Node& node1,LidarProcessOctree& octree2,const Vector& offset2,NodePairProcessFunctorParam& processFunctor); // Recursive node pair processor descending through this octree
+	template <class NodePairProcessFunctorParam>
+	void processLeafPairs(Node& leaf1,const Cube& leafDomain2,Node& node2,NodePairProcessFunctorParam& processFunctor); // Recursive node pair processor pairing a leaf of another octree with nodes of this octree
 	static void enterNodeRec(Node* node); // Locks a node and all its ancestors
 	static void leaveNodeRec(Node* node); // Unlocks a node and all its ancestors
 	Node* nextNodePrefix(Node* node); // Returns the next node after the given one in prefix traversal order
 	
 	/* Constructors and destructors: */
 	public:
-	LidarProcessOctree(const char* lidarFileName,size_t sCacheSize,const char* colorsFileName =0); // Creates octree from the given octree file; cache size is in bytes
+	LidarProcessOctree(const char* sLidarFileName,size_t sCacheSize,const char* sColorsFileName =0,bool mapDataFiles =false,bool sUsePointArrays =false); // Creates octree from the given octree file; cache size is in bytes, or zero to use half of the available physical memory; reads point data from memory-mapped files if first flag is true; creates structure-of-arrays views of all nodes' points if second flag is true
 	~LidarProcessOctree(void);
 	
 	/* Methods: */
+	void startPrefetching(void); // Starts a background thread loading nodes ahead of traversals without exceeding the cache size; does nothing if threading is disabled
 	unsigned int getMaxNumPointsPerNode(void) const // Returns the maximum number of points stored in each octree node
 		{
 		return maxNumPointsPerNode;
@@ -369,6 +554,31 @@ class LidarProcessOctree
 		{
 		return numNodes;
 		}
+	bool areDataFilesMapped(void) const // Returns true if point data is read from memory-mapped files
+		{
+		return pointsMap!=0;
+		}
+	bool hasAttributeChannel(const char* channelName) const; // Returns true if the LiDAR file contains the named per-point attribute channel
+	unsigned int addAttributeChannel(const char* channelName); // Maps the named per-point attribute channel if it is not already mapped and returns its index; must be called before any traversals start; throws exception if the channel does not exist
+	unsigned int getAttributeRecordSize(unsigned int channelIndex) const // Returns the size of one record in the given attribute channel in bytes
+		{
+		return attributeChannels[channelIndex]->getRecordSize();
+		}
+	template <class RecordParam>
+	const RecordParam* getAttributes(const Node& node,unsigned int channelIndex) const // Returns the given node's records in the given attribute channel in the same order as its points; records stay valid while the octree exists
+		{
+		const LidarMappedFile* channel=attributeChannels[channelIndex];
+		channel->checkRecords(node.dataOffset,node.numPoints);
+		return channel->getRecords<RecordParam>(node.dataOffset);
+		}
+	bool hasSummaries(void) const // Returns true if node summaries are available
+		{
+		return !summaries.empty();
+		}
+	const LidarNodeSummary* getNodeSummary(const Node& node) const // Returns the summary of the given node's subtree, or 0 if node summaries are not available
+		{
+		return !summaries.empty()?&summaries[node.index]:0;
+		}
 	Node* getChild(Node* node,int childIndex) // Returns a child node of the given node
 		{
 		/* Check if the node is an interior node: */
@@ -405,6 +615,25 @@ class LidarProcessOctree
 		/* Call recursive node processor on the root node: */
 		processNodesPostfix(root,0,processFunctor);
 		}
+	template <class NodeProcessFunctorParam>
+	void processNodesInBoxPrefix(const Box& box,NodeProcessFunctorParam& processFunctor) // Calls given functor for each octree node whose domain overlaps the given box in pre-fix order
+		{
+		/* Call recursive node processor on the root node: */
+		processNodesInBoxPrefix(root,0,box,processFunctor);
+		}
+	template <class NodeProcessFunctorParam>
+	void processNodesOnPath(const Point& point,NodeProcessFunctorParam& processFunctor) // Calls given functor for each octree node whose domain contains the given point, from the root down to a leaf
+		{
+		/* Call recursive node processor on the root node if it contains the point: */
+		if(root.domain.contains(point))
+			processNodesOnPath(root,0,point,processFunctor);
+		}
+	template <class NodeProcessFunctorParam>
+	void processNodesPrefixParallel(NodeProcessFunctorParam& processFunctor,unsigned int numThreads); // Calls given functor for each octree node from the given number of threads; each node is processed before its children; functor must be thread-safe and must not throw
+	template <class NodeProcessFunctorParam>
+	void processNodesPostfixParallel(NodeProcessFunctorParam& processFunctor,unsigned int numThreads); // Calls given functor for each octree node from the given number of threads; each interior node is processed by the thread completing its last child; functor must be thread-safe and must not throw
+	template <class NodeProcessFunctorParam>
+	void processNodesInBoxPrefixParallel(const Box& box,NodeProcessFunctorParam& processFunctor,unsigned int numThreads); // Calls given functor for each octree node whose domain overlaps the given box from the given number of threads; each node is processed before its children; functor must be thread-safe and must not throw
 	template <class ProcessFunctorParam>
 	void processPoints(ProcessFunctorParam& processFunctor) // Calls given functor for each LiDAR point stored in the octree
 		{
@@ -417,12 +646,34 @@ class LidarProcessOctree
 		/* Call recursive point processor on the root node: */
 		processPointsInBox(root,box,processFunctor);
 		}
+	template <class BatchProcessFunctorParam>
+	void processPointsInBoxBatched(const Box& box,BatchProcessFunctorParam& processFunctor) // Calls given functor with arrays of LiDAR points stored in the octree that are inside the given box; uses point arrays if enabled
+		{
+		/* Call recursive batched point processor on the root node: */
+		processPointsInBoxBatched(root,box,processFunctor);
+		}
+	template <class ProcessFunctorParam>
+	void processPointsInBox(const Box& box,Misc::UInt32 classMask,unsigned int classificationChannelIndex,ProcessFunctorParam& processFunctor) // Calls given functor for each LiDAR point stored in the octree that is inside the given box and whose classification's bit (see LidarNodeSummary::getClassBit) is set in the given mask; classifications are read from the given attribute channel, which must have been added as "Classification"
+		{
+		/* Call recursive class-filtered point processor on the root node: */
+		processPointsInBoxWithClasses(root,box,classMask,classificationChannelIndex,processFunctor);
+		}
 	template <class DirectedProcessFunctorParam>
 	void processPointsDirected(DirectedProcessFunctorParam& processFunctor) // Calls given functor for each LiDAR point stored in the octree in order of distance from a query point
 		{
 		/* Call recursive directed point processor on the root node: */
 		processPointsDirectedOctree(root,processFunctor);
 		}
+	template <class SphereProcessFunctorParam>
+	void processPointsInSphere(SphereProcessFunctorParam& processFunctor) // Calls given functor for each LiDAR point stored in the octree that is inside the functor's query sphere, in no particular order; uses point arrays if enabled
+		{
+		/* Call recursive sphere point processor on the root node: */
+		processPointsInSphere(root,processFunctor);
+		}
+	template <class NodePairProcessFunctorParam>
+	void processNodePairs(LidarProcessOctree& octree2,NodePairProcessFunctorParam& processFunctor); // Calls given functor for all pairs of non-empty leaf nodes from this and the given octree whose domains lie within the functor's maximum distance in the second octree's coordinate space; each non-empty leaf of this octree is bracketed by calls to the functor's beginLeaf and endLeaf methods, with all its pairs processed in between, closest partners first
+	template <class QueryPointParam,class KNearestHeapParam,class KNearestResultFunctorParam>
+	void processKNearestNeighbors(const QueryPointParam* queryPoints,unsigned int numQueryPoints,KNearestHeapParam& heap,Scalar maxDist2,KNearestResultFunctorParam& resultFunctor); // Finds the nearest neighbors within the given squared distance of a batch of query points using the given KNearestNeighborHeap, and calls the result functor with each query point's index and its sorted heap; bounds each search by the previous query's neighborhood, so consecutive query points should be spatially adjacent, e.g., all points of one node
 	NodeIterator beginNodes(void) // Returns iterator to the first node (root)
 		{
 		return NodeIterator(this,&root);
@@ -433,11 +684,31 @@ class LidarProcessOctree
 		}
 	size_t getNumSubdivideCalls(void) const // Returns total number of calls to the subdivide method
 		{
-		return numSubdivideCalls;
+		return numSubdivideCalls.get();
 		}
 	size_t getNumLoadedNodes(void) const // Returns total number of nodes loaded from file
 		{
-		return numLoadedNodes;
+		return numLoadedNodes.get();
+		}
+	size_t getNumLruContentions(void) const // Returns the number of times a thread had to wait for a part of the leaf parent node list
+		{
+		return numLruContentions.get();
+		}
+	size_t getNumBusyEvictionCandidates(void) const // Returns the number of leaf parent nodes skipped during eviction because they were locked or in use
+		{
+		return numBusyEvictionCandidates.get();
+		}
+	size_t getNumFileContentions(void) const // Returns the number of times a subdividing thread did not find an unused set of file handles
+		{
+		return numFileContentions.get();
+		}
+	unsigned int getNumLoaderFiles(void) const // Returns the number of sets of file handles opened by subdividing threads
+		{
+		return numLoaderFiles.get();
+		}
+	size_t getNumPrefetchedNodes(void) const // Returns the number of nodes loaded ahead of traversals by the prefetching thread
+		{
+		return numPrefetchedNodes.get();
 		}
 	};
 
@@ -470,6 +741,22 @@ class DirectedProcessFunctor
 	Scalar getQueryRadius2(void) const; // Returns the square of the query sphere radius
 	};
 
+class SphereProcessFunctor
+	{
+	/* Methods: */
+	public:
+	void operator()(const LidarPoint& point); // Processes the given LiDAR point inside the query sphere
+	const Point& getQueryPoint(void) const; // Returns the center of the query sphere
+	Scalar getQueryRadius2(void) const; // Returns the square of the query sphere radius; re-read after each block of points
+	};
+
+class BatchProcessFunctor
+	{
+	/* Methods: */
+	public:
+	void operator()(const LidarPoint* points,size_t numPoints); // Processes the given array of LiDAR points inside the query box
+	};
+
 #endif
 
 #ifndef LIDARPROCESSOCTREE_IMPLEMENTATION
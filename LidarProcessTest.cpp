@@ -1,6 +1,6 @@
 /***********************************************************************
-LidarProcessTest - Test program for the LiDAR processing octree data
-structure.
+LidarProcessTest - Benchmark program for the query kernels of the LiDAR
+processing octree data structure.
 Copyright (c) 2008-2022 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
@@ -24,40 +24,23 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string>
 #include <iostream>
 #include <vector>
-#include <Misc/File.h>
 #include <Misc/Timer.h>
-#include <IO/File.h>
-#include <IO/OpenFile.h>
-#include <Threads/Thread.h>
+#include <Threads/Atomic.h>
+#include <Math/Math.h>
 #include <Math/Constants.h>
-#include <Math/Random.h>
-#include <Geometry/ArrayKdTree.h>
 
 #include "LidarTypes.h"
 #include "LidarProcessOctree.h"
+#include "KNearestNeighborHeap.h"
 
-#if 0
+namespace {
 
-int main(int argc,char* argv[])
-	{
-	LidarProcessOctree lpo(argv[1],512*1024*1024);
-	
-	Misc::Timer t;
-	
-	size_t numLeafPoints=0;
-	for(LidarProcessOctree::PointIterator pIt=lpo.beginNodes();pIt!=lpo.endNodes();++pIt)
-		++numLeafPoints;
-	
-	t.elapse();
-	std::cout<<numLeafPoints<<" leaf points, ";
-	std::cout<<"done in "<<t.getTime()*1000.0<<" ms"<<std::endl;
-	
-	return 0;
-	}
-
-#elif 1
+/**************
+Kernel functors:
+**************/
 
 class PointCounter // Functor class to count the number of points stored in an octree file
 	{
@@ -83,784 +66,539 @@ class PointCounter // Functor class to count the number of points stored in an o
 		}
 	};
 
-class DirectedProcessFunctor
+class ParallelPointCounter // Thread-safe functor class to count the number of points in an octree file's leaf nodes, optionally only those inside a box
 	{
 	/* Elements: */
-	protected:
-	Point queryPoint;
-	Scalar queryRadius2;
+	private:
+	const Box* box; // Box against which to test points, or null
+	Threads::Atomic<size_t> numPoints;
 	
 	/* Constructors and destructors: */
 	public:
-	DirectedProcessFunctor(const Point& sQueryPoint,Scalar sQueryRadius2)
-		:queryPoint(sQueryPoint),queryRadius2(sQueryRadius2)
+	ParallelPointCounter(const Box* sBox)
+		:box(sBox),numPoints(0)
 		{
 		}
 	
 	/* Methods: */
-	const Point& getQueryPoint(void) const
-		{
-		return queryPoint;
-		}
-	Scalar getQueryRadius2(void) const
-		{
-		return queryRadius2;
-		}
-	};
-
-class NeighborCounter:public DirectedProcessFunctor
-	{
-	public:
-	size_t numPoints;
-	
-	NeighborCounter(const Point& queryPoint,Scalar queryRadius2)
-		:DirectedProcessFunctor(queryPoint,queryRadius2),
-		 numPoints(0)
-		{
-		}
-	
-	void operator()(const LidarPoint& point)
-		{
-		++numPoints;
-		}
-	};
-
-class PointDensityCalculator
-	{
-	struct ThreadArgs
-		{
-		unsigned int numPoints;
-		const LidarPoint* points;
-		size_t numNeighbors;
-		};
-	
-	LidarProcessOctree& lpo;
-	Scalar neighborhoodRadius;
-	int numThreads;
-	Threads::Thread* threads;
-	ThreadArgs* threadArgs;
-	public:
-	size_t numPoints;
-	size_t totalNumNeighbors;
-	
-	void* processThreadMethod(ThreadArgs* args)
-		{
-		args->numNeighbors=0;
-		for(unsigned int i=0;i<args->numPoints;++i)
-			{
-			NeighborCounter nc(args->points[i],neighborhoodRadius*neighborhoodRadius);
-			lpo.processPointsDirected(nc);
-			args->numNeighbors+=nc.numPoints;
-			}
-		
-		return 0;
-		}
-	
-	PointDensityCalculator(LidarProcessOctree& sLpo,Scalar sNeighborhoodRadius,int sNumThreads)
-		:lpo(sLpo),
-		 neighborhoodRadius(sNeighborhoodRadius),
-		 numThreads(sNumThreads),threads(new Threads::Thread[numThreads]),threadArgs(new ThreadArgs[numThreads]),
-		 numPoints(0),totalNumNeighbors(0)
-		{
-		}
-	~PointDensityCalculator(void)
-		{
-		delete[] threads;
-		delete[] threadArgs;
-		}
-	
 	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
 		{
-		if(!node.isLeaf()||node.getNumPoints()==0)
+		if(!node.isLeaf())
 			return;
 		
-		for(int i=0;i<numThreads;++i)
+		if(box!=0)
 			{
-			unsigned int firstPoint=(node.getNumPoints()*i)/numThreads;
-			unsigned int lastPoint=(node.getNumPoints()*(i+1))/numThreads;
-			threadArgs[i].numPoints=lastPoint-firstPoint;
-			threadArgs[i].points=node.getPoints()+firstPoint;
-			threads[i].start(this,&PointDensityCalculator::processThreadMethod,&threadArgs[i]);
+			/* Count the node's points that are inside the box: */
+			size_t numInside=0;
+			for(unsigned int i=0;i<node.getNumPoints();++i)
+				if(box->contains(node[i]))
+					++numInside;
+			numPoints.preAdd(numInside);
 			}
-		for(int i=0;i<numThreads;++i)
-			{
-			threads[i].join();
-			totalNumNeighbors+=threadArgs[i].numNeighbors;
-			}
-		numPoints+=node.getNumPoints();
-		}
-	void operator()(const LidarPoint& point)
-		{
-		++numPoints;
-		NeighborCounter nc(point,neighborhoodRadius*neighborhoodRadius);
-		lpo.processPointsDirected(nc);
-		totalNumNeighbors+=nc.numPoints;
-		}
-	};
-
-class PointSaver
-	{
-	/* Elements: */
-	private:
-	Misc::File resultFile;
-	
-	/* Constructors and destructors: */
-	public:
-	PointSaver(const char* resultFileName)
-		:resultFile(resultFileName,"wb")
-		{
-		}
-	
-	/* Methods: */
-	void operator()(const LidarPoint& point)
-		{
-		fprintf(resultFile.getFilePtr(),"%.10f %.10f %.10f %03d %03d %03d\n",point[0],point[1],point[2],point.value[0],point.value[1],point.value[2]);
-		}
-	};
-
-class BinaryPointSaver
-	{
-	/* Elements: */
-	private:
-	IO::SeekableFilePtr resultFile;
-	size_t numPoints;
-	
-	/* Constructors and destructors: */
-	public:
-	BinaryPointSaver(const char* resultFileName)
-		:resultFile(IO::openSeekableFile(resultFileName,IO::File::WriteOnly)),
-		 numPoints(0)
-		{
-		/* Write the initial number of points: */
-		resultFile->setEndianness(Misc::LittleEndian);
-		resultFile->write<unsigned int>(0);
-		}
-	~BinaryPointSaver(void)
-		{
-		/* Write the final number of points: */
-		resultFile->setWritePosAbs(0);
-		resultFile->write<unsigned int>(numPoints);
-		std::cout<<numPoints<<" points written to binary file"<<std::endl;
+		else
+			numPoints.preAdd(node.getNumPoints());
 		}
-	
-	/* Methods: */
-	void operator()(const LidarPoint& point)
+	size_t getNumPoints(void) const
 		{
-		float pd[4];
-		for(int i=0;i<3;++i)
-			pd[i]=float(point[i]);
-		pd[3]=float(point.value[0])*0.3f+float(point.value[1])*0.59f+float(point.value[2])*0.11f;
-		resultFile->write(pd,4);
-		++numPoints;
+		return numPoints.get();
 		}
 	};
 
-class LasPointSaver
+class NeighborCounter // Functor class to count the number of points inside a sphere
 	{
 	/* Elements: */
 	private:
-	IO::SeekableFilePtr lasFile;
-	double scale[3],offset[3];
-	double min[3],max[3];
+	Point queryPoint;
+	Scalar queryRadius2;
 	size_t numPoints;
 	
 	/* Constructors and destructors: */
 	public:
-	LasPointSaver(const char* lasFileName,const double sScale[3],const double sOffset[3])
-		:lasFile(IO::openSeekableFile(lasFileName,IO::File::WriteOnly)),
+	NeighborCounter(const Point& sQueryPoint,Scalar sQueryRadius2)
+		:queryPoint(sQueryPoint),queryRadius2(sQueryRadius2),
 		 numPoints(0)
 		{
-		for(int i=0;i<3;++i)
-			{
-			scale[i]=sScale[i];
-			offset[i]=sOffset[i];
-			min[i]=Math::Constants<double>::max;
-			max[i]=Math::Constants<double>::min;
-			}
-		
-		/* Create the initial LAS file header: */
-		char signature[5]="LASF";
-		lasFile->write(signature,4);
-		lasFile->write<unsigned short>(0);
-		lasFile->write<unsigned short>(0);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned short>(0);
-		lasFile->write<unsigned short>(0);
-		char dummy[32]="";
-		lasFile->write(dummy,8);
-		lasFile->write<unsigned char>(1);
-		lasFile->write<unsigned char>(2);
-		lasFile->write(dummy,32);
-		lasFile->write(dummy,32);
-		lasFile->write<unsigned short>(1);
-		lasFile->write<unsigned short>(2011);
-		lasFile->write<unsigned short>(227);
-		lasFile->write<unsigned int>(227);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned char>(0);
-		lasFile->write<unsigned short>(20);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned int>(0);
-		lasFile->write<unsigned int>(0);
-		lasFile->write(scale,3);
-		lasFile->write(offset,3);
-		for(int i=0;i<3;++i)
-			{
-			lasFile->write<double>(max[i]);
-			lasFile->write<double>(min[i]);
-			}
-		}
-	~LasPointSaver(void)
-		{
-		/* Write the final LAS header: */
-		lasFile->setWritePosAbs(107);
-		lasFile->write<unsigned int>(numPoints);
-		lasFile->write<unsigned int>(numPoints);
-		lasFile->setWritePosAbs(179);
-		for(int i=0;i<3;++i)
-			{
-			lasFile->write<double>(max[i]);
-			lasFile->write<double>(min[i]);
-			}
-		}
-	
-	/* Methods: */
-	void operator()(const LidarPoint& point)
-		{
-		/* Quantize the point position: */
-		int p[3];
-		for(int i=0;i<3;++i)
-			p[i]=int(Math::floor((double(point[i])-offset[i])/scale[i]+0.5));
-		
-		/* Write the point record: */
-		lasFile->write(p,3);
-		lasFile->write<unsigned short>(0);
-		lasFile->write<char>(0);
-		lasFile->write<char>(0);
-		lasFile->write<unsigned char>(0);
-		lasFile->write<unsigned char>(0);
-		lasFile->write<unsigned short>(0);
-		
-		/* Update LAS header: */
-		for(int i=0;i<3;++i)
-			{
-			if(min[i]>point[i])
-				min[i]=point[i];
-			if(max[i]<point[i])
-				max[i]=point[i];
-			}
-		++numPoints;
-		}
-	};
-
-int main(int argc,char* argv[])
-	{
-	LidarProcessOctree lpo(argv[1],512*1024*1024);
-	
-	#if 0
-	Misc::Timer t;
-	{
-	// BinaryPointSaver bps(argv[2]);
-	double scale[3]={0.001,0.001,0.001};
-	double offset[3];
-	for(int i=0;i<3;++i)
-		offset[i]=lpo.getDomain().getCenter(i);
-	LasPointSaver lps(argv[2],scale,offset);
-	// PointCounter pc;
-	Box box(Box::Point(2.04446e6,617053.0,-1000.0),Box::Point(2.04446e6+100.0,617053.0+100.0,1000.0));
-	lpo.processPointsInBox(box,lps);
-	// std::cout<<lps.getNumPoints()<<std::endl;
-	}
-	t.elapse();
-	std::cout<<"Done in "<<t.getTime()*1000.0<<" ms"<<std::endl;
-	#elif 0
-	PointSaver ps(argv[2]);
-	Box box=Box::full;
-	for(int i=0;i<2;++i)
-		{
-		box.min[i]=atof(argv[3+i]);
-		box.max[i]=atof(argv[5+i]);
-		}
-	lpo.processPointsInBox(box,ps);
-	#elif 1
-	PointCounter pc;
-	lpo.processPoints(pc);
-	std::cout<<pc.getNumPoints()<<std::endl;
-	#else
-	Scalar radius=Scalar(0.1);
-	PointDensityCalculator pdc(lpo,radius,4);
-	#if 0
-	Box box;
-	box.min=Point(930,530,0);
-	box.max=Point(970,570,100);
-	lpo.processPointsInBox(box,pdc);
-	#else
-	// lpo.processPoints(pdc);
-	lpo.processNodesPostfix(pdc);
-	#endif
-	
-	std::cout<<"Number of processed points: "<<pdc.numPoints<<std::endl;
-	std::cout<<"Total number of found neighbors: "<<pdc.totalNumNeighbors<<std::endl;
-	std::cout<<"Total number of loaded octree nodes: "<<lpo.getNumSubdivideCalls()<<", "<<lpo.getNumLoadedNodes()<<std::endl;
-	std::cout<<"Average point density in 1/m^3: "<<pdc.totalNumNeighbors/(pdc.numPoints*4.0/3.0*3.141592654*radius*radius*radius)<<std::endl;
-	#endif
-	
-	return 0;
-	}
-
-#else
-
-class NearestNeighborFinder // Functor class to find the nearest non-duplicate neighbor of a point in an octree file
-	{
-	/* Elements: */
-	private:
-	Point queryPoint; // The query point position
-	Scalar dist2; // Squared distance to current nearest neighbor candidate
-	const LidarPoint* nearest; // Pointer to nearest neighbor
-	
-	/* Constructors and destructors: */
-	public:
-	NearestNeighborFinder(const Point& sQueryPoint)
-		:queryPoint(sQueryPoint),
-		 dist2(Math::Constants<Scalar>::max),
-		 nearest(0)
-		{
 		}
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point)
-		{
-		Scalar pDist2=Geometry::sqrDist(point,queryPoint);
-		if(pDist2>Scalar(0)&&pDist2<dist2)
-			{
-			nearest=&point;
-			dist2=pDist2;
-			}
-		}
 	const Point& getQueryPoint(void) const
 		{
 		return queryPoint;
 		}
 	Scalar getQueryRadius2(void) const
 		{
-		return dist2;
+		return queryRadius2;
 		}
-	const LidarPoint* getNearest(void) const
+	void operator()(const LidarPoint& point)
 		{
-		return nearest;
+		++numPoints;
 		}
-	Scalar getNearestDistance2(void) const
+	size_t getNumPoints(void) const
 		{
-		return dist2;
+		return numPoints;
 		}
 	};
 
-class KNearestNeighborFinder // Functor class to find the k nearest neighbors of a point in an octree file
+class KNearestNeighborCounter // Result functor for batched k-nearest neighbor queries
 	{
-	/* Embedded classes: */
-	private:
-	struct Neighbor // Structure to store a neighbor
-		{
-		/* Elements: */
-		public:
-		const LidarPoint* point; // Pointer to neighbor
-		Scalar dist2; // Squared distance from query position to neighbor
-		};
-	
 	/* Elements: */
 	private:
-	Point queryPoint; // The query point position
-	int maxNumNeighbors; // Maximum number of neighbors to find
-	Neighbor* neighbors; // Array of current neighbor candidates
-	int numNeighbors; // Current number of neighbor candidates
-	Scalar maxDist2; // Current maximum distance to any neighbor candidate
+	size_t numNeighbors; // Total number of found neighbors
+	double totalDistance2; // Sum of squared distances to each query's farthest neighbor
 	
 	/* Constructors and destructors: */
 	public:
-	KNearestNeighborFinder(const Point& sQueryPoint,int sMaxNumNeighbors)
-		:queryPoint(sQueryPoint),
-		 maxNumNeighbors(sMaxNumNeighbors),
-		 neighbors(new Neighbor[maxNumNeighbors]),
-		 numNeighbors(0),
-		 maxDist2(Math::Constants<Scalar>::max)
+	KNearestNeighborCounter(void)
+		:numNeighbors(0),totalDistance2(0.0)
 		{
 		}
-	~KNearestNeighborFinder(void)
-		{
-		delete[] neighbors;
-		}
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point)
+	void operator()(unsigned int,const KNearestNeighborHeap<>& neighbors)
 		{
-		Scalar dist2=Geometry::sqrDist(point,queryPoint);
-		if(numNeighbors<maxNumNeighbors)
+		if(neighbors.getNumNeighbors()>0)
 			{
-			/* Insert the new point into the heap: */
-			int insertionPos=numNeighbors;
-			while(insertionPos>0)
-				{
-				int parent=(insertionPos-1)>>1;
-				if(neighbors[parent].dist2>=dist2)
-					break;
-				neighbors[insertionPos]=neighbors[parent];
-				insertionPos=parent;
-				}
-			neighbors[insertionPos].point=&point;
-			neighbors[insertionPos].dist2=dist2;
-			
-			++numNeighbors;
-			if(numNeighbors==maxNumNeighbors)
-				maxDist2=neighbors[0].dist2;
-			}
-		else if(dist2<maxDist2)
-			{
-			/* Replace the currently farthest-away neighbor in the heap: */
-			int insertionPos=0;
-			while(true)
-				{
-				int biggestIndex=insertionPos;
-				Scalar biggest=dist2;
-				int child=(insertionPos<<1);
-				for(int i=0;i<2;++i)
-					{
-					++child;
-					if(child<maxNumNeighbors&&neighbors[child].dist2>biggest)
-						{
-						biggestIndex=child;
-						biggest=neighbors[child].dist2;
-						}
-					}
-				if(biggestIndex==insertionPos)
-					break;
-				neighbors[insertionPos]=neighbors[biggestIndex];
-				insertionPos=biggestIndex;
-				}
-			neighbors[insertionPos].point=&point;
-			neighbors[insertionPos].dist2=dist2;
-			
-			maxDist2=neighbors[0].dist2;
+			numNeighbors+=neighbors.getNumNeighbors();
+			totalDistance2+=double(neighbors.getNeighbor(neighbors.getNumNeighbors()-1).dist2);
 			}
 		}
-	const Point& getQueryPoint(void) const
-		{
-		return queryPoint;
-		}
-	Scalar getQueryRadius2(void) const
-		{
-		return maxDist2;
-		}
-	int getNumNeighbors(void) const
+	size_t getNumNeighbors(void) const
 		{
 		return numNeighbors;
 		}
-	const LidarPoint* getNeighbor(int index) const
-		{
-		return neighbors[index].point;
-		}
-	Scalar getNeighborDistance2(int index) const
-		{
-		return neighbors[index].dist2;
-		}
 	};
 
-class PointNearestNeighborFinder // Functor class to find the nearest neighbors of all points in an octree file
+class QuerySampler // Functor class to pick evenly spaced query points from an octree file in traversal order
 	{
 	/* Elements: */
 	private:
-	LidarProcessOctree& lpo;
-	size_t numPoints;
-	double totalDistance2;
+	size_t stride; // Distance between picked points in traversal order
+	size_t index; // Index of the next point
+	std::vector<Point>& queryPoints; // List of picked query points
 	
 	/* Constructors and destructors: */
 	public:
-	PointNearestNeighborFinder(LidarProcessOctree& sLpo)
-		:lpo(sLpo),
-		 numPoints(0),totalDistance2(0.0)
+	QuerySampler(size_t sStride,std::vector<Point>& sQueryPoints)
+		:stride(sStride),index(0),
+		 queryPoints(sQueryPoints)
 		{
 		}
 	
 	/* Methods: */
 	void operator()(const LidarPoint& p)
 		{
-		/* Find the nearest neighbor of this point: */
-		NearestNeighborFinder nnf(p);
-		lpo.processPointsDirected(nnf);
-		++numPoints;
-		totalDistance2+=double(nnf.getNearestDistance2());
-		}
-	size_t getNumPoints(void) const
-		{
-		return numPoints;
-		}
-	Scalar getAverageDist(void) const
-		{
-		return Scalar(Math::sqrt(totalDistance2/double(numPoints)));
+		if(index%stride==0)
+			queryPoints.push_back(p);
+		++index;
 		}
 	};
 
-class PointKNearestNeighborFinder // Functor class to find the k nearest neighbors of all points in an octree file
+/****************
+Benchmark driver:
+****************/
+
+enum KernelType // Enumerated type for benchmark kernels
+	{
+	SCAN,PARALLEL_SCAN,BOX,PARALLEL_BOX,RADIUS,KNN
+	};
+
+struct Kernel // Structure describing a benchmark kernel run
 	{
 	/* Elements: */
-	private:
-	LidarProcessOctree& lpo;
-	int maxNumNeighbors;
-	size_t numPoints;
-	double totalDistance2;
-	
-	/* Constructors and destructors: */
 	public:
-	PointKNearestNeighborFinder(LidarProcessOctree& sLpo,int sMaxNumNeighbors)
-		:lpo(sLpo),
-		 maxNumNeighbors(sMaxNumNeighbors),
-		 numPoints(0),totalDistance2(0.0)
-		{
-		}
-	
-	/* Methods: */
-	void operator()(const LidarPoint& p)
-		{
-		/* Find the k nearest neighbors of this point: */
-		KNearestNeighborFinder knnf(p,maxNumNeighbors);
-		lpo.processPointsDirected(knnf);
-		++numPoints;
-		totalDistance2+=double(knnf.getNeighborDistance2(0));
-		}
-	size_t getNumPoints(void) const
-		{
-		return numPoints;
-		}
-	Scalar getAverageDist(void) const
-		{
-		return Scalar(Math::sqrt(totalDistance2/double(numPoints)));
-		}
+	KernelType type;
+	std::string name; // Kernel name as used on the command line and in results
+	unsigned int parameter; // Number of neighbors for kNN kernels, number of threads for parallel kernels, zero otherwise
 	};
 
-class PointExtractor // Functor class to load all points from an octree file into a std::vector
+struct BenchmarkSettings // Structure holding the benchmark's query parameters
 	{
 	/* Elements: */
-	private:
-	std::vector<LidarPoint> points; // Point array
-	
-	/* Constructors and destructors: */
 	public:
-	PointExtractor(void)
-		{
-		}
-	
-	/* Methods: */
-	void operator()(const LidarPoint& p)
-		{
-		points.push_back(p);
-		}
-	const std::vector<LidarPoint>& getPoints(void) const
-		{
-		return points;
-		}
+	Box box; // Query box for box kernels
+	Scalar radius; // Query radius for radius kernels
+	std::vector<Point> queryPoints; // Query points for radius and kNN kernels
 	};
 
-class NearestNeighborFinderKdtree // Functor class to find the non-duplicate nearest neighbor of a point in an in-memory kd-tree
+struct Result // Structure holding the measurement of one kernel repetition
 	{
 	/* Elements: */
-	private:
-	Point queryPoint; // The query point position
-	Scalar dist2; // Squared distance to current nearest neighbor candidate
-	const LidarPoint* nearest; // Pointer to nearest neighbor
-	
-	/* Constructors and destructors: */
 	public:
-	NearestNeighborFinderKdtree(const Point& sQueryPoint)
-		:queryPoint(sQueryPoint),
-		dist2(Math::Constants<Scalar>::max),
-		nearest(0)
-		{
-		}
-	
-	/* Methods: */
-	bool operator()(const LidarPoint& point,int splitDimension)
+	const Kernel* kernel;
+	unsigned int repetition;
+	double time; // Kernel run time in seconds
+	size_t numResults; // Number of points or neighbors found by the kernel
+	size_t numLoadedNodes; // Number of nodes loaded from file during the kernel run
+	size_t numSubdivideCalls; // Number of node subdivisions during the kernel run
+	};
+
+size_t runKernel(LidarProcessOctree& lpo,const Kernel& kernel,const BenchmarkSettings& settings) // Runs the given kernel once and returns its number of results
+	{
+	switch(kernel.type)
 		{
-		Scalar pDist2=Geometry::sqrDist(point,queryPoint);
-		if(pDist2>Scalar(0)&&pDist2<dist2)
+		case SCAN:
 			{
-			nearest=&point;
-			dist2=pDist2;
+			PointCounter pc;
+			lpo.processPoints(pc);
+			return pc.getNumPoints();
 			}
 		
-		/* Stop traversal if split plane is farther away than closest point: */
-		return dist2>Math::sqr(point[splitDimension]-queryPoint[splitDimension]);
-		}
-	const Point& getQueryPosition(void) const
-		{
-		return queryPoint;
-		}
-	Scalar getQueryRadius2(void) const
-		{
-		return dist2;
-		}
-	const LidarPoint* getNearest(void) const
-		{
-		return nearest;
+		case PARALLEL_SCAN:
+			{
+			ParallelPointCounter ppc(0);
+			lpo.processNodesPrefixParallel(ppc,kernel.parameter);
+			return ppc.getNumPoints();
+			}
+		
+		case BOX:
+			{
+			PointCounter pc;
+			lpo.processPointsInBox(settings.box,pc);
+			return pc.getNumPoints();
+			}
+		
+		case PARALLEL_BOX:
+			{
+			ParallelPointCounter ppc(&settings.box);
+			lpo.processNodesInBoxPrefixParallel(settings.box,ppc,kernel.parameter);
+			return ppc.getNumPoints();
+			}
+		
+		case RADIUS:
+			{
+			size_t numNeighbors=0;
+			Scalar radius2=Math::sqr(settings.radius);
+			for(std::vector<Point>::const_iterator qIt=settings.queryPoints.begin();qIt!=settings.queryPoints.end();++qIt)
+				{
+				NeighborCounter nc(*qIt,radius2);
+				lpo.processPointsInSphere(nc);
+				numNeighbors+=nc.getNumPoints();
+				}
+			return numNeighbors;
+			}
+		
+		case KNN:
+			{
+			/* Run the queries in batches of adjacent query points: */
+			KNearestNeighborHeap<> heap(kernel.parameter);
+			KNearestNeighborCounter knnc;
+			const unsigned int batchSize=1024;
+			for(size_t first=0;first<settings.queryPoints.size();first+=batchSize)
+				{
+				unsigned int numQueries=(unsigned int)(settings.queryPoints.size()-first);
+				if(numQueries>batchSize)
+					numQueries=batchSize;
+				lpo.processKNearestNeighbors(&settings.queryPoints[first],numQueries,heap,Math::Constants<Scalar>::max,knnc);
+				}
+			return knnc.getNumNeighbors();
+			}
 		}
-	Scalar getNearestDistance2(void) const
-		{
-		return dist2;
+	
+	return 0;
+	}
+
+bool parseKernels(const char* kernelList,const std::vector<unsigned int>& ks,unsigned int numThreads,std::vector<Kernel>& kernels) // Parses a comma-separated list of kernel names; returns false on unknown names
+	{
+	const char* kPtr=kernelList;
+	while(*kPtr!='\0')
+		{
+		/* Extract the next kernel name: */
+		const char* nameEnd;
+		for(nameEnd=kPtr;*nameEnd!='\0'&&*nameEnd!=',';++nameEnd)
+			;
+		std::string name(kPtr,nameEnd);
+		kPtr=*nameEnd==','?nameEnd+1:nameEnd;
+		
+		Kernel kernel;
+		kernel.name=name;
+		kernel.parameter=0;
+		if(strcasecmp(name.c_str(),"scan")==0)
+			kernel.type=SCAN;
+		else if(strcasecmp(name.c_str(),"pscan")==0)
+			{
+			kernel.type=PARALLEL_SCAN;
+			kernel.parameter=numThreads;
+			}
+		else if(strcasecmp(name.c_str(),"box")==0)
+			kernel.type=BOX;
+		else if(strcasecmp(name.c_str(),"pbox")==0)
+			{
+			kernel.type=PARALLEL_BOX;
+			kernel.parameter=numThreads;
+			}
+		else if(strcasecmp(name.c_str(),"radius")==0)
+			kernel.type=RADIUS;
+		else if(strcasecmp(name.c_str(),"knn")==0)
+			{
+			/* Create one kernel run per neighborhood size: */
+			kernel.type=KNN;
+			for(std::vector<unsigned int>::const_iterator kIt=ks.begin();kIt!=ks.end();++kIt)
+				{
+				kernel.parameter=*kIt;
+				kernels.push_back(kernel);
+				}
+			continue;
+			}
+		else
+			{
+			std::cerr<<"Unknown benchmark kernel "<<name<<std::endl;
+			return false;
+			}
+		kernels.push_back(kernel);
 		}
-	};
+	
+	return true;
+	}
+
+void sampleQueryPoints(LidarProcessOctree& lpo,size_t numQueries,std::vector<Point>& queryPoints) // Picks the given number of query points evenly spaced in traversal order
+	{
+	PointCounter pc;
+	lpo.processPoints(pc);
+	size_t stride=pc.getNumPoints()/numQueries;
+	if(stride<1)
+		stride=1;
+	QuerySampler qs(stride,queryPoints);
+	lpo.processPoints(qs);
+	if(queryPoints.size()>numQueries)
+		queryPoints.resize(numQueries);
+	}
+
+}
 
 int main(int argc,char* argv[])
 	{
+	/* Parse the command line: */
 	const char* fileName=0;
-	int maxNumNeighbors=10;
 	int cacheSize=512;
+	bool mapDataFiles=false;
+	const char* kernelList="scan,pscan,box,pbox,radius,knn";
+	std::vector<unsigned int> ks;
+	unsigned int numThreads=4;
+	unsigned int numRepetitions=5;
+	bool coldCache=false;
+	size_t numQueries=10000;
+	double boxFraction=0.25;
+	double radius=0.0;
+	const char* csvFileName=0;
 	for(int i=1;i<argc;++i)
 		{
 		if(argv[i][0]=='-')
 			{
-			if(strcasecmp(argv[i]+1,"numNeighbors")==0)
+			if(strcasecmp(argv[i]+1,"cache")==0)
+				{
+				++i;
+				if(i<argc)
+					cacheSize=atoi(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -cache option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"mmap")==0)
+				mapDataFiles=true;
+			else if(strcasecmp(argv[i]+1,"kernels")==0)
+				{
+				++i;
+				if(i<argc)
+					kernelList=argv[i];
+				else
+					std::cerr<<"Ignoring dangling -kernels option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"k")==0)
+				{
+				++i;
+				if(i<argc)
+					{
+					/* Parse a comma-separated list of neighborhood sizes: */
+					ks.clear();
+					char* kPtr=argv[i];
+					while(*kPtr!='\0')
+						{
+						unsigned int k=(unsigned int)strtoul(kPtr,&kPtr,10);
+						if(k>0)
+							ks.push_back(k);
+						if(*kPtr!='\0')
+							++kPtr;
+						}
+					}
+				else
+					std::cerr<<"Ignoring dangling -k option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"threads")==0)
+				{
+				++i;
+				if(i<argc)
+					numThreads=(unsigned int)atoi(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -threads option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"repeat")==0)
+				{
+				++i;
+				if(i<argc)
+					numRepetitions=(unsigned int)atoi(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -repeat option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"cold")==0)
+				coldCache=true;
+			else if(strcasecmp(argv[i]+1,"warm")==0)
+				coldCache=false;
+			else if(strcasecmp(argv[i]+1,"queries")==0)
+				{
+				++i;
+				if(i<argc)
+					numQueries=size_t(atol(argv[i]));
+				else
+					std::cerr<<"Ignoring dangling -queries option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"boxFraction")==0)
 				{
 				++i;
-				maxNumNeighbors=atoi(argv[i]);
+				if(i<argc)
+					boxFraction=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -boxFraction option"<<std::endl;
 				}
-			else if(strcasecmp(argv[i]+1,"cache")==0)
+			else if(strcasecmp(argv[i]+1,"radius")==0)
 				{
 				++i;
-				cacheSize=atoi(argv[i]);
+				if(i<argc)
+					radius=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -radius option"<<std::endl;
 				}
+			else if(strcasecmp(argv[i]+1,"csv")==0)
+				{
+				++i;
+				if(i<argc)
+					csvFileName=argv[i];
+				else
+					std::cerr<<"Ignoring dangling -csv option"<<std::endl;
+				}
+			else
+				std::cerr<<"Ignoring command line option "<<argv[i]<<std::endl;
 			}
 		else if(fileName==0)
 			fileName=argv[i];
+		else
+			std::cerr<<"Ignoring command line argument "<<argv[i]<<std::endl;
 		}
 	if(fileName==0)
 		{
-		std::cerr<<"No file name provided"<<std::endl;
+		std::cerr<<"Usage: "<<argv[0]<<" [-cache <cache size>] [-mmap] [-kernels <kernel list>] [-k <k list>] [-threads <num threads>] [-repeat <num repetitions>] [-cold | -warm] [-queries <num queries>] [-boxFraction <fraction>] [-radius <radius>] [-csv <result file name>] <LiDAR file name>"<<std::endl;
+		std::cerr<<"  -cache <cache size> sets the size of the LiDAR memory cache in MB (default: 512)"<<std::endl;
+		std::cerr<<"  -mmap requests to read point data from memory-mapped files"<<std::endl;
+		std::cerr<<"  -kernels <kernel list> comma-separated list of kernels to run from scan, pscan, box, pbox, radius, knn (default: all)"<<std::endl;
+		std::cerr<<"  -k <k list> comma-separated list of neighborhood sizes for the knn kernel (default: 1,8,32)"<<std::endl;
+		std::cerr<<"  -threads <num threads> sets the number of threads for the parallel pscan and pbox kernels (default: 4)"<<std::endl;
+		std::cerr<<"  -repeat <num repetitions> runs each kernel the given number of times (default: 5)"<<std::endl;
+		std::cerr<<"  -cold runs each repetition on a freshly opened octree with an empty memory cache"<<std::endl;
+		std::cerr<<"  -warm runs all repetitions on the same octree after one untimed warm-up run (default)"<<std::endl;
+		std::cerr<<"  -queries <num queries> sets the number of query points for the radius and knn kernels (default: 10000)"<<std::endl;
+		std::cerr<<"  -boxFraction <fraction> sets the size of the centered query box for the box kernels relative to the octree's domain (default: 0.25)"<<std::endl;
+		std::cerr<<"  -radius <radius> sets the query radius for the radius kernel (default: 1/1024 of the octree's domain size)"<<std::endl;
+		std::cerr<<"  -csv <result file name> writes one line per kernel repetition to the given CSV file"<<std::endl;
 		return 1;
 		}
-	
-	Misc::Timer t;
-	
-	/* Create a processing octree: */
-	LidarProcessOctree lpo(fileName,size_t(cacheSize)*size_t(1024*1024));
-	
-	#if 0
-	
-	/* Count the number of points in the octree: */
-	PointCounter pc;
-	const Cube& c=lpo.getDomain();
-	// Box box(c.getMin(),c.getMax());
-	Box box(Point(700.0,300.0,-200.0),Point(1200.0,800.0,300.0));
-	lpo.processPointsInBox(box,pc);
-	std::cout<<"Octree contains "<<pc.getNumPoints()<<" points"<<std::endl;
-	
-	#elif 1
-	
-	if(maxNumNeighbors==1)
-		{
-		/* Find the nearest neighbor of each point in the octree: */
-		PointNearestNeighborFinder pnnf(lpo);
-		lpo.processPoints(pnnf);
-		std::cout<<"Octree contains "<<pnnf.getNumPoints()<<" points, average point density is "<<pnnf.getAverageDist()<<std::endl;
-		}
-	else
+	if(ks.empty())
 		{
-		/* Find the k nearest neighbors of each point in the octree: */
-		PointKNearestNeighborFinder pknnf(lpo,maxNumNeighbors);
-		lpo.processPoints(pknnf);
-		std::cout<<"Octree contains "<<pknnf.getNumPoints()<<" points, average point density is "<<pknnf.getAverageDist()<<std::endl;
+		ks.push_back(1);
+		ks.push_back(8);
+		ks.push_back(32);
 		}
+	if(numThreads<1)
+		numThreads=1;
+	if(numRepetitions<1)
+		numRepetitions=1;
+	if(numQueries<1)
+		numQueries=1;
 	
-	#elif 0
-	
-	/* Extract the points from the octree: */
-	PointExtractor pe;
-	lpo.processPoints(pe);
+	std::vector<Kernel> kernels;
+	if(!parseKernels(kernelList,ks,numThreads,kernels))
+		return 1;
 	
-	/* Build a kd-tree from the points: */
-	Geometry::ArrayKdTree<LidarPoint> kdTree;
-	LidarPoint* points=kdTree.createTree(pe.getPoints().size());
-	for(size_t i=0;i<pe.getPoints().size();++i)
-		points[i]=pe.getPoints()[i];
-	kdTree.releasePoints();
+	size_t cacheBytes=size_t(cacheSize)*size_t(1024*1024);
 	
-	#if 0
-	/* Find the nearest neighbor of all points in the kd-tree: */
-	double nearestDistance2=0.0;
-	for(size_t i=0;i<pe.getPoints().size();++i)
+	/* Open the octree and set up the query parameters: */
+	LidarProcessOctree* lpo=new LidarProcessOctree(fileName,cacheBytes,0,mapDataFiles);
+	BenchmarkSettings settings;
+	Point center=lpo->getRootCenter();
+	Scalar halfSize=lpo->getRootSize()*Scalar(boxFraction);
+	for(int i=0;i<3;++i)
 		{
-		NearestNeighborFinderKdtree nnfkd(points[i]);
-		kdTree.traverseTreeDirected(nnfkd);
-		nearestDistance2+=double(nnfkd.getNearestDistance2());
+		settings.box.min[i]=center[i]-halfSize;
+		settings.box.max[i]=center[i]+halfSize;
 		}
-	std::cout<<"Octree contains "<<pe.getPoints().size()<<" points, average point density is "<<Math::sqrt(nearestDistance2/double(pe.getPoints().size()))<<std::endl;
-	#else
-	/* Search points randomly to test for correctness: */
-	for(int index=0;index<pe.getPoints().size();++index)
+	settings.radius=radius>0.0?Scalar(radius):lpo->getRootSize()*Scalar(2.0/1024.0);
+	sampleQueryPoints(*lpo,numQueries,settings.queryPoints);
+	std::cout<<"Benchmarking "<<fileName<<" with "<<settings.queryPoints.size()<<" query points, query radius "<<settings.radius<<", "<<(coldCache?"cold":"warm")<<" cache"<<std::endl;
+	
+	/* Run all kernels: */
+	std::vector<Result> results;
+	for(std::vector<Kernel>::const_iterator kIt=kernels.begin();kIt!=kernels.end();++kIt)
 		{
-		/* Use the kd-tree: */
-		NearestNeighborFinderKdtree nnfkd(points[index]);
-		kdTree.traverseTreeDirected(nnfkd);
-		
-		/* Use the out-of-core search algorithm: */
-		NearestNeighborFinder nnf(points[index]);
-		lpo.processPointsDirected(nnf);
-		
-		if(nnfkd.getNearestDistance2()!=nnf.getNearestDistance2())
+		if(!coldCache)
 			{
-			/* Whoopsie! */
-			std::cout<<"Mismatch for search point "<<points[index][0]<<", "<<points[index][1]<<", "<<points[index][2]<<":"<<std::endl;
-			std::cout<<"Kd-tree: "<<nnfkd.getNearestDistance2()<<" "<<(*nnfkd.getNearest())[0]<<", "<<(*nnfkd.getNearest())[1]<<", "<<(*nnfkd.getNearest())[0]<<std::endl;
-			std::cout<<"Octree : "<<nnf.getNearestDistance2()<<" "<<(*nnf.getNearest())[0]<<", "<<(*nnf.getNearest())[1]<<", "<<(*nnf.getNearest())[0]<<std::endl;
+			/* Warm up the cache with one untimed run: */
+			runKernel(*lpo,*kIt,settings);
 			}
-		}
-	#endif
-	
-	#else
-	
-	/* Extract the points from the octree: */
-	PointExtractor pe;
-	lpo.processPoints(pe);
-	
-	/* Compare a brute-force search against the octree-based algorithm: */
-	const std::vector<LidarPoint>& points=pe.getPoints();
-	for(int i=0;i<100000;++i)
-		{
-		size_t index=Math::randUniformCO(0,points.size());
-		
-		/* Use the out-of-core search algorithm: */
-		NearestNeighborFinder nnf(points[index]);
-		lpo.processPointsDirected(nnf);
 		
-		/* Use brute force: */
-		const LidarPoint* nearest=0;
-		Scalar minDist2=Math::Constants<Scalar>::max;
-		for(size_t i=0;i<points.size();++i)
+		double minTime=Math::Constants<double>::max;
+		double maxTime=0.0;
+		double totalTime=0.0;
+		size_t numResults=0;
+		for(unsigned int repetition=0;repetition<numRepetitions;++repetition)
 			{
-			Scalar dist2=Geometry::sqrDist(points[index],points[i]);
-			if(dist2>Scalar(0)&&dist2<minDist2)
+			if(coldCache)
 				{
-				nearest=&points[i];
-				minDist2=dist2;
+				/* Drop the octree's memory cache by re-opening the octree: */
+				delete lpo;
+				lpo=new LidarProcessOctree(fileName,cacheBytes,0,mapDataFiles);
 				}
+			
+			/* Run the kernel: */
+			Result result;
+			result.kernel=&*kIt;
+			result.repetition=repetition;
+			size_t numLoadedNodes=lpo->getNumLoadedNodes();
+			size_t numSubdivideCalls=lpo->getNumSubdivideCalls();
+			Misc::Timer t;
+			result.numResults=runKernel(*lpo,*kIt,settings);
+			t.elapse();
+			result.time=t.getTime();
+			result.numLoadedNodes=lpo->getNumLoadedNodes()-numLoadedNodes;
+			result.numSubdivideCalls=lpo->getNumSubdivideCalls()-numSubdivideCalls;
+			results.push_back(result);
+			
+			if(minTime>result.time)
+				minTime=result.time;
+			if(maxTime<result.time)
+				maxTime=result.time;
+			totalTime+=result.time;
+			numResults=result.numResults;
 			}
 		
-		if(nnf.getNearestDistance2()!=minDist2)
+		/* Print a summary line: */
+		std::cout<<kIt->name;
+		if(kIt->parameter!=0)
+			std::cout<<'('<<kIt->parameter<<')';
+		std::cout<<": "<<numResults<<" results, min "<<minTime*1000.0<<" ms, mean "<<totalTime*1000.0/double(numRepetitions)<<" ms, max "<<maxTime*1000.0<<" ms"<<std::endl;
+		}
+	delete lpo;
+	
+	if(csvFileName!=0)
+		{
+		/* Write all measurements to the result file: */
+		FILE* csvFile=fopen(csvFileName,"wt");
+		if(csvFile==0)
 			{
-			/* Whoopsie! */
-			std::cout<<"Mismatch for search point "<<points[index][0]<<", "<<points[index][1]<<", "<<points[index][2]<<":"<<std::endl;
-			std::cout<<"Octree     : "<<nnf.getNearestDistance2()<<" "<<(*nnf.getNearest())[0]<<", "<<(*nnf.getNearest())[1]<<", "<<(*nnf.getNearest())[0]<<std::endl;
-			std::cout<<"Brute force: "<<minDist2<<" "<<(*nearest)[0]<<", "<<(*nearest)[1]<<", "<<(*nearest)[2]<<std::endl;
+			std::cerr<<"Cannot create result file "<<csvFileName<<std::endl;
+			return 1;
 			}
+		fprintf(csvFile,"kernel,parameter,cache,repetition,time,results,loadedNodes,subdivideCalls\n");
+		for(std::vector<Result>::const_iterator rIt=results.begin();rIt!=results.end();++rIt)
+			fprintf(csvFile,"%s,%u,%s,%u,%.6f,%lu,%lu,%lu\n",rIt->kernel->name.c_str(),rIt->kernel->parameter,coldCache?"cold":"warm",rIt->repetition,rIt->time,(unsigned long)rIt->numResults,(unsigned long)rIt->numLoadedNodes,(unsigned long)rIt->numSubdivideCalls);
+		fclose(csvFile);
 		}
-	#endif
 	
-	t.elapse();
-	
-	/* Clean up and exit: */
-	std::cout<<"Loaded "<<lpo.getNumLoadedNodes()<<" nodes"<<std::endl;
-	std::cout<<"Total runtime: "<<t.getTime()<<" s"<<std::endl;
 	return 0;
 	}
-
-#endif
@@ -0,0 +1,144 @@
+/***********************************************************************
+LidarQuantization - Compact on-disk representations of LiDAR points and
+normal vectors, with positions quantized relative to their octree node's
+domain and octahedrally encoded normal vectors.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARQUANTIZATION_INCLUDED
+#define LIDARQUANTIZATION_INCLUDED
+
+#include <Misc/SizedTypes.h>
+#include <Math/Math.h>
+
+#include "LidarTypes.h"
+#include "Cube.h"
+
+/***********************************************************************
+Quantized data files are identified by the record size stored in their
+LidarDataFileHeader: a points file with a record size of
+sizeof(QuantizedLidarPoint) and a normal vector file with a record size
+of sizeof(QuantizedNormal) contain quantized records; the octree index
+file and the records' data offsets are identical in both formats.
+***********************************************************************/
+
+struct QuantizedLidarPoint // Structure for LiDAR points with positions quantized relative to their octree node's domain
+	{
+	/* Elements: */
+	public:
+	Misc::UInt16 position[3]; // Point position relative to the node domain's minimum corner, in units of 1/65535 of the domain's size
+	Color value; // Point color
+	};
+
+struct QuantizedNormal // Structure for octahedrally encoded normal vectors; (0, 0) encodes the null vector
+	{
+	/* Elements: */
+	public:
+	Misc::UInt16 oct[2]; // Coordinates of the normal vector's projection onto the unit octahedron, unfolded into the unit square
+	};
+
+inline QuantizedLidarPoint quantizePoint(const LidarPoint& point,const Cube& domain) // Quantizes a point relative to the given node domain
+	{
+	QuantizedLidarPoint result;
+	for(int i=0;i<3;++i)
+		{
+		Scalar size=domain.getMax()[i]-domain.getMin()[i];
+		Scalar q=size>Scalar(0)?(point[i]-domain.getMin()[i])*Scalar(65535)/size:Scalar(0);
+		q=q<Scalar(0)?Scalar(0):q;
+		q=q>Scalar(65535)?Scalar(65535):q;
+		result.position[i]=Misc::UInt16(q+Scalar(0.5));
+		}
+	result.value=point.value;
+	return result;
+	}
+
+inline void dequantizePoints(const QuantizedLidarPoint* qPoints,unsigned int numPoints,const Cube& domain,LidarPoint* points) // Converts an array of points quantized relative to the given node domain back to full LiDAR points
+	{
+	Scalar scale[3];
+	for(int i=0;i<3;++i)
+		scale[i]=(domain.getMax()[i]-domain.getMin()[i])/Scalar(65535);
+	for(unsigned int i=0;i<numPoints;++i,++qPoints,++points)
+		{
+		for(int j=0;j<3;++j)
+			(*points)[j]=domain.getMin()[j]+Scalar(qPoints->position[j])*scale[j];
+		points->value=qPoints->value;
+		}
+	}
+
+inline QuantizedNormal encodeNormal(const Vector& normal) // Encodes a normal vector; the result is normalized
+	{
+	QuantizedNormal result;
+	
+	/* Project the normal vector onto the unit octahedron: */
+	Scalar l1=Math::abs(normal[0])+Math::abs(normal[1])+Math::abs(normal[2]);
+	if(l1==Scalar(0))
+		{
+		/* Use the reserved code for null vectors: */
+		result.oct[0]=result.oct[1]=0U;
+		return result;
+		}
+	Scalar o[2];
+	o[0]=normal[0]/l1;
+	o[1]=normal[1]/l1;
+	
+	/* Fold the lower hemisphere over the upper hemisphere's diagonals: */
+	if(normal[2]<Scalar(0))
+		{
+		Scalar x=o[0];
+		o[0]=(Scalar(1)-Math::abs(o[1]))*(x>=Scalar(0)?Scalar(1):Scalar(-1));
+		o[1]=(Scalar(1)-Math::abs(x))*(o[1]>=Scalar(0)?Scalar(1):Scalar(-1));
+		}
+	
+	/* Quantize the unfolded coordinates, never producing the reserved null code: */
+	for(int i=0;i<2;++i)
+		{
+		Scalar q=(o[i]+Scalar(1))*Scalar(32767.5);
+		q=q<Scalar(0)?Scalar(0):q;
+		q=q>Scalar(65535)?Scalar(65535):q;
+		result.oct[i]=Misc::UInt16(q+Scalar(0.5));
+		}
+	if(result.oct[0]==0U&&result.oct[1]==0U)
+		result.oct[0]=1U;
+	
+	return result;
+	}
+
+inline Vector decodeNormal(const QuantizedNormal& qNormal) // Decodes an octahedrally encoded normal vector
+	{
+	/* Check for the reserved null code: */
+	if(qNormal.oct[0]==0U&&qNormal.oct[1]==0U)
+		return Vector::zero;
+	
+	/* Unfold the octahedron: */
+	Vector result;
+	result[0]=Scalar(qNormal.oct[0])/Scalar(32767.5)-Scalar(1);
+	result[1]=Scalar(qNormal.oct[1])/Scalar(32767.5)-Scalar(1);
+	result[2]=Scalar(1)-Math::abs(result[0])-Math::abs(result[1]);
+	if(result[2]<Scalar(0))
+		{
+		Scalar x=result[0];
+		result[0]=(Scalar(1)-Math::abs(result[1]))*(x>=Scalar(0)?Scalar(1):Scalar(-1));
+		result[1]=(Scalar(1)-Math::abs(x))*(result[1]>=Scalar(0)?Scalar(1):Scalar(-1));
+		}
+	
+	return result.normalize();
+	}
+
+#endif
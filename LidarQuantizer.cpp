@@ -0,0 +1,200 @@
+/***********************************************************************
+LidarQuantizer - Post-processing filter to convert the points file and
+optional normal vector file of a LiDAR data set to the compact quantized
+record format.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <Misc/SelfDestructArray.h>
+
+#include "LidarTypes.h"
+#include "LidarFile.h"
+#include "LidarProcessOctree.h"
+#include "LidarCompressedFile.h"
+#include "LidarQuantization.h"
+
+namespace {
+
+/***********************************************************
+Helper functions to load LiDAR files given a base file name:
+***********************************************************/
+
+std::string getLidarPartFileName(const char* lidarFileName,const char* partFileName)
+	{
+	std::string result=lidarFileName;
+	result.push_back('/');
+	result.append(partFileName);
+	return result;
+	}
+
+}
+
+class NodeQuantizer // Functor class to write the quantized points and normal vectors of each octree node
+	{
+	/* Elements: */
+	private:
+	const LidarProcessOctree& lpo; // The processed octree
+	LidarFile& pointsFile; // File to which to write quantized points
+	LidarFile* normalsFile; // Original normal vector file, or 0 if the data set has no normal vectors
+	LidarFile::Offset normalsRecordSize; // Record size of the original normal vector file
+	LidarFile* qNormalsFile; // File to which to write encoded normal vectors
+	Misc::SelfDestructArray<QuantizedLidarPoint> qPoints; // Buffer for a node's quantized points
+	Misc::SelfDestructArray<Vector> normals; // Buffer for a node's original normal vectors
+	Misc::SelfDestructArray<QuantizedNormal> qNormals; // Buffer for a node's encoded normal vectors
+	size_t numProcessedNodes; // Number of nodes processed so far
+	
+	/* Constructors and destructors: */
+	public:
+	NodeQuantizer(const LidarProcessOctree& sLpo,LidarFile& sPointsFile,LidarFile* sNormalsFile,LidarFile::Offset sNormalsRecordSize,LidarFile* sQNormalsFile)
+		:lpo(sLpo),
+		 pointsFile(sPointsFile),
+		 normalsFile(sNormalsFile),normalsRecordSize(sNormalsRecordSize),qNormalsFile(sQNormalsFile),
+		 qPoints(lpo.getMaxNumPointsPerNode()),
+		 normals(normalsFile!=0?lpo.getMaxNumPointsPerNode():0U),
+		 qNormals(normalsFile!=0?lpo.getMaxNumPointsPerNode():0U),
+		 numProcessedNodes(0)
+		{
+		}
+	
+	/* Methods: */
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
+		{
+		unsigned int numPoints=node.getNumPoints();
+		
+		/* Quantize the node's points relative to the node's domain: */
+		for(unsigned int i=0;i<numPoints;++i)
+			qPoints[i]=quantizePoint(node[i],node.getDomain());
+		pointsFile.setWritePosAbs(LidarDataFileHeader::getFileSize()+LidarFile::Offset(sizeof(QuantizedLidarPoint))*node.getDataOffset());
+		pointsFile.write(qPoints.getArray(),numPoints);
+		
+		if(normalsFile!=0)
+			{
+			/* Read and encode the node's normal vectors: */
+			normalsFile->setReadPosAbs(LidarDataFileHeader::getFileSize()+normalsRecordSize*node.getDataOffset());
+			normalsFile->read(normals.getArray(),numPoints);
+			for(unsigned int i=0;i<numPoints;++i)
+				qNormals[i]=encodeNormal(normals[i]);
+			qNormalsFile->setWritePosAbs(LidarDataFileHeader::getFileSize()+LidarFile::Offset(sizeof(QuantizedNormal))*node.getDataOffset());
+			qNormalsFile->write(qNormals.getArray(),numPoints);
+			}
+		
+		/* Update the progress indicator: */
+		++numProcessedNodes;
+		std::cout<<"\b\b\b\b"<<std::setw(3)<<(numProcessedNodes*100+lpo.getNumNodes()/2)/lpo.getNumNodes()<<"%"<<std::flush;
+		}
+	};
+
+int main(int argc,char* argv[])
+	{
+	const char* fileName=0;
+	int cacheSize=512;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"cache")==0)
+				{
+				++i;
+				cacheSize=atoi(argv[i]);
+				}
+			}
+		else if(fileName==0)
+			fileName=argv[i];
+		}
+	if(fileName==0)
+		{
+		std::cerr<<"No file name provided"<<std::endl;
+		return 1;
+		}
+	
+	std::string pointsFileName=getLidarPartFileName(fileName,"Points");
+	std::string normalsFileName=getLidarPartFileName(fileName,"Normals");
+	std::string qPointsFileName=pointsFileName+".quantized";
+	std::string qNormalsFileName=normalsFileName+".quantized";
+	bool haveNormals=access(normalsFileName.c_str(),R_OK)==0;
+	
+	{
+	/* Create a processing octree: */
+	LidarProcessOctree lpo(fileName,size_t(cacheSize)*size_t(1024*1024));
+	
+	/* Check that the data set is not already quantized: */
+	{
+	LidarFile pointsFile(pointsFileName.c_str());
+	pointsFile.setEndianness(Misc::LittleEndian);
+	LidarDataFileHeader dfh(pointsFile);
+	if(LidarCompressedFile::getRecordSize(dfh.recordSize)==sizeof(QuantizedLidarPoint))
+		{
+		std::cerr<<"LiDAR file "<<fileName<<" is already quantized"<<std::endl;
+		return 1;
+		}
+	}
+	
+	/* Create the quantized points file: */
+	LidarFile qPointsFile(qPointsFileName.c_str(),LidarFile::ReadWrite);
+	qPointsFile.setEndianness(Misc::LittleEndian);
+	LidarDataFileHeader((unsigned int)(sizeof(QuantizedLidarPoint))).write(qPointsFile);
+	
+	/* Open the original normal vector file and create the encoded normal vector file: */
+	LidarFile* normalsFile=0;
+	LidarFile::Offset normalsRecordSize=0;
+	LidarFile* qNormalsFile=0;
+	if(haveNormals)
+		{
+		normalsFile=new LidarFile(normalsFileName.c_str());
+		normalsFile->setEndianness(Misc::LittleEndian);
+		LidarDataFileHeader dfh(*normalsFile);
+		if(dfh.recordSize!=sizeof(Vector))
+			{
+			std::cerr<<"Normal vector file of LiDAR file "<<fileName<<" has unsupported record size "<<dfh.recordSize<<std::endl;
+			delete normalsFile;
+			return 1;
+			}
+		normalsRecordSize=LidarFile::Offset(dfh.recordSize);
+		qNormalsFile=new LidarFile(qNormalsFileName.c_str(),LidarFile::ReadWrite);
+		qNormalsFile->setEndianness(Misc::LittleEndian);
+		LidarDataFileHeader((unsigned int)(sizeof(QuantizedNormal))).write(*qNormalsFile);
+		}
+	
+	/* Quantize all nodes: */
+	NodeQuantizer nq(lpo,qPointsFile,normalsFile,normalsRecordSize,qNormalsFile);
+	std::cout<<"Quantizing points...   0%"<<std::flush;
+	lpo.processNodesPrefix(nq);
+	std::cout<<std::endl;
+	
+	delete normalsFile;
+	delete qNormalsFile;
+	}
+	
+	/* Replace the original data files with the quantized data files: */
+	if(rename(qPointsFileName.c_str(),pointsFileName.c_str())!=0||(haveNormals&&rename(qNormalsFileName.c_str(),normalsFileName.c_str())!=0))
+		{
+		std::cerr<<"Unable to replace data files of LiDAR file "<<fileName<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
@@ -0,0 +1,745 @@
+/***********************************************************************
+LidarRemoteFile - Classes to read the parts of a LiDAR file stored on an
+HTTP server through range requests, with a bounded persistent local
+cache of fetched blocks.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarRemoteFile.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <iostream>
+#include <Misc/StdError.h>
+
+/*********************************************************
+Helper class to send HTTP requests over a kept-alive TCP
+connection and receive their responses:
+*********************************************************/
+
+class LidarHttpConnection
+	{
+	/* Embedded classes: */
+	public:
+	struct Response // Structure for the parsed header of an HTTP response
+		{
+		/* Elements: */
+		public:
+		int status; // HTTP status code
+		LidarFile::Offset contentLength; // Length of the response body, or -1 if not given
+		bool keepAlive; // Flag whether the server keeps the connection open
+		std::string validator; // ETag or Last-Modified header, or empty
+		};
+	
+	/* Elements: */
+	private:
+	std::string host; // Host name of the HTTP server
+	int port; // Port number of the HTTP server
+	int fd; // Socket connected to the server, or -1 if not connected
+	char buffer[8192]; // Buffer for received data
+	size_t bufferPos,bufferEnd; // Range of unread data in the receive buffer
+	
+	/* Private methods: */
+	void connect(void) // Connects to the server
+		{
+		/* Resolve the server's host name: */
+		struct addrinfo hints;
+		memset(&hints,0,sizeof(hints));
+		hints.ai_family=AF_UNSPEC;
+		hints.ai_socktype=SOCK_STREAM;
+		char portName[16];
+		snprintf(portName,sizeof(portName),"%d",port);
+		struct addrinfo* addresses;
+		int aiResult=getaddrinfo(host.c_str(),portName,&hints,&addresses);
+		if(aiResult!=0)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot resolve host %s due to error %s",host.c_str(),gai_strerror(aiResult));
+		
+		/* Connect to the first address that accepts the connection: */
+		int error=0;
+		for(struct addrinfo* aPtr=addresses;aPtr!=0&&fd<0;aPtr=aPtr->ai_next)
+			{
+			fd=socket(aPtr->ai_family,aPtr->ai_socktype,aPtr->ai_protocol);
+			if(fd>=0&&::connect(fd,aPtr->ai_addr,aPtr->ai_addrlen)<0)
+				{
+				error=errno;
+				close(fd);
+				fd=-1;
+				}
+			}
+		freeaddrinfo(addresses);
+		if(fd<0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot connect to %s:%d",host.c_str(),port);
+		
+		/* Send requests immediately: */
+		int flag=1;
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+		bufferPos=bufferEnd=0;
+		}
+	void fillBuffer(void) // Receives more data into the empty receive buffer; throws exception if the connection was closed
+		{
+		ssize_t readResult;
+		do
+			{
+			readResult=recv(fd,buffer,sizeof(buffer),0);
+			}
+		while(readResult<0&&errno==EINTR);
+		if(readResult<0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot receive from %s:%d",host.c_str(),port);
+		if(readResult==0)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Connection to %s:%d closed by server",host.c_str(),port);
+		bufferPos=0;
+		bufferEnd=size_t(readResult);
+		}
+	void readLine(std::string& line) // Reads a CRLF-terminated line, without the line terminator
+		{
+		line.clear();
+		while(true)
+			{
+			if(bufferPos==bufferEnd)
+				fillBuffer();
+			char c=buffer[bufferPos++];
+			if(c=='\n')
+				break;
+			if(c!='\r')
+				line.push_back(c);
+			}
+		}
+	void sendRequest(const char* method,const std::string& path,LidarFile::Offset rangeBegin,LidarFile::Offset rangeEnd) // Sends a request for the given half-open byte range of the given path, or for the entire path if the range is empty
+		{
+		std::string request=method;
+		request.push_back(' ');
+		request.append(path);
+		request.append(" HTTP/1.1\r\nHost: ");
+		request.append(host);
+		if(port!=80)
+			{
+			char portName[16];
+			snprintf(portName,sizeof(portName),":%d",port);
+			request.append(portName);
+			}
+		request.append("\r\n");
+		if(rangeBegin<rangeEnd)
+			{
+			char range[64];
+			snprintf(range,sizeof(range),"Range: bytes=%lld-%lld\r\n",(long long)rangeBegin,(long long)(rangeEnd-1));
+			request.append(range);
+			}
+		request.append("Connection: keep-alive\r\n\r\n");
+		
+		const char* rPtr=request.data();
+		size_t rSize=request.size();
+		while(rSize>0)
+			{
+			ssize_t writeResult=send(fd,rPtr,rSize,MSG_NOSIGNAL);
+			if(writeResult<0)
+				{
+				if(errno==EINTR)
+					continue;
+				throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot send to %s:%d",host.c_str(),port);
+				}
+			rPtr+=writeResult;
+			rSize-=size_t(writeResult);
+			}
+		}
+	void readResponse(Response& response) // Reads the status line and headers of a response
+		{
+		std::string line;
+		readLine(line);
+		int minorVersion=0;
+		if(sscanf(line.c_str(),"HTTP/1.%d %d",&minorVersion,&response.status)!=2)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Malformed response from %s:%d",host.c_str(),port);
+		response.contentLength=-1;
+		response.keepAlive=minorVersion>=1;
+		response.validator.clear();
+		while(true)
+			{
+			readLine(line);
+			if(line.empty())
+				break;
+			
+			/* Split the header into name and value: */
+			std::string::size_type colon=line.find(':');
+			if(colon==std::string::npos)
+				continue;
+			std::string value=line.substr(colon+1);
+			value.erase(0,value.find_first_not_of(" \t"));
+			line.erase(colon);
+			if(strcasecmp(line.c_str(),"Content-Length")==0)
+				response.contentLength=LidarFile::Offset(strtoll(value.c_str(),0,10));
+			else if(strcasecmp(line.c_str(),"Connection")==0)
+				response.keepAlive=strcasecmp(value.c_str(),"close")!=0;
+			else if(strcasecmp(line.c_str(),"ETag")==0||(strcasecmp(line.c_str(),"Last-Modified")==0&&response.validator.empty()))
+				response.validator=value;
+			}
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	LidarHttpConnection(const std::string& sHost,int sPort) // Creates a connection to the given server; connects lazily
+		:host(sHost),port(sPort),fd(-1),bufferPos(0),bufferEnd(0)
+		{
+		}
+	~LidarHttpConnection(void)
+		{
+		disconnect();
+		}
+	
+	/* Methods: */
+	void disconnect(void) // Closes the connection to the server
+		{
+		if(fd>=0)
+			close(fd);
+		fd=-1;
+		}
+	void head(const std::string& path,Response& response) // Sends a HEAD request for the given path and reads the response
+		{
+		/* Retry once on a fresh connection if a kept-alive connection was closed by the server: */
+		for(int attempt=0;;++attempt)
+			{
+			try
+				{
+				if(fd<0)
+					connect();
+				sendRequest("HEAD",path,0,0);
+				readResponse(response);
+				break;
+				}
+			catch(const std::runtime_error&)
+				{
+				disconnect();
+				if(attempt>0)
+					throw;
+				}
+			}
+		if(!response.keepAlive)
+			disconnect();
+		}
+	template <class BodySinkParam>
+	void get(const std::string& path,LidarFile::Offset rangeBegin,LidarFile::Offset rangeEnd,BodySinkParam& sink) // Requests the given half-open byte range of the given path and passes the response body to the given sink in pieces
+		{
+		Response response;
+		for(int attempt=0;;++attempt)
+			{
+			try
+				{
+				if(fd<0)
+					connect();
+				sendRequest("GET",path,rangeBegin,rangeEnd);
+				readResponse(response);
+				break;
+				}
+			catch(const std::runtime_error&)
+				{
+				disconnect();
+				if(attempt>0)
+					throw;
+				}
+			}
+		if(response.status!=206||response.contentLength!=rangeEnd-rangeBegin)
+			{
+			disconnect();
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Server %s:%d did not honor range request for %s (status %d)",host.c_str(),port,path.c_str(),response.status);
+			}
+		
+		/* Pass the response body to the sink: */
+		LidarFile::Offset pos=rangeBegin;
+		while(pos<rangeEnd)
+			{
+			if(bufferPos==bufferEnd)
+				fillBuffer();
+			size_t chunkSize=bufferEnd-bufferPos;
+			if(LidarFile::Offset(chunkSize)>rangeEnd-pos)
+				chunkSize=size_t(rangeEnd-pos);
+			sink(pos,buffer+bufferPos,chunkSize);
+			bufferPos+=chunkSize;
+			pos+=LidarFile::Offset(chunkSize);
+			}
+		if(!response.keepAlive)
+			disconnect();
+		}
+	};
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+void makeDirectories(const std::string& path) // Creates the given directory and all its missing ancestors
+	{
+	for(std::string::size_type slash=path.find('/',1);;slash=path.find('/',slash+1))
+		{
+		std::string prefix=path.substr(0,slash);
+		if(mkdir(prefix.c_str(),0777)<0&&errno!=EEXIST)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot create directory %s",prefix.c_str());
+		if(slash==std::string::npos)
+			break;
+		}
+	}
+
+class CacheWriter // Helper class to write fetched blocks that are missing from the cache into a part's cache file
+	{
+	/* Elements: */
+	private:
+	int cacheFd; // The part's cache file
+	const std::vector<bool>& writeBlock; // Flags whether to write each fetched block
+	LidarFile::Offset firstBlockOffset; // Part offset of the first fetched block
+	
+	/* Constructors and destructors: */
+	public:
+	CacheWriter(int sCacheFd,const std::vector<bool>& sWriteBlock,LidarFile::Offset sFirstBlockOffset)
+		:cacheFd(sCacheFd),writeBlock(sWriteBlock),firstBlockOffset(sFirstBlockOffset)
+		{
+		}
+	
+	/* Methods: */
+	void operator()(LidarFile::Offset pos,const char* data,size_t size)
+		{
+		while(size>0)
+			{
+			/* Write or skip the part of the data inside the current block: */
+			size_t blockIndex=size_t((pos-firstBlockOffset)/LidarFile::Offset(LidarRemoteDataset::blockSize));
+			LidarFile::Offset blockEnd=firstBlockOffset+LidarFile::Offset(blockIndex+1)*LidarFile::Offset(LidarRemoteDataset::blockSize);
+			size_t pieceSize=size;
+			if(LidarFile::Offset(pieceSize)>blockEnd-pos)
+				pieceSize=size_t(blockEnd-pos);
+			if(writeBlock[blockIndex])
+				{
+				const char* dPtr=data;
+				size_t dSize=pieceSize;
+				LidarFile::Offset dPos=pos;
+				while(dSize>0)
+					{
+					ssize_t writeResult=pwrite(cacheFd,dPtr,dSize,off_t(dPos));
+					if(writeResult<0)
+						{
+						if(errno==EINTR)
+							continue;
+						throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot write to cache file");
+						}
+					dPtr+=writeResult;
+					dSize-=size_t(writeResult);
+					dPos+=LidarFile::Offset(writeResult);
+					}
+				}
+			pos+=LidarFile::Offset(pieceSize);
+			data+=pieceSize;
+			size-=pieceSize;
+			}
+		}
+	};
+
+}
+
+/***********************************
+Methods of class LidarRemoteDataset:
+***********************************/
+
+LidarRemoteDataset::Part* LidarRemoteDataset::getPart(const char* partName)
+	{
+	/* Return the part if it has been opened before: */
+	PartMap::iterator pIt=parts.find(partName);
+	if(pIt!=parts.end())
+		return pIt->second;
+	
+	/* Query the part's size and validator: */
+	std::string path=basePath;
+	path.append(partName);
+	LidarHttpConnection::Response response;
+	controlConnection->head(path,response);
+	if(response.status==404||response.status==403||response.status==410)
+		{
+		/* Remember that the part does not exist: */
+		parts[partName]=0;
+		return 0;
+		}
+	if(response.status!=200||response.contentLength<0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot query %s on %s:%d (status %d)",path.c_str(),host.c_str(),port,response.status);
+	
+	/* Create the part's state: */
+	Part* part=new Part;
+	part->path=path;
+	part->size=response.contentLength;
+	part->validator=response.validator;
+	part->cacheFileName=cacheDirectory;
+	part->cacheFileName.push_back('/');
+	part->cacheFileName.append(partName);
+	part->blockStamps.resize(size_t((part->size+LidarFile::Offset(blockSize)-1)/LidarFile::Offset(blockSize)),0U);
+	
+	/* Open the part's sparse cache file: */
+	part->cacheFd=open(part->cacheFileName.c_str(),O_RDWR|O_CREAT,0666);
+	if(part->cacheFd<0)
+		{
+		int error=errno;
+		delete part;
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot open cache file %s",part->cacheFileName.c_str());
+		}
+	
+	/* Restore the blocks cached by previous runs if the part did not change on the server: */
+	loadBlockStamps(*part);
+	if(ftruncate(part->cacheFd,off_t(part->size))<0)
+		{
+		int error=errno;
+		close(part->cacheFd);
+		delete part;
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot resize cache file %s",part->cacheFileName.c_str());
+		}
+	
+	parts[partName]=part;
+	return part;
+	}
+
+void LidarRemoteDataset::loadBlockStamps(LidarRemoteDataset::Part& part)
+	{
+	std::string stampsFileName=part.cacheFileName;
+	stampsFileName.append(".blocks");
+	FILE* stampsFile=fopen(stampsFileName.c_str(),"rb");
+	bool valid=false;
+	if(stampsFile!=0)
+		{
+		/* Check the saved part size, block size, and validator: */
+		Misc::UInt64 savedSize=0;
+		Misc::UInt32 savedBlockSize=0;
+		Misc::UInt32 validatorLength=0;
+		if(fread(&savedSize,sizeof(savedSize),1,stampsFile)==1&&fread(&savedBlockSize,sizeof(savedBlockSize),1,stampsFile)==1&&fread(&validatorLength,sizeof(validatorLength),1,stampsFile)==1
+		   &&savedSize==Misc::UInt64(part.size)&&savedBlockSize==Misc::UInt32(blockSize)&&validatorLength==Misc::UInt32(part.validator.size()))
+			{
+			std::string savedValidator(validatorLength,' ');
+			if((validatorLength==0||fread(&savedValidator[0],1,validatorLength,stampsFile)==validatorLength)&&savedValidator==part.validator)
+				valid=fread(&part.blockStamps[0],sizeof(Misc::UInt32),part.blockStamps.size(),stampsFile)==part.blockStamps.size();
+			}
+		fclose(stampsFile);
+		}
+	
+	if(valid)
+		{
+		/* Account for the restored blocks: */
+		for(std::vector<Misc::UInt32>::iterator bsIt=part.blockStamps.begin();bsIt!=part.blockStamps.end();++bsIt)
+			if(*bsIt!=0U)
+				{
+				++numCachedBlocks;
+				if(stampCounter<*bsIt)
+					stampCounter=*bsIt;
+				}
+		}
+	else
+		{
+		/* Discard any stale cache contents: */
+		std::fill(part.blockStamps.begin(),part.blockStamps.end(),0U);
+		if(ftruncate(part.cacheFd,0)<0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot reset cache file %s",part.cacheFileName.c_str());
+		}
+	}
+
+void LidarRemoteDataset::saveBlockStamps(const LidarRemoteDataset::Part& part) const
+	{
+	std::string stampsFileName=part.cacheFileName;
+	stampsFileName.append(".blocks");
+	FILE* stampsFile=fopen(stampsFileName.c_str(),"wb");
+	if(stampsFile==0)
+		return;
+	Misc::UInt64 savedSize=Misc::UInt64(part.size);
+	Misc::UInt32 savedBlockSize=Misc::UInt32(blockSize);
+	Misc::UInt32 validatorLength=Misc::UInt32(part.validator.size());
+	fwrite(&savedSize,sizeof(savedSize),1,stampsFile);
+	fwrite(&savedBlockSize,sizeof(savedBlockSize),1,stampsFile);
+	fwrite(&validatorLength,sizeof(validatorLength),1,stampsFile);
+	fwrite(part.validator.data(),1,validatorLength,stampsFile);
+	if(!part.blockStamps.empty())
+		fwrite(&part.blockStamps[0],sizeof(Misc::UInt32),part.blockStamps.size(),stampsFile);
+	fclose(stampsFile);
+	}
+
+void LidarRemoteDataset::evictBlocks(Misc::UInt32 minKeepStamp)
+	{
+	size_t maxNumBlocks=maxCacheSize/blockSize;
+	if(numCachedBlocks<=maxNumBlocks)
+		return;
+	
+	/* Collect the stamps of all evictable blocks: */
+	std::vector<Misc::UInt32> stamps;
+	for(PartMap::iterator pIt=parts.begin();pIt!=parts.end();++pIt)
+		if(pIt->second!=0)
+			for(std::vector<Misc::UInt32>::iterator bsIt=pIt->second->blockStamps.begin();bsIt!=pIt->second->blockStamps.end();++bsIt)
+				if(*bsIt!=0U&&*bsIt<minKeepStamp)
+					stamps.push_back(*bsIt);
+	
+	/* Evict enough blocks to shrink the cache to 90% of its limit, to amortize the cost of eviction: */
+	size_t numEvict=numCachedBlocks-(maxNumBlocks*9)/10;
+	if(numEvict>stamps.size())
+		numEvict=stamps.size();
+	if(numEvict==0)
+		return;
+	std::nth_element(stamps.begin(),stamps.begin()+(numEvict-1),stamps.end());
+	Misc::UInt32 maxEvictStamp=stamps[numEvict-1];
+	
+	for(PartMap::iterator pIt=parts.begin();pIt!=parts.end();++pIt)
+		if(pIt->second!=0)
+			{
+			Part& part=*pIt->second;
+			for(size_t i=0;i<part.blockStamps.size();++i)
+				if(part.blockStamps[i]!=0U&&part.blockStamps[i]<=maxEvictStamp)
+					{
+					part.blockStamps[i]=0U;
+					--numCachedBlocks;
+					
+					#ifdef __linux__
+					/* Release the block's disk space: */
+					fallocate(part.cacheFd,FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE,off_t(i)*off_t(blockSize),off_t(blockSize));
+					#endif
+					}
+			}
+	}
+
+void LidarRemoteDataset::read(LidarRemoteDataset::Part& part,LidarHttpConnection& connection,LidarFile::Offset offset,size_t size,void* buffer)
+	{
+	size_t firstBlock=size_t(offset/LidarFile::Offset(blockSize));
+	size_t endBlock=size_t((offset+LidarFile::Offset(size)+LidarFile::Offset(blockSize)-1)/LidarFile::Offset(blockSize));
+	
+	/* Extend the fetched range to read ahead of sequential reads: */
+	size_t minFetchBlocks=(minFetchSize+blockSize-1)/blockSize;
+	size_t fetchEndBlock=std::max(endBlock,firstBlock+minFetchBlocks);
+	if(fetchEndBlock>part.blockStamps.size())
+		fetchEndBlock=part.blockStamps.size();
+	
+	Misc::UInt32 requestStamp=0;
+	while(true)
+		{
+		/* Find the first and last missing block in the fetched range: */
+		size_t fetchFirst=fetchEndBlock;
+		size_t fetchEnd=firstBlock;
+		{
+		Threads::Mutex::Lock lock(mutex);
+		if(requestStamp==0U)
+			requestStamp=stampCounter+1;
+		bool requestedMissing=false;
+		for(size_t i=firstBlock;i<fetchEndBlock;++i)
+			if(part.blockStamps[i]==0U)
+				{
+				if(i<endBlock)
+					requestedMissing=true;
+				if(fetchFirst>i)
+					fetchFirst=i;
+				fetchEnd=i+1;
+				}
+		
+		if(!requestedMissing)
+			{
+			/* Mark the requested blocks as used and read them from the cache file: */
+			++stampCounter;
+			for(size_t i=firstBlock;i<endBlock;++i)
+				part.blockStamps[i]=stampCounter;
+			char* bPtr=static_cast<char*>(buffer);
+			size_t bSize=size;
+			off_t bPos=off_t(offset);
+			while(bSize>0)
+				{
+				ssize_t readResult=pread(part.cacheFd,bPtr,bSize,bPos);
+				if(readResult<0&&errno==EINTR)
+					continue;
+				if(readResult<=0)
+					throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot read from cache file %s",part.cacheFileName.c_str());
+				bPtr+=readResult;
+				bSize-=size_t(readResult);
+				bPos+=off_t(readResult);
+				}
+			return;
+			}
+		}
+		
+		/* Fetch missing blocks in runs, along with short runs of cached blocks between them, without holding the mutex: */
+		std::vector<size_t> newBlocks;
+		size_t runFirst=fetchFirst;
+		while(runFirst<fetchEnd)
+			{
+			/* Find the end of the run, bridging short gaps of cached blocks: */
+			std::vector<bool> writeBlock;
+			size_t runEnd=runFirst;
+			size_t gap=0;
+			{
+			Threads::Mutex::Lock lock(mutex);
+			for(size_t i=runFirst;i<fetchEnd&&gap<=maxGapBlocks;++i)
+				{
+				bool missing=part.blockStamps[i]==0U;
+				writeBlock.push_back(missing);
+				if(missing)
+					{
+					runEnd=i+1;
+					gap=0;
+					}
+				else
+					++gap;
+				}
+			}
+			writeBlock.resize(runEnd-runFirst);
+			
+			/* Fetch the run and write its missing blocks into the cache file: */
+			LidarFile::Offset rangeBegin=LidarFile::Offset(runFirst)*LidarFile::Offset(blockSize);
+			LidarFile::Offset rangeEnd=std::min(LidarFile::Offset(runEnd)*LidarFile::Offset(blockSize),part.size);
+			CacheWriter writer(part.cacheFd,writeBlock,rangeBegin);
+			connection.get(part.path,rangeBegin,rangeEnd,writer);
+			for(size_t i=0;i<writeBlock.size();++i)
+				if(writeBlock[i])
+					newBlocks.push_back(runFirst+i);
+			
+			{
+			Threads::Mutex::Lock lock(mutex);
+			numFetchedBytes+=size_t(rangeEnd-rangeBegin);
+			
+			/* Find the beginning of the next run: */
+			for(runFirst=runEnd;runFirst<fetchEnd&&part.blockStamps[runFirst]!=0U;++runFirst)
+				;
+			}
+			}
+		
+		/* Mark the fetched blocks as cached and make room for them, keeping all blocks used since this request started: */
+		{
+		Threads::Mutex::Lock lock(mutex);
+		++stampCounter;
+		for(std::vector<size_t>::iterator nbIt=newBlocks.begin();nbIt!=newBlocks.end();++nbIt)
+			if(part.blockStamps[*nbIt]==0U)
+				{
+				part.blockStamps[*nbIt]=stampCounter;
+				++numCachedBlocks;
+				}
+		evictBlocks(requestStamp);
+		}
+		}
+	}
+
+LidarRemoteDataset::LidarRemoteDataset(const char* url,const char* cacheBaseDirectory,size_t sMaxCacheSize)
+	:port(80),
+	 maxCacheSize(sMaxCacheSize),
+	 controlConnection(0),
+	 stampCounter(0U),numCachedBlocks(0),numFetchedBytes(0)
+	{
+	/* Split the URL into host name, port, and path: */
+	if(!isRemote(url))
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"%s is not an http:// URL",url);
+	const char* hostStart=url+7;
+	const char* hostEnd=hostStart;
+	while(*hostEnd!='\0'&&*hostEnd!=':'&&*hostEnd!='/')
+		++hostEnd;
+	host=std::string(hostStart,hostEnd);
+	const char* pathStart=hostEnd;
+	if(*pathStart==':')
+		{
+		port=int(strtol(pathStart+1,const_cast<char**>(&pathStart),10));
+		if(port<=0||port>65535)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Invalid port number in URL %s",url);
+		}
+	if(host.empty())
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No host name in URL %s",url);
+	basePath=*pathStart=='\0'?"/":pathStart;
+	if(basePath[basePath.size()-1]!='/')
+		basePath.push_back('/');
+	
+	/* Create this dataset's cache directory, named after the URL: */
+	cacheDirectory=cacheBaseDirectory;
+	cacheDirectory.push_back('/');
+	for(const char* uPtr=hostStart;*uPtr!='\0';++uPtr)
+		cacheDirectory.push_back(isalnum(*uPtr)||*uPtr=='.'||*uPtr=='-'?*uPtr:'_');
+	makeDirectories(cacheDirectory);
+	
+	controlConnection=new LidarHttpConnection(host,port);
+	}
+
+LidarRemoteDataset::~LidarRemoteDataset(void)
+	{
+	/* Save the cache state of all parts and close their cache files: */
+	for(PartMap::iterator pIt=parts.begin();pIt!=parts.end();++pIt)
+		if(pIt->second!=0)
+			{
+			saveBlockStamps(*pIt->second);
+			close(pIt->second->cacheFd);
+			delete pIt->second;
+			}
+	
+	delete controlConnection;
+	}
+
+bool LidarRemoteDataset::hasPart(const char* partName)
+	{
+	Threads::Mutex::Lock lock(mutex);
+	return getPart(partName)!=0;
+	}
+
+LidarSourceFile* LidarRemoteDataset::openPart(const char* partName)
+	{
+	Part* part;
+	{
+	Threads::Mutex::Lock lock(mutex);
+	part=getPart(partName);
+	}
+	if(part==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Remote LiDAR file does not contain part %s",partName);
+	return new LidarRemoteFile(*this,*part);
+	}
+
+/********************************
+Methods of class LidarRemoteFile:
+********************************/
+
+size_t LidarRemoteFile::readData(IO::File::Byte* buffer,size_t bufferSize)
+	{
+	/* Signal end-of-file if the read position is at or past the end of the part: */
+	if(readPos>=part.size)
+		return 0;
+	
+	/* Read as much as possible through the dataset's cache: */
+	size_t readSize=bufferSize;
+	if(LidarFile::Offset(readSize)>part.size-readPos)
+		readSize=size_t(part.size-readPos);
+	dataset.read(part,*connection,readPos,readSize,buffer);
+	readPos+=Offset(readSize);
+	
+	return readSize;
+	}
+
+LidarRemoteFile::LidarRemoteFile(LidarRemoteDataset& sDataset,LidarRemoteDataset::Part& sPart)
+	:IO::SeekableFile(),
+	 dataset(sDataset),part(sPart),
+	 connection(new LidarHttpConnection(sDataset.host,sDataset.port))
+	{
+	/* Install a read buffer the size of one cache block: */
+	resizeReadBuffer(LidarRemoteDataset::blockSize);
+	}
+
+LidarRemoteFile::~LidarRemoteFile(void)
+	{
+	delete connection;
+	}
+
+IO::SeekableFile::Offset LidarRemoteFile::getSize(void) const
+	{
+	return Offset(part.size);
+	}
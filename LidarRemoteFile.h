@@ -0,0 +1,143 @@
+/***********************************************************************
+LidarRemoteFile - Classes to read the parts of a LiDAR file stored on an
+HTTP server through range requests, with a bounded persistent local
+cache of fetched blocks.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARREMOTEFILE_INCLUDED
+#define LIDARREMOTEFILE_INCLUDED
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <Misc/SizedTypes.h>
+#include <Threads/Mutex.h>
+#include <IO/SeekableFile.h>
+
+#include "LidarFile.h"
+
+/***********************************************************************
+A remote LiDAR file is named by an http:// URL of its directory. Each
+part (Index, Points, etc.) is fetched in fixed-size blocks through HTTP
+range requests; runs of missing blocks are fetched with one request, and
+short runs of cached blocks between missing ones are fetched along to
+avoid extra round trips. Fetched blocks are stored in sparse cache files
+inside a per-dataset cache directory, and survive between runs as long
+as the server reports the same size and validator (ETag or
+Last-Modified) for a part. The least recently used blocks of all parts
+are evicted when the cache exceeds its size limit.
+***********************************************************************/
+
+/* Forward declarations: */
+class LidarHttpConnection;
+
+class LidarRemoteDataset // Class representing a LiDAR file on an HTTP server and its local block cache
+	{
+	friend class LidarRemoteFile;
+	
+	/* Embedded classes: */
+	private:
+	struct Part // Structure for the cache state of one part of the LiDAR file
+		{
+		/* Elements: */
+		public:
+		std::string path; // Path of the part on the server
+		LidarFile::Offset size; // Size of the part in bytes
+		std::string validator; // ETag or Last-Modified header reported by the server, to detect changed parts
+		std::string cacheFileName; // Name of the part's sparse cache file
+		int cacheFd; // File descriptor of the part's cache file
+		std::vector<Misc::UInt32> blockStamps; // Last access stamp of each cached block, or 0 if the block is not cached
+		};
+	
+	typedef std::map<std::string,Part*> PartMap; // Type for maps from part names to part states
+	
+	public:
+	static const size_t blockSize=256*1024; // Size of cached blocks in bytes
+	static const size_t minFetchSize=1024*1024; // Minimum number of bytes to fetch ahead of a read
+	static const size_t maxGapBlocks=2; // Maximum number of cached blocks between two runs of missing blocks that are fetched along
+	
+	/* Elements: */
+	private:
+	std::string host; // Host name of the HTTP server
+	int port; // Port number of the HTTP server
+	std::string basePath; // Path of the LiDAR file directory on the server, with trailing slash
+	std::string cacheDirectory; // Directory holding this dataset's cache files
+	size_t maxCacheSize; // Maximum total size of cached blocks in bytes
+	Threads::Mutex mutex; // Mutex serializing access to the cache state
+	LidarHttpConnection* controlConnection; // Connection used to query part sizes
+	PartMap parts; // Map of parts opened so far
+	Misc::UInt32 stampCounter; // Counter for block access stamps
+	size_t numCachedBlocks; // Total number of cached blocks in all parts
+	size_t numFetchedBytes; // Total number of bytes fetched from the server
+	
+	/* Private methods: */
+	Part* getPart(const char* partName); // Returns the state of the given part, querying the server if the part has not been opened before; returns null if the part does not exist; mutex must be locked
+	void loadBlockStamps(Part& part); // Restores the given part's cached blocks from a previous run
+	void saveBlockStamps(const Part& part) const; // Saves the given part's cached blocks for future runs
+	void evictBlocks(Misc::UInt32 minKeepStamp); // Evicts least recently used blocks with stamps smaller than the given stamp until the cache fits its size limit; mutex must be locked
+	void read(Part& part,LidarHttpConnection& connection,LidarFile::Offset offset,size_t size,void* buffer); // Reads the given byte range of the given part through the cache, using the given connection to fetch missing blocks
+	
+	/* Constructors and destructors: */
+	public:
+	LidarRemoteDataset(const char* url,const char* cacheBaseDirectory,size_t sMaxCacheSize); // Opens the remote LiDAR file of the given URL with a cache of the given maximum size in bytes in a subdirectory of the given directory; throws exception if the URL is invalid
+	private:
+	LidarRemoteDataset(const LidarRemoteDataset& source); // Prohibit copy constructor
+	LidarRemoteDataset& operator=(const LidarRemoteDataset& source); // Prohibit assignment operator
+	public:
+	~LidarRemoteDataset(void); // Saves the cache state; all part files must have been closed
+	
+	/* Methods: */
+	static bool isRemote(const char* lidarFileName) // Returns true if the given LiDAR file name is an HTTP URL
+		{
+		return strncmp(lidarFileName,"http://",7)==0;
+		}
+	bool hasPart(const char* partName); // Returns true if the remote LiDAR file contains the given part
+	LidarSourceFile* openPart(const char* partName); // Returns a new read-only handle to the given part; throws exception if the part does not exist
+	size_t getNumFetchedBytes(void) const // Returns the total number of bytes fetched from the server so far
+		{
+		return numFetchedBytes;
+		}
+	};
+
+class LidarRemoteFile:public IO::SeekableFile // Class for read-only handles to parts of remote LiDAR files
+	{
+	/* Elements: */
+	private:
+	LidarRemoteDataset& dataset; // The dataset containing the part
+	LidarRemoteDataset::Part& part; // The part read through this handle
+	LidarHttpConnection* connection; // Connection private to this handle
+	
+	/* Protected methods from IO::File: */
+	protected:
+	virtual size_t readData(Byte* buffer,size_t bufferSize);
+	
+	/* Constructors and destructors: */
+	public:
+	LidarRemoteFile(LidarRemoteDataset& sDataset,LidarRemoteDataset::Part& sPart); // Creates a handle to the given part of the given dataset
+	virtual ~LidarRemoteFile(void);
+	
+	/* Methods from IO::SeekableFile: */
+	virtual Offset getSize(void) const;
+	};
+
+#endif
@@ -0,0 +1,301 @@
+/***********************************************************************
+LidarRidgeFinder - Post-processing filter to classify the points of a
+LiDAR data set as ridges or else, and to store the classification as a
+color file.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <Misc/StdError.h>
+#include <Threads/Mutex.h>
+#include <Math/Math.h>
+
+#include "LidarTypes.h"
+#include "LidarFile.h"
+#include "LidarProcessOctree.h"
+#include "KNearestNeighborHeap.h"
+#include "RidgeClassifier.h"
+
+/**************
+Helper classes:
+**************/
+
+class NodeClassifier // Result functor classifying the points of a node from their batched neighborhood queries
+	{
+	/* Elements: */
+	private:
+	const LidarPoint* points; // The points of the classified node
+	Scalar radius2; // The squared search radius around each point
+	std::vector<LidarPoint> neighbors; // The neighborhood of the currently classified point
+	Color* colors; // Array receiving the colors of the node's points
+	size_t numRidgePoints; // Number of ridge points in the node
+	
+	/* Constructors and destructors: */
+	public:
+	NodeClassifier(const LidarPoint* sPoints,Scalar sRadius2,unsigned int maxNumNeighbors,Color* sColors)
+		:points(sPoints),radius2(sRadius2),
+		 colors(sColors),
+		 numRidgePoints(0)
+		{
+		neighbors.reserve(maxNumNeighbors);
+		}
+	
+	/* Methods: */
+	void operator()(unsigned int pointIndex,const KNearestNeighborHeap<>& heap)
+		{
+		/* Copy the point's neighborhood out of the heap: */
+		neighbors.clear();
+		for(unsigned int i=0;i<heap.getNumNeighbors();++i)
+			neighbors.push_back(heap.getNeighbor(i).point);
+		
+		/* Classify the point: */
+		if(!neighbors.empty()&&RidgeClassifier::isRidge(points[pointIndex],radius2,&neighbors[0],neighbors.size()))
+			{
+			colors[pointIndex]=Color(255,255,255);
+			++numRidgePoints;
+			}
+		else
+			colors[pointIndex]=Color(0,0,0);
+		}
+	size_t getNumRidgePoints(void) const
+		{
+		return numRidgePoints;
+		}
+	};
+
+/***********************************************************
+Octree traversal functor class to classify points as ridges:
+***********************************************************/
+
+class NodeRidgeFinder // Node functor to classify the points of a LiDAR octree as ridges or else from multiple threads, and to write the classification into a color file
+	{
+	/* Elements: */
+	private:
+	LidarProcessOctree& lpo; // The processed LiDAR octree
+	Scalar radius2; // The squared search radius around each LiDAR point
+	unsigned int maxNumNeighbors; // Maximum number of neighbors considered around each LiDAR point
+	LidarFile::Offset colorDataSize; // Size of each record in the color file
+	int colorFd; // File descriptor of the color file, which is written at explicit positions by concurrent threads
+	Threads::Mutex statusMutex; // Mutex protecting the progress counters and error message
+	size_t numProcessedNodes; // Number of already processed nodes
+	size_t nextProgressUpdate; // Number of processed nodes at which the progress indicator should be updated
+	size_t numRidgePoints; // Number of LiDAR points classified as ridges
+	std::string errorMessage; // Message of the first error that occurred during processing
+	
+	/* Private methods: */
+	void writeColors(const Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const; // Writes a node's colors to the color file
+	size_t classifyNode(LidarProcessOctree::Node& node); // Classifies the given node's points and writes their colors to the color file; returns number of ridge points
+	
+	/* Constructors and destructors: */
+	public:
+	NodeRidgeFinder(LidarProcessOctree& sLpo,Scalar sRadius,unsigned int sMaxNumNeighbors,const char* colorFileName); // Creates a ridge finder with the given parameters
+	private:
+	NodeRidgeFinder(const NodeRidgeFinder& source); // Prohibit copy constructor
+	NodeRidgeFinder& operator=(const NodeRidgeFinder& source); // Prohibit assignment operator
+	public:
+	~NodeRidgeFinder(void);
+	
+	/* Methods: */
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel); // Processes a node; thread-safe if called from a parallel traversal
+	size_t getNumRidgePoints(void) const // Returns the number of LiDAR points classified as ridges
+		{
+		return numRidgePoints;
+		}
+	const std::string& getErrorMessage(void) const // Returns the message of the first error that occurred during processing, or an empty string
+		{
+		return errorMessage;
+		}
+	};
+
+/********************************
+Methods of class NodeRidgeFinder:
+********************************/
+
+void NodeRidgeFinder::writeColors(const Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const
+	{
+	const char* bufPtr=reinterpret_cast<const char*>(colors);
+	size_t numBytes=size_t(numColors)*sizeof(Color);
+	off_t pos=off_t(LidarDataFileHeader::getFileSize()+colorDataSize*dataOffset);
+	while(numBytes>0)
+		{
+		ssize_t writeResult=pwrite(colorFd,bufPtr,numBytes,pos);
+		if(writeResult<0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot write colors at offset %llu",(unsigned long long)dataOffset);
+		bufPtr+=writeResult;
+		numBytes-=size_t(writeResult);
+		pos+=off_t(writeResult);
+		}
+	}
+
+size_t NodeRidgeFinder::classifyNode(LidarProcessOctree::Node& node)
+	{
+	if(node.getNumPoints()==0)
+		return 0;
+	
+	/* Query the neighborhoods of all the node's points in one batch of spatially adjacent queries: */
+	std::vector<Color> colors(node.getNumPoints());
+	NodeClassifier nc(node.getPoints(),radius2,maxNumNeighbors,&colors[0]);
+	KNearestNeighborHeap<> heap(maxNumNeighbors);
+	lpo.processKNearestNeighbors(node.getPoints(),node.getNumPoints(),heap,radius2,nc);
+	
+	/* Write the node's colors to the color file: */
+	writeColors(&colors[0],node.getDataOffset(),node.getNumPoints());
+	
+	return nc.getNumRidgePoints();
+	}
+
+NodeRidgeFinder::NodeRidgeFinder(LidarProcessOctree& sLpo,Scalar sRadius,unsigned int sMaxNumNeighbors,const char* colorFileName)
+	:lpo(sLpo),
+	 radius2(Math::sqr(sRadius)),
+	 maxNumNeighbors(sMaxNumNeighbors),
+	 colorDataSize(sizeof(Color)),
+	 colorFd(-1),
+	 numProcessedNodes(0),nextProgressUpdate((lpo.getNumNodes()+199)/200),
+	 numRidgePoints(0)
+	{
+	{
+	/* Write the color file's header: */
+	LidarFile colorFile(colorFileName,LidarFile::ReadWrite);
+	colorFile.setEndianness(Misc::LittleEndian);
+	LidarDataFileHeader dfh((unsigned int)(colorDataSize));
+	dfh.write(colorFile);
+	}
+	
+	/* Reopen the color file for positional writes: */
+	colorFd=open(colorFileName,O_RDWR);
+	if(colorFd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot open color file %s",colorFileName);
+	}
+
+NodeRidgeFinder::~NodeRidgeFinder(void)
+	{
+	close(colorFd);
+	}
+
+void NodeRidgeFinder::operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
+	{
+	/* Classify the node's points; each node's colors are written independently of all other nodes: */
+	size_t nodeNumRidgePoints=0;
+	std::string nodeErrorMessage;
+	try
+		{
+		nodeNumRidgePoints=classifyNode(node);
+		}
+	catch(const std::runtime_error& err)
+		{
+		/* Parallel traversals do not allow exceptions; remember the error instead: */
+		nodeErrorMessage=err.what();
+		}
+	
+	/* Update the progress counter: */
+	Threads::Mutex::Lock statusLock(statusMutex);
+	numRidgePoints+=nodeNumRidgePoints;
+	if(errorMessage.empty())
+		errorMessage=nodeErrorMessage;
+	++numProcessedNodes;
+	if(numProcessedNodes>=nextProgressUpdate)
+		{
+		int percent=int((numProcessedNodes*100+lpo.getNumNodes()/2)/lpo.getNumNodes());
+		std::cout<<"\rFinding ridges... "<<std::setw(3)<<percent<<"%"<<std::flush;
+		nextProgressUpdate=((percent+1)*lpo.getNumNodes()-lpo.getNumNodes()/2+99)/100;
+		}
+	}
+
+
+int main(int argc,char* argv[])
+	{
+	/* Parse the command line: */
+	size_t memoryCache=512;
+	const char* lidarFileName=0;
+	float neighborhoodRadius=1.0f;
+	unsigned int maxNumNeighbors=256;
+	const char* colorFileName=0;
+	unsigned int numThreads=1;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"cache")==0)
+				{
+				++i;
+				memoryCache=size_t(atoi(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"radius")==0)
+				{
+				++i;
+				neighborhoodRadius=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"maxNeighbors")==0)
+				{
+				++i;
+				maxNumNeighbors=(unsigned int)atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"threads")==0)
+				{
+				++i;
+				numThreads=(unsigned int)atoi(argv[i]);
+				}
+			}
+		else if(lidarFileName==0)
+			lidarFileName=argv[i];
+		else if(colorFileName==0)
+			colorFileName=argv[i];
+		}
+	if(lidarFileName==0)
+		{
+		std::cerr<<"No LiDAR file name provided"<<std::endl;
+		return 1;
+		}
+	if(colorFileName==0)
+		colorFileName="Ridges";
+	
+	/* Open the LiDAR octree file: */
+	LidarProcessOctree lpo(lidarFileName,memoryCache*size_t(1024*1024));
+	lpo.startPrefetching();
+	
+	/* Classify all points in the octree; all nodes are independent, and each node's neighborhoods are queried in one batch: */
+	std::string ridgeFileName=lidarFileName;
+	ridgeFileName.push_back('/');
+	ridgeFileName.append(colorFileName);
+	NodeRidgeFinder nodeRidgeFinder(lpo,neighborhoodRadius,maxNumNeighbors,ridgeFileName.c_str());
+	std::cout<<"Finding ridges...   0%"<<std::flush;
+	if(numThreads>1)
+		lpo.processNodesPrefixParallel(nodeRidgeFinder,numThreads);
+	else
+		lpo.processNodesPrefix(nodeRidgeFinder);
+	std::cout<<std::endl;
+	if(!nodeRidgeFinder.getErrorMessage().empty())
+		{
+		std::cerr<<"Error while finding ridges: "<<nodeRidgeFinder.getErrorMessage()<<std::endl;
+		return 1;
+		}
+	std::cout<<nodeRidgeFinder.getNumRidgePoints()<<" LiDAR points classified as ridges"<<std::endl;
+	
+	return 0;
+	}
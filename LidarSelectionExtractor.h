@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarSelectionExtractor - Point processor functor class to collect the
 set of selected points into a vector.
-Copyright (c) 2007-2008 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,6 +24,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef LIDARSELECTIONEXTRACTOR_INCLUDED
 #define LIDARSELECTIONEXTRACTOR_INCLUDED
 
+#include <stddef.h>
 #include <vector>
 
 template <class PointParam>
@@ -35,14 +36,27 @@ class LidarSelectionExtractor
 	
 	/* Elements: */
 	private:
+	size_t stride; // Only every stride-th processed point is extracted
+	size_t strideCounter; // Number of points processed since the last extracted point
 	std::vector<Point> points; // Vector holding extracted points
 	
-	/* Methods: */
+	/* Constructors and destructors: */
 	public:
+	LidarSelectionExtractor(size_t sStride =1) // Creates an extractor for every stride-th processed point
+		:stride(sStride),strideCounter(0)
+		{
+		};
+	
+	/* Methods: */
 	void operator()(const LidarPoint& lp) // Process the given LiDAR point
 		{
-		/* Convert the point to the desired type and store it in the vector: */
-		points.push_back(Point(lp[0],lp[1],lp[2])); // Workaround for stupid g++ 4.0.1 on Mac OS X; chooses plain copy constructor here
+		if(strideCounter==0)
+			{
+			/* Convert the point to the desired type and store it in the vector: */
+			points.push_back(Point(lp[0],lp[1],lp[2])); // Workaround for stupid g++ 4.0.1 on Mac OS X; chooses plain copy constructor here
+			}
+		if(++strideCounter==stride)
+			strideCounter=0;
 		};
 	const std::vector<Point>& getPoints(void) const // Returns the vector of extracted points
 		{
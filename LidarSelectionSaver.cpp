@@ -0,0 +1,276 @@
+/***********************************************************************
+LidarSelectionSaver - Class to take a snapshot of the set of selected
+points and save it to a file from a background thread.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarSelectionSaver.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <Misc/FileNameExtensions.h>
+#include <IO/OpenFile.h>
+#include <Math/Math.h>
+
+/************************************
+Methods of class LidarSelectionSaver:
+************************************/
+
+void LidarSelectionSaver::saveAscii(void)
+	{
+	/* Format whole blocks of points into a text buffer: */
+	std::vector<char> buffer(blockSize*160);
+	bool haveNormals=!normals.empty();
+	for(size_t blockStart=0;blockStart<points.size()&&!cancelSaving;blockStart+=blockSize)
+		{
+		size_t blockEnd=blockStart+blockSize;
+		if(blockEnd>points.size())
+			blockEnd=points.size();
+		char* bPtr=&buffer[0];
+		for(size_t i=blockStart;i<blockEnd;++i)
+			{
+			const LidarPoint& lp=points[i];
+			double op[3];
+			for(int j=0;j<3;++j)
+				op[j]=double(lp[j])+pointOffset[j];
+			if(haveNormals)
+				{
+				const Vector& normal=normals[i];
+				bPtr+=snprintf(bPtr,160,"%.12g %.12g %.12g %.4f %.4f %.4f %u %u %u\n",op[0],op[1],op[2],normal[0],normal[1],normal[2],(unsigned int)lp.value[0],(unsigned int)lp.value[1],(unsigned int)lp.value[2]);
+				}
+			else
+				bPtr+=snprintf(bPtr,160,"%.12g %.12g %.12g %u %u %u\n",op[0],op[1],op[2],(unsigned int)lp.value[0],(unsigned int)lp.value[1],(unsigned int)lp.value[2]);
+			}
+		selectionFile->writeRaw(&buffer[0],bPtr-&buffer[0]);
+		blockSaved(blockEnd);
+		}
+	}
+
+void LidarSelectionSaver::saveBinary(void)
+	{
+	/* Write the point offset vector and the number of points: */
+	selectionFile->write(pointOffset,3);
+	selectionFile->write<unsigned int>((unsigned int)points.size());
+	
+	/* Write the point records: */
+	for(size_t blockStart=0;blockStart<points.size()&&!cancelSaving;blockStart+=blockSize)
+		{
+		size_t blockEnd=blockStart+blockSize;
+		if(blockEnd>points.size())
+			blockEnd=points.size();
+		for(size_t i=blockStart;i<blockEnd;++i)
+			{
+			selectionFile->write(points[i].getComponents(),3);
+			selectionFile->write(points[i].value.getRgba(),4);
+			}
+		blockSaved(blockEnd);
+		}
+	}
+
+void LidarSelectionSaver::saveLas(void)
+	{
+	/* Calculate the snapshot's bounding box: */
+	Box bbox=Box::empty;
+	for(std::vector<LidarPoint>::const_iterator pIt=points.begin();pIt!=points.end();++pIt)
+		bbox.addPoint(*pIt);
+	
+	/* Quantize positions to millimeters around the bounding box's center: */
+	double scale[3],offset[3];
+	for(int i=0;i<3;++i)
+		{
+		scale[i]=0.001;
+		offset[i]=points.empty()?0.0:(double(bbox.min[i])+double(bbox.max[i]))*0.5;
+		}
+	
+	/* Write the LAS file header: */
+	char signature[5]="LASF";
+	selectionFile->write(signature,4); // LAS signature
+	selectionFile->write<unsigned short>(0); // File source ID
+	selectionFile->write<unsigned short>(0); // Reserved field
+	selectionFile->write<unsigned int>(0); // Project ID
+	selectionFile->write<unsigned short>(0); // Project ID
+	selectionFile->write<unsigned short>(0); // Project ID
+	char dummy[32];
+	memset(dummy,0,sizeof(dummy));
+	selectionFile->write(dummy,8); // Project ID
+	selectionFile->write<unsigned char>(1); // File version number
+	selectionFile->write<unsigned char>(2); // File version number
+	selectionFile->write(dummy,32); // System identifier
+	selectionFile->write(dummy,32); // Generating software
+	selectionFile->write<unsigned short>(1); // File creation day of year
+	selectionFile->write<unsigned short>(2011); // File creation year
+	selectionFile->write<unsigned short>(227); // LAS header size
+	selectionFile->write<unsigned int>(227); // Point data offset
+	selectionFile->write<unsigned int>(0); // Number of variable-length records
+	selectionFile->write<unsigned char>(2); // Point data format
+	selectionFile->write<unsigned short>(26); // Point data record length
+	selectionFile->write<unsigned int>((unsigned int)points.size()); // Number of point records
+	selectionFile->write<unsigned int>((unsigned int)points.size()); // Number of point records by return
+	selectionFile->write<unsigned int>(0); // Number of point records by return
+	selectionFile->write<unsigned int>(0); // Number of point records by return
+	selectionFile->write<unsigned int>(0); // Number of point records by return
+	selectionFile->write<unsigned int>(0); // Number of point records by return
+	selectionFile->write(scale,3); // Quantization scale factor
+	for(int i=0;i<3;++i) // Quantization offset vector
+		selectionFile->write<double>(offset[i]+pointOffset[i]);
+	for(int i=0;i<3;++i) // Point position bounding box
+		{
+		selectionFile->write<double>(double(bbox.max[i])+pointOffset[i]);
+		selectionFile->write<double>(double(bbox.min[i])+pointOffset[i]);
+		}
+	
+	/* Write the point data records: */
+	for(size_t blockStart=0;blockStart<points.size()&&!cancelSaving;blockStart+=blockSize)
+		{
+		size_t blockEnd=blockStart+blockSize;
+		if(blockEnd>points.size())
+			blockEnd=points.size();
+		for(size_t i=blockStart;i<blockEnd;++i)
+			{
+			const LidarPoint& lp=points[i];
+			
+			/* Quantize the point position: */
+			int p[3];
+			for(int j=0;j<3;++j)
+				p[j]=int(Math::floor((double(lp[j])-offset[j])/scale[j]+0.5));
+			
+			/* Calculate point intensity from RGB color: */
+			unsigned short intensity=((unsigned short)(lp.value[0])+(unsigned short)(lp.value[1])+(unsigned short)(lp.value[2])+1)/3;
+			
+			/* Write the point record: */
+			selectionFile->write(p,3); // Quantized point position
+			selectionFile->write<unsigned short>(intensity); // Point intensity
+			selectionFile->write<char>(0); // Return data
+			selectionFile->write<char>(0); // Point classification
+			selectionFile->write<unsigned char>(0); // Laser angle
+			selectionFile->write<unsigned char>(0); // User data
+			selectionFile->write<unsigned short>(0); // Source
+			for(int j=0;j<3;++j) // Point color
+				selectionFile->write<unsigned short>(lp.value[j]);
+			}
+		blockSaved(blockEnd);
+		}
+	}
+
+void LidarSelectionSaver::blockSaved(size_t newNumSavedPoints)
+	{
+	numSavedPoints.set(newNumSavedPoints);
+	
+	/* Notify the application: */
+	if(progressFunction!=0)
+		progressFunction(progressFunctionArg);
+	}
+
+void* LidarSelectionSaver::saverThreadMethod(void)
+	{
+	std::string threadErrorMessage;
+	try
+		{
+		/* Write the snapshot in the selected format: */
+		switch(fileFormat)
+			{
+			case ASCII:
+				saveAscii();
+				break;
+			
+			case BINARY:
+				saveBinary();
+				break;
+			
+			case LAS:
+				saveLas();
+				break;
+			}
+		
+		/* Close the selection file to flush all buffered data: */
+		selectionFile=0;
+		}
+	catch(const std::runtime_error& err)
+		{
+		threadErrorMessage=err.what();
+		}
+	
+	/* Mark saving as finished: */
+	{
+	Threads::Mutex::Lock statusLock(statusMutex);
+	errorMessage=threadErrorMessage;
+	finished=true;
+	}
+	
+	/* Notify the application one last time: */
+	if(progressFunction!=0)
+		progressFunction(progressFunctionArg);
+	
+	return 0;
+	}
+
+LidarSelectionSaver::LidarSelectionSaver(const char* sSelectionFileName,const double sPointOffset[3],LidarSelectionSaver::ProgressFunction sProgressFunction,void* sProgressFunctionArg)
+	:selectionFileName(sSelectionFileName),
+	 selectionFile(IO::openSeekableFile(sSelectionFileName,IO::File::WriteOnly)),
+	 fileFormat(getFileFormat(sSelectionFileName)),
+	 progressFunction(sProgressFunction),progressFunctionArg(sProgressFunctionArg),
+	 saverStarted(false),numSavedPoints(0),cancelSaving(false),
+	 finished(false)
+	{
+	selectionFile->setEndianness(Misc::LittleEndian);
+	for(int i=0;i<3;++i)
+		pointOffset[i]=sPointOffset[i];
+	}
+
+LidarSelectionSaver::~LidarSelectionSaver(void)
+	{
+	if(saverStarted)
+		{
+		/* Stop the background thread after its current block: */
+		cancelSaving=true;
+		saverThread.join();
+		}
+	}
+
+LidarSelectionSaver::FileFormat LidarSelectionSaver::getFileFormat(const char* fileName)
+	{
+	const char* extPtr=Misc::getExtension(fileName);
+	if(strcasecmp(extPtr,".bin")==0)
+		return BINARY;
+	else if(strcasecmp(extPtr,".las")==0)
+		return LAS;
+	else
+		return ASCII;
+	}
+
+void LidarSelectionSaver::startSaving(void)
+	{
+	/* Start the background thread: */
+	saverThread.start(this,&LidarSelectionSaver::saverThreadMethod);
+	saverStarted=true;
+	}
+
+bool LidarSelectionSaver::isFinished(void)
+	{
+	Threads::Mutex::Lock statusLock(statusMutex);
+	return finished;
+	}
+
+std::string LidarSelectionSaver::getErrorMessage(void)
+	{
+	Threads::Mutex::Lock statusLock(statusMutex);
+	return errorMessage;
+	}
@@ -1,7 +1,7 @@
 /***********************************************************************
-LidarSelectionSaver - Point processor functor class to save the set of
-selected points to a file
-Copyright (c) 2005-2012 Oliver Kreylos
+LidarSelectionSaver - Class to take a snapshot of the set of selected
+points and save it to a file from a background thread.
+Copyright (c) 2005-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,44 +24,81 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef LIDARSELECTIONSAVER_INCLUDED
 #define LIDARSELECTIONSAVER_INCLUDED
 
-#include <stdio.h>
-#include <Misc/File.h>
+#include <string>
+#include <vector>
+#include <Threads/Atomic.h>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
+#include <IO/SeekableFile.h>
 
 #include "LidarTypes.h"
-#include "LidarOctree.h"
 
 class LidarSelectionSaver
 	{
+	/* Embedded classes: */
+	public:
+	enum FileFormat // Enumerated type for selection file formats
+		{
+		ASCII, // Lines of xyzrgb or xyzuvwrgb text
+		BINARY, // Point offset, number of points, and binary records of position and color, as written by LidarExporter
+		LAS // LAS 1.2 file with point data records of format 2
+		};
+	
+	typedef void (*ProgressFunction)(void*); // Type for callback functions called from the background thread whenever saving progresses
+	
 	/* Elements: */
 	private:
-	Misc::File selectionFile; // The file to save the selected points to
-	const double* pointOffset; // Offset vector from octree coordinates to real coordinates
+	static const size_t blockSize=65536; // Number of points saved between progress updates
+	std::string selectionFileName; // Name of the selection file
+	IO::SeekableFilePtr selectionFile; // The file to save the selected points to
+	FileFormat fileFormat; // Format of the selection file
+	double pointOffset[3]; // Offset vector from octree coordinates to real coordinates
+	std::vector<LidarPoint> points; // Snapshot of the selected points
+	std::vector<Vector> normals; // Snapshot of the selected points' normal vectors, if any
+	ProgressFunction progressFunction; // Function called when saving progresses
+	void* progressFunctionArg; // Argument for progress function
+	Threads::Thread saverThread; // Background thread writing the snapshot to the selection file
+	bool saverStarted; // Flag whether the background thread was started
+	Threads::Atomic<size_t> numSavedPoints; // Number of points written so far
+	volatile bool cancelSaving; // Flag to stop the background thread early
+	Threads::Mutex statusMutex; // Mutex protecting the completion state
+	bool finished; // Flag whether the background thread has finished
+	std::string errorMessage; // Message of the error that stopped the background thread, or empty
+	
+	/* Private methods: */
+	void saveAscii(void); // Writes the snapshot as ASCII text
+	void saveBinary(void); // Writes the snapshot as binary records
+	void saveLas(void); // Writes the snapshot as LAS point data records
+	void blockSaved(size_t newNumSavedPoints); // Updates the progress after a block of points was written
+	void* saverThreadMethod(void); // Thread method writing the snapshot to the selection file
 	
 	/* Constructors and destructors: */
 	public:
-	LidarSelectionSaver(const char* selectionFileName,const double* sPointOffset)
-		:selectionFile(selectionFileName,"wt"),
-		 pointOffset(sPointOffset)
-		{
-		};
+	LidarSelectionSaver(const char* sSelectionFileName,const double sPointOffset[3],ProgressFunction sProgressFunction,void* sProgressFunctionArg); // Creates the selection file and prepares to take a snapshot of selected points; selects file format from the file name's extension
+	~LidarSelectionSaver(void); // Stops the background thread if it is still running
 	
 	/* Methods: */
-	void operator()(const LidarPoint& lp) // Process the given LiDAR point
+	static FileFormat getFileFormat(const char* fileName); // Returns the file format selected by the given file name's extension
+	void operator()(const LidarPoint& lp) // Adds the given LiDAR point to the snapshot
 		{
-		/* Write the point to the selection file: */
-		double op[3];
-		for(int i=0;i<3;++i)
-			op[i]=double(lp[i])+pointOffset[i];
-		fprintf(selectionFile.getFilePtr(),"%.12g %.12g %.12g %u %u %u\n",op[0],op[1],op[2],(unsigned int)lp.value[0],(unsigned int)lp.value[1],(unsigned int)lp.value[2]);
-		};
-	void operator()(const LidarPoint& lp,const Vector& normal) // Process the given LiDAR point plus normal vector
+		points.push_back(lp);
+		}
+	void operator()(const LidarPoint& lp,const Vector& normal) // Adds the given LiDAR point plus normal vector to the snapshot
 		{
-		/* Write the point to the selection file: */
-		double op[3];
-		for(int i=0;i<3;++i)
-			op[i]=double(lp[i])+pointOffset[i];
-		fprintf(selectionFile.getFilePtr(),"%.12g %.12g %.12g %.4f %.4f %.4f %u %u %u\n",op[0],op[1],op[2],normal[0],normal[1],normal[2],(unsigned int)lp.value[0],(unsigned int)lp.value[1],(unsigned int)lp.value[2]);
-		};
+		points.push_back(lp);
+		normals.push_back(normal);
+		}
+	void startSaving(void); // Starts writing the snapshot to the selection file in the background; snapshot must not be changed afterwards
+	size_t getNumPoints(void) const // Returns the number of points in the snapshot
+		{
+		return points.size();
+		}
+	size_t getNumSavedPoints(void) const // Returns the number of points written so far
+		{
+		return numSavedPoints.get();
+		}
+	bool isFinished(void); // Returns true if the background thread has finished
+	std::string getErrorMessage(void); // Returns the message of the error that stopped the background thread, or an empty string if saving succeeded or is still in progress
 	};
 
 #endif
@@ -0,0 +1,109 @@
+/***********************************************************************
+LidarSource - Class to open the parts of a LiDAR file from a local
+directory or from an HTTP server.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "LidarSource.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "LidarRemoteFile.h"
+
+/************************************
+Static elements of class LidarSource:
+************************************/
+
+std::string LidarSource::remoteCacheDirectory;
+size_t LidarSource::remoteCacheSize=size_t(4096)*1024*1024;
+
+/****************************
+Methods of class LidarSource:
+****************************/
+
+LidarSource::LidarSource(const char* sLidarFileName)
+	:lidarFileName(sLidarFileName),
+	 remote(0)
+	{
+	if(isRemote(sLidarFileName))
+		{
+		/* Use the default cache directory if none was set: */
+		std::string cacheDirectory=remoteCacheDirectory;
+		if(cacheDirectory.empty())
+			{
+			const char* home=getenv("HOME");
+			cacheDirectory=home!=0?home:"/tmp";
+			cacheDirectory.append("/.cache/LidarViewer");
+			}
+		
+		/* Open the remote LiDAR file: */
+		remote=new LidarRemoteDataset(sLidarFileName,cacheDirectory.c_str(),remoteCacheSize);
+		}
+	}
+
+LidarSource::~LidarSource(void)
+	{
+	delete remote;
+	}
+
+void LidarSource::setRemoteCache(const char* newRemoteCacheDirectory,size_t newRemoteCacheSize)
+	{
+	remoteCacheDirectory=newRemoteCacheDirectory!=0?newRemoteCacheDirectory:"";
+	remoteCacheSize=newRemoteCacheSize;
+	}
+
+bool LidarSource::isRemote(const char* lidarFileName)
+	{
+	return LidarRemoteDataset::isRemote(lidarFileName);
+	}
+
+std::string LidarSource::getPartFileName(const char* partName) const
+	{
+	std::string result=lidarFileName;
+	if(result.empty()||result[result.size()-1]!='/')
+		result.push_back('/');
+	result.append(partName);
+	return result;
+	}
+
+bool LidarSource::hasPart(const char* partName) const
+	{
+	if(remote!=0)
+		return remote->hasPart(partName);
+	else
+		return access(getPartFileName(partName).c_str(),R_OK)==0;
+	}
+
+LidarSourceFile* LidarSource::openPart(const char* partName) const
+	{
+	LidarSourceFile* result;
+	if(remote!=0)
+		result=remote->openPart(partName);
+	else
+		result=new LidarFile(getPartFileName(partName).c_str());
+	result->setEndianness(Misc::LittleEndian);
+	return result;
+	}
+
+size_t LidarSource::getNumFetchedBytes(void) const
+	{
+	return remote!=0?remote->getNumFetchedBytes():0;
+	}
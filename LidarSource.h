@@ -0,0 +1,70 @@
+/***********************************************************************
+LidarSource - Class to open the parts of a LiDAR file from a local
+directory or from an HTTP server.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef LIDARSOURCE_INCLUDED
+#define LIDARSOURCE_INCLUDED
+
+#include <stddef.h>
+#include <string>
+
+#include "LidarFile.h"
+
+/* Forward declarations: */
+class LidarRemoteDataset;
+
+class LidarSource
+	{
+	/* Elements: */
+	private:
+	static std::string remoteCacheDirectory; // Base directory for the caches of remote LiDAR files
+	static size_t remoteCacheSize; // Maximum size of the cache of each remote LiDAR file in bytes
+	std::string lidarFileName; // Name of the LiDAR file directory, or URL of a remote LiDAR file
+	LidarRemoteDataset* remote; // Remote LiDAR file and its block cache, or 0 for local LiDAR files
+	
+	/* Constructors and destructors: */
+	public:
+	LidarSource(const char* sLidarFileName); // Opens the LiDAR file of the given directory name or http:// URL
+	private:
+	LidarSource(const LidarSource& source); // Prohibit copy constructor
+	LidarSource& operator=(const LidarSource& source); // Prohibit assignment operator
+	public:
+	~LidarSource(void); // Closes the LiDAR file; all part files opened from it must have been closed
+	
+	/* Methods: */
+	static void setRemoteCache(const char* newRemoteCacheDirectory,size_t newRemoteCacheSize); // Sets the cache base directory and per-file cache size in bytes for remote LiDAR files opened afterwards
+	static bool isRemote(const char* lidarFileName); // Returns true if the given LiDAR file name is the URL of a remote LiDAR file
+	bool isRemote(void) const // Returns true if the LiDAR file is remote
+		{
+		return remote!=0;
+		}
+	const std::string& getLidarFileName(void) const // Returns the LiDAR file's name
+		{
+		return lidarFileName;
+		}
+	std::string getPartFileName(const char* partName) const; // Returns the full name of the given part of the LiDAR file
+	bool hasPart(const char* partName) const; // Returns true if the LiDAR file contains the given part
+	LidarSourceFile* openPart(const char* partName) const; // Returns a new read-only little-endian handle to the given part; throws exception if the part does not exist
+	size_t getNumFetchedBytes(void) const; // Returns the number of bytes fetched from a remote LiDAR file's server so far
+	};
+
+#endif
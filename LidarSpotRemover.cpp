@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarSpotRemover - Utility to extract isolated points (spot noise) from
 LiDAR data sets.
-Copyright (c) 2013 Oliver Kreylos
+Copyright (c) 2013-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,6 +24,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
+#include <vector>
+#include <Threads/Mutex.h>
 #include <IO/SeekableFile.h>
 #include <IO/OpenFile.h>
 
@@ -58,9 +60,9 @@ class NeighborCounter
 		/* Check if the point is inside the neighborhood sphere; if so, increase neighbor count: */
 		if(Geometry::sqrDist(center,point)<=radius2)
 			{
-			/* Stop traversing the tree if the required number of neighbors have been found: */
+			/* Stop traversing the tree if the required number of neighbors have been found; a negative radius rejects all remaining nodes and points, including duplicates of the center: */
 			if(++numNeighbors==minNumNeighbors)
-				radius2=0.0f;
+				radius2=-1.0f;
 			}
 		}
 	const Point& getQueryPoint(void) const
@@ -77,13 +79,14 @@ class NeighborCounter
 		}
 	};
 
-class OutlierSaver
+class OutlierSaver // Node functor to find outliers in the leaf nodes of an octree from multiple threads
 	{
 	/* Elements: */
 	private:
 	LidarProcessOctree& lpo;
 	float radius,radius2;
 	unsigned int minNumNeighbors;
+	Threads::Mutex outlierFileMutex; // Mutex serializing access to the outlier file
 	IO::FilePtr outlierFile;
 	size_t numOutliers;
 	
@@ -99,17 +102,34 @@ class OutlierSaver
 		}
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point)
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
 		{
-		/* Count the number of points in the point's neighborhood: */
-		NeighborCounter nc(point,radius2,minNumNeighbors);
-		lpo.processPointsDirected(nc);
+		/* Only leaf nodes contain original points: */
+		if(!node.isLeaf()||node.getNumPoints()==0)
+			return;
 		
-		if(nc.getNumNeighbors()<minNumNeighbors)
+		/* Collect the node's outliers in a local buffer: */
+		std::vector<LidarPoint> outliers;
+		const LidarPoint* points=node.getPoints();
+		for(unsigned int i=0;i<node.getNumPoints();++i)
 			{
-			/* Point is an outlier; save it to the file: */
-			outlierFile->write(point);
-			++numOutliers;
+			/* Count the number of points in the point's neighborhood: */
+			NeighborCounter nc(points[i],radius2,minNumNeighbors);
+			lpo.processPointsInSphere(nc);
+			
+			if(nc.getNumNeighbors()<minNumNeighbors)
+				{
+				/* Point is an outlier: */
+				outliers.push_back(points[i]);
+				}
+			}
+		
+		if(!outliers.empty())
+			{
+			/* Save the node's outliers to the file in one go: */
+			Threads::Mutex::Lock outlierFileLock(outlierFileMutex);
+			outlierFile->write(&outliers[0],outliers.size());
+			numOutliers+=outliers.size();
 			}
 		}
 	size_t getNumOutliers(void) const
@@ -126,6 +146,7 @@ int main(int argc,char* argv[])
 	float neighborhoodRadius=1.0f;
 	unsigned int minNumNeighbors=3;
 	const char* outlierFileName="Outliers.bin";
+	unsigned int numThreads=1;
 	for(int i=1;i<argc;++i)
 		{
 		if(argv[i][0]=='-')
@@ -145,6 +166,11 @@ int main(int argc,char* argv[])
 				++i;
 				minNumNeighbors=(unsigned int)atoi(argv[i]);
 				}
+			else if(strcasecmp(argv[i]+1,"threads")==0)
+				{
+				++i;
+				numThreads=(unsigned int)atoi(argv[i]);
+				}
 			}
 		else if(lidarFileName==0)
 			lidarFileName=argv[i];
@@ -158,7 +184,7 @@ int main(int argc,char* argv[])
 		}
 	
 	/* Open the LiDAR octree file: */
-	LidarProcessOctree lpo(lidarFileName,memoryCache*size_t(1024*1024));
+	LidarProcessOctree lpo(lidarFileName,memoryCache*size_t(1024*1024),0,false,true);
 	
 	/* Open the outlier file: */
 	IO::SeekableFilePtr outlierFile(IO::openSeekableFile(outlierFileName,IO::File::WriteOnly));
@@ -167,9 +193,9 @@ int main(int argc,char* argv[])
 	/* Write a bogus file header: */
 	outlierFile->write<unsigned int>(0);
 	
-	/* Process the LiDAR file: */
+	/* Process the LiDAR file's leaf nodes in parallel: */
 	OutlierSaver os(lpo,neighborhoodRadius,minNumNeighbors,outlierFile);
-	lpo.processPoints(os);
+	lpo.processNodesPrefixParallel(os,numThreads);
 	
 	/* Finalize the outlier file: */
 	outlierFile->setWritePosAbs(0);
@@ -0,0 +1,579 @@
+/***********************************************************************
+LidarStitcher - Utility to plan spatially partitioned preprocessing of
+large point sets, and to stitch partial LiDAR octrees created from the
+partitions back into a single LiDAR file.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <Misc/SelfDestructArray.h>
+#include <Math/Math.h>
+#include <Geometry/ArrayKdTree.h>
+
+#include "LidarTypes.h"
+#include "Cube.h"
+#include "LidarFile.h"
+#include "LidarCompressedFile.h"
+#include "LidarOctreeCreator.h"
+
+namespace {
+
+/***********************************************************
+Helper functions to load LiDAR files given a base file name:
+***********************************************************/
+
+std::string getLidarPartFileName(const char* lidarFileName,const char* partFileName)
+	{
+	std::string result=lidarFileName;
+	result.push_back('/');
+	result.append(partFileName);
+	return result;
+	}
+
+/****************************************************
+Helper functions to calculate the partitions' domains:
+****************************************************/
+
+Cube getGlobalDomain(const Box& box)
+	{
+	/* Enlarge the box slightly so that points on its maximum faces fall inside the half-open cube: */
+	Box paddedBox=box;
+	Scalar size=Scalar(0);
+	for(int i=0;i<3;++i)
+		if(size<box.max[i]-box.min[i])
+			size=box.max[i]-box.min[i];
+	for(int i=0;i<3;++i)
+		paddedBox.max[i]+=size*Scalar(1.0e-5);
+	
+	return Cube(paddedBox);
+	}
+
+void getPartitionDomains(const Cube& domain,unsigned int numLevels,std::vector<Cube>& partitionDomains)
+	{
+	if(numLevels==0)
+		partitionDomains.push_back(domain);
+	else
+		{
+		for(int childIndex=0;childIndex<8;++childIndex)
+			getPartitionDomains(Cube(domain,childIndex),numLevels-1,partitionDomains);
+		}
+	}
+
+bool equalDomains(const Cube& cube1,const Cube& cube2)
+	{
+	/* Allow for round-off when the domains were passed through the command line: */
+	Scalar eps=(cube1.getMax()[0]-cube1.getMin()[0])*Scalar(1.0e-5);
+	for(int i=0;i<3;++i)
+		if(Math::abs(cube1.getMin()[i]-cube2.getMin()[i])>eps||Math::abs(cube1.getMax()[i]-cube2.getMax()[i])>eps)
+			return false;
+	return true;
+	}
+
+/*********************************************
+Structure describing a partial octree:
+*********************************************/
+
+struct Partition
+	{
+	/* Elements: */
+	public:
+	std::string fileName; // Name of the partial octree's LiDAR file directory
+	Cube domain; // The partial octree's root domain
+	unsigned int maxNumPointsPerNode; // Maximum number of points in any node of the partial octree
+	LidarOctreeFileNode root; // The partial octree's root node
+	LidarFile::Offset numIndexBytes; // Size of the partial octree's index file
+	LidarFile::Offset numRecords; // Number of point records in the partial octree's points file
+	bool used; // Flag if the partition has been assigned to a node of the stitched octree
+	LidarFile::Offset indexShift; // Amount by which to shift the partition's index file offsets
+	LidarFile::Offset dataBase; // Amount by which to shift the partition's data offsets
+	};
+
+/*************************************************
+Structure for nodes in the top levels of the
+stitched octree:
+*************************************************/
+
+struct TopNode
+	{
+	/* Elements: */
+	public:
+	TopNode* children; // Array of children for interior nodes, or 0 for leaf nodes
+	Partition* partition; // Partial octree rooted at this node, or 0
+	Scalar detailSize; // Detail size of the node
+	unsigned int numPoints; // Number of points in the node
+	LidarPoint* points; // Array of the node's points
+	LidarFile::Offset nodeOffset; // Offset of the node's record in the stitched index file
+	LidarFile::Offset dataOffset; // Offset of the node's points in the stitched points file
+	
+	/* Constructors and destructors: */
+	TopNode(void)
+		:children(0),partition(0),
+		 detailSize(0),numPoints(0),points(0),
+		 nodeOffset(0),dataOffset(0)
+		{
+		}
+	~TopNode(void)
+		{
+		delete[] children;
+		delete[] points;
+		}
+	};
+
+bool createTopNode(TopNode& node,const Cube& domain,unsigned int numLevels,std::vector<Partition>& partitions,unsigned int maxNumPointsPerNode)
+	{
+	if(numLevels==0)
+		{
+		/* Find the partial octree covering this node's domain: */
+		for(std::vector<Partition>::iterator pIt=partitions.begin();pIt!=partitions.end()&&node.partition==0;++pIt)
+			if(!pIt->used&&equalDomains(pIt->domain,domain))
+				{
+				pIt->used=true;
+				node.partition=&*pIt;
+				}
+		if(node.partition==0)
+			return false;
+		
+		/* Read the partial octree's root points: */
+		const LidarOctreeFileNode& root=node.partition->root;
+		node.detailSize=root.detailSize;
+		node.numPoints=root.numPoints;
+		node.points=new LidarPoint[node.numPoints];
+		LidarFile pointsFile(getLidarPartFileName(node.partition->fileName.c_str(),"Points").c_str());
+		pointsFile.setEndianness(Misc::LittleEndian);
+		pointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+LidarFile::Offset(sizeof(LidarPoint))*root.dataOffset);
+		pointsFile.read(node.points,node.numPoints);
+		
+		return node.numPoints>0||root.childrenOffset!=0;
+		}
+	
+	/* Create the node's children: */
+	node.children=new TopNode[8];
+	bool haveChildren=false;
+	for(int childIndex=0;childIndex<8;++childIndex)
+		if(createTopNode(node.children[childIndex],Cube(domain,childIndex),numLevels-1,partitions,maxNumPointsPerNode))
+			haveChildren=true;
+	if(!haveChildren)
+		{
+		/* Turn the node into an empty leaf: */
+		delete[] node.children;
+		node.children=0;
+		return false;
+		}
+	
+	/* Collect all the children's points: */
+	unsigned int totalNumPoints=0;
+	for(int childIndex=0;childIndex<8;++childIndex)
+		totalNumPoints+=node.children[childIndex].numPoints;
+	LidarPoint* points=new LidarPoint[totalNumPoints];
+	LidarPoint* pPtr=points;
+	for(int childIndex=0;childIndex<8;++childIndex)
+		{
+		TopNode& child=node.children[childIndex];
+		if(node.detailSize<child.detailSize)
+			node.detailSize=child.detailSize;
+		for(unsigned int i=0;i<child.numPoints;++i,++pPtr)
+			*pPtr=child.points[i];
+		
+		/* The points of partial octrees' roots are already in their points files: */
+		if(child.partition!=0)
+			{
+			delete[] child.points;
+			child.points=0;
+			}
+		}
+	
+	/* Subsample the collected points: */
+	node.numPoints=LidarOctreeCreator::subsamplePointsOnGrid(points,totalNumPoints,maxNumPointsPerNode,node.detailSize);
+	
+	/* Sort the node's remaining points into kd-tree order: */
+	node.points=new LidarPoint[node.numPoints];
+	for(unsigned int i=0;i<node.numPoints;++i)
+		node.points[i]=points[i];
+	delete[] points;
+	Geometry::ArrayKdTree<LidarPoint> pointTree;
+	pointTree.donatePoints(node.numPoints,node.points);
+	node.points=pointTree.detachPoints();
+	
+	return true;
+	}
+
+void calcNodeOffsets(TopNode& node,unsigned int level,LidarFile::Offset& indexFilePos)
+	{
+	if(level==0)
+		{
+		/* Calculate the node's offset: */
+		node.nodeOffset=indexFilePos;
+		indexFilePos+=LidarFile::Offset(LidarOctreeFileNode::getFileSize());
+		}
+	else if(node.children!=0)
+		{
+		/* Recurse into the node's children: */
+		for(int childIndex=0;childIndex<8;++childIndex)
+			calcNodeOffsets(node.children[childIndex],level-1,indexFilePos);
+		}
+	}
+
+void writeNodePoints(TopNode& node,LidarFile& pointsFile,LidarFile::Offset& dataOffset,unsigned int& maxNumPointsPerNode)
+	{
+	if(node.partition!=0)
+		{
+		/* Shift the partial octree root's data offset: */
+		node.dataOffset=node.partition->root.dataOffset+node.partition->dataBase;
+		}
+	else
+		{
+		/* Append the node's points to the points file: */
+		node.dataOffset=dataOffset;
+		dataOffset+=LidarFile::Offset(node.numPoints);
+		pointsFile.write(node.points,node.numPoints);
+		if(maxNumPointsPerNode<node.numPoints)
+			maxNumPointsPerNode=node.numPoints;
+		}
+	
+	/* Recurse into the node's children: */
+	if(node.children!=0)
+		for(int childIndex=0;childIndex<8;++childIndex)
+			writeNodePoints(node.children[childIndex],pointsFile,dataOffset,maxNumPointsPerNode);
+	}
+
+void writeIndexFileLevel(const TopNode& node,unsigned int level,LidarFile& indexFile)
+	{
+	if(level==0)
+		{
+		/* Write the node's record: */
+		LidarOctreeFileNode ofn;
+		if(node.children!=0)
+			ofn.childrenOffset=node.children[0].nodeOffset;
+		else if(node.partition!=0&&node.partition->root.childrenOffset!=0)
+			ofn.childrenOffset=node.partition->root.childrenOffset+node.partition->indexShift;
+		else
+			ofn.childrenOffset=0;
+		ofn.detailSize=node.detailSize;
+		ofn.numPoints=node.numPoints;
+		ofn.dataOffset=node.dataOffset;
+		ofn.write(indexFile);
+		}
+	else if(node.children!=0)
+		{
+		/* Recurse into the node's children: */
+		for(int childIndex=0;childIndex<8;++childIndex)
+			writeIndexFileLevel(node.children[childIndex],level-1,indexFile);
+		}
+	}
+
+bool readOffsetFile(const char* lidarFileName,double offset[3])
+	{
+	std::string offsetFileName=getLidarPartFileName(lidarFileName,"Offset");
+	if(access(offsetFileName.c_str(),R_OK)!=0)
+		{
+		for(int i=0;i<3;++i)
+			offset[i]=0.0;
+		return false;
+		}
+	LidarFile offsetFile(offsetFileName.c_str());
+	offsetFile.setEndianness(Misc::LittleEndian);
+	offsetFile.read(offset,3);
+	return true;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parse the command line: */
+	const char* outputFileName=0;
+	unsigned int numLevels=1;
+	bool haveBox=false;
+	Box box;
+	bool plan=false;
+	unsigned int maxNumPointsPerNode=0;
+	std::vector<const char*> partitionFileNames;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"o")==0)
+				{
+				++i;
+				if(i<argc)
+					outputFileName=argv[i];
+				else
+					std::cerr<<"Dangling -o flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"level")==0)
+				{
+				++i;
+				if(i<argc)
+					numLevels=atoi(argv[i]);
+				else
+					std::cerr<<"Dangling -level flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"box")==0)
+				{
+				if(i+6<argc)
+					{
+					for(int j=0;j<3;++j)
+						box.min[j]=Scalar(atof(argv[i+1+j]));
+					for(int j=0;j<3;++j)
+						box.max[j]=Scalar(atof(argv[i+4+j]));
+					haveBox=true;
+					}
+				else
+					std::cerr<<"Dangling -box flag on command line"<<std::endl;
+				i+=6;
+				}
+			else if(strcasecmp(argv[i]+1,"np")==0)
+				{
+				++i;
+				if(i<argc)
+					maxNumPointsPerNode=atoi(argv[i]);
+				else
+					std::cerr<<"Dangling -np flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"plan")==0)
+				plan=true;
+			else
+				std::cerr<<"Unrecognized command line option "<<argv[i]<<std::endl;
+			}
+		else
+			partitionFileNames.push_back(argv[i]);
+		}
+	if(!haveBox||numLevels<1||(!plan&&outputFileName==0))
+		{
+		std::cerr<<"Usage: "<<argv[0]<<" -plan -level <partition level> -box <min x> <min y> <min z> <max x> <max y> <max z>"<<std::endl;
+		std::cerr<<"       "<<argv[0]<<" -o <output file name> -level <partition level> -box <min x> <min y> <min z> <max x> <max y> <max z> [-np <max points per node>] <partition file name 1> ... <partition file name n>"<<std::endl;
+		return 1;
+		}
+	
+	/* Calculate the partitions' domains: */
+	Cube globalDomain=getGlobalDomain(box);
+	std::vector<Cube> partitionDomains;
+	getPartitionDomains(globalDomain,numLevels,partitionDomains);
+	
+	if(plan)
+		{
+		/* Print LidarPreprocessor's -domain arguments for all partitions: */
+		for(std::vector<Cube>::iterator pdIt=partitionDomains.begin();pdIt!=partitionDomains.end();++pdIt)
+			{
+			printf("-domain");
+			for(int i=0;i<3;++i)
+				printf(" %.9g",double(pdIt->getMin()[i]));
+			for(int i=0;i<3;++i)
+				printf(" %.9g",double(pdIt->getMax()[i]));
+			printf("\n");
+			}
+		
+		return 0;
+		}
+	
+	/* Read the partial octrees' headers and root nodes: */
+	std::vector<Partition> partitions;
+	bool haveOffset=false;
+	double offset[3];
+	unsigned int maxNumPointsPerPartitionNode=0;
+	try
+		{
+		for(std::vector<const char*>::iterator pfnIt=partitionFileNames.begin();pfnIt!=partitionFileNames.end();++pfnIt)
+			{
+			Partition p;
+			p.fileName=*pfnIt;
+			
+			/* Check that the partial octree's points are stored uncompressed at full precision: */
+			LidarFile pointsFile(getLidarPartFileName(*pfnIt,"Points").c_str());
+			pointsFile.setEndianness(Misc::LittleEndian);
+			LidarDataFileHeader dfh(pointsFile);
+			if(LidarCompressedFile::isCompressed(dfh.recordSize)||dfh.recordSize!=sizeof(LidarPoint))
+				{
+				std::cerr<<"Partial octree "<<*pfnIt<<" does not store uncompressed full-precision points"<<std::endl;
+				return 1;
+				}
+			p.numRecords=(pointsFile.getSize()-LidarFile::Offset(LidarDataFileHeader::getFileSize()))/LidarFile::Offset(sizeof(LidarPoint));
+			
+			/* Read the partial octree's index file header and root node: */
+			LidarFile indexFile(getLidarPartFileName(*pfnIt,"Index").c_str());
+			indexFile.setEndianness(Misc::LittleEndian);
+			LidarOctreeFileHeader ofh(indexFile);
+			p.domain=ofh.domain;
+			p.maxNumPointsPerNode=ofh.maxNumPointsPerNode;
+			p.root.read(indexFile);
+			p.numIndexBytes=indexFile.getSize();
+			p.used=false;
+			if(maxNumPointsPerPartitionNode<p.maxNumPointsPerNode)
+				maxNumPointsPerPartitionNode=p.maxNumPointsPerNode;
+			
+			/* Check that all partial octrees use the same point offset: */
+			double pOffset[3];
+			bool pHaveOffset=readOffsetFile(*pfnIt,pOffset);
+			if(pfnIt==partitionFileNames.begin())
+				{
+				haveOffset=pHaveOffset;
+				for(int i=0;i<3;++i)
+					offset[i]=pOffset[i];
+				}
+			else if(pHaveOffset!=haveOffset||pOffset[0]!=offset[0]||pOffset[1]!=offset[1]||pOffset[2]!=offset[2])
+				{
+				std::cerr<<"Partial octree "<<*pfnIt<<" has a different point offset than partial octree "<<partitionFileNames.front()<<std::endl;
+				return 1;
+				}
+			
+			partitions.push_back(p);
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Unable to read partial octrees due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	if(maxNumPointsPerNode==0)
+		maxNumPointsPerNode=maxNumPointsPerPartitionNode;
+	
+	/* Create the top levels of the stitched octree: */
+	std::cout<<"Creating top "<<numLevels<<" levels of stitched octree..."<<std::flush;
+	TopNode root;
+	createTopNode(root,globalDomain,numLevels,partitions,maxNumPointsPerNode);
+	std::cout<<" done"<<std::endl;
+	for(std::vector<Partition>::iterator pIt=partitions.begin();pIt!=partitions.end();++pIt)
+		if(!pIt->used)
+			{
+			std::cerr<<"Partial octree "<<pIt->fileName<<" does not match any partition domain"<<std::endl;
+			return 1;
+			}
+	
+	/* Lay out the stitched index file: the top levels first, followed by the partial octrees' non-root nodes: */
+	LidarFile::Offset indexFilePos=LidarFile::Offset(LidarOctreeFileHeader::getFileSize());
+	for(unsigned int level=0;level<=numLevels;++level)
+		calcNodeOffsets(root,level,indexFilePos);
+	LidarFile::Offset partitionIndexStart=LidarFile::Offset(LidarOctreeFileHeader::getFileSize()+LidarOctreeFileNode::getFileSize());
+	for(std::vector<Partition>::iterator pIt=partitions.begin();pIt!=partitions.end();++pIt)
+		{
+		pIt->indexShift=indexFilePos-partitionIndexStart;
+		indexFilePos+=pIt->numIndexBytes-partitionIndexStart;
+		}
+	
+	/* Create the stitched LiDAR file: */
+	if(mkdir(outputFileName,0777)<0)
+		{
+		std::cerr<<"Unable to create LiDAR file "<<outputFileName<<std::endl;
+		return 1;
+		}
+	try
+		{
+		/* Write the top levels' points, followed by the partial octrees' points: */
+		std::cout<<"Writing stitched points file..."<<std::flush;
+		LidarFile pointsFile(getLidarPartFileName(outputFileName,"Points").c_str(),IO::File::WriteOnly);
+		pointsFile.setEndianness(Misc::LittleEndian);
+		LidarDataFileHeader((unsigned int)(sizeof(LidarPoint))).write(pointsFile);
+		LidarFile::Offset dataBase=0;
+		unsigned int maxNumPointsPerInteriorNode=maxNumPointsPerPartitionNode;
+		
+		/* Count the top levels' points to calculate the partitions' data offsets: */
+		{
+		LidarFile::Offset topDataOffset=0;
+		std::vector<TopNode*> stack;
+		stack.push_back(&root);
+		while(!stack.empty())
+			{
+			TopNode* node=stack.back();
+			stack.pop_back();
+			if(node->partition==0)
+				topDataOffset+=LidarFile::Offset(node->numPoints);
+			if(node->children!=0)
+				for(int childIndex=0;childIndex<8;++childIndex)
+					stack.push_back(&node->children[childIndex]);
+			}
+		dataBase=topDataOffset;
+		}
+		for(std::vector<Partition>::iterator pIt=partitions.begin();pIt!=partitions.end();++pIt)
+			{
+			pIt->dataBase=dataBase;
+			dataBase+=pIt->numRecords;
+			}
+		LidarFile::Offset nextDataOffset=0;
+		writeNodePoints(root,pointsFile,nextDataOffset,maxNumPointsPerInteriorNode);
+		
+		/* Copy the partial octrees' point records verbatim: */
+		Misc::SelfDestructArray<char> buffer(1024*1024);
+		for(std::vector<Partition>::iterator pIt=partitions.begin();pIt!=partitions.end();++pIt)
+			{
+			LidarFile partitionPointsFile(getLidarPartFileName(pIt->fileName.c_str(),"Points").c_str());
+			partitionPointsFile.setReadPosAbs(LidarDataFileHeader::getFileSize());
+			LidarFile::Offset numBytesLeft=pIt->numRecords*LidarFile::Offset(sizeof(LidarPoint));
+			while(numBytesLeft>0)
+				{
+				size_t numBytes=numBytesLeft>LidarFile::Offset(1024*1024)?size_t(1024*1024):size_t(numBytesLeft);
+				partitionPointsFile.readRaw(buffer.getArray(),numBytes);
+				pointsFile.writeRaw(buffer.getArray(),numBytes);
+				numBytesLeft-=LidarFile::Offset(numBytes);
+				}
+			}
+		std::cout<<" done"<<std::endl;
+		
+		/* Write the stitched index file: */
+		std::cout<<"Writing stitched index file..."<<std::flush;
+		LidarFile indexFile(getLidarPartFileName(outputFileName,"Index").c_str(),IO::File::WriteOnly);
+		indexFile.setEndianness(Misc::LittleEndian);
+		LidarOctreeFileHeader(globalDomain,maxNumPointsPerInteriorNode).write(indexFile);
+		for(unsigned int level=0;level<=numLevels;++level)
+			writeIndexFileLevel(root,level,indexFile);
+		
+		/* Append the partial octrees' non-root nodes with adjusted children and data offsets: */
+		for(std::vector<Partition>::iterator pIt=partitions.begin();pIt!=partitions.end();++pIt)
+			{
+			LidarFile partitionIndexFile(getLidarPartFileName(pIt->fileName.c_str(),"Index").c_str());
+			partitionIndexFile.setEndianness(Misc::LittleEndian);
+			partitionIndexFile.setReadPosAbs(partitionIndexStart);
+			LidarFile::Offset numNodes=(pIt->numIndexBytes-partitionIndexStart)/LidarFile::Offset(LidarOctreeFileNode::getFileSize());
+			for(LidarFile::Offset i=0;i<numNodes;++i)
+				{
+				LidarOctreeFileNode ofn;
+				ofn.read(partitionIndexFile);
+				if(ofn.childrenOffset!=0)
+					ofn.childrenOffset+=pIt->indexShift;
+				ofn.dataOffset+=pIt->dataBase;
+				ofn.write(indexFile);
+				}
+			}
+		std::cout<<" done"<<std::endl;
+		
+		/* Copy the partial octrees' common point offset: */
+		if(haveOffset)
+			{
+			LidarFile offsetFile(getLidarPartFileName(outputFileName,"Offset").c_str(),IO::File::WriteOnly);
+			offsetFile.setEndianness(Misc::LittleEndian);
+			offsetFile.write(offset,3);
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Unable to write stitched LiDAR file "<<outputFileName<<" due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
@@ -1,7 +1,7 @@
 /***********************************************************************
 LidarSubtractor - Post-processing filter to subtract a (relatively
 small) point set from a LiDAR data set and create a new LiDAR data set.
-Copyright (c) 2009-2025 Oliver Kreylos
+Copyright (c) 2009-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -28,6 +28,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <iostream>
 #include <Misc/StandardValueCoders.h>
 #include <Misc/ConfigurationFile.h>
+#include <Threads/Mutex.h>
 #include <IO/File.h>
 #include <IO/OpenFile.h>
 #include <Geometry/ArrayKdTree.h>
@@ -78,6 +79,63 @@ class NodePointSubtractor
 		}
 	};
 
+class GridNodePointSubtractor // Node functor to subtract points from leaf nodes in parallel using a tiled subtraction set
+	{
+	/* Elements: */
+	private:
+	TiledSubtractSet& subtractPoints;
+	Threads::Mutex accumulatorMutex; // Mutex protecting the list of idle point accumulators
+	std::vector<PointAccumulator*> idleAccumulators; // Point accumulators not currently used by any traversal thread
+	
+	/* Constructors and destructors: */
+	public:
+	GridNodePointSubtractor(TiledSubtractSet& sSubtractPoints,const std::vector<PointAccumulator*>& sAccumulators)
+		:subtractPoints(sSubtractPoints),
+		 idleAccumulators(sAccumulators)
+		{
+		}
+	
+	/* Methods: */
+	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
+		{
+		/* Check if this node is a non-empty leaf: */
+		if(!node.isLeaf()||node.getNumPoints()==0)
+			return;
+		
+		/* Grab an idle point accumulator for exclusive use: */
+		PointAccumulator* pa;
+		{
+		Threads::Mutex::Lock accumulatorLock(accumulatorMutex);
+		pa=idleAccumulators.back();
+		idleAccumulators.pop_back();
+		}
+		
+		/* Look for each node's point in the subtract set, switching tiles where necessary: */
+		unsigned int tileIndex=subtractPoints.findTile(node[0]);
+		const TiledSubtractSet::TileGrid* grid=&subtractPoints.acquireTile(tileIndex);
+		for(unsigned int i=0;i<node.getNumPoints();++i)
+			{
+			unsigned int pointTileIndex=subtractPoints.findTile(node[i]);
+			if(tileIndex!=pointTileIndex)
+				{
+				subtractPoints.releaseTile(tileIndex);
+				tileIndex=pointTileIndex;
+				grid=&subtractPoints.acquireTile(tileIndex);
+				}
+			if(!grid->findMatch(node[i]))
+				{
+				/* Point has no match in subtract set; add it to point accumulator: */
+				pa->addPoint(PointAccumulator::Point(node[i].getComponents()),PointAccumulator::Color(node[i].value.getRgba()));
+				}
+			}
+		subtractPoints.releaseTile(tileIndex);
+		
+		/* Return the point accumulator: */
+		Threads::Mutex::Lock accumulatorLock(accumulatorMutex);
+		idleAccumulators.push_back(pa);
+		}
+	};
+
 int main(int argc,char* argv[])
 	{
 	/* Set default values for all parameters: */
@@ -86,7 +144,6 @@ int main(int argc,char* argv[])
 	std::string tempOctreeFileNameTemplate="/tmp/LidarPreprocessorTempOctree";
 	unsigned int maxNumPointsPerNode=4096;
 	int numThreads=1;
-	std::string tempPointFileNameTemplate="/tmp/LidarPreprocessorTempPoints";
 	
 	try
 		{
@@ -100,7 +157,6 @@ int main(int argc,char* argv[])
 		tempOctreeFileNameTemplate=cfg.retrieveValue<std::string>("./tempOctreeFileNameTemplate",tempOctreeFileNameTemplate);
 		maxNumPointsPerNode=cfg.retrieveValue<unsigned int>("./maxNumPointsPerNode",maxNumPointsPerNode);
 		numThreads=cfg.retrieveValue<int>("./numThreads",numThreads);
-		tempPointFileNameTemplate=cfg.retrieveValue<std::string>("./tempPointFileNameTemplate",tempPointFileNameTemplate);
 		}
 	catch(const std::runtime_error&)
 		{
@@ -117,6 +173,9 @@ int main(int argc,char* argv[])
 	const char* outputFileName=0; // Name of resulting LiDAR octree file
 	bool haveOffset=false; // Flag whether an explicit point offset was specified on the command line
 	bool offsetSubtractPoints=true; // Flag whether to offset subtraction points to native octree coordinates
+	bool useGrid=false; // Flag whether to match points against an out-of-core tiled hashed grid instead of an in-memory kd-tree
+	unsigned int tileLevel=4; // Octree level with whose nodes the subtraction point set's tiles are aligned
+	unsigned int tileCacheSize=256; // Memory size for loaded subtraction point tiles in MB
 	
 	for(int i=1;i<argc;++i)
 		{
@@ -166,7 +225,7 @@ int main(int argc,char* argv[])
 				{
 				++i;
 				if(i<argc)
-					tempPointFileNameTemplate=argv[i];
+					std::cerr<<"Ignoring -tp flag; octree creation no longer uses temporary point files"<<std::endl;
 				else
 					std::cerr<<"Dangling -tp flag on command line"<<std::endl;
 				}
@@ -224,6 +283,24 @@ int main(int argc,char* argv[])
 				else
 					std::cerr<<"Dangling -booc flag on command line"<<std::endl;
 				}
+			else if(strcasecmp(argv[i]+1,"grid")==0)
+				useGrid=true;
+			else if(strcasecmp(argv[i]+1,"tileLevel")==0)
+				{
+				++i;
+				if(i<argc)
+					tileLevel=(unsigned int)(atoi(argv[i]));
+				else
+					std::cerr<<"Dangling -tileLevel flag on command line"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"tileCache")==0)
+				{
+				++i;
+				if(i<argc)
+					tileCacheSize=(unsigned int)(atoi(argv[i]));
+				else
+					std::cerr<<"Dangling -tileCache flag on command line"<<std::endl;
+				}
 			else if(strcasecmp(argv[i]+1,"columns")==0)
 				{
 				if(i+3<argc)
@@ -269,6 +346,7 @@ int main(int argc,char* argv[])
 	PointAccumulator pa;
 	pa.setMemorySize(memoryCacheSize,tempOctreeMaxNumPointsPerNode);
 	pa.setTempOctreeFileNameTemplate(tempOctreeFileNameTemplate+"XXXXXX");
+	pa.setNumTempOctreeThreads(numThreads>1?(unsigned int)numThreads:1U);
 	if(!haveOffset)
 		{
 		/* Use the base point set's point offset for the resulting file: */
@@ -281,32 +359,95 @@ int main(int argc,char* argv[])
 			pa.setPointOffset(totalOffset);
 		}
 	
-	/* Load the subtraction point set into a kd-tree: */
-	PointKdTree* subtractPointTree=loadSubtractSet(subtractFileName,offsetSubtractPoints?Geometry::Vector<double,3>(basePoints->getOffset()):Geometry::Vector<double,3>::zero);
-	if(subtractPointTree==0)
-		return 1;
-	
-	/* Process the base point set: */
-	{
-	std::cout<<"Subtracting points..."<<std::flush;
-	NodePointSubtractor nps(*basePoints,*subtractPointTree,epsilon,pa);
-	basePoints->processNodesPostfix(nps);
-	pa.finishReading();
-	std::cout<<" done"<<std::endl;
-	}
-	
-	/* Clear input data structures: */
-	delete basePoints;
-	delete subtractPointTree;
+	Geometry::Vector<double,3> subtractOffset=offsetSubtractPoints?Geometry::Vector<double,3>(basePoints->getOffset()):Geometry::Vector<double,3>::zero;
+	if(useGrid)
+		{
+		/* Bucket the subtraction point set into tiles aligned with the base octree's nodes: */
+		TiledSubtractSet* subtractTiles;
+		try
+			{
+			std::string tileFileNameTemplate=tempOctreeFileNameTemplate+"XXXXXX";
+			std::vector<char> tileFileName(tileFileNameTemplate.begin(),tileFileNameTemplate.end());
+			tileFileName.push_back('\0');
+			subtractTiles=new TiledSubtractSet(subtractFileName,subtractOffset,basePoints->getDomain(),tileLevel,epsilon,&tileFileName[0],size_t(tileCacheSize)*size_t(1024*1024)/sizeof(Point));
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"Cannot load subtraction points from file "<<subtractFileName<<" due to exception "<<err.what()<<"; terminating"<<std::endl;
+			return 1;
+			}
+		
+		/* Create a point accumulator for each traversal thread: */
+		unsigned int numSubtractThreads=numThreads>1?(unsigned int)numThreads:1U;
+		size_t threadMemoryCacheSize=memoryCacheSize/numSubtractThreads;
+		if(threadMemoryCacheSize<1)
+			threadMemoryCacheSize=1;
+		std::vector<PointAccumulator*> accumulators;
+		for(unsigned int i=0;i<numSubtractThreads;++i)
+			{
+			PointAccumulator* threadPa=new PointAccumulator;
+			threadPa->setMemorySize(threadMemoryCacheSize,tempOctreeMaxNumPointsPerNode);
+			threadPa->setTempOctreeFileNameTemplate(tempOctreeFileNameTemplate+"XXXXXX");
+			if(haveOffset)
+				{
+				PointAccumulator::Vector totalOffset=pointOffset-PointAccumulator::Vector(basePoints->getOffset());
+				if(totalOffset!=PointAccumulator::Vector::zero)
+					threadPa->setPointOffset(totalOffset);
+				}
+			accumulators.push_back(threadPa);
+			}
+		
+		/* Process the base point set's leaves in parallel: */
+		std::cout<<"Subtracting points using "<<numSubtractThreads<<" threads..."<<std::flush;
+		{
+		GridNodePointSubtractor gnps(*subtractTiles,accumulators);
+		basePoints->processNodesPrefixParallel(gnps,numSubtractThreads);
+		}
+		
+		/* Move all per-thread temporary octrees into the main point accumulator: */
+		std::vector<TempOctree*>& tempOctrees=pa.getTempOctrees();
+		for(std::vector<PointAccumulator*>::iterator aIt=accumulators.begin();aIt!=accumulators.end();++aIt)
+			{
+			(*aIt)->finishReading();
+			std::vector<TempOctree*>& threadTempOctrees=(*aIt)->getTempOctrees();
+			tempOctrees.insert(tempOctrees.end(),threadTempOctrees.begin(),threadTempOctrees.end());
+			threadTempOctrees.clear();
+			delete *aIt;
+			}
+		pa.finishReading();
+		std::cout<<" done"<<std::endl;
+		
+		/* Clear input data structures: */
+		delete basePoints;
+		delete subtractTiles;
+		}
+	else
+		{
+		/* Load the subtraction point set into a kd-tree: */
+		PointKdTree* subtractPointTree=loadSubtractSet(subtractFileName,subtractOffset);
+		if(subtractPointTree==0)
+			return 1;
+		
+		/* Process the base point set: */
+		std::cout<<"Subtracting points..."<<std::flush;
+		NodePointSubtractor nps(*basePoints,*subtractPointTree,epsilon,pa);
+		basePoints->processNodesPostfix(nps);
+		pa.finishReading();
+		std::cout<<" done"<<std::endl;
+		
+		/* Clear input data structures: */
+		delete basePoints;
+		delete subtractPointTree;
+		}
 	
 	/* Construct an octree with less than maxPointsPerNode points per leaf: */
-	LidarOctreeCreator tree(pa.getMaxNumCacheablePoints(),maxNumPointsPerNode,numThreads,pa.getTempOctrees(),tempPointFileNameTemplate+"XXXXXX");
+	LidarOctreeCreator tree(pa.getMaxNumCacheablePoints(),maxNumPointsPerNode,numThreads,pa.getTempOctrees(),outputFileName);
 	
 	/* Delete the temporary point octrees: */
 	pa.deleteTempOctrees();
 	
-	/* Write the octree structure and data to the destination LiDAR file: */
-	tree.write(size_t(memoryCacheSize)*size_t(1024*1024),outputFileName);
+	/* Write the octree structure to the destination LiDAR file: */
+	tree.write();
 	
 	/* Check if a point offset was defined: */
 	if(pointOffset!=PointAccumulator::Vector::zero)
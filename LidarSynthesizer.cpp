@@ -0,0 +1,852 @@
+/***********************************************************************
+LidarSynthesizer - Utility to generate reproducible synthetic LiDAR
+point clouds of terrain, buildings, and vegetation with controlled size
+and density, for testing and benchmarking.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <Misc/SizedTypes.h>
+#include <Misc/Endianness.h>
+#include <Misc/StandardValueCoders.h>
+#include <Misc/CompoundValueCoders.h>
+#include <Misc/ConfigurationFile.h>
+#include <IO/File.h>
+#include <IO/SeekableFile.h>
+#include <IO/OpenFile.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+#include "Config.h"
+#include "LidarTypes.h"
+#include "PointAccumulator.h"
+#include "LidarOctreeCreator.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+inline Misc::UInt64 mixBits(Misc::UInt64 z) // Scrambles the bits of a 64-bit integer; finalizer of the SplitMix64 generator
+	{
+	z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+	z=(z^(z>>27))*0x94d049bb133111ebULL;
+	return z^(z>>31);
+	}
+
+class RandomSource // Small, fast pseudo-random number generator with reproducible output on all platforms
+	{
+	/* Elements: */
+	private:
+	Misc::UInt64 state; // Current generator state
+	
+	/* Constructors and destructors: */
+	public:
+	RandomSource(Misc::UInt64 seed)
+		:state(seed)
+		{
+		}
+	
+	/* Methods: */
+	Misc::UInt64 next(void) // Returns the next 64-bit random number
+		{
+		state+=0x9e3779b97f4a7c15ULL;
+		return mixBits(state);
+		}
+	double uniform(void) // Returns a uniformly distributed number in [0, 1)
+		{
+		return double(next()>>11)*(1.0/9007199254740992.0);
+		}
+	double gaussian(void) // Returns a normally distributed number with zero mean and unit standard deviation
+		{
+		double u1=1.0-uniform();
+		double u2=uniform();
+		return Math::sqrt(-2.0*Math::log(u1))*Math::cos(2.0*Math::Constants<double>::pi*u2);
+		}
+	};
+
+enum ColorMode // Enumerated type for point coloring schemes
+	{
+	CLASS_COLORS, // Color by surface class: ground, roof, or vegetation
+	HEIGHT_COLORS, // Color by elevation
+	INTENSITY // Gray values resembling return intensities
+	};
+
+class SyntheticScene // Deterministic model of a terrain with buildings and trees, in local coordinates
+	{
+	/* Embedded classes: */
+	public:
+	enum SurfaceClass
+		{
+		GROUND,ROOF,VEGETATION
+		};
+	
+	/* Elements: */
+	private:
+	Misc::UInt64 seed; // Seed defining the scene
+	double relief; // Scale factor for terrain elevation
+	double buildingDensity; // Fraction of building cells containing a building
+	double treeDensity; // Fraction of tree cells containing a tree
+	double canopyPenetration; // Fraction of returns from tree locations that reach the ground
+	static const double buildingCellSize; // Size of the grid cells holding at most one building each
+	static const double treeCellSize; // Size of the grid cells holding at most one tree each
+	
+	/* Private methods: */
+	double hash(int ix,int iy,unsigned int salt) const // Returns a reproducible number in [0, 1) for the given grid cell and purpose
+		{
+		Misc::UInt64 h=mixBits(seed^Misc::UInt64(Misc::UInt32(ix)));
+		h=mixBits(h^(Misc::UInt64(Misc::UInt32(iy))<<32));
+		h=mixBits(h+Misc::UInt64(salt));
+		return double(h>>11)*(1.0/9007199254740992.0);
+		}
+	double valueNoise(double x,double y,double cellSize,unsigned int octave) const // Returns smoothly interpolated lattice noise in [-1, 1]
+		{
+		double fx=x/cellSize;
+		double fy=y/cellSize;
+		int ix=int(Math::floor(fx));
+		int iy=int(Math::floor(fy));
+		double tx=fx-double(ix);
+		double ty=fy-double(iy);
+		tx=tx*tx*(3.0-2.0*tx);
+		ty=ty*ty*(3.0-2.0*ty);
+		double v0=hash(ix,iy,octave)*(1.0-tx)+hash(ix+1,iy,octave)*tx;
+		double v1=hash(ix,iy+1,octave)*(1.0-tx)+hash(ix+1,iy+1,octave)*tx;
+		return (v0*(1.0-ty)+v1*ty)*2.0-1.0;
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	SyntheticScene(Misc::UInt64 sSeed,double sRelief,double sBuildingDensity,double sTreeDensity,double sCanopyPenetration)
+		:seed(sSeed),relief(sRelief),
+		 buildingDensity(sBuildingDensity),treeDensity(sTreeDensity),canopyPenetration(sCanopyPenetration)
+		{
+		}
+	
+	/* Methods: */
+	double getMinElevation(void) const // Returns a lower bound for the scene's elevation
+		{
+		return -52.3*relief;
+		}
+	double getMaxElevation(void) const // Returns an upper bound for the scene's elevation, including buildings and trees
+		{
+		return 52.3*relief+30.0;
+		}
+	double getGroundElevation(double x,double y) const // Returns the terrain elevation at the given position
+		{
+		double z=40.0*valueNoise(x,y,800.0,0);
+		z+=10.0*valueNoise(x,y,160.0,1);
+		z+=2.0*valueNoise(x,y,40.0,2);
+		z+=0.3*valueNoise(x,y,8.0,3);
+		return z*relief;
+		}
+	bool findBuilding(double x,double y,double& roofElevation,unsigned int& style) const // Returns true and the roof elevation and style if the given position is inside a building's footprint
+		{
+		int bx=int(Math::floor(x/buildingCellSize));
+		int by=int(Math::floor(y/buildingCellSize));
+		if(hash(bx,by,10)>=buildingDensity)
+			return false;
+		
+		/* Calculate the building's footprint, staying inside its cell: */
+		double halfSize[2];
+		halfSize[0]=5.0+10.0*hash(bx,by,11);
+		halfSize[1]=5.0+10.0*hash(bx,by,12);
+		double center[2];
+		center[0]=(double(bx)+0.5)*buildingCellSize+(buildingCellSize*0.5-halfSize[0])*(2.0*hash(bx,by,13)-1.0);
+		center[1]=(double(by)+0.5)*buildingCellSize+(buildingCellSize*0.5-halfSize[1])*(2.0*hash(bx,by,14)-1.0);
+		if(Math::abs(x-center[0])>=halfSize[0]||Math::abs(y-center[1])>=halfSize[1])
+			return false;
+		
+		double height=hash(bx,by,15);
+		roofElevation=getGroundElevation(center[0],center[1])+4.0+26.0*height*height;
+		style=(unsigned int)(hash(bx,by,16)*4.0);
+		return true;
+		}
+	bool findCanopy(double x,double y,double& canopyTop,double& canopyRadius) const // Returns true and the canopy's top elevation and crown radius if the given position is under a tree
+		{
+		int tx=int(Math::floor(x/treeCellSize));
+		int ty=int(Math::floor(y/treeCellSize));
+		bool result=false;
+		canopyTop=Math::Constants<double>::min;
+		for(int cy=ty-1;cy<=ty+1;++cy)
+			for(int cx=tx-1;cx<=tx+1;++cx)
+				{
+				if(hash(cx,cy,20)>=treeDensity)
+					continue;
+				
+				/* Check if the position is inside the tree's crown: */
+				double center[2];
+				center[0]=(double(cx)+0.5)*treeCellSize+2.0*(2.0*hash(cx,cy,21)-1.0);
+				center[1]=(double(cy)+0.5)*treeCellSize+2.0*(2.0*hash(cx,cy,22)-1.0);
+				double radius=1.5+2.5*hash(cx,cy,23);
+				double dist2=Math::sqr(x-center[0])+Math::sqr(y-center[1]);
+				if(dist2>=radius*radius)
+					continue;
+				
+				/* Trees don't grow on roofs: */
+				double roofElevation;
+				unsigned int style;
+				if(findBuilding(center[0],center[1],roofElevation,style))
+					continue;
+				
+				double crownCenter=getGroundElevation(center[0],center[1])+2.0+4.0*hash(cx,cy,24)+radius;
+				double top=crownCenter+Math::sqrt(radius*radius-dist2);
+				if(canopyTop<top)
+					{
+					canopyTop=top;
+					canopyRadius=radius;
+					result=true;
+					}
+				}
+		
+		return result;
+		}
+	SurfaceClass samplePoint(RandomSource& rs,double x,double y,double& z,unsigned int& style) const // Returns the class and elevation of a LiDAR return at the given position
+		{
+		/* Check for buildings first: */
+		if(findBuilding(x,y,z,style))
+			return ROOF;
+		
+		/* Check for trees, letting some returns penetrate the canopy: */
+		double canopyTop,canopyRadius;
+		if(findCanopy(x,y,canopyTop,canopyRadius)&&rs.uniform()>=canopyPenetration)
+			{
+			/* Concentrate returns near the top of the crown: */
+			double u=rs.uniform();
+			z=canopyTop-u*u*canopyRadius;
+			style=0;
+			return VEGETATION;
+			}
+		
+		z=getGroundElevation(x,y);
+		style=0;
+		return GROUND;
+		}
+	};
+
+const double SyntheticScene::buildingCellSize=40.0;
+const double SyntheticScene::treeCellSize=8.0;
+
+struct SynthesizerSettings // Structure holding the parameters of a synthetic point cloud
+	{
+	/* Elements: */
+	public:
+	double origin[3]; // Source coordinates of the point cloud's lower-left corner
+	double extent[2]; // Size of the point cloud in x and y
+	Misc::UInt64 numPoints; // Total number of points to generate
+	double noise; // Standard deviation of the Gaussian noise added to point positions
+	ColorMode colorMode; // Point coloring scheme
+	Misc::UInt64 seed; // Seed for the scene and the point positions
+	};
+
+inline unsigned char clampColor(double value)
+	{
+	if(value<=0.0)
+		return 0;
+	else if(value>=255.0)
+		return 255;
+	else
+		return (unsigned char)(value+0.5);
+	}
+
+void colorPoint(const SyntheticScene& scene,SyntheticScene::SurfaceClass surfaceClass,unsigned int style,double z,ColorMode colorMode,RandomSource& rs,double color[3]) // Calculates a point's RGB color in [0, 255]
+	{
+	double jitter=(rs.uniform()-0.5)*16.0;
+	switch(colorMode)
+		{
+		case CLASS_COLORS:
+			{
+			static const double roofColors[4][3]={{150.0,150.0,150.0},{170.0,80.0,60.0},{90.0,90.0,100.0},{200.0,190.0,170.0}};
+			switch(surfaceClass)
+				{
+				case SyntheticScene::GROUND:
+					color[0]=110.0+jitter;
+					color[1]=112.0+jitter;
+					color[2]=70.0+jitter;
+					break;
+				
+				case SyntheticScene::ROOF:
+					for(int i=0;i<3;++i)
+						color[i]=roofColors[style][i]+jitter;
+					break;
+				
+				case SyntheticScene::VEGETATION:
+					color[0]=40.0+jitter;
+					color[1]=100.0+jitter;
+					color[2]=40.0+jitter;
+					break;
+				}
+			break;
+			}
+		
+		case HEIGHT_COLORS:
+			{
+			/* Map elevation to a blue-green-yellow-red ramp: */
+			double t=(z-scene.getMinElevation())/(scene.getMaxElevation()-scene.getMinElevation());
+			t=t<0.0?0.0:(t>1.0?1.0:t)*3.0;
+			if(t<1.0)
+				{
+				color[0]=0.0;
+				color[1]=255.0*t;
+				color[2]=255.0*(1.0-t);
+				}
+			else if(t<2.0)
+				{
+				color[0]=255.0*(t-1.0);
+				color[1]=255.0;
+				color[2]=0.0;
+				}
+			else
+				{
+				color[0]=255.0;
+				color[1]=255.0*(3.0-t);
+				color[2]=0.0;
+				}
+			break;
+			}
+		
+		case INTENSITY:
+			{
+			static const double intensities[3]={100.0,180.0,60.0};
+			for(int i=0;i<3;++i)
+				color[i]=intensities[surfaceClass]+jitter;
+			break;
+			}
+		}
+	}
+
+template <class PointSinkParam>
+void generatePoints(const SyntheticScene& scene,const SynthesizerSettings& settings,PointSinkParam& sink) // Generates all points tile by tile and passes them to the given sink in source coordinates
+	{
+	/* Split the extent into tiles of equal size that are processed in order, each with its own random number sequence: */
+	unsigned int numTiles[2];
+	double tileSize[2];
+	for(int i=0;i<2;++i)
+		{
+		numTiles[i]=(unsigned int)(Math::ceil(settings.extent[i]/25.0));
+		if(numTiles[i]<1)
+			numTiles[i]=1;
+		tileSize[i]=settings.extent[i]/double(numTiles[i]);
+		}
+	double totalNumTiles=double(numTiles[0])*double(numTiles[1]);
+	
+	std::cout<<"Generating points...   0% done"<<std::flush;
+	Misc::UInt64 tileIndex=0;
+	Misc::UInt64 numGenerated=0;
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		{
+		for(unsigned int tx=0;tx<numTiles[0];++tx,++tileIndex)
+			{
+			/* Distribute the points evenly over all tiles: */
+			Misc::UInt64 tileEnd=Misc::UInt64(Math::floor(double(settings.numPoints)*double(tileIndex+1)/totalNumTiles));
+			RandomSource rs(mixBits(settings.seed^mixBits(tileIndex)));
+			double x0=double(tx)*tileSize[0];
+			double y0=double(ty)*tileSize[1];
+			for(;numGenerated<tileEnd;++numGenerated)
+				{
+				/* Sample the scene at a random position inside the tile: */
+				double x=x0+rs.uniform()*tileSize[0];
+				double y=y0+rs.uniform()*tileSize[1];
+				double z;
+				unsigned int style;
+				SyntheticScene::SurfaceClass surfaceClass=scene.samplePoint(rs,x,y,z,style);
+				double color[3];
+				colorPoint(scene,surfaceClass,style,z,settings.colorMode,rs,color);
+				
+				/* Add measurement noise: */
+				if(settings.noise>0.0)
+					{
+					x+=rs.gaussian()*settings.noise;
+					y+=rs.gaussian()*settings.noise;
+					z+=rs.gaussian()*settings.noise;
+					}
+				
+				double p[3];
+				p[0]=settings.origin[0]+x;
+				p[1]=settings.origin[1]+y;
+				p[2]=settings.origin[2]+z;
+				sink.addPoint(p,color);
+				}
+			}
+		
+		std::cout<<"\rGenerating points... "<<std::setw(3)<<(100*(ty+1)+numTiles[1]/2)/numTiles[1]<<"% done"<<std::flush;
+		}
+	std::cout<<std::endl;
+	}
+
+class BinaryRgbSink // Writes points into a binary file in LidarPreprocessor's BINRGB format
+	{
+	/* Elements: */
+	private:
+	IO::FilePtr file;
+	
+	/* Constructors and destructors: */
+	public:
+	BinaryRgbSink(const char* fileName,Misc::UInt64 numPoints)
+		:file(IO::openFile(fileName,IO::File::WriteOnly))
+		{
+		file->setEndianness(Misc::LittleEndian);
+		file->write<unsigned int>((unsigned int)(numPoints));
+		}
+	
+	/* Methods: */
+	void addPoint(const double p[3],const double color[3])
+		{
+		float fp[3];
+		for(int i=0;i<3;++i)
+			fp[i]=float(p[i]);
+		file->write(fp,3);
+		Color::Scalar rgba[4];
+		for(int i=0;i<3;++i)
+			rgba[i]=clampColor(color[i]);
+		rgba[3]=Color::Scalar(255);
+		file->write(rgba,4);
+		}
+	};
+
+class LasSink // Writes points into a LAS 1.2 file with point data format 2
+	{
+	/* Elements: */
+	private:
+	IO::SeekableFilePtr file;
+	double scale[3],offset[3]; // Quantization scale factors and offset vector
+	double min[3],max[3]; // Bounding box of written points
+	Misc::UInt64 numPoints; // Number of written points
+	
+	/* Constructors and destructors: */
+	public:
+	LasSink(const char* fileName,const double sScale[3],const double sOffset[3])
+		:file(IO::openSeekableFile(fileName,IO::File::WriteOnly)),
+		 numPoints(0)
+		{
+		file->setEndianness(Misc::LittleEndian);
+		for(int i=0;i<3;++i)
+			{
+			scale[i]=sScale[i];
+			offset[i]=sOffset[i];
+			min[i]=Math::Constants<double>::max;
+			max[i]=Math::Constants<double>::min;
+			}
+		
+		/* Create the initial LAS file header: */
+		char signature[5]="LASF";
+		file->write(signature,4); // LAS signature
+		file->write<unsigned short>(0); // File source ID
+		file->write<unsigned short>(0); // Reserved field
+		file->write<unsigned int>(0); // Project ID
+		file->write<unsigned short>(0); // Project ID
+		file->write<unsigned short>(0); // Project ID
+		char dummy[32];
+		memset(dummy,0,sizeof(dummy));
+		file->write(dummy,8); // Project ID
+		file->write<unsigned char>(1); // File version number
+		file->write<unsigned char>(2); // File version number
+		file->write(dummy,32); // System identifier
+		file->write(dummy,32); // Generating software
+		file->write<unsigned short>(1); // File creation day of year
+		file->write<unsigned short>(2011); // File creation year
+		file->write<unsigned short>(227); // LAS header size
+		file->write<unsigned int>(227); // Point data offset
+		file->write<unsigned int>(0); // Number of variable-length records
+		file->write<unsigned char>(2); // Point data format
+		file->write<unsigned short>(26); // Point data record length
+		file->write<unsigned int>(0); // Number of point records
+		for(int i=0;i<5;++i)
+			file->write<unsigned int>(0); // Number of point records by return
+		file->write(scale,3); // Quantization scale factor
+		file->write(offset,3); // Quantization offset vector
+		for(int i=0;i<3;++i) // Point position bounding box
+			{
+			file->write<double>(max[i]);
+			file->write<double>(min[i]);
+			}
+		}
+	~LasSink(void)
+		{
+		/* Write the final LAS header: */
+		file->setWritePosAbs(107);
+		file->write<unsigned int>((unsigned int)(numPoints));
+		file->write<unsigned int>((unsigned int)(numPoints));
+		file->setWritePosAbs(179);
+		for(int i=0;i<3;++i)
+			{
+			file->write<double>(max[i]);
+			file->write<double>(min[i]);
+			}
+		}
+	
+	/* Methods: */
+	void addPoint(const double p[3],const double color[3])
+		{
+		/* Write the quantized point position: */
+		for(int i=0;i<3;++i)
+			{
+			file->write<int>(int(Math::floor((p[i]-offset[i])/scale[i]+0.5)));
+			if(min[i]>p[i])
+				min[i]=p[i];
+			if(max[i]<p[i])
+				max[i]=p[i];
+			}
+		
+		/* Write the rest of the point record: */
+		unsigned short rgb[3];
+		for(int i=0;i<3;++i)
+			rgb[i]=clampColor(color[i]);
+		file->write<unsigned short>((rgb[0]+rgb[1]+rgb[2]+1)/3); // Point intensity
+		file->write<unsigned char>(0); // Return data
+		file->write<unsigned char>(0); // Point classification
+		file->write<unsigned char>(0); // Laser angle
+		file->write<unsigned char>(0); // User data
+		file->write<unsigned short>(0); // Source
+		file->write(rgb,3); // Point color
+		++numPoints;
+		}
+	};
+
+class AccumulatorSink // Streams points into a point accumulator to create a LiDAR octree directly
+	{
+	/* Elements: */
+	private:
+	PointAccumulator::Batch batch;
+	
+	/* Constructors and destructors: */
+	public:
+	AccumulatorSink(PointAccumulator& pa)
+		:batch(pa)
+		{
+		}
+	~AccumulatorSink(void)
+		{
+		batch.flush();
+		}
+	
+	/* Methods: */
+	void addPoint(const double p[3],const double color[3])
+		{
+		batch.addPoint(PointAccumulator::Point(p),PointAccumulator::Color(float(color[0]),float(color[1]),float(color[2])));
+		}
+	};
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Read octree creation settings shared with LidarPreprocessor: */
+	unsigned int memoryCacheSize=512;
+	unsigned int tempOctreeMaxNumPointsPerNode=4096;
+	std::string tempOctreeFileNameTemplate="/tmp/LidarPreprocessorTempOctree";
+	unsigned int maxNumPointsPerNode=4096;
+	int numThreads=1;
+	try
+		{
+		/* Open LidarViewer's configuration file: */
+		Misc::ConfigurationFile configFile(LIDARVIEWER_CONFIGFILENAME);
+		Misc::ConfigurationFileSection cfg=configFile.getSection("/LidarPreprocessor");
+		
+		/* Override program settings from configuration file: */
+		memoryCacheSize=cfg.retrieveValue<unsigned int>("./memoryCacheSize",memoryCacheSize);
+		tempOctreeMaxNumPointsPerNode=cfg.retrieveValue<unsigned int>("./tempOctreeMaxNumPointsPerNode",tempOctreeMaxNumPointsPerNode);
+		tempOctreeFileNameTemplate=cfg.retrieveValue<std::string>("./tempOctreeFileNameTemplate",tempOctreeFileNameTemplate);
+		maxNumPointsPerNode=cfg.retrieveValue<unsigned int>("./maxNumPointsPerNode",maxNumPointsPerNode);
+		numThreads=cfg.retrieveValue<int>("./numThreads",numThreads);
+		}
+	catch(const std::runtime_error&)
+		{
+		/* Just ignore the error */
+		}
+	
+	/* Parse the command line: */
+	SynthesizerSettings settings;
+	for(int i=0;i<3;++i)
+		settings.origin[i]=0.0;
+	settings.extent[0]=settings.extent[1]=1000.0;
+	double density=10.0;
+	double numPoints=-1.0;
+	settings.noise=0.05;
+	settings.colorMode=CLASS_COLORS;
+	settings.seed=1;
+	double relief=1.0;
+	double buildingDensity=0.3;
+	double treeDensity=0.25;
+	double canopyPenetration=0.3;
+	int outputFileType=0; // 0: LiDAR octree, 1: binary, 2: LAS
+	double lasScale[3]={0.001,0.001,0.001};
+	const char* outputFileName=0;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"origin")==0)
+				{
+				if(i+3<argc)
+					{
+					for(int j=0;j<3;++j)
+						{
+						++i;
+						settings.origin[j]=atof(argv[i]);
+						}
+					}
+				else
+					{
+					std::cerr<<"Ignoring dangling -origin option"<<std::endl;
+					i+=3;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"extent")==0)
+				{
+				if(i+2<argc)
+					{
+					for(int j=0;j<2;++j)
+						{
+						++i;
+						settings.extent[j]=atof(argv[i]);
+						}
+					}
+				else
+					{
+					std::cerr<<"Ignoring dangling -extent option"<<std::endl;
+					i+=2;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"density")==0)
+				{
+				++i;
+				if(i<argc)
+					density=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -density option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"numPoints")==0)
+				{
+				++i;
+				if(i<argc)
+					numPoints=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -numPoints option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"noise")==0)
+				{
+				++i;
+				if(i<argc)
+					settings.noise=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -noise option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"color")==0)
+				{
+				++i;
+				if(i<argc)
+					{
+					if(strcasecmp(argv[i],"class")==0)
+						settings.colorMode=CLASS_COLORS;
+					else if(strcasecmp(argv[i],"height")==0)
+						settings.colorMode=HEIGHT_COLORS;
+					else if(strcasecmp(argv[i],"intensity")==0)
+						settings.colorMode=INTENSITY;
+					else
+						std::cerr<<"Ignoring unknown color mode "<<argv[i]<<std::endl;
+					}
+				else
+					std::cerr<<"Ignoring dangling -color option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"seed")==0)
+				{
+				++i;
+				if(i<argc)
+					settings.seed=Misc::UInt64(strtoull(argv[i],0,10));
+				else
+					std::cerr<<"Ignoring dangling -seed option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"relief")==0)
+				{
+				++i;
+				if(i<argc)
+					relief=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -relief option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"buildings")==0)
+				{
+				++i;
+				if(i<argc)
+					buildingDensity=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -buildings option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"trees")==0)
+				{
+				++i;
+				if(i<argc)
+					treeDensity=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -trees option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"penetration")==0)
+				{
+				++i;
+				if(i<argc)
+					canopyPenetration=atof(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -penetration option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"bin")==0)
+				outputFileType=1;
+			else if(strcasecmp(argv[i]+1,"las")==0)
+				outputFileType=2;
+			else if(strcasecmp(argv[i]+1,"lasScale")==0)
+				{
+				if(i+3<argc)
+					{
+					for(int j=0;j<3;++j)
+						{
+						++i;
+						lasScale[j]=atof(argv[i]);
+						}
+					}
+				else
+					{
+					std::cerr<<"Ignoring dangling -lasScale option"<<std::endl;
+					i+=3;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"np")==0)
+				{
+				++i;
+				if(i<argc)
+					maxNumPointsPerNode=(unsigned int)(atoi(argv[i]));
+				else
+					std::cerr<<"Ignoring dangling -np option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"nt")==0)
+				{
+				++i;
+				if(i<argc)
+					numThreads=atoi(argv[i]);
+				else
+					std::cerr<<"Ignoring dangling -nt option"<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"ooc")==0)
+				{
+				++i;
+				if(i<argc)
+					memoryCacheSize=(unsigned int)(atoi(argv[i]));
+				else
+					std::cerr<<"Ignoring dangling -ooc option"<<std::endl;
+				}
+			else
+				std::cerr<<"Ignoring command line option "<<argv[i]<<std::endl;
+			}
+		else if(outputFileName==0)
+			outputFileName=argv[i];
+		else
+			std::cerr<<"Ignoring command line argument "<<argv[i]<<std::endl;
+		}
+	if(outputFileName==0)
+		{
+		std::cerr<<"Usage: "<<argv[0]<<" [-extent <size x> <size y>] [-density <points per square unit> | -numPoints <num points>] [-origin <x> <y> <z>] [-noise <sigma>] [-color class | height | intensity] [-seed <seed>] [-relief <scale>] [-buildings <fraction>] [-trees <fraction>] [-penetration <fraction>] [-bin | -las [-lasScale <x scale> <y scale> <z scale>]] [-np <max points per node>] [-nt <num threads>] [-ooc <memory cache size>] <output file name>"<<std::endl;
+		std::cerr<<"  -extent <size x> <size y> sets the size of the generated area (default: 1000 1000)"<<std::endl;
+		std::cerr<<"  -density <points per square unit> sets the average point density (default: 10)"<<std::endl;
+		std::cerr<<"  -numPoints <num points> sets the total number of points, overriding -density"<<std::endl;
+		std::cerr<<"  -origin <x> <y> <z> offsets all points by the given vector (default: 0 0 0)"<<std::endl;
+		std::cerr<<"  -noise <sigma> sets the standard deviation of the noise added to point positions (default: 0.05)"<<std::endl;
+		std::cerr<<"  -color class | height | intensity colors points by surface class, by elevation, or with intensity-like gray values (default: class)"<<std::endl;
+		std::cerr<<"  -seed <seed> selects a different, reproducible scene and point distribution (default: 1)"<<std::endl;
+		std::cerr<<"  -relief <scale> scales the terrain's elevation (default: 1)"<<std::endl;
+		std::cerr<<"  -buildings <fraction> sets the fraction of 40x40 cells containing a building (default: 0.3)"<<std::endl;
+		std::cerr<<"  -trees <fraction> sets the fraction of 8x8 cells containing a tree (default: 0.25)"<<std::endl;
+		std::cerr<<"  -penetration <fraction> sets the fraction of returns reaching the ground through tree canopies (default: 0.3)"<<std::endl;
+		std::cerr<<"  -bin writes points into a binary file in LidarPreprocessor's BINRGB format"<<std::endl;
+		std::cerr<<"  -las writes points into a LAS file"<<std::endl;
+		std::cerr<<"  -lasScale <x scale> <y scale> <z scale> defines the quantization scaling factors for LAS files (default: 0.001 0.001 0.001)"<<std::endl;
+		std::cerr<<"  Without -bin or -las, creates a LiDAR octree directly, using the -np, -nt, and -ooc options like LidarPreprocessor"<<std::endl;
+		return 1;
+		}
+	
+	/* Calculate the total number of points: */
+	if(numPoints<0.0)
+		numPoints=density*settings.extent[0]*settings.extent[1];
+	settings.numPoints=Misc::UInt64(numPoints+0.5);
+	if(outputFileType!=0&&settings.numPoints>Misc::UInt64(~0x0U))
+		{
+		std::cerr<<"Cannot write more than "<<~0x0U<<" points into a binary or LAS file"<<std::endl;
+		return 1;
+		}
+	std::cout<<"Generating "<<settings.numPoints<<" points over "<<settings.extent[0]<<" x "<<settings.extent[1]<<" with seed "<<settings.seed<<std::endl;
+	
+	SyntheticScene scene(settings.seed,relief,buildingDensity,treeDensity,canopyPenetration);
+	try
+		{
+		if(outputFileType==1)
+			{
+			BinaryRgbSink sink(outputFileName,settings.numPoints);
+			generatePoints(scene,settings,sink);
+			}
+		else if(outputFileType==2)
+			{
+			LasSink sink(outputFileName,lasScale,settings.origin);
+			generatePoints(scene,settings,sink);
+			}
+		else
+			{
+			/* Stream the points into a point accumulator, shifting them to the origin: */
+			PointAccumulator pa;
+			pa.setMemorySize(memoryCacheSize,tempOctreeMaxNumPointsPerNode);
+			pa.setTempOctreeFileNameTemplate(tempOctreeFileNameTemplate+"XXXXXX");
+			pa.setNumTempOctreeThreads(numThreads>1?(unsigned int)numThreads:1U);
+			PointAccumulator::Vector pointOffset;
+			for(int i=0;i<3;++i)
+				pointOffset[i]=-settings.origin[i];
+			pa.setPointOffset(pointOffset);
+			{
+			AccumulatorSink sink(pa);
+			generatePoints(scene,settings,sink);
+			}
+			pa.finishReading();
+			
+			/* Create the LiDAR octree: */
+			LidarOctreeCreator tree(pa.getMaxNumCacheablePoints(),maxNumPointsPerNode,numThreads,pa.getTempOctrees(),outputFileName);
+			pa.deleteTempOctrees();
+			tree.write();
+			
+			/* Write the point offsets to an offset file: */
+			if(pa.getPointOffset()!=PointAccumulator::Vector::zero)
+				{
+				std::string offsetFileName=outputFileName;
+				offsetFileName.append("/Offset");
+				IO::FilePtr offsetFile(IO::openFile(offsetFileName.c_str(),IO::File::WriteOnly));
+				offsetFile->setEndianness(Misc::LittleEndian);
+				offsetFile->write(pa.getPointOffset().getComponents(),3);
+				}
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Cannot create synthetic point cloud "<<outputFileName<<" due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
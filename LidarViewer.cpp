@@ -1,6 +1,6 @@
 /***********************************************************************
 LidarViewer - Viewer program for multiresolution LiDAR data.
-Copyright (c) 2005-2025 Oliver Kreylos
+Copyright (c) 2005-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,6 +23,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarViewer.h"
 
 #include <string.h>
+#include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <iostream>
@@ -33,7 +34,6 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Misc/PrintInteger.h>
 #include <Misc/MessageLogger.h>
 #include <Misc/CreateNumberedFileName.h>
-#include <Misc/FileTests.h>
 #include <Misc/StringMarshaller.h>
 #include <Misc/StandardValueCoders.h>
 #include <Misc/ColorValueCoders.h>
@@ -43,6 +43,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <IO/ValueSource.h>
 #include <IO/OpenFile.h>
 #include <Cluster/MulticastPipe.h>
+#include <Cluster/GatherOperation.h>
+#include <Math/Math.h>
 #include <Geometry/Vector.h>
 #include <Geometry/AffineTransformation.h>
 #include <Geometry/LinearUnit.h>
@@ -51,6 +53,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <GL/GLMaterialTemplates.h>
 #include <GL/GLMaterial.h>
 #include <GL/GLContextData.h>
+#include <GL/GLExtensionManager.h>
 #ifdef LIDARVIEWER_VISUALIZE_WATER
 #include <GL/Extensions/GLARBVertexShader.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
@@ -72,6 +75,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <GLMotif/Pager.h>
 #include <GLMotif/Separator.h>
 #include <GLMotif/Label.h>
+#include <GLMotif/TextField.h>
 #include <GLMotif/Button.h>
 #include <GLMotif/CascadeButton.h>
 #include <GLMotif/MaterialEditor.h>
@@ -97,8 +101,14 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include "Config.h"
 #include "LidarOctree.h"
+#include "LidarCacheManager.h"
+#include "SystemMemory.h"
+#include "LidarFileServer.h"
+#include "CameraPath.h"
+#include "TraceEvents.h"
 #include "ProjectorTool.h"
 #include "PointSelectorTool.h"
+#include "ProfileTool.h"
 #include "LidarSelectionSaver.h"
 #include "Primitive.h"
 #include "PointPrimitive.h"
@@ -107,6 +117,9 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "CylinderPrimitive.h"
 #include "PlanePrimitive.h"
 #include "BruntonPrimitive.h"
+#include "PrimitiveRefiner.h"
+#include "RenderQualityController.h"
+#include "SurfaceHeightCache.h"
 #include "PrimitiveDraggerTool.h"
 #include "PointClassifier.h"
 #include "RidgeFinder.h"
@@ -137,18 +150,45 @@ Methods of class LidarViewer::DataItem:
 
 LidarViewer::DataItem::DataItem(GLContextData& contextData)
 	:influenceSphereDisplayListId(glGenLists(1)),
-	 pbls(contextData)
+	 pbls(contextData),
+	 hasTimerQueryExtension(GLExtensionManager::isExtensionSupported("GL_ARB_timer_query")),
+	 glGenQueriesProc(0),glDeleteQueriesProc(0),glBeginQueryProc(0),glEndQueryProc(0),
+	 glGetQueryObjectuivProc(0),glGetQueryObjectui64vProc(0),
+	 nextTimerQuery(0),
+	 timedFrame(0),timedFrameTime(0.0)
 	 #ifdef LIDARVIEWER_VISUALIZE_WATER
 	 ,waterShader(0)
 	 #endif
 	{
 	glGenTextures(1,&planeColorMapTextureId);
+	
+	for(int i=0;i<numTimerQueries;++i)
+		{
+		timerQueryIds[i]=0;
+		timerQueryFrames[i]=0;
+		timerQueryPending[i]=false;
+		}
+	if(hasTimerQueryExtension)
+		{
+		/* Get the required entry points: */
+		glGenQueriesProc=GLExtensionManager::getFunction<PFNGLGENQUERIESPROC>("glGenQueries");
+		glDeleteQueriesProc=GLExtensionManager::getFunction<PFNGLDELETEQUERIESPROC>("glDeleteQueries");
+		glBeginQueryProc=GLExtensionManager::getFunction<PFNGLBEGINQUERYPROC>("glBeginQuery");
+		glEndQueryProc=GLExtensionManager::getFunction<PFNGLENDQUERYPROC>("glEndQuery");
+		glGetQueryObjectuivProc=GLExtensionManager::getFunction<PFNGLGETQUERYOBJECTUIVPROC>("glGetQueryObjectuiv");
+		glGetQueryObjectui64vProc=GLExtensionManager::getFunction<PFNGLGETQUERYOBJECTUI64VPROC>("glGetQueryObjectui64v");
+		
+		/* Create the timer queries: */
+		glGenQueriesProc(numTimerQueries,timerQueryIds);
+		}
 	}
 
 LidarViewer::DataItem::~DataItem(void)
 	{
 	glDeleteLists(influenceSphereDisplayListId,1);
 	glDeleteTextures(1,&planeColorMapTextureId);
+	if(hasTimerQueryExtension)
+		glDeleteQueriesProc(numTimerQueries,timerQueryIds);
 	
 	#ifdef LIDARVIEWER_VISUALIZE_WATER
 	glDeleteObjectARB(waterShader);
@@ -239,25 +279,36 @@ void LidarViewer::classifySelectionCallback(Misc::CallbackData* cbData)
 
 void LidarViewer::saveSelectionOKCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData)
 	{
+	/* Save only one selection at a time: */
+	if(savingSelection)
+		{
+		Misc::formattedUserError("Save Selection...: Could not write selection to file %s because the previous selection is still being saved",cbData->getSelectedPath().c_str());
+		cbData->fileSelectionDialog->close();
+		return;
+		}
+	
 	bool success=false;
 	
 	if(Vrui::isHeadNode())
 		{
 		try
 			{
-			/* Create a selection saver functor: */
-			LidarSelectionSaver lss(cbData->getSelectedPath().c_str(),offsets);
-			if(octrees[0]->hasNormalVectors())
+			/* Create a selection saver and take a snapshot of all selected points: */
+			selectionSaver=new LidarSelectionSaver(cbData->getSelectedPath().c_str(),offsets,treeUpdateNotificationCB,this);
+			if(octrees[0]->hasNormalVectors()&&LidarSelectionSaver::getFileFormat(cbData->getSelectedPath().c_str())==LidarSelectionSaver::ASCII)
 				{
-				/* Save all selected points: */
-				octrees[0]->processSelectedPointsWithNormals(lss);
+				/* Snapshot all selected points: */
+				octrees[0]->processSelectedPointsWithNormals(*selectionSaver);
 				}
 			else
 				{
-				/* Save all selected points: */
-				octrees[0]->processSelectedPoints(lss);
+				/* Snapshot all selected points: */
+				octrees[0]->processSelectedPoints(*selectionSaver);
 				}
 			
+			/* Write the snapshot from a background thread: */
+			selectionSaver->startSaving();
+			
 			if(Vrui::getMainPipe()!=0)
 				{
 				/* Send success flag to the cluster: */
@@ -269,6 +320,9 @@ void LidarViewer::saveSelectionOKCallback(GLMotif::FileSelectionDialog::OKCallba
 			}
 		catch(const std::runtime_error& err)
 			{
+			delete selectionSaver;
+			selectionSaver=0;
+			
 			if(Vrui::getMainPipe()!=0)
 				{
 				/* Send error flag and error message to the cluster: */
@@ -295,8 +349,17 @@ void LidarViewer::saveSelectionOKCallback(GLMotif::FileSelectionDialog::OKCallba
 	
 	if(success)
 		{
-		/* Remember the current directory for next time: */
-		dataDirectory=cbData->selectedDirectory;
+		/* Remember the save until the background thread finishes: */
+		savingSelection=true;
+		savingSelectionPath=cbData->getSelectedPath();
+		savingSelectionDirectory=cbData->selectedDirectory;
+		
+		/* Show a progress dialog: */
+		saveSelectionProgressDialog=new GLMotif::PopupWindow("SaveSelectionProgressDialog",Vrui::getWidgetManager(),"Saving Selection...");
+		saveSelectionProgressDialog->setResizableFlags(false,false);
+		saveSelectionProgressLabel=new GLMotif::Label("SaveSelectionProgressLabel",saveSelectionProgressDialog,"Saved 0000000000 of 0000000000 points");
+		Vrui::popupPrimaryWidget(saveSelectionProgressDialog);
+		updateSaveSelectionProgress();
 		}
 	
 	/* Destroy the file selection dialog: */
@@ -311,12 +374,12 @@ void LidarViewer::saveSelectionCallback(Misc::CallbackData* cbData)
 	if(octrees[0]->hasNormalVectors())
 		{
 		fileName="SelectedPoints.xyzuvwrgb";
-		filter=".xyzuvwrgb";
+		filter=".xyzuvwrgb;.bin;.las";
 		}
 	else
 		{
 		fileName="SelectedPoints.xyzrgb";
-		filter=".xyzrgb";
+		filter=".xyzrgb;.bin;.las";
 		}
 	
 	try
@@ -343,6 +406,78 @@ void LidarViewer::saveSelectionCallback(Misc::CallbackData* cbData)
 		}
 	}
 
+void LidarViewer::updateSaveSelectionProgress(void)
+	{
+	/* Get the background saver's state on the head node and share it with the cluster: */
+	bool finished;
+	Misc::UInt64 numSavedPoints,numPoints;
+	std::string errorMessage;
+	if(Vrui::isHeadNode())
+		{
+		finished=selectionSaver->isFinished();
+		numSavedPoints=selectionSaver->getNumSavedPoints();
+		numPoints=selectionSaver->getNumPoints();
+		if(finished)
+			errorMessage=selectionSaver->getErrorMessage();
+		
+		if(Vrui::getMainPipe()!=0)
+			{
+			Vrui::getMainPipe()->write<unsigned char>(finished?(errorMessage.empty()?1:2):0);
+			Vrui::getMainPipe()->write<Misc::UInt64>(numSavedPoints);
+			Vrui::getMainPipe()->write<Misc::UInt64>(numPoints);
+			if(!errorMessage.empty())
+				Misc::writeCString(errorMessage.c_str(),*Vrui::getMainPipe());
+			Vrui::getMainPipe()->flush();
+			}
+		}
+	else
+		{
+		unsigned char state=Vrui::getMainPipe()->read<unsigned char>();
+		finished=state!=0;
+		numSavedPoints=Vrui::getMainPipe()->read<Misc::UInt64>();
+		numPoints=Vrui::getMainPipe()->read<Misc::UInt64>();
+		if(state==2)
+			{
+			char* what=Misc::readCString(*Vrui::getMainPipe());
+			errorMessage=what;
+			delete[] what;
+			}
+		}
+	
+	if(finished)
+		{
+		/* Close the progress dialog: */
+		Vrui::popdownPrimaryWidget(saveSelectionProgressDialog);
+		delete saveSelectionProgressDialog;
+		saveSelectionProgressDialog=0;
+		saveSelectionProgressLabel=0;
+		
+		/* Release the background saver: */
+		delete selectionSaver;
+		selectionSaver=0;
+		savingSelection=false;
+		
+		if(errorMessage.empty())
+			{
+			/* Remember the current directory for next time: */
+			dataDirectory=savingSelectionDirectory;
+			}
+		else
+			{
+			/* Show an error message: */
+			Misc::formattedUserError("Save Selection...: Could not write selection to file %s due to exception %s",savingSelectionPath.c_str(),errorMessage.c_str());
+			}
+		savingSelectionDirectory=0;
+		}
+	else
+		{
+		/* Update the progress dialog: */
+		char progress[64];
+		snprintf(progress,sizeof(progress),"Saved %llu of %llu points",(unsigned long long)numSavedPoints,(unsigned long long)numPoints);
+		saveSelectionProgressLabel->setString(progress);
+		}
+	}
+
 void LidarViewer::clearSelectionCallback(Misc::CallbackData* cbData)
 	{
 	/* Clear the point selection: */
@@ -427,6 +562,9 @@ GLMotif::PopupMenu* LidarViewer::createDialogMenu(void)
 	GLMotif::Button* showInteractionDialogButton=new GLMotif::Button("ShowInteractionDialogButton",dialogMenu,"Show Interaction Dialog");
 	showInteractionDialogButton->getSelectCallbacks().add(this,&LidarViewer::showInteractionDialogCallback);
 	
+	GLMotif::Button* showStatisticsDialogButton=new GLMotif::Button("ShowStatisticsDialogButton",dialogMenu,"Show Statistics Dialog");
+	showStatisticsDialogButton->getSelectCallbacks().add(this,&LidarViewer::showStatisticsDialogCallback);
+	
 	GLMotif::Button* showSceneGraphListButton=new GLMotif::Button("ShowSceneGraphListButton",dialogMenu,"Show Scene Graph List");
 	showSceneGraphListButton->getSelectCallbacks().add(this,&LidarViewer::showSceneGraphListCallback);
 	
@@ -579,6 +717,15 @@ void LidarViewer::renderSettingsUpdatedCallback(KoinoniaClient* client,KoinoniaP
 	thisPtr->renderDialog->updateVariables();
 	}
 
+void LidarViewer::sharedLidarFileUrlsUpdatedCallback(KoinoniaClient* client,KoinoniaProtocol::ObjectID id,void* object,void* userData)
+	{
+	LidarViewer* thisPtr=static_cast<LidarViewer*>(userData);
+	
+	/* Tell the user where to stream the LiDAR files of the shared session from: */
+	if(!thisPtr->sharedLidarFileUrls.empty()&&thisPtr->lidarFileServer==0)
+		std::cout<<"LidarViewer: A collaboration peer serves its LiDAR files at "<<thisPtr->sharedLidarFileUrls<<"; open them in place of local files to stream octree nodes on demand"<<std::endl;
+	}
+
 void* LidarViewer::createPrimitiveFunction(KoinoniaClient* client,KoinoniaProtocol::NamespaceID namespaceId,DataType::TypeID type,void* userData)
 	{
 	/* Create a primitive object based on the given data type: */
@@ -639,6 +786,7 @@ void LidarViewer::primitiveDestroyedCallback(KoinoniaClient* client,KoinoniaProt
 		;
 	if(primitiveIndex<thisPtr->primitives.size())
 		{
+		thisPtr->cancelPrimitiveRefinement(primitive);
 		delete thisPtr->primitives[primitiveIndex];
 		thisPtr->primitives.erase(thisPtr->primitives.begin()+primitiveIndex);
 		thisPtr->primitiveSelectedFlags.erase(thisPtr->primitiveSelectedFlags.begin()+primitiveIndex);
@@ -669,7 +817,7 @@ GLMotif::PopupWindow* LidarViewer::createRenderDialog(void)
 	/* Create a slider/textfield combo to change the rendering quality: */
 	new GLMotif::Label("RenderQualityLabel",lodBox,"Render Quality");
 	
-	GLMotif::TextFieldSlider* renderQualitySlider=new GLMotif::TextFieldSlider("RenderQualitySlider",lodBox,6,ss.fontHeight*10.0f);
+	renderQualitySlider=new GLMotif::TextFieldSlider("RenderQualitySlider",lodBox,6,ss.fontHeight*10.0f);
 	renderQualitySlider->getTextField()->setFloatFormat(GLMotif::TextField::FIXED);
 	renderQualitySlider->getTextField()->setFieldWidth(5);
 	renderQualitySlider->getTextField()->setPrecision(2);
@@ -855,6 +1003,58 @@ GLMotif::PopupWindow* LidarViewer::createRenderDialog(void)
 		materialEditor->getValueChangedCallbacks().add(this,&LidarViewer::renderSettingsChangedCallback);
 		
 		materialMargin->manageChild();
+		
+		if(!colorAttributeName.empty())
+			{
+			/* Create a page to map point attribute values to colors: */
+			renderPager->setNextPageName("Attribute");
+			
+			GLMotif::RowColumn* attributeBox=new GLMotif::RowColumn("AttributeBox",renderPager,false);
+			attributeBox->setOrientation(GLMotif::RowColumn::VERTICAL);
+			attributeBox->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+			attributeBox->setNumMinorWidgets(2);
+			
+			/* Create a toggle button to enable attribute color mapping: */
+			GLMotif::Margin* useAttributeMapMargin=new GLMotif::Margin("UseAttributeMapMargin",attributeBox,false);
+			useAttributeMapMargin->setAlignment(GLMotif::Alignment(GLMotif::Alignment::LEFT,GLMotif::Alignment::VCENTER));
+			
+			std::string useAttributeMapLabel="Color by ";
+			useAttributeMapLabel.append(colorAttributeName);
+			GLMotif::ToggleButton* useAttributeMapToggle=new GLMotif::ToggleButton("UseAttributeMapToggle",useAttributeMapMargin,useAttributeMapLabel.c_str());
+			useAttributeMapToggle->setBorderWidth(0.0f);
+			useAttributeMapToggle->setHAlignment(GLFont::Left);
+			useAttributeMapToggle->track(useAttributeMap);
+			
+			useAttributeMapMargin->manageChild();
+			
+			/* Create a box with a pair of sliders to select the range of attribute values spread over the color map: */
+			GLMotif::RowColumn* attributeRangeBox=new GLMotif::RowColumn("AttributeRangeBox",attributeBox,false);
+			attributeRangeBox->setOrientation(GLMotif::RowColumn::VERTICAL);
+			attributeRangeBox->setNumMinorWidgets(2);
+			
+			double valueStep=(colorAttributeRange[1]-colorAttributeRange[0])/255.0;
+			new GLMotif::Label("AttributeMinLabel",attributeRangeBox,"Minimum");
+			
+			GLMotif::TextFieldSlider* attributeMinSlider=new GLMotif::TextFieldSlider("AttributeMinSlider",attributeRangeBox,8,ss.fontHeight*10.0f);
+			attributeMinSlider->getTextField()->setFloatFormat(GLMotif::TextField::SMART);
+			attributeMinSlider->getTextField()->setFieldWidth(8);
+			attributeMinSlider->getTextField()->setPrecision(6);
+			attributeMinSlider->setValueRange(colorAttributeRange[0],colorAttributeRange[1],valueStep);
+			attributeMinSlider->track(attributeMapRange[0]);
+			
+			new GLMotif::Label("AttributeMaxLabel",attributeRangeBox,"Maximum");
+			
+			GLMotif::TextFieldSlider* attributeMaxSlider=new GLMotif::TextFieldSlider("AttributeMaxSlider",attributeRangeBox,8,ss.fontHeight*10.0f);
+			attributeMaxSlider->getTextField()->setFloatFormat(GLMotif::TextField::SMART);
+			attributeMaxSlider->getTextField()->setFieldWidth(8);
+			attributeMaxSlider->getTextField()->setPrecision(6);
+			attributeMaxSlider->setValueRange(colorAttributeRange[0],colorAttributeRange[1],valueStep);
+			attributeMaxSlider->track(attributeMapRange[1]);
+			
+			attributeRangeBox->manageChild();
+			
+			attributeBox->manageChild();
+			}
 		}
 	
 	/* Create a page with plane setting: */
@@ -1019,6 +1219,40 @@ GLMotif::PopupWindow* LidarViewer::createInteractionDialog(void)
 	return interactionDialog;
 	}
 
+GLMotif::PopupWindow* LidarViewer::createStatisticsDialog(void)
+	{
+	GLMotif::PopupWindow* statisticsDialog=new GLMotif::PopupWindow("StatisticsDialog",Vrui::getWidgetManager(),"Performance Statistics");
+	statisticsDialog->setCloseButton(true);
+	statisticsDialog->setResizableFlags(false,false);
+	statisticsDialog->popDownOnClose();
+	
+	GLMotif::RowColumn* statistics=new GLMotif::RowColumn("Statistics",statisticsDialog,false);
+	statistics->setOrientation(GLMotif::RowColumn::VERTICAL);
+	statistics->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	statistics->setNumMinorWidgets(2);
+	
+	/* Create a label and a read-only text field for each value: */
+	static const char* statisticsNames[numStatistics]=
+		{
+		"Rendered Nodes","Rendered Points","Cache Misses","Cache Bypasses","Bypassed Points","Occluded Nodes",
+		"GPU Frame Time (ms)","Queued Requests","Node Load Time (ms)","Read Rate (MB/s)","Resident Nodes"
+		};
+	for(int i=0;i<numStatistics;++i)
+		{
+		char widgetName[32];
+		snprintf(widgetName,sizeof(widgetName),"StatisticsLabel%d",i);
+		new GLMotif::Label(widgetName,statistics,statisticsNames[i]);
+		
+		snprintf(widgetName,sizeof(widgetName),"StatisticsField%d",i);
+		statisticsFields[i]=new GLMotif::TextField(widgetName,statistics,20);
+		statisticsFields[i]->setHAlignment(GLFont::Right);
+		}
+	
+	statistics->manageChild();
+	
+	return statisticsDialog;
+	}
+
 void LidarViewer::updateTexturePlane(const PlanePrimitive* plane)
 	{
 	/* Update the texture plane: */
@@ -1036,27 +1270,85 @@ void LidarViewer::updateTexturePlane(const PlanePrimitive* plane)
 	#endif
 	}
 
+namespace {
+
+/************************************************************
+Helper functions to extract primitives and refine their fits:
+************************************************************/
+
+template <class PrimitiveParam>
+inline PrimitiveParam* createPrimitive(const LidarOctree* octree,const Primitive::Vector& translation,size_t maxNumFitPoints) // Extracts a primitive of some type from the selected points of the given octree
+	{
+	return new PrimitiveParam(octree,translation);
+	}
+
+template <>
+inline SpherePrimitive* createPrimitive<SpherePrimitive>(const LidarOctree* octree,const Primitive::Vector& translation,size_t maxNumFitPoints)
+	{
+	return new SpherePrimitive(octree,translation,maxNumFitPoints);
+	}
+
+template <>
+inline CylinderPrimitive* createPrimitive<CylinderPrimitive>(const LidarOctree* octree,const Primitive::Vector& translation,size_t maxNumFitPoints)
+	{
+	return new CylinderPrimitive(octree,translation,maxNumFitPoints);
+	}
+
+template <class PrimitiveParam>
+inline PrimitiveRefiner* createRefiner(PrimitiveParam* primitive,const LidarOctree* octree,PrimitiveRefiner::FinishedFunction finishedFunction,void* finishedFunctionArg) // Starts refining the given primitive against all selected points of the given octree if it was fitted to a subset; returns null otherwise
+	{
+	return 0;
+	}
+
+template <>
+inline PrimitiveRefiner* createRefiner<SpherePrimitive>(SpherePrimitive* primitive,const LidarOctree* octree,PrimitiveRefiner::FinishedFunction finishedFunction,void* finishedFunctionArg)
+	{
+	return primitive->isSubsampled()?new PrimitiveFitRefiner<SpherePrimitive>(primitive,octree,finishedFunction,finishedFunctionArg):0;
+	}
+
+template <>
+inline PrimitiveRefiner* createRefiner<CylinderPrimitive>(CylinderPrimitive* primitive,const LidarOctree* octree,PrimitiveRefiner::FinishedFunction finishedFunction,void* finishedFunctionArg)
+	{
+	return primitive->isSubsampled()?new PrimitiveFitRefiner<CylinderPrimitive>(primitive,octree,finishedFunction,finishedFunctionArg):0;
+	}
+
+}
+
 template <class PrimitiveParam>
 inline PrimitiveParam* LidarViewer::extractPrimitive(void)
 	{
 	PrimitiveParam* primitive=0;
+	bool refining=false;
+	PrimitiveRefiner* refiner=0;
 	if(Vrui::isHeadNode())
 		{
 		try
 			{
 			/* Extract a primitive: */
-			primitive=new PrimitiveParam(octrees[0],Primitive::Vector(offsets));
+			primitive=createPrimitive<PrimitiveParam>(octrees[0],Primitive::Vector(offsets),maxNumFitPoints);
+			
+			/* Refine the primitive against all selected points in the background if it was fitted to a subset: */
+			refiner=createRefiner<PrimitiveParam>(primitive,octrees[0],treeUpdateNotificationCB,this);
+			refining=refiner!=0;
 			
 			if(extractorPipe!=0)
 				{
 				/* Send the extracted primitive to the cluster: */
 				extractorPipe->write(int(1));
 				primitive->write(extractorPipe);
+				extractorPipe->write(int(refining?1:0));
 				extractorPipe->flush();
 				}
 			}
 		catch(const std::runtime_error& err)
 			{
+			/* Discard a partially extracted primitive: */
+			delete refiner;
+			refiner=0;
+			refining=false;
+			delete primitive;
+			primitive=0;
+			
 			if(extractorPipe!=0)
 				{
 				/* Send an error message to the cluster: */
@@ -1076,6 +1368,7 @@ inline PrimitiveParam* LidarViewer::extractPrimitive(void)
 			{
 			/* Read a primitive from the head node: */
 			primitive=new PrimitiveParam(extractorPipe);
+			refining=extractorPipe->read<int>()!=0;
 			}
 		else
 			{
@@ -1097,6 +1390,16 @@ inline PrimitiveParam* LidarViewer::extractPrimitive(void)
 			primitive->setObjectId(koinonia->createNsObject(primitiveNamespaceId,primitive->getType(),primitive));
 			}
 		#endif
+		
+		if(refining)
+			{
+			/* Remember to update the primitive when its background refinement finishes: */
+			PrimitiveRefinement pr;
+			pr.primitive=primitive;
+			pr.refiner=refiner;
+			primitiveRefinements.push_back(pr);
+			std::cout<<"Refining primitive against all selected points in the background"<<std::endl;
+			}
 		}
 	
 	return primitive;
@@ -1114,6 +1417,100 @@ int LidarViewer::addPrimitive(Primitive* newPrimitive)
 	return int(primitives.size())-1;
 	}
 
+void LidarViewer::updatePrimitiveRefinements(void)
+	{
+	std::vector<PrimitiveRefinement>::iterator prIt=primitiveRefinements.begin();
+	while(prIt!=primitiveRefinements.end())
+		{
+		/* Get the background refiner's state on the head node and share it with the cluster: */
+		unsigned char state=0;
+		std::string errorMessage;
+		if(Vrui::isHeadNode())
+			{
+			if(prIt->refiner->isFinished())
+				{
+				errorMessage=prIt->refiner->getErrorMessage();
+				if(errorMessage.empty())
+					{
+					/* Replace the primitive's preliminary fit with the refined fit: */
+					prIt->refiner->applyFit();
+					state=1;
+					}
+				else
+					state=2;
+				}
+			
+			if(Vrui::getMainPipe()!=0)
+				{
+				Vrui::getMainPipe()->write<unsigned char>(state);
+				if(state==1)
+					prIt->primitive->write(Vrui::getMainPipe());
+				else if(state==2)
+					Misc::writeCString(errorMessage.c_str(),*Vrui::getMainPipe());
+				}
+			}
+		else
+			{
+			state=Vrui::getMainPipe()->read<unsigned char>();
+			if(state==1)
+				{
+				/* Read the refined primitive from the head node: */
+				prIt->primitive->read(Vrui::getMainPipe());
+				prIt->primitive->invalidate();
+				}
+			else if(state==2)
+				{
+				char* what=Misc::readCString(*Vrui::getMainPipe());
+				errorMessage=what;
+				delete[] what;
+				}
+			}
+		
+		if(state!=0)
+			{
+			if(state==1)
+				{
+				std::cout<<"Refined primitive fitting "<<prIt->primitive->getNumPoints()<<" points"<<std::endl;
+				std::cout<<"RMS approximation residual: "<<prIt->primitive->getRms()<<std::endl;
+				
+				#if USE_COLLABORATION
+				if(koinonia!=0)
+					{
+					/* Update the refined primitive on the server: */
+					koinonia->replaceNsObject(primitiveNamespaceId,prIt->primitive->getObjectId());
+					}
+				#endif
+				}
+			else
+				{
+				/* Show an error message; the primitive keeps its preliminary fit: */
+				Misc::formattedUserError("LidarViewer: Unable to refine primitive due to exception %s",errorMessage.c_str());
+				}
+			
+			/* Release the background refiner: */
+			delete prIt->refiner;
+			prIt=primitiveRefinements.erase(prIt);
+			}
+		else
+			++prIt;
+		}
+	
+	if(Vrui::isHeadNode()&&Vrui::getMainPipe()!=0)
+		Vrui::getMainPipe()->flush();
+	}
+
+void LidarViewer::cancelPrimitiveRefinement(Primitive* primitive)
+	{
+	for(std::vector<PrimitiveRefinement>::iterator prIt=primitiveRefinements.begin();prIt!=primitiveRefinements.end();++prIt)
+		if(prIt->primitive==primitive)
+			{
+			/* Stop the background refiner: */
+			delete prIt->refiner;
+			primitiveRefinements.erase(prIt);
+			break;
+			}
+	}
+
 Primitive::DragState* LidarViewer::pickPrimitive(const Primitive::Point& pickPos)
 	{
 	/* Pick against all primitives: */
@@ -1210,11 +1607,269 @@ void LidarViewer::deletePrimitive(int primitiveIndex)
 		}
 	#endif
 	
+	cancelPrimitiveRefinement(primitives[primitiveIndex]);
 	delete primitives[primitiveIndex];
 	primitives.erase(primitives.begin()+primitiveIndex);
 	primitiveSelectedFlags.erase(primitiveSelectedFlags.begin()+primitiveIndex);
 	}
 
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+void sumStatistics(int numOctrees,LidarOctree* const* octrees,const bool* showOctrees,LidarOctree::RenderStatistics& rs,LidarOctree::LoaderStatistics& ls) // Sums up the render statistics of all visible octrees and the loader statistics of all octrees
+	{
+	for(int i=0;i<numOctrees;++i)
+		{
+		if(showOctrees[i])
+			{
+			LidarOctree::RenderStatistics ors=octrees[i]->getRenderStatistics();
+			rs.numRenderedNodes+=ors.numRenderedNodes;
+			rs.numCacheMisses+=ors.numCacheMisses;
+			rs.numCacheBypasses+=ors.numCacheBypasses;
+			rs.numRenderedPoints+=ors.numRenderedPoints;
+			rs.numBypassedPoints+=ors.numBypassedPoints;
+			rs.numOccludedNodes+=ors.numOccludedNodes;
+			}
+		
+		LidarOctree::LoaderStatistics ols=octrees[i]->getLoaderStatistics();
+		ls.numQueuedRequests+=ols.numQueuedRequests;
+		ls.numCachedNodes+=ols.numCachedNodes;
+		ls.cacheSize+=ols.cacheSize;
+		ls.numLoadedSubdivisions+=ols.numLoadedSubdivisions;
+		ls.loadTime+=ols.loadTime;
+		ls.numBytesRead+=ols.numBytesRead;
+		}
+	}
+
+}
+
+void LidarViewer::updateStatistics(double now)
+	{
+	/* Sum up the statistics of all octrees: */
+	LidarOctree::RenderStatistics rs;
+	LidarOctree::LoaderStatistics ls;
+	sumStatistics(numOctrees,octrees,showOctrees,rs,ls);
+	
+	/* Calculate loader rates over the interval since the last update: */
+	unsigned int numLoads=ls.numLoadedSubdivisions-lastNumLoadedSubdivisions;
+	double loadTime=numLoads>0?(ls.loadTime-lastLoadTime)*1000.0/double(numLoads):0.0;
+	double readRate=now>lastStatisticsTime?(double(ls.numBytesRead)-lastNumBytesRead)/((now-lastStatisticsTime)*1024.0*1024.0):0.0;
+	lastNumLoadedSubdivisions=ls.numLoadedSubdivisions;
+	lastLoadTime=ls.loadTime;
+	lastNumBytesRead=double(ls.numBytesRead);
+	lastStatisticsTime=now;
+	
+	/* Describe memory cache residency relative to the shared or the octrees' own caches: */
+	char residency[64];
+	if(cacheManager!=0)
+		snprintf(residency,sizeof(residency),"%u (%.0f of %.0f MB)",ls.numCachedNodes,double(cacheManager->getNumCachedBytes())/(1024.0*1024.0),double(cacheManager->getCacheSize())/(1024.0*1024.0));
+	else
+		snprintf(residency,sizeof(residency),"%u of %u",ls.numCachedNodes,ls.cacheSize);
+	
+	if(statisticsDialog!=0&&Vrui::getWidgetManager()->isVisible(statisticsDialog))
+		{
+		/* Update the performance dialog: */
+		statisticsFields[0]->setValue(rs.numRenderedNodes);
+		statisticsFields[1]->setValue(rs.numRenderedPoints);
+		statisticsFields[2]->setValue(rs.numCacheMisses);
+		statisticsFields[3]->setValue(rs.numCacheBypasses);
+		statisticsFields[4]->setValue(rs.numBypassedPoints);
+		statisticsFields[5]->setValue(rs.numOccludedNodes);
+		char value[32];
+		snprintf(value,sizeof(value),"%.2f",lastGpuFrameTime*1000.0);
+		statisticsFields[6]->setString(value);
+		statisticsFields[7]->setValue(ls.numQueuedRequests);
+		snprintf(value,sizeof(value),"%.2f",loadTime);
+		statisticsFields[8]->setString(value);
+		snprintf(value,sizeof(value),"%.1f",readRate);
+		statisticsFields[9]->setString(value);
+		statisticsFields[10]->setString(residency);
+		}
+	
+	if(logStatistics)
+		{
+		/* Print the statistics as a single line: */
+		Misc::formattedLogNote("LidarViewer: %u nodes, %u points, %u misses, %u bypasses, %u occluded, GPU %.2f ms, %u queued, load %.2f ms, read %.1f MB/s, resident %s",
+		                       rs.numRenderedNodes,rs.numRenderedPoints,rs.numCacheMisses,rs.numCacheBypasses,rs.numOccludedNodes,
+		                       lastGpuFrameTime*1000.0,ls.numQueuedRequests,loadTime,readRate,residency);
+		}
+	}
+
+void LidarViewer::updateBenchmark(double now,double frameGpuTime)
+	{
+	/* Start the first phase at the first frame, after all data has been loaded: */
+	if(benchmarkStartTime<0.0)
+		benchmarkStartTime=now;
+	double time=now-benchmarkStartTime;
+	
+	if(benchmarkPhase==BenchmarkWarmup&&time>benchmarkPath->getDuration())
+		{
+		/* Restart the path for the measured replay: */
+		benchmarkPhase=BenchmarkMeasure;
+		benchmarkStartTime=now;
+		time=0.0;
+		}
+	
+	/* Replay the path: */
+	Vrui::setNavigationTransformation(benchmarkPath->getNavigation(time));
+	Vrui::requestUpdate();
+	
+	if(benchmarkPhase==BenchmarkWarmup)
+		return;
+	
+	/* Record the frame's measurements: */
+	LidarOctree::RenderStatistics rs;
+	LidarOctree::LoaderStatistics ls;
+	sumStatistics(numOctrees,octrees,showOctrees,rs,ls);
+	BenchmarkFrame bf;
+	bf.time=time;
+	bf.frameTime=Vrui::getFrameTime();
+	bf.gpuFrameTime=frameGpuTime;
+	bf.numRenderedNodes=rs.numRenderedNodes;
+	bf.numRenderedPoints=rs.numRenderedPoints;
+	bf.numCacheMisses=rs.numCacheMisses;
+	bf.numQueuedRequests=ls.numQueuedRequests;
+	bf.numLoadedSubdivisions=benchmarkFrames.empty()?0:ls.numLoadedSubdivisions-benchmarkNumLoadedSubdivisions;
+	bf.settling=benchmarkPhase==BenchmarkSettle;
+	benchmarkFrames.push_back(bf);
+	benchmarkNumLoadedSubdivisions=ls.numLoadedSubdivisions;
+	
+	if(benchmarkPhase==BenchmarkMeasure&&time>benchmarkPath->getDuration())
+		{
+		/* Hold the final view until it reaches full detail: */
+		benchmarkPhase=BenchmarkSettle;
+		benchmarkQuietFrames=0;
+		}
+	else if(benchmarkPhase==BenchmarkSettle)
+		{
+		/* Count consecutive frames in which the loader was idle: */
+		if(ls.numQueuedRequests==0&&bf.numLoadedSubdivisions==0)
+			++benchmarkQuietFrames;
+		else
+			benchmarkQuietFrames=0;
+		
+		/* Finish the benchmark when the view settled or took too long to settle: */
+		double settleTime=time-benchmarkPath->getDuration();
+		const unsigned int numQuietFrames=10;
+		const double maxSettleTime=60.0;
+		if(benchmarkQuietFrames>=numQuietFrames||settleTime>=maxSettleTime)
+			{
+			/* Find the time of the first quiet frame: */
+			double timeToFullDetail=-1.0;
+			if(benchmarkQuietFrames>=numQuietFrames)
+				timeToFullDetail=benchmarkFrames[benchmarkFrames.size()-numQuietFrames].time-benchmarkPath->getDuration();
+			
+			if(Vrui::isHeadNode())
+				{
+				try
+					{
+					writeBenchmarkReport(timeToFullDetail);
+					}
+				catch(const std::runtime_error& err)
+					{
+					Misc::formattedUserError("LidarViewer: Could not write benchmark report due to exception %s",err.what());
+					}
+				}
+			
+			delete benchmarkPath;
+			benchmarkPath=0;
+			Vrui::shutdown();
+			}
+		}
+	}
+
+void LidarViewer::writeBenchmarkReport(double timeToFullDetail) const
+	{
+	FILE* reportFile=fopen(benchmarkReportFileName.c_str(),"wt");
+	if(reportFile==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot create report file %s",benchmarkReportFileName.c_str());
+	
+	/* Write one line per measured frame and accumulate a summary: */
+	fprintf(reportFile,"time,frameTime,gpuFrameTime,renderedNodes,renderedPoints,cacheMisses,queuedRequests,loadedSubdivisions,settling\n");
+	size_t numPathFrames=0;
+	double totalFrameTime=0.0;
+	double maxFrameTime=0.0;
+	double totalGpuFrameTime=0.0;
+	size_t numGpuFrames=0;
+	for(std::vector<BenchmarkFrame>::const_iterator bfIt=benchmarkFrames.begin();bfIt!=benchmarkFrames.end();++bfIt)
+		{
+		fprintf(reportFile,"%.6f,%.6f,%.6f,%u,%u,%u,%u,%u,%d\n",bfIt->time,bfIt->frameTime,bfIt->gpuFrameTime,bfIt->numRenderedNodes,bfIt->numRenderedPoints,bfIt->numCacheMisses,bfIt->numQueuedRequests,bfIt->numLoadedSubdivisions,bfIt->settling?1:0);
+		if(!bfIt->settling)
+			{
+			++numPathFrames;
+			totalFrameTime+=bfIt->frameTime;
+			if(maxFrameTime<bfIt->frameTime)
+				maxFrameTime=bfIt->frameTime;
+			if(bfIt->gpuFrameTime>0.0)
+				{
+				totalGpuFrameTime+=bfIt->gpuFrameTime;
+				++numGpuFrames;
+				}
+			}
+		}
+	
+	fclose(reportFile);
+	
+	/* Print a summary: */
+	Misc::formattedLogNote("LidarViewer: Benchmark replayed %u frames, mean frame time %.2f ms, max frame time %.2f ms, mean GPU frame time %.2f ms, time to full detail %.3f s",
+	                       (unsigned int)(numPathFrames),numPathFrames>0?totalFrameTime*1000.0/double(numPathFrames):0.0,maxFrameTime*1000.0,
+	                       numGpuFrames>0?totalGpuFrameTime*1000.0/double(numGpuFrames):0.0,timeToFullDetail);
+	}
+
+void LidarViewer::loadSession(void)
+	{
+	IO::FilePtr sessionFile=IO::openFile(sessionFileName.c_str());
+	sessionFile->setEndianness(Misc::LittleEndian);
+	
+	/* Read the navigation transformation as translation vector, scaled rotation axis, and scaling factor: */
+	if(sessionFile->read<Misc::UInt32>()!=1U)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Session file %s has unsupported format version",sessionFileName.c_str());
+	Vrui::Vector translation;
+	for(int i=0;i<3;++i)
+		translation[i]=Vrui::Scalar(sessionFile->read<Misc::Float64>());
+	Vrui::Vector scaledAxis;
+	for(int i=0;i<3;++i)
+		scaledAxis[i]=Vrui::Scalar(sessionFile->read<Misc::Float64>());
+	Vrui::Scalar scaling=Vrui::Scalar(sessionFile->read<Misc::Float64>());
+	
+	/* Only restore the session if it was saved for the same set of octrees: */
+	if(int(sessionFile->read<Misc::UInt32>())!=numOctrees)
+		return;
+	bool matches=true;
+	for(int i=0;i<numOctrees;++i)
+		matches=octrees[i]->preloadResidentNodes(*sessionFile)&&matches;
+	if(matches)
+		{
+		/* Restore the navigation transformation at the initial navigation reset: */
+		sessionNavigation=Vrui::NavTransform(translation,Vrui::Rotation::rotateScaledAxis(scaledAxis),scaling);
+		restoreSessionNavigation=true;
+		}
+	}
+
+void LidarViewer::saveSession(void) const
+	{
+	IO::FilePtr sessionFile=IO::openFile(sessionFileName.c_str(),IO::File::WriteOnly);
+	sessionFile->setEndianness(Misc::LittleEndian);
+	
+	/* Write the format version and the navigation transformation: */
+	sessionFile->write<Misc::UInt32>(1U);
+	Vrui::NavTransform nav=Vrui::getNavigationTransformation();
+	for(int i=0;i<3;++i)
+		sessionFile->write<Misc::Float64>(nav.getTranslation()[i]);
+	Vrui::Vector scaledAxis=nav.getRotation().getScaledAxis();
+	for(int i=0;i<3;++i)
+		sessionFile->write<Misc::Float64>(scaledAxis[i]);
+	sessionFile->write<Misc::Float64>(nav.getScaling());
+	
+	/* Write the nodes in memory of all octrees: */
+	sessionFile->write<Misc::UInt32>(Misc::UInt32(numOctrees));
+	for(int i=0;i<numOctrees;++i)
+		octrees[i]->saveResidentNodes(*sessionFile);
+	}
+
 void LidarViewer::updateSun(void)
 	{
 	/* Check if the sun's state changed: */
@@ -1257,32 +1912,62 @@ void LidarViewer::updateSun(void)
 
 LidarViewer::LidarViewer(int& argc,char**& argv)
 	:Vrui::Application(argc,argv),
-	 numOctrees(0),octrees(0),showOctrees(0),
+	 numOctrees(0),octrees(0),showOctrees(0),cacheManager(0),maxAutoCacheSize(0),lastCacheAdaptTime(Vrui::getApplicationTime()),
 	 coordTransform(0),
-	 renderQuality(0),fncWeight(0.5),
+	 renderQuality(0),renderQualityController(0),frameIndex(0),gpuFrameTime(0.0),
+	 fncWeight(0.5),
 	 pointSize(3.0f),
+	 useAttributeMap(false),
 	 sceneGraphRoot(new SceneGraph::DOGTransformNode),
 	 sceneGraphList(*sceneGraphRoot,*IO::Directory::getCurrent()),
 	 #if USE_COLLABORATION
 	 koinonia(0),
 	 #endif
+	 lidarFileServer(0),
 	 viewerHeadlightStates(0),sun(0),sunEnabled(false),
 	 updateTree(true),
-	 lastFrameTime(Vrui::getApplicationTime()),
+	 lastFrameTime(Vrui::getApplicationTime()),lastNavTransform(Vrui::getNavigationTransformation()),prefetchTime(0.0),
+	 statisticsInterval(1.0),logStatistics(false),collectStatistics(false),
+	 lastStatisticsTime(Vrui::getApplicationTime()),lastNumLoadedSubdivisions(0),lastLoadTime(0.0),lastNumBytesRead(0.0),lastGpuFrameTime(0.0),
+	 recordedPath(0),recordStartTime(-1.0),
+	 benchmarkPath(0),benchmarkPhase(BenchmarkMeasure),benchmarkStartTime(-1.0),benchmarkQuietFrames(0),benchmarkNumLoadedSubdivisions(0),
+	 restoreSessionNavigation(false),
 	 overrideTools(true),
 	 defaultSelectorRadius(Vrui::getGlyphRenderer()->getGlyphSize()*Vrui::Scalar(2.5)),
 	 brushColor(0.6f,0.6f,0.1f,0.5f),
 	 defaultSelectorMode(Add),
+	 surfaceHeightCache(new SurfaceHeightCache),surfaceHeightNumLoadedSubdivisions(0),
 	 neighborhoodSize(1),
 	 extractorPipe(Vrui::openPipe()),
 	 primitiveColor(0.5f,0.5f,0.1f,0.5f),
 	 selectedPrimitiveColor(0.1f,0.5f,0.5f,0.5f),
 	 lastPickedPrimitive(-1),
-	 mainMenu(0),octreeDialog(0),renderDialog(0),interactionDialog(0),
-	 dataDirectory(0)
+	 maxNumFitPoints(250000),
+	 numExtractorThreads(4),
+	 mainMenu(0),octreeDialog(0),renderDialog(0),renderQualitySlider(0),interactionDialog(0),statisticsDialog(0),
+	 dataDirectory(0),
+	 savingSelection(false),selectionSaver(0),
+	 saveSelectionProgressDialog(0),saveSelectionProgressLabel(0)
 	{
 	memCacheSize=512;
 	unsigned int gfxCacheSize=128;
+	bool persistentGfxCache=false;
+	bool occlusionCulling=false;
+	bool shareMemoryCache=true;
+	double targetGpuFrameTime=0.0;
+	unsigned int pointBudget=0;
+	double glUploadBudget=0.0;
+	bool sharedTraversal=false;
+	bool incrementalTraversal=false;
+	bool clockCoarsening=false;
+	bool serveLidarFiles=false;
+	int lidarFileServerPort=0;
+	std::string lidarFileServerInterface;
+	std::string lidarFileServerHostName;
+	bool mapDataFiles=false;
+	bool mapDataFilesOnCluster=false;
+	unsigned int numNodeLoaderThreads=1;
+	unsigned int numPreloadLevels=0;
 	try
 		{
 		/* Open LidarViewer's configuration file: */
@@ -1291,6 +1976,10 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 		
 		/* Override program settings from configuration file: */
 		renderQuality=cfg.retrieveValue<Scalar>("./renderQuality",renderQuality);
+		targetGpuFrameTime=cfg.retrieveValue<double>("./targetGpuFrameTime",targetGpuFrameTime);
+		prefetchTime=cfg.retrieveValue<double>("./prefetchTime",prefetchTime*1000.0)*0.001;
+		statisticsInterval=cfg.retrieveValue<double>("./statisticsInterval",statisticsInterval);
+		logStatistics=cfg.retrieveValue<bool>("./logStatistics",logStatistics);
 		fncWeight=cfg.retrieveValue<Scalar>("./focusAndContextWeight",fncWeight);
 		pointSize=cfg.retrieveValue<float>("./pointSize",pointSize);
 		renderSettings.pointBasedLighting=cfg.retrieveValue<bool>("./enableLighting",renderSettings.pointBasedLighting);
@@ -1308,12 +1997,34 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 		selectedPrimitiveColor=cfg.retrieveValue<Primitive::Color>("./selectedPrimitiveColor",selectedPrimitiveColor);
 		memCacheSize=cfg.retrieveValue<unsigned int>("./memoryCacheSize",memCacheSize);
 		gfxCacheSize=cfg.retrieveValue<unsigned int>("./graphicsCacheSize",gfxCacheSize);
+		persistentGfxCache=cfg.retrieveValue<bool>("./persistentGraphicsCache",persistentGfxCache);
+		occlusionCulling=cfg.retrieveValue<bool>("./occlusionCulling",occlusionCulling);
+		shareMemoryCache=cfg.retrieveValue<bool>("./shareMemoryCache",shareMemoryCache);
+		pointBudget=cfg.retrieveValue<unsigned int>("./pointBudget",pointBudget);
+		glUploadBudget=cfg.retrieveValue<double>("./graphicsUploadBudget",glUploadBudget);
+		sharedTraversal=cfg.retrieveValue<bool>("./sharedTraversal",sharedTraversal);
+		incrementalTraversal=cfg.retrieveValue<bool>("./incrementalTraversal",incrementalTraversal);
+		clockCoarsening=cfg.retrieveValue<bool>("./clockCoarsening",clockCoarsening);
+		mapDataFiles=cfg.retrieveValue<bool>("./mapDataFiles",mapDataFiles);
+		mapDataFilesOnCluster=cfg.retrieveValue<bool>("./mapDataFilesOnCluster",mapDataFilesOnCluster);
+		numNodeLoaderThreads=cfg.retrieveValue<unsigned int>("./numNodeLoaderThreads",numNodeLoaderThreads);
+		numPreloadLevels=cfg.retrieveValue<unsigned int>("./numPreloadLevels",numPreloadLevels);
+		serveLidarFiles=cfg.retrieveValue<bool>("./serveLidarFiles",serveLidarFiles);
+		lidarFileServerPort=cfg.retrieveValue<int>("./lidarFileServerPort",lidarFileServerPort);
+		lidarFileServerInterface=cfg.retrieveString("./lidarFileServerInterface",lidarFileServerInterface);
+		lidarFileServerHostName=cfg.retrieveString("./lidarFileServerHostName",lidarFileServerHostName);
+		maxNumFitPoints=size_t(cfg.retrieveValue<unsigned int>("./maxNumFitPoints",(unsigned int)(maxNumFitPoints)));
+		numExtractorThreads=cfg.retrieveValue<unsigned int>("./numExtractorThreads",numExtractorThreads);
 		}
 	catch(const std::runtime_error& err)
 		{
 		/* Just ignore the error */
 		}
 	
+	/* Read point data through memory-mapped files on a cluster if requested: */
+	if(mapDataFilesOnCluster&&Vrui::getMainPipe()!=0)
+		mapDataFiles=true;
+	
 	/* Parse the command line: */
 	for(int i=1;i<argc;++i)
 		{
@@ -1335,6 +2046,173 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 					gfxCacheSize=atoi(argv[i]);
 					}
 				}
+			else if(strcasecmp(argv[i]+1,"persistentGraphicsCache")==0)
+				persistentGfxCache=true;
+			else if(strcasecmp(argv[i]+1,"occlusionCulling")==0)
+				occlusionCulling=true;
+			else if(strcasecmp(argv[i]+1,"separateMemoryCaches")==0)
+				shareMemoryCache=false;
+			else if(strcasecmp(argv[i]+1,"pointBudget")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					pointBudget=(unsigned int)(atoi(argv[i]));
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"graphicsUploadBudget")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					glUploadBudget=atof(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"colorAttribute")==0)
+				{
+				if(i+3<argc)
+					{
+					colorAttributeName=argv[i+1];
+					colorAttributeRange[0]=atof(argv[i+2]);
+					colorAttributeRange[1]=atof(argv[i+3]);
+					i+=3;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"sharedTraversal")==0)
+				sharedTraversal=true;
+			else if(strcasecmp(argv[i]+1,"incrementalTraversal")==0)
+				incrementalTraversal=true;
+			else if(strcasecmp(argv[i]+1,"clockCoarsening")==0)
+				clockCoarsening=true;
+			else if(strcasecmp(argv[i]+1,"prefetchTime")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					prefetchTime=atof(argv[i])*0.001;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"logStatistics")==0)
+				logStatistics=true;
+			else if(strcasecmp(argv[i]+1,"trace")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					std::string traceFileName=argv[i];
+					if(Vrui::getMainPipe()!=0&&!Vrui::isHeadNode())
+						{
+						/* Give each render node's trace file a unique name: */
+						char hostName[256];
+						if(gethostname(hostName,sizeof(hostName))==0)
+							{
+							hostName[sizeof(hostName)-1]='\0';
+							traceFileName.push_back('.');
+							traceFileName.append(hostName);
+							}
+						}
+					TraceEvents::start(traceFileName.c_str());
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"recordPath")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					recordPathFileName=argv[i];
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"session")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					sessionFileName=argv[i];
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"benchmark")==0)
+				{
+				if(i+2<argc)
+					{
+					/* Read the benchmark path: */
+					delete benchmarkPath;
+					benchmarkPath=new CameraPath(argv[i+1]);
+					benchmarkReportFileName=argv[i+2];
+					i+=2;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"warmCache")==0)
+				benchmarkPhase=BenchmarkWarmup;
+			else if(strcasecmp(argv[i]+1,"mapDataFiles")==0)
+				mapDataFiles=true;
+			else if(strcasecmp(argv[i]+1,"remoteCache")==0)
+				{
+				if(i+2<argc)
+					{
+					/* Set the cache directory and size in MB for LiDAR files opened from http:// URLs: */
+					LidarSource::setRemoteCache(argv[i+1],size_t(atol(argv[i+2]))*size_t(1024*1024));
+					i+=2;
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"serveLidarFiles")==0)
+				{
+				if(i+1<argc)
+					{
+					/* Serve the local LiDAR files to collaboration peers on the given TCP port, or on any free port for 0: */
+					++i;
+					serveLidarFiles=true;
+					lidarFileServerPort=atoi(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"lidarFileServerInterface")==0)
+				{
+				if(i+1<argc)
+					{
+					/* Serve LiDAR files only on the interface with the given host name or address: */
+					++i;
+					lidarFileServerInterface=argv[i];
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"lidarFileServerHostName")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					lidarFileServerHostName=argv[i];
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"numNodeLoaderThreads")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					numNodeLoaderThreads=atoi(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"numPreloadLevels")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					numPreloadLevels=atoi(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"maxNumFitPoints")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					maxNumFitPoints=size_t(atol(argv[i]));
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"numExtractorThreads")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					numExtractorThreads=atoi(argv[i]);
+					}
+				}
 			else if(strcasecmp(argv[i]+1,"renderQuality")==0)
 				{
 				if(i+1<argc)
@@ -1343,6 +2221,14 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 					renderQuality=Scalar(atof(argv[i]));
 					}
 				}
+			else if(strcasecmp(argv[i]+1,"targetGpuFrameTime")==0)
+				{
+				if(i+1<argc)
+					{
+					++i;
+					targetGpuFrameTime=atof(argv[i]);
+					}
+				}
 			else if(strcasecmp(argv[i]+1,"focusAndContextWeight")==0)
 				{
 				if(i+1<argc)
@@ -1392,14 +2278,139 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 			++numOctrees;
 			octrees=newOctrees;
 			
+			/* Size the memory cache from the available physical memory if requested: */
+			size_t octreeCacheSize=size_t(memCacheSize)*size_t(1024*1024);
+			if(memCacheSize==0)
+				{
+				if(maxAutoCacheSize==0)
+					{
+					maxAutoCacheSize=getAutoCacheSize();
+					std::cout<<"LidarViewer: Automatic memory cache size "<<maxAutoCacheSize/(1024*1024)<<" MB"<<std::endl;
+					}
+				octreeCacheSize=maxAutoCacheSize;
+				}
+			
 			/* Load a LiDAR octree file: */
-			octrees[numOctrees-1]=new LidarOctree(argv[i],size_t(memCacheSize)*size_t(1024*1024),size_t(gfxCacheSize)*size_t(1024*1024));
+			octrees[numOctrees-1]=new LidarOctree(argv[i],octreeCacheSize,size_t(gfxCacheSize)*size_t(1024*1024),mapDataFiles,numNodeLoaderThreads);
+			octrees[numOctrees-1]->setPersistentGlCache(persistentGfxCache);
+			octrees[numOctrees-1]->setOcclusionCulling(occlusionCulling);
+			octrees[numOctrees-1]->setPointBudget(pointBudget);
+			octrees[numOctrees-1]->setGlUploadBudget(size_t(glUploadBudget*1024.0*1024.0));
+			octrees[numOctrees-1]->setSharedTraversal(sharedTraversal);
+			octrees[numOctrees-1]->setIncrementalTraversal(incrementalTraversal);
+			octrees[numOctrees-1]->setClockCoarsening(clockCoarsening);
+			if(!colorAttributeName.empty())
+				{
+				try
+					{
+					/* Store the attribute channel's values in the octree's point colors for shader-side color mapping: */
+					octrees[numOctrees-1]->setColorAttribute(colorAttributeName.c_str(),colorAttributeRange[0],colorAttributeRange[1]);
+					}
+				catch(const std::runtime_error& err)
+					{
+					Misc::formattedUserWarning("Cannot color LiDAR file %s by attribute due to exception %s",argv[i],err.what());
+					}
+				}
+			
+			/* Let all octrees compete for one memory cache instead of giving each its own; an automatically sized cache is always shared so that it can adapt as a whole: */
+			if(shareMemoryCache||maxAutoCacheSize!=0)
+				{
+				if(cacheManager==0)
+					cacheManager=new LidarCacheManager(octreeCacheSize);
+				octrees[numOctrees-1]->setCacheManager(cacheManager);
+				}
+			
+			/* Load the octree's top levels in one sequential pass for a detailed first frame: */
+			if(numPreloadLevels>0)
+				{
+				LidarOctree::PreloadStatistics ps=octrees[numOctrees-1]->preloadTopLevels(numPreloadLevels);
+				if(!ps.errorMessage.empty())
+					Misc::formattedUserWarning("Stopped preloading LiDAR file %s after %u levels due to exception %s",argv[i],ps.numPreloadedLevels,ps.errorMessage.c_str());
+				}
 			}
 		}
 	
 	if(numOctrees==0)
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No octree file name provided");
 	
+	/* Serve the local LiDAR files to collaboration peers, so that they can stream octree nodes on demand instead of copying the files first: */
+	if(serveLidarFiles&&Vrui::isHeadNode())
+		{
+		std::vector<std::string> localLidarFileNames;
+		for(std::vector<std::string>::iterator lfnIt=lidarFileNames.begin();lfnIt!=lidarFileNames.end();++lfnIt)
+			if(!LidarSource::isRemote(lfnIt->c_str()))
+				localLidarFileNames.push_back(*lfnIt);
+		if(!localLidarFileNames.empty())
+			{
+			try
+				{
+				lidarFileServer=new LidarFileServer(lidarFileServerInterface.c_str(),lidarFileServerPort,localLidarFileNames);
+				
+				/* Advertise the served files under this host's name unless another name was given: */
+				if(lidarFileServerHostName.empty())
+					{
+					char hostName[256];
+					if(gethostname(hostName,sizeof(hostName))==0)
+						{
+						hostName[sizeof(hostName)-1]='\0';
+						lidarFileServerHostName=hostName;
+						}
+					else
+						lidarFileServerHostName="localhost";
+					}
+				std::string urls;
+				for(size_t i=0;i<localLidarFileNames.size();++i)
+					{
+					if(i>0)
+						urls.push_back(' ');
+					urls.append(lidarFileServer->getUrl(lidarFileServerHostName.c_str(),i));
+					}
+				std::cout<<"LidarViewer: Serving LiDAR files at "<<urls<<std::endl;
+				#if USE_COLLABORATION
+				sharedLidarFileUrls=urls;
+				#endif
+				}
+			catch(const std::runtime_error& err)
+				{
+				Misc::formattedUserWarning("Cannot serve LiDAR files due to exception %s",err.what());
+				}
+			}
+		}
+	
+	/* Split the free graphics card memory evenly between all octrees if their graphics caches are sized automatically: */
+	if(gfxCacheSize==0)
+		for(int i=0;i<numOctrees;++i)
+			octrees[i]->setAutoGlCacheFraction(0.5/double(numOctrees));
+	
+	if(!colorAttributeName.empty())
+		{
+		/* Start out by spreading the full range of stored attribute values over the color map: */
+		useAttributeMap=true;
+		for(int i=0;i<2;++i)
+			attributeMapRange[i]=colorAttributeRange[i];
+		}
+	
+	/* Record the navigation path if requested: */
+	if(!recordPathFileName.empty())
+		recordedPath=new CameraPath;
+	
+	/* Restore the previous session if there is one: */
+	if(!sessionFileName.empty()&&access(sessionFileName.c_str(),R_OK)==0)
+		{
+		try
+			{
+			loadSession();
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"LidarViewer: Could not restore session due to exception "<<err.what()<<std::endl;
+			}
+		}
+	
+	/* Adapt the rendering quality to the target GPU frame time, given in milliseconds, if one was requested: */
+	if(targetGpuFrameTime>0.0)
+		renderQualityController=new RenderQualityController(targetGpuFrameTime*0.001,Scalar(-3),Scalar(3));
+	
 	/* Initialize all octrees: */
 	showOctrees=new bool[numOctrees];
 	for(int i=0;i<numOctrees;++i)
@@ -1414,12 +2425,11 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 	for(int i=0;i<numOctrees;++i)
 		{
 		/* Check if the LiDAR file contains a unit file: */
-		std::string unitFileName=lidarFileNames[i];
-		unitFileName.append("/Unit");
-		if(Misc::isFileReadable(unitFileName.c_str()))
+		const LidarSource& source=octrees[i]->getSource();
+		if(source.hasPart("Unit"))
 			{
 			/* Read the unit file: */
-			IO::ValueSource unit(IO::openFile(unitFileName.c_str()));
+			IO::ValueSource unit(source.openPart("Unit"));
 			unit.skipWs();
 			Vrui::Scalar unitFactor=Vrui::Scalar(unit.readNumber());
 			std::string unitName=unit.readString();
@@ -1440,13 +2450,10 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 	/* WARNING: This does not work properly for multiple octree files! */
 	for(int i=0;i<3;++i)
 		offsets[i]=double(octrees[0]->getPointOffset()[i]);
-	std::string offsetFileName=lidarFileNames[0];
-	offsetFileName.append("/Offset");
-	if(Misc::isFileReadable(offsetFileName.c_str()))
+	if(octrees[0]->getSource().hasPart("Offset"))
 		{
 		/* Read the offset file: */
-		IO::FilePtr offsetFile(IO::openFile(offsetFileName.c_str()));
-		offsetFile->setEndianness(Misc::LittleEndian);
+		IO::FilePtr offsetFile(octrees[0]->getSource().openPart("Offset"));
 		for(int i=0;i<3;++i)
 			offsets[i]-=offsetFile->read<double>();
 		}
@@ -1470,6 +2477,7 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 		octreeDialog=createOctreeDialog();
 	renderDialog=createRenderDialog();
 	interactionDialog=createInteractionDialog();
+	statisticsDialog=createStatisticsDialog();
 	
 	#if USE_COLLABORATION
 	/* Check if there is a collaboration client: */
@@ -1530,6 +2538,16 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 		/* Share the settings structure: */
 		renderSettingsId=koinonia->shareObject("LidarViewer.renderSettings",(1U<<16)+0U,renderSettingsTypes,renderSettingsType,&renderSettings,&LidarViewer::renderSettingsUpdatedCallback,this);
 		
+		/* Share the URLs of LiDAR files served by a peer, and replace them with this application's URLs if it serves its files: */
+		DataType lidarFileUrlsTypes;
+		std::string servedLidarFileUrls=sharedLidarFileUrls;
+		sharedLidarFileUrlsId=koinonia->shareObject("LidarViewer.lidarFileUrls",(1U<<16)+0U,lidarFileUrlsTypes,DataType::String,&sharedLidarFileUrls,&LidarViewer::sharedLidarFileUrlsUpdatedCallback,this);
+		if(lidarFileServer!=0)
+			{
+			sharedLidarFileUrls=servedLidarFileUrls;
+			koinonia->replaceSharedObject(sharedLidarFileUrlsId);
+			}
+		
 		/* Create a data type dictionary to share extracted primitives: */
 		Primitive::registerType(primitiveDataType);
 		PointPrimitive::registerType(primitiveDataType);
@@ -1554,6 +2572,7 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 	Vrui::getToolManager()->addAbstractClass(baseToolFactory,Vrui::ToolManager::defaultToolFactoryDestructor);
 	PointSelectorTool::initClass(baseToolFactory);
 	PrimitiveDraggerTool::initClass(baseToolFactory);
+	Vrui::getToolManager()->addClass(new ProfileToolFactory(*Vrui::getToolManager()),ProfileToolFactory::factoryDestructor);
 	
 	/* Initialize the scene graph: */
 	createSceneGraph();
@@ -1561,6 +2580,16 @@ LidarViewer::LidarViewer(int& argc,char**& argv)
 
 LidarViewer::~LidarViewer(void)
 	{
+	/* Stop saving a selection in the background: */
+	delete selectionSaver;
+	
+	/* Stop refining primitives in the background: */
+	for(std::vector<PrimitiveRefinement>::iterator prIt=primitiveRefinements.begin();prIt!=primitiveRefinements.end();++prIt)
+		delete prIt->refiner;
+	
+	delete renderQualityController;
+	delete surfaceHeightCache;
+	
 	/* Close the synchronization pipe: */
 	delete extractorPipe;
 	
@@ -1572,11 +2601,41 @@ LidarViewer::~LidarViewer(void)
 	Vrui::getSceneGraphManager()->removeNavigationalNode(*sceneGraphRoot);
 	destroySceneGraph();
 	
+	/* Write the recorded navigation path: */
+	if(recordedPath!=0&&Vrui::isHeadNode())
+		{
+		try
+			{
+			recordedPath->write(recordPathFileName.c_str());
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"LidarViewer: Could not write recorded path due to exception "<<err.what()<<std::endl;
+			}
+		}
+	delete recordedPath;
+	delete benchmarkPath;
+	
+	/* Save the session: */
+	if(!sessionFileName.empty()&&Vrui::isHeadNode())
+		{
+		try
+			{
+			saveSession();
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"LidarViewer: Could not save session due to exception "<<err.what()<<std::endl;
+			}
+		}
+	
 	/* Delete the GUI: */
 	delete mainMenu;
 	delete octreeDialog;
 	delete renderDialog;
 	delete interactionDialog;
+	delete statisticsDialog;
+	delete saveSelectionProgressDialog;
 	
 	/* Delete the viewer headlight states: */
 	delete[] viewerHeadlightStates;
@@ -1586,6 +2645,20 @@ LidarViewer::~LidarViewer(void)
 		delete octrees[i];
 	delete[] octrees;
 	delete[] showOctrees;
+	delete cacheManager;
+	
+	/* Stop serving LiDAR files to collaboration peers: */
+	delete lidarFileServer;
+	
+	/* Write the trace file after all node loader threads have shut down: */
+	try
+		{
+		TraceEvents::finish();
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"LidarViewer: Could not write trace file due to exception "<<err.what()<<std::endl;
+		}
 	}
 
 void LidarViewer::toolCreationCallback(Vrui::ToolManager::ToolCreationCallbackData* cbData)
@@ -1604,37 +2677,179 @@ void LidarViewer::toolCreationCallback(Vrui::ToolManager::ToolCreationCallbackDa
 
 void LidarViewer::frame(void)
 	{
-	#if 0
-	/* Get the current frame time and adapt the rendering quality: */
-	double fr=Vrui::getCurrentFrameTime();
-	if(fr>0.0)
+	TraceEvents::Scope traceScope("Frame","LidarViewer");
+	
+	/* Check whether performance statistics are shown or logged: */
+	collectStatistics=logStatistics||benchmarkPath!=0||Vrui::getWidgetManager()->isVisible(statisticsDialog);
+	
+	/* Retrieve the GPU frame time measured since the last frame: */
+	double frameTime;
+	{
+	Threads::Mutex::Lock gpuFrameTimeLock(gpuFrameTimeMutex);
+	frameTime=gpuFrameTime;
+	gpuFrameTime=0.0;
+	}
+	if(frameTime>0.0)
+		lastGpuFrameTime=frameTime;
+	
+	if(renderQualityController!=0)
 		{
-		fr=1.0/fr;
-		if(fr<45.0)
+		if(Vrui::getMainPipe()!=0)
 			{
-			renderQuality-=0.01f*(45.0-fr);
-			octree->setRenderQuality(renderQuality);
-			renderQualitySlider->setValue(double(renderQuality));
+			/* Adapt to the slowest node of the cluster so that all nodes render at the same quality: */
+			unsigned int frameTimeUs=(unsigned int)(frameTime*1.0e6+0.5);
+			frameTimeUs=Vrui::getMainPipe()->gather(frameTimeUs,Cluster::GatherOperation::MAX);
+			frameTime=double(frameTimeUs)*1.0e-6;
 			}
-		else if(fr>55.0)
+		
+		/* Adapt the rendering quality: */
+		if(frameTime>0.0&&renderQualityController->update(frameTime,renderQuality))
 			{
-			renderQuality+=0.01f;
-			octree->setRenderQuality(renderQuality);
-			renderQualitySlider->setValue(double(renderQuality));
+			for(int i=0;i<numOctrees;++i)
+				octrees[i]->setRenderQuality(renderQuality);
+			if(renderQualitySlider!=0)
+				renderQualitySlider->setValue(double(renderQuality));
 			}
 		}
-	#endif
+	++frameIndex;
+	
+	/* Extrapolate the navigation transformation to prefetch octree nodes that are about to come into view: */
+	double now=Vrui::getApplicationTime();
+	if(benchmarkPath!=0)
+		{
+		/* Replay the benchmark path: */
+		updateBenchmark(now,frameTime);
+		}
+	if(recordedPath!=0)
+		{
+		/* Record the current navigation transformation: */
+		if(recordStartTime<0.0)
+			recordStartTime=now;
+		recordedPath->addKeyframe(now-recordStartTime,Vrui::getNavigationTransformation());
+		}
+	Vrui::NavTransform nav=Vrui::getNavigationTransformation();
+	if(prefetchTime>0.0&&now>lastFrameTime)
+		{
+		/* Calculate the navigation change since the last frame in physical space: */
+		Vrui::NavTransform delta=nav*Geometry::invert(lastNavTransform);
+		if(Geometry::mag(delta.getTranslation())>Vrui::Scalar(0)||delta.getRotation().getAngle()>Vrui::Scalar(0)||delta.getScaling()!=Vrui::Scalar(1))
+			{
+			/* Scale the change to the prefetch interval, assuming constant linear, angular, and scaling velocities: */
+			Vrui::Scalar steps=Vrui::Scalar(prefetchTime/(now-lastFrameTime));
+			Vrui::NavTransform predictedDelta(delta.getTranslation()*steps,Vrui::Rotation::rotateScaledAxis(delta.getRotation().getScaledAxis()*steps),Math::pow(delta.getScaling(),steps));
+			
+			/* Express the predicted change in octree coordinates relative to the current view: */
+			LidarOctree::OGTransform prefetchTransform(Geometry::invert(nav)*predictedDelta*nav);
+			for(int i=0;i<numOctrees;++i)
+				octrees[i]->setPrefetchTransform(prefetchTransform);
+			}
+		else
+			{
+			/* The predicted view is the current view: */
+			for(int i=0;i<numOctrees;++i)
+				octrees[i]->disablePrefetching();
+			}
+		}
+	lastFrameTime=now;
+	lastNavTransform=nav;
+	
+	/* Update the performance statistics periodically: */
+	if(collectStatistics&&now>=lastStatisticsTime+statisticsInterval)
+		updateStatistics(now);
+	
+	/* Check on a selection being saved in the background: */
+	if(savingSelection)
+		updateSaveSelectionProgress();
+	
+	/* Check on primitives being refined in the background: */
+	if(!primitiveRefinements.empty())
+		updatePrimitiveRefinements();
+	
+	if(Vrui::isHeadNode())
+		{
+		/* Refresh the heightfield tiles around surface navigation tools when new detail was loaded: */
+		unsigned int numLoadedSubdivisions=0;
+		for(int i=0;i<numOctrees;++i)
+			numLoadedSubdivisions+=octrees[i]->getLoaderStatistics().numLoadedSubdivisions;
+		if(surfaceHeightNumLoadedSubdivisions!=numLoadedSubdivisions)
+			{
+			surfaceHeightCache->invalidate();
+			surfaceHeightNumLoadedSubdivisions=numLoadedSubdivisions;
+			}
+		
+		/* Build at most one missing or out-of-date tile per frame: */
+		surfaceHeightCache->update(octrees,numOctrees);
+		}
+	
+	/* Periodically shrink an automatically sized memory cache when other processes need memory, and let it grow back when they release it: */
+	if(maxAutoCacheSize!=0&&now>=lastCacheAdaptTime+2.0)
+		{
+		cacheManager->setCacheSize(adaptAutoCacheSize(maxAutoCacheSize,cacheManager->getNumCachedBytes()));
+		cacheManager->trim();
+		lastCacheAdaptTime=now;
+		}
 	
 	/* Prepare the next rendering pass: */
 	Point displayCenter=Point(Vrui::getInverseNavigationTransformation().transform(Vrui::getDisplayCenter()));
 	Scalar displaySize=Scalar(Vrui::getInverseNavigationTransformation().getScaling()*Vrui::getDisplaySize());
 	for(int i=0;i<numOctrees;++i)
+		{
+		/* Age hidden octrees' nodes as well when they share a memory cache, so that visible octrees can claim their memory: */
+		if(showOctrees[i]||cacheManager!=0)
+			octrees[i]->startRenderPass();
 		if(showOctrees[i])
 			{
-			octrees[i]->startRenderPass();
 			octrees[i]->setFocusAndContext(displayCenter,displaySize*Scalar(0.5),fncWeight);
 			octrees[i]->setBaseSurfelSize(renderSettings.splatSize,float(Vrui::getNavigationTransformation().getScaling()));
 			}
+		}
+	}
+
+bool LidarViewer::startTimingRendering(LidarViewer::DataItem* dataItem) const
+	{
+	/* Retrieve the results of all finished timer queries in the order in which they were issued: */
+	for(int q=0;q<DataItem::numTimerQueries;++q)
+		{
+		int index=(dataItem->nextTimerQuery+q)%DataItem::numTimerQueries;
+		if(dataItem->timerQueryPending[index])
+			{
+			GLuint resultAvailable=0;
+			dataItem->glGetQueryObjectuivProc(dataItem->timerQueryIds[index],GL_QUERY_RESULT_AVAILABLE,&resultAvailable);
+			if(resultAvailable==0)
+				break;
+			GLuint64 elapsedNs=0;
+			dataItem->glGetQueryObjectui64vProc(dataItem->timerQueryIds[index],GL_QUERY_RESULT,&elapsedNs);
+			dataItem->timerQueryPending[index]=false;
+			
+			if(dataItem->timedFrame!=dataItem->timerQueryFrames[index])
+				{
+				/* The previously timed frame is complete; report its GPU time: */
+				if(dataItem->timedFrameTime>0.0)
+					{
+					Threads::Mutex::Lock gpuFrameTimeLock(gpuFrameTimeMutex);
+					if(gpuFrameTime<dataItem->timedFrameTime)
+						gpuFrameTime=dataItem->timedFrameTime;
+					}
+				dataItem->timedFrame=dataItem->timerQueryFrames[index];
+				dataItem->timedFrameTime=0.0;
+				}
+			
+			/* Accumulate the GPU times of all rendering passes of the same frame, e.g., for both eyes of a stereo window: */
+			dataItem->timedFrameTime+=double(elapsedNs)*1.0e-9;
+			}
+		}
+	
+	/* Bail out if the next timer query is still waiting for its result: */
+	int index=dataItem->nextTimerQuery;
+	if(dataItem->timerQueryPending[index])
+		return false;
+	
+	/* Start timing the rendering pass: */
+	dataItem->glBeginQueryProc(GL_TIME_ELAPSED,dataItem->timerQueryIds[index]);
+	dataItem->timerQueryFrames[index]=frameIndex;
+	dataItem->timerQueryPending[index]=true;
+	dataItem->nextTimerQuery=(index+1)%DataItem::numTimerQueries;
+	return true;
 	}
 
 void LidarViewer::display(GLContextData& contextData) const
@@ -1653,9 +2868,10 @@ void LidarViewer::display(GLContextData& contextData) const
 	glFogf(GL_FOG_END,GLfloat(Vrui::getBackplaneDist()));
 	glFogfv(GL_FOG_COLOR,Vrui::getBackgroundColor().getRgba());
 	
+	bool mapAttribute=useAttributeMap&&!renderSettings.useTexturePlane;
 	if(renderSettings.pointBasedLighting&&octrees[0]->hasNormalVectors())
 		{
-		if(renderSettings.useTexturePlane)
+		if(renderSettings.useTexturePlane||mapAttribute)
 			glMaterial(GLMaterialEnums::FRONT_AND_BACK,GLMaterial(GLMaterial::Color(1.0f,1.0f,1.0f),renderSettings.surfaceMaterial.specular,renderSettings.surfaceMaterial.shininess));
 		else if(renderSettings.usePointColors)
 			{
@@ -1668,6 +2884,7 @@ void LidarViewer::display(GLContextData& contextData) const
 		
 		/* Enable the point-based lighting shader: */
 		dataItem->pbls.setUsePlaneDistance(renderSettings.useTexturePlane);
+		dataItem->pbls.setUseAttributeMap(mapAttribute);
 		dataItem->pbls.setUsePointColors(renderSettings.usePointColors);
 		dataItem->pbls.setUseSplatting(renderSettings.useSplatting);
 		dataItem->pbls.enable();
@@ -1693,6 +2910,17 @@ void LidarViewer::display(GLContextData& contextData) const
 			/* Bind the distance map texture: */
 			glBindTexture(GL_TEXTURE_1D,dataItem->planeColorMapTextureId);
 			}
+		else if(mapAttribute)
+			{
+			/* Map the stored range of attribute values to the selected range of the color map: */
+			double mapRange=attributeMapRange[1]>attributeMapRange[0]?attributeMapRange[1]-attributeMapRange[0]:1.0;
+			double alphaScale=(colorAttributeRange[1]-colorAttributeRange[0])/mapRange;
+			double alphaOffset=(colorAttributeRange[0]-attributeMapRange[0])/mapRange;
+			dataItem->pbls.setAttributeMap(0,alphaScale,alphaOffset);
+			
+			/* Bind the color map texture: */
+			glBindTexture(GL_TEXTURE_1D,dataItem->planeColorMapTextureId);
+			}
 		}
 	else
 		{
@@ -1739,6 +2967,11 @@ void LidarViewer::display(GLContextData& contextData) const
 		glTranslate(-fTrans);
 		}
 	
+	/* Measure the GPU time spent rendering the LiDAR point trees if the rendering quality is adapted or statistics are collected: */
+	bool timeRendering=false;
+	if((renderQualityController!=0||collectStatistics)&&dataItem->hasTimerQueryExtension)
+		timeRendering=startTimingRendering(dataItem);
+	
 	/* Render the LiDAR point tree: */
 	LidarOctree::Frustum frustum;
 	frustum.setFromGL();
@@ -1746,6 +2979,9 @@ void LidarViewer::display(GLContextData& contextData) const
 		if(showOctrees[i])
 			octrees[i]->glRenderAction(frustum,dataItem->pbls,contextData);
 	
+	if(timeRendering)
+		dataItem->glEndQueryProc(GL_TIME_ELAPSED);
+	
 	if(renderSettings.planeDistanceExaggeration!=1.0)
 		glPopMatrix();
 	
@@ -1755,7 +2991,7 @@ void LidarViewer::display(GLContextData& contextData) const
 		/* Disable the point-based lighting shader: */
 		dataItem->pbls.disable();
 		
-		if(renderSettings.useTexturePlane)
+		if(renderSettings.useTexturePlane||mapAttribute)
 			glBindTexture(GL_TEXTURE_1D,0);
 		}
 	else
@@ -1835,6 +3071,14 @@ void LidarViewer::display(GLContextData& contextData) const
 
 void LidarViewer::resetNavigation(void)
 	{
+	if(restoreSessionNavigation)
+		{
+		/* Return to the previous session's view once: */
+		Vrui::setNavigationTransformation(sessionNavigation);
+		restoreSessionNavigation=false;
+		return;
+		}
+	
 	/* Initialize the navigation transformation: */
 	Vrui::setNavigationTransformation(octrees[0]->getDomainCenter(),octrees[0]->getDomainRadius(),Vrui::Vector(0,0,1));
 	}
@@ -1941,15 +3185,23 @@ void LidarViewer::alignSurfaceFrame(Vrui::SurfaceNavigationTool::AlignmentData&
 	Scalar surfaceZ=base[2];
 	if(Vrui::isHeadNode())
 		{
-		/* Drop a sphere onto the LiDAR point cloud: */
-		base[2]+=alignmentData.probeSize+alignmentData.maxClimb;
-		FallingSphereProcessor fsp(base,alignmentData.probeSize);
-		for(int i=0;i<numOctrees;++i)
-			octrees[i]->processPointsInBox(fsp.getBox(),fsp);
-		
-		/* Get the surface elevation: */
-		if(fsp.getMinZ()!=Math::Constants<Scalar>::min)
-			surfaceZ=fsp.getMinZ()-alignmentData.probeSize;
+		/* Look up the surface elevation in the cached heightfield at the probe's resolution: */
+		surfaceHeightCache->setCellSize(Scalar(alignmentData.probeSize));
+		Scalar cachedZ;
+		if(surfaceHeightCache->getHeight(Point(base),cachedZ)&&cachedZ<=Scalar(base[2]+alignmentData.maxClimb))
+			surfaceZ=cachedZ;
+		else
+			{
+			/* Drop a sphere onto the LiDAR point cloud where the cache has no data yet, or where the highest points are out of climbing reach, e.g., under overhangs: */
+			base[2]+=alignmentData.probeSize+alignmentData.maxClimb;
+			FallingSphereProcessor fsp(base,alignmentData.probeSize);
+			for(int i=0;i<numOctrees;++i)
+				octrees[i]->processPointsInBox(fsp.getBox(),fsp);
+			
+			/* Get the surface elevation: */
+			if(fsp.getMinZ()!=Math::Constants<Scalar>::min)
+				surfaceZ=fsp.getMinZ()-alignmentData.probeSize;
+			}
 		
 		if(Vrui::getMainPipe()!=0)
 			{
@@ -2315,6 +3567,7 @@ void LidarViewer::clearPrimitivesCallback(Misc::CallbackData* cbData)
 			}
 		#endif
 		
+		cancelPrimitiveRefinement(*pIt);
 		delete *pIt;
 		}
 	primitives.clear();
@@ -2346,6 +3599,12 @@ void LidarViewer::showInteractionDialogCallback(Misc::CallbackData* cbData)
 	Vrui::popupPrimaryWidget(interactionDialog);
 	}
 
+void LidarViewer::showStatisticsDialogCallback(Misc::CallbackData* cbData)
+	{
+	/* Open the statistics dialog: */
+	Vrui::popupPrimaryWidget(statisticsDialog);
+	}
+
 void LidarViewer::showSceneGraphListCallback(Misc::CallbackData* cbData)
 	{
 	/* Create and open the scene graph list: */
@@ -1,6 +1,6 @@
 /***********************************************************************
 LidarViewer - Viewer program for multiresolution LiDAR data.
-Copyright (c) 2005-2025 Oliver Kreylos
+Copyright (c) 2005-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -29,9 +29,11 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Misc/SizedTypes.h>
 #include <Misc/RGBA.h>
 #include <Misc/CallbackData.h>
+#include <Threads/Mutex.h>
 #include <IO/Directory.h>
 #include <Geometry/Plane.h>
 #include <GL/gl.h>
+#include <GL/glext.h>
 #include <GL/GLMaterial.h>
 #include <GL/GLObject.h>
 #ifdef LIDARVIEWER_VISUALIZE_WATER
@@ -64,6 +66,8 @@ class MulticastPipe;
 namespace GLMotif {
 class PopupMenu;
 class PopupWindow;
+class Label;
+class TextField;
 }
 namespace Vrui {
 class InputDevice;
@@ -72,6 +76,13 @@ class AffineCoordinateTransform;
 }
 
 class LidarOctree;
+class CameraPath;
+class LidarSelectionSaver;
+class PrimitiveRefiner;
+class RenderQualityController;
+class SurfaceHeightCache;
+class LidarCacheManager;
+class LidarFileServer;
 class PlanePrimitive;
 
 /* Namespace shortcuts: */
@@ -90,6 +101,28 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 		Add,Subtract
 		};
 	
+	enum BenchmarkPhase // Enumerated type for phases of a benchmark replay
+		{
+		BenchmarkWarmup, // Replaying the path once without measurements to warm up the caches
+		BenchmarkMeasure, // Replaying the path while measuring each frame
+		BenchmarkSettle // Holding the final view until all nodes are loaded
+		};
+	
+	struct BenchmarkFrame // Structure for measurements of a single frame during a benchmark replay
+		{
+		/* Elements: */
+		public:
+		double time; // Time since the start of the measured replay in seconds
+		double frameTime; // Time since the previous frame in seconds
+		double gpuFrameTime; // GPU frame time reported during the frame in seconds, or 0 if none was reported
+		unsigned int numRenderedNodes; // Number of nodes rendered in the most recent rendering pass
+		unsigned int numRenderedPoints; // Number of points rendered in the most recent rendering pass
+		unsigned int numCacheMisses; // Number of graphics cache misses in the most recent rendering pass
+		unsigned int numQueuedRequests; // Number of pending subdivision requests
+		unsigned int numLoadedSubdivisions; // Number of subdivisions loaded since the previous frame
+		bool settling; // Flag whether the frame was recorded after the end of the path
+		};
+	
 	class ProjectorTool; // Class for transformer tools projecting a ray-based input device onto a LiDAR point cloud
 	class PointSelectorTool; // Class for tools to select/deselect points
 	class PrimitiveDraggerTool; // Class for tools to select/deselect and drag primitives
@@ -99,10 +132,19 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	friend class PointSelectorTool;
 	friend class PrimitiveDraggerTool;
 	friend class ProfileExtractorTool;
+	friend class ProfileTool;
 	
 	typedef std::vector<PointSelectorTool*> PointSelectorToolList;
 	typedef std::vector<Primitive*> PrimitiveList;
 	
+	struct PrimitiveRefinement // Structure for primitives whose fits are being refined in the background
+		{
+		/* Elements: */
+		public:
+		Primitive* primitive; // The primitive being refined
+		PrimitiveRefiner* refiner; // The background refiner; only exists on the head node
+		};
+	
 	struct RenderSettings // Structure holding environment-independent rendering settings
 		{
 		/* Elements: */
@@ -133,6 +175,20 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 		GLuint influenceSphereDisplayListId; // ID of display list to render transparent spheres
 		GLuint planeColorMapTextureId; // Texture object ID of texture plane color map
 		PointBasedLightingShader pbls; // Shader for point-based lighting
+		static const int numTimerQueries=4; // Number of timer queries in flight to measure GPU frame times without stalling
+		bool hasTimerQueryExtension; // Flag if timer queries are supported
+		PFNGLGENQUERIESPROC glGenQueriesProc;
+		PFNGLDELETEQUERIESPROC glDeleteQueriesProc;
+		PFNGLBEGINQUERYPROC glBeginQueryProc;
+		PFNGLENDQUERYPROC glEndQueryProc;
+		PFNGLGETQUERYOBJECTUIVPROC glGetQueryObjectuivProc;
+		PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64vProc;
+		GLuint timerQueryIds[numTimerQueries]; // Ring buffer of timer query objects measuring the GPU time spent rendering octrees
+		unsigned int timerQueryFrames[numTimerQueries]; // Indices of the frames measured by the timer queries
+		bool timerQueryPending[numTimerQueries]; // Flags whether the timer queries' results have not been retrieved yet
+		int nextTimerQuery; // Index of the next timer query to issue, which is also the oldest pending one
+		unsigned int timedFrame; // Index of the frame whose GPU times are currently being accumulated
+		double timedFrameTime; // Accumulated GPU time of all rendering passes of the timed frame in this context
 		#ifdef LIDARVIEWER_VISUALIZE_WATER
 		GLhandleARB waterShader; // Shader to generate a water-like texture on-the-fly
 		#endif
@@ -143,17 +199,28 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 		};
 	
 	/* Elements: */
-	unsigned int memCacheSize; // Memory cache size for the LiDAR data representation in MB
+	unsigned int memCacheSize; // Memory cache size for the LiDAR data representation in MB, or 0 to size the cache from available physical memory
 	std::vector<std::string> lidarFileNames; // Array of file names from with the octrees were loaded
 	int numOctrees; // Number of LiDAR octrees rendered in parallel
 	LidarOctree** octrees; // Array of LiDAR data representations rendered in parallel
 	bool* showOctrees; // Array of flags to disable individual LiDAR data representations
+	LidarCacheManager* cacheManager; // Memory cache shared by all octrees, or 0 if each octree has its own cache
+	size_t maxAutoCacheSize; // Upper limit for the size of the shared memory cache in bytes if it is sized automatically, or 0 if its size is fixed
+	double lastCacheAdaptTime; // Application time of the last adaptation of an automatically sized memory cache to memory pressure
 	double offsets[3]; // Coordinate offsets that need to be added to points stored in the octree(s) to reconstruct original point positions
 	Vrui::AffineCoordinateTransform* coordTransform; // Pointer to a coordinate transformation to undo point offsets and handle vertical exaggeration
 	Scalar renderQuality; // The current rendering quality (adapted to achieve optimal frame rate)
+	RenderQualityController* renderQualityController; // Controller adapting the rendering quality to a target GPU frame time, or 0 if the quality is fixed
+	unsigned int frameIndex; // Index of the current frame, to attribute GPU time measurements to frames
+	mutable Threads::Mutex gpuFrameTimeMutex; // Mutex protecting the measured GPU frame time
+	mutable double gpuFrameTime; // Largest GPU frame time measured in any OpenGL context since the last frame, or 0 if there are no new measurements
 	Scalar fncWeight; // Weight factor for focus+context LOD adjustment
 	float pointSize; // The pixel size used to render LiDAR points
 	RenderSettings renderSettings; // Environment-independent rendering settings
+	std::string colorAttributeName; // Name of the attribute channel whose values are stored in the octrees' point colors, or empty
+	double colorAttributeRange[2]; // Range of attribute values stored in the octrees' point colors
+	bool useAttributeMap; // Flag whether to color illuminated points by mapping their attribute values through the color map
+	double attributeMapRange[2]; // Range of attribute values spread over the color map
 	SceneGraph::DOGTransformNodePointer sceneGraphRoot; // Common root node for additional scene graphs
 	SceneGraph::SceneGraphList sceneGraphList; // Dynamic list of additionally loaded scene graphs
 	#if USE_COLLABORATION
@@ -161,12 +228,42 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	KoinoniaProtocol::ObjectID renderSettingsId; // Koinonia ID to share rendering settings
 	DataType primitiveDataType; // Data type dictionary to share extracted primitives
 	KoinoniaProtocol::NamespaceID primitiveNamespaceId; // ID for the namespace to share extracted primitives
+	std::string sharedLidarFileUrls; // Space-separated URLs under which a collaboration peer serves its LiDAR files, or empty
+	KoinoniaProtocol::ObjectID sharedLidarFileUrlsId; // Koinonia ID to share the URLs of served LiDAR files
 	#endif
+	LidarFileServer* lidarFileServer; // Server streaming the local LiDAR files to collaboration peers, or 0
 	bool* viewerHeadlightStates; // Enable states of all viewers' headlights at the last time the sun light source was turned on
 	Vrui::Lightsource* sun; // Light source representing the sun
 	bool sunEnabled; // Flag whether the sun light source is currently enabled
 	bool updateTree; // Flag if the tree is continuously updated
 	double lastFrameTime; // Application time of last frame; used to calculate render performance
+	Vrui::NavTransform lastNavTransform; // Navigation transformation at the last frame, to extrapolate navigation for prefetching
+	double prefetchTime; // Time in seconds by which to extrapolate navigation to prefetch octree nodes, or 0 to disable prefetching
+	double statisticsInterval; // Interval in seconds between updates of the performance statistics
+	bool logStatistics; // Flag whether to print the performance statistics at every update
+	bool collectStatistics; // Flag whether performance statistics are currently shown or logged
+	double lastStatisticsTime; // Application time of the last performance statistics update
+	unsigned int lastNumLoadedSubdivisions; // Total number of subdivisions loaded by all octrees at the last update
+	double lastLoadTime; // Total time spent loading subdivisions in all octrees at the last update
+	double lastNumBytesRead; // Total number of bytes read by all octrees' node loaders at the last update
+	double lastGpuFrameTime; // Most recent GPU frame time measured in any OpenGL context
+	
+	/* Navigation recording and benchmarking state: */
+	std::string recordPathFileName; // Name of the file to which to write the recorded navigation path on exit, or empty
+	CameraPath* recordedPath; // Navigation path being recorded, or 0
+	double recordStartTime; // Application time at which path recording started, or negative before the first frame
+	CameraPath* benchmarkPath; // Navigation path being replayed as a benchmark, or 0
+	std::string benchmarkReportFileName; // Name of the file to which to write the per-frame benchmark report
+	BenchmarkPhase benchmarkPhase; // Current phase of the benchmark
+	double benchmarkStartTime; // Application time at which the current benchmark phase started, or negative before the first frame
+	unsigned int benchmarkQuietFrames; // Number of consecutive frames without pending or newly loaded subdivisions while settling
+	unsigned int benchmarkNumLoadedSubdivisions; // Total number of subdivisions loaded by all octrees at the previous benchmark frame
+	std::vector<BenchmarkFrame> benchmarkFrames; // Measurements of all frames since the start of the measured replay
+	
+	/* Session state: */
+	std::string sessionFileName; // Name of the file from which to restore the previous session on start and to which to save the session on exit, or empty
+	bool restoreSessionNavigation; // Flag whether the next navigation reset restores the previous session's navigation transformation
+	Vrui::NavTransform sessionNavigation; // Navigation transformation of the previous session
 	
 	/* Interaction state: */
 	bool overrideTools; // Flag whether interaction settings changes influence existing tools
@@ -174,6 +271,8 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	Misc::RGBA<Misc::Float32> brushColor; // Color to render selection brush, with transparency
 	SelectorMode defaultSelectorMode; // Selection mode for new selector locators
 	PointSelectorToolList pointSelectorTools; // List of currently existing point selector tools
+	SurfaceHeightCache* surfaceHeightCache; // Cache of heightfield tiles to align surface navigation tools
+	unsigned int surfaceHeightNumLoadedSubdivisions; // Total number of subdivisions loaded by all octrees when the heightfield tiles were last refreshed
 	Scalar neighborhoodSize; // Size of neighborhood for point classification
 	Cluster::MulticastPipe* extractorPipe; // Pipe to synchronize feature extraction on a distributed rendering cluster
 	Primitive::Color primitiveColor; // Color to render primitives, with transparency
@@ -181,15 +280,28 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	PrimitiveList primitives; // List of extracted primitives
 	int lastPickedPrimitive; // Index of the most recently picked primitive
 	std::vector<bool> primitiveSelectedFlags; // List of selected flags for extracted primitives
+	size_t maxNumFitPoints; // Maximum number of selected points to which spheres and cylinders are fitted directly; larger selections are fitted to a subset first and then refined in the background
+	std::vector<PrimitiveRefinement> primitiveRefinements; // List of primitives currently being refined in the background
+	unsigned int numExtractorThreads; // Number of threads used to extract profiles from the point cloud
 	
 	/* Vrui state: */
 	GLMotif::PopupMenu* mainMenu; // The program's main menu
 	GLMotif::RadioBox* mainMenuSelectorModes;
 	GLMotif::PopupWindow* octreeDialog; // The dialog to select individual octrees
 	GLMotif::PopupWindow* renderDialog; // The rendering settings dialog
+	GLMotif::TextFieldSlider* renderQualitySlider; // Slider showing the current rendering quality
 	GLMotif::PopupWindow* interactionDialog; // The interaction settings dialog
+	GLMotif::PopupWindow* statisticsDialog; // The rendering and loader performance dialog
+	static const int numStatistics=11; // Number of values shown in the performance dialog
+	GLMotif::TextField* statisticsFields[numStatistics]; // Text fields showing the values in the performance dialog
 	GLMotif::RadioBox* interactionDialogSelectorModes;
 	IO::DirectoryPtr dataDirectory; // Last directory from/to which selections or primitives were loaded/saved
+	bool savingSelection; // Flag whether a selection snapshot is currently being saved in the background
+	LidarSelectionSaver* selectionSaver; // Background saver for the current selection snapshot; only exists on the head node
+	std::string savingSelectionPath; // Path of the selection file currently being saved
+	IO::DirectoryPtr savingSelectionDirectory; // Directory containing the selection file currently being saved
+	GLMotif::PopupWindow* saveSelectionProgressDialog; // Dialog showing the progress of the current background save
+	GLMotif::Label* saveSelectionProgressLabel; // Label showing the number of saved points
 	
 	/* Private methods: */
 	void changeSelectorModeCallback(GLMotif::RadioBox::ValueChangedCallbackData* cbData);
@@ -197,6 +309,7 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	void classifySelectionCallback(Misc::CallbackData* cbData);
 	void saveSelectionOKCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData);
 	void saveSelectionCallback(Misc::CallbackData* cbData);
+	void updateSaveSelectionProgress(void); // Updates the progress of a background selection save and finishes it once it is complete
 	void clearSelectionCallback(Misc::CallbackData* cbData);
 	GLMotif::PopupMenu* createSelectionMenu(void);
 	GLMotif::PopupMenu* createExtractionMenu(void);
@@ -211,6 +324,7 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	void distanceExaggerationSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
 	#if USE_COLLABORATION
 	static void renderSettingsUpdatedCallback(KoinoniaClient* client,KoinoniaProtocol::ObjectID id,void* object,void* userData);
+	static void sharedLidarFileUrlsUpdatedCallback(KoinoniaClient* client,KoinoniaProtocol::ObjectID id,void* object,void* userData);
 	static void* createPrimitiveFunction(KoinoniaClient* client,KoinoniaProtocol::NamespaceID namespaceId,DataType::TypeID type,void* userData);
 	static void primitiveCreatedCallback(KoinoniaClient* client,KoinoniaProtocol::NamespaceID namespaceId,KoinoniaProtocol::ObjectID objectId,void* object,void* userData);
 	static void primitiveReplacedCallback(KoinoniaClient* client,KoinoniaProtocol::NamespaceID namespaceId,KoinoniaProtocol::ObjectID objectId,KoinoniaProtocol::VersionNumber newVersion,void* object,void* userData);
@@ -218,6 +332,7 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	#endif
 	GLMotif::PopupWindow* createRenderDialog(void);
 	GLMotif::PopupWindow* createInteractionDialog(void);
+	GLMotif::PopupWindow* createStatisticsDialog(void);
 	static void treeUpdateNotificationCB(void* userData)
 		{
 		Vrui::requestUpdate();
@@ -226,6 +341,9 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	template <class PrimitiveParam>
 	PrimitiveParam* extractPrimitive(void); // Extracts a primitive of some type from the octree
 	int addPrimitive(Primitive* newPrimitive); // Adds a primitive to the list; returns the index of the newly added primitive
+	void updatePrimitiveRefinements(void); // Applies the results of finished background refinements to their primitives
+	bool startTimingRendering(DataItem* dataItem) const; // Collects finished GPU time measurements in the given OpenGL context and starts timing its next rendering pass; returns false if no timer query is available
+	void cancelPrimitiveRefinement(Primitive* primitive); // Stops refining the given primitive in the background before it is destroyed
 	Primitive::DragState* pickPrimitive(const Primitive::Point& pickPos); // Picks the list of extracted primitives and returns a pick result, or null if there was no valid picl
 	void dragPrimitive(Primitive::DragState* dragState,const Primitive::Point& dragPos); // Drags the primitive associated with the given pick result
 	void togglePrimitive(Primitive* primitive); // Toggles the selection state of the given primitive
@@ -233,6 +351,11 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	void deselectPrimitive(int primitiveIndex); // Deselects the given primitive
 	void deletePrimitive(int primitiveIndex); // Deletes the given primitive from the list
 	void updateSun(void); // Updates the state of the sun light source
+	void updateStatistics(double now); // Updates the performance dialog and prints the performance statistics if requested
+	void updateBenchmark(double now,double frameGpuTime); // Advances the benchmark replay and records the current frame's measurements
+	void writeBenchmarkReport(double timeToFullDetail) const; // Writes the recorded benchmark frames to the report file
+	void loadSession(void); // Reads the session file and starts preloading the octree nodes that were in memory at the end of the previous session
+	void saveSession(void) const; // Writes the navigation transformation and the octree nodes currently in memory to the session file
 	
 	/* Constructors and destructors: */
 	public:
@@ -269,6 +392,7 @@ class LidarViewer:public Vrui::Application,public Vrui::TransparentObject,public
 	void octreeSelectionCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData,const int& octreeIndex);
 	void showRenderDialogCallback(Misc::CallbackData* cbData);
 	void showInteractionDialogCallback(Misc::CallbackData* cbData);
+	void showStatisticsDialogCallback(Misc::CallbackData* cbData);
 	void showSceneGraphListCallback(Misc::CallbackData* cbData);
 	void overrideToolsCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 	void brushSizeSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
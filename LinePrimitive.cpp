@@ -1,7 +1,7 @@
 /***********************************************************************
 LinePrimitive - Class for lines extracted from point clouds by
 intersecting two plane primitives.
-Copyright (c) 2008-2020 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -31,8 +31,6 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Math/Constants.h>
 #include <Math/Matrix.h>
 #include <Geometry/AffineCombiner.h>
-#include <Geometry/Box.h>
-#include <Geometry/PCACalculator.h>
 #include <Geometry/OutputOperators.h>
 #include <GL/gl.h>
 #include <GL/GLColorTemplates.h>
@@ -64,60 +62,6 @@ namespace {
 Helper classes:
 **************/
 
-class LidarLineExtractor
-	{
-	/* Embedded classes: */
-	public:
-	typedef Geometry::Point<double,3> Point; // Type for points
-	typedef Geometry::Vector<double,3> Vector; // Type for vectors
-	typedef Geometry::Box<double,3> Box; // Type for bounding boxes
-	
-	/* Elements: */
-	private:
-	Box bb; // Bounding box of all processed points
-	Geometry::PCACalculator<3> pca; // Helper object to accumulate the points' covariance matrix and calculate their PCA
-	
-	/* Constructors and destructors: */
-	public:
-	LidarLineExtractor(void)
-		:bb(Box::empty)
-		{
-		};
-	
-	/* Methods: */
-	void operator()(const LidarPoint& lp) // Process the given LiDAR point
-		{
-		/* Add the node point to the bounding box: */
-		bb.addPoint(lp);
-		
-		/* Add the point to the PCA calculator: */
-		pca.accumulatePoint(lp);
-		};
-	size_t getNumPoints(void) const // Returns the number of processed points
-		{
-		return pca.getNumPoints();
-		}
-	const Box& getBB(void) const // Returns the processed points' bounding box
-		{
-		return bb;
-		};
-	void calcLine(Point& centroid,Vector& axis) // Returns the least-squares line
-		{
-		/* Calculate the processed points' centroid: */
-		centroid=pca.calcCentroid();
-		
-		/* Calculate the point set's covariance matrix: */
-		pca.calcCovariance();
-		
-		/* Calculate the covariance matrix' eigenvalues: */
-		double evs[3];
-		pca.calcEigenvalues(evs);
-		
-		/* Get the "longest" eigenvector: */
-		axis=pca.calcEigenvector(evs[0]);
-		};
-	};
-
 class LidarLineFitter
 	{
 	/* Embedded classes: */
@@ -180,25 +124,24 @@ class LidarLineFitter
 
 LinePrimitive::LinePrimitive(const LidarOctree* octree,const Vector& translation)
 	{
-	/* Create a LiDAR line extractor: */
-	LidarLineExtractor lle;
+	/* Get the moments of the selected points, which the octree maintains while points are selected and deselected: */
+	SelectionMoments moments=octree->getSelectionMoments();
 	
-	/* Process all selected points: */
-	octree->processSelectedPoints(lle);
-	
-	if(lle.getNumPoints()>=2)
+	if(moments.getNumPoints()>=2)
 		{
-		/* Extract the line's coordinate frame: */
-		LidarLineExtractor::Point centroid;
-		LidarLineExtractor::Vector laxis;
-		lle.calcLine(centroid,laxis);
+		/* Extract the line's coordinate frame from the "longest" principal axis: */
+		SelectionMoments::Point centroid=moments.calcCentroid();
+		double evs[3];
+		SelectionMoments::Vector evecs[3];
+		moments.calcPrincipalAxes(evs,evecs);
+		SelectionMoments::Vector laxis=evecs[0];
 		
 		/* Calculate the bounding interval of the selected points in line coordinates: */
 		LidarLineFitter llf(centroid,laxis);
 		octree->processSelectedPoints(llf);
 		
 		/* Store the number of points and the RMS residual: */
-		numPoints=Misc::UInt64(lle.getNumPoints());
+		numPoints=Misc::UInt64(moments.getNumPoints());
 		rms=Scalar(llf.getRMS());
 		
 		/* Initialize the extracted line primitive's extents: */
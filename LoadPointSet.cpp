@@ -1,7 +1,7 @@
 /***********************************************************************
 LoadPointSet - Helper function to load a 2D point set into LiDAR Viewer
 by elevating the points to the implicit LiDAR point cloud surface.
-Copyright (c) 2010-2021 Oliver Kreylos
+Copyright (c) 2010-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -55,6 +55,9 @@ void loadPointSet(const char* lidarFileName,unsigned int memCacheSize,IO::FilePt
 	/* Create a temporary LiDAR processing octree to calculate point elevations: */
 	LidarProcessOctree lpo(lidarFileName,size_t(memCacheSize)*size_t(1024*1024));
 	
+	/* Tabulate the elevation filter: */
+	LanczosKernel kernel(numLobes);
+	
 	/* Attach a value source to the point file: */
 	IO::ValueSource pointSource(pointFile);
 	pointSource.setWhitespace("");
@@ -101,8 +104,8 @@ void loadPointSet(const char* lidarFileName,unsigned int memCacheSize,IO::FilePt
 			}
 		
 		/* Calculate the current point's elevation: */
-		LidarRadialElevationSampler les(pos,filterRadius,numLobes);
-		lpo.processPointsInBox(les.getBox(),les);
+		LidarRadialElevationSampler les(pos,filterRadius,kernel);
+		lpo.processPointsInBoxBatched(les.getBox(),les);
 		if(les.getAbsWeightSum()>0.0)
 			{
 			/* Add the point to the coordinate node: */
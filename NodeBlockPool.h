@@ -0,0 +1,129 @@
+/***********************************************************************
+NodeBlockPool - Helper class to allocate the blocks of eight child nodes
+created by octree subdivisions from large chunks, and to recycle them
+without returning them to the heap.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef NODEBLOCKPOOL_INCLUDED
+#define NODEBLOCKPOOL_INCLUDED
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <Threads/Mutex.h>
+
+template <class NodeParam>
+class NodeBlockPool
+	{
+	/* Embedded classes: */
+	public:
+	typedef NodeParam Node; // Type of tree nodes
+	static const unsigned int numBlocksPerChunk=64; // Number of node blocks allocated from the heap at once
+	
+	private:
+	union Block // Union for the storage of a block of eight nodes, or a link in the list of free blocks
+		{
+		/* Elements: */
+		public:
+		Block* succ; // Next free block in the free list
+		Misc::UInt64 alignment; // Dummy element to align node storage
+		double alignment2; // Dummy element to align node storage
+		char storage[8*sizeof(Node)]; // Storage for eight nodes
+		};
+	
+	/* Elements: */
+	Threads::Mutex mutex; // Mutex serializing access to the free list
+	std::vector<Block*> chunks; // List of chunks of blocks allocated from the heap
+	Block* freeBlocks; // Head of the list of unused blocks
+	size_t numUsedBlocks; // Number of blocks currently handed out
+	
+	/* Constructors and destructors: */
+	public:
+	NodeBlockPool(void) // Creates an empty pool
+		:freeBlocks(0),numUsedBlocks(0)
+		{
+		}
+	private:
+	NodeBlockPool(const NodeBlockPool& source); // Prohibit copy constructor
+	NodeBlockPool& operator=(const NodeBlockPool& source); // Prohibit assignment operator
+	public:
+	~NodeBlockPool(void) // Releases all chunks; all blocks must have been returned to the pool
+		{
+		for(typename std::vector<Block*>::iterator cIt=chunks.begin();cIt!=chunks.end();++cIt)
+			delete[] *cIt;
+		}
+	
+	/* Methods: */
+	size_t getNumUsedBlocks(void) const // Returns the number of blocks currently handed out
+		{
+		return numUsedBlocks;
+		}
+	size_t getMemorySize(void) const // Returns the total size of all chunks allocated from the heap in bytes
+		{
+		return chunks.size()*numBlocksPerChunk*sizeof(Block);
+		}
+	Node* allocate(void) // Returns an array of eight default-constructed nodes
+		{
+		Block* block;
+		{
+		Threads::Mutex::Lock lock(mutex);
+		
+		if(freeBlocks==0)
+			{
+			/* Allocate a new chunk and add its blocks to the free list: */
+			Block* chunk=new Block[numBlocksPerChunk];
+			chunks.push_back(chunk);
+			for(unsigned int i=0;i<numBlocksPerChunk;++i)
+				{
+				chunk[i].succ=freeBlocks;
+				freeBlocks=&chunk[i];
+				}
+			}
+		
+		/* Take the first free block: */
+		block=freeBlocks;
+		freeBlocks=block->succ;
+		++numUsedBlocks;
+		}
+		
+		/* Construct the block's nodes outside the lock: */
+		Node* nodes=reinterpret_cast<Node*>(block->storage);
+		for(int i=0;i<8;++i)
+			new(&nodes[i]) Node;
+		return nodes;
+		}
+	void free(Node* nodes) // Destroys the given array of eight nodes returned by allocate and returns its block to the pool
+		{
+		/* Destroy the block's nodes outside the lock: */
+		for(int i=7;i>=0;--i)
+			nodes[i].~Node();
+		
+		/* Put the block back on the free list: */
+		Block* block=reinterpret_cast<Block*>(nodes);
+		Threads::Mutex::Lock lock(mutex);
+		block->succ=freeBlocks;
+		freeBlocks=block;
+		--numUsedBlocks;
+		}
+	};
+
+#endif
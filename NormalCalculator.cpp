@@ -1,7 +1,7 @@
 /***********************************************************************
 NormalCalculator - Functor class to calculate a normal vector for a
 point in a LiDAR data set.
-Copyright (c) 2008-2024 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -26,6 +26,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Misc/Utility.h>
 #include <Misc/StdError.h>
 #include <Math/Math.h>
+#include <Math/Constants.h>
+#include <Geometry/Vector.h>
 
 #include "NormalCalculator.h"
 
@@ -163,6 +165,131 @@ NormalCalculator::Plane::Vector NormalCalculator::calcNormal(const NormalCalcula
 	return calcEigenvector(cov,roots[2]);
 	}
 
+void NormalCalculator::calcCovariance(const double sums[9],double numPoints,double cov[6])
+	{
+	cov[0]=(sums[0]-sums[6]*sums[6]/numPoints)/numPoints;
+	cov[1]=(sums[1]-sums[6]*sums[7]/numPoints)/numPoints;
+	cov[2]=(sums[2]-sums[6]*sums[8]/numPoints)/numPoints;
+	cov[3]=(sums[3]-sums[7]*sums[7]/numPoints)/numPoints;
+	cov[4]=(sums[4]-sums[7]*sums[8]/numPoints)/numPoints;
+	cov[5]=(sums[5]-sums[8]*sums[8]/numPoints)/numPoints;
+	}
+
+NormalCalculator::Matrix NormalCalculator::makeMatrix(const double cov[6])
+	{
+	Matrix result;
+	result(0,0)=cov[0];
+	result(0,1)=cov[1];
+	result(0,2)=cov[2];
+	result(1,0)=cov[1];
+	result(1,1)=cov[3];
+	result(1,2)=cov[4];
+	result(2,0)=cov[2];
+	result(2,1)=cov[4];
+	result(2,2)=cov[5];
+	return result;
+	}
+
+/**************************************************
+Methods of class NormalCalculator::CovarianceBatch:
+**************************************************/
+
+void NormalCalculator::CovarianceBatch::calcNormals(NormalCalculator::Plane::Vector normals[]) const
+	{
+	/*********************************************************************
+	Solve all eigenproblems in closed form, one step at a time across the
+	entire batch, so that the compiler can vectorize each loop. The
+	covariance matrices are symmetric positive semi-definite, meaning
+	their smallest eigenvalue is also the one of smallest absolute value.
+	*********************************************************************/
+	
+	/* Calculate the smallest eigenvalues using the trigonometric solution of the characteristic polynomial: */
+	double minEigenvalues[maxNumMatrices];
+	for(unsigned int i=0;i<numMatrices;++i)
+		{
+		/* Shift the matrix by a third of its trace and scale the result to unit Frobenius norm: */
+		double q=(cov[0][i]+cov[3][i]+cov[5][i])/3.0;
+		double a=cov[0][i]-q;
+		double b=cov[3][i]-q;
+		double c=cov[5][i]-q;
+		double offDiag2=Math::sqr(cov[1][i])+Math::sqr(cov[2][i])+Math::sqr(cov[4][i]);
+		double p=Math::sqrt((a*a+b*b+c*c+2.0*offDiag2)/6.0);
+		double pInv=p>0.0?1.0/p:0.0;
+		
+		/* Calculate half the determinant of the shifted and scaled matrix: */
+		double det=a*(b*c-Math::sqr(cov[4][i]))-cov[1][i]*(cov[1][i]*c-cov[4][i]*cov[2][i])+cov[2][i]*(cov[1][i]*cov[4][i]-b*cov[2][i]);
+		double r=0.5*det*pInv*pInv*pInv;
+		r=r<-1.0?-1.0:r>1.0?1.0:r;
+		
+		/* The smallest eigenvalue belongs to the largest angle: */
+		minEigenvalues[i]=q+2.0*p*Math::cos(Math::acos(r)/3.0+2.0*Math::Constants<double>::pi/3.0);
+		}
+	
+	/* Calculate the eigenvectors as the largest cross product of two rows of the matrices minus their smallest eigenvalues: */
+	double nx[maxNumMatrices],ny[maxNumMatrices],nz[maxNumMatrices],nMag2[maxNumMatrices];
+	for(unsigned int i=0;i<numMatrices;++i)
+		{
+		double a=cov[0][i]-minEigenvalues[i];
+		double b=cov[3][i]-minEigenvalues[i];
+		double c=cov[5][i]-minEigenvalues[i];
+		double d=cov[1][i];
+		double e=cov[4][i];
+		double f=cov[2][i];
+		
+		/* Rows (a, d, f) x (d, b, e): */
+		double x=d*e-f*b;
+		double y=f*d-a*e;
+		double z=a*b-d*d;
+		double mag2=x*x+y*y+z*z;
+		
+		/* Rows (a, d, f) x (f, e, c): */
+		double x2=d*c-f*e;
+		double y2=f*f-a*c;
+		double z2=a*e-d*f;
+		double mag22=x2*x2+y2*y2+z2*z2;
+		bool better=mag22>mag2;
+		x=better?x2:x;
+		y=better?y2:y;
+		z=better?z2:z;
+		mag2=better?mag22:mag2;
+		
+		/* Rows (d, b, e) x (f, e, c): */
+		x2=b*c-e*e;
+		y2=e*f-d*c;
+		z2=d*e-b*f;
+		mag22=x2*x2+y2*y2+z2*z2;
+		better=mag22>mag2;
+		nx[i]=better?x2:x;
+		ny[i]=better?y2:y;
+		nz[i]=better?z2:z;
+		nMag2[i]=better?mag22:mag2;
+		}
+	
+	/* Normalize the eigenvectors: */
+	for(unsigned int i=0;i<numMatrices;++i)
+		{
+		if(nMag2[i]>0.0)
+			{
+			double scale=1.0/Math::sqrt(nMag2[i]);
+			normals[i]=Plane::Vector(nx[i]*scale,ny[i]*scale,nz[i]*scale);
+			}
+		else
+			{
+			/* The smallest eigenvalue is degenerate, i.e., the points are collinear; pick any vector orthogonal to the line: */
+			Plane::Vector line(cov[0][i],cov[1][i],cov[2][i]);
+			if(Math::abs(cov[3][i])>Math::abs(line[0])&&Math::abs(cov[3][i])>=Math::abs(cov[5][i]))
+				line=Plane::Vector(cov[1][i],cov[3][i],cov[4][i]);
+			else if(Math::abs(cov[5][i])>Math::abs(line[0]))
+				line=Plane::Vector(cov[2][i],cov[4][i],cov[5][i]);
+			normals[i]=Geometry::normal(line);
+			if(Geometry::sqr(normals[i])>0.0)
+				normals[i].normalize();
+			else
+				normals[i]=Plane::Vector(0.0,0.0,1.0);
+			}
+		}
+	}
+
 /***************************************
 Methods of class RadiusNormalCalculator:
 ***************************************/
@@ -193,26 +320,24 @@ void RadiusNormalCalculator::prepare(const Point& newQueryPoint)
 	closestDist2=radius2;
 	}
 
+void RadiusNormalCalculator::calcCovariance(double cov[6]) const
+	{
+	double sums[9]={pxpxs,pxpys,pxpzs,pypys,pypzs,pzpzs,pxs,pys,pzs};
+	NormalCalculator::calcCovariance(sums,double(numPoints),cov);
+	}
+
 NormalCalculator::Plane RadiusNormalCalculator::calcPlane(void) const
 	{
 	if(numPoints<3)
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Three points required, only have %u",numPoints);
 	
 	/* Calculate the processed points' covariance matrix: */
-	double np=double(numPoints);
-	Matrix c;
-	c(0,0)=(pxpxs-pxs*pxs/np)/np;
-	c(0,1)=(pxpys-pxs*pys/np)/np;
-	c(0,2)=(pxpzs-pxs*pzs/np)/np;
-	c(1,0)=c(0,1);
-	c(1,1)=(pypys-pys*pys/np)/np;
-	c(1,2)=(pypzs-pys*pzs/np)/np;
-	c(2,0)=c(0,2);
-	c(2,1)=c(1,2);
-	c(2,2)=(pzpzs-pzs*pzs/np)/np;
+	double cov[6];
+	calcCovariance(cov);
 	
 	/* Return the plane equation: */
-	return Plane(calcNormal(c),Plane::Point(pxs/np,pys/np,pzs/np));
+	double np=double(numPoints);
+	return Plane(calcNormal(makeMatrix(cov)),Plane::Point(pxs/np,pys/np,pzs/np));
 	}
 
 /*********************************************
@@ -221,173 +346,100 @@ Methods of class NumberRadiusNormalCalculator:
 
 NumberRadiusNormalCalculator::NumberRadiusNormalCalculator(unsigned int sMaxNumNeighbors)
 	:maxNumNeighbors(sMaxNumNeighbors),maxDist2(Math::Constants<Scalar>::max),
-	 neighbors(new Neighbor[maxNumNeighbors])
+	 neighbors(new NeighborHeap(maxNumNeighbors))
 	{
 	}
 
 NumberRadiusNormalCalculator::NumberRadiusNormalCalculator(unsigned int sMaxNumNeighbors,Scalar sMaxDist)
 	:maxNumNeighbors(sMaxNumNeighbors),maxDist2(Math::sqr(sMaxDist)),
-	 neighbors(new Neighbor[maxNumNeighbors])
+	 neighbors(new NeighborHeap(maxNumNeighbors))
 	{
 	}
 
 NumberRadiusNormalCalculator::NumberRadiusNormalCalculator(const NumberRadiusNormalCalculator& source)
 	:maxNumNeighbors(source.maxNumNeighbors),maxDist2(source.maxDist2),
-	 neighbors(new Neighbor[maxNumNeighbors]),
-	 currentNumNeighbors(source.currentNumNeighbors),currentMaxDist2(source.currentMaxDist2)
+	 neighbors(new NeighborHeap(maxNumNeighbors))
 	{
-	/* Copy the source's neighbor heap: */
-	for(unsigned int i=0;i<maxNumNeighbors;++i)
-		neighbors[i]=source.neighbors[i];
 	}
 
 NumberRadiusNormalCalculator& NumberRadiusNormalCalculator::operator=(const NumberRadiusNormalCalculator& source)
 	{
 	if(this!=&source)
 		{
-		if(maxNumNeighbors!=source.maxNumNeighbors)
-			{
-			maxNumNeighbors=source.maxNumNeighbors;
-			delete[] neighbors;
-			neighbors=new Neighbor[maxNumNeighbors];
-			}
+		maxNumNeighbors=source.maxNumNeighbors;
 		maxDist2=source.maxDist2;
-		currentNumNeighbors=source.currentNumNeighbors;
-		currentMaxDist2=source.currentMaxDist2;
 		
-		/* Copy the source's neighbor heap: */
-		for(unsigned int i=0;i<maxNumNeighbors;++i)
-			neighbors[i]=source.neighbors[i];
+		/* Start with a fresh neighbor heap: */
+		delete neighbors;
+		neighbors=new NeighborHeap(maxNumNeighbors);
 		}
 	return *this;
 	}
 
 NumberRadiusNormalCalculator::~NumberRadiusNormalCalculator(void)
 	{
-	delete[] neighbors;
+	delete neighbors;
 	}
 
-void NumberRadiusNormalCalculator::operator()(const LidarPoint& point)
+void NumberRadiusNormalCalculator::prepare(const Point& newQueryPoint)
 	{
-	Scalar dist2=Geometry::sqrDist(point,queryPoint);
-	if(dist2<currentMaxDist2)
+	/* Reset the neighborhood collector, bounding the search by the previous neighborhood: */
+	neighbors->prepareAdjacent(newQueryPoint,maxDist2);
+	}
+
+void NumberRadiusNormalCalculator::accumulateNeighbors(double sums[9]) const
+	{
+	for(int i=0;i<9;++i)
+		sums[i]=0.0;
+	for(unsigned int i=0;i<neighbors->getNumNeighbors();++i)
 		{
-		if(currentNumNeighbors<maxNumNeighbors)
-			{
-			/* Insert the new point into the heap: */
-			unsigned int insertionPos=currentNumNeighbors;
-			while(insertionPos>0)
-				{
-				unsigned int parent=(insertionPos-1)>>1;
-				if(neighbors[parent].dist2>=dist2)
-					break;
-				neighbors[insertionPos]=neighbors[parent];
-				insertionPos=parent;
-				}
-			neighbors[insertionPos].point=point;
-			neighbors[insertionPos].dist2=dist2;
-			
-			/* Increment the current neighborhood size and check if it became full: */
-			++currentNumNeighbors;
-			if(currentNumNeighbors==maxNumNeighbors)
-				currentMaxDist2=neighbors[0].dist2;
-			}
-		else
-			{
-			/* Replace the currently farthest-away neighbor in the heap: */
-			unsigned int insertionPos=0;
-			while(true)
-				{
-				unsigned int biggestIndex=insertionPos;
-				Scalar biggest=dist2;
-				unsigned int child=(insertionPos<<1);
-				for(int i=0;i<2;++i)
-					{
-					++child;
-					if(child<maxNumNeighbors&&neighbors[child].dist2>biggest)
-						{
-						biggestIndex=child;
-						biggest=neighbors[child].dist2;
-						}
-					}
-				if(biggestIndex==insertionPos)
-					break;
-				neighbors[insertionPos]=neighbors[biggestIndex];
-				insertionPos=biggestIndex;
-				}
-			neighbors[insertionPos].point=point;
-			neighbors[insertionPos].dist2=dist2;
-			
-			/* Update the current neighborhood radius: */
-			currentMaxDist2=neighbors[0].dist2;
-			}
+		/* Accumulate the neighbor: */
+		const Point& lp=neighbors->getNeighbor(i).point;
+		sums[0]+=double(lp[0])*double(lp[0]);
+		sums[1]+=double(lp[0])*double(lp[1]);
+		sums[2]+=double(lp[0])*double(lp[2]);
+		sums[3]+=double(lp[1])*double(lp[1]);
+		sums[4]+=double(lp[1])*double(lp[2]);
+		sums[5]+=double(lp[2])*double(lp[2]);
+		sums[6]+=double(lp[0]);
+		sums[7]+=double(lp[1]);
+		sums[8]+=double(lp[2]);
 		}
 	}
 
-void NumberRadiusNormalCalculator::prepare(const Point& newQueryPoint)
+void NumberRadiusNormalCalculator::calcCovariance(double cov[6]) const
 	{
-	/* Copy the query point: */
-	queryPoint=newQueryPoint;
-	
-	/* Reset the neighborhood collector: */
-	currentNumNeighbors=0;
-	currentMaxDist2=maxDist2;
+	double sums[9];
+	accumulateNeighbors(sums);
+	NormalCalculator::calcCovariance(sums,double(neighbors->getNumNeighbors()),cov);
 	}
 
 NormalCalculator::Plane NumberRadiusNormalCalculator::calcPlane(void) const
 	{
-	if(currentNumNeighbors<3)
-		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Three points required, only have %u",currentNumNeighbors);
+	unsigned int numNeighbors=neighbors->getNumNeighbors();
+	if(numNeighbors<3)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Three points required, only have %u",numNeighbors);
 	
 	/* Calculate the processed points' covariance matrix: */
-	double pxpxs=0.0;
-	double pxpys=0.0;
-	double pxpzs=0.0;
-	double pypys=0.0;
-	double pypzs=0.0;
-	double pzpzs=0.0;
-	double pxs=0.0;
-	double pys=0.0;
-	double pzs=0.0;
-	for(unsigned int i=0;i<currentNumNeighbors;++i)
-		{
-		/* Accumulate the neighbor: */
-		const Point& lp=neighbors[i].point;
-		pxpxs+=double(lp[0])*double(lp[0]);
-		pxpys+=double(lp[0])*double(lp[1]);
-		pxpzs+=double(lp[0])*double(lp[2]);
-		pypys+=double(lp[1])*double(lp[1]);
-		pypzs+=double(lp[1])*double(lp[2]);
-		pzpzs+=double(lp[2])*double(lp[2]);
-		pxs+=double(lp[0]);
-		pys+=double(lp[1]);
-		pzs+=double(lp[2]);
-		}
-	
-	double np=double(currentNumNeighbors);
-	Matrix c;
-	c(0,0)=(pxpxs-pxs*pxs/np)/np;
-	c(0,1)=(pxpys-pxs*pys/np)/np;
-	c(0,2)=(pxpzs-pxs*pzs/np)/np;
-	c(1,0)=c(0,1);
-	c(1,1)=(pypys-pys*pys/np)/np;
-	c(1,2)=(pypzs-pys*pzs/np)/np;
-	c(2,0)=c(0,2);
-	c(2,1)=c(1,2);
-	c(2,2)=(pzpzs-pzs*pzs/np)/np;
+	double sums[9];
+	accumulateNeighbors(sums);
+	double np=double(numNeighbors);
+	double cov[6];
+	NormalCalculator::calcCovariance(sums,np,cov);
 	
 	/* Return the plane equation: */
-	return Plane(calcNormal(c),Plane::Point(pxs/np,pys/np,pzs/np));
+	return Plane(calcNormal(makeMatrix(cov)),Plane::Point(sums[6]/np,sums[7]/np,sums[8]/np));
 	}
 
 Scalar NumberRadiusNormalCalculator::getClosestDist(void) const
 	{
 	/* Find the closest non-identical neighbor: */
 	Scalar result2=maxDist2;
-	for(unsigned int i=0;i<currentNumNeighbors;++i)
+	for(unsigned int i=0;i<neighbors->getNumNeighbors();++i)
 		{
-		if(neighbors[i].dist2>Scalar(0)&&result2>neighbors[i].dist2)
-			result2=neighbors[i].dist2;
+		Scalar dist2=neighbors->getNeighbor(i).dist2;
+		if(dist2>Scalar(0)&&result2>dist2)
+			result2=dist2;
 		}
 	
 	return Math::sqrt(result2);
@@ -1,7 +1,7 @@
 /***********************************************************************
 NormalCalculator - Functor classes to calculate a normal vector for each
 point in a LiDAR data set.
-Copyright (c) 2008-2014 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,8 +24,9 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef NORMALCALCULATOR_INCLUDED
 #define NORMALCALCULATOR_INCLUDED
 
-#include <Threads/Thread.h>
-#include <Threads/Barrier.h>
+#include <string>
+#include <vector>
+#include <Threads/Mutex.h>
 #include <Geometry/ComponentArray.h>
 #include <Geometry/Matrix.h>
 #include <Geometry/Plane.h>
@@ -33,6 +34,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarTypes.h"
 #include "LidarFile.h"
 #include "LidarProcessOctree.h"
+#include "KNearestNeighborHeap.h"
 
 /* Forward declarations: */
 namespace Misc {
@@ -44,6 +46,47 @@ class NormalCalculator // Base class for functors calculating normal vectors bas
 	/* Embedded classes: */
 	public:
 	typedef Geometry::Plane<double,3> Plane; // Type for planes
+	
+	class CovarianceBatch // Class to calculate normal vectors for a batch of covariance matrices at once
+		{
+		/* Embedded classes: */
+		public:
+		static const unsigned int maxNumMatrices=16; // Maximum number of covariance matrices in a batch
+		
+		/* Elements: */
+		private:
+		unsigned int numMatrices; // Current number of covariance matrices in the batch
+		double cov[6][maxNumMatrices]; // Upper-triangle components xx, xy, xz, yy, yz, zz of the batch's covariance matrices, stored component-wise
+		
+		/* Constructors and destructors: */
+		public:
+		CovarianceBatch(void) // Creates an empty batch
+			:numMatrices(0)
+			{
+			}
+		
+		/* Methods: */
+		unsigned int getNumMatrices(void) const // Returns the current number of covariance matrices in the batch
+			{
+			return numMatrices;
+			}
+		bool isFull(void) const // Returns true if the batch can not accept any more matrices
+			{
+			return numMatrices==maxNumMatrices;
+			}
+		void clear(void) // Removes all matrices from the batch
+			{
+			numMatrices=0;
+			}
+		void addMatrix(const double newCov[6]) // Adds a covariance matrix in upper-triangle form to the batch
+			{
+			for(int i=0;i<6;++i)
+				cov[i][numMatrices]=newCov[i];
+			++numMatrices;
+			}
+		void calcNormals(Plane::Vector normals[]) const; // Calculates the normalized eigenvectors of the smallest eigenvalues of all matrices in the batch
+		};
+	
 	protected:
 	typedef Geometry::ComponentArray<double,3> CA;
 	typedef Geometry::Matrix<double,3,3> Matrix;
@@ -52,6 +95,8 @@ class NormalCalculator // Base class for functors calculating normal vectors bas
 	protected:
 	static Plane::Vector calcEigenvector(const Matrix& cov,double eigenvalue); // Returns the eigenvector of the given matrix for the given eigenvalue
 	static Plane::Vector calcNormal(const Matrix& cov); // Returns the normal vector of the plane defined by the given covariance matrix
+	static void calcCovariance(const double sums[9],double numPoints,double cov[6]); // Calculates an upper-triangle covariance matrix from accumulated sums xx, xy, xz, yy, yz, zz, x, y, z
+	static Matrix makeMatrix(const double cov[6]); // Returns the full matrix for the given upper-triangle covariance matrix
 	};
 
 class RadiusNormalCalculator:public NormalCalculator // Class to calculate normal vectors by accumulating points from a neighborhood of fixed size
@@ -107,6 +152,7 @@ class RadiusNormalCalculator:public NormalCalculator // Class to calculate norma
 		{
 		return numPoints;
 		}
+	void calcCovariance(double cov[6]) const; // Returns the upper-triangle covariance matrix of the processed points
 	Plane calcPlane(void) const; // Returns the least-squares plane fitting the processed points
 	Scalar getClosestDist(void) const // Returns the distance to the closest non-identical neighbor
 		{
@@ -118,93 +164,105 @@ class NumberRadiusNormalCalculator:public NormalCalculator // Class to calculate
 	{
 	/* Embedded classes: */
 	private:
-	struct Neighbor // Structure to store a neighbor
-		{
-		/* Elements: */
-		public:
-		Point point; // Copy of neighbor's position
-		Scalar dist2; // Squared distance from query position to neighbor
-		};
+	typedef KNearestNeighborHeap<> NeighborHeap; // Type for heaps of neighbor candidates
 	
 	/* Elements: */
 	private:
 	unsigned int maxNumNeighbors; // Maximum number of neighbors
 	Scalar maxDist2; // Squared maximum distance to neighbors
-	Point queryPoint; // The query point position
-	Neighbor* neighbors; // Array of current neighbor candidates, organized as a heap
-	unsigned int currentNumNeighbors; // Current number of neighbor candidates
-	Scalar currentMaxDist2; // Current maximum distance to any neighbor candidate
+	NeighborHeap* neighbors; // Heap of current neighbor candidates
+	
+	/* Private methods: */
+	void accumulateNeighbors(double sums[9]) const; // Accumulates the sums xx, xy, xz, yy, yz, zz, x, y, z over the current neighbors
 	
 	/* Constructors and destructors: */
 	public:
 	NumberRadiusNormalCalculator(unsigned int sMaxNumNeighbors); // Creates normal calculator for the given number of neighbors and unlimited neighborhood size
 	NumberRadiusNormalCalculator(unsigned int sMaxNumNeighbors,Scalar sMaxDist); // Creates normal calculator for the given number of neighbors and given neighborhood size
-	NumberRadiusNormalCalculator(const NumberRadiusNormalCalculator& source); // Copy constructor
-	NumberRadiusNormalCalculator& operator=(const NumberRadiusNormalCalculator& source); // Assignment operator
+	NumberRadiusNormalCalculator(const NumberRadiusNormalCalculator& source); // Copy constructor; does not copy the current neighborhood
+	NumberRadiusNormalCalculator& operator=(const NumberRadiusNormalCalculator& source); // Assignment operator; does not copy the current neighborhood
 	~NumberRadiusNormalCalculator(void);
 	
 	/* Methods: */
-	void operator()(const LidarPoint& point);
+	void operator()(const LidarPoint& point)
+		{
+		(*neighbors)(point);
+		}
 	const Point& getQueryPoint(void) const
 		{
-		return queryPoint;
+		return neighbors->getQueryPoint();
 		}
 	Scalar getQueryRadius2(void) const
 		{
-		return currentMaxDist2;
+		return neighbors->getQueryRadius2();
 		}
 	
-	void prepare(const Point& newQueryPoint); // Prepares the normal calculator for traversal around the given point
+	void prepare(const Point& newQueryPoint); // Prepares the normal calculator for traversal around the given point; traversals are fastest if consecutive query points are close to each other
 	unsigned int getNumPoints(void) const // Returns the number of neighbors in the neighborhood
 		{
-		return currentNumNeighbors;
+		return neighbors->getNumNeighbors();
 		}
+	void calcCovariance(double cov[6]) const; // Returns the upper-triangle covariance matrix of the processed points
 	Plane calcPlane(void) const; // Returns the least-squares plane fitting the processed points
 	Scalar getClosestDist(void) const; // Returns the distance to the closest non-identical neighbor
 	};
 
 template <class NormalCalculatorParam>
-class NodeNormalCalculator
+class NodeNormalCalculator // Node functor to calculate normal vectors for all points in a LiDAR octree; thread-safe if called from a parallel post-fix traversal, where each thread carries one node at a time from gathering its points' neighborhoods or its children's normal vectors to writing its own normal vectors
 	{
 	/* Embedded classes: */
 	public:
 	typedef NormalCalculatorParam NormalCalculator; // Normal calculator class
+	private:
+	typedef typename NormalCalculator::CovarianceBatch CovarianceBatch;
+	
+	struct Buffers // Structure for scratch buffers used while processing a single node
+		{
+		/* Elements: */
+		public:
+		Vector* normalBuffer; // Array to hold normal vectors for a node during processing
+		Vector* childNormalBuffers[8]; // Arrays to hold normal vectors for a node's children during subsampling
+		};
 	
 	/* Elements: */
-	private:
 	LidarProcessOctree& lpo; // The processed LiDAR octree
-	const NormalCalculator& normalCalculator; // The "prototype" normal calculator
-	Vector* normalBuffer; // Array to hold normal vectors for a node during processing
-	Vector* childNormalBuffers[8]; // Array of normal arrays for a node's children during subsampling
+	const NormalCalculator& normalCalculator; // The "prototype" normal calculator; each leaf node is processed with its own copy
+	Threads::Mutex bufferMutex; // Mutex protecting the list of idle scratch buffers
+	std::vector<Buffers*> idleBuffers; // List of scratch buffers not currently used by any thread
 	LidarFile::Offset normalDataSize; // Size of each record in the normal file
-	LidarFile normalFile; // The file to which to write the normal vector data
-	bool saveOutliers; // Flag whether to save points with undefined normal vectors to an outlier file
-	Threads::Mutex outlierMutex; // Mutex serializing access to the outlier array
-	size_t numOutliers; // Number of outliers encountered in the current node
-	Point* outliers; // Array of outlier positions
+	int normalFd; // File descriptor of the normal file, which is read and written at explicit positions by concurrent threads
+	Threads::Mutex outlierMutex; // Mutex serializing access to the outlier file
 	Misc::File* outlierFile; // If outliers are to be saved, pointer to the file to which to write them
-	unsigned int numThreads; // Number of processing threads
-	bool shutdownThreads; // Flag to shut down threads at the end
-	Threads::Thread* calcThreads; // Array of threads to calculate normal vectors from point neighborhoods
-	Threads::Barrier calcBarrier;
-	Threads::Thread* subsampleThreads; // Array of threads to subsample normal vectors from node children
-	Threads::Barrier subsampleBarrier;
-	LidarProcessOctree::Node* currentNode; // Pointer to currently processed node
-	LidarProcessOctree::Node* currentChildren[8]; // Pointer to children of currently processed node
+	Threads::Mutex statusMutex; // Mutex protecting the progress counters and error message
 	size_t numProcessedNodes; // Number of already processed nodes
+	size_t nextProgressUpdate; // Number of processed nodes at which the progress indicator should be updated
+	std::string errorMessage; // Message of the first error that occurred during processing
 	
 	/* Private methods: */
-	void* calcThreadMethod(unsigned int threadIndex);
-	void* subsampleThreadMethod(unsigned int threadIndex);
+	Buffers* acquireBuffers(void); // Returns an idle set of scratch buffers, or a new set if there is none
+	void releaseBuffers(Buffers* buffers); // Returns the given set of scratch buffers to the idle list
+	void readNormals(Vector* normals,LidarFile::Offset dataOffset,unsigned int numNormals) const; // Reads a node's normal vectors from the normal file
+	void writeNormals(const Vector* normals,LidarFile::Offset dataOffset,unsigned int numNormals) const; // Writes a node's normal vectors to the normal file
+	static void storeBatchNormals(const CovarianceBatch& batch,const unsigned int pointIndices[],const Scalar closestDists[],Vector* normalBuffer); // Stores the normal vectors of a batch of point neighborhoods into the given normal buffer
+	void calcNormals(LidarProcessOctree::Node& node,Vector* normalBuffer); // Calculates normal vectors for all points of the given leaf node from their neighborhoods
+	void subsampleNormals(LidarProcessOctree::Node& node,Buffers& buffers); // Averages the normal vectors of the given interior node's children onto its points
 	
 	/* Constructors and destructors: */
 	public:
-	NodeNormalCalculator(LidarProcessOctree& sLpo,const NormalCalculator& sNormalCalculator,const char* normalFileName,unsigned int sNumThreads =1); // Creates a node normal calculator with the given point normal calculator and parameters
+	NodeNormalCalculator(LidarProcessOctree& sLpo,const NormalCalculator& sNormalCalculator,const char* normalFileName); // Creates a node normal calculator with the given point normal calculator and parameters
+	private:
+	NodeNormalCalculator(const NodeNormalCalculator& source); // Prohibit copy constructor
+	NodeNormalCalculator& operator=(const NodeNormalCalculator& source); // Prohibit assignment operator
+	public:
 	~NodeNormalCalculator(void);
 	
 	/* Methods: */
 	void saveOutlierPoints(const char* outlierFileName); // Saves outlier points to the given file
 	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel);
+	const std::string& getErrorMessage(void) const // Returns the message of the first error that occurred during processing, or an empty string
+		{
+		return errorMessage;
+		}
 	};
 
 #ifndef NORMALCALCULATOR_IMPLEMENTATION
@@ -1,12 +1,16 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <string>
+#include <stdexcept>
+#include <vector>
 #include <iostream>
 #include <iomanip>
 #include <Misc/StdError.h>
-#include <Threads/Thread.h>
-#include <Threads/Barrier.h>
+#include <Threads/Mutex.h>
 #include <Math/Math.h>
 
 #include "LidarTypes.h"
@@ -114,95 +118,55 @@ class Axe
 		}
 	};
 
-class PaulBunyan
+class PaulBunyan // Node functor to classify LiDAR points as ground or else; thread-safe if called from a parallel post-fix traversal, where each thread carries one node at a time from reading its children's colors through classification or subsampling to writing its own colors
 	{
-	/* Elements: */
+	/* Embedded classes: */
 	private:
+	struct Buffers // Structure for scratch buffers used while processing a single node
+		{
+		/* Elements: */
+		public:
+		Color* colorBuffer; // Array to hold colors for a node during processing
+		Color* childColorBuffers[8]; // Arrays to hold colors for a node's children during processing
+		};
+	
+	/* Elements: */
 	LidarProcessOctree& lpo; // The processed LiDAR octree
-	Axe axe; // The axe
-	Color* colorBuffer; // Array to hold colors for a node during processing
-	Color* childColorBuffers[8]; // Arrays to hold colors for a node's children during processing
+	Axe axe; // The prototype axe; each node is classified with its own copy
+	Threads::Mutex bufferMutex; // Mutex protecting the list of idle scratch buffers
+	std::vector<Buffers*> idleBuffers; // List of scratch buffers not currently used by any thread
 	LidarFile::Offset colorDataSize; // Size of each record in the color file
-	LidarFile colorFile; // The file to which to write the color data
+	int colorFd; // File descriptor of the color file, which is read and written at explicit positions by concurrent threads
+	Threads::Mutex pointFileMutex; // Mutex serializing access to the ground point file
 	FILE* pointFile; // Optional ASCII file to store ground points
-	unsigned int numThreads; // Number of processing threads
-	bool shutdownThreads; // Flag to shut down threads at the end
-	Threads::Thread* calcThreads; // Array of threads to calculate normal vectors from point neighborhoods
-	Threads::Barrier calcBarrier;
-	Threads::Thread* subsampleThreads; // Array of threads to subsample normal vectors from node children
-	Threads::Barrier subsampleBarrier;
-	LidarProcessOctree::Node* currentNode; // Pointer to currently processed node
-	LidarProcessOctree::Node* currentChildren[8]; // Pointer to children of currently processed node
+	Threads::Mutex statusMutex; // Mutex protecting the progress counters and error message
 	size_t numProcessedNodes; // Number of already processed nodes
+	size_t nextProgressUpdate; // Number of processed nodes at which the progress indicator should be updated
+	std::string errorMessage; // Message of the first error that occurred during processing
 	
 	/* Private methods: */
-	void* calcThreadMethod(unsigned int threadIndex);
-	void* subsampleThreadMethod(unsigned int threadIndex);
+	Buffers* acquireBuffers(void); // Returns an idle set of scratch buffers, or a new set if there is none
+	void releaseBuffers(Buffers* buffers); // Returns the given set of scratch buffers to the idle list
+	void readColors(Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const; // Reads a node's colors from the color file
+	void writeColors(const Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const; // Writes a node's colors to the color file
+	void processNode(LidarProcessOctree::Node& node,Buffers& buffers); // Classifies the given leaf node's points or subsamples the given interior node's colors from its children, and writes them to the color file
 	
 	/* Constructors and destructors: */
 	public:
-	PaulBunyan(LidarProcessOctree& sLpo,const Axe& sAxe,const char* colorFileName,const char* pointFileName,unsigned int sNumThreads =1); // Creates an axe wielder with the given axe
+	PaulBunyan(LidarProcessOctree& sLpo,const Axe& sAxe,const char* colorFileName,const char* pointFileName); // Creates an axe wielder with the given axe
+	private:
+	PaulBunyan(const PaulBunyan& source); // Prohibit copy constructor
+	PaulBunyan& operator=(const PaulBunyan& source); // Prohibit assignment operator
+	public:
 	~PaulBunyan(void);
 	
 	/* Methods: */
 	void operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel);
-	};
-
-/***************************
-Methods of class PaulBunyan:
-***************************/
-
-void* PaulBunyan::calcThreadMethod(unsigned int threadIndex)
-	{
-	Threads::Thread::setCancelState(Threads::Thread::CANCEL_ENABLE);
-	
-	while(true)
+	const std::string& getErrorMessage(void) const // Returns the message of the first error that occurred during processing, or an empty string
 		{
-		/* Wait on the calculation barrier until there is a job: */
-		calcBarrier.synchronize();
-		if(shutdownThreads)
-			break;
-		
-		/* Process the current node: */
-		unsigned int firstI=(threadIndex*currentNode->getNumPoints())/numThreads;
-		unsigned int lastI=((threadIndex+1)*currentNode->getNumPoints())/numThreads;
-		for(unsigned int index=firstI;index<lastI;++index)
-			{
-			/* Apply the axe to the point: */
-			axe.prepareTraversal((*currentNode)[index]);
-			lpo.processPointsInBox(axe.getBox(),axe);
-			
-			/* Color the point based on its classification: */
-			float intensity=float((*currentNode)[index].value[0])*0.299f+float((*currentNode)[index].value[1])*0.587f+float((*currentNode)[index].value[2])*0.114f;
-			for(int i=0;i<4;++i)
-				colorBuffer[index][i]=Color::Scalar(0);
-			if(axe.isGround())
-				{
-				/* Color the point brown: */
-				colorBuffer[index][0]=Color::Scalar(intensity*0.5f+0.5f);
-				colorBuffer[index][1]=Color::Scalar(intensity*0.333f+0.5f);
-				
-				if(pointFile!=0)
-					{
-					/* Write the original point to a file: */
-					fprintf(pointFile,"%.10g %.10g %.10g %3u %3u %3u\n",
-					        (*currentNode)[index][0],(*currentNode)[index][1],(*currentNode)[index][2],
-					        (*currentNode)[index].value[0],(*currentNode)[index].value[1],(*currentNode)[index].value[2]);
-					}
-				}
-			else
-				{
-				/* Color the point green: */
-				colorBuffer[index][1]=Color::Scalar(intensity+0.5f);
-				}
-			}
-		
-		/* Synchronize on the calculation barrier to signal job completion: */
-		calcBarrier.synchronize();
+		return errorMessage;
 		}
-	
-	return 0;
-	}
+	};
 
 namespace {
 
@@ -247,28 +211,141 @@ class FindPoint // Class to find a point inside an octree node
 
 }
 
-void* PaulBunyan::subsampleThreadMethod(unsigned int threadIndex)
+/***************************
+Methods of class PaulBunyan:
+***************************/
+
+PaulBunyan::Buffers* PaulBunyan::acquireBuffers(void)
+	{
+	{
+	Threads::Mutex::Lock bufferLock(bufferMutex);
+	if(!idleBuffers.empty())
+		{
+		Buffers* result=idleBuffers.back();
+		idleBuffers.pop_back();
+		return result;
+		}
+	}
+	
+	/* Allocate a new set of buffers: */
+	Buffers* result=new Buffers;
+	result->colorBuffer=new Color[lpo.getMaxNumPointsPerNode()];
+	for(int i=0;i<8;++i)
+		result->childColorBuffers[i]=new Color[lpo.getMaxNumPointsPerNode()];
+	return result;
+	}
+
+void PaulBunyan::releaseBuffers(PaulBunyan::Buffers* buffers)
+	{
+	Threads::Mutex::Lock bufferLock(bufferMutex);
+	idleBuffers.push_back(buffers);
+	}
+
+void PaulBunyan::readColors(Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const
+	{
+	char* bufPtr=reinterpret_cast<char*>(colors);
+	size_t numBytes=size_t(numColors)*sizeof(Color);
+	off_t pos=off_t(LidarDataFileHeader::getFileSize()+colorDataSize*dataOffset);
+	while(numBytes>0)
+		{
+		ssize_t readResult=pread(colorFd,bufPtr,numBytes,pos);
+		if(readResult<=0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,readResult<0?errno:0,"Cannot read colors at offset %llu",(unsigned long long)dataOffset);
+		bufPtr+=readResult;
+		numBytes-=size_t(readResult);
+		pos+=off_t(readResult);
+		}
+	}
+
+void PaulBunyan::writeColors(const Color* colors,LidarFile::Offset dataOffset,unsigned int numColors) const
+	{
+	const char* bufPtr=reinterpret_cast<const char*>(colors);
+	size_t numBytes=size_t(numColors)*sizeof(Color);
+	off_t pos=off_t(LidarDataFileHeader::getFileSize()+colorDataSize*dataOffset);
+	while(numBytes>0)
+		{
+		ssize_t writeResult=pwrite(colorFd,bufPtr,numBytes,pos);
+		if(writeResult<0)
+			throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot write colors at offset %llu",(unsigned long long)dataOffset);
+		bufPtr+=writeResult;
+		numBytes-=size_t(writeResult);
+		pos+=off_t(writeResult);
+		}
+	}
+
+void PaulBunyan::processNode(LidarProcessOctree::Node& node,PaulBunyan::Buffers& buffers)
 	{
-	Threads::Thread::setCancelState(Threads::Thread::CANCEL_ENABLE);
+	if(node.getNumPoints()==0)
+		return;
+	
+	Color* colorBuffer=buffers.colorBuffer;
+	Color** childColorBuffers=buffers.childColorBuffers;
 	
-	while(true)
+	if(node.isLeaf())
 		{
-		/* Wait on the subsampling barrier until there is a job: */
-		subsampleBarrier.synchronize();
-		if(shutdownThreads)
-			break;
+		/* Classify the node's points with a private copy of the axe: */
+		Axe nodeAxe(axe);
+		std::string groundPoints;
+		for(unsigned int index=0;index<node.getNumPoints();++index)
+			{
+			/* Apply the axe to the point: */
+			nodeAxe.prepareTraversal(node[index]);
+			lpo.processPointsInBox(nodeAxe.getBox(),nodeAxe);
+			
+			/* Color the point based on its classification: */
+			float intensity=float(node[index].value[0])*0.299f+float(node[index].value[1])*0.587f+float(node[index].value[2])*0.114f;
+			for(int i=0;i<4;++i)
+				colorBuffer[index][i]=Color::Scalar(0);
+			if(nodeAxe.isGround())
+				{
+				/* Color the point brown: */
+				colorBuffer[index][0]=Color::Scalar(intensity*0.5f+0.5f);
+				colorBuffer[index][1]=Color::Scalar(intensity*0.333f+0.5f);
+				
+				if(pointFile!=0)
+					{
+					/* Collect the original point for the point file: */
+					char line[256];
+					snprintf(line,sizeof(line),"%.10g %.10g %.10g %3u %3u %3u\n",
+					         node[index][0],node[index][1],node[index][2],
+					         node[index].value[0],node[index].value[1],node[index].value[2]);
+					groundPoints.append(line);
+					}
+				}
+			else
+				{
+				/* Color the point green: */
+				colorBuffer[index][1]=Color::Scalar(intensity+0.5f);
+				}
+			}
+		
+		if(!groundPoints.empty())
+			{
+			/* Write the node's ground points to the point file in one go: */
+			Threads::Mutex::Lock pointFileLock(pointFileMutex);
+			fputs(groundPoints.c_str(),pointFile);
+			}
+		}
+	else
+		{
+		/* Get pointers to the node's children and load their classified color arrays: */
+		LidarProcessOctree::Node* children[8];
+		for(int childIndex=0;childIndex<8;++childIndex)
+			{
+			children[childIndex]=lpo.getChild(&node,childIndex);
+			if(children[childIndex]->getNumPoints()>0)
+				readColors(childColorBuffers[childIndex],children[childIndex]->getDataOffset(),children[childIndex]->getNumPoints());
+			}
 		
 		/* Find the ancestor points of each node point and copy their classified colors: */
-		unsigned int firstI=(threadIndex*currentNode->getNumPoints())/numThreads;
-		unsigned int lastI=((threadIndex+1)*currentNode->getNumPoints())/numThreads;
-		for(unsigned int i=firstI;i<lastI;++i)
+		for(unsigned int i=0;i<node.getNumPoints();++i)
 			{
 			/* Find the child node containing this point's ancestor: */
-			int pointChildIndex=currentNode->getDomain().findChild((*currentNode)[i]);
-			LidarProcessOctree::Node* pointChild=currentChildren[pointChildIndex];
+			int pointChildIndex=node.getDomain().findChild(node[i]);
+			LidarProcessOctree::Node* pointChild=children[pointChildIndex];
 			
 			/* Find the point's ancestor: */
-			FindPoint fp((*currentNode)[i]);
+			FindPoint fp(node[i]);
 			lpo.processNodePointsDirected(pointChild,fp);
 			if(fp.getFoundPoint()==0)
 				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Inconsistent octree");
@@ -276,113 +353,80 @@ void* PaulBunyan::subsampleThreadMethod(unsigned int threadIndex)
 			/* Copy the ancestor's color: */
 			colorBuffer[i]=childColorBuffers[pointChildIndex][fp.getFoundPoint()-pointChild->getPoints()];
 			}
-		
-		/* Synchronize on the subsampling barrier to signal job completion: */
-		subsampleBarrier.synchronize();
 		}
 	
-	return 0;
+	/* Write the node's colors to the color file: */
+	writeColors(colorBuffer,node.getDataOffset(),node.getNumPoints());
 	}
 
-PaulBunyan::PaulBunyan(LidarProcessOctree& sLpo,const Axe& sAxe,const char* colorFileName,const char* pointFileName,unsigned int sNumThreads)
+PaulBunyan::PaulBunyan(LidarProcessOctree& sLpo,const Axe& sAxe,const char* colorFileName,const char* pointFileName)
 	:lpo(sLpo),axe(sAxe),
-	 colorBuffer(new Color[lpo.getMaxNumPointsPerNode()]),
 	 colorDataSize(sizeof(Color)),
-	 colorFile(colorFileName,LidarFile::ReadWrite),
+	 colorFd(-1),
 	 pointFile(0),
-	 numThreads(sNumThreads),shutdownThreads(false),
-	 calcThreads(new Threads::Thread[numThreads]),calcBarrier(numThreads+1),
-	 subsampleThreads(new Threads::Thread[numThreads]),subsampleBarrier(numThreads+1),
-	 currentNode(0),
-	 numProcessedNodes(0)
+	 numProcessedNodes(0),nextProgressUpdate((lpo.getNumNodes()+199)/200)
+	{
 	{
-	/* Allocate the child color buffers: */
-	for(int i=0;i<8;++i)
-		childColorBuffers[i]=new Color[lpo.getMaxNumPointsPerNode()];
-	
 	/* Write the color file's header: */
+	LidarFile colorFile(colorFileName,LidarFile::ReadWrite);
 	colorFile.setEndianness(Misc::LittleEndian);
 	LidarDataFileHeader dfh((unsigned int)(colorDataSize));
 	dfh.write(colorFile);
+	}
+	
+	/* Reopen the color file for positional reads and writes: */
+	colorFd=open(colorFileName,O_RDWR);
+	if(colorFd<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot open color file %s",colorFileName);
 	
 	if(pointFileName!=0)
 		{
 		/* Open the point file: */
 		pointFile=fopen(pointFileName,"wt");
 		}
-	
-	/* Start the worker threads: */
-	for(unsigned int i=0;i<numThreads;++i)
-		{
-		calcThreads[i].start(this,&PaulBunyan::calcThreadMethod,i);
-		subsampleThreads[i].start(this,&PaulBunyan::subsampleThreadMethod,i);
-		}
 	}
 
 PaulBunyan::~PaulBunyan(void)
 	{
-	/* Shut down all threads: */
-	shutdownThreads=true;
-	calcBarrier.synchronize();
-	subsampleBarrier.synchronize();
-	for(unsigned int i=0;i<numThreads;++i)
+	close(colorFd);
+	for(std::vector<Buffers*>::iterator bIt=idleBuffers.begin();bIt!=idleBuffers.end();++bIt)
 		{
-		calcThreads[i].join();
-		subsampleThreads[i].join();
+		delete[] (*bIt)->colorBuffer;
+		for(int i=0;i<8;++i)
+			delete[] (*bIt)->childColorBuffers[i];
+		delete *bIt;
 		}
-	delete[] calcThreads;
-	delete[] subsampleThreads;
-	
-	delete[] colorBuffer;
-	for(int i=0;i<8;++i)
-		delete[] childColorBuffers[i];
 	if(pointFile!=0)
 		fclose(pointFile);
 	}
 
 void PaulBunyan::operator()(LidarProcessOctree::Node& node,unsigned int nodeLevel)
 	{
-	currentNode=&node;
-	
-	if(currentNode->getNumPoints()>0)
+	/* Process the node using a set of scratch buffers: */
+	Buffers* buffers=acquireBuffers();
+	std::string nodeErrorMessage;
+	try
 		{
-		if(currentNode->isLeaf())
-			{
-			/* Wake up the calculation threads: */
-			calcBarrier.synchronize();
-			
-			/* Wait for their completion: */
-			calcBarrier.synchronize();
-			}
-		else
-			{
-			/* Get pointers to the node's children and load their classified color arrays: */
-			for(int childIndex=0;childIndex<8;++childIndex)
-				{
-				currentChildren[childIndex]=lpo.getChild(currentNode,childIndex);
-				if(currentChildren[childIndex]->getNumPoints()>0)
-					{
-					colorFile.setReadPosAbs(LidarDataFileHeader::getFileSize()+colorDataSize*currentChildren[childIndex]->getDataOffset());
-					colorFile.read(childColorBuffers[childIndex],currentChildren[childIndex]->getNumPoints());
-					}
-				}
-			
-			/* Wake up the subsampling threads: */
-			subsampleBarrier.synchronize();
-			
-			/* Wait for their completion: */
-			subsampleBarrier.synchronize();
-			}
+		processNode(node,*buffers);
 		}
-	
-	/* Write the node's colors to the color file: */
-	colorFile.setWritePosAbs(LidarDataFileHeader::getFileSize()+colorDataSize*currentNode->getDataOffset());
-	colorFile.write(colorBuffer,currentNode->getNumPoints());
+	catch(const std::runtime_error& err)
+		{
+		/* Parallel traversals do not allow exceptions; remember the error instead: */
+		nodeErrorMessage=err.what();
+		}
+	releaseBuffers(buffers);
 	
 	/* Update the progress counter: */
+	Threads::Mutex::Lock statusLock(statusMutex);
+	if(errorMessage.empty())
+		errorMessage=nodeErrorMessage;
 	++numProcessedNodes;
-	int percent=int((numProcessedNodes*100+lpo.getNumNodes()/2)/lpo.getNumNodes());
-	std::cout<<"\b\b\b\b"<<std::setw(3)<<percent<<"%"<<std::flush;
+	if(numProcessedNodes>=nextProgressUpdate)
+		{
+		int percent=int((numProcessedNodes*100+lpo.getNumNodes()/2)/lpo.getNumNodes());
+		std::cout<<"\rWielding axe... "<<std::setw(3)<<percent<<"%"<<std::flush;
+		nextProgressUpdate=((percent+1)*lpo.getNumNodes()-lpo.getNumNodes()/2+99)/100;
+		}
 	}
 
 int main(int argc,char* argv[])
@@ -442,6 +486,7 @@ int main(int argc,char* argv[])
 	
 	/* Create a processing octree: */
 	LidarProcessOctree lpo(lidarFileName,size_t(cacheSize)*size_t(1024*1024));
+	lpo.startPrefetching();
 	
 	/* Create an axe: */
 	Axe axe(radius,tolerance,maxAngle);
@@ -450,10 +495,18 @@ int main(int argc,char* argv[])
 	std::string lidarColorFileName=lidarFileName;
 	lidarColorFileName.push_back('/');
 	lidarColorFileName.append(colorFileName);
-	PaulBunyan paulBunyan(lpo,axe,lidarColorFileName.c_str(),groundPointFileName,numThreads);
+	PaulBunyan paulBunyan(lpo,axe,lidarColorFileName.c_str(),groundPointFileName);
 	std::cout<<"Wielding axe...   0%"<<std::flush;
-	lpo.processNodesPostfix(paulBunyan);
+	if(numThreads>1)
+		lpo.processNodesPostfixParallel(paulBunyan,numThreads);
+	else
+		lpo.processNodesPostfix(paulBunyan);
 	std::cout<<std::endl;
+	if(!paulBunyan.getErrorMessage().empty())
+		{
+		std::cerr<<"Error while wielding axe: "<<paulBunyan.getErrorMessage()<<std::endl;
+		return 1;
+		}
 	
 	return 0;
 	}
@@ -1,6 +1,6 @@
 /***********************************************************************
 PlanePrimitive - Class for planes extracted from point clouds.
-Copyright (c) 2007-2020 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -37,7 +37,6 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #endif
 
 #include "LidarOctree.h"
-#include "LidarPlaneExtractor.h"
 #include "LidarPlaneFitter.h"
 
 /*****************************************
@@ -71,19 +70,16 @@ Methods of class PlanePrimitive:
 
 PlanePrimitive::PlanePrimitive(const LidarOctree* octree,const Primitive::Vector& translation)
 	{
-	/* Create a LiDAR plane extractor: */
-	LidarPlaneExtractor lpe;
+	/* Get the moments of the selected points, which the octree maintains while points are selected and deselected: */
+	SelectionMoments moments=octree->getSelectionMoments();
 	
-	/* Process all selected points: */
-	octree->processSelectedPoints(lpe);
-	
-	if(lpe.getNumPoints()>=3)
+	if(moments.getNumPoints()>=3)
 		{
 		/* Extract the plane's coordinate frame: */
-		LidarPlaneExtractor::Point centroid;
-		LidarPlaneExtractor::Vector planeFrame[3];
+		SelectionMoments::Point centroid=moments.calcCentroid();
+		SelectionMoments::Vector planeFrame[3];
 		double lengths[3];
-		lpe.calcPlane(centroid,planeFrame,lengths);
+		moments.calcPrincipalAxes(lengths,planeFrame);
 		
 		/* Ensure that (planeFrame, planeNormal) is a right-handed system, and that planeNormal points "up:" */
 		if(planeFrame[2][2]<0.0)
@@ -101,7 +97,7 @@ PlanePrimitive::PlanePrimitive(const LidarOctree* octree,const Primitive::Vector
 		octree->processSelectedPoints(lpf);
 		
 		/* Store the number of points and the RMS residual: */
-		numPoints=Misc::UInt64(lpe.getNumPoints());
+		numPoints=Misc::UInt64(moments.getNumPoints());
 		rms=Scalar(lpf.getRMS());
 		
 		/* Calculate the extracted plane's rectangle: */
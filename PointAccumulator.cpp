@@ -25,37 +25,112 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include <string.h>
 #include <utility>
+#include <stdexcept>
 #include <iostream>
 #include <iomanip>
 #include <Misc/Timer.h>
+#include <Math/Math.h>
 #include <Math/Constants.h>
 
 #include "TempOctree.h"
+#include "TraceEvents.h"
 
 /*********************************
 Methods of class PointAccumulator:
 *********************************/
 
+void* PointAccumulator::spillThreadMethod(void)
+	{
+	TraceEvents::setThreadName("Temporary octree writer");
+	
+	while(true)
+		{
+		/* Wait for the next full point buffer: */
+		{
+		Threads::MutexCond::Lock spillLock(spillCond);
+		while(spillThreadRun&&!spillPending)
+			spillCond.wait(spillLock);
+		if(!spillPending)
+			break;
+		}
+		
+		/* Create a temporary octree for the full point buffer while the main thread keeps accumulating points: */
+		char tofnt[1024];
+		strcpy(tofnt,spillFileNameTemplate.c_str());
+		TraceEvents::Scope traceScope("WriteTempOctree","PointAccumulator");
+		Misc::Timer t;
+		TempOctree* to=0;
+		std::string errorMessage;
+		try
+			{
+			to=new TempOctree(tofnt,spillMaxNumPointsPerNode,&spillPoints[0],spillPoints.size(),spillNumThreads);
+			t.elapse();
+			std::cout<<std::endl<<"Stored "<<spillPoints.size()<<" points as temporary octree in "<<t.getTime()*1000.0<<" ms"<<std::endl;
+			}
+		catch(const std::runtime_error& err)
+			{
+			/* Remember the error to throw it from the main thread: */
+			errorMessage=err.what();
+			}
+		
+		/* Hand the temporary octree or the error, and the emptied point buffer back to the main thread: */
+		Threads::MutexCond::Lock spillLock(spillCond);
+		if(to!=0)
+			tempOctrees.push_back(to);
+		else if(spillErrorMessage.empty())
+			spillErrorMessage=errorMessage;
+		spillPoints.clear();
+		spillPending=false;
+		spillCond.broadcast();
+		}
+	
+	return 0;
+	}
+
+void PointAccumulator::waitForSpill(void)
+	{
+	Threads::MutexCond::Lock spillLock(spillCond);
+	while(spillPending)
+		spillCond.wait(spillLock);
+	
+	/* Throw the spill thread's error on the main thread: */
+	if(!spillErrorMessage.empty())
+		{
+		std::string errorMessage;
+		std::swap(errorMessage,spillErrorMessage);
+		throw std::runtime_error(errorMessage);
+		}
+	}
+
 void PointAccumulator::savePoints(void)
 	{
-	/* Create a temporary octree for the current in-memory point set: */
-	std::cout<<std::endl<<"Storing "<<points.size()<<" points as temporary octree..."<<std::flush;
-	char tofnt[1024];
-	strcpy(tofnt,tempOctreeFileNameTemplate.c_str());
-	Misc::Timer t;
-	TempOctree* to=new TempOctree(tofnt,maxNumPointsPerNode,&points[0],points.size());
-	t.elapse();
-	std::cout<<" done in "<<t.getTime()*1000.0<<" ms"<<std::endl;
-	tempOctrees.push_back(to);
+	/* Wait until the spill thread has finished the previous point buffer: */
+	waitForSpill();
+	
+	{
+	Threads::MutexCond::Lock spillLock(spillCond);
+	
+	/* Hand the current point set to the spill thread and continue accumulating into the emptied buffer: */
+	std::swap(points,spillPoints);
+	spillFileNameTemplate=tempOctreeFileNameTemplates[nextTempOctreeFileNameTemplate];
+	nextTempOctreeFileNameTemplate=(nextTempOctreeFileNameTemplate+1)%tempOctreeFileNameTemplates.size();
+	spillMaxNumPointsPerNode=maxNumPointsPerNode;
+	spillNumThreads=numTempOctreeThreads;
+	spillPending=true;
+	spillCond.broadcast();
+	}
 	
-	/* Clear the point set: */
-	points.clear();
+	/* Make sure the new in-memory point buffer does not have to grow while accumulating: */
+	points.reserve(maxNumBufferedPoints);
 	}
 
 PointAccumulator::PointAccumulator(void)
-	:maxNumCacheablePoints(~0x0U),
+	:maxNumCacheablePoints(~0x0U),maxNumBufferedPoints(~0x0U),
 	 maxNumPointsPerNode(4096),
-	 tempOctreeFileNameTemplate("/tmp/LidarPreprocessorTempOctreeXXXXXX"),
+	 tempOctreeFileNameTemplates(1,"/tmp/LidarPreprocessorTempOctreeXXXXXX"),nextTempOctreeFileNameTemplate(0),
+	 numTempOctreeThreads(1),
+	 spillPending(false),spillMaxNumPointsPerNode(4096),spillNumThreads(1),
+	 spillThreadRun(true),spillThread(this,&PointAccumulator::spillThreadMethod),
 	 havePointOffset(false),pointOffset(Vector::zero),
 	 haveTransform(false),transform(ATransform::identity)
 	{
@@ -66,6 +141,14 @@ PointAccumulator::PointAccumulator(void)
 
 PointAccumulator::~PointAccumulator(void)
 	{
+	/* Shut down the spill thread after it has finished any pending point buffer: */
+	{
+	Threads::MutexCond::Lock spillLock(spillCond);
+	spillThreadRun=false;
+	spillCond.broadcast();
+	}
+	spillThread.join();
+	
 	/* Delete all temporary octrees: */
 	for(std::vector<TempOctree*>::iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
 		delete *toIt;
@@ -77,20 +160,38 @@ void PointAccumulator::setMemorySize(size_t memorySize,unsigned int newMaxNumPoi
 	maxNumCacheablePoints=(memorySize*1024U*1024U+sizeof(LidarPoint)-1)/sizeof(LidarPoint);
 	maxNumPointsPerNode=newMaxNumPointsPerNode;
 	
+	/* Split the memory limit between the accumulating and the spilling point buffers: */
+	maxNumBufferedPoints=(maxNumCacheablePoints+1)/2;
+	
 	/* Check if the current point set is already too large: */
-	if(points.size()>maxNumCacheablePoints)
+	if(points.size()>maxNumBufferedPoints)
 		{
 		/* Save the current point set: */
 		savePoints();
 		}
 	
 	/* Allocate the maximum amount of memory for the in-memory point set: */
-	points.reserve(maxNumCacheablePoints);
+	points.reserve(maxNumBufferedPoints);
 	}
 
 void PointAccumulator::setTempOctreeFileNameTemplate(std::string newTempOctreeFileNameTemplate)
 	{
-	tempOctreeFileNameTemplate=newTempOctreeFileNameTemplate;
+	tempOctreeFileNameTemplates.clear();
+	tempOctreeFileNameTemplates.push_back(newTempOctreeFileNameTemplate);
+	nextTempOctreeFileNameTemplate=0;
+	}
+
+void PointAccumulator::setTempOctreeFileNameTemplates(const std::vector<std::string>& newTempOctreeFileNameTemplates,unsigned int firstTemplateIndex)
+	{
+	if(newTempOctreeFileNameTemplates.empty())
+		return;
+	tempOctreeFileNameTemplates=newTempOctreeFileNameTemplates;
+	nextTempOctreeFileNameTemplate=firstTemplateIndex%tempOctreeFileNameTemplates.size();
+	}
+
+void PointAccumulator::setNumTempOctreeThreads(unsigned int newNumTempOctreeThreads)
+	{
+	numTempOctreeThreads=newNumTempOctreeThreads>0?newNumTempOctreeThreads:1U;
 	}
 
 void PointAccumulator::setPointOffset(const PointAccumulator::Vector& newPointOffset)
@@ -137,6 +238,82 @@ void PointAccumulator::printExtents(void) const
 		std::cout<<"RGB range: <empty>"<<std::endl;
 	}
 
+void PointAccumulator::addPoints(size_t numPoints,const PointAccumulator::Point newPoints[],const PointAccumulator::Color newColors[])
+	{
+	while(numPoints>0)
+		{
+		/* Check if the current in-memory point set is full: */
+		if(points.size()>=maxNumBufferedPoints)
+			{
+			/* Save the current point set: */
+			savePoints();
+			}
+		
+		/* Append as many of the new points as fit into the current point set in one batch: */
+		size_t batchSize=maxNumBufferedPoints-points.size();
+		if(batchSize>numPoints)
+			batchSize=numPoints;
+		size_t first=points.size();
+		points.resize(first+batchSize);
+		LidarPoint* lpPtr=&points[first];
+		
+		/* Store the new points' positions and reduce their bounding box: */
+		Vector offset=havePointOffset?pointOffset:Vector::zero;
+		Point pMin=Point(Math::Constants<double>::max,Math::Constants<double>::max,Math::Constants<double>::max);
+		Point pMax=Point(Math::Constants<double>::min,Math::Constants<double>::min,Math::Constants<double>::min);
+		if(haveTransform)
+			{
+			for(size_t i=0;i<batchSize;++i)
+				{
+				Point pt=transform.transform(newPoints[i]+offset);
+				for(int j=0;j<3;++j)
+					{
+					pMin[j]=Math::min(pMin[j],pt[j]);
+					pMax[j]=Math::max(pMax[j],pt[j]);
+					}
+				lpPtr[i]=LidarPoint::Point(pt);
+				}
+			}
+		else
+			{
+			for(size_t i=0;i<batchSize;++i)
+				{
+				Point pt=newPoints[i]+offset;
+				for(int j=0;j<3;++j)
+					{
+					pMin[j]=Math::min(pMin[j],pt[j]);
+					pMax[j]=Math::max(pMax[j],pt[j]);
+					}
+				lpPtr[i]=LidarPoint::Point(pt);
+				}
+			}
+		bounds.addPoint(pMin);
+		bounds.addPoint(pMax);
+		
+		/* Store the new points' colors and reduce their color space extents: */
+		Color cMin=Color(Math::Constants<float>::max,Math::Constants<float>::max,Math::Constants<float>::max);
+		Color cMax=Color(Math::Constants<float>::min,Math::Constants<float>::min,Math::Constants<float>::min);
+		for(size_t i=0;i<batchSize;++i)
+			{
+			for(int j=0;j<3;++j)
+				{
+				float col=newColors[i][j]*colorMask[j];
+				cMin[j]=Math::min(cMin[j],col);
+				cMax[j]=Math::max(cMax[j],col);
+				lpPtr[i].value[j]=::Color::clampRound(col);
+				}
+			lpPtr[i].value[3]=::Color::Scalar(255);
+			}
+		colorBounds.addPoint(cMin);
+		colorBounds.addPoint(cMax);
+		
+		/* Go to the next batch: */
+		newPoints+=batchSize;
+		newColors+=batchSize;
+		numPoints-=batchSize;
+		}
+	}
+
 void PointAccumulator::finishReading(void)
 	{
 	if(!points.empty())
@@ -145,13 +322,21 @@ void PointAccumulator::finishReading(void)
 		savePoints();
 		}
 	
-	/* A hackety-hack to release the point vector's allocated memory: */
+	/* Wait until all point buffers have been written: */
+	waitForSpill();
+	
+	/* A hackety-hack to release the point buffers' allocated memory: */
 	std::vector<LidarPoint> empty;
 	std::swap(points,empty);
+	std::vector<LidarPoint> emptySpill;
+	std::swap(spillPoints,emptySpill);
 	}
 
 void PointAccumulator::deleteTempOctrees(void)
 	{
+	/* Wait until any pending point buffer has been written: */
+	waitForSpill();
+	
 	/* Delete all temporary octrees: */
 	for(std::vector<TempOctree*>::iterator toIt=tempOctrees.begin();toIt!=tempOctrees.end();++toIt)
 		delete *toIt;
@@ -30,6 +30,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <Geometry/Vector.h>
 #include <Geometry/Box.h>
 #include <Geometry/AffineTransformation.h>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
 
 #include "LidarTypes.h"
 
@@ -47,13 +49,60 @@ class PointAccumulator
 	typedef Geometry::Point<float,3> Color; // Type for float-valued colors
 	typedef Geometry::Box<float,3> ColorBox; // Type for float-valued axis-aligned boxes
 	
+	class Batch // Helper class to collect points from a loader and push them into a point accumulator in batches
+		{
+		/* Elements: */
+		private:
+		PointAccumulator& pa; // The point accumulator receiving the collected points
+		size_t maxNumPoints; // Number of points collected before they are pushed into the point accumulator
+		std::vector<Point> points; // Buffer of collected point positions
+		std::vector<Color> colors; // Buffer of collected point colors
+		size_t numPoints; // Number of points currently in the buffers
+		
+		/* Constructors and destructors: */
+		public:
+		Batch(PointAccumulator& sPa,size_t sMaxNumPoints =65536) // Creates an empty batch for the given point accumulator; points not flushed before destruction are discarded
+			:pa(sPa),maxNumPoints(sMaxNumPoints),
+			 points(maxNumPoints),colors(maxNumPoints),
+			 numPoints(0)
+			{
+			}
+		
+		/* Methods: */
+		void addPoint(const Point& p,const Color& c) // Adds a point to the batch
+			{
+			points[numPoints]=p;
+			colors[numPoints]=c;
+			if(++numPoints==maxNumPoints)
+				flush();
+			}
+		void flush(void) // Pushes all collected points into the point accumulator
+			{
+			if(numPoints>0)
+				pa.addPoints(numPoints,&points[0],&colors[0]);
+			numPoints=0;
+			}
+		};
+	
 	/* Elements: */
 	private:
 	size_t maxNumCacheablePoints; // Maximum number of points allowed in memory at a time
+	size_t maxNumBufferedPoints; // Maximum number of points in each of the two in-memory point buffers
 	std::vector<LidarPoint> points; // Vector holding current in-memory point set
 	unsigned int maxNumPointsPerNode; // Maximum number of points per node in the temporary octrees
-	std::string tempOctreeFileNameTemplate; // File name template for temporary octrees
+	std::vector<std::string> tempOctreeFileNameTemplates; // File name templates for temporary octrees, used in round-robin order to spread temporary octrees across scratch volumes
+	unsigned int nextTempOctreeFileNameTemplate; // Index of the file name template to be used for the next temporary octree
+	unsigned int numTempOctreeThreads; // Number of threads used to create each temporary octree
 	std::vector<TempOctree*> tempOctrees; // List of temporary octrees holding out-of-memory point sets
+	Threads::MutexCond spillCond; // Condition variable protecting the spill buffer and the temporary octree list, signaled when a spill starts or finishes
+	std::vector<LidarPoint> spillPoints; // Full point buffer currently being written to a temporary octree by the spill thread
+	bool spillPending; // Flag if the spill buffer holds points that have not been written yet
+	std::string spillErrorMessage; // Message of the exception that stopped the spill thread from writing a point buffer, or empty
+	std::string spillFileNameTemplate; // File name template for the temporary octree currently being written
+	unsigned int spillMaxNumPointsPerNode; // Maximum number of points per node in the temporary octree currently being written
+	unsigned int spillNumThreads; // Number of threads creating the temporary octree currently being written
+	volatile bool spillThreadRun; // Flag to shut down the spill thread
+	Threads::Thread spillThread; // Thread writing full point buffers to temporary octrees in the background
 	bool havePointOffset; // Flag if there is a current point offset
 	Vector pointOffset; // Offset vector applied to incoming points before the (optional) transformation is applied
 	bool haveTransform; // Flag if there is a current point transformation
@@ -63,7 +112,9 @@ class PointAccumulator
 	ColorBox colorBounds; // Color space extents of currently added point set
 	
 	/* Private methods: */
-	void savePoints(void); // Saves the current in-memory point set to a temporary octree file
+	void* spillThreadMethod(void); // Thread method writing full point buffers to temporary octree files
+	void waitForSpill(void); // Waits until the spill thread has written any pending point buffer; throws the exception that stopped the spill thread from writing a point buffer, if any
+	void savePoints(void); // Hands the current in-memory point set to the spill thread to be saved to a temporary octree file
 	
 	/* Constructors and destructors: */
 	public:
@@ -71,7 +122,7 @@ class PointAccumulator
 	~PointAccumulator(void); // Destroys the point accumulator
 	
 	/* Methods: */
-	size_t getMaxNumCacheablePoints(void) const // Returns the maximum number of points to be held in memory
+	size_t getMaxNumCacheablePoints(void) const // Returns the maximum number of points to be held in memory, in both point buffers combined
 		{
 		return maxNumCacheablePoints;
 		}
@@ -81,6 +132,8 @@ class PointAccumulator
 		}
 	void setMemorySize(size_t memorySize,unsigned int newMaxNumPointsPerNode); // Limits the point accumulator to the given amount of memory in megabytes
 	void setTempOctreeFileNameTemplate(std::string newTempOctreeFileNameTemplate); // Sets the template for temporary octree file names
+	void setTempOctreeFileNameTemplates(const std::vector<std::string>& newTempOctreeFileNameTemplates,unsigned int firstTemplateIndex =0); // Sets a list of templates for temporary octree file names to be used in round-robin order, starting with the given list index
+	void setNumTempOctreeThreads(unsigned int newNumTempOctreeThreads); // Sets the number of threads used to create each temporary octree
 	void setPointOffset(const Vector& newPointOffset); // Sets the point offset
 	void resetPointOffset(void); // Resets the point offset
 	const Vector& getPointOffset(void) const // Returns the current point offset
@@ -100,13 +153,25 @@ class PointAccumulator
 		transform=newTransform;
 		}
 	void resetTransform(void); // Turns off point transformations
+	bool hasTransform(void) const // Returns true if there is a current point transformation
+		{
+		return haveTransform;
+		}
+	const ATransform& getTransform(void) const // Returns the current point transformation
+		{
+		return transform;
+		}
 	void setColorMask(const float newColorMask[3]); // Sets the current color mask
+	const float* getColorMask(void) const // Returns the current color mask
+		{
+		return colorMask;
+		}
 	void resetExtents(void); // Resets the accumulated spatial and color space extents
 	void printExtents(void) const; // Prints the currently accumulated spatial and color space extents
 	void addPoint(const Point& p,const Color& c) // Pushes a double-valued colored point into the current point set
 		{
 		/* Check if the current in-memory point set is too big: */
-		if(points.size()==maxNumCacheablePoints)
+		if(points.size()>=maxNumBufferedPoints)
 			{
 			/* Save the current point set: */
 			savePoints();
@@ -136,7 +201,8 @@ class PointAccumulator
 		
 		points.push_back(lp);
 		}
-	void finishReading(void); // Finishes reading points from source files
+	void addPoints(size_t numPoints,const Point newPoints[],const Color newColors[]); // Pushes an array of double-valued colored points into the current point set
+	void finishReading(void); // Finishes reading points from source files by writing all buffered points and releasing the point buffers; can be called more than once
 	std::vector<TempOctree*>& getTempOctrees(void) // Returns the list of temporary octrees
 		{
 		return tempOctrees;
@@ -0,0 +1,109 @@
+/***********************************************************************
+PointArrayPool - Helper class to allocate fixed-size point arrays for
+octree nodes from large slabs, and to recycle the arrays of evicted
+nodes without returning them to the heap.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef POINTARRAYPOOL_INCLUDED
+#define POINTARRAYPOOL_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Threads/Mutex.h>
+
+class PointArrayPool
+	{
+	/* Elements: */
+	private:
+	size_t arraySize; // Size of each array in bytes, rounded up to keep arrays aligned inside slabs
+	size_t numArraysPerSlab; // Number of arrays allocated from the heap at once
+	Threads::Mutex mutex; // Mutex serializing access to the free list
+	std::vector<char*> slabs; // List of slabs allocated from the heap
+	std::vector<void*> freeArrays; // Stack of unused arrays
+	size_t numUsedArrays; // Number of arrays currently handed out
+	
+	/* Constructors and destructors: */
+	public:
+	PointArrayPool(size_t sArraySize,size_t cacheSize) // Creates an empty pool for arrays of the given size in bytes, for a cache holding the given number of arrays
+		:arraySize((sArraySize+15)&~size_t(15)),
+		 numArraysPerSlab(cacheSize/16),
+		 numUsedArrays(0)
+		{
+		/* Grow the pool in slabs of 1/16th of the cache, but not in slabs that are too small or too large: */
+		if(numArraysPerSlab<4)
+			numArraysPerSlab=4;
+		if(numArraysPerSlab>256)
+			numArraysPerSlab=256;
+		
+		/* Make room to recycle the arrays of a full cache without reallocating the free list: */
+		freeArrays.reserve(cacheSize+numArraysPerSlab);
+		}
+	private:
+	PointArrayPool(const PointArrayPool& source); // Prohibit copy constructor
+	PointArrayPool& operator=(const PointArrayPool& source); // Prohibit assignment operator
+	public:
+	~PointArrayPool(void) // Releases all slabs; all arrays must have been returned to the pool
+		{
+		for(std::vector<char*>::iterator sIt=slabs.begin();sIt!=slabs.end();++sIt)
+			delete[] *sIt;
+		}
+	
+	/* Methods: */
+	size_t getNumUsedArrays(void) const // Returns the number of arrays currently handed out
+		{
+		return numUsedArrays;
+		}
+	size_t getMemorySize(void) const // Returns the total size of all slabs allocated from the heap in bytes
+		{
+		return slabs.size()*numArraysPerSlab*arraySize;
+		}
+	template <class ElementParam>
+	ElementParam* allocate(void) // Returns an unused array; array contents are undefined
+		{
+		Threads::Mutex::Lock lock(mutex);
+		
+		if(freeArrays.empty())
+			{
+			/* Allocate a new slab and put its arrays on the free list: */
+			char* slab=new char[numArraysPerSlab*arraySize];
+			slabs.push_back(slab);
+			for(size_t i=numArraysPerSlab;i>0;--i)
+				freeArrays.push_back(slab+(i-1)*arraySize);
+			}
+		
+		/* Take the most recently freed array: */
+		void* result=freeArrays.back();
+		freeArrays.pop_back();
+		++numUsedArrays;
+		return static_cast<ElementParam*>(result);
+		}
+	void free(void* array) // Returns an array to the pool; ignores null pointers
+		{
+		if(array!=0)
+			{
+			Threads::Mutex::Lock lock(mutex);
+			freeArrays.push_back(array);
+			--numUsedArrays;
+			}
+		}
+	};
+
+#endif
@@ -1,7 +1,7 @@
 /***********************************************************************
 PointBasedLightingShader - Class to maintain a GLSL point-based lighting
 shader that tracks the current OpenGL lighting state.
-Copyright (c) 2008-2025 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -36,6 +36,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <GL/Extensions/GLARBVertexShader.h>
 #include <GL/Extensions/GLARBGeometryShader4.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
+#include <GL/Extensions/GLARBPointSprite.h>
 
 /*****************************************
 Methods of class PointBasedLightingShader:
@@ -58,6 +59,14 @@ void PointBasedLightingShader::compileShader(void)
 			uniform sampler1D planeDistanceMap;\n\
 			\n";
 		}
+	else if(useAttributeMap)
+		{
+		/* Create the attribute mapping uniforms: */
+		vertexShaderDefines+="\
+			uniform vec2 attributeMapScaleOffset;\n\
+			uniform sampler1D attributeMap;\n\
+			\n";
+		}
 	
 	/* Create the main vertex shader starting boilerplate: */
 	vertexShaderMain+="\
@@ -130,6 +139,13 @@ void PointBasedLightingShader::compileShader(void)
 		
 		#endif
 		}
+	else if(useAttributeMap)
+		{
+		vertexShaderMain+="\
+			/* Get the material properties by mapping the attribute value stored in the current color's alpha component: */\n\
+			vec4 ambient=texture1D(attributeMap,gl_Color.a*attributeMapScaleOffset.x+attributeMapScaleOffset.y);\n\
+			vec4 diffuse=ambient;\n";
+		}
 	else if(usePointColors)
 		{
 		if(correctGamma)
@@ -194,7 +210,43 @@ void PointBasedLightingShader::compileShader(void)
 	vertexShaderMain+=cpt.createCalcClipDistances("vertexEc");
 	
 	/* Finish the main vertex shader: */
-	if(useSplatting)
+	if(useSplatting&&havePointSprites)
+		{
+		/* Create the splatting uniforms and varyings: */
+		vertexShaderDefines+="\
+			uniform float surfelSize;\n\
+			uniform vec4 viewport;\n\
+			varying vec3 splatCenter;\n\
+			varying vec3 splatNormal;\n\
+			varying float splatRadius2;\n\
+			\n";
+		
+		vertexShaderMain+="\
+				/* Pass the eye-coordinate splat disk to the fragment shader: */\n\
+				float splatRadius=length(gl_Normal)*surfelSize;\n\
+				splatCenter=vertexEc.xyz/vertexEc.w;\n\
+				splatNormal=normalEc;\n\
+				splatRadius2=splatRadius*splatRadius;\n\
+				\n\
+				/* Calculate a point size that covers the splat disk's projection: */\n\
+				gl_Position=gl_ProjectionMatrix*vertexEc;\n\
+				float pixelScale=max(gl_ProjectionMatrix[0][0]*viewport.z,gl_ProjectionMatrix[1][1]*viewport.w)*0.5;\n\
+				float pixelRadius;\n\
+				if(gl_ProjectionMatrix[2][3]!=0.0)\n\
+					{\n\
+					/* Bound the perspective projection of the splat's bounding sphere, including off-axis stretching: */\n\
+					float depth=-splatCenter.z;\n\
+					if(depth-splatRadius>depth*1.0e-3)\n\
+						pixelRadius=pixelScale*splatRadius*length(splatCenter)/((depth-splatRadius)*depth);\n\
+					else\n\
+						pixelRadius=1.0e4;\n\
+					}\n\
+				else\n\
+					pixelRadius=pixelScale*splatRadius;\n\
+				gl_PointSize=pixelRadius*2.0+2.0;\n\
+				}\n";
+		}
+	else if(useSplatting)
 		{
 		/* Create the splatting varyings: */
 		vertexShaderDefines+="\
@@ -219,21 +271,53 @@ void PointBasedLightingShader::compileShader(void)
 				}\n";
 		}
 	
-	/* Compile the vertex shader: */
+	/* Assemble the vertex shader: */
 	std::string vertexShaderSource=vertexShaderDefines+vertexShaderFunctions+vertexShaderMain;
-	glCompileShaderFromString(vertexShader,vertexShaderSource.c_str());
 	
-	if(useSplatting)
+	/* Select the geometry and fragment shaders: */
+	const char* geometryShaderSource=0;
+	const char* fragmentShaderSource;
+	if(useSplatting&&havePointSprites)
 		{
-		if(!geometryShaderAttached)
-			{
-			/* Attach the geometry shader to the program object: */
-			glAttachObjectARB(programObject,geometryShader);
-			geometryShaderAttached=true;
-			}
-		
-		/* Compile the surfel generation geometry shader: */
-		const char* geometryShaderSource="\
+		/* Use the ray-casting splat fragment shader: */
+		fragmentShaderSource=
+			"\
+			uniform vec4 viewport;\n\
+			varying vec3 splatCenter;\n\
+			varying vec3 splatNormal;\n\
+			varying float splatRadius2;\n\
+			\n\
+			void main()\n\
+				{\n\
+				/* Calculate the eye-coordinate ray through the fragment: */\n\
+				vec2 ndc=(gl_FragCoord.xy-viewport.xy)*2.0/viewport.zw-vec2(1.0);\n\
+				vec4 rayStart=gl_ProjectionMatrixInverse*vec4(ndc,-1.0,1.0);\n\
+				vec4 rayEnd=gl_ProjectionMatrixInverse*vec4(ndc,1.0,1.0);\n\
+				vec3 start=rayStart.xyz/rayStart.w;\n\
+				vec3 dir=rayEnd.xyz/rayEnd.w-start;\n\
+				\n\
+				/* Intersect the ray with the splat's plane: */\n\
+				float denominator=dot(splatNormal,dir);\n\
+				if(denominator==0.0)\n\
+					discard;\n\
+				vec3 hit=start+dir*(dot(splatNormal,splatCenter-start)/denominator);\n\
+				\n\
+				/* Discard fragments whose intersection lies outside the splat disk: */\n\
+				vec3 offset=hit-splatCenter;\n\
+				if(dot(offset,offset)>splatRadius2)\n\
+					discard;\n\
+				\n\
+				/* Write the depth of the intersection point: */\n\
+				vec4 hitClip=gl_ProjectionMatrix*vec4(hit,1.0);\n\
+				gl_FragDepth=(gl_DepthRange.diff*hitClip.z/hitClip.w+gl_DepthRange.near+gl_DepthRange.far)*0.5;\n\
+				\n\
+				gl_FragColor=gl_Color;\n\
+				}\n";
+		}
+	else if(useSplatting)
+		{
+		/* Use the surfel generation geometry shader: */
+		geometryShaderSource="\
 			#version 120\n\
 			#extension GL_ARB_geometry_shader4: enable\n\
 			\n\
@@ -276,15 +360,9 @@ void PointBasedLightingShader::compileShader(void)
 				gl_Position=gl_ProjectionMatrix*(gl_PositionIn[0]-vec4(x,0.0));\n\
 				EmitVertex();\n\
 				}\n";
-		glCompileShaderFromString(geometryShader,geometryShaderSource);
-		
-		/* Set the geometry shader's parameters: */
-		glProgramParameteriARB(programObject,GL_GEOMETRY_VERTICES_OUT_ARB,4);
-		glProgramParameteriARB(programObject,GL_GEOMETRY_INPUT_TYPE_ARB,GL_POINTS);
-		glProgramParameteriARB(programObject,GL_GEOMETRY_OUTPUT_TYPE_ARB,GL_TRIANGLE_STRIP);
 		
-		/* Compile the surfel fragment shader: */
-		const char* fragmentShaderSource=
+		/* Use the surfel fragment shader: */
+		fragmentShaderSource=
 			"\
 			void main()\n\
 				{\n\
@@ -294,68 +372,114 @@ void PointBasedLightingShader::compileShader(void)
 				\n\
 				gl_FragColor=gl_Color;\n\
 				}\n";
-		glCompileShaderFromString(fragmentShader,fragmentShaderSource);
 		}
 	else
 		{
-		if(geometryShaderAttached)
-			{
-			/* Detach the geometry shader from the program object: */
-			glDetachObjectARB(programObject,geometryShader);
-			geometryShaderAttached=false;
-			}
-		
-		/* Compile the standard fragment shader: */
-		const char* fragmentShaderSource=
+		/* Use the standard fragment shader: */
+		fragmentShaderSource=
 			"\
 			void main()\n\
 				{\n\
 				gl_FragColor=gl_Color;\n\
 				}\n";
+		}
+	
+	/* Use the program variant for the assembled shader sources if it was linked before, or link a new one: */
+	std::string variantKey=vertexShaderSource;
+	variantKey.push_back('\0');
+	if(geometryShaderSource!=0)
+		variantKey.append(geometryShaderSource);
+	variantKey.push_back('\0');
+	variantKey.append(fragmentShaderSource);
+	VariantHasher::Iterator vIt=variants.findEntry(variantKey);
+	if(vIt.isFinished())
+		{
+		current=linkVariant(vertexShaderSource.c_str(),geometryShaderSource,fragmentShaderSource);
+		variants.setEntry(VariantHasher::Entry(variantKey,current));
+		}
+	else
+		current=vIt->getDest();
+	}
+
+PointBasedLightingShader::ProgramVariant PointBasedLightingShader::linkVariant(const char* vertexShaderSource,const char* geometryShaderSource,const char* fragmentShaderSource) const
+	{
+	ProgramVariant result;
+	
+	/* Create the program object: */
+	result.programObject=glCreateProgramObjectARB();
+	try
+		{
+		/* Compile and attach the shaders; they will be deleted together with the program object: */
+		GLhandleARB vertexShader=glCreateShaderObjectARB(GL_VERTEX_SHADER_ARB);
+		glAttachObjectARB(result.programObject,vertexShader);
+		glDeleteObjectARB(vertexShader);
+		glCompileShaderFromString(vertexShader,vertexShaderSource);
+		
+		if(geometryShaderSource!=0)
+			{
+			GLhandleARB geometryShader=glCreateShaderObjectARB(GL_GEOMETRY_SHADER_ARB);
+			glAttachObjectARB(result.programObject,geometryShader);
+			glDeleteObjectARB(geometryShader);
+			glCompileShaderFromString(geometryShader,geometryShaderSource);
+			
+			/* Set the geometry shader's parameters: */
+			glProgramParameteriARB(result.programObject,GL_GEOMETRY_VERTICES_OUT_ARB,4);
+			glProgramParameteriARB(result.programObject,GL_GEOMETRY_INPUT_TYPE_ARB,GL_POINTS);
+			glProgramParameteriARB(result.programObject,GL_GEOMETRY_OUTPUT_TYPE_ARB,GL_TRIANGLE_STRIP);
+			}
+		
+		GLhandleARB fragmentShader=glCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB);
+		glAttachObjectARB(result.programObject,fragmentShader);
+		glDeleteObjectARB(fragmentShader);
 		glCompileShaderFromString(fragmentShader,fragmentShaderSource);
 		}
+	catch(...)
+		{
+		glDeleteObjectARB(result.programObject);
+		throw;
+		}
 	
 	/* Link the program object: */
-	glLinkProgramARB(programObject);
+	glLinkProgramARB(result.programObject);
 	
 	/* Check if the program linked successfully: */
 	GLint linkStatus;
-	glGetObjectParameterivARB(programObject,GL_OBJECT_LINK_STATUS_ARB,&linkStatus);
+	glGetObjectParameterivARB(result.programObject,GL_OBJECT_LINK_STATUS_ARB,&linkStatus);
 	if(!linkStatus)
 		{
 		/* Get some more detailed information: */
 		GLcharARB linkLogBuffer[2048];
 		GLsizei linkLogSize;
-		glGetInfoLogARB(programObject,sizeof(linkLogBuffer),&linkLogSize,linkLogBuffer);
+		glGetInfoLogARB(result.programObject,sizeof(linkLogBuffer),&linkLogSize,linkLogBuffer);
+		glDeleteObjectARB(result.programObject);
 		
 		/* Signal an error: */
 		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Error \"%s\" while linking shader program",linkLogBuffer);
 		}
 	
-	if(useSplatting)
-		{
-		/* Get the locations of the uniform variables: */
-		surfelSizeLocation=glGetUniformLocationARB(programObject,"surfelSize");
-		}
+	/* Get the locations of the uniform variables; variables not used by the variant get location -1: */
+	result.surfelSizeLocation=glGetUniformLocationARB(result.programObject,"surfelSize");
+	result.viewportLocation=glGetUniformLocationARB(result.programObject,"viewport");
+	result.planeDistancePlaneLocation=glGetUniformLocationARB(result.programObject,"planeDistancePlane");
+	result.planeDistanceMapLocation=glGetUniformLocationARB(result.programObject,"planeDistanceMap");
+	result.attributeMapScaleOffsetLocation=glGetUniformLocationARB(result.programObject,"attributeMapScaleOffset");
+	result.attributeMapLocation=glGetUniformLocationARB(result.programObject,"attributeMap");
 	
-	if(usePlaneDistance)
-		{
-		/* Get the locations of the uniform variables: */
-		planeDistancePlaneLocation=glGetUniformLocationARB(programObject,"planeDistancePlane");
-		planeDistanceMapLocation=glGetUniformLocationARB(programObject,"planeDistanceMap");
-		}
+	return result;
 	}
 
 PointBasedLightingShader::PointBasedLightingShader(GLContextData& sContextData)
 	:contextData(sContextData),
 	 correctGamma(contextData.getContext().isNonlinear()),
-	 haveGeometryShaders(false),
+	 haveGeometryShaders(false),havePointSprites(false),
 	 lightStateVersion(0),clipPlaneStateVersion(0),shaderSettingsVersion(0),
 	 settingsVersion(1),
 	 usePlaneDistance(false),
+	 useAttributeMap(false),
 	 usePointColors(false),
 	 useSplatting(false),
-	 vertexShader(0),fragmentShader(0),geometryShader(0),programObject(0),geometryShaderAttached(false)
+	 variants(17),
+	 pointSpritesEnabled(false)
 	{
 	/* Check for the required OpenGL extensions: */
 	if(!GLARBShaderObjects::isSupported())
@@ -370,34 +494,28 @@ PointBasedLightingShader::PointBasedLightingShader(GLContextData& sContextData)
 	GLARBVertexShader::initExtension();
 	GLARBFragmentShader::initExtension();
 	
-	/* Create the vertex and fragment shaders: */
-	vertexShader=glCreateShaderObjectARB(GL_VERTEX_SHADER_ARB);
-	fragmentShader=glCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB);
-	
-	/* Create the program object: */
-	programObject=glCreateProgramObjectARB();
-	glAttachObjectARB(programObject,vertexShader);
-	glAttachObjectARB(programObject,fragmentShader);
-	
 	/* Check for the optional geometry shader extension: */
 	if(GLARBGeometryShader4::isSupported())
 		{
 		/* Initialize the extension: */
 		haveGeometryShaders=true;
 		GLARBGeometryShader4::initExtension();
-		
-		/* Create the geometry shader: */
-		geometryShader=glCreateShaderObjectARB(GL_GEOMETRY_SHADER_ARB);
+		}
+	
+	/* Check for the optional point sprite extension, which is the preferred way to render splats: */
+	if(GLARBPointSprite::isSupported())
+		{
+		/* Initialize the extension: */
+		havePointSprites=true;
+		GLARBPointSprite::initExtension();
 		}
 	}
 
 PointBasedLightingShader::~PointBasedLightingShader(void)
 	{
-	glDeleteObjectARB(programObject);
-	glDeleteObjectARB(vertexShader);
-	if(haveGeometryShaders)
-		glDeleteObjectARB(geometryShader);
-	glDeleteObjectARB(fragmentShader);
+	/* Delete all linked program variants: */
+	for(VariantHasher::Iterator vIt=variants.begin();!vIt.isFinished();++vIt)
+		glDeleteObjectARB(vIt->getDest().programObject);
 	}
 
 void PointBasedLightingShader::setUsePlaneDistance(bool newUsePlaneDistance)
@@ -410,6 +528,15 @@ void PointBasedLightingShader::setUsePlaneDistance(bool newUsePlaneDistance)
 		}
 	}
 
+void PointBasedLightingShader::setUseAttributeMap(bool newUseAttributeMap)
+	{
+	if(useAttributeMap!=newUseAttributeMap)
+		{
+		useAttributeMap=newUseAttributeMap;
+		++settingsVersion;
+		}
+	}
+
 void PointBasedLightingShader::setUsePointColors(bool newUsePointColors)
 	{
 	if(usePointColors!=newUsePointColors)
@@ -421,8 +548,8 @@ void PointBasedLightingShader::setUsePointColors(bool newUsePointColors)
 
 void PointBasedLightingShader::setUseSplatting(bool newUseSplatting)
 	{
-	/* Disable splatting if geometry shaders are not supported: */
-	newUseSplatting=newUseSplatting&&haveGeometryShaders;
+	/* Disable splatting if neither point sprites nor geometry shaders are supported: */
+	newUseSplatting=newUseSplatting&&(havePointSprites||haveGeometryShaders);
 	
 	if(useSplatting!=newUseSplatting)
 		{
@@ -435,13 +562,13 @@ void PointBasedLightingShader::enable(void)
 	{
 	try
 		{
-		/* Re-compile the shader if it is out of line with current state: */
+		/* Select or compile the shader variant matching the current state if the state changed: */
 		const GLLightTracker& lt=*(contextData.getLightTracker());
 		const GLClipPlaneTracker& cpt=*(contextData.getClipPlaneTracker());
 		
 		if(lightStateVersion!=lt.getVersion()||clipPlaneStateVersion!=cpt.getVersion()||shaderSettingsVersion!=settingsVersion)
 			{
-			/* Rebuild the shader: */
+			/* Select the shader variant: */
 			compileShader();
 			
 			/* Mark the shader as up-to-date: */
@@ -451,7 +578,20 @@ void PointBasedLightingShader::enable(void)
 			}
 		
 		/* Enable the shader: */
-		glUseProgramObjectARB(programObject);
+		glUseProgramObjectARB(current.programObject);
+		
+		if(useSplatting&&havePointSprites)
+			{
+			/* Let the vertex shader size each point sprite to cover its splat: */
+			glEnable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
+			glEnable(GL_POINT_SPRITE_ARB);
+			pointSpritesEnabled=true;
+			
+			/* Set the viewport uniform variable to reconstruct fragments' eye-coordinate rays: */
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT,viewport);
+			glUniformARB(current.viewportLocation,GLfloat(viewport[0]),GLfloat(viewport[1]),GLfloat(viewport[2]),GLfloat(viewport[3]));
+			}
 		}
 	catch(const std::runtime_error& err)
 		{
@@ -464,7 +604,7 @@ void PointBasedLightingShader::setSurfelSize(float surfelSize)
 	if(useSplatting)
 		{
 		/* Set the surfel size uniform variable: */
-		glUniformARB(surfelSizeLocation,surfelSize);
+		glUniformARB(current.surfelSizeLocation,surfelSize);
 		}
 	}
 
@@ -477,10 +617,22 @@ void PointBasedLightingShader::setDistancePlane(int textureUnit,const PointBased
 		for(int i=0;i<3;++i)
 			planeEq[i]=GLfloat(distancePlane.getNormal()[i]/distancePlaneScale);
 		planeEq[3]=GLfloat(0.5-distancePlane.getOffset()/distancePlaneScale);
-		glUniformARB<4>(planeDistancePlaneLocation,1,planeEq);
+		glUniformARB<4>(current.planeDistancePlaneLocation,1,planeEq);
 		
 		/* Set the texture unit variable: */
-		glUniformARB(planeDistanceMapLocation,textureUnit);
+		glUniformARB(current.planeDistanceMapLocation,textureUnit);
+		}
+	}
+
+void PointBasedLightingShader::setAttributeMap(int textureUnit,double alphaScale,double alphaOffset) const
+	{
+	if(useAttributeMap&&!usePlaneDistance)
+		{
+		/* Set the texture coordinate mapping variable: */
+		glUniformARB(current.attributeMapScaleOffsetLocation,GLfloat(alphaScale),GLfloat(alphaOffset));
+		
+		/* Set the texture unit variable: */
+		glUniformARB(current.attributeMapLocation,textureUnit);
 		}
 	}
 
@@ -488,4 +640,12 @@ void PointBasedLightingShader::disable(void)
 	{
 	/* Disable the shader: */
 	glUseProgramObjectARB(0);
+	
+	if(pointSpritesEnabled)
+		{
+		/* Reset point rendering state: */
+		glDisable(GL_POINT_SPRITE_ARB);
+		glDisable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
+		pointSpritesEnabled=false;
+		}
 	}
@@ -1,7 +1,7 @@
 /***********************************************************************
 PointBasedLightingShader - Class to maintain a GLSL point-based lighting
 shader that tracks the current OpenGL lighting state.
-Copyright (c) 2008-2024 Oliver Kreylos
+Copyright (c) 2008-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,6 +24,9 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef POINTBASEDLIGHTINGSHADER_INCLUDED
 #define POINTBASEDLIGHTINGSHADER_INCLUDED
 
+#include <string>
+#include <Misc/HashTable.h>
+#include <Misc/StandardHashFunction.h>
 #include <Geometry/Plane.h>
 #include <GL/gl.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
@@ -37,28 +40,52 @@ class PointBasedLightingShader
 	public:
 	typedef Geometry::Plane<double,3> Plane; // Type for texture-mapping planes
 	
+	private:
+	struct ProgramVariant // Structure for a linked shader program for one combination of light, clip plane, and shader settings
+		{
+		/* Elements: */
+		public:
+		GLhandleARB programObject; // Handle for the linked program object
+		int surfelSizeLocation; // Location of the eye coordinate surfel radius uniform variable
+		int viewportLocation; // Location of the viewport uniform variable used by point sprite splats
+		int planeDistancePlaneLocation; // Location of distance plane equation uniform variable
+		int planeDistanceMapLocation; // Location of distance plane texture map uniform variable
+		int attributeMapScaleOffsetLocation; // Location of attribute map texture coordinate mapping uniform variable
+		int attributeMapLocation; // Location of attribute map texture uniform variable
+		
+		/* Constructors and destructors: */
+		ProgramVariant(void)
+			:programObject(0),
+			 surfelSizeLocation(-1),viewportLocation(-1),
+			 planeDistancePlaneLocation(-1),planeDistanceMapLocation(-1),
+			 attributeMapScaleOffsetLocation(-1),attributeMapLocation(-1)
+			{
+			};
+		};
+	
+	typedef Misc::HashTable<std::string,ProgramVariant> VariantHasher; // Hash table mapping complete shader sources to linked program variants
+	
 	/* Elements: */
 	private:
 	GLContextData& contextData; // The OpenGL context with which this shader is associated
 	bool correctGamma; // Flag whether incoming point colors need to be gamma-corrected
 	bool haveGeometryShaders; // Flag if the local OpenGL supports geometry shaders
+	bool havePointSprites; // Flag if the local OpenGL supports point sprites, to render splats without geometry shaders
 	unsigned int lightStateVersion; // Version of light tracker's state reflected in the current shader program
 	unsigned int clipPlaneStateVersion; // Version of clip plane tracker's state reflected in the current shader program
 	unsigned int shaderSettingsVersion; // Version of other shader settings reflected in the current shader program
 	unsigned int settingsVersion; // Version of other shader settings
 	bool usePlaneDistance; // Flag whether the point renderer uses distance from a user-defined plane to texture-map points
+	bool useAttributeMap; // Flag whether the point renderer maps the alpha components of point colors through a transfer function texture
 	bool usePointColors; // Flag whether the point renderer uses point colors as ambient and diffuse color
 	bool useSplatting; // Flag whether the point renderer uses surface-aligned point splats
-	GLhandleARB vertexShader,fragmentShader; // Handle for the vertex and fragment shaders
-	GLhandleARB geometryShader; // Handle for the optional geometry shader
-	GLhandleARB programObject; // Handle for the linked program object
-	bool geometryShaderAttached; // Flag whether the geometry shader is attached to the program object
-	int surfelSizeLocation; // Location of the eye coordinate surfel radius uniform variable
-	int planeDistancePlaneLocation; // Location of distance plane equation uniform variable
-	int planeDistanceMapLocation; // Location of distance plane texture map uniform variable
+	VariantHasher variants; // Cache of all program variants linked so far in this OpenGL context
+	ProgramVariant current; // The program variant reflecting the current states
+	bool pointSpritesEnabled; // Flag whether enable() turned on point sprites and vertex program point sizes
 	
 	/* Private methods: */
-	void compileShader(void); // Recompiles the point-based lighting shader based on the current states of all OpenGL light sources and clipping planes
+	void compileShader(void); // Selects the point-based lighting shader variant for the current states of all OpenGL light sources and clipping planes, and compiles it if it is not yet cached
+	ProgramVariant linkVariant(const char* vertexShaderSource,const char* geometryShaderSource,const char* fragmentShaderSource) const; // Compiles and links a new program variant from the given shader sources; geometry shader source can be null
 	
 	/* Constructors and destructors: */
 	public:
@@ -67,11 +94,13 @@ class PointBasedLightingShader
 	
 	/* Methods: */
 	void setUsePlaneDistance(bool newUsePlaneDistance); // Sets the plane distance texturing flag
+	void setUseAttributeMap(bool newUseAttributeMap); // Sets the attribute map texturing flag
 	void setUsePointColors(bool newUsePointColors); // Sets the point coloring flag
 	void setUseSplatting(bool newUseSplatting); // Sets the point splatting bit
 	void enable(void); // Enables point-based lighting in the current OpenGL context
 	void setSurfelSize(float surfelSize); // Sets the eye-coordinate radius of surfels
 	void setDistancePlane(int textureUnit,const Plane& distancePlane,double distancePlaneScale) const; // Sets the plane distance texturing plane equation and texture unti index
+	void setAttributeMap(int textureUnit,double alphaScale,double alphaOffset) const; // Sets the attribute map texture unit index and the mapping from point color alpha components to attribute map texture coordinates
 	void disable(void); // Disables point-based lighting in the current OpenGL context
 	};
 
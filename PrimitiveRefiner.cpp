@@ -0,0 +1,99 @@
+/***********************************************************************
+PrimitiveRefiner - Classes to refine primitives that were fitted to
+subsets of large point selections against all selected points in a
+background thread.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "PrimitiveRefiner.h"
+
+#include <stdexcept>
+
+/*********************************
+Methods of class PrimitiveRefiner:
+*********************************/
+
+void* PrimitiveRefiner::refinerThreadMethod(void)
+	{
+	std::string threadErrorMessage;
+	try
+		{
+		/* Refine the fit: */
+		refine();
+		}
+	catch(const std::runtime_error& err)
+		{
+		threadErrorMessage=err.what();
+		}
+	
+	/* Mark refinement as finished: */
+	{
+	Threads::Mutex::Lock statusLock(statusMutex);
+	errorMessage=threadErrorMessage;
+	finished=true;
+	}
+	
+	/* Notify the application: */
+	if(finishedFunction!=0)
+		finishedFunction(finishedFunctionArg);
+	
+	return 0;
+	}
+
+void PrimitiveRefiner::startRefining(void)
+	{
+	/* Start the background thread: */
+	refinerThread.start(this,&PrimitiveRefiner::refinerThreadMethod);
+	refinerStarted=true;
+	}
+
+void PrimitiveRefiner::stopRefining(void)
+	{
+	if(refinerStarted)
+		{
+		/* Stop the background thread after its current iteration: */
+		cancelRefining=true;
+		refinerThread.join();
+		refinerStarted=false;
+		}
+	}
+
+PrimitiveRefiner::PrimitiveRefiner(PrimitiveRefiner::FinishedFunction sFinishedFunction,void* sFinishedFunctionArg)
+	:finishedFunction(sFinishedFunction),finishedFunctionArg(sFinishedFunctionArg),
+	 refinerStarted(false),finished(false),
+	 cancelRefining(false)
+	{
+	}
+
+PrimitiveRefiner::~PrimitiveRefiner(void)
+	{
+	}
+
+bool PrimitiveRefiner::isFinished(void)
+	{
+	Threads::Mutex::Lock statusLock(statusMutex);
+	return finished;
+	}
+
+std::string PrimitiveRefiner::getErrorMessage(void)
+	{
+	Threads::Mutex::Lock statusLock(statusMutex);
+	return errorMessage;
+	}
@@ -0,0 +1,124 @@
+/***********************************************************************
+PrimitiveRefiner - Classes to refine primitives that were fitted to
+subsets of large point selections against all selected points in a
+background thread.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef PRIMITIVEREFINER_INCLUDED
+#define PRIMITIVEREFINER_INCLUDED
+
+#include <string>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
+
+#include "LidarOctree.h"
+#include "LidarSelectionExtractor.h"
+#include "Primitive.h"
+
+class PrimitiveRefiner // Base class for background refinement of primitive fits
+	{
+	/* Embedded classes: */
+	public:
+	typedef void (*FinishedFunction)(void*); // Type for callback functions called from the background thread when refinement finishes
+	
+	/* Elements: */
+	private:
+	FinishedFunction finishedFunction; // Function called when refinement finishes
+	void* finishedFunctionArg; // Argument for finished function
+	Threads::Thread refinerThread; // Background thread refining the fit
+	bool refinerStarted; // Flag whether the background thread was started
+	Threads::Mutex statusMutex; // Mutex protecting the completion state
+	bool finished; // Flag whether the background thread has finished
+	std::string errorMessage; // Message of the error that stopped the background thread, or empty
+	protected:
+	volatile bool cancelRefining; // Flag to stop the background thread early
+	
+	/* Protected methods: */
+	virtual void refine(void) =0; // Refines the fit; called from the background thread
+	void startRefining(void); // Starts the background thread; must be called at the end of derived class constructors
+	void stopRefining(void); // Stops the background thread if it was started; must be called at the beginning of derived class destructors
+	
+	/* Private methods: */
+	private:
+	void* refinerThreadMethod(void); // Thread method refining the fit
+	
+	/* Constructors and destructors: */
+	public:
+	PrimitiveRefiner(FinishedFunction sFinishedFunction,void* sFinishedFunctionArg);
+	virtual ~PrimitiveRefiner(void);
+	
+	/* Methods: */
+	bool isFinished(void); // Returns true if the background thread has finished
+	std::string getErrorMessage(void); // Returns the message of the error that stopped the background thread, or an empty string if refinement succeeded or is still in progress
+	virtual Primitive* getPrimitive(void) =0; // Returns the primitive being refined
+	virtual void applyFit(void) =0; // Replaces the primitive's fit with the refined fit; must only be called from the main thread after refinement finished without error
+	};
+
+template <class PrimitiveParam>
+class PrimitiveFitRefiner:public PrimitiveRefiner // Class to refine the fit of primitive classes providing Fit structures and static fit methods
+	{
+	/* Embedded classes: */
+	public:
+	typedef PrimitiveParam RefinedPrimitive; // Type of refined primitives
+	typedef typename RefinedPrimitive::Fit Fit; // Type for primitive fits
+	
+	/* Elements: */
+	private:
+	RefinedPrimitive* primitive; // The primitive being refined
+	LidarSelectionExtractor<Primitive::Point> points; // Snapshot of all selected points
+	Fit fit; // The fit being refined
+	
+	/* Protected methods from class PrimitiveRefiner: */
+	protected:
+	virtual void refine(void)
+		{
+		RefinedPrimitive::fit(points.getPoints(),fit,&cancelRefining);
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	PrimitiveFitRefiner(RefinedPrimitive* sPrimitive,const LidarOctree* octree,FinishedFunction sFinishedFunction,void* sFinishedFunctionArg) // Takes a snapshot of all points selected in the given octree and starts refining the given primitive's fit against them
+		:PrimitiveRefiner(sFinishedFunction,sFinishedFunctionArg),
+		 primitive(sPrimitive),fit(primitive->getFit())
+		{
+		/* Take a snapshot of all selected points: */
+		octree->processSelectedPoints(points);
+		
+		/* Start refining in the background: */
+		startRefining();
+		}
+	virtual ~PrimitiveFitRefiner(void)
+		{
+		stopRefining();
+		}
+	
+	/* Methods from class PrimitiveRefiner: */
+	virtual Primitive* getPrimitive(void)
+		{
+		return primitive;
+		}
+	virtual void applyFit(void)
+		{
+		primitive->setFit(fit);
+		}
+	};
+
+#endif
@@ -1,7 +1,7 @@
 /***********************************************************************
 ProfileExtractor - Algorithm to extract straight-line profiles from 2.5D
 LiDAR data.
-Copyright (c) 2010-2011 Oliver Kreylos
+Copyright (c) 2010-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,8 +23,9 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include "ProfileExtractor.h"
 
-#include <vector>
-#include <Cluster/MulticastPipe.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+#include <Threads/Thread.h>
 #include <SceneGraph/GroupNode.h>
 #include <SceneGraph/ColorNode.h>
 #include <SceneGraph/CoordinateNode.h>
@@ -34,164 +35,198 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include "LidarOctree.h"
 #include "SceneGraph.h"
 
-class Sampler // Class to sample the implicit surface defined by a LiDAR point cloud at an (x, y) position
+/******************************************
+Embedded classes of class ProfileExtractor:
+******************************************/
+
+class ProfileExtractor::ChunkSampler
 	{
 	/* Elements: */
 	private:
-	double pos[2]; // Sample point's (x, y) position
-	double dx[2],dy[2]; // Sample frame orientations in x and y
-	double step[2]; // Sample step size along dx and dy orientations
-	double numLobes; // Number of lobes in Lanczos reconstruction filter
-	double accumulator; // Accumulated convolution between point cloud and filter
-	double weightSum; // Sum of weights for all accumulated points
-	double absWeightSum; // Sum of absolute weights for all accumulated points
+	const ProfileExtractor& pe; // The profile extractor whose sampling frame is used
+	int first,last; // Index range of the chunk's profile samples, inclusive
+	double* accumulators; // Convolution accumulators of the chunk's profile samples
+	double* weightSums; // Weight sums of the chunk's profile samples
 	
 	/* Constructors and destructors: */
 	public:
-	Sampler(const double sDx[2],const double sDy[2],const double sStep[2],int sNumLobes) // Creates an empty sampler
-		:numLobes(double(sNumLobes))
+	ChunkSampler(ProfileExtractor& sPe,unsigned int sFirst,unsigned int sLast) // Creates a sampler for the given index range of profile samples
+		:pe(sPe),first(int(sFirst)),last(int(sLast)),
+		 accumulators(&sPe.accumulators[0]),weightSums(&sPe.weightSums[0])
 		{
-		for(int i=0;i<2;++i)
-			{
-			dx[i]=sDx[i];
-			dy[i]=sDy[i];
-			step[i]=sStep[i];
-			}
 		}
 	
 	/* Methods: */
-	void setPos(const Point& p)
-		{
-		/* Copy the sample position: */
-		for(int i=0;i<2;++i)
-			pos[i]=double(p[i]);
-		
-		/* Reset the filter accumulator: */
-		accumulator=0.0;
-		weightSum=0.0;
-		absWeightSum=0.0;
-		}
 	void operator()(const LidarPoint& p)
 		{
-		/* Calculate the sample coordinates of the LiDAR point: */
-		double lp[2];
-		lp[0]=double(p[0]-pos[0])*dx[0]+double(p[1]-pos[1])*dx[1];
-		lp[1]=double(p[0]-pos[0])*dy[0]+double(p[1]-pos[1])*dy[1];
+		/* Calculate the LiDAR point's coordinates along and across the profile line: */
+		double rx=double(p[0])-double(pe.origin[0]);
+		double ry=double(p[1])-double(pe.origin[1]);
+		double along=rx*pe.dx[0]+ry*pe.dx[1];
+		double across=rx*pe.dy[0]+ry*pe.dy[1];
+		
+		/* Bail out if the point is outside the filter's support across the profile line: */
+		if(Math::abs(across)>=pe.support[1])
+			return;
+		double acrossWeight=pe.kernel(across*pe.invFilterStep[1]);
 		
-		/* Calculate the Lanczos filter weight for the LiDAR point: */
-		double weight=1.0;
-		for(int i=0;i<2;++i)
+		/* Find the chunk's samples whose filter support along the profile line contains the point: */
+		int i0=int(Math::ceil((along-pe.support[0])/pe.sampleStep));
+		if(i0<first)
+			i0=first;
+		int i1=int(Math::floor((along+pe.support[0])/pe.sampleStep));
+		if(i1>last)
+			i1=last;
+		if(i0>i1)
+			return;
+		
+		/* Calculate the filter weights along the profile line for all those samples at once: */
+		int numSamples=i1-i0+1;
+		double ts[chunkSize],weights[chunkSize];
+		for(int i=0;i<numSamples;++i)
+			ts[i]=(along-double(i0+i)*pe.sampleStep)*pe.invFilterStep[0];
+		pe.kernel.evaluate(ts,weights,numSamples);
+		
+		/* Accumulate the weighted point into those samples: */
+		double z=double(p[2]);
+		for(int i=0;i<numSamples;++i)
 			{
-			double x=Math::Constants<double>::pi*lp[i]/step[i];
-			if(Math::abs(x)>=numLobes)
-				weight=0.0;
-			else if(x!=0.0)
-				{
-				weight*=Math::sin(x)/x;
-				x/=numLobes;
-				weight*=Math::sin(x)/x;
-				}
+			double weight=acrossWeight*weights[i];
+			accumulators[i0+i]+=z*weight;
+			weightSums[i0+i]+=weight;
 			}
-		
-		/* Accumulate the weighted point: */
-		accumulator+=double(p[2])*weight;
-		weightSum+=weight;
-		absWeightSum+=Math::abs(weight);
-		}
-	double getWeightSum(void) const // Returns the sum of point weights
-		{
-		return weightSum;
-		}
-	double getAbsWeightSum(void) const // Returns the sum of absolute point weights
-		{
-		return absWeightSum;
-		}
-	double getValue(void) const // Returns the convolution result
-		{
-		/* Return the weighted average: */
-		return accumulator/weightSum;
 		}
 	};
 
-void extractProfile(const LidarOctree* octree,const Point& p0,const Point& p1,double segmentLength,int oversampling,double filterWidth,int numLobes,Cluster::MulticastPipe* pipe)
+/*********************************
+Methods of class ProfileExtractor:
+*********************************/
+
+void ProfileExtractor::extractChunk(unsigned int chunkIndex)
 	{
-	std::vector<Point> profilePoints;
+	/* Get the chunk's range of profile samples: */
+	unsigned int first=chunkIndex*chunkSize;
+	unsigned int last=first+chunkSize-1;
+	if(last>=accumulators.size())
+		last=accumulators.size()-1;
 	
-	if(pipe==0||pipe->isMaster())
-		{
-		/* Calculate the distribution of sample points along the profile: */
-		double pLen=Geometry::dist(p0,p1);
-		int numSegments=int(pLen/segmentLength+0.5);
-		segmentLength=pLen/double(numSegments);
-		numSegments*=oversampling;
-		
-		/* Create the profile point list: */
-		profilePoints.reserve(numSegments+1);
-		profilePoints.push_back(p0);
-		for(int i=1;i<numSegments;++i)
+	/* Calculate the bounding box of the chunk's swath, i.e., of the union of its samples' filter supports: */
+	Box swath=Box::empty;
+	swath.min[2]=Math::Constants<Scalar>::min;
+	swath.max[2]=Math::Constants<Scalar>::max;
+	double along[2];
+	along[0]=double(first)*sampleStep-support[0];
+	along[1]=double(last)*sampleStep+support[0];
+	for(int i=0;i<2;++i)
+		for(int j=-1;j<=1;j+=2)
 			{
-			float lambda=float(double(i)/double(numSegments));
-			profilePoints.push_back(Geometry::affineCombination(p0,p1,lambda));
+			Point corner=origin;
+			corner[0]=Scalar(double(origin[0])+along[i]*dx[0]+double(j)*support[1]*dy[0]);
+			corner[1]=Scalar(double(origin[1])+along[i]*dx[1]+double(j)*support[1]*dy[1]);
+			swath.addPoint(corner);
 			}
-		profilePoints.push_back(p1);
+	
+	/* Accumulate all points inside the swath into the chunk's samples: */
+	ChunkSampler sampler(*this,first,last);
+	octree->processPointsInBox(swath,sampler);
+	}
+
+void* ProfileExtractor::extractorThreadMethod(void)
+	{
+	while(true)
+		{
+		/* Grab the next chunk: */
+		unsigned int chunkIndex=nextChunkIndex.preAdd(1U)-1U;
+		if(chunkIndex>=numChunks)
+			break;
 		
-		/* Set up the sampling filter frame: */
-		double dx[2],dy[2],step[2];
-		dx[0]=double(p1[0])-double(p0[0]);
-		dx[1]=double(p1[1])-double(p0[1]);
-		double dxMag=Math::sqrt(Math::sqr(dx[0])+Math::sqr(dx[1]));
+		/* Extract the chunk: */
+		extractChunk(chunkIndex);
+		}
+	
+	return 0;
+	}
+
+ProfileExtractor::ProfileExtractor(const LidarOctree* sOctree,unsigned int sNumThreads)
+	:octree(sOctree),numThreads(sNumThreads>0?sNumThreads:1U),
+	 kernel(1),
+	 nextChunkIndex(0U),numChunks(0)
+	{
+	}
+
+void ProfileExtractor::extract(const Point& p0,const Point& p1,double segmentLength,int oversampling,double filterWidth,int newNumLobes,std::vector<Point>& profilePoints)
+	{
+	/* Calculate the distribution of sample points along the profile: */
+	double pLen=Geometry::dist(p0,p1);
+	int numSegments=int(pLen/segmentLength+0.5);
+	if(numSegments<1)
+		numSegments=1;
+	segmentLength=pLen/double(numSegments);
+	numSegments*=oversampling;
+	
+	/* Create the profile point list, with elevations interpolated between the end points for samples that receive no points: */
+	profilePoints.clear();
+	profilePoints.reserve(numSegments+1);
+	profilePoints.push_back(p0);
+	for(int i=1;i<numSegments;++i)
+		{
+		float lambda=float(double(i)/double(numSegments));
+		profilePoints.push_back(Geometry::affineCombination(p0,p1,lambda));
+		}
+	profilePoints.push_back(p1);
+	
+	/* Set up the sampling filter frame: */
+	origin=p0;
+	dx[0]=double(p1[0])-double(p0[0]);
+	dx[1]=double(p1[1])-double(p0[1]);
+	double dxMag=Math::sqrt(Math::sqr(dx[0])+Math::sqr(dx[1]));
+	if(dxMag>0.0)
+		{
 		dx[0]/=dxMag;
 		dx[1]/=dxMag;
-		dy[0]=dx[1];
-		dy[1]=-dx[0];
-		step[0]=segmentLength;
-		step[1]=filterWidth;
-		Sampler sampler(dx,dy,step,numLobes);
-		
-		/* Sample all profile points: */
-		for(std::vector<Point>::iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
-			{
-			/* Calculate the bounding box of the sampling filter's support: */
-			Vector bx=Vector(dx[0],dx[1],0.0f)*(float(segmentLength)*float(numLobes));
-			Vector by=Vector(dy[0],dy[1],0.0f)*(float(filterWidth)*float(numLobes));
-			Box frame=Box::empty;
-			frame.min[2]=Math::Constants<float>::min;
-			frame.max[2]=Math::Constants<float>::max;
-			frame.addPoint(*ppIt-bx-by);
-			frame.addPoint(*ppIt-bx+by);
-			frame.addPoint(*ppIt+bx-by);
-			frame.addPoint(*ppIt+bx+by);
-			
-			/* Sample the point: */
-			sampler.setPos(*ppIt);
-			octree->processPointsInBox(frame,sampler);
-			
-			/* Set the profile point's elevation: */
-			(*ppIt)[2]=sampler.getValue();
-			}
-		
-		if(pipe!=0)
-			{
-			/* Send the extracted profile points to the slaves: */
-			pipe->write<unsigned int>(profilePoints.size());
-			for(std::vector<Point>::iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
-				pipe->write<Point::Scalar>(ppIt->getComponents(),3);
-			pipe->flush();
-			}
 		}
 	else
 		{
-		/* Retrieve the extracted profile points from the master: */
-		unsigned int numProfilePoints=pipe->read<unsigned int>();
-		profilePoints.reserve(numProfilePoints);
-		for(unsigned int i=0;i<numProfilePoints;++i)
-			{
-			Point pp;
-			pipe->read<Point::Scalar>(pp.getComponents(),3);
-			profilePoints.push_back(pp);
-			}
+		dx[0]=1.0;
+		dx[1]=0.0;
 		}
+	dy[0]=dx[1];
+	dy[1]=-dx[0];
+	sampleStep=dxMag/double(numSegments);
+	filterStep[0]=segmentLength;
+	filterStep[1]=filterWidth;
+	numLobes=double(newNumLobes);
+	kernel.setNumLobes(newNumLobes);
+	for(int i=0;i<2;++i)
+		{
+		invFilterStep[i]=1.0/filterStep[i];
+		support[i]=numLobes*filterStep[i]/Math::Constants<double>::pi;
+		}
+	
+	/* Reset the sample accumulators: */
+	accumulators.assign(profilePoints.size(),0.0);
+	weightSums.assign(profilePoints.size(),0.0);
+	
+	/* Extract the profile in chunks of consecutive samples on the calling thread and the extractor threads: */
+	numChunks=(profilePoints.size()+chunkSize-1)/chunkSize;
+	nextChunkIndex.set(0U);
+	unsigned int numExtraThreads=(numThreads<numChunks?numThreads:numChunks)-1U;
+	Threads::Thread* threads=new Threads::Thread[numExtraThreads];
+	for(unsigned int i=0;i<numExtraThreads;++i)
+		threads[i].start(this,&ProfileExtractor::extractorThreadMethod);
+	extractorThreadMethod();
+	for(unsigned int i=0;i<numExtraThreads;++i)
+		threads[i].join();
+	delete[] threads;
 	
+	/* Set the profile points' elevations: */
+	for(size_t i=0;i<profilePoints.size();++i)
+		if(weightSums[i]!=0.0)
+			profilePoints[i][2]=Scalar(accumulators[i]/weightSums[i]);
+	}
+
+void addProfileToSceneGraph(const std::vector<Point>& profilePoints)
+	{
 	/* Add the profile to the scene graph root: */
 	SceneGraph::GroupNode* root=new SceneGraph::GroupNode;
 	getSceneGraphRoot().children.appendValue(root);
@@ -210,7 +245,7 @@ void extractProfile(const LidarOctree* octree,const Point& p0,const Point& p1,do
 	
 	SceneGraph::CoordinateNode* coord=new SceneGraph::CoordinateNode;
 	ils->coord.setValue(coord);
-	for(std::vector<Point>::iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
+	for(std::vector<Point>::const_iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
 		coord->point.appendValue(*ppIt);
 	coord->update();
 	
@@ -1,7 +1,7 @@
 /***********************************************************************
 ProfileExtractor - Algorithm to extract straight-line profiles from 2.5D
 LiDAR data.
-Copyright (c) 2010-2011 Oliver Kreylos
+Copyright (c) 2010-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,14 +24,58 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef PROFILEEXTRACTOR_INCLUDED
 #define PROFILEEXTRACTOR_INCLUDED
 
+#include <vector>
+#include <Threads/Atomic.h>
+
 #include "LidarTypes.h"
+#include "LanczosKernel.h"
 
 /* Forward declarations: */
-namespace Cluster {
-class MulticastPipe;
-}
 class LidarOctree;
 
-void extractProfile(const LidarOctree* octree,const Point& p0,const Point& p1,double segmentLength,int oversampling,double filterWidth,int numLobes,Cluster::MulticastPipe* pipe);
+class ProfileExtractor
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int chunkSize=16; // Number of consecutive profile samples extracted together with one box query
+	
+	private:
+	class ChunkSampler; // Class to accumulate the points inside one chunk's swath into its profile samples
+	
+	/* Elements: */
+	const LidarOctree* octree; // The octree from whose in-memory leaf nodes profiles are extracted
+	unsigned int numThreads; // Number of threads extracting chunks in parallel
+	
+	/* Transient state during extraction: */
+	Point origin; // First profile point
+	double dx[2],dy[2]; // Unit vectors along and across the profile line in the (x, y) plane
+	double sampleStep; // Distance between consecutive profile samples along the profile line
+	double filterStep[2]; // Lanczos filter step sizes along and across the profile line
+	double invFilterStep[2]; // Reciprocal Lanczos filter step sizes
+	double numLobes; // Number of lobes in the Lanczos reconstruction filter
+	LanczosKernel kernel; // Tabulated Lanczos reconstruction filter
+	double support[2]; // Half-widths of the Lanczos filter's support along and across the profile line
+	std::vector<double> accumulators; // Accumulated convolution between point cloud and filter for each profile sample
+	std::vector<double> weightSums; // Sum of weights of all accumulated points for each profile sample
+	Threads::Atomic<unsigned int> nextChunkIndex; // Index of the next chunk to be extracted by any thread
+	unsigned int numChunks; // Number of chunks in the current profile
+	
+	/* Private methods: */
+	void extractChunk(unsigned int chunkIndex); // Accumulates the points in the given chunk's swath into its profile samples
+	void* extractorThreadMethod(void); // Thread method extracting chunks until all chunks are taken
+	
+	/* Constructors and destructors: */
+	public:
+	ProfileExtractor(const LidarOctree* sOctree,unsigned int sNumThreads); // Creates a profile extractor for the given octree using the given number of threads
+	private:
+	ProfileExtractor(const ProfileExtractor& source); // Prohibit copy constructor
+	ProfileExtractor& operator=(const ProfileExtractor& source); // Prohibit assignment operator
+	
+	/* Methods: */
+	public:
+	void extract(const Point& p0,const Point& p1,double segmentLength,int oversampling,double filterWidth,int numLobes,std::vector<Point>& profilePoints); // Samples the profile between the given points from the octree's currently loaded leaf nodes into the given point list; can be called again to refine the profile as deeper nodes are loaded; must not run concurrently with octree updates
+	};
+
+void addProfileToSceneGraph(const std::vector<Point>& profilePoints); // Adds the given extracted profile as a polyline to the scene graph
 
 #endif
@@ -1,7 +1,7 @@
 /***********************************************************************
 ProfileTool - Vrui tool class to extract profile curves from 2.5D LiDAR
 data sets.
-Copyright (c) 2010-2020 Oliver Kreylos
+Copyright (c) 2010-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,6 +23,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include "ProfileTool.h"
 
+#include <Cluster/MulticastPipe.h>
 #include <GL/gl.h>
 #include <GL/GLGeometryWrappers.h>
 #include <GLMotif/StyleSheet.h>
@@ -100,6 +101,51 @@ ProfileToolFactory* ProfileTool::factory=0;
 Methods of class ProfileTool:
 ****************************/
 
+bool ProfileTool::updateProfile(bool refine)
+	{
+	bool finished=false;
+	Cluster::MulticastPipe* pipe=Vrui::getMainPipe();
+	if(pipe==0||pipe->isMaster())
+		{
+		LidarOctree* octree=application->octrees[0];
+		if(refine)
+			{
+			/* Request full detail along the profile's swath, with one interactor covering each chunk of samples and its filter support: */
+			Scalar radius=Scalar(0.5*segmentLength*double(ProfileExtractor::chunkSize)/double(oversampling)+double(numLobes)*(segmentLength>filterWidth?segmentLength:filterWidth));
+			for(size_t i=ProfileExtractor::chunkSize/2;i<profilePoints.size();i+=ProfileExtractor::chunkSize)
+				octree->interact(LidarOctree::Interactor(profilePoints[i],radius));
+			}
+		
+		/* Extract the profile from the octree's currently loaded nodes: */
+		extractor->extract(p0,p1,segmentLength,oversampling,filterWidth,numLobes,profilePoints);
+		
+		/* Finish refinement once the octree has loaded all requested nodes, or after a while: */
+		if(refine)
+			finished=octree->getLoaderStatistics().numQueuedRequests==0||Vrui::getApplicationTime()-refineStartTime>=5.0;
+		
+		if(pipe!=0)
+			{
+			/* Send the extracted profile points to the slaves: */
+			pipe->write<unsigned int>(profilePoints.size());
+			for(std::vector<Point>::iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
+				pipe->write<Point::Scalar>(ppIt->getComponents(),3);
+			pipe->write<unsigned char>(finished?1:0);
+			pipe->flush();
+			}
+		}
+	else
+		{
+		/* Retrieve the extracted profile points from the master: */
+		unsigned int numProfilePoints=pipe->read<unsigned int>();
+		profilePoints.resize(numProfilePoints);
+		for(std::vector<Point>::iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
+			pipe->read<Point::Scalar>(ppIt->getComponents(),3);
+		finished=pipe->read<unsigned char>()!=0;
+		}
+	
+	return finished;
+	}
+
 void ProfileTool::segmentLengthCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData)
 	{
 	segmentLength=cbData->value;
@@ -124,7 +170,9 @@ ProfileTool::ProfileTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputA
 	:Vrui::Tool(factory,inputAssignment),
 	 segmentLength(1.0),oversampling(2),filterWidth(1.0),numLobes(3),
 	 settingsDialogPopup(0),
-	 state(0)
+	 state(0),
+	 extractor(new ProfileExtractor(application->octrees[0],application->numExtractorThreads)),
+	 refineStartTime(0.0)
 	{
 	/* Get the style sheet: */
 	const GLMotif::StyleSheet* ss=Vrui::getWidgetManager()->getStyleSheet();
@@ -180,6 +228,7 @@ ProfileTool::ProfileTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputA
 ProfileTool::~ProfileTool(void)
 	{
 	delete settingsDialogPopup;
+	delete extractor;
 	}
 
 const Vrui::ToolFactory* ProfileTool::getFactory(void) const
@@ -209,7 +258,10 @@ void ProfileTool::buttonCallback(int,Vrui::InputDevice::ButtonCallbackData* cbDa
 		
 		case 3:
 			if(!cbData->newButtonState)
+				{
 				state=4;
+				refineStartTime=Vrui::getApplicationTime();
+				}
 			break;
 		}
 	}
@@ -228,16 +280,25 @@ void ProfileTool::frame(void)
 			break;
 		
 		case 3:
-			/* Update the second point: */
+			/* Update the second point and preview the profile from the currently loaded nodes: */
 			p1=Point(Vrui::getInverseNavigationTransformation().transform(iDevice->getPosition()));
+			updateProfile(false);
 			break;
 		
 		case 4:
-			/* Extract the profile: */
-			extractProfile(application->octrees[0],p0,p1,segmentLength,oversampling,filterWidth,numLobes,Vrui::getMainPipe());
-			
-			/* Go back to idle state: */
-			state=0;
+			/* Refine the profile as deeper nodes are loaded: */
+			if(updateProfile(true))
+				{
+				/* Add the final profile to the scene graph and go back to idle state: */
+				addProfileToSceneGraph(profilePoints);
+				profilePoints.clear();
+				state=0;
+				}
+			else
+				{
+				/* Keep refining in the next frame: */
+				Vrui::requestUpdate();
+				}
 			break;
 		}
 	}
@@ -268,10 +329,21 @@ void ProfileTool::display(GLContextData& contextData) const
 				{
 				glLineWidth(3.0f);
 				glColor3f(0.0f,0.5f,0.0f);
-				glBegin(GL_LINES);
-				glVertex(p0);
-				glVertex(p1);
-				glEnd();
+				if(!profilePoints.empty())
+					{
+					/* Draw the current profile preview: */
+					glBegin(GL_LINE_STRIP);
+					for(std::vector<Point>::const_iterator ppIt=profilePoints.begin();ppIt!=profilePoints.end();++ppIt)
+						glVertex(*ppIt);
+					glEnd();
+					}
+				else
+					{
+					glBegin(GL_LINES);
+					glVertex(p0);
+					glVertex(p1);
+					glEnd();
+					}
 				}
 			}
 		
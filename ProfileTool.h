@@ -1,7 +1,7 @@
 /***********************************************************************
 ProfileTool - Vrui tool class to extract profile curves from 2.5D LiDAR
 data sets.
-Copyright (c) 2010 Oliver Kreylos
+Copyright (c) 2010-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,6 +24,7 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef PROFILETOOL_INCLUDED
 #define PROFILETOOL_INCLUDED
 
+#include <vector>
 #include <GLMotif/TextFieldSlider.h>
 #include <Vrui/Tool.h>
 #include <Vrui/Application.h>
@@ -35,6 +36,7 @@ namespace GLMotif {
 class PopupWindow;
 }
 class LidarViewer;
+class ProfileExtractor;
 
 class ProfileTool; // Forward declaration of the profile tool class
 
@@ -71,9 +73,13 @@ class ProfileTool:public Vrui::Tool,public Vrui::Application::Tool<LidarViewer>
 	int numLobes;
 	GLMotif::PopupWindow* settingsDialogPopup; // Dialog to adjust the profile extraction settings
 	Point p0,p1; // First and second profile points
-	int state; // Tool state (0: idle, 1: dragging first point, 2: waiting, 3: dragging second point, 4: extracting profile
+	int state; // Tool state (0: idle, 1: dragging first point, 2: waiting, 3: dragging second point, 4: refining profile)
+	ProfileExtractor* extractor; // Extractor sampling profiles from the first octree on multiple threads
+	std::vector<Point> profilePoints; // The most recently extracted profile, previewed while dragging and refining
+	double refineStartTime; // Application time at which refinement of the current profile started
 	
 	/* Private methods: */
+	bool updateProfile(bool refine); // Extracts the current profile on the master node and distributes it to the cluster; returns true if refinement is finished
 	void segmentLengthCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
 	void oversamplingCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
 	void filterWidthCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
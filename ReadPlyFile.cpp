@@ -783,6 +783,7 @@ void readPlyFileVertices(const Element& vertex,PlyFileParam& ply,PointAccumulato
 	
 	/* Read all vertices: */
 	Element::Value vertexValue(vertex);
+	PointAccumulator::Batch batch(pa);
 	for(unsigned int i=0;i<vertex.getNumValues();++i)
 		{
 		/* Read vertex element from file: */
@@ -807,8 +808,134 @@ void readPlyFileVertices(const Element& vertex,PlyFileParam& ply,PointAccumulato
 			}
 		
 		/* Store the point: */
-		pa.addPoint(p,c);
+		batch.addPoint(p,c);
 		}
+	batch.flush();
+	}
+
+/****************************************************************
+Helper functions to read binary vertices with fixed layouts fast:
+****************************************************************/
+
+template <class CoordParam,bool hasColorParam>
+void readVertexBlocks(IO::File& ply,size_t numVertices,size_t vertexSize,const size_t posOffsets[3],const size_t colOffsets[3],PointAccumulator& pa)
+	{
+	/* Read vertices in blocks of approximately one megabyte: */
+	size_t blockSize=(1024*1024)/vertexSize;
+	if(blockSize<1)
+		blockSize=1;
+	std::vector<char> buffer(blockSize*vertexSize);
+	
+	PointAccumulator::Batch batch(pa);
+	PointAccumulator::Color c(255.0f,255.0f,255.0f);
+	while(numVertices>0)
+		{
+		/* Read the next block of raw vertex records: */
+		size_t numBlockVertices=numVertices<blockSize?numVertices:blockSize;
+		ply.read(&buffer[0],numBlockVertices*vertexSize);
+		
+		/* Convert all vertices in the block: */
+		const char* vPtr=&buffer[0];
+		for(size_t i=0;i<numBlockVertices;++i,vPtr+=vertexSize)
+			{
+			/* Extract the vertex position; records are not necessarily aligned: */
+			PointAccumulator::Point p;
+			for(int j=0;j<3;++j)
+				{
+				CoordParam coord;
+				memcpy(&coord,vPtr+posOffsets[j],sizeof(CoordParam));
+				p[j]=double(coord);
+				}
+			
+			/* Extract the vertex color: */
+			if(hasColorParam)
+				for(int j=0;j<3;++j)
+					c[j]=float(reinterpret_cast<const unsigned char*>(vPtr)[colOffsets[j]]);
+			
+			batch.addPoint(p,c);
+			}
+		
+		numVertices-=numBlockVertices;
+		}
+	batch.flush();
+	}
+
+bool readPlyFileVerticesBulk(const Element& vertex,Misc::Endianness fileEndianness,IO::File& ply,PointAccumulator& pa,const char* plyColorNames[3]) // Reads a vertex element with a fixed layout of float or double positions and optional uchar colors; returns false without reading anything if the layout is not supported
+	{
+	/* Raw records can only be used if they don't need to be byte-swapped: */
+	if(fileEndianness!=Misc::HostEndianness||vertex.hasListProperty())
+		return false;
+	
+	/* Calculate the file offsets and sizes of all vertex properties: */
+	static const size_t dataTypeSizes[]={1,1,2,2,4,4,4,8};
+	std::vector<size_t> offsets;
+	size_t vertexSize=0;
+	for(Element::PropertyList::const_iterator pIt=vertex.propertiesBegin();pIt!=vertex.propertiesEnd();++pIt)
+		{
+		offsets.push_back(vertexSize);
+		vertexSize+=dataTypeSizes[pIt->getScalarType()];
+		}
+	
+	/* Check that the position components exist and share a floating-point type: */
+	static const char* posNames[3]={"x","y","z"};
+	size_t posOffsets[3];
+	DataType posType=DOUBLE;
+	for(int i=0;i<3;++i)
+		{
+		unsigned int index=vertex.getPropertyIndex(posNames[i]);
+		if(index>=vertex.getNumProperties())
+			return false;
+		DataType type=(vertex.propertiesBegin()+index)->getScalarType();
+		if((type!=FLOAT&&type!=DOUBLE)||(i>0&&type!=posType))
+			return false;
+		posType=type;
+		posOffsets[i]=offsets[index];
+		}
+	
+	/* Check that the color components either all exist as uchar, or are absent: */
+	size_t colOffsets[3];
+	bool hasColor=true;
+	for(int i=0;i<3;++i)
+		{
+		unsigned int index=vertex.getPropertyIndex(plyColorNames[i]);
+		if(index>=vertex.getNumProperties())
+			hasColor=false;
+		else if((vertex.propertiesBegin()+index)->getScalarType()!=UCHAR)
+			return false;
+		else
+			colOffsets[i]=offsets[index];
+		}
+	
+	/* Read the vertices with the matching specialized loop: */
+	if(posType==FLOAT)
+		{
+		if(hasColor)
+			readVertexBlocks<float,true>(ply,vertex.getNumValues(),vertexSize,posOffsets,colOffsets,pa);
+		else
+			readVertexBlocks<float,false>(ply,vertex.getNumValues(),vertexSize,posOffsets,colOffsets,pa);
+		}
+	else
+		{
+		if(hasColor)
+			readVertexBlocks<double,true>(ply,vertex.getNumValues(),vertexSize,posOffsets,colOffsets,pa);
+		else
+			readVertexBlocks<double,false>(ply,vertex.getNumValues(),vertexSize,posOffsets,colOffsets,pa);
+		}
+	
+	return true;
+	}
+
+void readVertexElement(const PlyFileHeader& header,const Element& vertex,IO::ValueSource& ply,PointAccumulator& pa,const char* plyColorNames[3])
+	{
+	/* Read the vertices property by property: */
+	readPlyFileVertices(vertex,ply,pa,plyColorNames);
+	}
+
+void readVertexElement(const PlyFileHeader& header,const Element& vertex,IO::File& ply,PointAccumulator& pa,const char* plyColorNames[3])
+	{
+	/* Try the bulk reader first, and fall back to reading vertices property by property: */
+	if(!readPlyFileVerticesBulk(vertex,header.getFileEndianness(),ply,pa,plyColorNames))
+		readPlyFileVertices(vertex,ply,pa,plyColorNames);
 	}
 
 void skipElement(const Element& element,IO::File& ply)
@@ -850,7 +977,7 @@ void readPlyFileElements(const PlyFileHeader& header,PlyFileParam& ply,PointAccu
 		if(element.isElement("vertex"))
 			{
 			/* Read the vertex element: */
-			readPlyFileVertices(element,ply,pa,plyColorNames);
+			readVertexElement(header,element,ply,pa,plyColorNames);
 			}
 		else
 			{
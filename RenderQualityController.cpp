@@ -0,0 +1,125 @@
+/***********************************************************************
+RenderQualityController - Class to adapt the rendering quality of LiDAR
+octrees to hold a target GPU frame time.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "RenderQualityController.h"
+
+#include <Math/Math.h>
+
+namespace {
+
+/**************************************
+Constants controlling the quality loop:
+**************************************/
+
+const double smoothingWeight=0.25; // Weight of a new measurement in the smoothed GPU frame time
+const double upperThreshold=1.0; // Ratio to the target above which quality is reduced immediately
+const double lowerThreshold=0.8; // Ratio to the target below which quality is raised; the band in between is the hysteresis
+const unsigned int numSettleMeasurements=4; // Number of measurements to ignore after a quality change
+const unsigned int numIncreaseMeasurements=30; // Number of consecutive measurements below the lower threshold before quality is raised
+const Scalar maxDecrease=Scalar(0.5); // Largest quality reduction in one step
+const Scalar increaseStep=Scalar(0.05); // Quality increase in one step
+
+}
+
+/****************************************
+Methods of class RenderQualityController:
+****************************************/
+
+RenderQualityController::RenderQualityController(double sTargetFrameTime,Scalar sMinQuality,Scalar sMaxQuality)
+	:targetFrameTime(sTargetFrameTime),
+	 minQuality(sMinQuality),maxQuality(sMaxQuality),
+	 smoothedFrameTime(-1.0),
+	 settleCounter(0),increaseCounter(0)
+	{
+	}
+
+void RenderQualityController::setTargetFrameTime(double newTargetFrameTime)
+	{
+	targetFrameTime=newTargetFrameTime;
+	
+	/* Start over with the new target: */
+	settleCounter=0;
+	increaseCounter=0;
+	}
+
+bool RenderQualityController::update(double gpuFrameTime,Scalar& quality)
+	{
+	/* Smooth the measured frame time to suppress single-frame spikes: */
+	if(smoothedFrameTime<0.0)
+		smoothedFrameTime=gpuFrameTime;
+	else
+		smoothedFrameTime+=(gpuFrameTime-smoothedFrameTime)*smoothingWeight;
+	
+	/* Ignore measurements that predate the effects of the last quality change: */
+	if(settleCounter>0)
+		{
+		--settleCounter;
+		return false;
+		}
+	
+	Scalar newQuality=quality;
+	double ratio=smoothedFrameTime/targetFrameTime;
+	if(ratio>upperThreshold)
+		{
+		/*******************************************************************
+		Over budget: The number of rendered points grows roughly with the
+		square of the inverse maximum LOD, i.e., by a factor of four per
+		quality level, so reduce quality by half the binary logarithm of the
+		overshoot to land close to the target in one step.
+		*******************************************************************/
+		
+		Scalar decrease=Scalar(0.5*Math::log(ratio)/Math::log(2.0));
+		if(decrease>maxDecrease)
+			decrease=maxDecrease;
+		newQuality-=decrease;
+		increaseCounter=0;
+		}
+	else if(ratio<lowerThreshold)
+		{
+		/* Under budget: Raise quality slowly once the frame time has stayed low for a while: */
+		if(++increaseCounter>=numIncreaseMeasurements)
+			{
+			newQuality+=increaseStep;
+			increaseCounter=0;
+			}
+		}
+	else
+		{
+		/* Inside the hysteresis band; hold the current quality: */
+		increaseCounter=0;
+		}
+	
+	/* Clamp the new quality level: */
+	if(newQuality<minQuality)
+		newQuality=minQuality;
+	if(newQuality>maxQuality)
+		newQuality=maxQuality;
+	if(newQuality==quality)
+		return false;
+	
+	/* Apply the new quality level and wait for its effects: */
+	quality=newQuality;
+	settleCounter=numSettleMeasurements;
+	smoothedFrameTime=-1.0;
+	return true;
+	}
@@ -0,0 +1,52 @@
+/***********************************************************************
+RenderQualityController - Class to adapt the rendering quality of LiDAR
+octrees to hold a target GPU frame time.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef RENDERQUALITYCONTROLLER_INCLUDED
+#define RENDERQUALITYCONTROLLER_INCLUDED
+
+#include "LidarTypes.h"
+
+class RenderQualityController
+	{
+	/* Elements: */
+	private:
+	double targetFrameTime; // GPU frame time to hold in seconds
+	Scalar minQuality,maxQuality; // Range of rendering quality levels
+	double smoothedFrameTime; // Exponentially smoothed measured GPU frame time, or negative if there are no measurements yet
+	unsigned int settleCounter; // Number of measurements to ignore after the last rendering quality change, to let its effects show
+	unsigned int increaseCounter; // Number of consecutive measurements below the lower threshold
+	
+	/* Constructors and destructors: */
+	public:
+	RenderQualityController(double sTargetFrameTime,Scalar sMinQuality,Scalar sMaxQuality); // Creates a controller for the given target GPU frame time and quality range
+	
+	/* Methods: */
+	double getTargetFrameTime(void) const // Returns the target GPU frame time
+		{
+		return targetFrameTime;
+		}
+	void setTargetFrameTime(double newTargetFrameTime); // Sets a new target GPU frame time
+	bool update(double gpuFrameTime,Scalar& quality); // Adjusts the given quality level based on a newly measured GPU frame time; returns true if the quality level changed
+	};
+
+#endif
@@ -0,0 +1,109 @@
+/***********************************************************************
+RidgeClassifier - Class to classify LiDAR points as ridges or else based
+on their neighborhoods.
+Copyright (c) 2009-2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "RidgeClassifier.h"
+
+#include <Math/Math.h>
+#include <Geometry/Vector.h>
+
+/*************************************************
+Methods of class RidgeClassifier::PointClassifier:
+*************************************************/
+
+RidgeClassifier::PointClassifier::PointClassifier(const Point& sQueryPoint,Scalar sRadius2,const PointPCACalculator::Plane& sPlane)
+	:queryPoint(sQueryPoint),radius2(sRadius2)
+	{
+	/* Calculate the transformation into the plane's local coordinate system: */
+	Vector z=sPlane.getNormal();
+	z.normalize();
+	Vector x=Geometry::normal(z);
+	x.normalize();
+	Vector y=Geometry::cross(z,x);
+	Point o=sPlane.project(queryPoint);
+	ATransform::Matrix m;
+	for(int i=0;i<3;++i)
+		{
+		m(i,0)=x[i];
+		m(i,1)=y[i];
+		m(i,2)=z[i];
+		m(i,3)=o[i];
+		}
+	toPlane=ATransform(m);
+	toPlane.doInvert();
+	}
+
+bool RidgeClassifier::PointClassifier::isRidge(void)
+	{
+	if(pcas[0].getNumPoints()>=2&&pcas[1].getNumPoints()>=2)
+		{
+		double radius=Math::sqrt(radius2);
+		
+		/* Calculate eigenvalues of both PCAs: */
+		double evs[2][2];
+		unsigned int numEvs[2];
+		bool isRidges[2];
+		for(int i=0;i<2;++i)
+			{
+			pcas[i].calcCovariance();
+			numEvs[i]=pcas[i].calcEigenvalues(evs[i]);
+			isRidges[i]=numEvs[i]==2&&Math::abs(evs[i][0])>=radius*0.75&&Math::abs(evs[i][1])<=radius*0.333;
+			}
+		
+		if(isRidges[0]&&!isRidges[1])
+			{
+			ATransform::Point qp=toPlane.transform(queryPoint);
+			return pcas[0].calcEigenvector(evs[0][1])*(Geometry::PCACalculator<2>::Point(qp[0],qp[1])-pcas[0].calcCentroid())<=1.0;
+			}
+		else if(!isRidges[0]&&isRidges[1])
+			{
+			ATransform::Point qp=toPlane.transform(queryPoint);
+			return pcas[1].calcEigenvector(evs[1][1])*(Geometry::PCACalculator<2>::Point(qp[0],qp[1])-pcas[1].calcCentroid())<=1.0;
+			}
+		else
+			return false;
+		}
+	else
+		return false;
+	}
+
+/********************************
+Methods of class RidgeClassifier:
+********************************/
+
+bool RidgeClassifier::isRidge(const Point& queryPoint,Scalar radius2,const LidarPoint* neighbors,size_t numNeighbors)
+	{
+	/* Points without enough neighbors to define a plane are not ridges: */
+	if(numNeighbors<3)
+		return false;
+	
+	/* Calculate the best-fitting plane of the point's neighborhood: */
+	PointPCACalculator ppca(queryPoint,radius2);
+	for(size_t i=0;i<numNeighbors;++i)
+		ppca(neighbors[i]);
+	
+	/* Run a ridge classifier on the same neighborhood: */
+	PointClassifier pc(queryPoint,radius2,ppca.getPlane());
+	for(size_t i=0;i<numNeighbors;++i)
+		pc(neighbors[i]);
+	return pc.isRidge();
+	}
@@ -0,0 +1,76 @@
+/***********************************************************************
+RidgeClassifier - Class to classify LiDAR points as ridges or else based
+on their neighborhoods.
+Copyright (c) 2009-2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+
+#ifndef RIDGECLASSIFIER_INCLUDED
+#define RIDGECLASSIFIER_INCLUDED
+
+#include <stddef.h>
+#include <Geometry/AffineTransformation.h>
+#include <Geometry/PCACalculator.h>
+
+#include "LidarTypes.h"
+#include "PointPCACalculator.h"
+
+class RidgeClassifier
+	{
+	/* Embedded classes: */
+	private:
+	class PointClassifier // Class to classify a point as ridge or else
+		{
+		/* Embedded classes: */
+		public:
+		typedef Geometry::AffineTransformation<double,3> ATransform; // Type for transformations into a plane's local coordinate system
+		
+		/* Elements: */
+		private:
+		Point queryPoint; // The query point for which to calculate a plane equation
+		Scalar radius2; // Squared search radius around query point
+		ATransform toPlane; // Transformation to plane's local coordinates
+		Geometry::PCACalculator<2> pcas[2]; // PCA calculators for points below and above the plane, respectively
+		
+		/* Constructors and destructors: */
+		public:
+		PointClassifier(const Point& sQueryPoint,Scalar sRadius2,const PointPCACalculator::Plane& sPlane); // Creates a classifier for the given query point and its neighborhood's best-fitting plane
+		
+		/* Methods: */
+		void operator()(const LidarPoint& lp) // Process the given LiDAR point
+			{
+			/* Convert the point to the plane's local coordinate system: */
+			ATransform::Point pp=toPlane.transform(lp);
+			
+			/* Accumulate the point into the lower or upper PCA calculator: */
+			if(pp[2]<0.0)
+				pcas[0].accumulatePoint(pp);
+			else
+				pcas[1].accumulatePoint(pp);
+			}
+		bool isRidge(void); // Returns true if the query point is a ridge point
+		};
+	
+	/* Methods: */
+	public:
+	static bool isRidge(const Point& queryPoint,Scalar radius2,const LidarPoint* neighbors,size_t numNeighbors); // Returns true if the given query point is a ridge point, based on its given neighborhood of the given squared radius, which includes the query point itself; fits the neighborhood's plane and classifies the point in two passes over the same points
+	};
+
+#endif
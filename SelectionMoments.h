@@ -0,0 +1,189 @@
+/***********************************************************************
+SelectionMoments - Class to maintain the zeroth, first, and second
+moments of a set of points to which points can be added and from which
+points can be removed, to calculate the set's centroid and principal
+axes without revisiting its points.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef SELECTIONMOMENTS_INCLUDED
+#define SELECTIONMOMENTS_INCLUDED
+
+#include <stddef.h>
+#include <Math/Math.h>
+#include <Geometry/Point.h>
+#include <Geometry/Vector.h>
+
+class SelectionMoments
+	{
+	/* Embedded classes: */
+	public:
+	typedef Geometry::Point<double,3> Point; // Type for points
+	typedef Geometry::Vector<double,3> Vector; // Type for vectors
+	
+	/* Elements: */
+	private:
+	size_t numPoints; // Number of points in the set
+	double sums[3]; // Sums of the points' coordinates
+	double productSums[6]; // Sums of the products of pairs of the points' coordinates, in order xx, xy, xz, yy, yz, zz
+	
+	/* Constructors and destructors: */
+	public:
+	SelectionMoments(void) // Creates moments of an empty point set
+		{
+		clear();
+		}
+	
+	/* Methods: */
+	void clear(void) // Removes all points from the set
+		{
+		numPoints=0;
+		for(int i=0;i<3;++i)
+			sums[i]=0.0;
+		for(int i=0;i<6;++i)
+			productSums[i]=0.0;
+		}
+	template <class PointParam>
+	void addPoint(const PointParam& p) // Adds a point to the set
+		{
+		++numPoints;
+		double pd[3];
+		for(int i=0;i<3;++i)
+			{
+			pd[i]=double(p[i]);
+			sums[i]+=pd[i];
+			}
+		double* psPtr=productSums;
+		for(int i=0;i<3;++i)
+			for(int j=i;j<3;++j,++psPtr)
+				*psPtr+=pd[i]*pd[j];
+		}
+	template <class PointParam>
+	void removePoint(const PointParam& p) // Removes a point that was previously added from the set
+		{
+		--numPoints;
+		double pd[3];
+		for(int i=0;i<3;++i)
+			{
+			pd[i]=double(p[i]);
+			sums[i]-=pd[i];
+			}
+		double* psPtr=productSums;
+		for(int i=0;i<3;++i)
+			for(int j=i;j<3;++j,++psPtr)
+				*psPtr-=pd[i]*pd[j];
+		}
+	SelectionMoments& operator+=(const SelectionMoments& other) // Adds all points of another set to the set
+		{
+		numPoints+=other.numPoints;
+		for(int i=0;i<3;++i)
+			sums[i]+=other.sums[i];
+		for(int i=0;i<6;++i)
+			productSums[i]+=other.productSums[i];
+		return *this;
+		}
+	size_t getNumPoints(void) const // Returns the number of points in the set
+		{
+		return numPoints;
+		}
+	Point calcCentroid(void) const // Returns the set's centroid; set must not be empty
+		{
+		Point result;
+		for(int i=0;i<3;++i)
+			result[i]=sums[i]/double(numPoints);
+		return result;
+		}
+	void calcCovariance(double covariance[3][3]) const // Returns the set's covariance matrix; set must not be empty
+		{
+		const double* psPtr=productSums;
+		for(int i=0;i<3;++i)
+			for(int j=i;j<3;++j,++psPtr)
+				covariance[j][i]=covariance[i][j]=(*psPtr-sums[i]*sums[j]/double(numPoints))/double(numPoints);
+		}
+	void calcPrincipalAxes(double eigenvalues[3],Vector eigenvectors[3]) const // Returns the eigenvalues of the set's covariance matrix in descending order, and their normalized eigenvectors
+		{
+		/* Diagonalize the covariance matrix using cyclic Jacobi rotations: */
+		double a[3][3];
+		calcCovariance(a);
+		double v[3][3]={{1.0,0.0,0.0},{0.0,1.0,0.0},{0.0,0.0,1.0}};
+		for(int sweep=0;sweep<50;++sweep)
+			{
+			double offDiagonal=Math::sqr(a[0][1])+Math::sqr(a[0][2])+Math::sqr(a[1][2]);
+			double diagonal=Math::sqr(a[0][0])+Math::sqr(a[1][1])+Math::sqr(a[2][2]);
+			if(offDiagonal<=diagonal*1.0e-30)
+				break;
+			
+			for(int p=0;p<2;++p)
+				for(int q=p+1;q<3;++q)
+					if(a[p][q]!=0.0)
+						{
+						/* Calculate the rotation that zeroes out the off-diagonal element: */
+						double theta=(a[q][q]-a[p][p])/(2.0*a[p][q]);
+						double t=1.0/(Math::abs(theta)+Math::sqrt(Math::sqr(theta)+1.0));
+						if(theta<0.0)
+							t=-t;
+						double c=1.0/Math::sqrt(Math::sqr(t)+1.0);
+						double s=t*c;
+						
+						/* Apply the rotation to the matrix from both sides and accumulate it into the eigenvectors: */
+						for(int k=0;k<3;++k)
+							{
+							double akp=a[k][p];
+							double akq=a[k][q];
+							a[k][p]=c*akp-s*akq;
+							a[k][q]=s*akp+c*akq;
+							}
+						for(int k=0;k<3;++k)
+							{
+							double apk=a[p][k];
+							double aqk=a[q][k];
+							a[p][k]=c*apk-s*aqk;
+							a[q][k]=s*apk+c*aqk;
+							}
+						for(int k=0;k<3;++k)
+							{
+							double vkp=v[k][p];
+							double vkq=v[k][q];
+							v[k][p]=c*vkp-s*vkq;
+							v[k][q]=s*vkp+c*vkq;
+							}
+						}
+			}
+		
+		/* Sort the eigenvalues in descending order: */
+		int order[3]={0,1,2};
+		for(int i=0;i<2;++i)
+			for(int j=i+1;j<3;++j)
+				if(a[order[i]][order[i]]<a[order[j]][order[j]])
+					{
+					int t=order[i];
+					order[i]=order[j];
+					order[j]=t;
+					}
+		for(int i=0;i<3;++i)
+			{
+			eigenvalues[i]=a[order[i]][order[i]];
+			for(int j=0;j<3;++j)
+				eigenvectors[i][j]=v[j][order[i]];
+			}
+		}
+	};
+
+#endif
@@ -1,6 +1,6 @@
 /***********************************************************************
 SpherePrimitive - Class for spheres extracted from point clouds.
-Copyright (c) 2007-2020 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -72,30 +72,41 @@ DataType::TypeID SpherePrimitive::type=DataType::TypeID(-1);
 Methods of class SpherePrimitive:
 ********************************/
 
-SpherePrimitive::SpherePrimitive(const LidarOctree* octree,const Primitive::Vector& translation)
+SpherePrimitive::SpherePrimitive(const LidarOctree* octree,const Primitive::Vector& translation,size_t maxNumFitPoints)
+	:subsampled(false)
 	{
-	/* Extract all selected points from the octree: */
-	LidarSelectionExtractor<SphereFitter::Point> lse;
+	/* Get the moments of the selected points: */
+	SelectionMoments moments=octree->getSelectionMoments();
+	
+	/* Extract all selected points, or an evenly strided subset if there are too many: */
+	size_t stride=1;
+	if(maxNumFitPoints>0&&moments.getNumPoints()>maxNumFitPoints)
+		{
+		stride=(moments.getNumPoints()+maxNumFitPoints-1)/maxNumFitPoints;
+		subsampled=true;
+		}
+	LidarSelectionExtractor<SphereFitter::Point> lse(stride);
 	octree->processSelectedPoints(lse);
 	
 	if(lse.getPoints().size()>=4)
 		{
-		/* Create a sphere fitter: */
-		SphereFitter sf(lse.getPoints());
-		
-		/* Minimize the target function: */
-		Scalar f=LevenbergMarquardtMinimizer<SphereFitter>::minimize(sf);
-		
-		/* Store the number of points and the RMS residual: */
-		numPoints=Misc::UInt64(lse.getPoints().size());
-		rms=Math::sqrt(f*Scalar(2)/Scalar(numPoints));
+		/* Initialize the sphere estimate from the selected points' centroid and their spread around it: */
+		Fit sphereFit;
+		sphereFit.center=moments.calcCentroid();
+		double evs[3];
+		SelectionMoments::Vector evecs[3];
+		moments.calcPrincipalAxes(evs,evecs);
+		sphereFit.radius=evs[0]+evs[1]+evs[2]>0.0?Scalar(Math::sqrt(evs[0]+evs[1]+evs[2])):Scalar(1);
 		
-		/* Extract the sphere parameters: */
-		point=sf.getCenter();
-		radius=sf.getRadius();
+		/* Fit the sphere to the extracted points: */
+		fit(lse.getPoints(),sphereFit);
+		setFit(sphereFit);
 		
 		/* Print the sphere's equation: */
-		std::cout<<"Sphere fitting "<<numPoints<<" points"<<std::endl;
+		std::cout<<"Sphere fitting "<<numPoints<<" points";
+		if(subsampled)
+			std::cout<<" of "<<moments.getNumPoints()<<" selected points";
+		std::cout<<std::endl;
 		std::cout<<"Center point: "<<(point+translation)<<std::endl;
 		std::cout<<"Radius: "<<radius<<std::endl;
 		std::cout<<"RMS approximation residual: "<<rms<<std::endl;
@@ -241,3 +252,41 @@ void SpherePrimitive::initContext(GLContextData& contextData) const
 	DataItem* dataItem=new DataItem;
 	contextData.addDataItem(this,dataItem);
 	}
+
+void SpherePrimitive::fit(const std::vector<Primitive::Point>& points,SpherePrimitive::Fit& fit,const volatile bool* cancel)
+	{
+	/* Create a sphere fitter starting from the given fit: */
+	SphereFitter sf(points);
+	sf.setCenter(fit.center);
+	sf.setRadius(fit.radius);
+	
+	/* Minimize the target function: */
+	Scalar f=LevenbergMarquardtMinimizer<SphereFitter>::minimize(sf,cancel);
+	
+	/* Store the sphere parameters, the number of points, and the RMS residual: */
+	fit.center=sf.getCenter();
+	fit.radius=sf.getRadius();
+	fit.numPoints=Misc::UInt64(points.size());
+	fit.rms=Math::sqrt(f*Scalar(2)/Scalar(fit.numPoints));
+	}
+
+SpherePrimitive::Fit SpherePrimitive::getFit(void) const
+	{
+	Fit result;
+	result.center=point;
+	result.radius=radius;
+	result.numPoints=numPoints;
+	result.rms=rms;
+	return result;
+	}
+
+void SpherePrimitive::setFit(const SpherePrimitive::Fit& newFit)
+	{
+	point=newFit.center;
+	radius=newFit.radius;
+	numPoints=newFit.numPoints;
+	rms=newFit.rms;
+	
+	/* Invalidate the sphere's visual representation: */
+	invalidate();
+	}
@@ -1,6 +1,6 @@
 /***********************************************************************
 SpherePrimitive - Class for spheres extracted from point clouds.
-Copyright (c) 2007-2020 Oliver Kreylos
+Copyright (c) 2007-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,6 +23,8 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef SPHEREPRIMITIVE_INCLUDED
 #define SPHEREPRIMITIVE_INCLUDED
 
+#include <stddef.h>
+#include <vector>
 #include <GL/gl.h>
 #include <GL/GLObject.h>
 
@@ -34,6 +36,17 @@ class LidarOctree;
 class SpherePrimitive:public PointPrimitive,public GLObject
 	{
 	/* Embedded classes: */
+	public:
+	struct Fit // Structure holding the parameters of a sphere fitted to a set of points
+		{
+		/* Elements: */
+		public:
+		Point center; // Sphere center
+		Scalar radius; // Sphere radius
+		Misc::UInt64 numPoints; // Number of fitted points
+		Scalar rms; // Root-mean square residual of the fit
+		};
+	
 	protected:
 	struct DataItem:public GLObject::DataItem
 		{
@@ -52,19 +65,23 @@ class SpherePrimitive:public PointPrimitive,public GLObject
 	static DataType::TypeID type; // Data type used by this primitive class
 	#endif
 	Scalar radius; // Sphere radius
+	bool subsampled; // Flag whether the sphere was fitted to a subset of the selected points
 	
 	/* Constructors and destructors: */
 	public:
 	SpherePrimitive(void) // Dummy constructor
+		:subsampled(false)
 		{
 		}
-	SpherePrimitive(const LidarOctree* octree,const Vector& translation); // Creates sphere by processing selected points from the given octree
+	SpherePrimitive(const LidarOctree* octree,const Vector& translation,size_t maxNumFitPoints =0); // Creates sphere by processing selected points from the given octree; fits to an evenly strided subset of the selected points if there are more than the given non-zero maximum
 	SpherePrimitive(IO::File& file,const Vector& translation) // Creates a sphere primitive by reading from a binary file
+		:subsampled(false)
 		{
 		/* Read the primitive: */
 		SpherePrimitive::read(file,translation);
 		}
 	SpherePrimitive(Cluster::MulticastPipe* pipe) // Creates a sphere primitive by reading from an intra-cluster pipe
+		:subsampled(false)
 		{
 		/* Read the primitive: */
 		SpherePrimitive::read(pipe);
@@ -91,6 +108,15 @@ class SpherePrimitive:public PointPrimitive,public GLObject
 	
 	/* Methods from class GLObject: */
 	virtual void initContext(GLContextData& contextData) const;
+	
+	/* New methods: */
+	static void fit(const std::vector<Point>& points,Fit& fit,const volatile bool* cancel =0); // Refines the given sphere fit against the given points; does not access any primitive and can be called from background threads
+	bool isSubsampled(void) const // Returns true if the sphere was fitted to a subset of the selected points
+		{
+		return subsampled;
+		}
+	Fit getFit(void) const; // Returns the sphere's current fit
+	void setFit(const Fit& newFit); // Replaces the sphere's fit with the given one
 	};
 
 #endif
@@ -0,0 +1,223 @@
+/***********************************************************************
+SubdivisionRequestHeap - Helper class to store octree nodes that are
+waiting to be subdivided by a node loader thread, in order of most
+recent/most coarsely resolved first.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef SUBDIVISIONREQUESTHEAP_INCLUDED
+#define SUBDIVISIONREQUESTHEAP_INCLUDED
+
+template <class NodeParam>
+class SubdivisionRequestHeap
+	{
+	/* Embedded classes: */
+	public:
+	typedef NodeParam Node; // Type of tree nodes
+	static const unsigned int notQueued=~0x0U-1U; // Heap index of nodes that do not have a pending subdivision request
+	static const unsigned int locked=~0x0U; // Heap index of nodes that are currently being subdivided by a node loader thread
+	
+	private:
+	struct HeapItem // Structure to store heap items
+		{
+		/* Elements: */
+		public:
+		Node* node; // Pointer to node stored in item
+		unsigned int renderPass; // Counter value of last rendering pass that requested subdivision of the node
+		float LOD; // LOD value of node in last rendering pass that requested its subdivision
+		bool interactive; // Flag whether the request came from an interaction tool, which preempts view-driven requests from the same rendering pass
+		
+		/* Constructors and destructors: */
+		HeapItem(void)
+			:node(0),renderPass(0U),LOD(0.0f),interactive(false)
+			{
+			};
+		
+		/* Methods: */
+		friend bool operator>=(const HeapItem& item1,const HeapItem& item2) // Comparison operator for heap ordering
+			{
+			if(item1.renderPass!=item2.renderPass)
+				return item1.renderPass>item2.renderPass;
+			else if(item1.interactive!=item2.interactive)
+				return item1.interactive;
+			else
+				return item1.LOD>=item2.LOD;
+			};
+		};
+	
+	/* Elements: */
+	unsigned int maxNumItems; // Maximum number of items in heap
+	HeapItem* items; // Array of heap items
+	unsigned int numItems; // Current number of items in heap
+	
+	/* Private methods: */
+	void set(unsigned int index,const HeapItem& item) // Stores an item at the given heap position and updates its node's heap index
+		{
+		items[index]=item;
+		items[index].node->subdivisionQueueIndex=index;
+		};
+	void percolate(unsigned int index) // Moves the item at the given position to its proper place in the heap
+		{
+		HeapItem item=items[index];
+		
+		/* Let the item percolate up the heap: */
+		while(index>0U)
+			{
+			unsigned int parent=(index-1U)>>1;
+			if(items[parent]>=item)
+				break;
+			set(index,items[parent]);
+			index=parent;
+			}
+		
+		/* Then let the item trickle down to its final position: */
+		while(true)
+			{
+			unsigned int maxIndex=index;
+			const HeapItem* maxItem=&item;
+			unsigned int child=(index<<1)+1U;
+			if(child<numItems&&!(*maxItem>=items[child]))
+				{
+				maxIndex=child;
+				maxItem=&items[child];
+				}
+			++child;
+			if(child<numItems&&!(*maxItem>=items[child]))
+				maxIndex=child;
+			if(maxIndex==index)
+				break;
+			set(index,items[maxIndex]);
+			index=maxIndex;
+			}
+		
+		set(index,item);
+		};
+	void removeAt(unsigned int index) // Removes the item at the given heap position
+		{
+		/* Replace the removed item with the bottom item of the heap: */
+		items[index].node->subdivisionQueueIndex=notQueued;
+		--numItems;
+		if(index<numItems)
+			{
+			set(index,items[numItems]);
+			percolate(index);
+			}
+		};
+	
+	/* Constructors and destructors: */
+	public:
+	SubdivisionRequestHeap(unsigned int sMaxNumItems) // Creates heap for given number of items
+		:maxNumItems(sMaxNumItems),
+		 items(new HeapItem[maxNumItems]),
+		 numItems(0U)
+		{
+		};
+	~SubdivisionRequestHeap(void) // Destroys heap
+		{
+		delete[] items;
+		};
+	
+	/* Methods: */
+	unsigned int getMaxNumItems(void) const // Returns the maximum number of items in heap
+		{
+		return maxNumItems;
+		};
+	unsigned int getNumItems(void) const // Returns current number of items in heap
+		{
+		return numItems;
+		};
+	bool request(Node* node,unsigned int renderPass,float LOD,bool interactive =false) // Inserts or updates a subdivision request for the given node; returns true if a new request was queued
+		{
+		/* Ignore nodes that are currently being subdivided: */
+		if(node->subdivisionQueueIndex==locked)
+			return false;
+		
+		HeapItem newItem;
+		newItem.node=node;
+		newItem.renderPass=renderPass;
+		newItem.LOD=LOD;
+		newItem.interactive=interactive;
+		
+		if(node->subdivisionQueueIndex!=notQueued)
+			{
+			/* Update the node's existing request if it became more urgent: */
+			unsigned int index=node->subdivisionQueueIndex;
+			if(!(items[index]>=newItem))
+				{
+				items[index]=newItem;
+				percolate(index);
+				}
+			return false;
+			}
+		
+		if(numItems==maxNumItems)
+			{
+			/* Compare against the bottom item, which is a leaf and thus among the least urgent requests: */
+			if(items[numItems-1U]>=newItem)
+				return false;
+			
+			/* Drop the bottom request to make room: */
+			removeAt(numItems-1U);
+			}
+		
+		/* Insert the new item at the bottom of the heap and let it percolate up: */
+		items[numItems]=newItem;
+		++numItems;
+		percolate(numItems-1U);
+		
+		return true;
+		};
+	Node* removeTop(void) // Removes and returns the most urgent request's node, or 0 if heap is empty; node's heap index is set to locked
+		{
+		if(numItems==0U)
+			return 0;
+		
+		Node* result=items[0].node;
+		removeAt(0);
+		result->subdivisionQueueIndex=locked;
+		return result;
+		};
+	void remove(Node* node) // Withdraws the given node's pending subdivision request, if there is one
+		{
+		if(node->subdivisionQueueIndex!=notQueued&&node->subdivisionQueueIndex!=locked)
+			removeAt(node->subdivisionQueueIndex);
+		};
+	bool checkHeap(void) const // Checks the heap for internal consistency
+		{
+		for(unsigned int i=0;i<numItems;++i)
+			{
+			/* Check if the node's heap index matches its position: */
+			if(items[i].node->subdivisionQueueIndex!=i)
+				return false;
+			
+			/* Check the heap invariant: */
+			unsigned int child=(i<<1)+1U;
+			if(child<numItems&&!(items[i]>=items[child]))
+				return false;
+			++child;
+			if(child<numItems&&!(items[i]>=items[child]))
+				return false;
+			}
+		
+		return true;
+		};
+	};
+
+#endif
@@ -1,7 +1,7 @@
 /***********************************************************************
 SubtractorHelper - Helper functions and classes for point subtraction
 utilities.
-Copyright (c) 2009-2020 Oliver Kreylos
+Copyright (c) 2009-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -23,9 +23,14 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 
 #include "SubtractorHelper.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
 #include <iostream>
+#include <Misc/StdError.h>
 #include <Misc/FileNameExtensions.h>
 #include <IO/File.h>
 #include <IO/OpenFile.h>
@@ -134,3 +139,371 @@ Geometry::ArrayKdTree<Point>* loadSubtractSet(const char* fileName,const Geometr
 	
 	return subtractPointTree;
 	}
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+template <class PointFunctorParam>
+inline
+void
+readSubtractPoints(
+	const char* fileName,
+	const Geometry::Vector<double,3>& offset,
+	PointFunctorParam& pointFunctor)
+	{
+	if(Misc::hasCaseExtension(fileName,".bin"))
+		{
+		/* Read a point set from a binary file in octree coordinates: */
+		IO::FilePtr pointFile(IO::openFile(fileName));
+		pointFile->setEndianness(Misc::LittleEndian);
+		unsigned int numPoints=pointFile->read<unsigned int>();
+		Geometry::Vector<float,3> o=offset;
+		for(unsigned int i=0;i<numPoints;++i)
+			{
+			/* Read a LiDAR point and apply the offset: */
+			LidarPoint lp=pointFile->read<LidarPoint>();
+			lp-=o;
+			pointFunctor(Point(lp));
+			}
+		}
+	else
+		{
+		/* Read a point set from an ASCII file: */
+		IO::ValueSource subtractSource(new IO::ReadAheadFilter(IO::openFile(fileName)));
+		subtractSource.setWhitespace(',',true);
+		subtractSource.setPunctuation('\n',true);
+		subtractSource.skipWs();
+		while(!subtractSource.eof())
+			{
+			/* Read the next point and subtract the base file's point offset: */
+			Point p;
+			for(int i=0;i<3;++i)
+				p[i]=Scalar(subtractSource.readNumber()-offset[i]);
+			pointFunctor(p);
+			
+			/* Skip the rest of the line: */
+			subtractSource.skipLine();
+			subtractSource.skipWs();
+			}
+		}
+	}
+
+int createTileFile(char* fileNameTemplate)
+	{
+	/* Create the temporary file: */
+	int result=mkstemp(fileNameTemplate);
+	
+	/* Check for errors: */
+	if(result<0)
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,errno,"Cannot create temporary tile file %s",fileNameTemplate);
+	
+	/* Immediately unlink the temporary file; it will stay alive until the file handle is closed: */
+	unlink(fileNameTemplate);
+	
+	return result;
+	}
+
+/**************
+Helper classes:
+**************/
+
+class TilePointCounter // Functor to count the points falling into each tile
+	{
+	/* Elements: */
+	public:
+	std::vector<size_t> numTilePoints; // Number of points in each tile
+	
+	/* Constructors and destructors: */
+	TilePointCounter(size_t numTiles)
+		:numTilePoints(numTiles,0)
+		{
+		}
+	
+	/* Methods: */
+	void operator()(unsigned int tileIndex,const Point& p)
+		{
+		++numTilePoints[tileIndex];
+		}
+	};
+
+class TilePointWriter // Functor to write points into their tiles' sections of the tile file
+	{
+	/* Embedded classes: */
+	private:
+	static const size_t maxNumBufferedPoints=256; // Number of points buffered for each tile before they are written
+	
+	/* Elements: */
+	IO::StandardFile& tileFile; // The tile file
+	std::vector<IO::StandardFile::Offset> nextPoint; // Index of the next point to be written for each tile
+	std::vector<std::vector<Point> > buffers; // Point buffers for each tile
+	
+	/* Private methods: */
+	void flush(unsigned int tileIndex) // Writes the given tile's buffered points
+		{
+		std::vector<Point>& buffer=buffers[tileIndex];
+		tileFile.setWritePosAbs(nextPoint[tileIndex]*IO::StandardFile::Offset(sizeof(Point)));
+		tileFile.writeRaw(&buffer[0],buffer.size()*sizeof(Point));
+		nextPoint[tileIndex]+=IO::StandardFile::Offset(buffer.size());
+		buffer.clear();
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	TilePointWriter(IO::StandardFile& sTileFile,const std::vector<IO::StandardFile::Offset>& sFirstPoints)
+		:tileFile(sTileFile),nextPoint(sFirstPoints),buffers(sFirstPoints.size())
+		{
+		}
+	
+	/* Methods: */
+	void operator()(unsigned int tileIndex,const Point& p)
+		{
+		buffers[tileIndex].push_back(p);
+		if(buffers[tileIndex].size()==maxNumBufferedPoints)
+			flush(tileIndex);
+		}
+	void finish(void) // Writes all remaining buffered points
+		{
+		for(unsigned int tileIndex=0;tileIndex<buffers.size();++tileIndex)
+			if(!buffers[tileIndex].empty())
+				flush(tileIndex);
+		}
+	};
+
+template <class TileFunctorParam>
+class TileBucketer // Functor to assign subtraction points to all tiles within epsilon
+	{
+	/* Elements: */
+	private:
+	const Cube& domain; // Domain covered by the tiles
+	unsigned int numTilesPerAxis; // Number of tiles along each axis
+	double tileSize; // Side length of each tile
+	Scalar epsilon; // Maximum matching distance
+	TileFunctorParam& tileFunctor; // Functor receiving points and the tiles they fall into
+	
+	/* Constructors and destructors: */
+	public:
+	TileBucketer(const Cube& sDomain,unsigned int sNumTilesPerAxis,double sTileSize,Scalar sEpsilon,TileFunctorParam& sTileFunctor)
+		:domain(sDomain),numTilesPerAxis(sNumTilesPerAxis),tileSize(sTileSize),epsilon(sEpsilon),
+		 tileFunctor(sTileFunctor)
+		{
+		}
+	
+	/* Methods: */
+	void operator()(const Point& p)
+		{
+		/* Find the range of tiles within epsilon of the point: */
+		int tileMin[3],tileMax[3];
+		for(int i=0;i<3;++i)
+			{
+			/* Ignore points that can not match any point inside the domain: */
+			if(p[i]+epsilon<domain.getMin()[i]||p[i]-epsilon>=domain.getMax()[i])
+				return;
+			
+			tileMin[i]=int(Math::floor((double(p[i])-double(epsilon)-double(domain.getMin()[i]))/tileSize));
+			tileMax[i]=int(Math::floor((double(p[i])+double(epsilon)-double(domain.getMin()[i]))/tileSize));
+			if(tileMin[i]<0)
+				tileMin[i]=0;
+			if(tileMax[i]>int(numTilesPerAxis)-1)
+				tileMax[i]=int(numTilesPerAxis)-1;
+			}
+		
+		/* Add the point to all tiles in the range: */
+		for(int x=tileMin[0];x<=tileMax[0];++x)
+			for(int y=tileMin[1];y<=tileMax[1];++y)
+				for(int z=tileMin[2];z<=tileMax[2];++z)
+					tileFunctor((unsigned int)((x*numTilesPerAxis+y)*numTilesPerAxis+z),p);
+		}
+	};
+
+struct CellPoint // Structure to sort a tile's points by hashed grid cell
+	{
+	/* Elements: */
+	public:
+	Misc::UInt64 key; // Key of the cell containing the point
+	Point point; // The point
+	
+	/* Methods: */
+	bool operator<(const CellPoint& other) const
+		{
+		return key<other.key;
+		}
+	};
+
+}
+
+/*******************************************
+Methods of class TiledSubtractSet::TileGrid:
+*******************************************/
+
+TiledSubtractSet::TileGrid::TileGrid(const double sOrigin[3],double sCellSize,Scalar sEpsilon2,std::vector<Point>& sPoints)
+	:cellSize(sCellSize),epsilon2(sEpsilon2),
+	 cells(sPoints.size()/4+17)
+	{
+	for(int i=0;i<3;++i)
+		origin[i]=sOrigin[i];
+	
+	/* Sort the tile's points by cell: */
+	std::vector<CellPoint> cellPoints(sPoints.size());
+	for(size_t i=0;i<sPoints.size();++i)
+		{
+		int cellIndex[3];
+		getCellIndex(sPoints[i],cellIndex);
+		cellPoints[i].key=getCellKey(cellIndex);
+		cellPoints[i].point=sPoints[i];
+		}
+	std::sort(cellPoints.begin(),cellPoints.end());
+	
+	/* Store the sorted points and enter each cell's point range into the hash table: */
+	points.swap(sPoints);
+	unsigned int first=0;
+	for(unsigned int i=0;i<cellPoints.size();++i)
+		{
+		points[i]=cellPoints[i].point;
+		if(i+1==cellPoints.size()||cellPoints[i+1].key!=cellPoints[i].key)
+			{
+			CellPoints cp;
+			cp.firstPoint=first;
+			cp.numPoints=i+1-first;
+			cells.setEntry(CellHasher::Entry(cellPoints[i].key,cp));
+			first=i+1;
+			}
+		}
+	}
+
+bool TiledSubtractSet::TileGrid::findMatch(const Point& p) const
+	{
+	/* Check the cell containing the point and all its neighbors: */
+	int cellIndex[3];
+	getCellIndex(p,cellIndex);
+	int ci[3];
+	for(ci[0]=cellIndex[0]-1;ci[0]<=cellIndex[0]+1;++ci[0])
+		for(ci[1]=cellIndex[1]-1;ci[1]<=cellIndex[1]+1;++ci[1])
+			for(ci[2]=cellIndex[2]-1;ci[2]<=cellIndex[2]+1;++ci[2])
+				{
+				CellHasher::ConstIterator cIt=cells.findEntry(getCellKey(ci));
+				if(!cIt.isFinished())
+					{
+					const CellPoints& cp=cIt->getDest();
+					for(unsigned int i=0;i<cp.numPoints;++i)
+						if(Geometry::sqrDist(points[cp.firstPoint+i],p)<epsilon2)
+							return true;
+					}
+				}
+	
+	return false;
+	}
+
+/*********************************
+Methods of class TiledSubtractSet:
+*********************************/
+
+TiledSubtractSet::TiledSubtractSet(const char* fileName,const Geometry::Vector<double,3>& offset,const Cube& sDomain,unsigned int tileLevel,Scalar sEpsilon,char* tempFileNameTemplate,size_t sMaxNumLoadedPoints)
+	:domain(sDomain),
+	 numTilesPerAxis(1U<<tileLevel),
+	 tileSize((double(domain.getMax()[0])-double(domain.getMin()[0]))/double(numTilesPerAxis)),
+	 epsilon(sEpsilon),
+	 tileFile(createTileFile(tempFileNameTemplate),IO::StandardFile::ReadWrite),
+	 tiles(size_t(numTilesPerAxis)*size_t(numTilesPerAxis)*size_t(numTilesPerAxis)),
+	 maxNumLoadedPoints(sMaxNumLoadedPoints),numLoadedPoints(0),
+	 useCounter(0)
+	{
+	/* Use cells at least epsilon in size, but no more than 2^20 cells per tile side to fit cell keys into 64 bits: */
+	cellSize=Math::max(double(epsilon),tileSize/double(1U<<20))*(1.0+1.0e-6);
+	
+	/* Count the number of subtraction points in each tile: */
+	std::cout<<"Bucketing subtraction points from file "<<fileName<<" into "<<tiles.size()<<" tiles..."<<std::flush;
+	TilePointCounter tpc(tiles.size());
+	{
+	TileBucketer<TilePointCounter> tb(domain,numTilesPerAxis,tileSize,epsilon,tpc);
+	readSubtractPoints(fileName,offset,tb);
+	}
+	
+	/* Lay out the tiles in the tile file: */
+	std::vector<IO::StandardFile::Offset> firstPoints(tiles.size());
+	IO::StandardFile::Offset numTotalPoints=0;
+	for(size_t i=0;i<tiles.size();++i)
+		{
+		if(tpc.numTilePoints[i]>size_t(~0U))
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Too many subtraction points in a single tile; use a deeper tile level");
+		tiles[i].firstPoint=numTotalPoints;
+		tiles[i].numPoints=(unsigned int)tpc.numTilePoints[i];
+		tiles[i].grid=0;
+		tiles[i].refCount=0;
+		tiles[i].lastUse=0;
+		firstPoints[i]=numTotalPoints;
+		numTotalPoints+=IO::StandardFile::Offset(tiles[i].numPoints);
+		}
+	
+	/* Write the subtraction points into their tiles: */
+	{
+	TilePointWriter tpw(tileFile,firstPoints);
+	TileBucketer<TilePointWriter> tb(domain,numTilesPerAxis,tileSize,epsilon,tpw);
+	readSubtractPoints(fileName,offset,tb);
+	tpw.finish();
+	}
+	std::cout<<" done, "<<numTotalPoints<<" tile points"<<std::endl;
+	}
+
+TiledSubtractSet::~TiledSubtractSet(void)
+	{
+	/* Delete all loaded tile grids: */
+	for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		delete tIt->grid;
+	}
+
+const TiledSubtractSet::TileGrid& TiledSubtractSet::acquireTile(unsigned int tileIndex)
+	{
+	Threads::Mutex::Lock tileLock(tileMutex);
+	
+	Tile& tile=tiles[tileIndex];
+	if(tile.grid==0)
+		{
+		/* Evict least-recently used unused tiles until the new tile fits into the memory limit: */
+		while(numLoadedPoints>0&&numLoadedPoints+tile.numPoints>maxNumLoadedPoints)
+			{
+			Tile* lruTile=0;
+			for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+				if(tIt->grid!=0&&tIt->refCount==0&&(lruTile==0||lruTile->lastUse>tIt->lastUse))
+					lruTile=&*tIt;
+			if(lruTile==0)
+				break;
+			numLoadedPoints-=lruTile->grid->getNumPoints();
+			delete lruTile->grid;
+			lruTile->grid=0;
+			}
+		
+		/* Read the tile's points: */
+		std::vector<Point> tilePoints(tile.numPoints);
+		if(tile.numPoints>0)
+			{
+			tileFile.setReadPosAbs(tile.firstPoint*IO::StandardFile::Offset(sizeof(Point)));
+			tileFile.readRaw(&tilePoints[0],tilePoints.size()*sizeof(Point));
+			}
+		
+		/* Create the tile's hashed grid: */
+		unsigned int tileIndices[3];
+		tileIndices[2]=tileIndex%numTilesPerAxis;
+		tileIndices[1]=(tileIndex/numTilesPerAxis)%numTilesPerAxis;
+		tileIndices[0]=tileIndex/(numTilesPerAxis*numTilesPerAxis);
+		double origin[3];
+		for(int i=0;i<3;++i)
+			origin[i]=double(domain.getMin()[i])+double(tileIndices[i])*tileSize;
+		tile.grid=new TileGrid(origin,cellSize,Math::sqr(epsilon),tilePoints);
+		numLoadedPoints+=tile.numPoints;
+		}
+	
+	/* Mark the tile as used: */
+	++tile.refCount;
+	tile.lastUse=++useCounter;
+	
+	return *tile.grid;
+	}
+
+void TiledSubtractSet::releaseTile(unsigned int tileIndex)
+	{
+	Threads::Mutex::Lock tileLock(tileMutex);
+	--tiles[tileIndex].refCount;
+	}
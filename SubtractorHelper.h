@@ -1,7 +1,7 @@
 /***********************************************************************
 SubtractorHelper - Helper functions and classes for point subtraction
 utilities.
-Copyright (c) 2009-2013 Oliver Kreylos
+Copyright (c) 2009-2026 Oliver Kreylos
 
 This file is part of the LiDAR processing and analysis package.
 
@@ -24,10 +24,16 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #ifndef SUBTRACTORHELPER_INCLUDED
 #define SUBTRACTORHELPER_INCLUDED
 
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <Misc/HashTable.h>
+#include <Threads/Mutex.h>
+#include <IO/StandardFile.h>
 #include <Math/Math.h>
 #include <Geometry/ArrayKdTree.h>
 
 #include "LidarTypes.h"
+#include "Cube.h"
 
 /* Forward declarations: */
 namespace Geometry {
@@ -76,4 +82,103 @@ class MatchingPointFinder
 typedef Geometry::ArrayKdTree<Point> PointKdTree;
 PointKdTree* loadSubtractSet(const char* fileName,const Geometry::Vector<double,3>& offset,int numThreads =1);
 
+/* Class to match points against an out-of-core subtraction point set using hashed grids: */
+class TiledSubtractSet
+	{
+	/* Embedded classes: */
+	public:
+	class TileGrid // Class to find matching points inside one tile using a hashed grid of epsilon-sized cells
+		{
+		friend class TiledSubtractSet;
+		
+		/* Embedded classes: */
+		private:
+		struct CellPoints // Structure to locate a cell's points in the tile's point array
+			{
+			/* Elements: */
+			public:
+			unsigned int firstPoint; // Index of the cell's first point
+			unsigned int numPoints; // Number of points in the cell
+			};
+		typedef Misc::HashTable<Misc::UInt64,CellPoints> CellHasher; // Hash table mapping cell keys to cells' points
+		
+		/* Elements: */
+		double origin[3]; // Position of the tile's minimum corner
+		double cellSize; // Side length of the hashed grid's cells; at least epsilon
+		Scalar epsilon2; // Squared matching distance
+		std::vector<Point> points; // The tile's points, sorted by cell
+		CellHasher cells; // Hash table of the tile's non-empty cells
+		
+		/* Private methods: */
+		Misc::UInt64 getCellKey(int cellIndex[3]) const // Returns the hash key of the given cell; accepts indices from -1 to 2^21-2
+			{
+			return (Misc::UInt64(cellIndex[0]+1)<<42)|(Misc::UInt64(cellIndex[1]+1)<<21)|Misc::UInt64(cellIndex[2]+1);
+			}
+		void getCellIndex(const Point& p,int cellIndex[3]) const // Returns the index of the cell containing the given point
+			{
+			for(int i=0;i<3;++i)
+				cellIndex[i]=int(Math::floor((double(p[i])-origin[i])/cellSize));
+			}
+		
+		/* Constructors and destructors: */
+		TileGrid(const double sOrigin[3],double sCellSize,Scalar sEpsilon2,std::vector<Point>& sPoints); // Creates a grid for the given tile's points; takes ownership of the point vector's contents
+		
+		/* Methods: */
+		public:
+		size_t getNumPoints(void) const // Returns the number of points in the tile
+			{
+			return points.size();
+			}
+		bool findMatch(const Point& p) const; // Returns true if the tile contains a point within epsilon of the given point
+		};
+	
+	private:
+	struct Tile // Structure describing a tile in the tile file and in memory
+		{
+		/* Elements: */
+		public:
+		IO::StandardFile::Offset firstPoint; // Index of the tile's first point in the tile file
+		unsigned int numPoints; // Number of points in the tile, including copies of points from adjacent tiles within epsilon
+		TileGrid* grid; // Hashed grid for the tile's points if the tile is loaded
+		unsigned int refCount; // Number of clients currently using the tile's grid
+		unsigned int lastUse; // Time stamp of the tile's most recent use
+		};
+	
+	/* Elements: */
+	Cube domain; // Domain covered by the tiles
+	unsigned int numTilesPerAxis; // Number of tiles along each axis
+	double tileSize; // Side length of each tile
+	Scalar epsilon; // Maximum matching distance
+	double cellSize; // Side length of hashed grid cells
+	IO::StandardFile tileFile; // Temporary file containing the subtraction points bucketed by tile
+	std::vector<Tile> tiles; // Array of tiles in x-major order
+	Threads::Mutex tileMutex; // Mutex protecting the tile array and the tile file
+	size_t maxNumLoadedPoints; // Number of points above which unused tiles are evicted from memory
+	size_t numLoadedPoints; // Number of points in currently loaded tiles
+	unsigned int useCounter; // Time stamp for the next tile use
+	
+	/* Constructors and destructors: */
+	public:
+	TiledSubtractSet(const char* fileName,const Geometry::Vector<double,3>& offset,const Cube& sDomain,unsigned int tileLevel,Scalar sEpsilon,char* tempFileNameTemplate,size_t sMaxNumLoadedPoints); // Buckets an ASCII or binary point file into tiles aligned with the nodes of the given level of an octree over the given domain, in a temporary file created from the given mkstemp template
+	~TiledSubtractSet(void);
+	
+	/* Methods: */
+	unsigned int findTile(const Point& p) const // Returns the index of the tile containing the given point
+		{
+		unsigned int tileIndex=0;
+		for(int i=0;i<3;++i)
+			{
+			int ti=int(Math::floor((double(p[i])-double(domain.getMin()[i]))/tileSize));
+			if(ti<0)
+				ti=0;
+			if(ti>int(numTilesPerAxis)-1)
+				ti=int(numTilesPerAxis)-1;
+			tileIndex=tileIndex*numTilesPerAxis+(unsigned int)ti;
+			}
+		return tileIndex;
+		}
+	const TileGrid& acquireTile(unsigned int tileIndex); // Returns the hashed grid of the given tile, loading it if necessary; tile must be released after use
+	void releaseTile(unsigned int tileIndex); // Releases a previously acquired tile
+	};
+
 #endif
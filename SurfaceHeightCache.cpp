@@ -0,0 +1,221 @@
+/***********************************************************************
+SurfaceHeightCache - Class to cache heightfield tiles of the highest LiDAR
+points around a position, to align surface-aligned navigation quickly.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "SurfaceHeightCache.h"
+
+#include <algorithm>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+#include "LidarOctree.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline int floorDiv(int a,int b) // Returns a divided by positive b, rounded towards negative infinity
+	{
+	return a>=0?a/b:-((-a-1)/b)-1;
+	}
+
+/**************************************************
+Helper class to collect the highest point per cell:
+**************************************************/
+
+class HeightBinner
+	{
+	/* Elements: */
+	private:
+	Scalar origin[2]; // Position of the tile's lower-left corner
+	Scalar cellSize; // Size of a cell
+	Scalar* heights; // Heights of the tile's cells
+	
+	/* Constructors and destructors: */
+	public:
+	HeightBinner(const Box& tileBox,Scalar sCellSize,Scalar* sHeights)
+		:cellSize(sCellSize),heights(sHeights)
+		{
+		for(int i=0;i<2;++i)
+			origin[i]=tileBox.min[i];
+		}
+	
+	/* Methods: */
+	void operator()(const LidarPoint& p) // Processes a LiDAR point
+		{
+		/* Find the cell containing the point, clamping points on the tile's upper edges: */
+		int cell[2];
+		for(int i=0;i<2;++i)
+			{
+			cell[i]=int(Math::floor((p[i]-origin[i])/cellSize));
+			if(cell[i]<0)
+				cell[i]=0;
+			if(cell[i]>=SurfaceHeightCache::tileSize)
+				cell[i]=SurfaceHeightCache::tileSize-1;
+			}
+		
+		/* Update the cell's height: */
+		Scalar& height=heights[cell[1]*SurfaceHeightCache::tileSize+cell[0]];
+		if(height<p[2])
+			height=p[2];
+		}
+	};
+
+}
+
+/***********************************
+Methods of class SurfaceHeightCache:
+***********************************/
+
+SurfaceHeightCache::Tile* SurfaceHeightCache::findTile(int tileX,int tileY) const
+	{
+	for(std::vector<Tile*>::const_iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		if((*tIt)->index[0]==tileX&&(*tIt)->index[1]==tileY)
+			return *tIt;
+	return 0;
+	}
+
+bool SurfaceHeightCache::getCellHeight(int cellX,int cellY,Scalar& height)
+	{
+	/* Find the tile containing the cell: */
+	int tileX=floorDiv(cellX,tileSize);
+	int tileY=floorDiv(cellY,tileSize);
+	Tile* tile=findTile(tileX,tileY);
+	if(tile==0)
+		return false;
+	tile->lastUsed=lookupCounter;
+	
+	/* Return the cell's height if it contains any points: */
+	height=tile->heights[(cellY-tileY*tileSize)*tileSize+(cellX-tileX*tileSize)];
+	return height!=Math::Constants<Scalar>::min;
+	}
+
+void SurfaceHeightCache::buildTile(int tileX,int tileY,LidarOctree* const* octrees,int numOctrees)
+	{
+	Tile* tile=findTile(tileX,tileY);
+	if(tile==0)
+		{
+		if(tiles.size()<maxNumTiles)
+			{
+			/* Add a new tile: */
+			tile=new Tile;
+			tile->heights.resize(tileSize*tileSize);
+			tiles.push_back(tile);
+			}
+		else
+			{
+			/* Replace the least recently used tile: */
+			tile=tiles.front();
+			for(std::vector<Tile*>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+				if(tile->lastUsed>(*tIt)->lastUsed)
+					tile=*tIt;
+			}
+		tile->index[0]=tileX;
+		tile->index[1]=tileY;
+		}
+	tile->version=version;
+	tile->lastUsed=lookupCounter;
+	
+	/* Collect the highest point of each cell from the nodes in memory: */
+	Box tileBox=Box::full;
+	tileBox.min[0]=Scalar(tileX*tileSize)*cellSize;
+	tileBox.min[1]=Scalar(tileY*tileSize)*cellSize;
+	tileBox.max[0]=tileBox.min[0]+Scalar(tileSize)*cellSize;
+	tileBox.max[1]=tileBox.min[1]+Scalar(tileSize)*cellSize;
+	std::fill(tile->heights.begin(),tile->heights.end(),Math::Constants<Scalar>::min);
+	HeightBinner hb(tileBox,cellSize,&tile->heights.front());
+	for(int i=0;i<numOctrees;++i)
+		octrees[i]->processPointsInBox(tileBox,hb);
+	}
+
+SurfaceHeightCache::SurfaceHeightCache(void)
+	:cellSize(0),
+	 version(0),lookupCounter(0),
+	 haveLastQuery(false)
+	{
+	}
+
+SurfaceHeightCache::~SurfaceHeightCache(void)
+	{
+	for(std::vector<Tile*>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		delete *tIt;
+	}
+
+void SurfaceHeightCache::setCellSize(Scalar newCellSize)
+	{
+	if(cellSize!=newCellSize)
+		{
+		/* Flush the cache: */
+		for(std::vector<Tile*>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+			delete *tIt;
+		tiles.clear();
+		cellSize=newCellSize;
+		haveLastQuery=false;
+		}
+	}
+
+bool SurfaceHeightCache::getHeight(const Point& p,Scalar& height)
+	{
+	++lookupCounter;
+	
+	/* Find the four cells whose centers surround the position: */
+	Scalar cx=p[0]/cellSize-Scalar(0.5);
+	Scalar cy=p[1]/cellSize-Scalar(0.5);
+	int cellX=int(Math::floor(cx));
+	int cellY=int(Math::floor(cy));
+	lastQueryCell[0]=cellX;
+	lastQueryCell[1]=cellY;
+	haveLastQuery=true;
+	
+	/* Interpolate the cells' heights if all of them are known: */
+	Scalar h00,h10,h01,h11;
+	if(!getCellHeight(cellX,cellY,h00)||!getCellHeight(cellX+1,cellY,h10)||!getCellHeight(cellX,cellY+1,h01)||!getCellHeight(cellX+1,cellY+1,h11))
+		return false;
+	Scalar wx=cx-Scalar(cellX);
+	Scalar wy=cy-Scalar(cellY);
+	height=(h00*(Scalar(1)-wx)+h10*wx)*(Scalar(1)-wy)+(h01*(Scalar(1)-wx)+h11*wx)*wy;
+	
+	return true;
+	}
+
+void SurfaceHeightCache::update(LidarOctree* const* octrees,int numOctrees)
+	{
+	if(!haveLastQuery)
+		return;
+	
+	/* Check the tile containing the most recently queried position first, then its neighbors: */
+	int tileX=floorDiv(lastQueryCell[0],tileSize);
+	int tileY=floorDiv(lastQueryCell[1],tileSize);
+	static const int offsets[9][2]={{0,0},{-1,0},{1,0},{0,-1},{0,1},{-1,-1},{1,-1},{-1,1},{1,1}};
+	for(int i=0;i<9;++i)
+		{
+		/* Build the first missing or out-of-date tile: */
+		Tile* tile=findTile(tileX+offsets[i][0],tileY+offsets[i][1]);
+		if(tile==0||tile->version!=version)
+			{
+			buildTile(tileX+offsets[i][0],tileY+offsets[i][1],octrees,numOctrees);
+			break;
+			}
+		}
+	}
@@ -0,0 +1,84 @@
+/***********************************************************************
+SurfaceHeightCache - Class to cache heightfield tiles of the highest LiDAR
+points around a position, to align surface-aligned navigation quickly.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef SURFACEHEIGHTCACHE_INCLUDED
+#define SURFACEHEIGHTCACHE_INCLUDED
+
+#include <vector>
+
+#include "LidarTypes.h"
+
+/* Forward declarations: */
+class LidarOctree;
+
+class SurfaceHeightCache
+	{
+	/* Embedded classes: */
+	public:
+	static const int tileSize=32; // Number of cells along each side of a square tile
+	static const unsigned int maxNumTiles=16; // Maximum number of tiles held in the cache
+	
+	private:
+	struct Tile // Structure for a tile of cells holding the elevation of their highest point
+		{
+		/* Elements: */
+		public:
+		int index[2]; // Index of the tile in the tile grid
+		unsigned int version; // Tree version from which the tile was built
+		unsigned int lastUsed; // Value of the lookup counter when the tile was last used
+		std::vector<Scalar> heights; // Elevations of the highest points in all cells in row-major order, or Math::Constants<Scalar>::min for empty cells
+		};
+	
+	/* Elements: */
+	Scalar cellSize; // Size of a cell; the cache is flushed when the cell size changes
+	std::vector<Tile*> tiles; // List of cached tiles
+	unsigned int version; // Current tree version; tiles built from older versions are refreshed
+	unsigned int lookupCounter; // Counter of height lookups, to evict least recently used tiles
+	bool haveLastQuery; // Flag whether the cache has been queried since the cell size was set
+	int lastQueryCell[2]; // Index of the cell containing the most recently queried position
+	
+	/* Private methods: */
+	Tile* findTile(int tileX,int tileY) const; // Returns the tile of the given index, or null if it is not cached
+	bool getCellHeight(int cellX,int cellY,Scalar& height); // Returns the height of the given cell if its tile is cached and the cell is not empty
+	void buildTile(int tileX,int tileY,LidarOctree* const* octrees,int numOctrees); // Builds or refreshes the tile of the given index from the given octrees' nodes in memory
+	
+	/* Constructors and destructors: */
+	public:
+	SurfaceHeightCache(void); // Creates an empty cache
+	private:
+	SurfaceHeightCache(const SurfaceHeightCache& source); // Prohibit copy constructor
+	SurfaceHeightCache& operator=(const SurfaceHeightCache& source); // Prohibit assignment operator
+	public:
+	~SurfaceHeightCache(void);
+	
+	/* Methods: */
+	void setCellSize(Scalar newCellSize); // Sets the size of cells; flushes the cache if the size changed
+	void invalidate(void) // Marks all tiles as out of date, to be refreshed from newly loaded nodes
+		{
+		++version;
+		}
+	bool getHeight(const Point& p,Scalar& height); // Returns the bilinearly interpolated height of the highest points around the given position; returns false if the cache does not cover the position yet
+	void update(LidarOctree* const* octrees,int numOctrees); // Builds or refreshes at most one missing or out-of-date tile around the most recently queried position from the given octrees
+	};
+
+#endif
@@ -0,0 +1,98 @@
+/***********************************************************************
+SystemMemory - Helper functions to query the host's physical memory and
+to derive automatic memory cache sizes from it.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "SystemMemory.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const size_t minCacheSize=size_t(64)*size_t(1024*1024); // Smallest automatic cache size
+
+}
+
+size_t getPhysicalMemorySize(void)
+	{
+	long numPages=sysconf(_SC_PHYS_PAGES);
+	long pageSize=sysconf(_SC_PAGESIZE);
+	if(numPages<=0||pageSize<=0)
+		return 0;
+	return size_t(numPages)*size_t(pageSize);
+	}
+
+size_t getAvailableMemorySize(void)
+	{
+	/* Read the kernel's estimate of allocatable memory, which includes page caches and reclaimable slabs: */
+	FILE* meminfo=fopen("/proc/meminfo","rt");
+	if(meminfo!=0)
+		{
+		char line[256];
+		while(fgets(line,sizeof(line),meminfo)!=0)
+			{
+			unsigned long long sizeKb;
+			if(sscanf(line,"MemAvailable: %llu kB",&sizeKb)==1)
+				{
+				fclose(meminfo);
+				return size_t(sizeKb)*size_t(1024);
+				}
+			}
+		fclose(meminfo);
+		}
+	
+	/* Fall back to the number of free pages: */
+	long numPages=sysconf(_SC_AVPHYS_PAGES);
+	long pageSize=sysconf(_SC_PAGESIZE);
+	if(numPages<=0||pageSize<=0)
+		return 0;
+	return size_t(numPages)*size_t(pageSize);
+	}
+
+size_t getAutoCacheSize(void)
+	{
+	size_t reserve=getPhysicalMemorySize()/8;
+	size_t available=getAvailableMemorySize();
+	size_t result=available>reserve?(available-reserve)/2:0;
+	return result>minCacheSize?result:minCacheSize;
+	}
+
+size_t adaptAutoCacheSize(size_t cacheSize,size_t numCachedBytes)
+	{
+	/* Give the cache half of the memory available beyond the reserve, or take away the reserve's deficit: */
+	size_t reserve=getPhysicalMemorySize()/8;
+	size_t available=getAvailableMemorySize();
+	size_t result;
+	if(available>=reserve)
+		result=numCachedBytes+(available-reserve)/2;
+	else
+		result=numCachedBytes>reserve-available?numCachedBytes-(reserve-available):0;
+	
+	/* Limit the result to the given cache size: */
+	if(result>cacheSize)
+		result=cacheSize;
+	return result>minCacheSize?result:minCacheSize;
+	}
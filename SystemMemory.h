@@ -0,0 +1,34 @@
+/***********************************************************************
+SystemMemory - Helper functions to query the host's physical memory and
+to derive automatic memory cache sizes from it.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef SYSTEMMEMORY_INCLUDED
+#define SYSTEMMEMORY_INCLUDED
+
+#include <stddef.h>
+
+size_t getPhysicalMemorySize(void); // Returns the total size of the host's physical memory in bytes
+size_t getAvailableMemorySize(void); // Returns the size of physical memory that can be allocated without swapping in bytes, including reclaimable file caches
+size_t getAutoCacheSize(void); // Returns a memory cache size in bytes that uses half of the currently available physical memory, but leaves an eighth of all physical memory to other processes
+size_t adaptAutoCacheSize(size_t cacheSize,size_t numCachedBytes); // Returns an adjusted memory cache size in bytes for a cache currently holding the given number of bytes, which shrinks the cache under memory pressure and grows it back up to the given size otherwise
+
+#endif
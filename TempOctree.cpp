@@ -27,12 +27,15 @@ Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string>
 #include <iostream>
 #include <Misc/Utility.h>
+#include <Misc/Timer.h>
 #include <Misc/StdError.h>
 
 #include "SplitPoints.h"
+#include "TraceEvents.h"
 
 /*********************************
 Methods of class TempOctree::Node:
@@ -133,29 +136,65 @@ void TempOctree::readLidarSubtree(TempOctree::Node& node,LidarFile::Offset child
 		}
 	}
 
-void* TempOctree::writerThreadMethod(void)
+void TempOctree::writeLeaf(TempOctree::Node& node)
 	{
-	while(true)
-		{
-		/* Get the next node from the write queue: */
-		Node* writeNode=0;
+	/* The leaf's points go to the same position in the octree file that they occupy in the partitioned point array: */
+	Offset offset=Offset(node.points-buildPoints)*Offset(sizeof(LidarPoint));
+	const char* writePtr=reinterpret_cast<const char*>(node.points);
+	size_t writeSize=node.numPoints*sizeof(LidarPoint);
+	off_t writePos=off_t(offset);
+	while(writeSize>0)
 		{
-		Threads::MutexCond::Lock writeQueueLock(writeQueueCond);
-		while(writerThreadRun&&writeQueue.empty())
-			writeQueueCond.wait(writeQueueLock);
-		if(writeQueue.empty())
+		ssize_t writeResult=pwrite(buildFd,writePtr,writeSize,writePos);
+		if(writeResult>0)
+			{
+			writePtr+=writeResult;
+			writeSize-=size_t(writeResult);
+			writePos+=off_t(writeResult);
+			}
+		else if(writeResult==0||errno!=EINTR)
+			{
+			/* Remember the error to be reported once the octree is finished: */
+			int error=writeResult==0?EIO:errno;
+			Threads::MutexCond::Lock buildQueueLock(buildQueueCond);
+			if(buildError==0)
+				buildError=error;
 			break;
-		writeNode=writeQueue.front();
-		writeQueue.pop_front();
+			}
 		}
-		
-		/* Write the node to the octree file: */
-		LidarPoint* points=writeNode->points;
-		writeNode->pointsOffset=file.getWritePos();
-		file.write(points,writeNode->numPoints);
+	
+	node.pointsOffset=offset;
+	}
+
+void TempOctree::splitNode(TempOctree::Node& node)
+	{
+	/* Make this node an interior node: */
+	node.children=new Node[8];
+	
+	/* Split the point array between the node's children: */
+	node.children[0].numPoints=node.numPoints;
+	node.children[0].points=node.points;
+	
+	/* Split the point set along the three dimensions, according to the node's center: */
+	int numSplits=1;
+	int splitSize=4;
+	for(int i=2;i>=0;--i,numSplits<<=1,splitSize>>=1)
+		{
+		int leftIndex=0;
+		for(int j=0;j<numSplits;++j,leftIndex+=splitSize*2)
+			{
+			size_t leftNumPoints=splitPoints(node.children[leftIndex].points,node.children[leftIndex].numPoints,i,node.domain.getCenter(i));
+			node.children[leftIndex+splitSize].points=node.children[leftIndex].points+leftNumPoints;
+			node.children[leftIndex+splitSize].numPoints=node.children[leftIndex].numPoints-leftNumPoints;
+			node.children[leftIndex].numPoints=leftNumPoints;
+			}
 		}
 	
-	return 0;
+	/* Set the children's domains: */
+	for(int childIndex=0;childIndex<8;++childIndex)
+		node.children[childIndex].domain=Cube(node.domain,childIndex);
+	
+	node.points=0;
 	}
 
 void TempOctree::createSubTree(TempOctree::Node& node)
@@ -163,45 +202,58 @@ void TempOctree::createSubTree(TempOctree::Node& node)
 	/* Check if the number of points is smaller than the maximum: */
 	if(node.numPoints<=size_t(maxNumPointsPerNode))
 		{
-		/* Queue up this node to be written to the octree file: */
-		Threads::MutexCond::Lock writeQueueLock(writeQueueCond);
-		writeQueue.push_back(&node);
-		writeQueueCond.signal();
+		/* Write this node's points to the octree file: */
+		writeLeaf(node);
 		}
 	else
 		{
-		/* Make this node an interior node: */
-		node.children=new Node[8];
-		
-		/* Split the point array between the node's children: */
-		node.children[0].numPoints=node.numPoints;
-		node.children[0].points=node.points;
+		/* Split this node and create the node's children's subtrees: */
+		splitNode(node);
+		for(int childIndex=0;childIndex<8;++childIndex)
+			createSubTree(node.children[childIndex]);
+		}
+	}
+
+void* TempOctree::builderThreadMethod(void)
+	{
+	while(true)
+		{
+		/* Get the next node from the build queue: */
+		Node* buildNode=0;
+		{
+		Threads::MutexCond::Lock buildQueueLock(buildQueueCond);
+		while(numBuildTasks>0&&buildQueue.empty())
+			buildQueueCond.wait(buildQueueLock);
+		if(buildQueue.empty())
+			break;
+		buildNode=buildQueue.front();
+		buildQueue.pop_front();
+		}
 		
-		/* Split the point set along the three dimensions, according to the node's center: */
-		int numSplits=1;
-		int splitSize=4;
-		for(int i=2;i>=0;--i,numSplits<<=1,splitSize>>=1)
+		if(buildNode->numPoints>buildSplitThreshold)
 			{
-			int leftIndex=0;
-			for(int j=0;j<numSplits;++j,leftIndex+=splitSize*2)
-				{
-				size_t leftNumPoints=splitPoints(node.children[leftIndex].points,node.children[leftIndex].numPoints,i,node.domain.getCenter(i));
-				node.children[leftIndex+splitSize].points=node.children[leftIndex].points+leftNumPoints;
-				node.children[leftIndex+splitSize].numPoints=node.children[leftIndex].numPoints-leftNumPoints;
-				node.children[leftIndex].numPoints=leftNumPoints;
-				}
+			/* Split the node and queue up its children as new tasks: */
+			splitNode(*buildNode);
+			Threads::MutexCond::Lock buildQueueLock(buildQueueCond);
+			for(int childIndex=0;childIndex<8;++childIndex)
+				buildQueue.push_back(&buildNode->children[childIndex]);
+			numBuildTasks+=7;
+			buildQueueCond.broadcast();
 			}
-		
-		/* Create the node's children's subtrees: */
-		for(int childIndex=0;childIndex<8;++childIndex)
+		else
 			{
-			Node& child=node.children[childIndex];
-			child.domain=Cube(node.domain,childIndex);
-			createSubTree(node.children[childIndex]);
+			/* Create the node's entire subtree locally: */
+			{
+			TraceEvents::Scope traceScope("BuildSubtree","TempOctree");
+			createSubTree(*buildNode);
+			}
+			Threads::MutexCond::Lock buildQueueLock(buildQueueCond);
+			if(--numBuildTasks==0)
+				buildQueueCond.broadcast();
 			}
-		
-		node.points=0;
 		}
+	
+	return 0;
 	}
 
 LidarPoint* TempOctree::getPointsInCube(TempOctree::Node& node,const Cube& cube,LidarPoint* points)
@@ -225,6 +277,7 @@ LidarPoint* TempOctree::getPointsInCube(TempOctree::Node& node,const Cube& cube,
 		file.setReadPosAbs(node.pointsOffset);
 		for(unsigned int i=0;i<node.numPoints;++i)
 			*(points++)=file.read<LidarPoint>();
+		numBytesRead+=node.numPoints*sizeof(LidarPoint);
 		}
 	else
 		{
@@ -236,6 +289,7 @@ LidarPoint* TempOctree::getPointsInCube(TempOctree::Node& node,const Cube& cube,
 			if(cube.contains(lp))
 				*(points++)=lp;
 			}
+		numBytesRead+=node.numPoints*sizeof(LidarPoint);
 		}
 	
 	return points;
@@ -261,17 +315,31 @@ int createTempFile(char* fileNameTemplate)
 
 }
 
-TempOctree::TempOctree(char* fileNameTemplate,unsigned int sMaxNumPointsPerNode,LidarPoint* points,size_t numPoints)
+TempOctree::TempOctree(char* fileNameTemplate,unsigned int sMaxNumPointsPerNode,LidarPoint* points,size_t numPoints,unsigned int numThreads)
 	:tempFileName(new char[strlen(fileNameTemplate)+1]),
 	 file(createTempFile(fileNameTemplate),File::ReadWrite),
 	 maxNumPointsPerNode(sMaxNumPointsPerNode),
 	 pointBbox(Box::empty),
-	 writerThreadRun(true),writerThread(this,&TempOctree::writerThreadMethod)
+	 buildPoints(points),buildFd(-1),buildSplitThreshold(0),
+	 numBuildTasks(0),buildError(0),
+	 buildTime(0.0),numBytesWritten(0),numBytesRead(0)
 	{
+	Misc::Timer buildTimer;
+	
 	/* Save the temporary file name: */
 	strcpy(tempFileName,fileNameTemplate);
 	
-	/* Immediately unlink the temporary file; it will stay alive until the file handle is closed: */
+	/* Open a second descriptor through which the builder threads write leaf nodes at their final positions: */
+	buildFd=open(tempFileName,O_WRONLY);
+	if(buildFd<0)
+		{
+		int error=errno;
+		unlink(tempFileName);
+		delete[] tempFileName;
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,error,"Cannot open temporary octree file %s for writing",fileNameTemplate);
+		}
+	
+	/* Immediately unlink the temporary file; it will stay alive until the file handles are closed: */
 	unlink(tempFileName);
 	
 	/* Calculate the point set's bounding box: */
@@ -303,13 +371,41 @@ TempOctree::TempOctree(char* fileNameTemplate,unsigned int sMaxNumPointsPerNode,
 	/* Create the root node's subtree: */
 	root.numPoints=numPoints;
 	root.points=points;
-	createSubTree(root);
+	if(numThreads>1)
+		{
+		/* Split nodes into tasks until there are enough subtrees to keep all threads busy: */
+		buildSplitThreshold=numPoints/(size_t(numThreads)*64);
+		if(buildSplitThreshold<size_t(maxNumPointsPerNode))
+			buildSplitThreshold=size_t(maxNumPointsPerNode);
+		buildQueue.push_back(&root);
+		numBuildTasks=1;
+		
+		/* Create the subtrees in parallel, with the creating thread acting as one of the builders: */
+		Threads::Thread* builderThreads=new Threads::Thread[numThreads-1];
+		for(unsigned int i=0;i<numThreads-1;++i)
+			builderThreads[i].start(this,&TempOctree::builderThreadMethod);
+		builderThreadMethod();
+		for(unsigned int i=0;i<numThreads-1;++i)
+			builderThreads[i].join();
+		delete[] builderThreads;
+		}
+	else
+		createSubTree(root);
+	
+	/* Close the write descriptor and check for errors: */
+	close(buildFd);
+	buildFd=-1;
+	buildPoints=0;
+	if(buildError!=0)
+		{
+		delete[] tempFileName;
+		throw Misc::makeLibcErr(__PRETTY_FUNCTION__,buildError,"Cannot write temporary octree file %s",fileNameTemplate);
+		}
 	
-	/* Wait until the octree file is finished: */
-	writerThreadRun=false;
-	writeQueueCond.signal();
-	writerThread.join();
-	file.flush();
+	/* Every point was written exactly once: */
+	numBytesWritten=numPoints*sizeof(LidarPoint);
+	buildTimer.elapse();
+	buildTime=buildTimer.getTime();
 	}
 
 namespace {
@@ -330,7 +426,10 @@ std::string getLidarPartFileName(const char* lidarFileName,const char* partFileN
 
 TempOctree::TempOctree(const char* lidarFileName)
 	:tempFileName(0),
-	 file(getLidarPartFileName(lidarFileName,"Points").c_str(),IO::File::ReadOnly)
+	 file(getLidarPartFileName(lidarFileName,"Points").c_str(),IO::File::ReadOnly),
+	 buildPoints(0),buildFd(-1),buildSplitThreshold(0),
+	 numBuildTasks(0),buildError(0),
+	 buildTime(0.0),numBytesWritten(0),numBytesRead(0)
 	{
 	file.setEndianness(Misc::LittleEndian);
 	
@@ -74,24 +74,48 @@ class TempOctree
 	unsigned int maxNumPointsPerNode; // The maximum number of points that can be stored in each leaf node
 	Box pointBbox; // Bounding box containing all points in this octree
 	Node root; // Root of the temporary octree
-	Threads::MutexCond writeQueueCond; // Condition variable to signal new entries in the write queue
-	std::deque<Node*> writeQueue; // Queue of octree leaf nodes to be written to the octree file
-	volatile bool writerThreadRun; // Flag to shut down the writer thread after the octree has been built
-	Threads::Thread writerThread; // Thread to write leaf nodes' point sets to the octree file in the background
+	LidarPoint* buildPoints; // Base of the point array from which the octree is being built; leaves' points are stored at the same relative positions in the octree file
+	int buildFd; // Write-only descriptor of the temporary octree file shared by all builder threads during tree creation
+	size_t buildSplitThreshold; // Nodes with more points than this are split by a single task and their children are queued as new tasks
+	Threads::MutexCond buildQueueCond; // Condition variable protecting the build task queue, signaled when tasks are added or the last task finishes
+	std::deque<Node*> buildQueue; // Queue of nodes whose subtrees still need to be created
+	size_t numBuildTasks; // Number of queued or currently processed subtree creation tasks
+	int buildError; // Error code of the first failed write to the octree file, or 0
+	double buildTime; // Time spent creating the temporary octree in seconds
+	size_t numBytesWritten; // Number of point data bytes written to the temporary octree file
+	size_t numBytesRead; // Number of point data bytes read from the octree file by getPointsInCube
 	
 	/* Private methods: */
 	void readLidarSubtree(Node& node,LidarFile::Offset childrenOffset,LidarFile& indexFile);
-	void* writerThreadMethod(void);
+	void writeLeaf(Node& node);
+	void splitNode(Node& node);
 	void createSubTree(Node& node);
+	void* builderThreadMethod(void);
 	LidarPoint* getPointsInCube(Node& node,const Cube& cube,LidarPoint* points);
 	
 	/* Constructors and destructors: */
 	public:
-	TempOctree(char* fileNameTemplate,unsigned int sMaxNumPointsPerNode,LidarPoint* points,size_t numPoints); // Creates a temporary octree for the given array of points; shuffles point array in the process
+	TempOctree(char* fileNameTemplate,unsigned int sMaxNumPointsPerNode,LidarPoint* points,size_t numPoints,unsigned int numThreads =1); // Creates a temporary octree for the given array of points using the given number of threads; shuffles point array in the process
 	TempOctree(const char* lidarFileName); // Creates a TempOctree wrapper around an existing octree in .LiDAR format
 	~TempOctree(void);
 	
 	/* Methods: */
+	const char* getTempFileName(void) const // Returns the name of the temporary octree file, or null if the octree wraps a LiDAR file
+		{
+		return tempFileName;
+		};
+	double getBuildTime(void) const // Returns the time spent creating the temporary octree in seconds
+		{
+		return buildTime;
+		};
+	size_t getNumBytesWritten(void) const // Returns the number of point data bytes written to the temporary octree file
+		{
+		return numBytesWritten;
+		};
+	size_t getNumBytesRead(void) const // Returns the number of point data bytes read from the octree file so far
+		{
+		return numBytesRead;
+		};
 	size_t getTotalNumPoints(void) const // Returns the total number of points in this octree
 		{
 		return root.numPoints;
@@ -0,0 +1,180 @@
+/***********************************************************************
+TraceEvents - Class to record scoped trace events from multiple threads
+and write them as a Chrome / Perfetto trace event file.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#include "TraceEvents.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <Misc/StdError.h>
+#include <Threads/Mutex.h>
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct Event // Structure for a completed trace event
+	{
+	/* Elements: */
+	public:
+	const char* name;
+	const char* category;
+	Misc::UInt64 beginTime,endTime;
+	unsigned int threadIndex; // Index of the thread that recorded the event
+	};
+
+struct ThreadInfo // Structure identifying a thread that recorded events
+	{
+	/* Elements: */
+	public:
+	pthread_t thread;
+	std::string name; // Name assigned to the thread, or empty
+	};
+
+/******************
+Global trace state:
+******************/
+
+Threads::Mutex traceMutex; // Mutex serializing access to the trace state
+std::string traceFileName; // Name of the trace file to write
+std::vector<Event> events; // List of recorded events
+std::vector<ThreadInfo> threads; // List of threads that recorded events
+
+/****************
+Helper functions:
+****************/
+
+unsigned int getThreadIndex(void) // Returns the index of the calling thread; must be called with the trace mutex locked
+	{
+	pthread_t self=pthread_self();
+	for(unsigned int i=0;i<threads.size();++i)
+		if(pthread_equal(threads[i].thread,self))
+			return i;
+	
+	ThreadInfo ti;
+	ti.thread=self;
+	threads.push_back(ti);
+	return (unsigned int)(threads.size()-1);
+	}
+
+void writeEscaped(FILE* file,const char* string) // Writes a string as the contents of a JSON string
+	{
+	for(const char* sPtr=string;*sPtr!='\0';++sPtr)
+		{
+		if(*sPtr=='"'||*sPtr=='\\')
+			fputc('\\',file);
+		fputc(*sPtr,file);
+		}
+	}
+
+}
+
+/************************************
+Static elements of class TraceEvents:
+************************************/
+
+volatile bool TraceEvents::enabled=false;
+
+/****************************
+Methods of class TraceEvents:
+****************************/
+
+void TraceEvents::start(const char* newTraceFileName)
+	{
+	Threads::Mutex::Lock traceLock(traceMutex);
+	traceFileName=newTraceFileName;
+	events.reserve(65536);
+	enabled=true;
+	}
+
+void TraceEvents::finish(void)
+	{
+	Threads::Mutex::Lock traceLock(traceMutex);
+	if(traceFileName.empty())
+		return;
+	enabled=false;
+	
+	/* Write the trace file: */
+	FILE* traceFile=fopen(traceFileName.c_str(),"wt");
+	if(traceFile==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Cannot create trace file %s",traceFileName.c_str());
+	unsigned int pid=(unsigned int)(getpid());
+	fprintf(traceFile,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first=true;
+	for(unsigned int i=0;i<threads.size();++i)
+		if(!threads[i].name.empty())
+			{
+			fprintf(traceFile,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"",first?"":",\n",pid,i);
+			writeEscaped(traceFile,threads[i].name.c_str());
+			fprintf(traceFile,"\"}}");
+			first=false;
+			}
+	for(std::vector<Event>::iterator eIt=events.begin();eIt!=events.end();++eIt)
+		{
+		fprintf(traceFile,"%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",first?"":",\n",eIt->name,eIt->category,pid,eIt->threadIndex,(unsigned long long)(eIt->beginTime),(unsigned long long)(eIt->endTime-eIt->beginTime));
+		first=false;
+		}
+	fprintf(traceFile,"\n]}\n");
+	fclose(traceFile);
+	
+	/* Reset the trace state: */
+	traceFileName.clear();
+	std::vector<Event>().swap(events);
+	threads.clear();
+	}
+
+Misc::UInt64 TraceEvents::getTime(void)
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return Misc::UInt64(now.tv_sec)*Misc::UInt64(1000000)+Misc::UInt64(now.tv_nsec/1000);
+	}
+
+void TraceEvents::setThreadName(const char* threadName)
+	{
+	/* Remember the name even if tracing has not started yet: */
+	Threads::Mutex::Lock traceLock(traceMutex);
+	threads[getThreadIndex()].name=threadName;
+	}
+
+void TraceEvents::record(const char* name,const char* category,Misc::UInt64 beginTime,Misc::UInt64 endTime)
+	{
+	Threads::Mutex::Lock traceLock(traceMutex);
+	
+	/* Ignore events that end after tracing was finished: */
+	if(!enabled)
+		return;
+	
+	Event e;
+	e.name=name;
+	e.category=category;
+	e.beginTime=beginTime;
+	e.endTime=endTime;
+	e.threadIndex=getThreadIndex();
+	events.push_back(e);
+	}
@@ -0,0 +1,77 @@
+/***********************************************************************
+TraceEvents - Class to record scoped trace events from multiple threads
+and write them as a Chrome / Perfetto trace event file.
+Copyright (c) 2026 Oliver Kreylos
+
+This file is part of the LiDAR processing and analysis package.
+
+The LiDAR processing and analysis package is free software; you can
+redistribute it and/or modify it under the terms of the GNU General
+Public License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+The LiDAR processing and analysis package is distributed in the hope
+that it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the LiDAR processing and analysis package; if not, write to the
+Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+02111-1307 USA
+***********************************************************************/
+
+#ifndef TRACEEVENTS_INCLUDED
+#define TRACEEVENTS_INCLUDED
+
+#include <Misc/SizedTypes.h>
+
+class TraceEvents
+	{
+	/* Embedded classes: */
+	public:
+	class Scope // Class to record the lifetime of a scope as a trace event; does nothing unless tracing is enabled
+		{
+		/* Elements: */
+		private:
+		const char* name; // Name of the event, or null if tracing was disabled when the scope was entered
+		const char* category; // Category of the event
+		Misc::UInt64 beginTime; // Time when the scope was entered
+		
+		/* Constructors and destructors: */
+		public:
+		Scope(const char* sName,const char* sCategory) // Enters a scope; name and category must be string literals
+			:name(0)
+			{
+			if(enabled)
+				{
+				name=sName;
+				category=sCategory;
+				beginTime=getTime();
+				}
+			}
+		~Scope(void)
+			{
+			if(name!=0)
+				record(name,category,beginTime,getTime());
+			}
+		};
+	
+	/* Elements: */
+	private:
+	static volatile bool enabled; // Flag whether trace events are currently being recorded
+	
+	/* Methods: */
+	public:
+	static void start(const char* traceFileName); // Starts recording trace events to be written to the given file
+	static void finish(void); // Stops recording and writes all recorded events to the trace file; does nothing if tracing was not started
+	static bool isEnabled(void) // Returns true if trace events are currently being recorded
+		{
+		return enabled;
+		}
+	static Misc::UInt64 getTime(void); // Returns the current time in microseconds
+	static void setThreadName(const char* threadName); // Names the calling thread in the trace file; can be called before tracing starts
+	static void record(const char* name,const char* category,Misc::UInt64 beginTime,Misc::UInt64 endTime); // Records a completed event on the calling thread; name and category must be string literals
+	};
+
+#endif